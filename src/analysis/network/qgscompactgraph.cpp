@@ -0,0 +1,85 @@
+/***************************************************************************
+  qgscompactgraph.cpp
+  --------------------------------------
+  Date                 : February 2017
+  Copyright            : (C) 2017 by the QGIS project
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "qgscompactgraph.h"
+#include "qgsgraph.h"
+
+QgsCompactGraph::QgsCompactGraph( const QgsGraph &graph, int strategyIndex )
+  : mStrategyIndex( strategyIndex )
+{
+  const int vertexCount = graph.vertexCount();
+  const int edgeCount = graph.edgeCount();
+
+  mX.resize( vertexCount );
+  mY.resize( vertexCount );
+  mOutOffsets.resize( vertexCount + 1 );
+  mInOffsets.resize( vertexCount + 1 );
+  mOutTargets.reserve( edgeCount );
+  mOutEdgeIds.reserve( edgeCount );
+  mOutCosts.reserve( edgeCount );
+  mInSources.reserve( edgeCount );
+  mInEdgeIds.reserve( edgeCount );
+  mInCosts.reserve( edgeCount );
+
+  // convert the costs only once, the edges are visited twice
+  QVector< double > costs( edgeCount );
+  for ( int i = 0; i < edgeCount; ++i )
+  {
+    costs[i] = graph.edge( i ).cost( strategyIndex ).toDouble();
+  }
+
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    const QgsGraphVertex &vertex = graph.vertex( i );
+    const QgsPoint p = vertex.point();
+    mX[i] = p.x();
+    mY[i] = p.y();
+
+    mOutOffsets[i] = mOutTargets.count();
+    Q_FOREACH ( int edgeId, vertex.outEdges() )
+    {
+      mOutTargets << graph.edge( edgeId ).inVertex();
+      mOutEdgeIds << edgeId;
+      mOutCosts << costs.at( edgeId );
+    }
+
+    mInOffsets[i] = mInSources.count();
+    Q_FOREACH ( int edgeId, vertex.inEdges() )
+    {
+      mInSources << graph.edge( edgeId ).outVertex();
+      mInEdgeIds << edgeId;
+      mInCosts << costs.at( edgeId );
+    }
+  }
+  mOutOffsets[vertexCount] = mOutTargets.count();
+  mInOffsets[vertexCount] = mInSources.count();
+
+  // the ratio must hold for every edge for the distance based bound to be valid
+  double minRatio = std::numeric_limits<double>::infinity();
+  for ( int i = 0; i < edgeCount; ++i )
+  {
+    const QgsGraphEdge &edge = graph.edge( i );
+    const double length = std::hypot( mX.at( edge.inVertex() ) - mX.at( edge.outVertex() ),
+                                      mY.at( edge.inVertex() ) - mY.at( edge.outVertex() ) );
+    if ( length > 0.0 )
+    {
+      minRatio = std::min( minRatio, costs.at( i ) / length );
+    }
+  }
+  mCostPerUnitDistance = std::isfinite( minRatio ) && minRatio > 0.0 ? minRatio : 0.0;
+}
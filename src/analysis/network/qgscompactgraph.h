@@ -0,0 +1,103 @@
+/***************************************************************************
+  qgscompactgraph.h
+  --------------------------------------
+  Date                 : February 2017
+  Copyright            : (C) 2017 by the QGIS project
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#ifndef QGSCOMPACTGRAPH_H
+#define QGSCOMPACTGRAPH_H
+
+#include <QVector>
+
+#include "qgspoint.h"
+#include "qgis_analysis.h"
+
+class QgsGraph;
+
+/**
+ * \ingroup analysis
+ * \class QgsCompactGraph
+ * \brief Immutable and compact representation of a QgsGraph for a single strategy.
+ *
+ * The adjacency of the graph is packed into flat arrays (compressed sparse rows), for
+ * both the outgoing and the incoming edges of every vertex, and the cost of each edge
+ * is converted to a double once, for the strategy given on construction. Vertex and edge
+ * indices are the same as in the source graph.
+ *
+ * The compact graph is meant to be built once and used for many shortest path queries,
+ * see QgsGraphAnalyzer::dijkstra() and QgsGraphAnalyzer::shortestPath(). It does not
+ * reference the source graph, which can be destroyed afterwards.
+ *
+ * \note added in QGIS 3.0
+ */
+class ANALYSIS_EXPORT QgsCompactGraph
+{
+  public:
+
+    /**
+     * Creates a compact copy of \a graph, using the edge costs calculated by the strategy
+     * at \a strategyIndex.
+     */
+    QgsCompactGraph( const QgsGraph &graph, int strategyIndex );
+
+    /**
+     * Returns the index of the strategy the edge costs were taken from.
+     */
+    int strategyIndex() const { return mStrategyIndex; }
+
+    /**
+     * Returns number of graph vertices
+     */
+    int vertexCount() const { return mX.count(); }
+
+    /**
+     * Returns number of graph edges
+     */
+    int edgeCount() const { return mOutTargets.count(); }
+
+    /**
+     * Returns the point associated with the vertex at \a vertexIdx
+     */
+    QgsPoint point( int vertexIdx ) const { return QgsPoint( mX.at( vertexIdx ), mY.at( vertexIdx ) ); }
+
+    /**
+     * Returns the lowest ratio between the cost of an edge and the straight line distance
+     * between its vertices. Multiplied by the distance between two vertices, it gives a lower
+     * bound of the cost of any path between them, which guides QgsGraphAnalyzer::shortestPath().
+     * Returns 0 if no such bound exists, e.g. if some edges have a zero cost.
+     */
+    double costPerUnitDistance() const { return mCostPerUnitDistance; }
+
+  private:
+
+    int mStrategyIndex;
+
+    QVector< double > mX;
+    QVector< double > mY;
+
+    //! Outgoing edges of vertex i are at [mOutOffsets[i], mOutOffsets[i+1])
+    QVector< int > mOutOffsets;
+    QVector< int > mOutTargets;
+    QVector< int > mOutEdgeIds;
+    QVector< double > mOutCosts;
+
+    //! Incoming edges of vertex i are at [mInOffsets[i], mInOffsets[i+1])
+    QVector< int > mInOffsets;
+    QVector< int > mInSources;
+    QVector< int > mInEdgeIds;
+    QVector< double > mInCosts;
+
+    double mCostPerUnitDistance = 0.0;
+
+    friend class QgsGraphAnalyzer;
+};
+
+#endif // QGSCOMPACTGRAPH_H
@@ -0,0 +1,551 @@
+/***************************************************************************
+  qgscontractionhierarchy.cpp
+  --------------------------------------
+  Date                 : February 2017
+  Copyright            : (C) 2017 by the QGIS project
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <vector>
+
+#include <QDataStream>
+#include <QFile>
+
+#include "qgscontractionhierarchy.h"
+#include "qgsgraph.h"
+#include "qgsfeedback.h"
+
+///@cond PRIVATE
+
+static const quint32 FILE_MAGIC = 0x51434831; // "QCH1"
+static const qint32 FILE_VERSION = 1;
+
+//! Maximum number of vertices settled by a witness search before a shortcut is assumed to be needed
+static const int WITNESS_SETTLED_LIMIT = 500;
+
+struct QgsChQueueEntry
+{
+  QgsChQueueEntry( double cost, int vertex )
+    : cost( cost )
+    , vertex( vertex )
+  {}
+
+  double cost;
+  int vertex;
+
+  bool operator>( const QgsChQueueEntry &other ) const { return cost > other.cost; }
+};
+
+typedef std::priority_queue< QgsChQueueEntry, std::vector< QgsChQueueEntry >, std::greater< QgsChQueueEntry > > QgsChQueue;
+
+//! Edge of the graph being contracted, seen from one of its vertices
+struct QgsChEdge
+{
+  int vertex;
+  double cost;
+  int middle;
+  int edgeId;
+};
+
+/**
+ * Contracts the vertices of a graph one after the other. The remaining graph is kept
+ * as adjacency lists which only contain vertices not contracted yet, with at most one
+ * edge (the cheapest) between two vertices.
+ */
+class QgsChContractor
+{
+  public:
+
+    explicit QgsChContractor( int vertexCount )
+      : mOut( vertexCount )
+      , mIn( vertexCount )
+      , mUp( vertexCount )
+      , mDown( vertexCount )
+      , mContracted( vertexCount, 0 )
+      , mContractedNeighbors( vertexCount, 0 )
+      , mWitnessCost( vertexCount, std::numeric_limits<double>::infinity() )
+    {}
+
+    void addEdge( int from, int to, double cost, int middle, int edgeId )
+    {
+      if ( from == to )
+        return;
+
+      QgsChEdge out = { to, cost, middle, edgeId };
+      QgsChEdge in = { from, cost, middle, edgeId };
+      if ( addToList( mOut[ from ], out ) )
+        addToList( mIn[ to ], in );
+    }
+
+    //! Returns the priority of a vertex, vertices with the lowest priority are contracted first
+    int priority( int vertex )
+    {
+      const int edgeDifference = processShortcuts( vertex, false ) - mOut.at( vertex ).count() - mIn.at( vertex ).count();
+      return edgeDifference + mContractedNeighbors.at( vertex );
+    }
+
+    void contract( int vertex )
+    {
+      processShortcuts( vertex, true );
+
+      // the remaining edges all lead to vertices contracted later
+      mUp[ vertex ] = mOut.at( vertex );
+      mDown[ vertex ] = mIn.at( vertex );
+      Q_FOREACH ( const QgsChEdge &edge, mOut.at( vertex ) )
+      {
+        removeFromList( mIn[ edge.vertex ], vertex );
+        mContractedNeighbors[ edge.vertex ]++;
+      }
+      Q_FOREACH ( const QgsChEdge &edge, mIn.at( vertex ) )
+      {
+        removeFromList( mOut[ edge.vertex ], vertex );
+        mContractedNeighbors[ edge.vertex ]++;
+      }
+      mOut[ vertex ] = QVector< QgsChEdge >();
+      mIn[ vertex ] = QVector< QgsChEdge >();
+      mContracted[ vertex ] = 1;
+    }
+
+    bool isContracted( int vertex ) const { return mContracted.at( vertex ); }
+
+    const QVector< QgsChEdge > &upEdges( int vertex ) const { return mUp.at( vertex ); }
+    const QVector< QgsChEdge > &downEdges( int vertex ) const { return mDown.at( vertex ); }
+
+  private:
+
+    //! Adds or updates an edge in a list, returns false if a cheaper edge already exists
+    static bool addToList( QVector< QgsChEdge > &list, const QgsChEdge &edge )
+    {
+      for ( int i = 0; i < list.count(); ++i )
+      {
+        if ( list.at( i ).vertex == edge.vertex )
+        {
+          if ( edge.cost >= list.at( i ).cost )
+            return false;
+          list[i] = edge;
+          return true;
+        }
+      }
+      list.append( edge );
+      return true;
+    }
+
+    static void removeFromList( QVector< QgsChEdge > &list, int vertex )
+    {
+      for ( int i = 0; i < list.count(); ++i )
+      {
+        if ( list.at( i ).vertex == vertex )
+        {
+          list.remove( i );
+          return;
+        }
+      }
+    }
+
+    /**
+     * Counts the shortcuts needed to contract a vertex, and adds them if \a apply is true.
+     * A shortcut u -> w replaces the path u -> vertex -> w unless a witness path which is not
+     * longer and avoids vertex is found.
+     */
+    int processShortcuts( int vertex, bool apply )
+    {
+      int count = 0;
+      const QVector< QgsChEdge > inEdges = mIn.at( vertex );
+      const QVector< QgsChEdge > outEdges = mOut.at( vertex );
+      Q_FOREACH ( const QgsChEdge &inEdge, inEdges )
+      {
+        double maxCost = -1.0;
+        Q_FOREACH ( const QgsChEdge &outEdge, outEdges )
+        {
+          if ( outEdge.vertex != inEdge.vertex )
+            maxCost = std::max( maxCost, inEdge.cost + outEdge.cost );
+        }
+        if ( maxCost < 0.0 )
+          continue;
+
+        witnessSearch( inEdge.vertex, vertex, maxCost );
+
+        Q_FOREACH ( const QgsChEdge &outEdge, outEdges )
+        {
+          if ( outEdge.vertex == inEdge.vertex )
+            continue;
+
+          const double cost = inEdge.cost + outEdge.cost;
+          if ( mWitnessCost.at( outEdge.vertex ) <= cost )
+            continue;
+
+          count++;
+          if ( apply )
+            addEdge( inEdge.vertex, outEdge.vertex, cost, vertex, -1 );
+        }
+      }
+      return count;
+    }
+
+    //! Bounded Dijkstra search from source in the remaining graph, without going through excluded
+    void witnessSearch( int source, int excluded, double maxCost )
+    {
+      Q_FOREACH ( int vertex, mWitnessTouched )
+        mWitnessCost[ vertex ] = std::numeric_limits<double>::infinity();
+      mWitnessTouched.clear();
+
+      mWitnessCost[ source ] = 0.0;
+      mWitnessTouched << source;
+      QgsChQueue queue;
+      queue.push( QgsChQueueEntry( 0.0, source ) );
+
+      int settled = 0;
+      while ( !queue.empty() )
+      {
+        const QgsChQueueEntry entry = queue.top();
+        queue.pop();
+        if ( entry.cost > mWitnessCost.at( entry.vertex ) )
+          continue;
+        if ( entry.cost > maxCost || ++settled > WITNESS_SETTLED_LIMIT )
+          break;
+
+        Q_FOREACH ( const QgsChEdge &edge, mOut.at( entry.vertex ) )
+        {
+          if ( edge.vertex == excluded )
+            continue;
+
+          const double cost = entry.cost + edge.cost;
+          if ( cost < mWitnessCost.at( edge.vertex ) )
+          {
+            if ( std::isinf( mWitnessCost.at( edge.vertex ) ) )
+              mWitnessTouched << edge.vertex;
+            mWitnessCost[ edge.vertex ] = cost;
+            queue.push( QgsChQueueEntry( cost, edge.vertex ) );
+          }
+        }
+      }
+    }
+
+    QVector< QVector< QgsChEdge > > mOut;
+    QVector< QVector< QgsChEdge > > mIn;
+    QVector< QVector< QgsChEdge > > mUp;
+    QVector< QVector< QgsChEdge > > mDown;
+    QVector< char > mContracted;
+    QVector< int > mContractedNeighbors;
+
+    QVector< double > mWitnessCost;
+    QVector< int > mWitnessTouched;
+};
+
+///@endcond
+
+QgsContractionHierarchy::QgsContractionHierarchy( const QgsGraph &graph, int strategyIndex, QgsFeedback *feedback )
+  : mStrategyIndex( strategyIndex )
+{
+  const int vertexCount = graph.vertexCount();
+
+  QgsChContractor contractor( vertexCount );
+  for ( int i = 0; i < graph.edgeCount(); ++i )
+  {
+    const QgsGraphEdge &edge = graph.edge( i );
+    contractor.addEdge( edge.outVertex(), edge.inVertex(), edge.cost( strategyIndex ).toDouble(), -1, i );
+  }
+
+  // contract the vertex with the lowest priority, priorities in the queue are updated lazily
+  QgsChQueue queue;
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    queue.push( QgsChQueueEntry( contractor.priority( i ), i ) );
+  }
+
+  mRank.fill( -1, vertexCount );
+  int contracted = 0;
+  while ( !queue.empty() )
+  {
+    const int vertex = queue.top().vertex;
+    queue.pop();
+    if ( contractor.isContracted( vertex ) )
+      continue;
+
+    const int priority = contractor.priority( vertex );
+    if ( !queue.empty() && priority > queue.top().cost )
+    {
+      queue.push( QgsChQueueEntry( priority, vertex ) );
+      continue;
+    }
+
+    contractor.contract( vertex );
+    mRank[ vertex ] = contracted++;
+
+    if ( feedback && contracted % 1000 == 0 )
+    {
+      if ( feedback->isCanceled() )
+      {
+        mRank.clear();
+        return;
+      }
+      feedback->setProgress( 100.0 * contracted / vertexCount );
+    }
+  }
+
+  mUpOffsets.resize( vertexCount + 1 );
+  mDownOffsets.resize( vertexCount + 1 );
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    mUpOffsets[i] = mUpVertices.count();
+    Q_FOREACH ( const QgsChEdge &edge, contractor.upEdges( i ) )
+    {
+      mUpVertices << edge.vertex;
+      mUpCosts << edge.cost;
+      mUpEdgeIds << edge.edgeId;
+      mUpMiddle << edge.middle;
+    }
+
+    mDownOffsets[i] = mDownVertices.count();
+    Q_FOREACH ( const QgsChEdge &edge, contractor.downEdges( i ) )
+    {
+      mDownVertices << edge.vertex;
+      mDownCosts << edge.cost;
+      mDownEdgeIds << edge.edgeId;
+      mDownMiddle << edge.middle;
+    }
+  }
+  mUpOffsets[ vertexCount ] = mUpVertices.count();
+  mDownOffsets[ vertexCount ] = mDownVertices.count();
+
+  if ( feedback )
+    feedback->setProgress( 100.0 );
+  mValid = true;
+}
+
+int QgsContractionHierarchy::shortcutCount() const
+{
+  return std::count_if( mUpMiddle.constBegin(), mUpMiddle.constEnd(), []( int middle ) { return middle >= 0; } )
+         + std::count_if( mDownMiddle.constBegin(), mDownMiddle.constEnd(), []( int middle ) { return middle >= 0; } );
+}
+
+double QgsContractionHierarchy::upwardSearch( int vertexIdx, bool forward, SearchResult &result, const SearchResult *opposite, int *meeting ) const
+{
+  const QVector< int > &offsets = forward ? mUpOffsets : mDownOffsets;
+  const QVector< int > &vertices = forward ? mUpVertices : mDownVertices;
+  const QVector< double > &costs = forward ? mUpCosts : mDownCosts;
+
+  double best = std::numeric_limits<double>::infinity();
+  result.cost.insert( vertexIdx, 0.0 );
+  result.previous.insert( vertexIdx, -1 );
+  result.edge.insert( vertexIdx, -1 );
+  QgsChQueue queue;
+  queue.push( QgsChQueueEntry( 0.0, vertexIdx ) );
+
+  while ( !queue.empty() )
+  {
+    const QgsChQueueEntry entry = queue.top();
+    queue.pop();
+    if ( entry.cost > result.cost.value( entry.vertex ) )
+      continue;
+
+    if ( opposite )
+    {
+      // the remaining vertices can only lead to more expensive paths
+      if ( entry.cost >= best )
+        break;
+
+      QHash< int, double >::const_iterator oppositeIt = opposite->cost.constFind( entry.vertex );
+      if ( oppositeIt != opposite->cost.constEnd() && entry.cost + oppositeIt.value() < best )
+      {
+        best = entry.cost + oppositeIt.value();
+        *meeting = entry.vertex;
+      }
+    }
+
+    for ( int e = offsets.at( entry.vertex ); e < offsets.at( entry.vertex + 1 ); ++e )
+    {
+      const int vertex = vertices.at( e );
+      const double cost = entry.cost + costs.at( e );
+      QHash< int, double >::iterator it = result.cost.find( vertex );
+      if ( it == result.cost.end() || cost < it.value() )
+      {
+        result.cost.insert( vertex, cost );
+        result.previous.insert( vertex, entry.vertex );
+        result.edge.insert( vertex, e );
+        queue.push( QgsChQueueEntry( cost, vertex ) );
+      }
+    }
+  }
+  return best;
+}
+
+int QgsContractionHierarchy::findEdge( bool up, int vertexIdx, int otherVertexIdx ) const
+{
+  const QVector< int > &offsets = up ? mUpOffsets : mDownOffsets;
+  const QVector< int > &vertices = up ? mUpVertices : mDownVertices;
+  for ( int e = offsets.at( vertexIdx ); e < offsets.at( vertexIdx + 1 ); ++e )
+  {
+    if ( vertices.at( e ) == otherVertexIdx )
+      return e;
+  }
+  return -1;
+}
+
+void QgsContractionHierarchy::unpackEdge( bool up, int edge, int vertexIdx, QVector<int> &path ) const
+{
+  if ( edge < 0 )
+    return;
+
+  const int middle = up ? mUpMiddle.at( edge ) : mDownMiddle.at( edge );
+  if ( middle < 0 )
+  {
+    path << ( up ? mUpEdgeIds.at( edge ) : mDownEdgeIds.at( edge ) );
+    return;
+  }
+
+  // a shortcut from -> to replaces from -> middle -> to, the middle vertex was contracted
+  // before both others so these edges are stored with it
+  const int from = up ? vertexIdx : mDownVertices.at( edge );
+  const int to = up ? mUpVertices.at( edge ) : vertexIdx;
+  unpackEdge( false, findEdge( false, middle, from ), middle, path );
+  unpackEdge( true, findEdge( true, middle, to ), middle, path );
+}
+
+double QgsContractionHierarchy::shortestPath( int startVertexIdx, int endVertexIdx, QVector<int> *resultPath ) const
+{
+  if ( resultPath )
+    resultPath->clear();
+
+  if ( !mValid || startVertexIdx < 0 || startVertexIdx >= vertexCount() || endVertexIdx < 0 || endVertexIdx >= vertexCount() )
+    return std::numeric_limits<double>::infinity();
+  if ( startVertexIdx == endVertexIdx )
+    return 0.0;
+
+  SearchResult forward;
+  SearchResult backward;
+  upwardSearch( startVertexIdx, true, forward );
+  int meeting = -1;
+  const double cost = upwardSearch( endVertexIdx, false, backward, &forward, &meeting );
+  if ( meeting < 0 || !resultPath )
+    return cost;
+
+  QVector< int > edges;
+  QVector< int > owners;
+  for ( int vertex = meeting; vertex != startVertexIdx; vertex = forward.previous.value( vertex ) )
+  {
+    edges << forward.edge.value( vertex );
+    owners << forward.previous.value( vertex );
+  }
+  for ( int i = edges.count() - 1; i >= 0; --i )
+  {
+    unpackEdge( true, edges.at( i ), owners.at( i ), *resultPath );
+  }
+
+  for ( int vertex = meeting; vertex != endVertexIdx; vertex = backward.previous.value( vertex ) )
+  {
+    unpackEdge( false, backward.edge.value( vertex ), backward.previous.value( vertex ), *resultPath );
+  }
+  return cost;
+}
+
+QVector<double> QgsContractionHierarchy::distanceMatrix( const QVector<int> &sources, const QVector<int> &targets ) const
+{
+  const int targetCount = targets.count();
+  QVector< double > result( sources.count() * targetCount, std::numeric_limits<double>::infinity() );
+  if ( !mValid )
+    return result;
+
+  // costs from the vertices of the upward search spaces of the targets, grouped by vertex
+  QHash< int, QVector< QPair< int, double > > > buckets;
+  for ( int j = 0; j < targetCount; ++j )
+  {
+    if ( targets.at( j ) < 0 || targets.at( j ) >= vertexCount() )
+      continue;
+
+    SearchResult backward;
+    upwardSearch( targets.at( j ), false, backward );
+    for ( QHash< int, double >::const_iterator it = backward.cost.constBegin(); it != backward.cost.constEnd(); ++it )
+    {
+      buckets[ it.key()] << qMakePair( j, it.value() );
+    }
+  }
+
+  for ( int i = 0; i < sources.count(); ++i )
+  {
+    if ( sources.at( i ) < 0 || sources.at( i ) >= vertexCount() )
+      continue;
+
+    SearchResult forward;
+    upwardSearch( sources.at( i ), true, forward );
+    double *row = result.data() + i * targetCount;
+    for ( QHash< int, double >::const_iterator it = forward.cost.constBegin(); it != forward.cost.constEnd(); ++it )
+    {
+      QHash< int, QVector< QPair< int, double > > >::const_iterator bucket = buckets.constFind( it.key() );
+      if ( bucket == buckets.constEnd() )
+        continue;
+
+      Q_FOREACH ( const auto &entry, bucket.value() )
+      {
+        row[ entry.first ] = std::min( row[ entry.first ], it.value() + entry.second );
+      }
+    }
+  }
+  return result;
+}
+
+bool QgsContractionHierarchy::writeToFile( const QString &fileName ) const
+{
+  if ( !mValid )
+    return false;
+
+  QFile file( fileName );
+  if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    return false;
+
+  QDataStream stream( &file );
+  stream.setVersion( QDataStream::Qt_5_0 );
+  stream << FILE_MAGIC << FILE_VERSION << static_cast< qint32 >( mStrategyIndex ) << mRank
+         << mUpOffsets << mUpVertices << mUpCosts << mUpEdgeIds << mUpMiddle
+         << mDownOffsets << mDownVertices << mDownCosts << mDownEdgeIds << mDownMiddle;
+  return stream.status() == QDataStream::Ok;
+}
+
+bool QgsContractionHierarchy::readFromFile( const QString &fileName )
+{
+  *this = QgsContractionHierarchy();
+
+  QFile file( fileName );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return false;
+
+  QDataStream stream( &file );
+  stream.setVersion( QDataStream::Qt_5_0 );
+  quint32 magic;
+  qint32 version;
+  stream >> magic >> version;
+  if ( stream.status() != QDataStream::Ok || magic != FILE_MAGIC || version != FILE_VERSION )
+    return false;
+
+  qint32 strategyIndex;
+  stream >> strategyIndex >> mRank
+         >> mUpOffsets >> mUpVertices >> mUpCosts >> mUpEdgeIds >> mUpMiddle
+         >> mDownOffsets >> mDownVertices >> mDownCosts >> mDownEdgeIds >> mDownMiddle;
+  mStrategyIndex = strategyIndex;
+
+  const int upCount = mUpVertices.count();
+  const int downCount = mDownVertices.count();
+  const bool consistent = mUpOffsets.count() == mRank.count() + 1 && mDownOffsets.count() == mRank.count() + 1
+                          && mUpOffsets.last() == upCount && mDownOffsets.last() == downCount
+                          && mUpCosts.count() == upCount && mUpEdgeIds.count() == upCount && mUpMiddle.count() == upCount
+                          && mDownCosts.count() == downCount && mDownEdgeIds.count() == downCount && mDownMiddle.count() == downCount;
+  if ( stream.status() != QDataStream::Ok || !consistent )
+  {
+    *this = QgsContractionHierarchy();
+    return false;
+  }
+
+  mValid = true;
+  return true;
+}
@@ -0,0 +1,160 @@
+/***************************************************************************
+  qgscontractionhierarchy.h
+  --------------------------------------
+  Date                 : February 2017
+  Copyright            : (C) 2017 by the QGIS project
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#ifndef QGSCONTRACTIONHIERARCHY_H
+#define QGSCONTRACTIONHIERARCHY_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include "qgis_analysis.h"
+
+class QgsGraph;
+class QgsFeedback;
+
+/**
+ * \ingroup analysis
+ * \class QgsContractionHierarchy
+ * \brief Contraction hierarchy of a QgsGraph, for fast shortest path queries.
+ *
+ * The hierarchy is built once for a graph and one of its strategies: vertices are
+ * contracted one after the other, from the least to the most important, and shortcut
+ * edges are added wherever a contraction removes a shortest path. A query then only
+ * has to search upwards in the hierarchy from both ends, which visits a few hundred
+ * vertices even on graphs with millions of edges.
+ *
+ * Building the hierarchy is expensive, it can be saved to a file with writeToFile()
+ * and loaded again with readFromFile(). Vertex and edge indices are the same as in the
+ * source graph, the hierarchy does not reference the graph afterwards.
+ *
+ * \note added in QGIS 3.0
+ */
+class ANALYSIS_EXPORT QgsContractionHierarchy
+{
+  public:
+
+    /**
+     * Creates an empty, invalid hierarchy. Use readFromFile() to load a saved hierarchy.
+     */
+    QgsContractionHierarchy() = default;
+
+    /**
+     * Builds the contraction hierarchy of \a graph, using the edge costs calculated by the
+     * strategy at \a strategyIndex. Edge costs must not be negative.
+     *
+     * An optional \a feedback object can be used to report progress and to cancel the
+     * preprocessing, in which case the hierarchy is left invalid.
+     */
+    QgsContractionHierarchy( const QgsGraph &graph, int strategyIndex, QgsFeedback *feedback = nullptr );
+
+    /**
+     * Returns true if the hierarchy has been successfully built or loaded.
+     */
+    bool isValid() const { return mValid; }
+
+    /**
+     * Returns the index of the strategy the edge costs were taken from.
+     */
+    int strategyIndex() const { return mStrategyIndex; }
+
+    /**
+     * Returns number of graph vertices
+     */
+    int vertexCount() const { return mRank.count(); }
+
+    /**
+     * Returns the number of shortcut edges added by the contraction.
+     */
+    int shortcutCount() const;
+
+    /**
+     * Finds the shortest path between two vertices.
+     * @param startVertexIdx index of the start vertex
+     * @param endVertexIdx index of the end vertex
+     * @param resultPath indices of the edges of the source graph along the path, from the
+     * start to the end vertex
+     * @returns cost of the path, or infinity if the end vertex can not be reached
+     */
+    double shortestPath( int startVertexIdx, int endVertexIdx, QVector<int> *resultPath = nullptr ) const;
+
+    /**
+     * Calculates the cost of the shortest paths from each of the \a sources to each of the
+     * \a targets. The result is stored row by row: the cost from sources[i] to targets[j]
+     * is at index i * targets.count() + j, it is infinity if targets[j] can not be reached.
+     *
+     * Each source and target is only searched once, so the whole matrix costs about as
+     * much as sources.count() + targets.count() point to point queries.
+     */
+    QVector<double> distanceMatrix( const QVector<int> &sources, const QVector<int> &targets ) const;
+
+    /**
+     * Saves the hierarchy to a file.
+     * @returns true if the file was successfully written
+     * @see readFromFile()
+     */
+    bool writeToFile( const QString &fileName ) const;
+
+    /**
+     * Loads a hierarchy previously saved with writeToFile(), replacing the current content.
+     * @returns true if the file was successfully read, the hierarchy is invalid otherwise
+     */
+    bool readFromFile( const QString &fileName );
+
+  private:
+
+    //! Vertices reached by an upward search, with their cost and the edge and vertex they were reached from
+    struct SearchResult
+    {
+      QHash< int, double > cost;
+      QHash< int, int > edge;
+      QHash< int, int > previous;
+    };
+
+    /**
+     * Searches the vertices of higher rank reachable from (or leading to, if \a forward is false) a vertex.
+     * If the result of the \a opposite search is set, the search stops as soon as no better path can be
+     * found and returns the cost of the shortest path through the \a meeting vertex.
+     */
+    double upwardSearch( int vertexIdx, bool forward, SearchResult &result, const SearchResult *opposite = nullptr, int *meeting = nullptr ) const;
+    int findEdge( bool up, int vertexIdx, int otherVertexIdx ) const;
+    void unpackEdge( bool up, int edge, int vertexIdx, QVector<int> &path ) const;
+
+    bool mValid = false;
+    int mStrategyIndex = -1;
+
+    //! Contraction order of each vertex
+    QVector< int > mRank;
+
+    /**
+     * Edges from each vertex to vertices of higher rank, those of vertex i are at
+     * [mUpOffsets[i], mUpOffsets[i+1]).
+     */
+    QVector< int > mUpOffsets;
+    QVector< int > mUpVertices;
+    QVector< double > mUpCosts;
+    //! Index of the source graph edge, or -1 for a shortcut
+    QVector< int > mUpEdgeIds;
+    //! Contracted vertex a shortcut goes through, or -1 for an edge of the source graph
+    QVector< int > mUpMiddle;
+
+    //! Edges to each vertex from vertices of higher rank, same layout as the upward edges
+    QVector< int > mDownOffsets;
+    QVector< int > mDownVertices;
+    QVector< double > mDownCosts;
+    QVector< int > mDownEdgeIds;
+    QVector< int > mDownMiddle;
+};
+
+#endif // QGSCONTRACTIONHIERARCHY_H
@@ -13,15 +13,39 @@
 *                                                                          *
 ***************************************************************************/
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <limits>
+#include <queue>
+#include <vector>
 
-#include <QMap>
 #include <QVector>
-#include <QPair>
 
 #include "qgsgraph.h"
+#include "qgscompactgraph.h"
 #include "qgsgraphanalyzer.h"
 
+///@cond PRIVATE
+
+//! Vertex waiting in the frontier, entries are not removed when a shorter cost is found
+struct QgsGraphQueueEntry
+{
+  QgsGraphQueueEntry( double cost, int vertex )
+    : cost( cost )
+    , vertex( vertex )
+  {}
+
+  double cost;
+  int vertex;
+
+  bool operator>( const QgsGraphQueueEntry &other ) const { return cost > other.cost; }
+};
+
+typedef std::priority_queue< QgsGraphQueueEntry, std::vector< QgsGraphQueueEntry >, std::greater< QgsGraphQueueEntry > > QgsGraphQueue;
+
+///@endcond
+
 void QgsGraphAnalyzer::dijkstra( const QgsGraph *source, int startPointIdx, int criterionNum, QVector<int> *resultTree, QVector<double> *resultCost )
 {
   QVector< double > *result = nullptr;
@@ -44,26 +68,26 @@ void QgsGraphAnalyzer::dijkstra( const QgsGraph *source, int startPointIdx, int
     resultTree->insert( resultTree->begin(), source->vertexCount(), -1 );
   }
 
-  // QMultiMap< cost, vertexIdx > not_begin
-  // I use it and don't create any struct or class
-  QMultiMap< double, int > not_begin;
-  QMultiMap< double, int >::iterator it;
-
-  not_begin.insert( 0.0, startPointIdx );
+  QgsGraphQueue not_begin;
+  not_begin.push( QgsGraphQueueEntry( 0.0, startPointIdx ) );
 
   while ( !not_begin.empty() )
   {
-    it = not_begin.begin();
-    double curCost = it.key();
-    int curVertex = it.value();
-    not_begin.erase( it );
+    const QgsGraphQueueEntry entry = not_begin.top();
+    not_begin.pop();
+    double curCost = entry.cost;
+    int curVertex = entry.vertex;
+
+    // a shorter path to this vertex has been handled already
+    if ( curCost > ( *result )[ curVertex ] )
+      continue;
 
     // edge index list
-    QgsGraphEdgeIds l = source->vertex( curVertex ).outEdges();
-    QgsGraphEdgeIds::iterator arcIt;
-    for ( arcIt = l.begin(); arcIt != l.end(); ++arcIt )
+    const QgsGraphEdgeIds l = source->vertex( curVertex ).outEdges();
+    QgsGraphEdgeIds::const_iterator arcIt;
+    for ( arcIt = l.constBegin(); arcIt != l.constEnd(); ++arcIt )
     {
-      const QgsGraphEdge arc = source->edge( *arcIt );
+      const QgsGraphEdge &arc = source->edge( *arcIt );
       double cost = arc.cost( criterionNum ).toDouble() + curCost;
 
       if ( cost < ( *result )[ arc.inVertex()] )
@@ -73,7 +97,7 @@ void QgsGraphAnalyzer::dijkstra( const QgsGraph *source, int startPointIdx, int
         {
           ( *resultTree )[ arc.inVertex()] = *arcIt;
         }
-        not_begin.insert( cost, arc.inVertex() );
+        not_begin.push( QgsGraphQueueEntry( cost, arc.inVertex() ) );
       }
     }
   }
@@ -83,6 +107,161 @@ void QgsGraphAnalyzer::dijkstra( const QgsGraph *source, int startPointIdx, int
   }
 }
 
+void QgsGraphAnalyzer::dijkstra( const QgsCompactGraph &source, int startVertexIdx, QVector<int> *resultTree, QVector<double> *resultCost )
+{
+  QVector< double > cost( source.vertexCount(), std::numeric_limits<double>::infinity() );
+  QVector< int > tree;
+  if ( resultTree )
+    tree.fill( -1, source.vertexCount() );
+
+  // raw pointers, the vectors are not shared and this avoids detach checks in the loop
+  double *costs = cost.data();
+  int *treeEdges = resultTree ? tree.data() : nullptr;
+  const int *offsets = source.mOutOffsets.constData();
+  const int *targets = source.mOutTargets.constData();
+  const double *edgeCosts = source.mOutCosts.constData();
+  const int *edgeIds = source.mOutEdgeIds.constData();
+
+  costs[ startVertexIdx ] = 0.0;
+  QgsGraphQueue queue;
+  queue.push( QgsGraphQueueEntry( 0.0, startVertexIdx ) );
+
+  while ( !queue.empty() )
+  {
+    const QgsGraphQueueEntry entry = queue.top();
+    queue.pop();
+    if ( entry.cost > costs[ entry.vertex ] )
+      continue;
+
+    for ( int e = offsets[ entry.vertex ]; e < offsets[ entry.vertex + 1 ]; ++e )
+    {
+      const double newCost = entry.cost + edgeCosts[e];
+      const int target = targets[e];
+      if ( newCost < costs[ target ] )
+      {
+        costs[ target ] = newCost;
+        if ( treeEdges )
+          treeEdges[ target ] = edgeIds[e];
+        queue.push( QgsGraphQueueEntry( newCost, target ) );
+      }
+    }
+  }
+
+  if ( resultTree )
+    *resultTree = tree;
+  if ( resultCost )
+    *resultCost = cost;
+}
+
+double QgsGraphAnalyzer::shortestPath( const QgsCompactGraph &source, int startVertexIdx, int endVertexIdx, QVector<int> *resultPath )
+{
+  const double infinity = std::numeric_limits<double>::infinity();
+  if ( resultPath )
+    resultPath->clear();
+  if ( startVertexIdx == endVertexIdx )
+    return 0.0;
+
+  // Both searches use the same potential: half the difference between the lower bounds
+  // of the distance to the end vertex and from the start vertex. It keeps all reduced
+  // edge costs non negative in both directions, so the usual stopping rule of the
+  // bidirectional Dijkstra algorithm still gives an exact result.
+  const double halfRatio = 0.5 * source.costPerUnitDistance();
+  const double startX = source.mX.at( startVertexIdx );
+  const double startY = source.mY.at( startVertexIdx );
+  const double endX = source.mX.at( endVertexIdx );
+  const double endY = source.mY.at( endVertexIdx );
+  auto potential = [&]( int vertex ) -> double
+  {
+    if ( halfRatio == 0.0 )
+      return 0.0;
+    const double x = source.mX.at( vertex );
+    const double y = source.mY.at( vertex );
+    return halfRatio * ( std::hypot( endX - x, endY - y ) - std::hypot( x - startX, y - startY ) );
+  };
+
+  const int vertexCount = source.vertexCount();
+  QVector< double > forwardCost( vertexCount, infinity );
+  QVector< double > backwardCost( vertexCount, infinity );
+  // edge and vertex each vertex has been reached from, in the direction of the search
+  QVector< int > forwardEdge( vertexCount, -1 );
+  QVector< int > backwardEdge( vertexCount, -1 );
+  QVector< int > forwardPrevious( vertexCount, -1 );
+  QVector< int > backwardPrevious( vertexCount, -1 );
+  QVector< char > forwardSettled( vertexCount, 0 );
+  QVector< char > backwardSettled( vertexCount, 0 );
+
+  QgsGraphQueue forwardQueue;
+  QgsGraphQueue backwardQueue;
+  forwardCost[ startVertexIdx ] = 0.0;
+  backwardCost[ endVertexIdx ] = 0.0;
+  forwardQueue.push( QgsGraphQueueEntry( potential( startVertexIdx ), startVertexIdx ) );
+  backwardQueue.push( QgsGraphQueueEntry( -potential( endVertexIdx ), endVertexIdx ) );
+
+  double best = infinity;
+  int meeting = -1;
+
+  while ( !forwardQueue.empty() && !backwardQueue.empty() )
+  {
+    if ( forwardQueue.top().cost + backwardQueue.top().cost >= best )
+      break;
+
+    const bool forward = forwardQueue.size() <= backwardQueue.size();
+    QgsGraphQueue &queue = forward ? forwardQueue : backwardQueue;
+    const int vertex = queue.top().vertex;
+    queue.pop();
+
+    QVector< char > &settled = forward ? forwardSettled : backwardSettled;
+    if ( settled.at( vertex ) )
+      continue;
+    settled[ vertex ] = 1;
+
+    QVector< double > &cost = forward ? forwardCost : backwardCost;
+    const QVector< double > &otherCost = forward ? backwardCost : forwardCost;
+    QVector< int > &edge = forward ? forwardEdge : backwardEdge;
+    QVector< int > &previous = forward ? forwardPrevious : backwardPrevious;
+    const QVector< int > &offsets = forward ? source.mOutOffsets : source.mInOffsets;
+    const QVector< int > &neighbors = forward ? source.mOutTargets : source.mInSources;
+    const QVector< double > &edgeCosts = forward ? source.mOutCosts : source.mInCosts;
+    const QVector< int > &edgeIds = forward ? source.mOutEdgeIds : source.mInEdgeIds;
+    const double sign = forward ? 1.0 : -1.0;
+
+    const double vertexCost = cost.at( vertex );
+    for ( int e = offsets.at( vertex ); e < offsets.at( vertex + 1 ); ++e )
+    {
+      const int neighbor = neighbors.at( e );
+      const double newCost = vertexCost + edgeCosts.at( e );
+      if ( newCost < cost.at( neighbor ) )
+      {
+        cost[ neighbor ] = newCost;
+        edge[ neighbor ] = edgeIds.at( e );
+        previous[ neighbor ] = vertex;
+        queue.push( QgsGraphQueueEntry( newCost + sign * potential( neighbor ), neighbor ) );
+
+        if ( newCost + otherCost.at( neighbor ) < best )
+        {
+          best = newCost + otherCost.at( neighbor );
+          meeting = neighbor;
+        }
+      }
+    }
+  }
+
+  if ( meeting < 0 )
+    return infinity;
+
+  if ( resultPath )
+  {
+    // from the meeting vertex back to the start, then on to the end
+    for ( int vertex = meeting; vertex != startVertexIdx; vertex = forwardPrevious.at( vertex ) )
+      resultPath->append( forwardEdge.at( vertex ) );
+    std::reverse( resultPath->begin(), resultPath->end() );
+    for ( int vertex = meeting; vertex != endVertexIdx; vertex = backwardPrevious.at( vertex ) )
+      resultPath->append( backwardEdge.at( vertex ) );
+  }
+
+  return best;
+}
+
 QgsGraph *QgsGraphAnalyzer::shortestTree( const QgsGraph *source, int startVertexIdx, int criterionNum )
 {
   QgsGraph *treeResult = new QgsGraph();
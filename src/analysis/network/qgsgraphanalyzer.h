@@ -20,6 +20,7 @@
 #include "qgis_analysis.h"
 
 class QgsGraph;
+class QgsCompactGraph;
 
 /** \ingroup analysis
  *  This class performs graph analysis, e.g. calculates shortest path between two
@@ -40,6 +41,34 @@ class ANALYSIS_EXPORT QgsGraphAnalyzer
      */
     static void dijkstra( const QgsGraph *source, int startVertexIdx, int criterionNum, QVector<int> *resultTree = nullptr, QVector<double> *resultCost = nullptr );
 
+    /**
+     * Solve shortest path problem using Dijkstra algorithm on a compact graph. The
+     * optimization strategy is the one the compact graph was built with.
+     * @param source source graph
+     * @param startVertexIdx index of the start vertex
+     * @param resultTree array that represents shortest path tree. resultTree[ vertexIndex ] == inboundingArcIndex if vertex reachable, otherwise resultTree[ vertexIndex ] == -1
+     * @param resultCost array of the paths costs
+     * @note added in QGIS 3.0
+     * @note not available in Python bindings
+     */
+    static void dijkstra( const QgsCompactGraph &source, int startVertexIdx, QVector<int> *resultTree = nullptr, QVector<double> *resultCost = nullptr );
+
+    /**
+     * Finds the shortest path between two vertices using a bidirectional A* search.
+     *
+     * Both searches are guided by the straight line distance to their target, scaled by
+     * QgsCompactGraph::costPerUnitDistance(), so only the vertices in the neighborhood
+     * of the path are visited. The result is exact, it has the same cost as the path
+     * found by dijkstra().
+     * @param source source graph
+     * @param startVertexIdx index of the start vertex
+     * @param endVertexIdx index of the end vertex
+     * @param resultPath indices of the edges of the path, from the start to the end vertex
+     * @returns cost of the path, or infinity if the end vertex can not be reached
+     * @note added in QGIS 3.0
+     */
+    static double shortestPath( const QgsCompactGraph &source, int startVertexIdx, int endVertexIdx, QVector<int> *resultPath = nullptr );
+
     /**
      * Returns shortest path tree with root-node in startVertexIdx
      * @param source source graph
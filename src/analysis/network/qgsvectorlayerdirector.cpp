@@ -22,15 +22,27 @@
 #include "qgsgraphbuilderinterface.h"
 
 #include "qgsfeatureiterator.h"
+#include "qgsvectorlayerfeatureiterator.h"
 #include <qgsvectorlayer.h>
 #include <qgsvectordataprovider.h>
 #include <qgspoint.h>
 #include <qgsgeometry.h>
 #include <qgsdistancearea.h>
+#include <qgscoordinatetransform.h>
 #include <qgswkbtypes.h>
 
 #include <QString>
+#include <QThread>
 #include <QtAlgorithms>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <vector>
 
 /** \ingroup analysis
  * \class QgsPointCompare
@@ -102,6 +114,224 @@ bool TiePointInfoCompare( const TiePointInfo &a, const TiePointInfo &b )
   return a.mFirstPoint.x() == b.mFirstPoint.x() ? a.mFirstPoint.y() < b.mFirstPoint.y() : a.mFirstPoint.x() < b.mFirstPoint.x();
 }
 
+///@cond PRIVATE
+
+//! Minimum number of features handled by each thread when building the graph
+static const int PARALLEL_MINIMUM_FEATURES = 1000;
+
+//! Segment of a line feature, in destination coordinates
+struct QgsNetworkSegment
+{
+  QgsPoint first;
+  QgsPoint last;
+};
+
+//! Subset of the line features, extracted by one thread
+struct QgsNetworkPartition
+{
+  std::shared_ptr< QgsVectorLayerFeatureSource > source;
+  QgsFeatureIds fids;
+  bool allFeatures = false;
+
+  //! Features without their geometry, as needed by the strategies
+  QgsFeatureList features;
+  QVector< QgsVectorLayerDirector::Direction > directions;
+
+  //! Segments of feature i are at [firstSegment[i], firstSegment[i+1])
+  QVector< int > firstSegment;
+  QVector< QgsNetworkSegment > segments;
+
+  //! Sorted vertices of the segments
+  QVector< QgsPoint > points;
+};
+
+//! Additional point and the nearest segment it is tied to
+struct QgsNetworkTiePoint
+{
+  QgsPoint point;
+  int segment = -1;
+  TiePointInfo info;
+};
+
+/**
+ * Static R-tree of segments, packed with the sort-tile-recursive algorithm, which finds
+ * the segment nearest to a point. It can be queried from several threads at once.
+ */
+class QgsNetworkSegmentIndex
+{
+  public:
+
+    explicit QgsNetworkSegmentIndex( const QVector< QgsNetworkSegment > &segments )
+      : mSegments( segments )
+    {
+      QVector< Node > entries;
+      entries.reserve( segments.count() );
+      for ( int i = 0; i < segments.count(); ++i )
+      {
+        const QgsNetworkSegment &segment = segments.at( i );
+        Node entry;
+        entry.xMin = std::min( segment.first.x(), segment.last.x() );
+        entry.xMax = std::max( segment.first.x(), segment.last.x() );
+        entry.yMin = std::min( segment.first.y(), segment.last.y() );
+        entry.yMax = std::max( segment.first.y(), segment.last.y() );
+        entry.first = i;
+        entry.count = 0;
+        entries << entry;
+      }
+      if ( entries.isEmpty() )
+        return;
+
+      // the leaves reference the segments, upper levels reference the level below
+      sortTileRecursive( entries );
+      mItems.reserve( entries.count() );
+      Q_FOREACH ( const Node &entry, entries )
+        mItems << entry.first;
+
+      QVector< Node > level = group( entries );
+      while ( level.count() > 1 )
+      {
+        sortTileRecursive( level );
+        mLevels.prepend( level );
+        level = group( level );
+      }
+      mLevels.prepend( level );
+    }
+
+    /**
+     * Returns the index of the segment nearest to \a point, or -1 if there are no segments. The
+     * squared distance and the nearest point of the segment are stored in \a info. If several
+     * segments are at the same distance, the one with the lowest index is returned.
+     */
+    int nearest( const QgsPoint &point, TiePointInfo &info ) const
+    {
+      if ( mLevels.isEmpty() )
+        return -1;
+
+      typedef QPair< double, QPair< int, int > > Candidate; // distance, level, node
+      std::priority_queue< Candidate, std::vector< Candidate >, std::greater< Candidate > > queue;
+      queue.push( qMakePair( 0.0, qMakePair( 0, 0 ) ) );
+
+      int best = -1;
+      info.mLength = std::numeric_limits<double>::infinity();
+      while ( !queue.empty() )
+      {
+        const Candidate candidate = queue.top();
+        queue.pop();
+        if ( candidate.first > info.mLength )
+          break;
+
+        const int levelIdx = candidate.second.first;
+        const Node &node = mLevels.at( levelIdx ).at( candidate.second.second );
+        if ( levelIdx + 1 < mLevels.count() )
+        {
+          const QVector< Node > &children = mLevels.at( levelIdx + 1 );
+          for ( int i = node.first; i < node.first + node.count; ++i )
+          {
+            queue.push( qMakePair( sqrDistToBox( point, children.at( i ) ), qMakePair( levelIdx + 1, i ) ) );
+          }
+          continue;
+        }
+
+        for ( int i = node.first; i < node.first + node.count; ++i )
+        {
+          const int segmentIdx = mItems.at( i );
+          const QgsNetworkSegment &segment = mSegments.at( segmentIdx );
+          QgsPoint tiedPoint;
+          double length;
+          if ( segment.first == segment.last )
+          {
+            length = point.sqrDist( segment.first );
+            tiedPoint = segment.first;
+          }
+          else
+          {
+            length = point.sqrDistToSegment( segment.first.x(), segment.first.y(),
+                                             segment.last.x(), segment.last.y(), tiedPoint );
+          }
+
+          if ( length < info.mLength || ( length == info.mLength && segmentIdx < best ) )
+          {
+            best = segmentIdx;
+            info.mLength = length;
+            info.mTiedPoint = tiedPoint;
+            info.mFirstPoint = segment.first;
+            info.mLastPoint = segment.last;
+          }
+        }
+      }
+      return best;
+    }
+
+  private:
+
+    static const int NODE_CAPACITY = 16;
+
+    //! Bounding box of a segment or node, with the range of its children
+    struct Node
+    {
+      double xMin;
+      double yMin;
+      double xMax;
+      double yMax;
+      int first;
+      int count;
+    };
+
+    static double sqrDistToBox( const QgsPoint &point, const Node &node )
+    {
+      const double dx = std::max( std::max( node.xMin - point.x(), point.x() - node.xMax ), 0.0 );
+      const double dy = std::max( std::max( node.yMin - point.y(), point.y() - node.yMax ), 0.0 );
+      return dx * dx + dy * dy;
+    }
+
+    //! Orders nodes in vertical slices by x, then by y within each slice
+    static void sortTileRecursive( QVector< Node > &nodes )
+    {
+      auto centerX = []( const Node & a, const Node & b ) { return a.xMin + a.xMax < b.xMin + b.xMax; };
+      auto centerY = []( const Node & a, const Node & b ) { return a.yMin + a.yMax < b.yMin + b.yMax; };
+
+      std::stable_sort( nodes.begin(), nodes.end(), centerX );
+      const int nodeCount = ( nodes.count() + NODE_CAPACITY - 1 ) / NODE_CAPACITY;
+      const int sliceCount = std::max( 1, static_cast< int >( std::ceil( std::sqrt( static_cast< double >( nodeCount ) ) ) ) );
+      const int sliceSize = sliceCount * NODE_CAPACITY;
+      for ( int start = 0; start < nodes.count(); start += sliceSize )
+      {
+        std::stable_sort( nodes.begin() + start, nodes.begin() + std::min( start + sliceSize, nodes.count() ), centerY );
+      }
+    }
+
+    //! Groups consecutive nodes into parent nodes
+    static QVector< Node > group( const QVector< Node > &nodes )
+    {
+      QVector< Node > parents;
+      for ( int start = 0; start < nodes.count(); start += NODE_CAPACITY )
+      {
+        Node parent = nodes.at( start );
+        parent.first = start;
+        parent.count = std::min( NODE_CAPACITY, nodes.count() - start );
+        for ( int i = start + 1; i < start + parent.count; ++i )
+        {
+          parent.xMin = std::min( parent.xMin, nodes.at( i ).xMin );
+          parent.yMin = std::min( parent.yMin, nodes.at( i ).yMin );
+          parent.xMax = std::max( parent.xMax, nodes.at( i ).xMax );
+          parent.yMax = std::max( parent.yMax, nodes.at( i ).yMax );
+        }
+        parents << parent;
+      }
+      return parents;
+    }
+
+    const QVector< QgsNetworkSegment > &mSegments;
+
+    //! Levels of the tree, from the root down to the leaves
+    QVector< QVector< Node > > mLevels;
+
+    //! Segment indices, in the order of the leaves
+    QVector< int > mItems;
+};
+
+///@endcond
+
 QgsVectorLayerDirector::QgsVectorLayerDirector( QgsVectorLayer *myLayer,
     int directionFieldId,
     const QString &directDirectionValue,
@@ -134,114 +364,12 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
   int featureCount = ( int ) vl->featureCount() * 2;
   int step = 0;
 
-  QgsCoordinateTransform ct;
-  ct.setSourceCrs( vl->crs() );
-  if ( builder->coordinateTransformationEnabled() )
-  {
-    ct.setDestinationCrs( builder->destinationCrs() );
-  }
-  else
-  {
-    ct.setDestinationCrs( vl->crs() );
-  }
-
-  snappedPoints = QVector< QgsPoint >( additionalPoints.size(), QgsPoint( 0.0, 0.0 ) );
-
-  TiePointInfo tmpInfo;
-  tmpInfo.mLength = std::numeric_limits<double>::infinity();
+  const QgsCoordinateReferenceSystem sourceCrs = vl->crs();
+  const QgsCoordinateReferenceSystem destinationCrs = builder->coordinateTransformationEnabled() ? builder->destinationCrs() : vl->crs();
 
-  QVector< TiePointInfo > pointLengthMap( additionalPoints.size(), tmpInfo );
-  QVector< TiePointInfo >::iterator pointLengthIt;
-
-  //Graph's points;
-  QVector< QgsPoint > points;
-
-  QgsFeatureIterator fit = vl->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() ) );
-
-  // begin: tie points to the graph
+  // fill attribute list 'la'
   QgsAttributeList la;
-  QgsFeature feature;
-  while ( fit.nextFeature( feature ) )
   {
-    QgsMultiPolyline mpl;
-    if ( QgsWkbTypes::flatType( feature.geometry().geometry()->wkbType() ) == QgsWkbTypes::MultiLineString )
-      mpl = feature.geometry().asMultiPolyline();
-    else if ( QgsWkbTypes::flatType( feature.geometry().geometry()->wkbType() ) == QgsWkbTypes::LineString )
-      mpl.push_back( feature.geometry().asPolyline() );
-
-    QgsMultiPolyline::iterator mplIt;
-    for ( mplIt = mpl.begin(); mplIt != mpl.end(); ++mplIt )
-    {
-      QgsPoint pt1, pt2;
-      bool isFirstPoint = true;
-      QgsPolyline::iterator pointIt;
-      for ( pointIt = mplIt->begin(); pointIt != mplIt->end(); ++pointIt )
-      {
-        pt2 = ct.transform( *pointIt );
-        points.push_back( pt2 );
-
-        if ( !isFirstPoint )
-        {
-          int i = 0;
-          for ( i = 0; i != additionalPoints.size(); ++i )
-          {
-            TiePointInfo info;
-            if ( pt1 == pt2 )
-            {
-              info.mLength = additionalPoints[ i ].sqrDist( pt1 );
-              info.mTiedPoint = pt1;
-            }
-            else
-            {
-              info.mLength = additionalPoints[ i ].sqrDistToSegment( pt1.x(), pt1.y(),
-                             pt2.x(), pt2.y(), info.mTiedPoint );
-            }
-
-            if ( pointLengthMap[ i ].mLength > info.mLength )
-            {
-              Q_UNUSED( info.mTiedPoint );
-              info.mFirstPoint = pt1;
-              info.mLastPoint = pt2;
-
-              pointLengthMap[ i ] = info;
-              snappedPoints[ i ] = info.mTiedPoint;
-            }
-          }
-        }
-        pt1 = pt2;
-        isFirstPoint = false;
-      }
-    }
-    emit buildProgress( ++step, featureCount );
-  }
-  // end: tie points to graph
-
-  // add tied point to graph
-  int i = 0;
-  for ( i = 0; i < snappedPoints.size(); ++i )
-  {
-    if ( snappedPoints[ i ] != QgsPoint( 0.0, 0.0 ) )
-    {
-      points.push_back( snappedPoints [ i ] );
-    }
-  }
-
-  QgsPointCompare pointCompare( builder->topologyTolerance() );
-
-  std::sort( points.begin(), points.end(), pointCompare );
-  QVector< QgsPoint >::iterator tmp = std::unique( points.begin(), points.end() );
-  points.resize( tmp - points.begin() );
-
-  for ( i = 0; i < points.size(); ++i )
-    builder->addVertex( i, points[ i ] );
-
-  for ( i = 0; i < snappedPoints.size() ; ++i )
-    snappedPoints[ i ] = *( my_binary_search( points.begin(), points.end(), snappedPoints[ i ], pointCompare ) );
-
-  std::sort( pointLengthMap.begin(), pointLengthMap.end(), TiePointInfoCompare );
-
-  {
-    // fill attribute list 'la'
     QgsAttributeList tmpAttr;
     if ( mDirectionFieldId != -1 )
     {
@@ -275,118 +403,237 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
     }
   } // end fill attribute list 'la'
 
-  // begin graph construction
-  fit = vl->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( la ) );
-  while ( fit.nextFeature( feature ) )
+  QgsPointCompare pointCompare( builder->topologyTolerance() );
+
+  // begin: extract the segments of the features, in parallel for large layers. Feature sources
+  // are created here since they must be created from the thread the layer lives in
+  QList< QgsNetworkPartition > partitions;
+  int partitionCount = 1;
+  QList< QgsFeatureId > ids;
+  if ( QThread::idealThreadCount() > 1 && featureCount >= 4 * PARALLEL_MINIMUM_FEATURES )
+  {
+    QgsFeature f;
+    QgsFeatureIterator idIt = vl->getFeatures( QgsFeatureRequest().setFlags( QgsFeatureRequest::NoGeometry ).setSubsetOfAttributes( QgsAttributeList() ) );
+    while ( idIt.nextFeature( f ) )
+      ids << f.id();
+    partitionCount = qBound( 1, ids.count() / PARALLEL_MINIMUM_FEATURES, QThread::idealThreadCount() );
+  }
+  for ( int i = 0; i < partitionCount; ++i )
   {
-    Direction directionType = mDefaultDirection;
+    QgsNetworkPartition partition;
+    partition.source = std::make_shared< QgsVectorLayerFeatureSource >( vl );
+    partition.allFeatures = partitionCount == 1;
+    int start = ids.count() * i / partitionCount;
+    int end = ids.count() * ( i + 1 ) / partitionCount;
+    for ( int j = start; j < end; ++j )
+      partition.fids << ids.at( j );
+    partitions << partition;
+  }
 
-    // What direction have feature?
-    QString str = feature.attribute( mDirectionFieldId ).toString();
-    if ( str == mBothDirectionValue )
-    {
-      directionType = Direction::DirectionBoth;
-    }
-    else if ( str == mDirectDirectionValue )
+  auto extractPartition = [&]( QgsNetworkPartition & partition )
+  {
+    // each thread uses its own transform
+    QgsCoordinateTransform ct( sourceCrs, destinationCrs );
+
+    QgsFeatureRequest request = partition.allFeatures ? QgsFeatureRequest() : QgsFeatureRequest( partition.fids );
+    request.setSubsetOfAttributes( la );
+    QgsFeatureIterator fit = partition.source->getFeatures( request );
+    QgsFeature feature;
+    while ( fit.nextFeature( feature ) )
     {
-      directionType = Direction::DirectionForward;
+      Direction directionType = mDefaultDirection;
+
+      // What direction have feature?
+      QString str = feature.attribute( mDirectionFieldId ).toString();
+      if ( str == mBothDirectionValue )
+      {
+        directionType = Direction::DirectionBoth;
+      }
+      else if ( str == mDirectDirectionValue )
+      {
+        directionType = Direction::DirectionForward;
+      }
+      else if ( str == mReverseDirectionValue )
+      {
+        directionType = Direction::DirectionBackward;
+      }
+
+      QgsMultiPolyline mpl;
+      if ( QgsWkbTypes::flatType( feature.geometry().geometry()->wkbType() ) == QgsWkbTypes::MultiLineString )
+        mpl = feature.geometry().asMultiPolyline();
+      else if ( QgsWkbTypes::flatType( feature.geometry().geometry()->wkbType() ) == QgsWkbTypes::LineString )
+        mpl.push_back( feature.geometry().asPolyline() );
+
+      partition.firstSegment << partition.segments.count();
+      QgsMultiPolyline::iterator mplIt;
+      for ( mplIt = mpl.begin(); mplIt != mpl.end(); ++mplIt )
+      {
+        QgsPoint pt1, pt2;
+        bool isFirstPoint = true;
+        QgsPolyline::iterator pointIt;
+        for ( pointIt = mplIt->begin(); pointIt != mplIt->end(); ++pointIt )
+        {
+          pt2 = ct.transform( *pointIt );
+          partition.points.push_back( pt2 );
+
+          if ( !isFirstPoint )
+          {
+            QgsNetworkSegment segment;
+            segment.first = pt1;
+            segment.last = pt2;
+            partition.segments << segment;
+          }
+          pt1 = pt2;
+          isFirstPoint = false;
+        }
+      }
+
+      feature.clearGeometry();
+      partition.features << feature;
+      partition.directions << directionType;
     }
-    else if ( str == mReverseDirectionValue )
+    partition.firstSegment << partition.segments.count();
+
+    // per thread vertex table, merged afterwards
+    std::sort( partition.points.begin(), partition.points.end(), pointCompare );
+    partition.points.resize( std::unique( partition.points.begin(), partition.points.end() ) - partition.points.begin() );
+  };
+
+  if ( partitions.count() == 1 )
+    extractPartition( partitions.first() );
+  else
+    QtConcurrent::blockingMap( partitions, extractPartition );
+
+  QVector< QgsNetworkSegment > segments;
+  Q_FOREACH ( const QgsNetworkPartition &partition, partitions )
+  {
+    segments += partition.segments;
+    step += partition.features.count();
+  }
+  emit buildProgress( step, featureCount );
+  // end: extract segments
+
+  // begin: tie points to the graph, using an index of the segments
+  snappedPoints = QVector< QgsPoint >( additionalPoints.size(), QgsPoint( 0.0, 0.0 ) );
+
+  QVector< QgsNetworkTiePoint > tiePoints( additionalPoints.size() );
+  for ( int i = 0; i < additionalPoints.size(); ++i )
+    tiePoints[ i ].point = additionalPoints.at( i );
+
+  if ( !tiePoints.isEmpty() && !segments.isEmpty() )
+  {
+    QgsNetworkSegmentIndex segmentIndex( segments );
+    QtConcurrent::blockingMap( tiePoints, [&segmentIndex]( QgsNetworkTiePoint & tiePoint )
     {
-      directionType = Direction::DirectionBackward;
-    }
+      tiePoint.segment = segmentIndex.nearest( tiePoint.point, tiePoint.info );
+    } );
+  }
+
+  QVector< TiePointInfo > pointLengthMap;
+  QVector< QgsPoint > tiedPoints;
+  for ( int i = 0; i < tiePoints.size(); ++i )
+  {
+    if ( tiePoints.at( i ).segment < 0 )
+      continue;
+
+    snappedPoints[ i ] = tiePoints.at( i ).info.mTiedPoint;
+    pointLengthMap << tiePoints.at( i ).info;
+    if ( snappedPoints[ i ] != QgsPoint( 0.0, 0.0 ) )
+      tiedPoints << snappedPoints[ i ];
+  }
+  // end: tie points to graph
+
+  // merge the sorted vertex tables of the threads and the tied points, in a deterministic order
+  std::sort( tiedPoints.begin(), tiedPoints.end(), pointCompare );
+  QVector< QgsPoint > points = tiedPoints;
+  Q_FOREACH ( const QgsNetworkPartition &partition, partitions )
+  {
+    QVector< QgsPoint > merged( points.size() + partition.points.size() );
+    std::merge( points.constBegin(), points.constEnd(), partition.points.constBegin(), partition.points.constEnd(), merged.begin(), pointCompare );
+    points.swap( merged );
+  }
+  QVector< QgsPoint >::iterator tmp = std::unique( points.begin(), points.end() );
+  points.resize( tmp - points.begin() );
 
-    // begin features segments and add arc to the Graph;
-    QgsMultiPolyline mpl;
-    if ( QgsWkbTypes::flatType( feature.geometry().geometry()->wkbType() ) == QgsWkbTypes::MultiLineString )
-      mpl = feature.geometry().asMultiPolyline();
-    else if ( QgsWkbTypes::flatType( feature.geometry().geometry()->wkbType() ) == QgsWkbTypes::LineString )
-      mpl.push_back( feature.geometry().asPolyline() );
+  int i = 0;
+  for ( i = 0; i < points.size(); ++i )
+    builder->addVertex( i, points[ i ] );
 
-    QgsMultiPolyline::iterator mplIt;
-    for ( mplIt = mpl.begin(); mplIt != mpl.end(); ++mplIt )
+  for ( i = 0; i < snappedPoints.size() ; ++i )
+    snappedPoints[ i ] = *( my_binary_search( points.begin(), points.end(), snappedPoints[ i ], pointCompare ) );
+
+  std::sort( pointLengthMap.begin(), pointLengthMap.end(), TiePointInfoCompare );
+
+  // begin graph construction
+  Q_FOREACH ( const QgsNetworkPartition &partition, partitions )
+  {
+    for ( int featureIdx = 0; featureIdx < partition.features.count(); ++featureIdx )
     {
-      QgsPoint pt1, pt2;
+      const QgsFeature &feature = partition.features.at( featureIdx );
+      const Direction directionType = partition.directions.at( featureIdx );
 
-      bool isFirstPoint = true;
-      QgsPolyline::iterator pointIt;
-      for ( pointIt = mplIt->begin(); pointIt != mplIt->end(); ++pointIt )
+      for ( int segmentIdx = partition.firstSegment.at( featureIdx ); segmentIdx < partition.firstSegment.at( featureIdx + 1 ); ++segmentIdx )
       {
-        pt2 = ct.transform( *pointIt );
-
-        if ( !isFirstPoint )
+        const QgsPoint &pt1 = partition.segments.at( segmentIdx ).first;
+        const QgsPoint &pt2 = partition.segments.at( segmentIdx ).last;
+
+        QMap< double, QgsPoint > pointsOnArc;
+        pointsOnArc[ 0.0 ] = pt1;
+        pointsOnArc[ pt1.sqrDist( pt2 )] = pt2;
+
+        // all the points tied to a segment with the same end points
+        TiePointInfo t;
+        t.mFirstPoint = pt1;
+        t.mLastPoint  = pt2;
+        t.mLength = 0.0;
+        auto tiedRange = std::equal_range( pointLengthMap.constBegin(), pointLengthMap.constEnd(), t, TiePointInfoCompare );
+        for ( QVector< TiePointInfo >::const_iterator it = tiedRange.first; it != tiedRange.second; ++it )
         {
-          QMap< double, QgsPoint > pointsOnArc;
-          pointsOnArc[ 0.0 ] = pt1;
-          pointsOnArc[ pt1.sqrDist( pt2 )] = pt2;
+          if ( it->mFirstPoint == pt1 && it->mLastPoint == pt2 )
+          {
+            pointsOnArc[ pt1.sqrDist( it->mTiedPoint )] = it->mTiedPoint;
+          }
+        }
 
-          TiePointInfo t;
-          t.mFirstPoint = pt1;
-          t.mLastPoint  = pt2;
-          t.mLength = 0.0;
-          pointLengthIt = my_binary_search( pointLengthMap.begin(), pointLengthMap.end(), t, TiePointInfoCompare );
+        QMap< double, QgsPoint >::iterator pointsIt;
+        QgsPoint arcPt1;
+        QgsPoint arcPt2;
+        int pt1idx = -1, pt2idx = -1;
+        bool isFirstPoint = true;
+        for ( pointsIt = pointsOnArc.begin(); pointsIt != pointsOnArc.end(); ++pointsIt )
+        {
+          arcPt2 = *pointsIt;
+          tmp = my_binary_search( points.begin(), points.end(), arcPt2, pointCompare );
+          arcPt2 = *tmp;
+          pt2idx = tmp - points.begin();
 
-          if ( pointLengthIt != pointLengthMap.end() )
+          if ( !isFirstPoint && arcPt1 != arcPt2 )
           {
-            QVector< TiePointInfo >::iterator it;
-            for ( it = pointLengthIt; it - pointLengthMap.begin() >= 0; --it )
+            double distance = builder->distanceArea()->measureLine( arcPt1, arcPt2 );
+            QVector< QVariant > prop;
+            QList< QgsNetworkStrategy * >::const_iterator it;
+            for ( it = mStrategies.begin(); it != mStrategies.end(); ++it )
             {
-              if ( it->mFirstPoint == pt1 && it->mLastPoint == pt2 )
-              {
-                pointsOnArc[ pt1.sqrDist( it->mTiedPoint )] = it->mTiedPoint;
-              }
+              prop.push_back( ( *it )->cost( distance, feature ) );
             }
-            for ( it = pointLengthIt + 1; it != pointLengthMap.end(); ++it )
+
+            if ( directionType == Direction::DirectionForward ||
+                 directionType == Direction::DirectionBoth )
             {
-              if ( it->mFirstPoint == pt1 && it->mLastPoint == pt2 )
-              {
-                pointsOnArc[ pt1.sqrDist( it->mTiedPoint )] = it->mTiedPoint;
-              }
+              builder->addEdge( pt1idx, arcPt1, pt2idx, arcPt2, prop );
             }
-          }
-
-          QMap< double, QgsPoint >::iterator pointsIt;
-          QgsPoint pt1;
-          QgsPoint pt2;
-          int pt1idx = -1, pt2idx = -1;
-          bool isFirstPoint = true;
-          for ( pointsIt = pointsOnArc.begin(); pointsIt != pointsOnArc.end(); ++pointsIt )
-          {
-            pt2 = *pointsIt;
-            tmp = my_binary_search( points.begin(), points.end(), pt2, pointCompare );
-            pt2 = *tmp;
-            pt2idx = tmp - points.begin();
-
-            if ( !isFirstPoint && pt1 != pt2 )
+            if ( directionType == Direction::DirectionBackward ||
+                 directionType == Direction::DirectionBoth )
             {
-              double distance = builder->distanceArea()->measureLine( pt1, pt2 );
-              QVector< QVariant > prop;
-              QList< QgsNetworkStrategy * >::const_iterator it;
-              for ( it = mStrategies.begin(); it != mStrategies.end(); ++it )
-              {
-                prop.push_back( ( *it )->cost( distance, feature ) );
-              }
-
-              if ( directionType == Direction::DirectionForward ||
-                   directionType == Direction::DirectionBoth )
-              {
-                builder->addEdge( pt1idx, pt1, pt2idx, pt2, prop );
-              }
-              if ( directionType == Direction::DirectionBackward ||
-                   directionType == Direction::DirectionBoth )
-              {
-                builder->addEdge( pt2idx, pt2, pt1idx, pt1, prop );
-              }
+              builder->addEdge( pt2idx, arcPt2, pt1idx, arcPt1, prop );
             }
-            pt1idx = pt2idx;
-            pt1 = pt2;
-            isFirstPoint = false;
           }
-        } // if ( !isFirstPoint )
-        pt1 = pt2;
-        isFirstPoint = false;
-      } // for (it = pl.begin(); it != pl.end(); ++it)
+          pt1idx = pt2idx;
+          arcPt1 = arcPt2;
+          isFirstPoint = false;
+        }
+      }
+      emit buildProgress( ++step, featureCount );
     }
-    emit buildProgress( ++step, featureCount );
-  } // while( vl->nextFeature(feature) )
+  }
 } // makeGraph( QgsGraphBuilderInterface *builder, const QVector< QgsPoint >& additionalPoints, QVector< QgsPoint >& tiedPoint )
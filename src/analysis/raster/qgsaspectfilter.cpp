@@ -43,3 +43,23 @@ float QgsAspectFilter::processNineCellWindow(
   }
 }
 
+void QgsAspectFilter::processScanLine( const float *scanLine1, const float *scanLine2, const float *scanLine3, float *resultLine, int width, ScanLineBuffers &buffers )
+{
+  float *derX = buffers.floats1.data();
+  float *derY = buffers.floats2.data();
+  calcFirstDerivatives( scanLine1, scanLine2, scanLine3, derX, derY, width );
+
+  for ( int j = 0; j < width; ++j )
+  {
+    if ( derX[j] == mOutputNodataValue ||
+         derY[j] == mOutputNodataValue ||
+         ( derX[j] == 0.0 && derY[j] == 0.0 ) )
+    {
+      resultLine[j] = mOutputNodataValue;
+    }
+    else
+    {
+      resultLine[j] = 180.0 + atan2( derX[j], derY[j] ) * 180.0 / M_PI;
+    }
+  }
+}
@@ -157,7 +157,42 @@ float QgsDerivativeFilter::calcFirstDerY( float *x11, float *x21, float *x31, fl
   return sum / ( weight * mCellSizeY * mZFactor );
 }
 
-
-
-
-
+void QgsDerivativeFilter::calcFirstDerivatives( const float *scanLine1, const float *scanLine2, const float *scanLine3,
+    float *derX, float *derY, int width )
+{
+  //without nodata values in the window, the derivatives are the basic formulas, evaluated
+  //in the same order as calcFirstDerX and calcFirstDerY for identical results
+  const double denominatorX = 8 * mCellSizeX * mZFactor;
+  const double denominatorY = 8 * mCellSizeY * mZFactor;
+  for ( int j = 0; j < width; ++j )
+  {
+    double sumX = 0;
+    sumX += ( scanLine1[j + 1] - scanLine1[j - 1] );
+    sumX += 2 * ( scanLine2[j + 1] - scanLine2[j - 1] );
+    sumX += ( scanLine3[j + 1] - scanLine3[j - 1] );
+    derX[j] = sumX / denominatorX;
+
+    double sumY = 0;
+    sumY += ( scanLine1[j - 1] - scanLine3[j - 1] );
+    sumY += 2 * ( scanLine1[j] - scanLine3[j] );
+    sumY += ( scanLine1[j + 1] - scanLine3[j + 1] );
+    derY[j] = sumY / denominatorY;
+  }
+
+  //the windows with nodata values (e.g. at the border) are calculated again with the weights of the valid cells
+  float *line1 = const_cast< float * >( scanLine1 );
+  float *line2 = const_cast< float * >( scanLine2 );
+  float *line3 = const_cast< float * >( scanLine3 );
+  const float nodata = mInputNodataValue;
+  for ( int j = 0; j < width; ++j )
+  {
+    const bool hasNodata = ( line1[j - 1] == nodata ) | ( line1[j] == nodata ) | ( line1[j + 1] == nodata )
+                           | ( line2[j - 1] == nodata ) | ( line2[j] == nodata ) | ( line2[j + 1] == nodata )
+                           | ( line3[j - 1] == nodata ) | ( line3[j] == nodata ) | ( line3[j + 1] == nodata );
+    if ( hasNodata )
+    {
+      derX[j] = calcFirstDerX( &line1[j - 1], &line1[j], &line1[j + 1], &line2[j - 1], &line2[j], &line2[j + 1], &line3[j - 1], &line3[j], &line3[j + 1] );
+      derY[j] = calcFirstDerY( &line1[j - 1], &line1[j], &line1[j + 1], &line2[j - 1], &line2[j], &line2[j + 1], &line3[j - 1], &line3[j], &line3[j + 1] );
+    }
+  }
+}
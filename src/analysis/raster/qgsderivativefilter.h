@@ -38,6 +38,16 @@ class ANALYSIS_EXPORT QgsDerivativeFilter : public QgsNineCellFilter
     float calcFirstDerX( float *x11, float *x21, float *x31, float *x12, float *x22, float *x32, float *x13, float *x23, float *x33 );
     //! Calculates the first order derivative in y-direction according to Horn (1981)
     float calcFirstDerY( float *x11, float *x21, float *x31, float *x12, float *x22, float *x32, float *x13, float *x23, float *x33 );
+
+    /**
+     * Calculates the first order derivatives in x- and y-direction of a scan line, with the same values as
+     * calcFirstDerX() and calcFirstDerY(). See processScanLine() for the layout of the scan lines.
+     * The windows without nodata values are calculated in a loop which the compiler can vectorize.
+     * \note not available in Python bindings
+     * \note added in QGIS 3.0
+     */
+    void calcFirstDerivatives( const float *scanLine1, const float *scanLine2, const float *scanLine3,
+                               float *derX, float *derY, int width );
 };
 
 #endif // QGSDERIVATIVEFILTER_H
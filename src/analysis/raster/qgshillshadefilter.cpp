@@ -17,6 +17,26 @@
 
 #include "qgshillshadefilter.h"
 
+///@cond PRIVATE
+
+//! Returns the hillshade value for the first order derivatives and the direction of the light
+static inline float hillshadeFromDerivatives( float derX, float derY, float azimuth_rad, double cosZenith, double sinZenith )
+{
+  float slope_rad = atan( sqrt( derX * derX + derY * derY ) );
+  float aspect_rad = 0;
+  if ( derX == 0 && derY == 0 ) //aspect undefined, take a neutral value. Better solutions?
+  {
+    aspect_rad = azimuth_rad / 2.0;
+  }
+  else
+  {
+    aspect_rad = M_PI + atan2( derX, derY );
+  }
+  return qMax( 0.0, 255.0 * ( ( cosZenith * cos( slope_rad ) ) + ( sinZenith * sin( slope_rad ) * cos( azimuth_rad - aspect_rad ) ) ) );
+}
+
+///@endcond
+
 QgsHillshadeFilter::QgsHillshadeFilter( const QString &inputFile, const QString &outputFile, const QString &outputFormat, double lightAzimuth,
                                         double lightAngle )
   : QgsDerivativeFilter( inputFile, outputFile, outputFormat )
@@ -38,16 +58,31 @@ float QgsHillshadeFilter::processNineCellWindow( float *x11, float *x21, float *
   }
 
   float zenith_rad = mLightAngle * M_PI / 180.0;
-  float slope_rad = atan( sqrt( derX * derX + derY * derY ) );
   float azimuth_rad = mLightAzimuth * M_PI / 180.0;
-  float aspect_rad = 0;
-  if ( derX == 0 && derY == 0 ) //aspect undefined, take a neutral value. Better solutions?
-  {
-    aspect_rad = azimuth_rad / 2.0;
-  }
-  else
+  return hillshadeFromDerivatives( derX, derY, azimuth_rad, cos( zenith_rad ), sin( zenith_rad ) );
+}
+
+void QgsHillshadeFilter::processScanLine( const float *scanLine1, const float *scanLine2, const float *scanLine3, float *resultLine, int width, ScanLineBuffers &buffers )
+{
+  float *derX = buffers.floats1.data();
+  float *derY = buffers.floats2.data();
+  calcFirstDerivatives( scanLine1, scanLine2, scanLine3, derX, derY, width );
+
+  //the terms of the light direction are the same for all the cells
+  const float zenith_rad = mLightAngle * M_PI / 180.0;
+  const float azimuth_rad = mLightAzimuth * M_PI / 180.0;
+  const double cosZenith = cos( zenith_rad );
+  const double sinZenith = sin( zenith_rad );
+
+  for ( int j = 0; j < width; ++j )
   {
-    aspect_rad = M_PI + atan2( derX, derY );
+    if ( derX[j] == mOutputNodataValue || derY[j] == mOutputNodataValue )
+    {
+      resultLine[j] = mOutputNodataValue;
+    }
+    else
+    {
+      resultLine[j] = hillshadeFromDerivatives( derX[j], derY[j], azimuth_rad, cosZenith, sinZenith );
+    }
   }
-  return qMax( 0.0, 255.0 * ( ( cos( zenith_rad ) * cos( slope_rad ) ) + ( sin( zenith_rad ) * sin( slope_rad ) * cos( azimuth_rad - aspect_rad ) ) ) );
 }
@@ -17,12 +17,118 @@
 #include "qgsvectorlayer.h"
 #include "qgsgeometry.h"
 
+#include <QPair>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
 #define NO_DATA -9999
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+///@cond PRIVATE
+
+//! Width and height of the tiles of the output raster kept in memory
+static const int KDE_TILE_SIZE = 256;
+//! Number of points added to the tiles at once
+static const int KDE_BATCH_POINTS = 65536;
+//! Smallest size of the FFT used to convolve the bins, the output is convolved by blocks of half of it
+static const int KDE_MIN_FFT_SIZE = 2 * KDE_TILE_SIZE;
+//! Largest width of the kernel whose values around a bin are calculated once
+static const int KDE_MAX_STENCIL_SIZE = 513;
+//! Rough number of operations to calculate a value of the kernel, relative to adding a value of the stencil
+static const int KDE_KERNEL_COST = 10;
+//! Memory used by an output tile and by the bins of a tile
+static const qint64 KDE_TILE_BYTES = KDE_TILE_SIZE * KDE_TILE_SIZE * sizeof( float );
+static const qint64 KDE_BIN_TILE_BYTES = KDE_TILE_SIZE * KDE_TILE_SIZE * ( sizeof( double ) + sizeof( int ) );
+
+typedef std::complex< double > KdeComplex;
+
+//! Multiplies complex numbers, without the special cases of infinite values which make std::complex slow
+static inline KdeComplex multiply( const KdeComplex &a, const KdeComplex &b )
+{
+  return KdeComplex( a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real() );
+}
+
+/**
+ * In place radix-2 fast Fourier transform of \a n values, \a n being a power of 2. \a twiddles are
+ * the n / 2 values of exp( -2 pi i k / n ). The inverse transform is not scaled by 1 / n.
+ */
+static void fft( KdeComplex *data, int n, const KdeComplex *twiddles, bool inverse )
+{
+  // bit reversal permutation
+  for ( int i = 1, j = 0; i < n; ++i )
+  {
+    int bit = n >> 1;
+    for ( ; j & bit; bit >>= 1 )
+      j ^= bit;
+    j ^= bit;
+    if ( i < j )
+      std::swap( data[i], data[j] );
+  }
+
+  for ( int length = 2; length <= n; length <<= 1 )
+  {
+    const int half = length / 2;
+    const int step = n / length;
+    for ( int start = 0; start < n; start += length )
+    {
+      for ( int k = 0; k < half; ++k )
+      {
+        const KdeComplex w = inverse ? std::conj( twiddles[k * step] ) : twiddles[k * step];
+        const KdeComplex u = data[start + k];
+        const KdeComplex v = multiply( data[start + k + half], w );
+        data[start + k] = u + v;
+        data[start + k + half] = u - v;
+      }
+    }
+  }
+}
+
+//! In place 2D fast Fourier transform of \a n x \a n values by rows, \a column must have room for n values
+static void fft2d( KdeComplex *data, int n, const KdeComplex *twiddles, bool inverse, KdeComplex *column )
+{
+  for ( int row = 0; row < n; ++row )
+  {
+    fft( data + row * n, n, twiddles, inverse );
+  }
+  for ( int col = 0; col < n; ++col )
+  {
+    for ( int row = 0; row < n; ++row )
+      column[row] = data[row * n + col];
+    fft( column, n, twiddles, inverse );
+    for ( int row = 0; row < n; ++row )
+      data[row * n + col] = column[row];
+  }
+}
+
+//! Output tile and the points or bins contributing to it
+struct QgsKdeTileTask
+{
+  int tileIndex;
+  float *values;
+  //! Indices of the pending points contributing to the tile, in the order they were added
+  QVector< int > points;
+};
+
+//! Block of the output raster convolved by a thread
+struct QgsKdeBlockTask
+{
+  int firstCol;
+  int firstRow;
+  //! Sums of the kernel values of the bins, by rows of the block
+  QVector< double > sums;
+  //! Number of bins within the radius of the pixels
+  QVector< double > counts;
+};
+
+///@endcond
+
 QgsKernelDensityEstimation::QgsKernelDensityEstimation( const QgsKernelDensityEstimation::Parameters &parameters, const QString &outputFile, const QString &outputFormat )
   : mInputLayer( parameters.vectorLayer )
   , mOutputFile( outputFile )
@@ -35,6 +141,16 @@ QgsKernelDensityEstimation::QgsKernelDensityEstimation( const QgsKernelDensityEs
   , mDecay( parameters.decayRatio )
   , mOutputValues( parameters.outputValues )
   , mBufferSize( -1 )
+  , mBinPoints( parameters.binPoints )
+  , mMemoryLimit( static_cast< qint64 >( parameters.memoryLimit ) * 1024 * 1024 )
+  , mColumns( 0 )
+  , mRows( 0 )
+  , mTileColumns( 0 )
+  , mTileRows( 0 )
+  , mTileUseCounter( 0 )
+  , mLoadedTiles( 0 )
+  , mBinTiles( 0 )
+  , mConvolutionBytes( 0 )
   , mDatasetH( nullptr )
   , mRasterBandH( nullptr )
 {
@@ -63,10 +179,13 @@ QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::run()
   QgsFeature f;
   while ( fit.nextFeature( f ) )
   {
-    addFeature( f );
+    result = addFeature( f );
+    if ( result != Success )
+      break;
   }
 
-  return finalise();
+  Result finaliseResult = finalise();
+  return result != Success ? result : finaliseResult;
 }
 
 QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::prepare()
@@ -104,6 +223,27 @@ QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::prepare()
   if ( mRadiusField < 0 )
     mBufferSize = radiusSizeInPixels( mRadius );
 
+  // the surface is accumulated in memory and written by finalise()
+  mColumns = cols;
+  mRows = rows;
+  mTileColumns = ( cols + KDE_TILE_SIZE - 1 ) / KDE_TILE_SIZE;
+  mTileRows = ( rows + KDE_TILE_SIZE - 1 ) / KDE_TILE_SIZE;
+  mTiles.clear();
+  mTiles.resize( mTileColumns * mTileRows );
+  mTileWritten.fill( false, mTileColumns * mTileRows );
+  mTileLastUse.fill( 0, mTileColumns * mTileRows );
+  mTileUseCounter = 0;
+  mLoadedTiles = 0;
+  mPendingPoints.clear();
+  mBinWeights.clear();
+  mBinCounts.clear();
+  mBinTiles = 0;
+  if ( mBinPoints && mRadiusField < 0 )
+  {
+    mBinWeights.resize( mTileColumns * mTileRows );
+    mBinCounts.resize( mTileColumns * mTileRows );
+  }
+
   return Success;
 }
 
@@ -139,7 +279,6 @@ QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::addFeature( const
     radius = feature.attribute( mRadiusField ).toDouble();
     buffer = radiusSizeInPixels( radius );
   }
-  int blockSize = 2 * buffer + 1; //Block SIDE would be more appropriate
 
   // calculate weight
   double weight = 1.0;
@@ -159,59 +298,710 @@ QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::addFeature( const
       continue;
     }
 
-    // calculate the pixel position
-    unsigned int xPosition = ( ( ( *pointIt ).x() - mBounds.xMinimum() ) / mPixelSize ) - buffer;
-    unsigned int yPosition = ( ( ( *pointIt ).y() - mBounds.yMinimum() ) / mPixelSize ) - buffer;
+    if ( !mBinWeights.isEmpty() )
+    {
+      if ( addBinnedPoint( ( *pointIt ).x(), ( *pointIt ).y(), weight ) )
+        continue;
+
+      // the bins are too large, the points are added one by one from now on
+      result = binsToPendingPoints();
+      if ( result != Success )
+        return result;
+    }
 
-    // get the data
-    float *dataBuffer = ( float * ) CPLMalloc( sizeof( float ) * blockSize * blockSize );
-    if ( GDALRasterIO( mRasterBandH, GF_Read, xPosition, yPosition, blockSize, blockSize,
-                       dataBuffer, blockSize, blockSize, GDT_Float32, 0, 0 ) != CE_None )
+    PendingPoint point;
+    point.x = ( *pointIt ).x();
+    point.y = ( *pointIt ).y();
+    if ( mBinPoints && mRadiusField < 0 )
     {
-      result = RasterIoError;
+      // keep the points at the center of their pixel, as they would have been binned
+      const int col = std::min( mColumns - 1, static_cast< int >( ( point.x - mBounds.xMinimum() ) / mPixelSize ) );
+      const int row = std::min( mRows - 1, static_cast< int >( ( point.y - mBounds.yMinimum() ) / mPixelSize ) );
+      point.x = ( col + 0.5 ) * mPixelSize + mBounds.xMinimum();
+      point.y = ( row + 0.5 ) * mPixelSize + mBounds.yMinimum();
+    }
+    point.radius = radius;
+    point.weight = weight;
+    point.buffer = buffer;
+    mPendingPoints << point;
+  }
+
+  if ( mPendingPoints.size() >= KDE_BATCH_POINTS )
+  {
+    result = addPendingPoints();
+  }
+
+  return result;
+}
+
+QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::finalise()
+{
+  Result result = !mBinWeights.isEmpty() ? convolveBins() : addPendingPoints();
+  if ( result == Success )
+    result = writeTiles();
+
+  GDALClose( ( GDALDatasetH ) mDatasetH );
+  mDatasetH = nullptr;
+  mRasterBandH = nullptr;
+
+  mTiles.clear();
+  mTileWritten.clear();
+  mTileLastUse.clear();
+  mLoadedTiles = 0;
+  mPendingPoints.clear();
+  mBinWeights.clear();
+  mBinCounts.clear();
+  mBinTiles = 0;
+  return result;
+}
+
+int QgsKernelDensityEstimation::maxLoadedTiles() const
+{
+  // the bins are limited to half of the memory, and the convolution buffers to half of what they leave
+  return static_cast< int >( std::max< qint64 >( 1, ( mMemoryLimit - mBinTiles * KDE_BIN_TILE_BYTES - mConvolutionBytes ) / KDE_TILE_BYTES ) );
+}
+
+QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::loadTiles( const QVector< int > &tileIndices )
+{
+  const quint64 use = ++mTileUseCounter;
+  int missing = 0;
+  for ( int tileIndex : tileIndices )
+  {
+    if ( mTiles.at( tileIndex ).isEmpty() )
+      ++missing;
+    mTileLastUse[ tileIndex ] = use;
+  }
+
+  // release the least recently used tiles, other than the requested ones
+  const int maxTiles = maxLoadedTiles();
+  if ( mLoadedTiles + missing > maxTiles )
+  {
+    QVector< QPair< quint64, int > > loaded;
+    for ( int tileIndex = 0; tileIndex < mTiles.size(); ++tileIndex )
+    {
+      if ( !mTiles.at( tileIndex ).isEmpty() && mTileLastUse.at( tileIndex ) != use )
+        loaded << qMakePair( mTileLastUse.at( tileIndex ), tileIndex );
+    }
+    std::sort( loaded.begin(), loaded.end() );
+    for ( int i = 0; i < loaded.size() && mLoadedTiles + missing > maxTiles; ++i )
+    {
+      Result result = releaseTile( loaded.at( i ).second );
+      if ( result != Success )
+        return result;
     }
+  }
+
+  for ( int tileIndex : tileIndices )
+  {
+    QVector< float > &values = mTiles[ tileIndex ];
+    if ( !values.isEmpty() )
+      continue;
 
-    for ( int xp = 0; xp < blockSize; xp++ )
+    values.fill( NO_DATA, KDE_TILE_SIZE * KDE_TILE_SIZE );
+    ++mLoadedTiles;
+    if ( !mTileWritten.at( tileIndex ) )
+      continue;
+
+    const int tileFirstCol = ( tileIndex % mTileColumns ) * KDE_TILE_SIZE;
+    const int tileFirstRow = ( tileIndex / mTileColumns ) * KDE_TILE_SIZE;
+    const int tileCols = std::min( mColumns - tileFirstCol, KDE_TILE_SIZE );
+    const int tileRows = std::min( mRows - tileFirstRow, KDE_TILE_SIZE );
+    if ( GDALRasterIO( mRasterBandH, GF_Read, tileFirstCol, tileFirstRow, tileCols, tileRows, values.data(),
+                       tileCols, tileRows, GDT_Float32, 0, KDE_TILE_SIZE * static_cast< int >( sizeof( float ) ) ) != CE_None )
     {
-      for ( int yp = 0; yp < blockSize; yp++ )
+      return RasterIoError;
+    }
+  }
+  return Success;
+}
+
+QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::releaseTile( int tileIndex )
+{
+  QVector< float > &values = mTiles[ tileIndex ];
+  const int tileFirstCol = ( tileIndex % mTileColumns ) * KDE_TILE_SIZE;
+  const int tileFirstRow = ( tileIndex / mTileColumns ) * KDE_TILE_SIZE;
+  const int tileCols = std::min( mColumns - tileFirstCol, KDE_TILE_SIZE );
+  const int tileRows = std::min( mRows - tileFirstRow, KDE_TILE_SIZE );
+  if ( GDALRasterIO( mRasterBandH, GF_Write, tileFirstCol, tileFirstRow, tileCols, tileRows, values.data(),
+                     tileCols, tileRows, GDT_Float32, 0, KDE_TILE_SIZE * static_cast< int >( sizeof( float ) ) ) != CE_None )
+  {
+    return RasterIoError;
+  }
+
+  values = QVector< float >();
+  mTileWritten[ tileIndex ] = true;
+  --mLoadedTiles;
+  return Success;
+}
+
+template <typename Task, typename Function>
+QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::runTileTasks( QVector< Task > &tasks, Function function )
+{
+  const int groupSize = maxLoadedTiles();
+  for ( int first = 0; first < tasks.size(); first += groupSize )
+  {
+    QVector< Task > group = tasks.mid( first, groupSize );
+    QVector< int > tileIndices;
+    tileIndices.reserve( group.size() );
+    for ( const Task &task : group )
+      tileIndices << task.tileIndex;
+
+    Result result = loadTiles( tileIndices );
+    if ( result != Success )
+      return result;
+
+    for ( Task &task : group )
+      task.values = mTiles[ task.tileIndex ].data();
+    QtConcurrent::blockingMap( group, function );
+  }
+  return Success;
+}
+
+QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::addPendingPoints()
+{
+  if ( mPendingPoints.isEmpty() )
+    return Success;
+
+  // the points are added to the tiles in parallel, but each tile is calculated by a single thread
+  // in the order of the points, which gives the same values as adding the points one by one
+  QVector< int > taskOfTile( mTiles.size(), -1 );
+  QVector< QgsKdeTileTask > tasks;
+  for ( int i = 0; i < mPendingPoints.size(); ++i )
+  {
+    const PendingPoint &point = mPendingPoints.at( i );
+    const int blockSize = 2 * point.buffer + 1;
+    const int xPosition = static_cast< int >( std::floor( ( point.x - mBounds.xMinimum() ) / mPixelSize ) ) - point.buffer;
+    const int yPosition = static_cast< int >( std::floor( ( point.y - mBounds.yMinimum() ) / mPixelSize ) ) - point.buffer;
+
+    // pixels outside of the raster are skipped
+    const int firstCol = std::max( 0, xPosition );
+    const int lastCol = std::min( mColumns - 1, xPosition + blockSize - 1 );
+    const int firstRow = std::max( 0, yPosition );
+    const int lastRow = std::min( mRows - 1, yPosition + blockSize - 1 );
+    if ( firstCol > lastCol || firstRow > lastRow )
+      continue;
+
+    for ( int tileRow = firstRow / KDE_TILE_SIZE; tileRow <= lastRow / KDE_TILE_SIZE; ++tileRow )
+    {
+      for ( int tileCol = firstCol / KDE_TILE_SIZE; tileCol <= lastCol / KDE_TILE_SIZE; ++tileCol )
+      {
+        const int tileIndex = tileRow * mTileColumns + tileCol;
+        if ( taskOfTile.at( tileIndex ) < 0 )
+        {
+          QgsKdeTileTask task;
+          task.tileIndex = tileIndex;
+          task.values = nullptr;
+          taskOfTile[ tileIndex ] = tasks.size();
+          tasks << task;
+        }
+        tasks[ taskOfTile.at( tileIndex ) ].points << i;
+      }
+    }
+  }
+
+  Result result = runTileTasks( tasks, [this]( QgsKdeTileTask & task )
+  {
+    addPointsToTile( task.tileIndex, task.values, task.points );
+  } );
+
+  mPendingPoints.clear();
+  return result;
+}
+
+void QgsKernelDensityEstimation::addPointsToTile( int tileIndex, float *values, const QVector< int > &points ) const
+{
+  const int tileFirstCol = ( tileIndex % mTileColumns ) * KDE_TILE_SIZE;
+  const int tileFirstRow = ( tileIndex / mTileColumns ) * KDE_TILE_SIZE;
+  const int tileLastCol = std::min( mColumns, tileFirstCol + KDE_TILE_SIZE ) - 1;
+  const int tileLastRow = std::min( mRows, tileFirstRow + KDE_TILE_SIZE ) - 1;
+
+  for ( int i : points )
+  {
+    const PendingPoint &point = mPendingPoints.at( i );
+    const int blockSize = 2 * point.buffer + 1;
+    const int xPosition = static_cast< int >( std::floor( ( point.x - mBounds.xMinimum() ) / mPixelSize ) ) - point.buffer;
+    const int yPosition = static_cast< int >( std::floor( ( point.y - mBounds.yMinimum() ) / mPixelSize ) ) - point.buffer;
+
+    const int firstCol = std::max( tileFirstCol, xPosition );
+    const int lastCol = std::min( tileLastCol, xPosition + blockSize - 1 );
+    const int firstRow = std::max( tileFirstRow, yPosition );
+    const int lastRow = std::min( tileLastRow, yPosition + blockSize - 1 );
+
+    for ( int col = firstCol; col <= lastCol; col++ )
+    {
+      for ( int row = firstRow; row <= lastRow; row++ )
       {
-        double pixelCentroidX = ( xPosition + xp + 0.5 ) * mPixelSize + mBounds.xMinimum();
-        double pixelCentroidY = ( yPosition + yp + 0.5 ) * mPixelSize + mBounds.yMinimum();
+        double pixelCentroidX = ( col + 0.5 ) * mPixelSize + mBounds.xMinimum();
+        double pixelCentroidY = ( row + 0.5 ) * mPixelSize + mBounds.yMinimum();
 
-        double distance = sqrt( pow( pixelCentroidX - ( *pointIt ).x(), 2.0 ) + pow( pixelCentroidY - ( *pointIt ).y(), 2.0 ) );
+        double distance = sqrt( pow( pixelCentroidX - point.x, 2.0 ) + pow( pixelCentroidY - point.y, 2.0 ) );
 
         // is pixel outside search bandwidth of feature?
-        if ( distance > radius )
+        if ( distance > point.radius )
         {
           continue;
         }
 
-        double pixelValue = weight * calculateKernelValue( distance, radius, mShape, mOutputValues );
-        int pos = xp + blockSize * yp;
-        if ( dataBuffer[ pos ] == NO_DATA )
+        double pixelValue = point.weight * calculateKernelValue( distance, point.radius, mShape, mOutputValues );
+        float &value = values[ ( row - tileFirstRow ) * KDE_TILE_SIZE + col - tileFirstCol ];
+        if ( value == NO_DATA )
         {
-          dataBuffer[ pos ] = 0;
+          value = 0;
         }
-        dataBuffer[ pos ] += pixelValue;
+        value += pixelValue;
       }
     }
-    if ( GDALRasterIO( mRasterBandH, GF_Write, xPosition, yPosition, blockSize, blockSize,
-                       dataBuffer, blockSize, blockSize, GDT_Float32, 0, 0 ) != CE_None )
+  }
+}
+
+bool QgsKernelDensityEstimation::addBinnedPoint( double x, double y, double weight )
+{
+  const int col = std::min( mColumns - 1, static_cast< int >( ( x - mBounds.xMinimum() ) / mPixelSize ) );
+  const int row = std::min( mRows - 1, static_cast< int >( ( y - mBounds.yMinimum() ) / mPixelSize ) );
+  const int tileIndex = ( row / KDE_TILE_SIZE ) * mTileColumns + col / KDE_TILE_SIZE;
+  QVector< double > &weights = mBinWeights[ tileIndex ];
+  QVector< int > &counts = mBinCounts[ tileIndex ];
+  if ( weights.isEmpty() )
+  {
+    if ( ( mBinTiles + 1 ) * KDE_BIN_TILE_BYTES > mMemoryLimit / 2 )
+      return false;
+
+    weights.fill( 0, KDE_TILE_SIZE * KDE_TILE_SIZE );
+    counts.fill( 0, KDE_TILE_SIZE * KDE_TILE_SIZE );
+    ++mBinTiles;
+  }
+  const int pos = ( row % KDE_TILE_SIZE ) * KDE_TILE_SIZE + col % KDE_TILE_SIZE;
+  weights[ pos ] += weight;
+  counts[ pos ] += 1;
+  return true;
+}
+
+QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::binsToPendingPoints()
+{
+  // the kernel of a bin is the kernel of a point at the center of its pixel with the sum of the weights
+  for ( int tileIndex = 0; tileIndex < mBinWeights.size(); ++tileIndex )
+  {
+    const QVector< double > &weights = mBinWeights.at( tileIndex );
+    const QVector< int > &counts = mBinCounts.at( tileIndex );
+    if ( counts.isEmpty() )
+      continue;
+
+    const int tileFirstCol = ( tileIndex % mTileColumns ) * KDE_TILE_SIZE;
+    const int tileFirstRow = ( tileIndex / mTileColumns ) * KDE_TILE_SIZE;
+    for ( int pos = 0; pos < counts.size(); ++pos )
     {
-      result = RasterIoError;
+      if ( counts.at( pos ) == 0 )
+        continue;
+
+      PendingPoint point;
+      point.x = ( tileFirstCol + pos % KDE_TILE_SIZE + 0.5 ) * mPixelSize + mBounds.xMinimum();
+      point.y = ( tileFirstRow + pos / KDE_TILE_SIZE + 0.5 ) * mPixelSize + mBounds.yMinimum();
+      point.radius = mRadius;
+      point.weight = weights.at( pos );
+      point.buffer = mBufferSize;
+      mPendingPoints << point;
+    }
+    mBinWeights[ tileIndex ] = QVector< double >();
+    mBinCounts[ tileIndex ] = QVector< int >();
+    --mBinTiles;
+
+    if ( mPendingPoints.size() >= KDE_BATCH_POINTS )
+    {
+      Result result = addPendingPoints();
+      if ( result != Success )
+        return result;
+    }
+  }
+
+  mBinWeights.clear();
+  mBinCounts.clear();
+  return addPendingPoints();
+}
+
+QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::convolveBins()
+{
+  const int buffer = mBufferSize;
+  const int kernelSize = 2 * buffer + 1;
+
+  auto kernelValue = [this]( int dx, int dy, double & value ) -> bool
+  {
+    double distance = sqrt( pow( dx * mPixelSize, 2.0 ) + pow( dy * mPixelSize, 2.0 ) );
+    if ( distance > mRadius )
+      return false;
+
+    value = calculateKernelValue( distance, mRadius, mShape, mOutputValues );
+    return true;
+  };
+
+  // values of the kernel around a bin, with offsets up to the radius in pixels, only kept for small radiuses
+  const bool useStencil = kernelSize <= KDE_MAX_STENCIL_SIZE;
+  QVector< double > stencil;
+  QVector< bool > stencilInside;
+  if ( useStencil )
+  {
+    stencil.fill( 0.0, kernelSize * kernelSize );
+    stencilInside.fill( false, kernelSize * kernelSize );
+  }
+  qint64 discArea = 0;
+  for ( int dy = -buffer; dy <= buffer; ++dy )
+  {
+    for ( int dx = -buffer; dx <= buffer; ++dx )
+    {
+      double value = 0;
+      if ( !kernelValue( dx, dy, value ) )
+        continue;
+
+      ++discArea;
+      if ( useStencil )
+      {
+        const int pos = ( dy + buffer ) * kernelSize + dx + buffer;
+        stencil[ pos ] = value;
+        stencilInside[ pos ] = true;
+      }
+    }
+  }
+  const qint64 stencilBytes = useStencil ? static_cast< qint64 >( kernelSize ) * kernelSize * ( sizeof( double ) + sizeof( bool ) ) : 0;
+
+  // the output is convolved by blocks of half the FFT size, with a part of the kernel of the other half. The FFT
+  // is sized for the whole kernel, and reduced until the buffers of the threads fit in half of the memory left
+  // by the bins, the kernel being split in more parts then
+  const qint64 budget = ( mMemoryLimit - mBinTiles * KDE_BIN_TILE_BYTES ) / 2 - stencilBytes;
+  const int idealThreads = std::max( 1, QThread::idealThreadCount() );
+  int fftSize = KDE_MIN_FFT_SIZE;
+  while ( fftSize / 2 + 1 < kernelSize )
+    fftSize <<= 1;
+  int threads = 1;
+  qint64 sharedBytes = 0;
+  qint64 threadBytes = 0;
+  for ( ;; )
+  {
+    const qint64 transformBytes = static_cast< qint64 >( fftSize ) * fftSize * sizeof( KdeComplex );
+    const qint64 blockPixels = static_cast< qint64 >( fftSize / 2 ) * ( fftSize / 2 );
+    const bool singlePart = fftSize / 2 + 1 >= kernelSize;
+    // the transform of a single kernel part is shared, otherwise each thread transforms the parts it needs
+    sharedBytes = singlePart ? transformBytes : 0;
+    threadBytes = ( singlePart ? 1 : 2 ) * transformBytes + blockPixels * 2 * sizeof( double ) + fftSize * sizeof( KdeComplex );
+    threads = static_cast< int >( std::min< qint64 >( idealThreads, ( budget - sharedBytes ) / threadBytes ) );
+    if ( threads >= idealThreads || fftSize == KDE_MIN_FFT_SIZE )
+      break;
+    fftSize >>= 1;
+  }
+  threads = std::max( 1, threads );
+  mConvolutionBytes = stencilBytes + sharedBytes + threads * threadBytes;
+
+  const int blockSize = fftSize / 2;
+  const int partSize = fftSize / 2 + 1;
+  const bool singlePart = partSize >= kernelSize;
+
+  QVector< KdeComplex > twiddles( fftSize / 2 );
+  for ( int k = 0; k < fftSize / 2; ++k )
+  {
+    const double angle = -2 * M_PI * k / fftSize;
+    twiddles[k] = KdeComplex( std::cos( angle ), std::sin( angle ) );
+  }
+
+  // first offsets of the parts of the kernel with values within the radius
+  QVector< QPair< int, int > > parts;
+  for ( int partY = -buffer; partY <= buffer; partY += partSize )
+  {
+    for ( int partX = -buffer; partX <= buffer; partX += partSize )
+    {
+      const int nearestX = std::max( partX, std::min( 0, partX + partSize - 1 ) );
+      const int nearestY = std::max( partY, std::min( 0, partY + partSize - 1 ) );
+      double value = 0;
+      if ( kernelValue( nearestX, nearestY, value ) )
+        parts << qMakePair( partX, partY );
+    }
+  }
+
+  // transform of a part of the kernel in the real part and of the disc covered by the kernel in the imaginary part
+  auto transformPart = [&]( const QPair< int, int > &part, KdeComplex * transform, KdeComplex * column )
+  {
+    std::fill( transform, transform + fftSize * fftSize, KdeComplex( 0, 0 ) );
+    for ( int y = 0; y < partSize && part.second + y <= buffer; ++y )
+    {
+      for ( int x = 0; x < partSize && part.first + x <= buffer; ++x )
+      {
+        double value = 0;
+        if ( kernelValue( part.first + x, part.second + y, value ) )
+          transform[ y * fftSize + x ] = KdeComplex( value, 1 );
+      }
+    }
+    fft2d( transform, fftSize, twiddles.constData(), false, column );
+  };
+
+  QVector< KdeComplex > sharedTransform;
+  if ( singlePart )
+  {
+    sharedTransform.resize( fftSize * fftSize );
+    QVector< KdeComplex > column( fftSize );
+    transformPart( parts.at( 0 ), sharedTransform.data(), column.data() );
+  }
+
+  // number of bins in the tiles overlapping a region of the raster
+  QVector< int > binTileCounts( mBinCounts.size(), 0 );
+  for ( int tileIndex = 0; tileIndex < mBinCounts.size(); ++tileIndex )
+  {
+    const QVector< int > &counts = mBinCounts.at( tileIndex );
+    binTileCounts[ tileIndex ] = static_cast< int >( counts.size() - std::count( counts.constBegin(), counts.constEnd(), 0 ) );
+  }
+  auto regionBins = [&]( int firstCol, int firstRow, int lastCol, int lastRow ) -> qint64
+  {
+    firstCol = std::max( 0, firstCol );
+    firstRow = std::max( 0, firstRow );
+    lastCol = std::min( mColumns - 1, lastCol );
+    lastRow = std::min( mRows - 1, lastRow );
+    qint64 bins = 0;
+    if ( firstCol > lastCol || firstRow > lastRow )
+      return bins;
+
+    for ( int tileRow = firstRow / KDE_TILE_SIZE; tileRow <= lastRow / KDE_TILE_SIZE; ++tileRow )
+    {
+      for ( int tileCol = firstCol / KDE_TILE_SIZE; tileCol <= lastCol / KDE_TILE_SIZE; ++tileCol )
+        bins += binTileCounts.at( tileRow * mTileColumns + tileCol );
+    }
+    return bins;
+  };
+
+  // output blocks within the radius of a tile with bins
+  QVector< QgsKdeBlockTask > tasks;
+  for ( int firstRow = 0; firstRow < mRows; firstRow += blockSize )
+  {
+    for ( int firstCol = 0; firstCol < mColumns; firstCol += blockSize )
+    {
+      if ( regionBins( firstCol - buffer, firstRow - buffer, firstCol + blockSize - 1 + buffer, firstRow + blockSize - 1 + buffer ) == 0 )
+        continue;
+
+      QgsKdeBlockTask task;
+      task.firstCol = firstCol;
+      task.firstRow = firstRow;
+      tasks << task;
     }
-    CPLFree( dataBuffer );
   }
 
+  auto convolveBlock = [&]( QgsKdeBlockTask & task )
+  {
+    const int blockCols = std::min( mColumns - task.firstCol, blockSize );
+    const int blockRows = std::min( mRows - task.firstRow, blockSize );
+    task.sums.fill( 0.0, blockSize * blockSize );
+    task.counts.fill( 0.0, blockSize * blockSize );
+
+    // rough number of operations of both methods, sparse bins are added directly
+    const qint64 occupiedBins = regionBins( task.firstCol - buffer, task.firstRow - buffer,
+                                            task.firstCol + blockCols - 1 + buffer, task.firstRow + blockRows - 1 + buffer );
+    const double transformCost = 2.0 * fftSize * fftSize * std::log2( static_cast< double >( fftSize ) );
+    const double fftCost = parts.size() * ( singlePart ? 2 : 3 ) * transformCost;
+    const double directCost = static_cast< double >( occupiedBins ) * discArea * ( useStencil ? 1 : KDE_KERNEL_COST );
+    if ( directCost <= fftCost )
+    {
+      const int firstCol = std::max( 0, task.firstCol - buffer );
+      const int firstRow = std::max( 0, task.firstRow - buffer );
+      const int lastCol = std::min( mColumns - 1, task.firstCol + blockCols - 1 + buffer );
+      const int lastRow = std::min( mRows - 1, task.firstRow + blockRows - 1 + buffer );
+      for ( int row = firstRow; row <= lastRow; ++row )
+      {
+        for ( int col = firstCol; col <= lastCol; ++col )
+        {
+          const int binTile = ( row / KDE_TILE_SIZE ) * mTileColumns + col / KDE_TILE_SIZE;
+          const QVector< int > &counts = mBinCounts.at( binTile );
+          if ( counts.isEmpty() )
+          {
+            // skip to the next tile
+            col = std::min( lastCol, ( col / KDE_TILE_SIZE + 1 ) * KDE_TILE_SIZE - 1 );
+            continue;
+          }
+          const int pos = ( row % KDE_TILE_SIZE ) * KDE_TILE_SIZE + col % KDE_TILE_SIZE;
+          if ( counts.at( pos ) == 0 )
+            continue;
+
+          const double weight = mBinWeights.at( binTile ).at( pos );
+          const int outFirstRow = std::max( task.firstRow, row - buffer );
+          const int outLastRow = std::min( task.firstRow + blockRows - 1, row + buffer );
+          const int outFirstCol = std::max( task.firstCol, col - buffer );
+          const int outLastCol = std::min( task.firstCol + blockCols - 1, col + buffer );
+          for ( int outRow = outFirstRow; outRow <= outLastRow; ++outRow )
+          {
+            for ( int outCol = outFirstCol; outCol <= outLastCol; ++outCol )
+            {
+              double value = 0;
+              if ( useStencil )
+              {
+                const int stencilPos = ( outRow - row + buffer ) * kernelSize + outCol - col + buffer;
+                if ( !stencilInside.at( stencilPos ) )
+                  continue;
+                value = stencil.at( stencilPos );
+              }
+              else if ( !kernelValue( outCol - col, outRow - row, value ) )
+              {
+                continue;
+              }
+              const int blockPos = ( outRow - task.firstRow ) * blockSize + outCol - task.firstCol;
+              task.sums[ blockPos ] += weight * value;
+              task.counts[ blockPos ] += 1;
+            }
+          }
+        }
+      }
+      return;
+    }
+
+    QVector< KdeComplex > data( fftSize * fftSize );
+    QVector< KdeComplex > column( fftSize );
+    QVector< KdeComplex > partTransform;
+    if ( !singlePart )
+      partTransform.resize( fftSize * fftSize );
+    const double scale = 1.0 / ( static_cast< double >( fftSize ) * fftSize );
+
+    for ( const QPair< int, int > &part : parts )
+    {
+      // bins reaching the block through the part of the kernel, an output pixel p gets the bins p - offset,
+      // so the region starts at the first pixel of the block - the last offset of the part
+      const int regionCol = task.firstCol - part.first - partSize + 1;
+      const int regionRow = task.firstRow - part.second - partSize + 1;
+      if ( regionBins( regionCol, regionRow, regionCol + fftSize - 1, regionRow + fftSize - 1 ) == 0 )
+        continue;
+
+      // the weights in the real part and the counts in the imaginary part are transformed at once
+      std::fill( data.begin(), data.end(), KdeComplex( 0, 0 ) );
+      for ( int r = 0; r < fftSize; ++r )
+      {
+        const int row = regionRow + r;
+        if ( row < 0 || row >= mRows )
+          continue;
+        for ( int c = 0; c < fftSize; ++c )
+        {
+          const int col = regionCol + c;
+          if ( col < 0 || col >= mColumns )
+            continue;
+          const int binTile = ( row / KDE_TILE_SIZE ) * mTileColumns + col / KDE_TILE_SIZE;
+          const QVector< int > &counts = mBinCounts.at( binTile );
+          if ( counts.isEmpty() )
+            continue;
+          const int pos = ( row % KDE_TILE_SIZE ) * KDE_TILE_SIZE + col % KDE_TILE_SIZE;
+          if ( counts.at( pos ) > 0 )
+            data[ r * fftSize + c ] = KdeComplex( mBinWeights.at( binTile ).at( pos ), counts.at( pos ) );
+        }
+      }
+      fft2d( data.data(), fftSize, twiddles.constData(), false, column.data() );
+
+      const KdeComplex *kernel = sharedTransform.constData();
+      if ( !singlePart )
+      {
+        transformPart( part, partTransform.data(), column.data() );
+        kernel = partTransform.constData();
+      }
+
+      // with Z = W + iC the transform of the weights is (Z(k) + conj(Z(-k))) / 2 and the transform of the
+      // counts is (Z(k) - conj(Z(-k))) / 2i, and likewise for the kernel and the disc. The transforms of the
+      // weights and of the counts are multiplied by the ones of the kernel and of the disc, and combined
+      // again as W + iC, the values at -k being the conjugates of the ones at k
+      const KdeComplex halfI( 0, -0.5 );
+      for ( int ky = 0; ky < fftSize; ++ky )
+      {
+        for ( int kx = 0; kx < fftSize; ++kx )
+        {
+          const int index = ky * fftSize + kx;
+          const int mirror = ( ( fftSize - ky ) % fftSize ) * fftSize + ( fftSize - kx ) % fftSize;
+          if ( mirror < index )
+            continue;
+
+          const KdeComplex z = data.at( index );
+          const KdeComplex zMirror = data.at( mirror );
+          const KdeComplex weights = 0.5 * ( z + std::conj( zMirror ) );
+          const KdeComplex counts = multiply( halfI, z - std::conj( zMirror ) );
+          const KdeComplex kernelValues = 0.5 * ( kernel[ index ] + std::conj( kernel[ mirror ] ) );
+          const KdeComplex disc = multiply( halfI, kernel[ index ] - std::conj( kernel[ mirror ] ) );
+          const KdeComplex sums = multiply( weights, kernelValues );
+          const KdeComplex covered = multiply( counts, disc );
+          data[ index ] = KdeComplex( sums.real() - covered.imag(), sums.imag() + covered.real() );
+          data[ mirror ] = KdeComplex( sums.real() + covered.imag(), covered.real() - sums.imag() );
+        }
+      }
+      fft2d( data.data(), fftSize, twiddles.constData(), true, column.data() );
+
+      for ( int row = 0; row < blockRows; ++row )
+      {
+        for ( int col = 0; col < blockCols; ++col )
+        {
+          const KdeComplex &result = data.at( ( row + partSize - 1 ) * fftSize + col + partSize - 1 );
+          task.sums[ row * blockSize + col ] += result.real() * scale;
+          task.counts[ row * blockSize + col ] += result.imag() * scale;
+        }
+      }
+    }
+  };
+
+  // the blocks are aligned on the output tiles, the values of the pixels with bins within their radius are stored
+  auto storeBlock = [&]( const QgsKdeBlockTask & task ) -> Result
+  {
+    const int lastCol = std::min( mColumns, task.firstCol + blockSize ) - 1;
+    const int lastRow = std::min( mRows, task.firstRow + blockSize ) - 1;
+    for ( int tileRow = task.firstRow / KDE_TILE_SIZE; tileRow <= lastRow / KDE_TILE_SIZE; ++tileRow )
+    {
+      for ( int tileCol = task.firstCol / KDE_TILE_SIZE; tileCol <= lastCol / KDE_TILE_SIZE; ++tileCol )
+      {
+        const int tileFirstCol = tileCol * KDE_TILE_SIZE;
+        const int tileFirstRow = tileRow * KDE_TILE_SIZE;
+        const int tileCols = std::min( lastCol + 1 - tileFirstCol, KDE_TILE_SIZE );
+        const int tileRows = std::min( lastRow + 1 - tileFirstRow, KDE_TILE_SIZE );
+        bool covered = false;
+        for ( int row = 0; row < tileRows && !covered; ++row )
+        {
+          for ( int col = 0; col < tileCols && !covered; ++col )
+          {
+            // the convolved counts are the number of points within the radius of the pixel
+            covered = task.counts.at( ( tileFirstRow + row - task.firstRow ) * blockSize + tileFirstCol + col - task.firstCol ) > 0.5;
+          }
+        }
+        if ( !covered )
+          continue;
+
+        const int tileIndex = tileRow * mTileColumns + tileCol;
+        Result result = loadTiles( QVector< int >() << tileIndex );
+        if ( result != Success )
+          return result;
+
+        float *values = mTiles[ tileIndex ].data();
+        for ( int row = 0; row < tileRows; ++row )
+        {
+          for ( int col = 0; col < tileCols; ++col )
+          {
+            const int blockPos = ( tileFirstRow + row - task.firstRow ) * blockSize + tileFirstCol + col - task.firstCol;
+            if ( task.counts.at( blockPos ) > 0.5 )
+              values[ row * KDE_TILE_SIZE + col ] = task.sums.at( blockPos );
+          }
+        }
+      }
+    }
+    return Success;
+  };
+
+  // as many blocks as threads are calculated at once, their buffers being accounted in the memory limit
+  Result result = Success;
+  for ( int first = 0; first < tasks.size() && result == Success; first += threads )
+  {
+    QVector< QgsKdeBlockTask > batch = tasks.mid( first, threads );
+    QtConcurrent::blockingMap( batch, convolveBlock );
+    for ( int i = 0; i < batch.size() && result == Success; ++i )
+      result = storeBlock( batch.at( i ) );
+  }
+
+  mConvolutionBytes = 0;
   return result;
 }
 
-QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::finalise()
+QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::writeTiles()
 {
-  GDALClose( ( GDALDatasetH ) mDatasetH );
-  mDatasetH = nullptr;
-  mRasterBandH = nullptr;
-  return Success;
+  Result result = Success;
+  for ( int tileIndex = 0; tileIndex < mTiles.size(); ++tileIndex )
+  {
+    if ( mTiles.at( tileIndex ).isEmpty() )
+      continue;
+
+    if ( releaseTile( tileIndex ) != Success )
+      result = RasterIoError;
+  }
+  return result;
 }
 
 int QgsKernelDensityEstimation::radiusSizeInPixels( double radius ) const
@@ -18,6 +18,7 @@
 
 #include "qgsrectangle.h"
 #include <QString>
+#include <QVector>
 
 // GDAL includes
 #include <gdal.h>
@@ -34,6 +35,12 @@ class QgsFeature;
  * \class QgsKernelDensityEstimation
  * \ingroup analysis
  * Performs Kernel Density Estimation ("heatmap") calculations on a vector layer.
+ *
+ * The surface is accumulated in memory, in tiles of the output raster which are only allocated
+ * when a point contributes to them, and written to the output file by finalise(). The points are
+ * added to the tiles in batches, with the tiles calculated in parallel. When the tiles exceed
+ * Parameters::memoryLimit the least recently used ones are written to the output file, and read
+ * back when more points are added to them.
  * @note added in QGIS 3.0
  */
 class ANALYSIS_EXPORT QgsKernelDensityEstimation
@@ -93,6 +100,20 @@ class ANALYSIS_EXPORT QgsKernelDensityEstimation
 
       //! Type of output value
       OutputValues outputValues;
+
+      /**
+       * True to move the points to the center of their output pixel, and to calculate the surface by
+       * convolving the binned weights with the kernel. This is much faster for large numbers of points
+       * or large radiuses, but moves the points by up to half a pixel. Only used with a fixed radius.
+       */
+      bool binPoints = false;
+
+      /**
+       * Approximate limit of the memory used by the tiles, bins and convolution buffers kept in memory, in
+       * megabytes. When the bins of the binned mode would need more than half of it, the binned points are
+       * added one by one. The convolution of the bins uses at most half of the memory left by the bins.
+       */
+      int memoryLimit = 1024;
     };
 
     /**
@@ -131,6 +152,61 @@ class ANALYSIS_EXPORT QgsKernelDensityEstimation
 
   private:
 
+    //! Point waiting to be added to the output tiles
+    struct PendingPoint
+    {
+      double x;
+      double y;
+      double radius;
+      double weight;
+      //! Radius in pixels
+      int buffer;
+    };
+
+    //! Adds the pending points to the tiles they contribute to, in parallel over the tiles
+    Result addPendingPoints();
+
+    //! Adds the contribution of \a points, indices of pending points, to the \a values of the output tile \a tileIndex
+    void addPointsToTile( int tileIndex, float *values, const QVector< int > &points ) const;
+
+    /**
+     * Adds a point to the bins of the binned mode. Returns false if the bins would exceed their part
+     * of the memory limit, the point is not added then.
+     */
+    bool addBinnedPoint( double x, double y, double weight );
+
+    //! Adds the binned points as pending points at the center of their pixel and frees the bins
+    Result binsToPendingPoints();
+
+    /**
+     * Convolves the bins with the kernel and stores the result in the output tiles. The output is calculated
+     * by blocks, with FFTs sized for the radius within the memory limit, the kernel being split in parts
+     * when it does not fit in the FFT.
+     */
+    Result convolveBins();
+
+    //! Writes the tiles kept in memory to the raster
+    Result writeTiles();
+
+    //! Writes an output tile to the raster and frees it
+    Result releaseTile( int tileIndex );
+
+    /**
+     * Makes sure the output tiles \a tileIndices are in memory, reading them back from the raster if they
+     * were released or allocating them with nodata values, and releases the least recently used other
+     * tiles to stay within the memory limit.
+     */
+    Result loadTiles( const QVector< int > &tileIndices );
+
+    //! Number of output tiles which may be kept in memory at once
+    int maxLoadedTiles() const;
+
+    /**
+     * Runs \a function over the \a tasks in parallel, in groups of tasks whose output tiles fit in memory at once.
+     * The tasks need a tileIndex, and their values are set to the data of the output tile before running them.
+     */
+    template <typename Task, typename Function> Result runTileTasks( QVector< Task > &tasks, Function function );
+
     //! Calculate the value given to a point width a given distance for a specified kernel shape
     double calculateKernelValue( const double distance, const double bandwidth, const KernelShape shape, const OutputValues outputType ) const;
     //! Uniform kernel function
@@ -162,6 +238,36 @@ class ANALYSIS_EXPORT QgsKernelDensityEstimation
     OutputValues mOutputValues;
 
     int mBufferSize;
+    bool mBinPoints;
+    //! Memory limit, in bytes
+    qint64 mMemoryLimit;
+
+    //! Size of the output raster
+    int mColumns;
+    int mRows;
+    //! Number of tiles along x and y
+    int mTileColumns;
+    int mTileRows;
+
+    //! Values of the output tiles by rows of tiles, empty for the tiles without any point or released
+    QVector< QVector< float > > mTiles;
+    //! True for the tiles which have been written to the raster
+    QVector< bool > mTileWritten;
+    //! Value of mTileUseCounter when the tile was last used
+    QVector< quint64 > mTileLastUse;
+    quint64 mTileUseCounter;
+    int mLoadedTiles;
+
+    //! Points not yet added to mTiles
+    QVector< PendingPoint > mPendingPoints;
+
+    //! Sum of the weights of the points in each pixel in binned mode, in tiles like mTiles
+    QVector< QVector< double > > mBinWeights;
+    //! Number of points in each pixel in binned mode
+    QVector< QVector< int > > mBinCounts;
+    int mBinTiles;
+    //! Memory used by the convolution of the bins while it runs
+    qint64 mConvolutionBytes;
 
     GDALDatasetH mDatasetH;
     GDALRasterBandH mRasterBandH;
@@ -20,6 +20,28 @@
 #include "cpl_string.h"
 #include <QProgressDialog>
 #include <QFile>
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+
+///@cond PRIVATE
+
+//! Number of cells of the blocks of rows processed by a thread
+static const int NINE_CELL_BLOCK_CELLS = 1024 * 1024;
+
+//! Rows of the input raster and their results
+struct QgsNineCellFilterBlock
+{
+  int firstRow;
+  int rows;
+  //! Input rows from the row above the block to the row below it, with one more cell on each side
+  QVector< float > input;
+  QVector< float > output;
+};
+
+///@endcond
 
 QgsNineCellFilter::QgsNineCellFilter( const QString &inputFile, const QString &outputFile, const QString &outputFormat )
   : mInputFile( inputFile )
@@ -96,12 +118,27 @@ int QgsNineCellFilter::processRaster( QProgressDialog *p )
     return 6;
   }
 
-  //keep only three scanlines in memory at a time
-  float *scanLine1 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-  float *scanLine2 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-  float *scanLine3 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
+  // rows of a block, with as many cells as a block of 1024 x 1024
+  const int blockRows = std::max( 1, std::min( ySize, NINE_CELL_BLOCK_CELLS / xSize ) );
+  // input rows have one more cell on each side for the windows at the left and right border
+  const int inputWidth = xSize + 2;
 
-  float *resultLine = ( float * ) CPLMalloc( sizeof( float ) * xSize );
+  // one block per thread is in memory at a time
+  const bool parallel = canProcessInParallel();
+  const int batchSize = parallel ? std::max( 1, QThreadPool::globalInstance()->maxThreadCount() ) : 1;
+  QVector< QgsNineCellFilterBlock > batch;
+  batch.reserve( batchSize );
+
+  auto processBlock = [this, xSize, inputWidth]( QgsNineCellFilterBlock & block )
+  {
+    ScanLineBuffers buffers( xSize );
+    const float *input = block.input.constData() + 1;
+    for ( int row = 0; row < block.rows; ++row )
+    {
+      processScanLine( input + row * inputWidth, input + ( row + 1 ) * inputWidth, input + ( row + 2 ) * inputWidth,
+                       block.output.data() + row * xSize, xSize, buffers );
+    }
+  };
 
   if ( p )
   {
@@ -109,7 +146,7 @@ int QgsNineCellFilter::processRaster( QProgressDialog *p )
   }
 
   //values outside the layer extent (if the 3x3 window is on the border) are sent to the processing method as (input) nodata values
-  for ( int i = 0; i < ySize; ++i )
+  for ( int i = 0; i < ySize; )
   {
     if ( p )
     {
@@ -121,65 +158,45 @@ int QgsNineCellFilter::processRaster( QProgressDialog *p )
       break;
     }
 
-    if ( i == 0 )
+    //read the blocks of the batch with the rows above and below them, the datasets are only accessed in this thread
+    batch.clear();
+    for ( ; batch.size() < batchSize && i < ySize; i += blockRows )
     {
-      //fill scanline 1 with (input) nodata for the values above the first row and feed scanline2 with the first row
-      for ( int a = 0; a < xSize; ++a )
-      {
-        scanLine1[a] = mInputNodataValue;
-      }
-      if ( GDALRasterIO( rasterBand, GF_Read, 0, 0, xSize, 1, scanLine2, xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
+      QgsNineCellFilterBlock block;
+      block.firstRow = i;
+      block.rows = std::min( blockRows, ySize - i );
+      block.input.fill( mInputNodataValue, ( block.rows + 2 ) * inputWidth );
+      block.output.resize( block.rows * xSize );
+
+      const int firstInputRow = std::max( 0, i - 1 );
+      const int lastInputRow = std::min( ySize - 1, i + block.rows );
+      float *firstInputLine = block.input.data() + ( firstInputRow - i + 1 ) * inputWidth + 1;
+      if ( GDALRasterIO( rasterBand, GF_Read, 0, firstInputRow, xSize, lastInputRow - firstInputRow + 1, firstInputLine,
+                         xSize, lastInputRow - firstInputRow + 1, GDT_Float32, 0, inputWidth * static_cast< int >( sizeof( float ) ) ) != CE_None )
       {
         QgsDebugMsg( "Raster IO Error" );
       }
-    }
-    else
-    {
-      //normally fetch only scanLine3 and release scanline 1 if we move forward one row
-      CPLFree( scanLine1 );
-      scanLine1 = scanLine2;
-      scanLine2 = scanLine3;
-      scanLine3 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
+      batch << block;
     }
 
-    if ( i == ySize - 1 ) //fill the row below the bottom with nodata values
+    if ( parallel )
     {
-      for ( int a = 0; a < xSize; ++a )
-      {
-        scanLine3[a] = mInputNodataValue;
-      }
+      QtConcurrent::blockingMap( batch, processBlock );
     }
     else
     {
-      if ( GDALRasterIO( rasterBand, GF_Read, 0, i + 1, xSize, 1, scanLine3, xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
-      {
-        QgsDebugMsg( "Raster IO Error" );
-      }
+      for ( QgsNineCellFilterBlock &block : batch )
+        processBlock( block );
     }
 
-    for ( int j = 0; j < xSize; ++j )
+    for ( const QgsNineCellFilterBlock &block : batch )
     {
-      if ( j == 0 )
-      {
-        resultLine[j] = processNineCellWindow( &mInputNodataValue, &scanLine1[j], &scanLine1[j + 1], &mInputNodataValue, &scanLine2[j],
-                                               &scanLine2[j + 1], &mInputNodataValue, &scanLine3[j], &scanLine3[j + 1] );
-      }
-      else if ( j == xSize - 1 )
+      if ( GDALRasterIO( outputRasterBand, GF_Write, 0, block.firstRow, xSize, block.rows, const_cast< float * >( block.output.constData() ),
+                         xSize, block.rows, GDT_Float32, 0, 0 ) != CE_None )
       {
-        resultLine[j] = processNineCellWindow( &scanLine1[j - 1], &scanLine1[j], &mInputNodataValue, &scanLine2[j - 1], &scanLine2[j],
-                                               &mInputNodataValue, &scanLine3[j - 1], &scanLine3[j], &mInputNodataValue );
-      }
-      else
-      {
-        resultLine[j] = processNineCellWindow( &scanLine1[j - 1], &scanLine1[j], &scanLine1[j + 1], &scanLine2[j - 1], &scanLine2[j],
-                                               &scanLine2[j + 1], &scanLine3[j - 1], &scanLine3[j], &scanLine3[j + 1] );
+        QgsDebugMsg( "Raster IO Error" );
       }
     }
-
-    if ( GDALRasterIO( outputRasterBand, GF_Write, 0, i, xSize, 1, resultLine, xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
-    {
-      QgsDebugMsg( "Raster IO Error" );
-    }
   }
 
   if ( p )
@@ -187,11 +204,6 @@ int QgsNineCellFilter::processRaster( QProgressDialog *p )
     p->setValue( ySize );
   }
 
-  CPLFree( resultLine );
-  CPLFree( scanLine1 );
-  CPLFree( scanLine2 );
-  CPLFree( scanLine3 );
-
   GDALClose( inputDataset );
 
   if ( p && p->wasCanceled() )
@@ -205,6 +217,20 @@ int QgsNineCellFilter::processRaster( QProgressDialog *p )
   return 0;
 }
 
+void QgsNineCellFilter::processScanLine( const float *scanLine1, const float *scanLine2, const float *scanLine3, float *resultLine, int width, ScanLineBuffers &buffers )
+{
+  Q_UNUSED( buffers );
+  // processNineCellWindow() takes non const pointers, but does not modify the values
+  float *line1 = const_cast< float * >( scanLine1 );
+  float *line2 = const_cast< float * >( scanLine2 );
+  float *line3 = const_cast< float * >( scanLine3 );
+  for ( int j = 0; j < width; ++j )
+  {
+    resultLine[j] = processNineCellWindow( &line1[j - 1], &line1[j], &line1[j + 1], &line2[j - 1], &line2[j],
+                                           &line2[j + 1], &line3[j - 1], &line3[j], &line3[j + 1] );
+  }
+}
+
 GDALDatasetH QgsNineCellFilter::openInputFile( int &nCellsX, int &nCellsY )
 {
   GDALDatasetH inputDataset = GDALOpen( mInputFile.toUtf8().constData(), GA_ReadOnly );
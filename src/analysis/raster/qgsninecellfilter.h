@@ -19,6 +19,7 @@
 #define QGSNINECELLFILTER_H
 
 #include <QString>
+#include <QVector>
 #include "gdal.h"
 #include "qgis_analysis.h"
 
@@ -27,7 +28,10 @@ class QProgressDialog;
 /** \ingroup analysis
  * Base class for raster analysis methods that work with a 3x3 cell filter and calculate the value of each cell based on
 the cell value and the eight neighbour cells. Common examples are slope and aspect calculation in DEMs. Subclasses only implement
-the method that calculates the new value from the nine values. Everything else (reading file, writing file) is done by this subclass*/
+the method that calculates the new value from the nine values. Everything else (reading file, writing file) is done by this subclass.
+
+The raster is processed in blocks of rows, which are read with the row above and below them and calculated,
+in parallel on the global thread pool for the subclasses whose canProcessInParallel() returns true, then written in order*/
 
 class ANALYSIS_EXPORT QgsNineCellFilter
 {
@@ -55,11 +59,57 @@ class ANALYSIS_EXPORT QgsNineCellFilter
     void setOutputNodataValue( double value ) { mOutputNodataValue = value; }
 
     /** Calculates output value from nine input values. The input values and the output value can be equal to the
-      nodata value if not present or outside of the border. Must be implemented by subclasses*/
+      nodata value if not present or outside of the border. Must be implemented by subclasses.
+      It is only called from several threads at once if canProcessInParallel() returns true, it must then not modify the filter.*/
     virtual float processNineCellWindow( float *x11, float *x21, float *x31,
                                          float *x12, float *x22, float *x32,
                                          float *x13, float *x23, float *x33 ) = 0;
 
+    /**
+     * Scratch buffers of processScanLine() with room for the values of a scan line, which are
+     * allocated once per block of rows instead of once per scan line.
+     * \note not available in Python bindings
+     * \note added in QGIS 3.0
+     */
+    struct ScanLineBuffers
+    {
+      //! Allocates the buffers for scan lines of \a width cells
+      explicit ScanLineBuffers( int width )
+        : floats1( width )
+        , floats2( width )
+        , doubles( width )
+      {}
+
+      QVector< float > floats1;
+      QVector< float > floats2;
+      QVector< double > doubles;
+    };
+
+    /**
+     * Calculates the output values of a scan line of \a width cells from the input scan line \a scanLine2
+     * and the scan lines above and below it, \a scanLine1 and \a scanLine3. The input scan lines have one
+     * more cell on each side, at index -1 and \a width, which is the input nodata value at the border of the
+     * raster. The default implementation calls processNineCellWindow() for each cell, subclasses reimplement
+     * it with a loop over the cells which the compiler can inline and vectorize. The \a buffers may be
+     * used for intermediate values, their content is undefined when the method is called.
+     *
+     * If canProcessInParallel() returns true, this method is called for different scan lines from several
+     * threads at once, it must then not modify the filter.
+     * \note not available in Python bindings
+     * \note added in QGIS 3.0
+     */
+    virtual void processScanLine( const float *scanLine1, const float *scanLine2, const float *scanLine3,
+                                  float *resultLine, int width, ScanLineBuffers &buffers );
+
+    /**
+     * Returns true if processScanLine() may be called for different scan lines from several threads at once.
+     * The default implementation returns false, the rows are then calculated by the calling thread only, as
+     * processNineCellWindow() of subclasses which do not reimplement this method may not be reentrant.
+     * \note not available in Python bindings
+     * \note added in QGIS 3.0
+     */
+    virtual bool canProcessInParallel() const { return false; }
+
   private:
     //default constructor forbidden. We need input file, output file and format obligatory
     QgsNineCellFilter();
@@ -15,8 +15,18 @@
 #include "qgsrastercalcnode.h"
 #include "qgsrasterblock.h"
 #include "qgsrastermatrix.h"
+#include <QVector>
+#include <algorithm>
 #include <cfloat>
 
+///@cond PRIVATE
+
+//! Number of cells evaluated at once by a single pass calculation, small enough for
+//! the intermediate results of a whole tree to stay in the processor cache
+static const int FUSED_CHUNK_SIZE = 512;
+
+///@endcond
+
 QgsRasterCalcNode::QgsRasterCalcNode()
   : mType( tNumber )
   , mLeft( nullptr )
@@ -85,6 +95,25 @@ QgsRasterCalcNode::~QgsRasterCalcNode()
 
 bool QgsRasterCalcNode::calculate( QMap<QString, QgsRasterBlock * > &rasterData, QgsRasterMatrix &result, int row ) const
 {
+  int nChunkCols = -1;
+  int nChunkRows = -1;
+  int bufferCount = 0;
+  if ( mType == tOperator && canCalculateChunks( rasterData, nChunkCols, nChunkRows, bufferCount ) && nChunkCols >= 0 )
+  {
+    const int startCell = row >= 0 ? row * nChunkCols : 0;
+    const int nRows = row >= 0 ? 1 : nChunkRows;
+    const int nEntries = nChunkCols * nRows;
+    double *data = new double[nEntries];
+    QVector< double > buffers( std::max( 1, bufferCount ) * FUSED_CHUNK_SIZE );
+    for ( int offset = 0; offset < nEntries; offset += FUSED_CHUNK_SIZE )
+    {
+      calculateChunk( rasterData, startCell + offset, std::min( FUSED_CHUNK_SIZE, nEntries - offset ), result.nodataValue(),
+                      data + offset, buffers.data() );
+    }
+    result.setData( nChunkCols, nRows, data, result.nodataValue() );
+    return true;
+  }
+
   //if type is raster ref: return a copy of the corresponding matrix
 
   //if type is operator, call the proper matrix operations
@@ -231,6 +260,197 @@ bool QgsRasterCalcNode::calculate( QMap<QString, QgsRasterBlock * > &rasterData,
   return false;
 }
 
+bool QgsRasterCalcNode::canCalculateChunks( const QMap<QString, QgsRasterBlock *> &rasterData, int &nCols, int &nRows, int &bufferCount ) const
+{
+  switch ( mType )
+  {
+    case tNumber:
+      bufferCount = 0;
+      return true;
+
+    case tRasterRef:
+    {
+      QgsRasterBlock *block = rasterData.value( mRasterName );
+      if ( !block )
+        return false;
+
+      if ( nCols < 0 )
+      {
+        nCols = block->width();
+        nRows = block->height();
+      }
+      else if ( block->width() != nCols || block->height() != nRows )
+      {
+        return false;
+      }
+      bufferCount = 0;
+      return true;
+    }
+
+    case tOperator:
+    {
+      bool unary = false;
+      switch ( mOperator )
+      {
+        case opSQRT:
+        case opSIN:
+        case opCOS:
+        case opTAN:
+        case opASIN:
+        case opACOS:
+        case opATAN:
+        case opSIGN:
+        case opLOG:
+        case opLOG10:
+          unary = true;
+          break;
+        default:
+          break;
+      }
+      if ( mOperator == opNONE || !mLeft || ( !unary && !mRight ) )
+        return false;
+
+      int leftCount = 0;
+      int rightCount = 0;
+      if ( !mLeft->canCalculateChunks( rasterData, nCols, nRows, leftCount ) )
+        return false;
+      if ( !unary && !mRight->canCalculateChunks( rasterData, nCols, nRows, rightCount ) )
+        return false;
+
+      // the left operand is evaluated in the result, the right one in the first buffer
+      bufferCount = unary ? leftCount : std::max( leftCount, rightCount + 1 );
+      return true;
+    }
+
+    case tMatrix:
+      break;
+  }
+  return false;
+}
+
+void QgsRasterCalcNode::calculateChunk( const QMap<QString, QgsRasterBlock *> &rasterData, int start, int count, double nodataValue,
+                                        double *result, double *buffers ) const
+{
+  if ( mType == tNumber )
+  {
+    std::fill( result, result + count, mNumber );
+    return;
+  }
+
+  if ( mType == tRasterRef )
+  {
+    //convert input raster values to double, also convert input no data to result no data
+    QgsRasterBlock *block = rasterData.value( mRasterName );
+    for ( int i = 0; i < count; ++i )
+    {
+      const qgssize index = static_cast< qgssize >( start + i );
+      result[i] = block->isNoData( index ) ? nodataValue : block->value( index );
+    }
+    return;
+  }
+
+  mLeft->calculateChunk( rasterData, start, count, nodataValue, result, buffers );
+
+  QgsRasterMatrix::OneArgOperator oneArgOperator = QgsRasterMatrix::opSQRT;
+  switch ( mOperator )
+  {
+    case opPLUS:
+    case opMINUS:
+    case opMUL:
+    case opDIV:
+    case opPOW:
+    case opEQ:
+    case opNE:
+    case opGT:
+    case opLT:
+    case opGE:
+    case opLE:
+    case opAND:
+    case opOR:
+    {
+      QgsRasterMatrix::TwoArgOperator twoArgOperator = QgsRasterMatrix::opPLUS;
+      switch ( mOperator )
+      {
+        case opMINUS:
+          twoArgOperator = QgsRasterMatrix::opMINUS;
+          break;
+        case opMUL:
+          twoArgOperator = QgsRasterMatrix::opMUL;
+          break;
+        case opDIV:
+          twoArgOperator = QgsRasterMatrix::opDIV;
+          break;
+        case opPOW:
+          twoArgOperator = QgsRasterMatrix::opPOW;
+          break;
+        case opEQ:
+          twoArgOperator = QgsRasterMatrix::opEQ;
+          break;
+        case opNE:
+          twoArgOperator = QgsRasterMatrix::opNE;
+          break;
+        case opGT:
+          twoArgOperator = QgsRasterMatrix::opGT;
+          break;
+        case opLT:
+          twoArgOperator = QgsRasterMatrix::opLT;
+          break;
+        case opGE:
+          twoArgOperator = QgsRasterMatrix::opGE;
+          break;
+        case opLE:
+          twoArgOperator = QgsRasterMatrix::opLE;
+          break;
+        case opAND:
+          twoArgOperator = QgsRasterMatrix::opAND;
+          break;
+        case opOR:
+          twoArgOperator = QgsRasterMatrix::opOR;
+          break;
+        default:
+          break;
+      }
+      mRight->calculateChunk( rasterData, start, count, nodataValue, buffers, buffers + FUSED_CHUNK_SIZE );
+      QgsRasterMatrix::applyTwoArgumentOperator( twoArgOperator, result, buffers, result, count, nodataValue );
+      return;
+    }
+
+    case opSQRT:
+      oneArgOperator = QgsRasterMatrix::opSQRT;
+      break;
+    case opSIN:
+      oneArgOperator = QgsRasterMatrix::opSIN;
+      break;
+    case opCOS:
+      oneArgOperator = QgsRasterMatrix::opCOS;
+      break;
+    case opTAN:
+      oneArgOperator = QgsRasterMatrix::opTAN;
+      break;
+    case opASIN:
+      oneArgOperator = QgsRasterMatrix::opASIN;
+      break;
+    case opACOS:
+      oneArgOperator = QgsRasterMatrix::opACOS;
+      break;
+    case opATAN:
+      oneArgOperator = QgsRasterMatrix::opATAN;
+      break;
+    case opSIGN:
+      oneArgOperator = QgsRasterMatrix::opSIGN;
+      break;
+    case opLOG:
+      oneArgOperator = QgsRasterMatrix::opLOG;
+      break;
+    case opLOG10:
+      oneArgOperator = QgsRasterMatrix::opLOG10;
+      break;
+    case opNONE:
+      return;
+  }
+  QgsRasterMatrix::applyOneArgumentOperator( oneArgOperator, result, result, count, nodataValue );
+}
+
 QgsRasterCalcNode *QgsRasterCalcNode::parseRasterCalcString( const QString &str, QString &parserErrorMsg )
 {
   extern QgsRasterCalcNode *localParseRasterCalcString( const QString & str, QString & parserErrorMsg );
@@ -89,6 +89,10 @@ class ANALYSIS_EXPORT QgsRasterCalcNode
     void setRight( QgsRasterCalcNode *right ) { delete mRight; mRight = right; }
 
     /** Calculates result of raster calculation (might be real matrix or single number).
+     *
+     * Trees of operators, numbers and raster references are evaluated in a single pass over
+     * the cells, a chunk of cells at a time, without allocating an intermediate matrix for
+     * every node. Other trees are evaluated node by node.
      * @param rasterData input raster data references, map of raster name to raster data block
      * @param result destination raster matrix for calculation results
      * @param row optional row number to calculate for calculating result by rows, or -1 to
@@ -101,6 +105,20 @@ class ANALYSIS_EXPORT QgsRasterCalcNode
     static QgsRasterCalcNode *parseRasterCalcString( const QString &str, QString &parserErrorMsg );
 
   private:
+
+    /** Returns true if the tree can be evaluated a chunk of cells at a time by calculateChunk(),
+     * that is if it only has operators, numbers and references to blocks of \a rasterData, with
+     * at least one block and all of the same size. \a nCols and \a nRows receive the block size,
+     * \a bufferCount the number of chunk buffers needed by calculateChunk().
+     */
+    bool canCalculateChunks( const QMap<QString, QgsRasterBlock * > &rasterData, int &nCols, int &nRows, int &bufferCount ) const;
+
+    /** Evaluates the \a count cells of the blocks starting at cell \a start into \a result.
+     * \a buffers holds the chunk buffers used for the intermediate results of the tree.
+     */
+    void calculateChunk( const QMap<QString, QgsRasterBlock * > &rasterData, int start, int count, double nodataValue,
+                         double *result, double *buffers ) const;
+
     Type mType;
     QgsRasterCalcNode *mLeft = nullptr;
     QgsRasterCalcNode *mRight = nullptr;
@@ -19,12 +19,19 @@
 #include "qgsrastercalcnode.h"
 #include "qgsrasterdataprovider.h"
 #include "qgsrasterinterface.h"
+#include "qgsrasteriterator.h"
 #include "qgsrasterlayer.h"
 #include "qgsrastermatrix.h"
 #include "qgsrasterprojector.h"
 
 #include <QProgressDialog>
 #include <QFile>
+#include <QThreadPool>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 #include <cpl_string.h>
 #include <gdalwarper.h>
@@ -67,17 +74,26 @@ int QgsRasterCalculator::processCalculation( QProgressDialog *p )
     return static_cast<int>( ParserError );
   }
 
-  QMap< QString, QgsRasterBlock * > inputBlocks;
   QVector<QgsRasterCalculatorEntry>::const_iterator it = mRasterEntries.constBegin();
   for ( ; it != mRasterEntries.constEnd(); ++it )
   {
     if ( !it->raster ) // no raster layer in entry
     {
       delete calcNode;
-      qDeleteAll( inputBlocks );
       return static_cast< int >( InputLayerError );
     }
+  }
+
+  if ( mTiledProcessing )
+  {
+    int result = processCalculationTiled( *calcNode, p );
+    delete calcNode;
+    return result;
+  }
 
+  QMap< QString, QgsRasterBlock * > inputBlocks;
+  for ( it = mRasterEntries.constBegin(); it != mRasterEntries.constEnd(); ++it )
+  {
     QgsRasterBlock *block = nullptr;
     // if crs transform needed
     if ( it->raster->crs() != mOutputCrs )
@@ -186,6 +202,205 @@ QgsRasterCalculator::QgsRasterCalculator()
 {
 }
 
+void QgsRasterCalculator::setTileSize( int width, int height )
+{
+  mTileWidth = std::max( 1, width );
+  mTileHeight = std::max( 1, height );
+}
+
+///@cond PRIVATE
+
+//! Input blocks and result of one tile of the output raster
+struct QgsRasterCalculatorTile
+{
+  int topLeftCol;
+  int topLeftRow;
+  int nCols;
+  int nRows;
+  QMap< QString, QgsRasterBlock * > inputBlocks;
+  bool calculated;
+  QVector< float > result;
+};
+
+///@endcond
+
+int QgsRasterCalculator::processCalculationTiled( const QgsRasterCalcNode &calcNode, QProgressDialog *p )
+{
+  //open output dataset for writing, before the reads of the inputs are started
+  GDALDriverH outputDriver = openOutputDriver();
+  if ( !outputDriver )
+  {
+    return static_cast< int >( CreateOutputError );
+  }
+
+  GDALDatasetH outputDataset = openOutputFile( outputDriver );
+  if ( !outputDataset )
+  {
+    return static_cast< int >( CreateOutputError );
+  }
+  GDALSetProjection( outputDataset, mOutputCrs.toWkt().toLocal8Bit().data() );
+  GDALRasterBandH outputRasterBand = GDALGetRasterBand( outputDataset, 1 );
+
+  float outputNodataValue = -FLT_MAX;
+  GDALSetRasterNoDataValue( outputRasterBand, outputNodataValue );
+
+  // the inputs are read in the calling thread, as providers cannot be shared between threads
+  std::vector< std::unique_ptr< QgsRasterProjector > > projectors;
+  std::vector< std::unique_ptr< QgsRasterIterator > > iterators;
+  for ( const QgsRasterCalculatorEntry &entry : mRasterEntries )
+  {
+    QgsRasterInterface *input = entry.raster->dataProvider();
+    // if crs transform needed
+    if ( entry.raster->crs() != mOutputCrs )
+    {
+      QgsRasterProjector *proj = new QgsRasterProjector();
+      proj->setCrs( entry.raster->crs(), mOutputCrs );
+      proj->setInput( input );
+      proj->setPrecision( QgsRasterProjector::Exact );
+      projectors.emplace_back( proj );
+      input = proj;
+    }
+
+    QgsRasterIterator *iterator = new QgsRasterIterator( input );
+    // all the inputs must be split in the same tiles
+    iterator->setMaximumTileWidth( mTileWidth );
+    iterator->setMaximumTileHeight( mTileHeight );
+    iterator->startRasterRead( entry.bandNumber, mNumOutputColumns, mNumOutputRows, mOutputRectangle );
+    iterators.emplace_back( iterator );
+  }
+
+  // tiles are produced row by row, in the order of QgsRasterIterator
+  const int tileColumns = ( mNumOutputColumns + mTileWidth - 1 ) / mTileWidth;
+  const int tileRows = ( mNumOutputRows + mTileHeight - 1 ) / mTileHeight;
+  const int tileCount = tileColumns * tileRows;
+
+  if ( p )
+  {
+    p->setMaximum( tileCount );
+  }
+
+  // one tile per thread is in memory at a time
+  const int batchSize = std::max( 1, QThreadPool::globalInstance()->maxThreadCount() );
+  QVector< QgsRasterCalculatorTile > batch;
+  batch.reserve( batchSize );
+
+  auto calculateTile = [&calcNode, outputNodataValue]( QgsRasterCalculatorTile & tile )
+  {
+    QgsRasterMatrix resultMatrix;
+    resultMatrix.setNodataValue( outputNodataValue );
+    tile.calculated = calcNode.calculate( tile.inputBlocks, resultMatrix );
+    if ( !tile.calculated )
+      return;
+
+    const int size = tile.nCols * tile.nRows;
+    tile.result.resize( size );
+    float *calcData = tile.result.data();
+    if ( resultMatrix.isNumber() )
+    {
+      std::fill( calcData, calcData + size, static_cast< float >( resultMatrix.number() ) );
+    }
+    else
+    {
+      const double *data = resultMatrix.data();
+      for ( int i = 0; i < size; ++i )
+      {
+        calcData[i] = static_cast< float >( data[i] );
+      }
+    }
+  };
+
+  Result result = Success;
+  for ( int tileIndex = 0; tileIndex < tileCount && result == Success; )
+  {
+    if ( p )
+    {
+      p->setValue( tileIndex );
+    }
+
+    if ( p && p->wasCanceled() )
+    {
+      result = Canceled;
+      break;
+    }
+
+    // read the input tiles of the batch
+    batch.clear();
+    for ( ; batch.size() < batchSize && tileIndex < tileCount && result == Success; ++tileIndex )
+    {
+      QgsRasterCalculatorTile tile;
+      tile.topLeftCol = ( tileIndex % tileColumns ) * mTileWidth;
+      tile.topLeftRow = ( tileIndex / tileColumns ) * mTileHeight;
+      tile.nCols = std::min( mTileWidth, mNumOutputColumns - tile.topLeftCol );
+      tile.nRows = std::min( mTileHeight, mNumOutputRows - tile.topLeftRow );
+      tile.calculated = false;
+
+      for ( int i = 0; i < mRasterEntries.size(); ++i )
+      {
+        int nCols = 0;
+        int nRows = 0;
+        int topLeftCol = 0;
+        int topLeftRow = 0;
+        QgsRasterBlock *block = nullptr;
+        if ( !iterators[i]->readNextRasterPart( mRasterEntries.at( i ).bandNumber, nCols, nRows, &block, topLeftCol, topLeftRow )
+             || !block || block->isEmpty() || topLeftCol != tile.topLeftCol || topLeftRow != tile.topLeftRow )
+        {
+          delete block;
+          result = MemoryError;
+          break;
+        }
+        // a band used twice in the formula is only referenced once
+        delete tile.inputBlocks.value( mRasterEntries.at( i ).ref );
+        tile.inputBlocks.insert( mRasterEntries.at( i ).ref, block );
+      }
+      batch << tile;
+    }
+
+    if ( result == Success )
+    {
+      QtConcurrent::blockingMap( batch, calculateTile );
+
+      //write the tiles in order
+      for ( const QgsRasterCalculatorTile &tile : batch )
+      {
+        if ( !tile.calculated )
+          continue;
+
+        if ( GDALRasterIO( outputRasterBand, GF_Write, tile.topLeftCol, tile.topLeftRow, tile.nCols, tile.nRows,
+                           const_cast< float * >( tile.result.constData() ), tile.nCols, tile.nRows, GDT_Float32, 0, 0 ) != CE_None )
+        {
+          QgsDebugMsg( "RasterIO error!" );
+        }
+      }
+    }
+
+    for ( const QgsRasterCalculatorTile &tile : batch )
+    {
+      qDeleteAll( tile.inputBlocks );
+    }
+    batch.clear();
+  }
+
+  for ( int i = 0; i < mRasterEntries.size(); ++i )
+  {
+    iterators[i]->stopRasterRead( mRasterEntries.at( i ).bandNumber );
+  }
+
+  if ( p )
+  {
+    p->setValue( tileCount );
+  }
+
+  if ( result != Success )
+  {
+    //delete the dataset without closing (because it is faster)
+    GDALDeleteDataset( outputDriver, mOutputFile.toUtf8().constData() );
+    return static_cast< int >( result );
+  }
+  GDALClose( outputDataset );
+
+  return static_cast< int >( Success );
+}
+
 GDALDriverH QgsRasterCalculator::openOutputDriver()
 {
   char **driverMetadata = nullptr;
@@ -25,6 +25,7 @@
 #include "gdal.h"
 #include "qgis_analysis.h"
 
+class QgsRasterCalcNode;
 class QgsRasterLayer;
 class QProgressDialog;
 
@@ -85,6 +86,42 @@ class ANALYSIS_EXPORT QgsRasterCalculator
     //TODO QGIS 3.0 - return QgsRasterCalculator::Result
     int processCalculation( QProgressDialog *p = nullptr );
 
+    /** Sets whether the result is calculated tile by tile. In tiled mode, the tiles of the inputs
+     * are streamed through QgsRasterIterator, the formula is evaluated for several tiles at once
+     * on the global thread pool and the results are written in order, so that the memory used is
+     * bounded by the tile size and the number of threads. Otherwise every input is read over the
+     * whole output extent before calculating anything. Tiled processing is enabled by default.
+     * @see tiledProcessing()
+     * @see setTileSize()
+     * @note added in QGIS 3.0
+     */
+    void setTiledProcessing( bool tiled ) { mTiledProcessing = tiled; }
+
+    /** Returns true if the result is calculated tile by tile.
+     * @see setTiledProcessing()
+     * @note added in QGIS 3.0
+     */
+    bool tiledProcessing() const { return mTiledProcessing; }
+
+    /** Sets the maximum size in pixels of the tiles used in tiled mode.
+     * @see tileWidth()
+     * @see tileHeight()
+     * @note added in QGIS 3.0
+     */
+    void setTileSize( int width, int height );
+
+    /** Returns the maximum width in pixels of the tiles used in tiled mode.
+     * @see setTileSize()
+     * @note added in QGIS 3.0
+     */
+    int tileWidth() const { return mTileWidth; }
+
+    /** Returns the maximum height in pixels of the tiles used in tiled mode.
+     * @see setTileSize()
+     * @note added in QGIS 3.0
+     */
+    int tileHeight() const { return mTileHeight; }
+
   private:
     //default constructor forbidden. We need formula, output file, output format and output raster resolution obligatory
     QgsRasterCalculator();
@@ -101,6 +138,10 @@ class ANALYSIS_EXPORT QgsRasterCalculator
       @param transform double[6] array that receives the GDAL parameters*/
     void outputGeoTransform( double *transform ) const;
 
+    /** Calculates and writes the result tile by tile
+      @return a QgsRasterCalculator::Result value*/
+    int processCalculationTiled( const QgsRasterCalcNode &calcNode, QProgressDialog *p );
+
     QString mFormulaString;
     QString mOutputFile;
     QString mOutputFormat;
@@ -116,6 +157,10 @@ class ANALYSIS_EXPORT QgsRasterCalculator
 
     /***/
     QVector<QgsRasterCalculatorEntry> mRasterEntries;
+
+    bool mTiledProcessing = true;
+    int mTileWidth = 1024;
+    int mTileHeight = 1024;
 };
 
 #endif // QGSRASTERCALCULATOR_H
@@ -16,6 +16,7 @@
  ***************************************************************************/
 
 #include "qgsrastermatrix.h"
+#include <cmath>
 #include <cstring>
 #include <qmath.h>
 
@@ -200,69 +201,7 @@ bool QgsRasterMatrix::oneArgumentOperation( OneArgOperator op )
     return false;
   }
 
-  int nEntries = mColumns * mRows;
-  double value;
-  for ( int i = 0; i < nEntries; ++i )
-  {
-    value = mData[i];
-    if ( value != mNodataValue )
-    {
-      switch ( op )
-      {
-        case opSQRT:
-          if ( value < 0 ) //no complex numbers
-          {
-            mData[i] = mNodataValue;
-          }
-          else
-          {
-            mData[i] = sqrt( value );
-          }
-          break;
-        case opSIN:
-          mData[i] = sin( value );
-          break;
-        case opCOS:
-          mData[i] = cos( value );
-          break;
-        case opTAN:
-          mData[i] = tan( value );
-          break;
-        case opASIN:
-          mData[i] = asin( value );
-          break;
-        case opACOS:
-          mData[i] = acos( value );
-          break;
-        case opATAN:
-          mData[i] = atan( value );
-          break;
-        case opSIGN:
-          mData[i] = -value;
-          break;
-        case opLOG:
-          if ( value <= 0 )
-          {
-            mData[i] = mNodataValue;
-          }
-          else
-          {
-            mData[i] = ::log( value );
-          }
-          break;
-        case opLOG10:
-          if ( value <= 0 )
-          {
-            mData[i] = mNodataValue;
-          }
-          else
-          {
-            mData[i] = ::log10( value );
-          }
-          break;
-      }
-    }
-  }
+  applyOneArgumentOperator( op, mData, mData, mColumns * mRows, mNodataValue );
   return true;
 }
 
@@ -333,6 +272,12 @@ bool QgsRasterMatrix::twoArgumentOperation( TwoArgOperator op, const QgsRasterMa
   //two matrices
   if ( !isNumber() && !other.isNumber() )
   {
+    if ( other.mNodataValue == mNodataValue )
+    {
+      applyTwoArgumentOperator( op, mData, other.mData, mData, mColumns * mRows, mNodataValue );
+      return true;
+    }
+
     double *matrix = other.mData;
     int nEntries = mColumns * mRows;
     double value1, value2;
@@ -421,3 +366,141 @@ bool QgsRasterMatrix::testPowerValidity( double base, double power ) const
   }
   return true;
 }
+
+///@cond PRIVATE
+
+/*
+ * The kernels compute the operator for every value, including the nodata and invalid ones,
+ * and only then select the nodata value, so that the loops have no branch and can be vectorized.
+ */
+
+template <typename Operator>
+static void twoArgumentKernel( const double *left, const double *right, double *result, int count, double nodataValue, Operator op )
+{
+  for ( int i = 0; i < count; ++i )
+  {
+    const double value1 = left[i];
+    const double value2 = right[i];
+    const double value = op( value1, value2 );
+    result[i] = ( value1 == nodataValue || value2 == nodataValue ) ? nodataValue : value;
+  }
+}
+
+template <typename Operator>
+static void oneArgumentKernel( const double *values, double *result, int count, double nodataValue, Operator op )
+{
+  for ( int i = 0; i < count; ++i )
+  {
+    const double value = values[i];
+    const double calculated = op( value );
+    result[i] = value == nodataValue ? nodataValue : calculated;
+  }
+}
+
+///@endcond
+
+void QgsRasterMatrix::applyTwoArgumentOperator( TwoArgOperator op, const double *left, const double *right, double *result, int count, double nodataValue )
+{
+  switch ( op )
+  {
+    case opPLUS:
+      twoArgumentKernel( left, right, result, count, nodataValue, []( double a, double b ) { return a + b; } );
+      break;
+    case opMINUS:
+      twoArgumentKernel( left, right, result, count, nodataValue, []( double a, double b ) { return a - b; } );
+      break;
+    case opMUL:
+      twoArgumentKernel( left, right, result, count, nodataValue, []( double a, double b ) { return a * b; } );
+      break;
+    case opDIV:
+      twoArgumentKernel( left, right, result, count, nodataValue, [nodataValue]( double a, double b )
+      {
+        const double quotient = a / b;
+        return b == 0 ? nodataValue : quotient;
+      } );
+      break;
+    case opPOW:
+      twoArgumentKernel( left, right, result, count, nodataValue, [nodataValue]( double a, double b )
+      {
+        // same validity test as testPowerValidity()
+        const double power = std::pow( a, b );
+        const bool invalid = ( a == 0 && b < 0 ) || ( a < 0 && ( b - std::floor( b ) ) > 0 );
+        return invalid ? nodataValue : power;
+      } );
+      break;
+    case opEQ:
+      twoArgumentKernel( left, right, result, count, nodataValue, []( double a, double b ) { return a == b ? 1.0 : 0.0; } );
+      break;
+    case opNE:
+      twoArgumentKernel( left, right, result, count, nodataValue, []( double a, double b ) { return a == b ? 0.0 : 1.0; } );
+      break;
+    case opGT:
+      twoArgumentKernel( left, right, result, count, nodataValue, []( double a, double b ) { return a > b ? 1.0 : 0.0; } );
+      break;
+    case opLT:
+      twoArgumentKernel( left, right, result, count, nodataValue, []( double a, double b ) { return a < b ? 1.0 : 0.0; } );
+      break;
+    case opGE:
+      twoArgumentKernel( left, right, result, count, nodataValue, []( double a, double b ) { return a >= b ? 1.0 : 0.0; } );
+      break;
+    case opLE:
+      twoArgumentKernel( left, right, result, count, nodataValue, []( double a, double b ) { return a <= b ? 1.0 : 0.0; } );
+      break;
+    case opAND:
+      twoArgumentKernel( left, right, result, count, nodataValue, []( double a, double b ) { return ( a != 0 ) & ( b != 0 ) ? 1.0 : 0.0; } );
+      break;
+    case opOR:
+      twoArgumentKernel( left, right, result, count, nodataValue, []( double a, double b ) { return ( a != 0 ) | ( b != 0 ) ? 1.0 : 0.0; } );
+      break;
+  }
+}
+
+void QgsRasterMatrix::applyOneArgumentOperator( OneArgOperator op, const double *values, double *result, int count, double nodataValue )
+{
+  switch ( op )
+  {
+    case opSQRT:
+      oneArgumentKernel( values, result, count, nodataValue, [nodataValue]( double v )
+      {
+        //no complex numbers
+        const double root = std::sqrt( v );
+        return v < 0 ? nodataValue : root;
+      } );
+      break;
+    case opSIN:
+      oneArgumentKernel( values, result, count, nodataValue, []( double v ) { return std::sin( v ); } );
+      break;
+    case opCOS:
+      oneArgumentKernel( values, result, count, nodataValue, []( double v ) { return std::cos( v ); } );
+      break;
+    case opTAN:
+      oneArgumentKernel( values, result, count, nodataValue, []( double v ) { return std::tan( v ); } );
+      break;
+    case opASIN:
+      oneArgumentKernel( values, result, count, nodataValue, []( double v ) { return std::asin( v ); } );
+      break;
+    case opACOS:
+      oneArgumentKernel( values, result, count, nodataValue, []( double v ) { return std::acos( v ); } );
+      break;
+    case opATAN:
+      oneArgumentKernel( values, result, count, nodataValue, []( double v ) { return std::atan( v ); } );
+      break;
+    case opSIGN:
+      oneArgumentKernel( values, result, count, nodataValue, []( double v ) { return -v; } );
+      break;
+    case opLOG:
+      oneArgumentKernel( values, result, count, nodataValue, [nodataValue]( double v )
+      {
+        const double logarithm = std::log( v );
+        return v <= 0 ? nodataValue : logarithm;
+      } );
+      break;
+    case opLOG10:
+      oneArgumentKernel( values, result, count, nodataValue, [nodataValue]( double v )
+      {
+        const double logarithm = std::log10( v );
+        return v <= 0 ? nodataValue : logarithm;
+      } );
+      break;
+  }
+}
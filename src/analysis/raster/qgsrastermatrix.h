@@ -112,6 +112,22 @@ class ANALYSIS_EXPORT QgsRasterMatrix
     bool log();
     bool log10();
 
+    /** Applies a two argument operator to \a count values of \a left and \a right and
+     * stores the results in \a result, which may be the same array as one of the arguments.
+     * Like the matrix operations, a nodata argument gives a nodata result. The loop has no
+     * branch, so that compilers can vectorize it.
+     * @note not available in python bindings
+     * @note added in QGIS 3.0
+     */
+    static void applyTwoArgumentOperator( TwoArgOperator op, const double *left, const double *right, double *result, int count, double nodataValue );
+
+    /** Applies a one argument operator to \a count \a values and stores the results in
+     * \a result, which may be the same array as \a values.
+     * @note not available in python bindings
+     * @note added in QGIS 3.0
+     */
+    static void applyOneArgumentOperator( OneArgOperator op, const double *values, double *result, int count, double nodataValue );
+
   private:
     int mColumns;
     int mRows;
@@ -17,6 +17,18 @@
 
 #include "qgsruggednessfilter.h"
 
+///@cond PRIVATE
+
+//! Returns the squared difference of a neighbour to the center cell, 0 if the neighbour is nodata
+static inline float squaredDifference( float neighbour, float x22, float nodata )
+{
+  //the operand is selected rather than the result, so that the compiler does not need a branch
+  const float diff = ( neighbour != nodata ? neighbour : x22 ) - x22;
+  return diff * diff;
+}
+
+///@endcond
+
 QgsRuggednessFilter::QgsRuggednessFilter( const QString &inputFile, const QString &outputFile, const QString &outputFormat ): QgsNineCellFilter( inputFile, outputFile, outputFormat )
 {
 
@@ -86,3 +98,29 @@ float QgsRuggednessFilter::processNineCellWindow( float *x11, float *x21, float
   return sqrt( sum );
 }
 
+void QgsRuggednessFilter::processScanLine( const float *scanLine1, const float *scanLine2, const float *scanLine3, float *resultLine, int width, ScanLineBuffers &buffers )
+{
+  //same sums as processNineCellWindow, without branches for the nodata neighbours so that the loop can be vectorized
+  double *sums = buffers.doubles.data();
+  const float nodata = mInputNodataValue;
+  for ( int j = 0; j < width; ++j )
+  {
+    const float x22 = scanLine2[j];
+    double sum = 0;
+    sum += squaredDifference( scanLine1[j - 1], x22, nodata );
+    sum += squaredDifference( scanLine1[j], x22, nodata );
+    sum += squaredDifference( scanLine1[j + 1], x22, nodata );
+    sum += squaredDifference( scanLine2[j - 1], x22, nodata );
+    sum += squaredDifference( scanLine2[j + 1], x22, nodata );
+    sum += squaredDifference( scanLine3[j - 1], x22, nodata );
+    sum += squaredDifference( scanLine3[j], x22, nodata );
+    sum += squaredDifference( scanLine3[j + 1], x22, nodata );
+    sums[j] = sum;
+  }
+
+  //sqrt may set errno, which prevents the vectorization of the loop above
+  for ( int j = 0; j < width; ++j )
+  {
+    resultLine[j] = scanLine2[j] == nodata ? mOutputNodataValue : static_cast< float >( sqrt( sums[j] ) );
+  }
+}
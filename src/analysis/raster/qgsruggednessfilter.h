@@ -38,6 +38,13 @@ class ANALYSIS_EXPORT QgsRuggednessFilter: public QgsNineCellFilter
                                  float *x12, float *x22, float *x32,
                                  float *x13, float *x23, float *x33 ) override;
 
+    //! Calculates the ruggedness indices of a scan line, without a virtual call per cell
+    void processScanLine( const float *scanLine1, const float *scanLine2, const float *scanLine3,
+                          float *resultLine, int width, ScanLineBuffers &buffers ) override;
+
+    //! The scan lines are calculated without modifying the filter
+    bool canProcessInParallel() const override { return true; }
+
   private:
     QgsRuggednessFilter();
 };
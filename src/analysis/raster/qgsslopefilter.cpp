@@ -17,6 +17,16 @@
 
 #include "qgsslopefilter.h"
 
+///@cond PRIVATE
+
+//! Returns the slope in degrees for the first order derivatives
+static inline float slopeFromDerivatives( float derX, float derY )
+{
+  return atan( sqrt( derX * derX + derY * derY ) ) * 180.0 / M_PI;
+}
+
+///@endcond
+
 QgsSlopeFilter::QgsSlopeFilter( const QString &inputFile, const QString &outputFile, const QString &outputFormat )
   : QgsDerivativeFilter( inputFile, outputFile, outputFormat )
 {
@@ -34,6 +44,25 @@ float QgsSlopeFilter::processNineCellWindow( float *x11, float *x21, float *x31,
     return mOutputNodataValue;
   }
 
-  return atan( sqrt( derX * derX + derY * derY ) ) * 180.0 / M_PI;
+  return slopeFromDerivatives( derX, derY );
+}
+
+void QgsSlopeFilter::processScanLine( const float *scanLine1, const float *scanLine2, const float *scanLine3, float *resultLine, int width, ScanLineBuffers &buffers )
+{
+  float *derX = buffers.floats1.data();
+  float *derY = buffers.floats2.data();
+  calcFirstDerivatives( scanLine1, scanLine2, scanLine3, derX, derY, width );
+
+  for ( int j = 0; j < width; ++j )
+  {
+    if ( derX[j] == mOutputNodataValue || derY[j] == mOutputNodataValue )
+    {
+      resultLine[j] = mOutputNodataValue;
+    }
+    else
+    {
+      resultLine[j] = slopeFromDerivatives( derX[j], derY[j] );
+    }
+  }
 }
 
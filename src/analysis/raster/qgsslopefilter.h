@@ -34,6 +34,13 @@ class ANALYSIS_EXPORT QgsSlopeFilter: public QgsDerivativeFilter
     float processNineCellWindow( float *x11, float *x21, float *x31,
                                  float *x12, float *x22, float *x32,
                                  float *x13, float *x23, float *x33 ) override;
+
+    //! Calculates the slopes of a scan line, without a virtual call per cell
+    void processScanLine( const float *scanLine1, const float *scanLine2, const float *scanLine3,
+                          float *resultLine, int width, ScanLineBuffers &buffers ) override;
+
+    //! The scan lines are calculated without modifying the filter
+    bool canProcessInParallel() const override { return true; }
 };
 
 #endif // QGSSLOPEFILTER_H
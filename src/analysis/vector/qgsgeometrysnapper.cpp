@@ -460,10 +460,10 @@ QgsSnapIndex::SnapItem *QgsSnapIndex::getSnapItem( const QgsPointV2 &pos, double
 QgsGeometrySnapper::QgsGeometrySnapper( QgsVectorLayer *referenceLayer )
   : mReferenceLayer( referenceLayer )
 {
-  // Build spatial index
+  // Build spatial index, the packed index is only queried and supports concurrent queries
   QgsFeatureRequest req;
   req.setSubsetOfAttributes( QgsAttributeList() );
-  mIndex = QgsSpatialIndex( mReferenceLayer->getFeatures( req ) );
+  mIndex = QgsSpatialIndex( mReferenceLayer->getFeatures( req ), QgsSpatialIndex::PackedRTree );
 }
 
 QgsFeatureList QgsGeometrySnapper::snapFeatures( const QgsFeatureList &features, double snapTolerance, SnapMode mode )
@@ -486,11 +486,9 @@ QgsGeometry QgsGeometrySnapper::snapGeometry( const QgsGeometry &geometry, doubl
 
   // Get potential reference features and construct snap index
   QList<QgsGeometry> refGeometries;
-  mIndexMutex.lock();
   QgsRectangle searchBounds = geometry.boundingBox();
   searchBounds.grow( snapTolerance );
   QgsFeatureIds refFeatureIds = mIndex.intersects( searchBounds ).toSet();
-  mIndexMutex.unlock();
 
   QgsFeatureRequest refFeatureRequest = QgsFeatureRequest().setFilterFids( refFeatureIds ).setSubsetOfAttributes( QgsAttributeList() );
   mReferenceLayerMutex.lock();
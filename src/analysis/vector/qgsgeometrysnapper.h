@@ -94,7 +94,6 @@ class ANALYSIS_EXPORT QgsGeometrySnapper : public QObject
     QgsFeatureList mInputFeatures;
 
     QgsSpatialIndex mIndex;
-    mutable QMutex mIndexMutex;
     mutable QMutex mReferenceLayerMutex;
 
     void processFeature( QgsFeature &feature, double snapTolerance, SnapMode mode );
@@ -28,8 +28,12 @@
 #include "qgsvectorfilewriter.h"
 #include "qgsvectordataprovider.h"
 #include "qgsdistancearea.h"
+#include <QHash>
 #include <QProgressDialog>
 
+//! Number of features of layer A whose overlay features are queried together
+static const int INTERSECTION_BATCH_SIZE = 1000;
+
 bool QgsOverlayAnalyzer::intersection( QgsVectorLayer *layerA, QgsVectorLayer *layerB,
                                        const QString &shapefileName, bool onlySelectedFeatures,
                                        QProgressDialog *p )
@@ -55,113 +59,134 @@ bool QgsOverlayAnalyzer::intersection( QgsVectorLayer *layerA, QgsVectorLayer *l
   QgsVectorFileWriter vWriter( shapefileName, dpA->encoding(), fieldsA, outputType, crs );
   QgsFeature currentFeature;
 
+  QgsFeatureRequest requestA;
+  QgsFeatureRequest requestB = QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() );
+  int featureCount = 0;
+
   //take only selection
   if ( onlySelectedFeatures )
   {
-    QgsFeatureIds selectionB = layerB->selectedFeatureIds();
-    QgsFeatureRequest req = QgsFeatureRequest().setFilterFids( selectionB ).setSubsetOfAttributes( QgsAttributeList() );
-    QgsSpatialIndex index = QgsSpatialIndex( layerB->getFeatures( req ) );
+    requestB.setFilterFids( layerB->selectedFeatureIds() );
 
-    //use QgsVectorLayer::featureAtId
     const QgsFeatureIds selectionA = layerA->selectedFeatureIds();
-    if ( p )
-    {
-      p->setMaximum( selectionA.size() );
-    }
-    req = QgsFeatureRequest().setFilterFids( selectionA );
-    QgsFeatureIterator selectionAIt = layerA->getFeatures( req );
-    QgsFeature currentFeature;
-    int processedFeatures = 0;
-    while ( selectionAIt.nextFeature( currentFeature ) )
-    {
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-
-      if ( p && p->wasCanceled() )
-      {
-        break;
-      }
-
-      intersectFeature( currentFeature, &vWriter, layerB, &index );
-      ++processedFeatures;
-    }
-
-    if ( p )
-    {
-      p->setValue( selectionA.size() );
-    }
+    requestA.setFilterFids( selectionA );
+    featureCount = selectionA.size();
   }
   //take all features
   else
   {
-    QgsFeatureRequest req = QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() );
-    QgsSpatialIndex index = QgsSpatialIndex( layerB->getFeatures( req ) );
+    featureCount = layerA->featureCount();
+  }
+
+  QgsSpatialIndex index = QgsSpatialIndex( layerB->getFeatures( requestB ), QgsSpatialIndex::PackedRTree );
 
-    int featureCount = layerA->featureCount();
+  if ( p )
+  {
+    p->setMaximum( featureCount );
+  }
+
+  // features are processed in batches so that the index queries run concurrently
+  QgsFeatureIterator fit = layerA->getFeatures( requestA );
+  QgsFeatureList batch;
+  int processedFeatures = 0;
+  while ( fit.nextFeature( currentFeature ) )
+  {
     if ( p )
     {
-      p->setMaximum( featureCount );
+      p->setValue( processedFeatures );
     }
-    int processedFeatures = 0;
-
-    QgsFeatureIterator fit = layerA->getFeatures();
-
-    QgsFeature currentFeature;
-    while ( fit.nextFeature( currentFeature ) )
+    if ( p && p->wasCanceled() )
     {
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-      if ( p && p->wasCanceled() )
-      {
-        break;
-      }
-      intersectFeature( currentFeature, &vWriter, layerB, &index );
-      ++processedFeatures;
+      break;
     }
-    if ( p )
+
+    batch << currentFeature;
+    ++processedFeatures;
+    if ( batch.size() >= INTERSECTION_BATCH_SIZE )
     {
-      p->setValue( featureCount );
+      intersectFeatures( batch, &vWriter, layerB, index );
+      batch.clear();
     }
   }
+  // on cancel the features read before it are still written, like when they were processed one by one
+  intersectFeatures( batch, &vWriter, layerB, index );
+
+  if ( p )
+  {
+    p->setValue( featureCount );
+  }
   return true;
 }
 
-void QgsOverlayAnalyzer::intersectFeature( QgsFeature &f, QgsVectorFileWriter *vfw,
-    QgsVectorLayer *vl, QgsSpatialIndex *index )
+void QgsOverlayAnalyzer::intersectFeatures( const QgsFeatureList &features, QgsVectorFileWriter *vfw,
+    QgsVectorLayer *vl, const QgsSpatialIndex &index )
 {
-  if ( !f.hasGeometry() )
+  QgsFeatureList featuresWithGeometry;
+  QVector< QgsRectangle > boundingBoxes;
+  Q_FOREACH ( const QgsFeature &f, features )
+  {
+    if ( f.hasGeometry() )
+    {
+      featuresWithGeometry << f;
+      boundingBoxes << f.geometry().boundingBox();
+    }
+  }
+  if ( featuresWithGeometry.isEmpty() )
   {
     return;
   }
 
-  QgsGeometry featureGeometry = f.geometry();
-  QgsGeometry intersectGeometry;
+  const QVector< QList<QgsFeatureId> > intersects = index.intersects( boundingBoxes );
+
+  // fetch all the overlay features of the batch at once
+  QgsFeatureIds overlayIds;
+  for ( int i = 0; i < intersects.count(); ++i )
+  {
+    overlayIds.unite( intersects.at( i ).toSet() );
+  }
+  if ( overlayIds.isEmpty() )
+  {
+    return;
+  }
+
+  QHash< QgsFeatureId, QgsFeature > overlayFeatures;
+  QgsFeatureIterator intersectIt = vl->getFeatures( QgsFeatureRequest().setFilterFids( overlayIds ) );
   QgsFeature overlayFeature;
+  while ( intersectIt.nextFeature( overlayFeature ) )
+  {
+    overlayFeatures.insert( overlayFeature.id(), overlayFeature );
+  }
 
-  QList<QgsFeatureId> intersects = index->intersects( featureGeometry.boundingBox() );
-  QgsFeatureRequest req = QgsFeatureRequest().setFilterFids( intersects.toSet() );
-  QgsFeatureIterator intersectIt = vl->getFeatures( req );
   QgsFeature outFeature;
-  while ( intersectIt.nextFeature( overlayFeature ) )
+  for ( int i = 0; i < featuresWithGeometry.count(); ++i )
   {
-    if ( featureGeometry.intersects( overlayFeature.geometry() ) )
-    {
-      intersectGeometry = featureGeometry.intersection( overlayFeature.geometry() );
+    const QgsFeature &f = featuresWithGeometry.at( i );
+    QgsGeometry featureGeometry = f.geometry();
 
-      outFeature.setGeometry( intersectGeometry );
-      QgsAttributes attributesA = f.attributes();
-      QgsAttributes attributesB = overlayFeature.attributes();
-      combineAttributeMaps( attributesA, attributesB );
-      outFeature.setAttributes( attributesA );
+    // write the intersections in a deterministic order
+    QList<QgsFeatureId> candidates = intersects.at( i );
+    std::sort( candidates.begin(), candidates.end() );
+    Q_FOREACH ( QgsFeatureId id, candidates )
+    {
+      QHash< QgsFeatureId, QgsFeature >::const_iterator overlayIt = overlayFeatures.constFind( id );
+      if ( overlayIt == overlayFeatures.constEnd() )
+        continue;
 
-      //add it to vector file writer
-      if ( vfw )
+      if ( featureGeometry.intersects( overlayIt->geometry() ) )
       {
-        vfw->addFeature( outFeature );
+        QgsGeometry intersectGeometry = featureGeometry.intersection( overlayIt->geometry() );
+
+        outFeature.setGeometry( intersectGeometry );
+        QgsAttributes attributesA = f.attributes();
+        QgsAttributes attributesB = overlayIt->attributes();
+        combineAttributeMaps( attributesA, attributesB );
+        outFeature.setAttributes( attributesA );
+
+        //add it to vector file writer
+        if ( vfw )
+        {
+          vfw->addFeature( outFeature );
+        }
       }
     }
   }
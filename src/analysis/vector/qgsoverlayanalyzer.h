@@ -47,7 +47,8 @@ class ANALYSIS_EXPORT QgsOverlayAnalyzer
   private:
 
     void combineFieldLists( QgsFields &fieldListA, const QgsFields &fieldListB );
-    void intersectFeature( QgsFeature &f, QgsVectorFileWriter *vfw, QgsVectorLayer *dp, QgsSpatialIndex *index );
+    //! Writes the intersections of a batch of features with the overlay features of layer \a vl
+    void intersectFeatures( const QgsFeatureList &features, QgsVectorFileWriter *vfw, QgsVectorLayer *vl, const QgsSpatialIndex &index );
     void combineAttributeMaps( QgsAttributes &attributesA, const QgsAttributes &attributesB );
 };
 
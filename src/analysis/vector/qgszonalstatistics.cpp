@@ -28,6 +28,11 @@
 
 #include <QProgressDialog>
 #include <QFile>
+#include <QThreadPool>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
 
 QgsZonalStatistics::QgsZonalStatistics( QgsVectorLayer *polygonLayer, QgsRasterLayer *rasterLayer, const QString &attributePrefix, int rasterBand, Statistics stats )
   : mRasterLayer( rasterLayer )
@@ -207,65 +212,36 @@ int QgsZonalStatistics::calculateStatistics( QProgressDialog *p )
   bool statsStoreValueCount = ( mStatistics & QgsZonalStatistics::Minority ) ||
                               ( mStatistics & QgsZonalStatistics::Majority );
 
-  FeatureStats featureStats( statsStoreValues, statsStoreValueCount );
-  int featureCounter = 0;
-
-  QgsChangedAttributesMap changeMap;
-  while ( fi.nextFeature( f ) )
+  //polygon of a batch, with the raster cells covering its bounding box
+  struct PolygonJob
   {
-    if ( p )
-    {
-      p->setValue( featureCounter );
-    }
+    QgsFeatureId id;
+    QgsGeometry geometry;
+    int offsetX;
+    int offsetY;
+    int nCellsX;
+    int nCellsY;
+    QgsRasterBlock *block;
+    QgsAttributeMap attributes;
+  };
 
-    if ( p && p->wasCanceled() )
-    {
-      break;
-    }
-
-    if ( !f.hasGeometry() )
-    {
-      ++featureCounter;
-      continue;
-    }
-    QgsGeometry featureGeometry = f.geometry();
-
-    QgsRectangle featureRect = featureGeometry.boundingBox().intersect( &rasterBBox );
-    if ( featureRect.isEmpty() )
-    {
-      ++featureCounter;
-      continue;
-    }
-
-    int offsetX, offsetY, nCellsX, nCellsY;
-    if ( cellInfoForBBox( rasterBBox, featureRect, cellsizeX, cellsizeY, offsetX, offsetY, nCellsX, nCellsY ) != 0 )
-    {
-      ++featureCounter;
-      continue;
-    }
-
-    //avoid access to cells outside of the raster (may occur because of rounding)
-    if ( ( offsetX + nCellsX ) > nCellsXProvider )
-    {
-      nCellsX = nCellsXProvider - offsetX;
-    }
-    if ( ( offsetY + nCellsY ) > nCellsYProvider )
-    {
-      nCellsY = nCellsYProvider - offsetY;
-    }
+  auto calculatePolygon = [&]( PolygonJob & job )
+  {
+    FeatureStats featureStats( statsStoreValues, statsStoreValueCount );
+    const QVector< Ring > rings = polygonRings( job.geometry );
 
-    statisticsFromMiddlePointTest( featureGeometry, offsetX, offsetY, nCellsX, nCellsY, cellsizeX, cellsizeY,
+    statisticsFromMiddlePointTest( rings, job.block, job.offsetX, job.offsetY, job.nCellsX, job.nCellsY, cellsizeX, cellsizeY,
                                    rasterBBox, featureStats );
 
     if ( featureStats.count <= 1 )
     {
       //the cell resolution is probably larger than the polygon area. We switch to precise pixel - polygon intersection in this case
-      statisticsFromPreciseIntersection( featureGeometry, offsetX, offsetY, nCellsX, nCellsY, cellsizeX, cellsizeY,
+      statisticsFromPreciseIntersection( rings, job.block, job.offsetX, job.offsetY, job.nCellsX, job.nCellsY, cellsizeX, cellsizeY,
                                          rasterBBox, featureStats );
     }
 
-    //write the statistics value to the vector data provider
-    QgsAttributeMap changeAttributeMap;
+    //the statistics values to write to the vector data provider
+    QgsAttributeMap &changeAttributeMap = job.attributes;
     if ( mStatistics & QgsZonalStatistics::Count )
       changeAttributeMap.insert( countIndex, QVariant( featureStats.count ) );
     if ( mStatistics & QgsZonalStatistics::Sum )
@@ -326,9 +302,79 @@ int QgsZonalStatistics::calculateStatistics( QProgressDialog *p )
       if ( mStatistics & QgsZonalStatistics::Variety )
         changeAttributeMap.insert( varietyIndex, QVariant( featureStats.valueCount.count() ) );
     }
+  };
 
-    changeMap.insert( f.id(), changeAttributeMap );
-    ++featureCounter;
+  // the raster blocks are read in this thread, as providers cannot be shared between threads,
+  // and a few polygons per thread keep the threads busy
+  const int batchSize = 16 * std::max( 1, QThreadPool::globalInstance()->maxThreadCount() );
+  QVector< PolygonJob > batch;
+  batch.reserve( batchSize );
+  int featureCounter = 0;
+  bool moreFeatures = true;
+
+  QgsChangedAttributesMap changeMap;
+  while ( moreFeatures )
+  {
+    if ( p )
+    {
+      p->setValue( featureCounter );
+    }
+
+    if ( p && p->wasCanceled() )
+    {
+      break;
+    }
+
+    batch.clear();
+    while ( batch.size() < batchSize && ( moreFeatures = fi.nextFeature( f ) ) )
+    {
+      ++featureCounter;
+      if ( !f.hasGeometry() )
+      {
+        continue;
+      }
+      QgsGeometry featureGeometry = f.geometry();
+
+      QgsRectangle featureRect = featureGeometry.boundingBox().intersect( &rasterBBox );
+      if ( featureRect.isEmpty() )
+      {
+        continue;
+      }
+
+      int offsetX, offsetY, nCellsX, nCellsY;
+      if ( cellInfoForBBox( rasterBBox, featureRect, cellsizeX, cellsizeY, offsetX, offsetY, nCellsX, nCellsY ) != 0 )
+      {
+        continue;
+      }
+
+      //avoid access to cells outside of the raster (may occur because of rounding)
+      if ( ( offsetX + nCellsX ) > nCellsXProvider )
+      {
+        nCellsX = nCellsXProvider - offsetX;
+      }
+      if ( ( offsetY + nCellsY ) > nCellsYProvider )
+      {
+        nCellsY = nCellsYProvider - offsetY;
+      }
+
+      PolygonJob job;
+      job.id = f.id();
+      job.geometry = featureGeometry;
+      job.offsetX = offsetX;
+      job.offsetY = offsetY;
+      job.nCellsX = nCellsX;
+      job.nCellsY = nCellsY;
+      job.block = mRasterProvider->block( mRasterBand, featureRect, nCellsX, nCellsY );
+      batch << job;
+    }
+
+    QtConcurrent::blockingMap( batch, calculatePolygon );
+
+    for ( const PolygonJob &job : batch )
+    {
+      changeMap.insert( job.id, job.attributes );
+      delete job.block;
+    }
   }
 
   vectorProvider->changeAttributeValues( changeMap );
@@ -375,83 +421,165 @@ int QgsZonalStatistics::cellInfoForBBox( const QgsRectangle &rasterBBox, const Q
   return 0;
 }
 
-void QgsZonalStatistics::statisticsFromMiddlePointTest( const QgsGeometry &poly, int pixelOffsetX,
-    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats )
+QVector< QgsZonalStatistics::Ring > QgsZonalStatistics::polygonRings( const QgsGeometry &poly )
 {
-  double cellCenterX, cellCenterY;
-
-  cellCenterY = rasterBBox.yMaximum() - pixelOffsetY * cellSizeY - cellSizeY / 2;
-  stats.reset();
+  QgsMultiPolygon parts;
+  if ( poly.isMultipart() )
+  {
+    parts = poly.asMultiPolygon();
+  }
+  else
+  {
+    parts << poly.asPolygon();
+  }
 
-  GEOSGeometry *polyGeos = poly.exportToGeos();
-  if ( !polyGeos )
+  QVector< Ring > rings;
+  for ( const QgsPolygon &part : parts )
   {
-    return;
+    for ( int i = 0; i < part.size(); ++i )
+    {
+      rings << Ring { part.at( i ), i == 0 };
+    }
   }
+  return rings;
+}
 
-  GEOSContextHandle_t geosctxt = QgsGeometry::getGEOSHandler();
-  const GEOSPreparedGeometry *polyGeosPrepared = GEOSPrepare_r( geosctxt, polyGeos );
-  if ( !polyGeosPrepared )
+void QgsZonalStatistics::statisticsFromMiddlePointTest( const QVector< Ring > &rings, QgsRasterBlock *block, int pixelOffsetX,
+    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats ) const
+{
+  stats.reset();
+  if ( !block )
   {
-    GEOSGeom_destroy_r( geosctxt, polyGeos );
     return;
   }
 
-  GEOSCoordSequence *cellCenterCoords = nullptr;
-  GEOSGeometry *currentCellCenter = nullptr;
+  const double firstCellCenterX = rasterBBox.xMinimum() + pixelOffsetX * cellSizeX + cellSizeX / 2;
+  double cellCenterY = rasterBBox.yMaximum() - pixelOffsetY * cellSizeY - cellSizeY / 2;
 
-  QgsRectangle featureBBox = poly.boundingBox().intersect( &rasterBBox );
-  QgsRectangle intersectBBox = rasterBBox.intersect( &featureBBox );
-
-  QgsRasterBlock *block = mRasterProvider->block( mRasterBand, intersectBBox, nCellsX, nCellsY );
+  QVector< double > crossings;
   for ( int i = 0; i < nCellsY; ++i )
   {
-    cellCenterX = rasterBBox.xMinimum() + pixelOffsetX * cellSizeX + cellSizeX / 2;
-    for ( int j = 0; j < nCellsX; ++j )
+    //x of the crossings of the edges with the line through the cell centers of the row
+    crossings.clear();
+    for ( const Ring &ring : rings )
     {
-      if ( validPixel( block->value( i, j ) ) )
+      const QgsPoint *points = ring.points.constData();
+      const int nPoints = ring.points.size();
+      for ( int k = 0, previous = nPoints - 1; k < nPoints; previous = k++ )
       {
-        GEOSGeom_destroy_r( geosctxt, currentCellCenter );
-        cellCenterCoords = GEOSCoordSeq_create_r( geosctxt, 1, 2 );
-        GEOSCoordSeq_setX_r( geosctxt, cellCenterCoords, 0, cellCenterX );
-        GEOSCoordSeq_setY_r( geosctxt, cellCenterCoords, 0, cellCenterY );
-        currentCellCenter = GEOSGeom_createPoint_r( geosctxt, cellCenterCoords );
-        if ( GEOSPreparedContains_r( geosctxt, polyGeosPrepared, currentCellCenter ) )
+        const QgsPoint &p1 = points[previous];
+        const QgsPoint &p2 = points[k];
+        //an edge ending on the line is only counted on one side, so that a vertex on the line is crossed once
+        if ( ( p1.y() > cellCenterY ) != ( p2.y() > cellCenterY ) )
+        {
+          crossings << p1.x() + ( cellCenterY - p1.y() ) * ( p2.x() - p1.x() ) / ( p2.y() - p1.y() );
+        }
+      }
+    }
+    std::sort( crossings.begin(), crossings.end() );
+
+    //with the even-odd rule, the cells between two consecutive crossings are inside the polygon
+    for ( int k = 0; k + 1 < crossings.size(); k += 2 )
+    {
+      const double spanStart = crossings.at( k );
+      const double spanEnd = crossings.at( k + 1 );
+      const double firstColumn = std::ceil( ( spanStart - firstCellCenterX ) / cellSizeX );
+      const double lastColumn = std::floor( ( spanEnd - firstCellCenterX ) / cellSizeX );
+      const int first = static_cast< int >( qBound( 0.0, firstColumn, static_cast< double >( nCellsX ) ) );
+      const int last = static_cast< int >( qBound( -1.0, lastColumn, static_cast< double >( nCellsX - 1 ) ) );
+      for ( int j = first; j <= last; ++j )
+      {
+        //cells with the center on the boundary are not contained in the polygon
+        const double cellCenterX = firstCellCenterX + j * cellSizeX;
+        if ( cellCenterX <= spanStart || cellCenterX >= spanEnd )
+        {
+          continue;
+        }
+
+        if ( validPixel( block->value( i, j ) ) )
         {
           stats.addValue( block->value( i, j ) );
         }
       }
-      cellCenterX += cellSizeX;
     }
     cellCenterY -= cellSizeY;
   }
+}
+
+///@cond PRIVATE
+
+//! Clips a ring to the half plane on one side of an horizontal or vertical line (Sutherland-Hodgman)
+static void clipRing( const QVector< QgsPoint > &ring, QVector< QgsPoint > &result, bool vertical, double limit, bool keepAbove )
+{
+  result.clear();
+  const int nPoints = ring.size();
+  if ( nPoints == 0 )
+  {
+    return;
+  }
+
+  auto coordinate = [vertical]( const QgsPoint & point ) { return vertical ? point.x() : point.y(); };
+  auto inside = [&]( const QgsPoint & point ) { return keepAbove ? coordinate( point ) >= limit : coordinate( point ) <= limit; };
+
+  QgsPoint previous = ring.at( nPoints - 1 );
+  bool previousInside = inside( previous );
+  for ( const QgsPoint &current : ring )
+  {
+    const bool currentInside = inside( current );
+    if ( currentInside != previousInside )
+    {
+      const double t = ( limit - coordinate( previous ) ) / ( coordinate( current ) - coordinate( previous ) );
+      result << QgsPoint( previous.x() + t * ( current.x() - previous.x() ), previous.y() + t * ( current.y() - previous.y() ) );
+    }
+    if ( currentInside )
+    {
+      result << current;
+    }
+    previous = current;
+    previousInside = currentInside;
+  }
+}
 
-  GEOSGeom_destroy_r( geosctxt, currentCellCenter );
-  GEOSPreparedGeom_destroy_r( geosctxt, polyGeosPrepared );
-  GEOSGeom_destroy_r( geosctxt, polyGeos );
-  delete block;
+//! Returns the area of a ring
+static double ringArea( const QVector< QgsPoint > &ring )
+{
+  const int nPoints = ring.size();
+  double area = 0;
+  for ( int k = 0, previous = nPoints - 1; k < nPoints; previous = k++ )
+  {
+    area += ring.at( previous ).x() * ring.at( k ).y() - ring.at( k ).x() * ring.at( previous ).y();
+  }
+  return std::fabs( area ) / 2;
 }
 
-void QgsZonalStatistics::statisticsFromPreciseIntersection( const QgsGeometry &poly, int pixelOffsetX,
-    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats )
+///@endcond
+
+void QgsZonalStatistics::statisticsFromPreciseIntersection( const QVector< Ring > &rings, QgsRasterBlock *block, int pixelOffsetX,
+    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats ) const
 {
   stats.reset();
+  if ( !block )
+  {
+    return;
+  }
 
-  double currentY = rasterBBox.yMaximum() - pixelOffsetY * cellSizeY - cellSizeY / 2;
-  QgsGeometry pixelRectGeometry;
-
-  double hCellSizeX = cellSizeX / 2.0;
-  double hCellSizeY = cellSizeY / 2.0;
   double pixelArea = cellSizeX * cellSizeY;
-  double weight = 0;
+  const double firstCellLeft = rasterBBox.xMinimum() + pixelOffsetX * cellSizeX;
+  double cellTop = rasterBBox.yMaximum() - pixelOffsetY * cellSizeY;
 
-  QgsRectangle featureBBox = poly.boundingBox().intersect( &rasterBBox );
-  QgsRectangle intersectBBox = rasterBBox.intersect( &featureBBox );
-
-  QgsRasterBlock *block = mRasterProvider->block( mRasterBand, intersectBBox, nCellsX, nCellsY );
+  QVector< QVector< QgsPoint > > rowRings( rings.size() );
+  QVector< QgsPoint > clipped;
+  QVector< QgsPoint > cellRing;
   for ( int i = 0; i < nCellsY; ++i )
   {
-    double currentX = rasterBBox.xMinimum() + cellSizeX / 2.0 + pixelOffsetX * cellSizeX;
+    //clip the rings to the row once, then each row ring to the cells
+    const double cellBottom = cellTop - cellSizeY;
+    for ( int r = 0; r < rings.size(); ++r )
+    {
+      clipRing( rings.at( r ).points, clipped, false, cellBottom, true );
+      clipRing( clipped, rowRings[r], false, cellTop, false );
+    }
+
     for ( int j = 0; j < nCellsX; ++j )
     {
       if ( !validPixel( block->value( i, j ) ) )
@@ -459,27 +587,27 @@ void QgsZonalStatistics::statisticsFromPreciseIntersection( const QgsGeometry &p
         continue;
       }
 
-      pixelRectGeometry = QgsGeometry::fromRect( QgsRectangle( currentX - hCellSizeX, currentY - hCellSizeY, currentX + hCellSizeX, currentY + hCellSizeY ) );
-      if ( !pixelRectGeometry.isNull() )
+      const double cellLeft = firstCellLeft + j * cellSizeX;
+      const double cellRight = cellLeft + cellSizeX;
+      //area of the exterior rings in the cell, less the area of the holes
+      double intersectionArea = 0;
+      for ( int r = 0; r < rings.size(); ++r )
       {
-        //intersection
-        QgsGeometry intersectGeometry = pixelRectGeometry.intersection( poly );
-        if ( !intersectGeometry.isNull() )
+        if ( rowRings.at( r ).size() < 3 )
         {
-          double intersectionArea = intersectGeometry.area();
-          if ( intersectionArea >= 0.0 )
-          {
-            weight = intersectionArea / pixelArea;
-            stats.addValue( block->value( i, j ), weight );
-          }
+          continue;
         }
-        pixelRectGeometry = QgsGeometry();
+        clipRing( rowRings.at( r ), clipped, true, cellLeft, true );
+        clipRing( clipped, cellRing, true, cellRight, false );
+        const double area = ringArea( cellRing );
+        intersectionArea += rings.at( r ).exterior ? area : -area;
       }
-      currentX += cellSizeX;
+
+      double weight = std::max( 0.0, intersectionArea ) / pixelArea;
+      stats.addValue( block->value( i, j ), weight );
     }
-    currentY -= cellSizeY;
+    cellTop = cellBottom;
   }
-  delete block;
 }
 
 bool QgsZonalStatistics::validPixel( float value ) const
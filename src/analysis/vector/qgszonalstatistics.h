@@ -20,12 +20,15 @@
 
 #include <QString>
 #include <QMap>
+#include <QVector>
 #include <limits>
 #include <cfloat>
 #include "qgis_analysis.h"
+#include "qgspoint.h"
 
 class QgsGeometry;
 class QgsVectorLayer;
+class QgsRasterBlock;
 class QgsRasterLayer;
 class QgsRasterDataProvider;
 class QProgressDialog;
@@ -33,7 +36,13 @@ class QgsRectangle;
 class QgsField;
 
 /** \ingroup analysis
- *  A class that calculates raster statistics (count, sum, mean) for a polygon or multipolygon layer and appends the results as attributes*/
+ *  A class that calculates raster statistics (count, sum, mean) for a polygon or multipolygon layer and appends the results as attributes.
+ *
+ *  The cells covered by a polygon are found by scan-line rasterization of its rings, and for
+ *  polygons smaller than a cell by computing the exact area of the polygon in each cell. The
+ *  polygons are processed in batches: the raster block of each polygon of a batch is read once,
+ *  then the statistics of the polygons are calculated in parallel.
+ */
 class ANALYSIS_EXPORT QgsZonalStatistics
 {
   public:
@@ -115,13 +124,29 @@ class ANALYSIS_EXPORT QgsZonalStatistics
     int cellInfoForBBox( const QgsRectangle &rasterBBox, const QgsRectangle &featureBBox, double cellSizeX, double cellSizeY,
                          int &offsetX, int &offsetY, int &nCellsX, int &nCellsY ) const;
 
-    //! Returns statistics by considering the pixels where the center point is within the polygon (fast)
-    void statisticsFromMiddlePointTest( const QgsGeometry &poly, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
-                                        double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats );
+    //! Ring of a polygon or of a part of a multipolygon
+    struct Ring
+    {
+      QVector< QgsPoint > points;
+      //! False for the holes of a polygon
+      bool exterior;
+    };
+
+    //! Returns the rings of all the parts of a polygon or multipolygon, with curves segmentized
+    static QVector< Ring > polygonRings( const QgsGeometry &poly );
 
-    //! Returns statistics with precise pixel - polygon intersection test (slow)
-    void statisticsFromPreciseIntersection( const QgsGeometry &poly, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
-                                            double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats );
+    /** Returns statistics by considering the pixels where the center point is within the polygon (fast).
+     * The cells of each row whose center is inside are found from the crossings of the row center line
+     * with the edges of the rings. \a block holds the raster values of the nCellsX x nCellsY cells.
+     */
+    void statisticsFromMiddlePointTest( const QVector< Ring > &rings, QgsRasterBlock *block, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
+                                        double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats ) const;
+
+    /** Returns statistics with precise pixel - polygon intersection test, the weight of each pixel being
+     * the area of the polygon inside it, computed by clipping the rings to the pixel (slow).
+     */
+    void statisticsFromPreciseIntersection( const QVector< Ring > &rings, QgsRasterBlock *block, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
+                                            double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats ) const;
 
     //! Tests whether a pixel's value should be included in the result
     bool validPixel( float value ) const;
@@ -131,7 +131,7 @@ class CORE_EXPORT QgsCurve: public QgsAbstractGeometry
 
     /** Returns a QPolygonF representing the points.
      */
-    QPolygonF asQPolygonF() const;
+    virtual QPolygonF asQPolygonF() const;
 
 
   protected:
@@ -44,15 +44,235 @@ email                : morb at ozemail dot com dot au
 #include "qgspointv2.h"
 #include "qgspolygon.h"
 #include "qgslinestring.h"
+#include "qgswkbgeometryview.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QtConcurrentMap>
+#include <memory>
 
 struct QgsGeometryPrivate
 {
-  QgsGeometryPrivate(): ref( 1 ), geometry( nullptr ) {}
-  ~QgsGeometryPrivate() { delete geometry; }
+  QgsGeometryPrivate(): ref( 1 ) {}
+  ~QgsGeometryPrivate()
+  {
+    preparedEngines.clear();
+    delete parsedGeometry.load();
+  }
   QAtomicInt ref;
-  QgsAbstractGeometry *geometry = nullptr;
+
+  //! Geometry, null until the pending WKB is parsed
+  QAtomicPointer< QgsAbstractGeometry > parsedGeometry;
+  //! WKB the geometry was created from, parsed on the first access to the geometry
+  QgsWkbGeometryView pendingWkb;
+  //! Non zero while pendingWkb has not been parsed
+  QAtomicInt wkbPending;
+  //! Serializes the parsing of the pending WKB by threads sharing the geometry
+  QMutex wkbMutex;
+  //! Bounding box of the pending WKB, valid once pendingBoxValid is set
+  QgsRectangle pendingBox;
+  bool pendingBoxValid = false;
+
+  //! Returns the geometry, parsing the pending WKB on the first call
+  QgsAbstractGeometry *geometry()
+  {
+    QgsAbstractGeometry *geom = parsedGeometry.loadAcquire();
+    if ( geom || !wkbPending.loadAcquire() )
+      return geom;
+
+    QMutexLocker locker( &wkbMutex );
+    if ( wkbPending.load() )
+    {
+      QgsConstWkbPtr ptr( pendingWkb.wkb() );
+      parsedGeometry.storeRelease( QgsGeometryFactory::geomFromWkb( ptr ) );
+      pendingWkb = QgsWkbGeometryView();
+      wkbPending.storeRelease( 0 );
+    }
+    return parsedGeometry.load();
+  }
+
+  //! Returns a copy of the pending WKB view, or an invalid view once the geometry is parsed
+  QgsWkbGeometryView pendingView()
+  {
+    if ( !wkbPending.loadAcquire() )
+      return QgsWkbGeometryView();
+
+    QMutexLocker locker( &wkbMutex );
+    return wkbPending.load() ? pendingWkb : QgsWkbGeometryView();
+  }
+
+  /**
+   * Sets \a bbox to the bounding box of the pending WKB, which is only scanned on the first
+   * call. Returns false once the geometry is parsed.
+   */
+  bool pendingBoundingBox( QgsRectangle &bbox )
+  {
+    if ( !wkbPending.loadAcquire() )
+      return false;
+
+    QMutexLocker locker( &wkbMutex );
+    if ( !wkbPending.load() )
+      return false;
+
+    if ( !pendingBoxValid )
+    {
+      pendingBox = pendingWkb.boundingBox();
+      pendingBoxValid = true;
+    }
+    bbox = pendingBox;
+    return true;
+  }
+
+  //! Replaces the geometry without deleting the previous one, the geometry must not be shared
+  void setGeometry( QgsAbstractGeometry *geometry )
+  {
+    pendingWkb = QgsWkbGeometryView();
+    pendingBoxValid = false;
+    wkbPending.store( 0 );
+    parsedGeometry.store( geometry );
+  }
+
+  //! Replaces the geometry by a WKB view parsed on demand, the geometry must not be shared
+  void setWkb( const QgsWkbGeometryView &view )
+  {
+    delete parsedGeometry.load();
+    parsedGeometry.store( nullptr );
+    pendingWkb = view;
+    pendingBoxValid = false;
+    wkbPending.store( 1 );
+  }
+
+  //! Deletes the geometry and discards the pending WKB, the geometry must not be shared
+  void deleteGeometry()
+  {
+    delete parsedGeometry.load();
+    setGeometry( nullptr );
+  }
+
+  //! Returns true if there is neither a geometry nor a pending WKB
+  bool isNull() const
+  {
+    return !parsedGeometry.load() && !wkbPending.load();
+  }
+
+  //! Number of predicates evaluated with this geometry as first operand
+  QAtomicInt predicateCount;
+  /**
+   * GEOS engines with the prepared geometry by thread, created on the second predicate evaluation
+   * by a thread. Prepared GEOS geometries cannot be used by several threads at once. At most one
+   * engine per ideal thread is kept, the engines of the other threads are dropped when a new thread
+   * needs one.
+   */
+  QHash< Qt::HANDLE, std::shared_ptr< QgsGeometryEngine > > preparedEngines;
+  //! Protects preparedEngines, the engines are used without holding it
+  QMutex preparedMutex;
+
+  //! Discards the prepared geometries, must be called before the geometry is modified
+  void invalidatePrepared()
+  {
+    preparedEngines.clear();
+    predicateCount = 0;
+  }
 };
 
+///@cond PRIVATE
+
+typedef bool ( QgsGeometryEngine::*QgsGeometryPredicate )( const QgsAbstractGeometry &, QString * ) const;
+
+//! Below this number of geometries batched predicates are evaluated by the calling thread only
+static const int PARALLEL_PREDICATE_MINIMUM_GEOMETRIES = 256;
+
+/**
+ * Evaluates a predicate with the geometry of \a d as first operand. The first evaluation
+ * converts the geometry to GEOS for this call only, the following ones use an engine with
+ * the prepared geometry, one per thread, kept until the geometry is modified or more threads
+ * than the ideal thread count use it.
+ */
+static bool evaluatePredicate( QgsGeometryPrivate *d, const QgsAbstractGeometry &other, QgsGeometryPredicate predicate )
+{
+  if ( d->predicateCount.fetchAndAddRelaxed( 1 ) == 0 )
+  {
+    QgsGeos geos( d->geometry() );
+    return ( geos.*predicate )( other, nullptr );
+  }
+
+  // the engine is shared so that it survives a concurrent invalidation while it is used
+  const Qt::HANDLE thread = QThread::currentThreadId();
+  std::shared_ptr< QgsGeometryEngine > engine;
+  {
+    QMutexLocker locker( &d->preparedMutex );
+    engine = d->preparedEngines.value( thread );
+  }
+  if ( !engine )
+  {
+    engine.reset( new QgsGeos( d->geometry() ) );
+    engine->prepareGeometry();
+    QMutexLocker locker( &d->preparedMutex );
+    if ( d->preparedEngines.size() >= std::max( 1, QThread::idealThreadCount() ) )
+      d->preparedEngines.clear();
+    d->preparedEngines.insert( thread, engine );
+  }
+  return ( engine.get()->*predicate )( other, nullptr );
+}
+
+//! Range of geometries evaluated by one task of a batched predicate
+struct QgsGeometryPredicateRange
+{
+  int start;
+  int end;
+};
+
+/**
+ * Evaluates a predicate with the geometry of \a d against each geometry of a list.
+ * Large lists are split between the threads of the global pool, each thread prepares
+ * its own copy of the geometry since prepared GEOS geometries are not thread safe.
+ */
+static QVector< bool > evaluatePredicates( QgsGeometryPrivate *d, const QVector< QgsGeometry > &geometries, QgsGeometryPredicate predicate )
+{
+  const int count = geometries.count();
+  QVector< bool > results( count, false );
+  if ( !d->geometry() || count == 0 )
+    return results;
+
+  if ( count < PARALLEL_PREDICATE_MINIMUM_GEOMETRIES )
+  {
+    // make sure the prepared geometry of this thread is created and kept for later calls
+    d->predicateCount.fetchAndAddRelaxed( 1 );
+    for ( int i = 0; i < count; ++i )
+    {
+      const QgsAbstractGeometry *other = geometries.at( i ).geometry();
+      if ( other )
+        results[i] = evaluatePredicate( d, *other, predicate );
+    }
+    return results;
+  }
+
+  const int threads = std::max( 1, QThread::idealThreadCount() );
+  const int rangeSize = std::max( PARALLEL_PREDICATE_MINIMUM_GEOMETRIES / 4, ( count + threads - 1 ) / threads );
+  QVector< QgsGeometryPredicateRange > ranges;
+  for ( int start = 0; start < count; start += rangeSize )
+    ranges.append( { start, std::min( start + rangeSize, count ) } );
+
+  const QgsAbstractGeometry *geometry = d->geometry();
+  const QgsGeometry *geometryData = geometries.constData();
+  bool *resultData = results.data();
+  QtConcurrent::blockingMap( ranges, [ = ]( const QgsGeometryPredicateRange & range )
+  {
+    QgsGeos geos( geometry );
+    geos.prepareGeometry();
+    for ( int i = range.start; i < range.end; ++i )
+    {
+      const QgsAbstractGeometry *other = geometryData[i].geometry();
+      if ( other )
+        resultData[i] = ( geos.*predicate )( *other, nullptr );
+    }
+  } );
+  return results;
+}
+
+///@endcond
+
 QgsGeometry::QgsGeometry(): d( new QgsGeometryPrivate() )
 {
 }
@@ -65,7 +285,7 @@ QgsGeometry::~QgsGeometry()
 
 QgsGeometry::QgsGeometry( QgsAbstractGeometry *geom ): d( new QgsGeometryPrivate() )
 {
-  d->geometry = geom;
+  d->setGeometry( geom );
   d->ref = QAtomicInt( 1 );
 }
 
@@ -91,44 +311,58 @@ void QgsGeometry::detach( bool cloneGeom )
 {
   if ( d->ref > 1 )
   {
-    ( void )d->ref.deref();
-    QgsAbstractGeometry *cGeom = nullptr;
-
-    if ( d->geometry && cloneGeom )
+    QgsGeometryPrivate *newD = new QgsGeometryPrivate();
+    if ( cloneGeom )
     {
-      cGeom = d->geometry->clone();
+      // an unparsed geometry is detached by sharing its WKB, which is parsed by each copy when needed
+      const QgsWkbGeometryView view = d->pendingView();
+      if ( view.isValid() )
+        newD->setWkb( view );
+      else if ( d->geometry() )
+        newD->setGeometry( d->geometry()->clone() );
     }
 
-    d = new QgsGeometryPrivate();
-    d->geometry = cGeom;
+    ( void )d->ref.deref();
+    d = newD;
+  }
+  else
+  {
+    QMutexLocker locker( &d->preparedMutex );
+    d->invalidatePrepared();
   }
 }
 
 QgsAbstractGeometry *QgsGeometry::geometry() const
 {
-  return d->geometry;
+  // the geometry may be modified through the returned pointer
+  if ( d->predicateCount.load() > 1 )
+  {
+    QMutexLocker locker( &d->preparedMutex );
+    d->invalidatePrepared();
+  }
+  return d->geometry();
 }
 
 void QgsGeometry::setGeometry( QgsAbstractGeometry *geometry )
 {
-  if ( d->geometry == geometry )
+  if ( geometry && d->parsedGeometry.load() == geometry )
   {
     return;
   }
 
   detach( false );
-  if ( d->geometry )
-  {
-    delete d->geometry;
-    d->geometry = nullptr;
-  }
-
-  d->geometry = geometry;
+  d->deleteGeometry();
+  d->setGeometry( geometry );
 }
 
 bool QgsGeometry::isNull() const
 {
-  return !d->geometry;
+  return d->isNull();
+}
+
+QgsWkbGeometryView QgsGeometry::wkbView() const
+{
+  return d->pendingView();
 }
 
 QgsGeometry QgsGeometry::fromWkt( const QString &wkt )
@@ -238,14 +472,7 @@ QgsGeometry QgsGeometry::collectGeometry( const QList< QgsGeometry > &geometries
 
 void QgsGeometry::fromWkb( unsigned char *wkb, int length )
 {
-  detach( false );
-
-  if ( d->geometry )
-  {
-    delete d->geometry;
-  }
-  QgsConstWkbPtr ptr( wkb, length );
-  d->geometry = QgsGeometryFactory::geomFromWkb( ptr );
+  fromWkb( QByteArray( reinterpret_cast< const char * >( wkb ), length ) );
   delete [] wkb;
 }
 
@@ -253,77 +480,88 @@ void QgsGeometry::fromWkb( const QByteArray &wkb )
 {
   detach( false );
 
-  if ( d->geometry )
+  // supported geometries are parsed on demand, so that read-only users such as
+  // the renderers can work on the WKB directly
+  QgsWkbGeometryView view( wkb );
+  if ( view.isValid() )
   {
-    delete d->geometry;
+    d->setWkb( view );
+    return;
   }
+
+  d->deleteGeometry();
   QgsConstWkbPtr ptr( wkb );
-  d->geometry = QgsGeometryFactory::geomFromWkb( ptr );
+  d->setGeometry( QgsGeometryFactory::geomFromWkb( ptr ) );
 }
 
 GEOSGeometry *QgsGeometry::exportToGeos( double precision ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return nullptr;
   }
 
-  return QgsGeos::asGeos( d->geometry, precision );
+  return QgsGeos::asGeos( d->geometry(), precision );
 }
 
 
 QgsWkbTypes::Type QgsGeometry::wkbType() const
 {
-  if ( !d->geometry )
+  const QgsWkbGeometryView view = d->pendingView();
+  if ( view.isValid() )
+  {
+    return view.wkbType();
+  }
+  else if ( !d->geometry() )
   {
     return QgsWkbTypes::Unknown;
   }
   else
   {
-    return d->geometry->wkbType();
+    return d->geometry()->wkbType();
   }
 }
 
 
 QgsWkbTypes::GeometryType QgsGeometry::type() const
 {
-  if ( !d->geometry )
+  if ( isNull() )
   {
     return QgsWkbTypes::UnknownGeometry;
   }
-  return static_cast< QgsWkbTypes::GeometryType >( QgsWkbTypes::geometryType( d->geometry->wkbType() ) );
+  return static_cast< QgsWkbTypes::GeometryType >( QgsWkbTypes::geometryType( wkbType() ) );
 }
 
 bool QgsGeometry::isEmpty() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return true;
   }
 
-  return d->geometry->isEmpty();
+  return d->geometry()->isEmpty();
 }
 
 bool QgsGeometry::isMultipart() const
 {
-  if ( !d->geometry )
+  if ( isNull() )
   {
     return false;
   }
-  return QgsWkbTypes::isMultiType( d->geometry->wkbType() );
+  return QgsWkbTypes::isMultiType( wkbType() );
 }
 
 void QgsGeometry::fromGeos( GEOSGeometry *geos )
 {
   detach( false );
-  delete d->geometry;
-  d->geometry = QgsGeos::fromGeos( geos );
+  d->deleteGeometry();
+  d->setGeometry( QgsGeos::fromGeos( geos ) );
   GEOSGeom_destroy_r( QgsGeos::getGEOSHandler(), geos );
 }
 
 QgsPoint QgsGeometry::closestVertex( const QgsPoint &point, int &atVertex, int &beforeVertex, int &afterVertex, double &sqrDist ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     sqrDist = -1;
     return QgsPoint( 0, 0 );
@@ -332,7 +570,7 @@ QgsPoint QgsGeometry::closestVertex( const QgsPoint &point, int &atVertex, int &
   QgsPointV2 pt( point.x(), point.y() );
   QgsVertexId id;
 
-  QgsPointV2 vp = QgsGeometryUtils::closestVertex( *( d->geometry ), pt, id );
+  QgsPointV2 vp = QgsGeometryUtils::closestVertex( *( d->geometry() ), pt, id );
   if ( !id.isValid() )
   {
     sqrDist = -1;
@@ -347,7 +585,7 @@ QgsPoint QgsGeometry::closestVertex( const QgsPoint &point, int &atVertex, int &
 
 double QgsGeometry::distanceToVertex( int vertex ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return -1;
   }
@@ -358,12 +596,12 @@ double QgsGeometry::distanceToVertex( int vertex ) const
     return -1;
   }
 
-  return QgsGeometryUtils::distanceToVertex( *( d->geometry ), id );
+  return QgsGeometryUtils::distanceToVertex( *( d->geometry() ), id );
 }
 
 double QgsGeometry::angleAtVertex( int vertex ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 0;
   }
@@ -376,26 +614,26 @@ double QgsGeometry::angleAtVertex( int vertex ) const
 
   QgsVertexId v1;
   QgsVertexId v3;
-  QgsGeometryUtils::adjacentVertices( *d->geometry, v2, v1, v3 );
+  QgsGeometryUtils::adjacentVertices( *d->geometry(), v2, v1, v3 );
   if ( v1.isValid() && v3.isValid() )
   {
-    QgsPointV2 p1 = d->geometry->vertexAt( v1 );
-    QgsPointV2 p2 = d->geometry->vertexAt( v2 );
-    QgsPointV2 p3 = d->geometry->vertexAt( v3 );
+    QgsPointV2 p1 = d->geometry()->vertexAt( v1 );
+    QgsPointV2 p2 = d->geometry()->vertexAt( v2 );
+    QgsPointV2 p3 = d->geometry()->vertexAt( v3 );
     double angle1 = QgsGeometryUtils::lineAngle( p1.x(), p1.y(), p2.x(), p2.y() );
     double angle2 = QgsGeometryUtils::lineAngle( p2.x(), p2.y(), p3.x(), p3.y() );
     return QgsGeometryUtils::averageAngle( angle1, angle2 );
   }
   else if ( v3.isValid() )
   {
-    QgsPointV2 p1 = d->geometry->vertexAt( v2 );
-    QgsPointV2 p2 = d->geometry->vertexAt( v3 );
+    QgsPointV2 p1 = d->geometry()->vertexAt( v2 );
+    QgsPointV2 p2 = d->geometry()->vertexAt( v3 );
     return QgsGeometryUtils::lineAngle( p1.x(), p1.y(), p2.x(), p2.y() );
   }
   else if ( v1.isValid() )
   {
-    QgsPointV2 p1 = d->geometry->vertexAt( v1 );
-    QgsPointV2 p2 = d->geometry->vertexAt( v2 );
+    QgsPointV2 p1 = d->geometry()->vertexAt( v1 );
+    QgsPointV2 p2 = d->geometry()->vertexAt( v2 );
     return QgsGeometryUtils::lineAngle( p1.x(), p1.y(), p2.x(), p2.y() );
   }
   return 0.0;
@@ -403,7 +641,7 @@ double QgsGeometry::angleAtVertex( int vertex ) const
 
 void QgsGeometry::adjacentVertices( int atVertex, int &beforeVertex, int &afterVertex ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return;
   }
@@ -417,14 +655,14 @@ void QgsGeometry::adjacentVertices( int atVertex, int &beforeVertex, int &afterV
   }
 
   QgsVertexId beforeVertexId, afterVertexId;
-  QgsGeometryUtils::adjacentVertices( *( d->geometry ), id, beforeVertexId, afterVertexId );
+  QgsGeometryUtils::adjacentVertices( *( d->geometry() ), id, beforeVertexId, afterVertexId );
   beforeVertex = vertexNrFromVertexId( beforeVertexId );
   afterVertex = vertexNrFromVertexId( afterVertexId );
 }
 
 bool QgsGeometry::moveVertex( double x, double y, int atVertex )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
@@ -437,12 +675,12 @@ bool QgsGeometry::moveVertex( double x, double y, int atVertex )
 
   detach( true );
 
-  return d->geometry->moveVertex( id, QgsPointV2( x, y ) );
+  return d->geometry()->moveVertex( id, QgsPointV2( x, y ) );
 }
 
 bool QgsGeometry::moveVertex( const QgsPointV2 &p, int atVertex )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
@@ -455,30 +693,30 @@ bool QgsGeometry::moveVertex( const QgsPointV2 &p, int atVertex )
 
   detach( true );
 
-  return d->geometry->moveVertex( id, p );
+  return d->geometry()->moveVertex( id, p );
 }
 
 bool QgsGeometry::deleteVertex( int atVertex )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
   //maintain compatibility with < 2.10 API
-  if ( QgsWkbTypes::flatType( d->geometry->wkbType() ) == QgsWkbTypes::MultiPoint )
+  if ( QgsWkbTypes::flatType( d->geometry()->wkbType() ) == QgsWkbTypes::MultiPoint )
   {
     detach( true );
     //delete geometry instead of point
-    return static_cast< QgsGeometryCollection * >( d->geometry )->removeGeometry( atVertex );
+    return static_cast< QgsGeometryCollection * >( d->geometry() )->removeGeometry( atVertex );
   }
 
   //if it is a point, set the geometry to nullptr
-  if ( QgsWkbTypes::flatType( d->geometry->wkbType() ) == QgsWkbTypes::Point )
+  if ( QgsWkbTypes::flatType( d->geometry()->wkbType() ) == QgsWkbTypes::Point )
   {
     detach( false );
-    delete d->geometry;
-    d->geometry = nullptr;
+    d->deleteGeometry();
+    d->setGeometry( nullptr );
     return true;
   }
 
@@ -490,22 +728,22 @@ bool QgsGeometry::deleteVertex( int atVertex )
 
   detach( true );
 
-  return d->geometry->deleteVertex( id );
+  return d->geometry()->deleteVertex( id );
 }
 
 bool QgsGeometry::insertVertex( double x, double y, int beforeVertex )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
   //maintain compatibility with < 2.10 API
-  if ( QgsWkbTypes::flatType( d->geometry->wkbType() ) == QgsWkbTypes::MultiPoint )
+  if ( QgsWkbTypes::flatType( d->geometry()->wkbType() ) == QgsWkbTypes::MultiPoint )
   {
     detach( true );
     //insert geometry instead of point
-    return static_cast< QgsGeometryCollection * >( d->geometry )->insertGeometry( new QgsPointV2( x, y ), beforeVertex );
+    return static_cast< QgsGeometryCollection * >( d->geometry() )->insertGeometry( new QgsPointV2( x, y ), beforeVertex );
   }
 
   QgsVertexId id;
@@ -516,22 +754,22 @@ bool QgsGeometry::insertVertex( double x, double y, int beforeVertex )
 
   detach( true );
 
-  return d->geometry->insertVertex( id, QgsPointV2( x, y ) );
+  return d->geometry()->insertVertex( id, QgsPointV2( x, y ) );
 }
 
 bool QgsGeometry::insertVertex( const QgsPointV2 &point, int beforeVertex )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
   //maintain compatibility with < 2.10 API
-  if ( QgsWkbTypes::flatType( d->geometry->wkbType() ) == QgsWkbTypes::MultiPoint )
+  if ( QgsWkbTypes::flatType( d->geometry()->wkbType() ) == QgsWkbTypes::MultiPoint )
   {
     detach( true );
     //insert geometry instead of point
-    return static_cast< QgsGeometryCollection * >( d->geometry )->insertGeometry( new QgsPointV2( point ), beforeVertex );
+    return static_cast< QgsGeometryCollection * >( d->geometry() )->insertGeometry( new QgsPointV2( point ), beforeVertex );
   }
 
   QgsVertexId id;
@@ -542,12 +780,12 @@ bool QgsGeometry::insertVertex( const QgsPointV2 &point, int beforeVertex )
 
   detach( true );
 
-  return d->geometry->insertVertex( id, point );
+  return d->geometry()->insertVertex( id, point );
 }
 
 QgsPoint QgsGeometry::vertexAt( int atVertex ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsPoint( 0, 0 );
   }
@@ -558,7 +796,7 @@ QgsPoint QgsGeometry::vertexAt( int atVertex ) const
   {
     return QgsPoint( 0, 0 );
   }
-  QgsPointV2 pt = d->geometry->vertexAt( vId );
+  QgsPointV2 pt = d->geometry()->vertexAt( vId );
   return QgsPoint( pt.x(), pt.y() );
 }
 
@@ -570,26 +808,26 @@ double QgsGeometry::sqrDistToVertexAt( QgsPoint &point, int atVertex ) const
 
 QgsGeometry QgsGeometry::nearestPoint( const QgsGeometry &other ) const
 {
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   return geos.closestPoint( other );
 }
 
 QgsGeometry QgsGeometry::shortestLine( const QgsGeometry &other ) const
 {
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   return geos.shortestLine( other );
 }
 
 double QgsGeometry::closestVertexWithContext( const QgsPoint &point, int &atVertex ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return -1;
   }
 
   QgsVertexId vId;
   QgsPointV2 pt( point.x(), point.y() );
-  QgsPointV2 closestPoint = QgsGeometryUtils::closestVertex( *( d->geometry ), pt, vId );
+  QgsPointV2 closestPoint = QgsGeometryUtils::closestVertex( *( d->geometry() ), pt, vId );
   if ( !vId.isValid() )
     return -1;
   atVertex = vertexNrFromVertexId( vId );
@@ -603,7 +841,7 @@ double QgsGeometry::closestSegmentWithContext(
   double *leftOf,
   double epsilon ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return -1;
   }
@@ -612,7 +850,7 @@ double QgsGeometry::closestSegmentWithContext(
   QgsVertexId vertexAfter;
   bool leftOfBool;
 
-  double sqrDist = d->geometry->closestSegment( QgsPointV2( point.x(), point.y() ), segmentPt,  vertexAfter, &leftOfBool, epsilon );
+  double sqrDist = d->geometry()->closestSegment( QgsPointV2( point.x(), point.y() ), segmentPt,  vertexAfter, &leftOfBool, epsilon );
   if ( sqrDist < 0 )
     return -1;
 
@@ -639,7 +877,7 @@ int QgsGeometry::addRing( const QList<QgsPoint> &ring )
 
 int QgsGeometry::addRing( QgsCurve *ring )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     delete ring;
     return 1;
@@ -647,7 +885,7 @@ int QgsGeometry::addRing( QgsCurve *ring )
 
   detach( true );
 
-  return QgsGeometryEditUtils::addRing( d->geometry, ring );
+  return QgsGeometryEditUtils::addRing( d->geometry(), ring );
 }
 
 int QgsGeometry::addPart( const QList<QgsPoint> &points, QgsWkbTypes::GeometryType geomType )
@@ -675,19 +913,19 @@ int QgsGeometry::addPart( const QgsPointSequence &points, QgsWkbTypes::GeometryT
 
 int QgsGeometry::addPart( QgsAbstractGeometry *part, QgsWkbTypes::GeometryType geomType )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     detach( false );
     switch ( geomType )
     {
       case QgsWkbTypes::PointGeometry:
-        d->geometry = new QgsMultiPointV2();
+        d->setGeometry( new QgsMultiPointV2() );
         break;
       case QgsWkbTypes::LineGeometry:
-        d->geometry = new QgsMultiLineString();
+        d->setGeometry( new QgsMultiLineString() );
         break;
       case QgsWkbTypes::PolygonGeometry:
-        d->geometry = new QgsMultiPolygonV2();
+        d->setGeometry( new QgsMultiPolygonV2() );
         break;
       default:
         return 1;
@@ -699,27 +937,27 @@ int QgsGeometry::addPart( QgsAbstractGeometry *part, QgsWkbTypes::GeometryType g
   }
 
   convertToMultiType();
-  return QgsGeometryEditUtils::addPart( d->geometry, part );
+  return QgsGeometryEditUtils::addPart( d->geometry(), part );
 }
 
 int QgsGeometry::addPart( const QgsGeometry &newPart )
 {
-  if ( !d->geometry || !newPart.d || !newPart.d->geometry )
+  if ( !d->geometry() || !newPart.d || !newPart.d->geometry() )
   {
     return 1;
   }
 
-  return addPart( newPart.d->geometry->clone() );
+  return addPart( newPart.d->geometry()->clone() );
 }
 
 QgsGeometry QgsGeometry::removeInteriorRings( double minimumRingArea ) const
 {
-  if ( !d->geometry || type() != QgsWkbTypes::PolygonGeometry )
+  if ( !d->geometry() || type() != QgsWkbTypes::PolygonGeometry )
   {
     return QgsGeometry();
   }
 
-  if ( QgsWkbTypes::isMultiType( d->geometry->wkbType() ) )
+  if ( QgsWkbTypes::isMultiType( d->geometry()->wkbType() ) )
   {
     QList<QgsGeometry> parts = asGeometryCollection();
     QList<QgsGeometry> results;
@@ -741,7 +979,7 @@ QgsGeometry QgsGeometry::removeInteriorRings( double minimumRingArea ) const
   }
   else
   {
-    QgsCurvePolygon *newPoly = static_cast< QgsCurvePolygon * >( d->geometry->clone() );
+    QgsCurvePolygon *newPoly = static_cast< QgsCurvePolygon * >( d->geometry()->clone() );
     newPoly->removeInteriorRings( minimumRingArea );
     return QgsGeometry( newPoly );
   }
@@ -749,7 +987,7 @@ QgsGeometry QgsGeometry::removeInteriorRings( double minimumRingArea ) const
 
 int QgsGeometry::addPart( GEOSGeometry *newPart )
 {
-  if ( !d->geometry || !newPart )
+  if ( !d->geometry() || !newPart )
   {
     return 1;
   }
@@ -757,25 +995,25 @@ int QgsGeometry::addPart( GEOSGeometry *newPart )
   detach( true );
 
   QgsAbstractGeometry *geom = QgsGeos::fromGeos( newPart );
-  return QgsGeometryEditUtils::addPart( d->geometry, geom );
+  return QgsGeometryEditUtils::addPart( d->geometry(), geom );
 }
 
 int QgsGeometry::translate( double dx, double dy )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 1;
   }
 
   detach( true );
 
-  d->geometry->transform( QTransform::fromTranslate( dx, dy ) );
+  d->geometry()->transform( QTransform::fromTranslate( dx, dy ) );
   return 0;
 }
 
 int QgsGeometry::rotate( double rotation, const QgsPoint &center )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 1;
   }
@@ -785,13 +1023,13 @@ int QgsGeometry::rotate( double rotation, const QgsPoint &center )
   QTransform t = QTransform::fromTranslate( center.x(), center.y() );
   t.rotate( -rotation );
   t.translate( -center.x(), -center.y() );
-  d->geometry->transform( t );
+  d->geometry()->transform( t );
   return 0;
 }
 
 int QgsGeometry::splitGeometry( const QList<QgsPoint> &splitLine, QList<QgsGeometry> &newGeometries, bool topological, QList<QgsPoint> &topologyTestPoints )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 0;
   }
@@ -803,13 +1041,13 @@ int QgsGeometry::splitGeometry( const QList<QgsPoint> &splitLine, QList<QgsGeome
   splitLineString.setPoints( splitLinePointsV2 );
   QgsPointSequence tp;
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   int result = geos.splitGeometry( splitLineString, newGeoms, topological, tp );
 
   if ( result == 0 )
   {
     detach( false );
-    d->geometry = newGeoms.at( 0 );
+    d->setGeometry( newGeoms.at( 0 ) );
 
     newGeometries.clear();
     for ( int i = 1; i < newGeoms.size(); ++i )
@@ -825,7 +1063,7 @@ int QgsGeometry::splitGeometry( const QList<QgsPoint> &splitLine, QList<QgsGeome
 //! Replaces a part of this geometry with another line
 int QgsGeometry::reshapeGeometry( const QList<QgsPoint> &reshapeWithLine )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 0;
   }
@@ -835,14 +1073,14 @@ int QgsGeometry::reshapeGeometry( const QList<QgsPoint> &reshapeWithLine )
   QgsLineString reshapeLineString;
   reshapeLineString.setPoints( reshapeLine );
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   int errorCode = 0;
   QgsAbstractGeometry *geom = geos.reshapeGeometry( reshapeLineString, &errorCode );
   if ( errorCode == 0 && geom )
   {
     detach( false );
-    delete d->geometry;
-    d->geometry = geom;
+    d->deleteGeometry();
+    d->setGeometry( geom );
     return 0;
   }
   return errorCode;
@@ -850,12 +1088,12 @@ int QgsGeometry::reshapeGeometry( const QList<QgsPoint> &reshapeWithLine )
 
 int QgsGeometry::makeDifference( const QgsGeometry *other )
 {
-  if ( !d->geometry || !other->d->geometry )
+  if ( !d->geometry() || !other->d->geometry() )
   {
     return 0;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
 
   QgsAbstractGeometry *diffGeom = geos.intersection( *( other->geometry() ) );
   if ( !diffGeom )
@@ -865,19 +1103,19 @@ int QgsGeometry::makeDifference( const QgsGeometry *other )
 
   detach( false );
 
-  delete d->geometry;
-  d->geometry = diffGeom;
+  d->deleteGeometry();
+  d->setGeometry( diffGeom );
   return 0;
 }
 
 QgsGeometry QgsGeometry::makeDifference( const QgsGeometry &other ) const
 {
-  if ( !d->geometry || other.isNull() )
+  if ( !d->geometry() || other.isNull() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
 
   QgsAbstractGeometry *diffGeom = geos.intersection( *other.geometry() );
   if ( !diffGeom )
@@ -890,9 +1128,14 @@ QgsGeometry QgsGeometry::makeDifference( const QgsGeometry &other ) const
 
 QgsRectangle QgsGeometry::boundingBox() const
 {
-  if ( d->geometry )
+  QgsRectangle bbox;
+  if ( d->pendingBoundingBox( bbox ) )
+  {
+    return bbox;
+  }
+  else if ( d->geometry() )
   {
-    return d->geometry->boundingBox();
+    return d->geometry()->boundingBox();
   }
   return QgsRectangle();
 }
@@ -905,7 +1148,7 @@ QgsGeometry QgsGeometry::orientedMinimumBoundingBox( double &area, double &angle
   width = DBL_MAX;
   height = DBL_MAX;
 
-  if ( !d->geometry || d->geometry->nCoordinates() < 2 )
+  if ( !d->geometry() || d->geometry()->nCoordinates() < 2 )
     return QgsGeometry();
 
   QgsGeometry hull = convexHull();
@@ -971,120 +1214,127 @@ bool QgsGeometry::intersects( const QgsRectangle &r ) const
 
 bool QgsGeometry::intersects( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.intersects( *geometry.d->geometry );
+  return evaluatePredicate( d, *geometry.d->geometry(), &QgsGeometryEngine::intersects );
+}
+
+QVector<bool> QgsGeometry::intersects( const QVector<QgsGeometry> &geometries ) const
+{
+  return evaluatePredicates( d, geometries, &QgsGeometryEngine::intersects );
 }
 
 bool QgsGeometry::contains( const QgsPoint *p ) const
 {
-  if ( !d->geometry || !p )
+  if ( !d->geometry() || !p )
   {
     return false;
   }
 
   QgsPointV2 pt( p->x(), p->y() );
-  QgsGeos geos( d->geometry );
-  return geos.contains( pt );
+  return evaluatePredicate( d, pt, &QgsGeometryEngine::contains );
 }
 
 bool QgsGeometry::contains( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.contains( *( geometry.d->geometry ) );
+  return evaluatePredicate( d, *geometry.d->geometry(), &QgsGeometryEngine::contains );
+}
+
+QVector<bool> QgsGeometry::contains( const QVector<QgsGeometry> &geometries ) const
+{
+  return evaluatePredicates( d, geometries, &QgsGeometryEngine::contains );
 }
 
 bool QgsGeometry::disjoint( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.disjoint( *( geometry.d->geometry ) );
+  return evaluatePredicate( d, *geometry.d->geometry(), &QgsGeometryEngine::disjoint );
 }
 
 bool QgsGeometry::equals( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.isEqual( *( geometry.d->geometry ) );
+  QgsGeos geos( d->geometry() );
+  return geos.isEqual( *( geometry.d->geometry() ) );
 }
 
 bool QgsGeometry::touches( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.touches( *( geometry.d->geometry ) );
+  return evaluatePredicate( d, *geometry.d->geometry(), &QgsGeometryEngine::touches );
 }
 
 bool QgsGeometry::overlaps( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.overlaps( *( geometry.d->geometry ) );
+  return evaluatePredicate( d, *geometry.d->geometry(), &QgsGeometryEngine::overlaps );
 }
 
 bool QgsGeometry::within( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.within( *( geometry.d->geometry ) );
+  return evaluatePredicate( d, *geometry.d->geometry(), &QgsGeometryEngine::within );
+}
+
+QVector<bool> QgsGeometry::within( const QVector<QgsGeometry> &geometries ) const
+{
+  return evaluatePredicates( d, geometries, &QgsGeometryEngine::within );
 }
 
 bool QgsGeometry::crosses( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.crosses( *( geometry.d->geometry ) );
+  return evaluatePredicate( d, *geometry.d->geometry(), &QgsGeometryEngine::crosses );
 }
 
 QString QgsGeometry::exportToWkt( int precision ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QString();
   }
-  return d->geometry->asWkt( precision );
+  return d->geometry()->asWkt( precision );
 }
 
 QString QgsGeometry::exportToGeoJSON( int precision ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QStringLiteral( "null" );
   }
-  return d->geometry->asJSON( precision );
+  return d->geometry()->asJSON( precision );
 }
 
 QgsGeometry QgsGeometry::convertToType( QgsWkbTypes::GeometryType destType, bool destMultipart ) const
@@ -1107,7 +1357,7 @@ QgsGeometry QgsGeometry::convertToType( QgsWkbTypes::GeometryType destType, bool
 
 bool QgsGeometry::convertToMultiType()
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
@@ -1118,21 +1368,21 @@ bool QgsGeometry::convertToMultiType()
   }
 
   QgsGeometryCollection *multiGeom = dynamic_cast<QgsGeometryCollection *>
-                                     ( QgsGeometryFactory::geomFromWkbType( QgsWkbTypes::multiType( d->geometry->wkbType() ) ) );
+                                     ( QgsGeometryFactory::geomFromWkbType( QgsWkbTypes::multiType( d->geometry()->wkbType() ) ) );
   if ( !multiGeom )
   {
     return false;
   }
 
   detach( true );
-  multiGeom->addGeometry( d->geometry );
-  d->geometry = multiGeom;
+  multiGeom->addGeometry( d->geometry() );
+  d->setGeometry( multiGeom );
   return true;
 }
 
 bool QgsGeometry::convertToSingleType()
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
@@ -1142,24 +1392,24 @@ bool QgsGeometry::convertToSingleType()
     return true;
   }
 
-  QgsGeometryCollection *multiGeom = dynamic_cast<QgsGeometryCollection *>( d->geometry );
+  QgsGeometryCollection *multiGeom = dynamic_cast<QgsGeometryCollection *>( d->geometry() );
   if ( !multiGeom || multiGeom->partCount() < 1 )
     return false;
 
   QgsAbstractGeometry *firstPart = multiGeom->geometryN( 0 )->clone();
   detach( false );
 
-  d->geometry = firstPart;
+  d->setGeometry( firstPart );
   return true;
 }
 
 QgsPoint QgsGeometry::asPoint() const
 {
-  if ( !d->geometry || QgsWkbTypes::flatType( d->geometry->wkbType() ) != QgsWkbTypes::Point )
+  if ( !d->geometry() || QgsWkbTypes::flatType( d->geometry()->wkbType() ) != QgsWkbTypes::Point )
   {
     return QgsPoint();
   }
-  QgsPointV2 *pt = dynamic_cast<QgsPointV2 *>( d->geometry );
+  QgsPointV2 *pt = dynamic_cast<QgsPointV2 *>( d->geometry() );
   if ( !pt )
   {
     return QgsPoint();
@@ -1171,17 +1421,17 @@ QgsPoint QgsGeometry::asPoint() const
 QgsPolyline QgsGeometry::asPolyline() const
 {
   QgsPolyline polyLine;
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return polyLine;
   }
 
-  bool doSegmentation = ( QgsWkbTypes::flatType( d->geometry->wkbType() ) == QgsWkbTypes::CompoundCurve
-                          || QgsWkbTypes::flatType( d->geometry->wkbType() ) == QgsWkbTypes::CircularString );
+  bool doSegmentation = ( QgsWkbTypes::flatType( d->geometry()->wkbType() ) == QgsWkbTypes::CompoundCurve
+                          || QgsWkbTypes::flatType( d->geometry()->wkbType() ) == QgsWkbTypes::CircularString );
   QgsLineString *line = nullptr;
   if ( doSegmentation )
   {
-    QgsCurve *curve = dynamic_cast<QgsCurve *>( d->geometry );
+    QgsCurve *curve = dynamic_cast<QgsCurve *>( d->geometry() );
     if ( !curve )
     {
       return polyLine;
@@ -1190,7 +1440,7 @@ QgsPolyline QgsGeometry::asPolyline() const
   }
   else
   {
-    line = dynamic_cast<QgsLineString *>( d->geometry );
+    line = dynamic_cast<QgsLineString *>( d->geometry() );
     if ( !line )
     {
       return polyLine;
@@ -1216,15 +1466,15 @@ QgsPolyline QgsGeometry::asPolyline() const
 
 QgsPolygon QgsGeometry::asPolygon() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
     return QgsPolygon();
 
-  bool doSegmentation = ( QgsWkbTypes::flatType( d->geometry->wkbType() ) == QgsWkbTypes::CurvePolygon );
+  bool doSegmentation = ( QgsWkbTypes::flatType( d->geometry()->wkbType() ) == QgsWkbTypes::CurvePolygon );
 
   QgsPolygonV2 *p = nullptr;
   if ( doSegmentation )
   {
-    QgsCurvePolygon *curvePoly = dynamic_cast<QgsCurvePolygon *>( d->geometry );
+    QgsCurvePolygon *curvePoly = dynamic_cast<QgsCurvePolygon *>( d->geometry() );
     if ( !curvePoly )
     {
       return QgsPolygon();
@@ -1233,7 +1483,7 @@ QgsPolygon QgsGeometry::asPolygon() const
   }
   else
   {
-    p = dynamic_cast<QgsPolygonV2 *>( d->geometry );
+    p = dynamic_cast<QgsPolygonV2 *>( d->geometry() );
   }
 
   if ( !p )
@@ -1253,12 +1503,12 @@ QgsPolygon QgsGeometry::asPolygon() const
 
 QgsMultiPoint QgsGeometry::asMultiPoint() const
 {
-  if ( !d->geometry || QgsWkbTypes::flatType( d->geometry->wkbType() ) != QgsWkbTypes::MultiPoint )
+  if ( !d->geometry() || QgsWkbTypes::flatType( d->geometry()->wkbType() ) != QgsWkbTypes::MultiPoint )
   {
     return QgsMultiPoint();
   }
 
-  const QgsMultiPointV2 *mp = dynamic_cast<QgsMultiPointV2 *>( d->geometry );
+  const QgsMultiPointV2 *mp = dynamic_cast<QgsMultiPointV2 *>( d->geometry() );
   if ( !mp )
   {
     return QgsMultiPoint();
@@ -1277,12 +1527,12 @@ QgsMultiPoint QgsGeometry::asMultiPoint() const
 
 QgsMultiPolyline QgsGeometry::asMultiPolyline() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsMultiPolyline();
   }
 
-  QgsGeometryCollection *geomCollection = dynamic_cast<QgsGeometryCollection *>( d->geometry );
+  QgsGeometryCollection *geomCollection = dynamic_cast<QgsGeometryCollection *>( d->geometry() );
   if ( !geomCollection )
   {
     return QgsMultiPolyline();
@@ -1326,12 +1576,12 @@ QgsMultiPolyline QgsGeometry::asMultiPolyline() const
 
 QgsMultiPolygon QgsGeometry::asMultiPolygon() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsMultiPolygon();
   }
 
-  QgsGeometryCollection *geomCollection = dynamic_cast<QgsGeometryCollection *>( d->geometry );
+  QgsGeometryCollection *geomCollection = dynamic_cast<QgsGeometryCollection *>( d->geometry() );
   if ( !geomCollection )
   {
     return QgsMultiPolygon();
@@ -1369,17 +1619,17 @@ QgsMultiPolygon QgsGeometry::asMultiPolygon() const
 
 double QgsGeometry::area() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return -1.0;
   }
-  QgsGeos g( d->geometry );
+  QgsGeos g( d->geometry() );
 
 #if 0
   //debug: compare geos area with calculation in QGIS
   double geosArea = g.area();
   double qgisArea = 0;
-  QgsSurface *surface = dynamic_cast<QgsSurface *>( d->geometry );
+  QgsSurface *surface = dynamic_cast<QgsSurface *>( d->geometry() );
   if ( surface )
   {
     qgisArea = surface->area();
@@ -1391,33 +1641,33 @@ double QgsGeometry::area() const
 
 double QgsGeometry::length() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return -1.0;
   }
-  QgsGeos g( d->geometry );
+  QgsGeos g( d->geometry() );
   return g.length();
 }
 
 double QgsGeometry::distance( const QgsGeometry &geom ) const
 {
-  if ( !d->geometry || !geom.d->geometry )
+  if ( !d->geometry() || !geom.d->geometry() )
   {
     return -1.0;
   }
 
-  QgsGeos g( d->geometry );
-  return g.distance( *( geom.d->geometry ) );
+  QgsGeos g( d->geometry() );
+  return g.distance( *( geom.d->geometry() ) );
 }
 
 QgsGeometry QgsGeometry::buffer( double distance, int segments ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos g( d->geometry );
+  QgsGeos g( d->geometry() );
   QgsAbstractGeometry *geom = g.buffer( distance, segments );
   if ( !geom )
   {
@@ -1428,12 +1678,12 @@ QgsGeometry QgsGeometry::buffer( double distance, int segments ) const
 
 QgsGeometry QgsGeometry::buffer( double distance, int segments, EndCapStyle endCapStyle, JoinStyle joinStyle, double mitreLimit ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos g( d->geometry );
+  QgsGeos g( d->geometry() );
   QgsAbstractGeometry *geom = g.buffer( distance, segments, endCapStyle, joinStyle, mitreLimit );
   if ( !geom )
   {
@@ -1444,12 +1694,12 @@ QgsGeometry QgsGeometry::buffer( double distance, int segments, EndCapStyle endC
 
 QgsGeometry QgsGeometry::offsetCurve( double distance, int segments, JoinStyle joinStyle, double mitreLimit ) const
 {
-  if ( !d->geometry || type() != QgsWkbTypes::LineGeometry )
+  if ( !d->geometry() || type() != QgsWkbTypes::LineGeometry )
   {
     return QgsGeometry();
   }
 
-  if ( QgsWkbTypes::isMultiType( d->geometry->wkbType() ) )
+  if ( QgsWkbTypes::isMultiType( d->geometry()->wkbType() ) )
   {
     QList<QgsGeometry> parts = asGeometryCollection();
     QList<QgsGeometry> results;
@@ -1471,7 +1721,7 @@ QgsGeometry QgsGeometry::offsetCurve( double distance, int segments, JoinStyle j
   }
   else
   {
-    QgsGeos geos( d->geometry );
+    QgsGeos geos( d->geometry() );
     QgsAbstractGeometry *offsetGeom = geos.offsetCurve( distance, segments, joinStyle, mitreLimit );
     if ( !offsetGeom )
     {
@@ -1483,12 +1733,12 @@ QgsGeometry QgsGeometry::offsetCurve( double distance, int segments, JoinStyle j
 
 QgsGeometry QgsGeometry::singleSidedBuffer( double distance, int segments, BufferSide side, JoinStyle joinStyle, double mitreLimit ) const
 {
-  if ( !d->geometry || type() != QgsWkbTypes::LineGeometry )
+  if ( !d->geometry() || type() != QgsWkbTypes::LineGeometry )
   {
     return QgsGeometry();
   }
 
-  if ( QgsWkbTypes::isMultiType( d->geometry->wkbType() ) )
+  if ( QgsWkbTypes::isMultiType( d->geometry()->wkbType() ) )
   {
     QList<QgsGeometry> parts = asGeometryCollection();
     QList<QgsGeometry> results;
@@ -1510,7 +1760,7 @@ QgsGeometry QgsGeometry::singleSidedBuffer( double distance, int segments, Buffe
   }
   else
   {
-    QgsGeos geos( d->geometry );
+    QgsGeos geos( d->geometry() );
     QgsAbstractGeometry *bufferGeom = geos.singleSidedBuffer( distance, segments, side,
                                       joinStyle, mitreLimit );
     if ( !bufferGeom )
@@ -1523,12 +1773,12 @@ QgsGeometry QgsGeometry::singleSidedBuffer( double distance, int segments, Buffe
 
 QgsGeometry QgsGeometry::extendLine( double startDistance, double endDistance ) const
 {
-  if ( !d->geometry || type() != QgsWkbTypes::LineGeometry )
+  if ( !d->geometry() || type() != QgsWkbTypes::LineGeometry )
   {
     return QgsGeometry();
   }
 
-  if ( QgsWkbTypes::isMultiType( d->geometry->wkbType() ) )
+  if ( QgsWkbTypes::isMultiType( d->geometry()->wkbType() ) )
   {
     QList<QgsGeometry> parts = asGeometryCollection();
     QList<QgsGeometry> results;
@@ -1550,7 +1800,7 @@ QgsGeometry QgsGeometry::extendLine( double startDistance, double endDistance )
   }
   else
   {
-    QgsLineString *line = dynamic_cast< QgsLineString * >( d->geometry );
+    QgsLineString *line = dynamic_cast< QgsLineString * >( d->geometry() );
     if ( !line )
       return QgsGeometry();
 
@@ -1562,12 +1812,12 @@ QgsGeometry QgsGeometry::extendLine( double startDistance, double endDistance )
 
 QgsGeometry QgsGeometry::simplify( double tolerance ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   QgsAbstractGeometry *simplifiedGeom = geos.simplify( tolerance );
   if ( !simplifiedGeom )
   {
@@ -1578,12 +1828,12 @@ QgsGeometry QgsGeometry::simplify( double tolerance ) const
 
 QgsGeometry QgsGeometry::centroid() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   QgsPointV2 centroid;
   bool ok = geos.centroid( centroid );
   if ( !ok )
@@ -1595,12 +1845,12 @@ QgsGeometry QgsGeometry::centroid() const
 
 QgsGeometry QgsGeometry::pointOnSurface() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   QgsPointV2 pt;
   bool ok = geos.pointOnSurface( pt );
   if ( !ok )
@@ -1619,11 +1869,11 @@ QgsGeometry QgsGeometry::poleOfInaccessibility( double precision, double *distan
 
 QgsGeometry QgsGeometry::convexHull() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   QgsAbstractGeometry *cHull = geos.convexHull();
   if ( !cHull )
   {
@@ -1634,36 +1884,36 @@ QgsGeometry QgsGeometry::convexHull() const
 
 QgsGeometry QgsGeometry::voronoiDiagram( const QgsGeometry &extent, double tolerance, bool edgesOnly ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   return geos.voronoiDiagram( extent.geometry(), tolerance, edgesOnly );
 }
 
 QgsGeometry QgsGeometry::delaunayTriangulation( double tolerance, bool edgesOnly ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   return geos.delaunayTriangulation( tolerance, edgesOnly );
 }
 
 QgsGeometry QgsGeometry::interpolate( double distance ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
   QgsGeometry line = *this;
   if ( type() == QgsWkbTypes::PolygonGeometry )
-    line = QgsGeometry( d->geometry->boundary() );
+    line = QgsGeometry( d->geometry()->boundary() );
 
   QgsGeos geos( line.geometry() );
   QgsAbstractGeometry *result = geos.interpolate( distance );
@@ -1685,23 +1935,23 @@ double QgsGeometry::lineLocatePoint( const QgsGeometry &point ) const
   QgsGeometry segmentized = *this;
   if ( QgsWkbTypes::isCurvedType( wkbType() ) )
   {
-    segmentized = QgsGeometry( static_cast< QgsCurve * >( d->geometry )->segmentize() );
+    segmentized = QgsGeometry( static_cast< QgsCurve * >( d->geometry() )->segmentize() );
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.lineLocatePoint( *( static_cast< QgsPointV2 * >( point.d->geometry ) ) );
+  QgsGeos geos( d->geometry() );
+  return geos.lineLocatePoint( *( static_cast< QgsPointV2 * >( point.d->geometry() ) ) );
 }
 
 double QgsGeometry::interpolateAngle( double distance ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
     return 0.0;
 
   // always operate on segmentized geometries
   QgsGeometry segmentized = *this;
   if ( QgsWkbTypes::isCurvedType( wkbType() ) )
   {
-    segmentized = QgsGeometry( static_cast< QgsCurve * >( d->geometry )->segmentize() );
+    segmentized = QgsGeometry( static_cast< QgsCurve * >( d->geometry() )->segmentize() );
   }
 
   QgsVertexId previous;
@@ -1748,27 +1998,27 @@ double QgsGeometry::interpolateAngle( double distance ) const
 
 QgsGeometry QgsGeometry::intersection( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
 
-  QgsAbstractGeometry *resultGeom = geos.intersection( *( geometry.d->geometry ) );
+  QgsAbstractGeometry *resultGeom = geos.intersection( *( geometry.d->geometry() ) );
   return QgsGeometry( resultGeom );
 }
 
 QgsGeometry QgsGeometry::combine( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
 
-  QgsAbstractGeometry *resultGeom = geos.combine( *( geometry.d->geometry ) );
+  QgsAbstractGeometry *resultGeom = geos.combine( *( geometry.d->geometry() ) );
   if ( !resultGeom )
   {
     return QgsGeometry();
@@ -1778,31 +2028,31 @@ QgsGeometry QgsGeometry::combine( const QgsGeometry &geometry ) const
 
 QgsGeometry QgsGeometry::mergeLines() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
-  if ( QgsWkbTypes::flatType( d->geometry->wkbType() ) == QgsWkbTypes::LineString )
+  if ( QgsWkbTypes::flatType( d->geometry()->wkbType() ) == QgsWkbTypes::LineString )
   {
     // special case - a single linestring was passed
     return QgsGeometry( *this );
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   return geos.mergeLines();
 }
 
 QgsGeometry QgsGeometry::difference( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
 
-  QgsAbstractGeometry *resultGeom = geos.difference( *( geometry.d->geometry ) );
+  QgsAbstractGeometry *resultGeom = geos.difference( *( geometry.d->geometry() ) );
   if ( !resultGeom )
   {
     return QgsGeometry();
@@ -1812,14 +2062,14 @@ QgsGeometry QgsGeometry::difference( const QgsGeometry &geometry ) const
 
 QgsGeometry QgsGeometry::symDifference( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
 
-  QgsAbstractGeometry *resultGeom = geos.symDifference( *( geometry.d->geometry ) );
+  QgsAbstractGeometry *resultGeom = geos.symDifference( *( geometry.d->geometry() ) );
   if ( !resultGeom )
   {
     return QgsGeometry();
@@ -1836,18 +2086,18 @@ QgsGeometry QgsGeometry::extrude( double x, double y )
 
 QByteArray QgsGeometry::exportToWkb() const
 {
-  return d->geometry ? d->geometry->asWkb() : QByteArray();
+  return d->geometry() ? d->geometry()->asWkb() : QByteArray();
 }
 
 QList<QgsGeometry> QgsGeometry::asGeometryCollection() const
 {
   QList<QgsGeometry> geometryList;
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return geometryList;
   }
 
-  QgsGeometryCollection *gc = dynamic_cast<QgsGeometryCollection *>( d->geometry );
+  QgsGeometryCollection *gc = dynamic_cast<QgsGeometryCollection *>( d->geometry() );
   if ( gc )
   {
     int numGeom = gc->numGeometries();
@@ -1859,7 +2109,7 @@ QList<QgsGeometry> QgsGeometry::asGeometryCollection() const
   }
   else //a singlepart geometry
   {
-    geometryList.append( QgsGeometry( d->geometry->clone() ) );
+    geometryList.append( QgsGeometry( d->geometry()->clone() ) );
   }
 
   return geometryList;
@@ -1902,19 +2152,19 @@ QPolygonF QgsGeometry::asQPolygonF() const
 
 bool QgsGeometry::deleteRing( int ringNum, int partNum )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
   detach( true );
-  bool ok = QgsGeometryEditUtils::deleteRing( d->geometry, ringNum, partNum );
+  bool ok = QgsGeometryEditUtils::deleteRing( d->geometry(), ringNum, partNum );
   return ok;
 }
 
 bool QgsGeometry::deletePart( int partNum )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
@@ -1926,22 +2176,22 @@ bool QgsGeometry::deletePart( int partNum )
   }
 
   detach( true );
-  bool ok = QgsGeometryEditUtils::deletePart( d->geometry, partNum );
+  bool ok = QgsGeometryEditUtils::deletePart( d->geometry(), partNum );
   return ok;
 }
 
 int QgsGeometry::avoidIntersections( const QList<QgsVectorLayer *> &avoidIntersectionsLayers, const QHash<QgsVectorLayer *, QSet<QgsFeatureId> > &ignoreFeatures )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 1;
   }
 
-  QgsAbstractGeometry *diffGeom = QgsGeometryEditUtils::avoidIntersections( *( d->geometry ), avoidIntersectionsLayers, ignoreFeatures );
+  QgsAbstractGeometry *diffGeom = QgsGeometryEditUtils::avoidIntersections( *( d->geometry() ), avoidIntersectionsLayers, ignoreFeatures );
   if ( diffGeom )
   {
     detach( false );
-    d->geometry = diffGeom;
+    d->setGeometry( diffGeom );
   }
   return 0;
 }
@@ -1949,11 +2199,11 @@ int QgsGeometry::avoidIntersections( const QList<QgsVectorLayer *> &avoidInterse
 
 QgsGeometry QgsGeometry::makeValid()
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
     return QgsGeometry();
 
   QString errorMsg;
-  QgsAbstractGeometry *g = _qgis_lwgeom_make_valid( *d->geometry, errorMsg );
+  QgsAbstractGeometry *g = _qgis_lwgeom_make_valid( *d->geometry(), errorMsg );
   if ( !g )
     return QgsGeometry();
 
@@ -1968,24 +2218,24 @@ void QgsGeometry::validateGeometry( QList<Error> &errors )
 
 bool QgsGeometry::isGeosValid() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   return geos.isValid();
 }
 
 bool QgsGeometry::isGeosEqual( const QgsGeometry &g ) const
 {
-  if ( !d->geometry || !g.d->geometry )
+  if ( !d->geometry() || !g.d->geometry() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.isEqual( *( g.d->geometry ) );
+  QgsGeos geos( d->geometry() );
+  return geos.isEqual( *( g.d->geometry() ) );
 }
 
 QgsGeometry QgsGeometry::unaryUnion( const QList<QgsGeometry> &geometries )
@@ -2025,67 +2275,67 @@ QgsGeometry QgsGeometry::polygonize( const QList<QgsGeometry> &geometryList )
 
 void QgsGeometry::convertToStraightSegment()
 {
-  if ( !d->geometry || !requiresConversionToStraightSegments() )
+  if ( !d->geometry() || !requiresConversionToStraightSegments() )
   {
     return;
   }
 
-  QgsAbstractGeometry *straightGeom = d->geometry->segmentize();
+  QgsAbstractGeometry *straightGeom = d->geometry()->segmentize();
   detach( false );
 
-  d->geometry = straightGeom;
+  d->setGeometry( straightGeom );
 }
 
 bool QgsGeometry::requiresConversionToStraightSegments() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
-  return d->geometry->hasCurvedSegments();
+  return d->geometry()->hasCurvedSegments();
 }
 
 int QgsGeometry::transform( const QgsCoordinateTransform &ct )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 1;
   }
 
   detach();
-  d->geometry->transform( ct );
+  d->geometry()->transform( ct );
   return 0;
 }
 
 int QgsGeometry::transform( const QTransform &ct )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 1;
   }
 
   detach();
-  d->geometry->transform( ct );
+  d->geometry()->transform( ct );
   return 0;
 }
 
 void QgsGeometry::mapToPixel( const QgsMapToPixel &mtp )
 {
-  if ( d->geometry )
+  if ( d->geometry() )
   {
     detach();
-    d->geometry->transform( mtp.transform() );
+    d->geometry()->transform( mtp.transform() );
   }
 }
 
 #if 0
 void QgsGeometry::clip( const QgsRectangle &rect )
 {
-  if ( d->geometry )
+  if ( d->geometry() )
   {
     detach();
-    d->geometry->clip( rect );
+    d->geometry()->clip( rect );
     removeWkbGeos();
   }
 }
@@ -2093,20 +2343,20 @@ void QgsGeometry::clip( const QgsRectangle &rect )
 
 void QgsGeometry::draw( QPainter &p ) const
 {
-  if ( d->geometry )
+  if ( d->geometry() )
   {
-    d->geometry->draw( p );
+    d->geometry()->draw( p );
   }
 }
 
 bool QgsGeometry::vertexIdFromVertexNr( int nr, QgsVertexId &id ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
-  QgsCoordinateSequence coords = d->geometry->coordinateSequence();
+  QgsCoordinateSequence coords = d->geometry()->coordinateSequence();
 
   int vertexCount = 0;
   for ( int part = 0; part < coords.size(); ++part )
@@ -2133,12 +2383,12 @@ bool QgsGeometry::vertexIdFromVertexNr( int nr, QgsVertexId &id ) const
 
 int QgsGeometry::vertexNrFromVertexId( QgsVertexId id ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return -1;
   }
 
-  QgsCoordinateSequence coords = d->geometry->coordinateSequence();
+  QgsCoordinateSequence coords = d->geometry()->coordinateSequence();
 
   int vertexCount = 0;
   for ( int part = 0; part < coords.size(); ++part )
@@ -2182,7 +2432,7 @@ void QgsGeometry::convertPointList( const QgsPointSequence &input, QList<QgsPoin
 
 QgsGeometry::operator bool() const
 {
-  return d->geometry;
+  return !d->isNull();
 }
 
 void QgsGeometry::convertToPolyline( const QgsPointSequence &input, QgsPolyline &output )
@@ -2296,12 +2546,12 @@ bool QgsGeometry::compare( const QgsMultiPolygon &p1, const QgsMultiPolygon &p2,
 
 QgsGeometry QgsGeometry::smooth( const unsigned int iterations, const double offset, double minimumDistance, double maxAngle ) const
 {
-  if ( d->geometry->isEmpty() )
+  if ( d->geometry()->isEmpty() )
     return QgsGeometry();
 
   QgsGeometry geom = *this;
   if ( QgsWkbTypes::isCurvedType( wkbType() ) )
-    geom = QgsGeometry( d->geometry->segmentize() );
+    geom = QgsGeometry( d->geometry()->segmentize() );
 
   switch ( QgsWkbTypes::flatType( geom.wkbType() ) )
   {
@@ -2312,13 +2562,13 @@ QgsGeometry QgsGeometry::smooth( const unsigned int iterations, const double off
 
     case QgsWkbTypes::LineString:
     {
-      QgsLineString *lineString = static_cast< QgsLineString * >( d->geometry );
+      QgsLineString *lineString = static_cast< QgsLineString * >( d->geometry() );
       return QgsGeometry( smoothLine( *lineString, iterations, offset, minimumDistance, maxAngle ) );
     }
 
     case QgsWkbTypes::MultiLineString:
     {
-      QgsMultiLineString *multiLine = static_cast< QgsMultiLineString * >( d->geometry );
+      QgsMultiLineString *multiLine = static_cast< QgsMultiLineString * >( d->geometry() );
 
       QgsMultiLineString *resultMultiline = new QgsMultiLineString();
       for ( int i = 0; i < multiLine->numGeometries(); ++i )
@@ -2330,13 +2580,13 @@ QgsGeometry QgsGeometry::smooth( const unsigned int iterations, const double off
 
     case QgsWkbTypes::Polygon:
     {
-      QgsPolygonV2 *poly = static_cast< QgsPolygonV2 * >( d->geometry );
+      QgsPolygonV2 *poly = static_cast< QgsPolygonV2 * >( d->geometry() );
       return QgsGeometry( smoothPolygon( *poly, iterations, offset, minimumDistance, maxAngle ) );
     }
 
     case QgsWkbTypes::MultiPolygon:
     {
-      QgsMultiPolygonV2 *multiPoly = static_cast< QgsMultiPolygonV2 * >( d->geometry );
+      QgsMultiPolygonV2 *multiPoly = static_cast< QgsMultiPolygonV2 * >( d->geometry() );
 
       QgsMultiPolygonV2 *resultMultiPoly = new QgsMultiPolygonV2();
       for ( int i = 0; i < multiPoly->numGeometries(); ++i )
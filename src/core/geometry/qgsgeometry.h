@@ -64,6 +64,7 @@ typedef QVector<QgsPolygon> QgsMultiPolygon;
 class QgsRectangle;
 
 class QgsConstWkbPtr;
+class QgsWkbGeometryView;
 
 struct QgsGeometryPrivate;
 
@@ -99,7 +100,8 @@ class CORE_EXPORT QgsGeometry
 
     ~QgsGeometry();
 
-    /** Returns the underlying geometry store.
+    /** Returns the underlying geometry store. The prepared geometries cached by the
+    * predicates are discarded, since the geometry may be modified through the returned pointer.
     * @note added in QGIS 2.10
     * @see setGeometry
     */
@@ -153,11 +155,23 @@ class CORE_EXPORT QgsGeometry
     void fromWkb( unsigned char *wkb, int length );
 
     /**
-     * Set the geometry, feeding in the buffer containing OGC Well-Known Binary
+     * Set the geometry, feeding in the buffer containing OGC Well-Known Binary.
+     * Points, line strings, polygons and their multi types are parsed on the first call
+     * which needs the geometry, until then the buffer is shared and can be read
+     * with wkbView().
      * @note added in 3.0
      */
     void fromWkb( const QByteArray &wkb );
 
+    /**
+     * Returns a read-only view over the WKB the geometry was created from with fromWkb(),
+     * as long as it has not been parsed. Once the geometry is parsed, e.g. because it
+     * was modified or geometry() was called, the returned view is not valid.
+     * @note added in QGIS 3.0
+     * @note not available in Python bindings
+     */
+    QgsWkbGeometryView wkbView() const;
+
     /** Returns a geos geometry - caller takes ownership of the object (should be deleted with GEOSGeom_destroy_r)
      *  @param precision The precision of the grid to which to snap the geometry vertices. If 0, no snapping is performed.
      *  @note added in 3.0
@@ -507,6 +521,14 @@ class CORE_EXPORT QgsGeometry
     //! Test for intersection with a geometry (uses GEOS)
     bool intersects( const QgsGeometry &geometry ) const;
 
+    /** Tests for intersection with each geometry of a list (uses GEOS). The geometry is
+     * prepared once, and large lists are processed by several threads.
+     * @returns a list of the results, in the order of the geometries
+     * @note not available in Python bindings
+     * @note added in QGIS 3.0
+     */
+    QVector<bool> intersects( const QVector<QgsGeometry> &geometries ) const;
+
     //! Test for containment of a point (uses GEOS)
     bool contains( const QgsPoint *p ) const;
 
@@ -514,6 +536,14 @@ class CORE_EXPORT QgsGeometry
      *  @note added in 1.5 */
     bool contains( const QgsGeometry &geometry ) const;
 
+    /** Tests if each geometry of a list is contained in this geometry (uses GEOS). The geometry
+     * is prepared once, and large lists are processed by several threads.
+     * @returns a list of the results, in the order of the geometries
+     * @note not available in Python bindings
+     * @note added in QGIS 3.0
+     */
+    QVector<bool> contains( const QVector<QgsGeometry> &geometries ) const;
+
     /** Test for if geometry is disjoint of another (uses GEOS)
      *  @note added in 1.5 */
     bool disjoint( const QgsGeometry &geometry ) const;
@@ -534,6 +564,14 @@ class CORE_EXPORT QgsGeometry
      *  @note added in 1.5 */
     bool within( const QgsGeometry &geometry ) const;
 
+    /** Tests if this geometry is within each geometry of a list (uses GEOS). The geometry
+     * is prepared once, and large lists are processed by several threads.
+     * @returns a list of the results, in the order of the geometries
+     * @note not available in Python bindings
+     * @note added in QGIS 3.0
+     */
+    QVector<bool> within( const QVector<QgsGeometry> &geometries ) const;
+
     /** Test for if geometry crosses another (uses GEOS)
      *  @note added in 1.5 */
     bool crosses( const QgsGeometry &geometry ) const;
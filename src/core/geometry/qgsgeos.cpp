@@ -29,6 +29,7 @@ email                : marco.hugentobler at sourcepole dot com
 #include <limits>
 #include <cstdio>
 #include <QtCore/qmath.h>
+#include <QThreadStorage>
 
 #define DEFAULT_QUADRANT_SEGMENTS 8
 
@@ -103,7 +104,20 @@ class GEOSInit
     GEOSInit &operator=( const GEOSInit &rh );
 };
 
-static GEOSInit geosinit;
+/**
+ * GEOS context of the current thread. Contexts hold the message handlers and their
+ * buffers, threads using a single context would overwrite each other's messages.
+ */
+static QThreadStorage< GEOSInit * > sGeosInit;
+
+static GEOSInit *geosinit()
+{
+  if ( !sGeosInit.hasLocalData() )
+  {
+    sGeosInit.setLocalData( new GEOSInit() );
+  }
+  return sGeosInit.localData();
+}
 
 ///@endcond
 
@@ -116,12 +130,12 @@ class GEOSGeomScopedPtr
 {
   public:
     explicit GEOSGeomScopedPtr( GEOSGeometry *geom = nullptr ) : mGeom( geom ) {}
-    ~GEOSGeomScopedPtr() { GEOSGeom_destroy_r( geosinit.ctxt, mGeom ); }
+    ~GEOSGeomScopedPtr() { GEOSGeom_destroy_r( geosinit()->ctxt, mGeom ); }
     GEOSGeometry *get() const { return mGeom; }
     operator bool() const { return nullptr != mGeom; }
     void reset( GEOSGeometry *geom )
     {
-      GEOSGeom_destroy_r( geosinit.ctxt, mGeom );
+      GEOSGeom_destroy_r( geosinit()->ctxt, mGeom );
       mGeom = geom;
     }
 
@@ -144,28 +158,28 @@ QgsGeos::QgsGeos( const QgsAbstractGeometry *geometry, double precision )
 
 QgsGeos::~QgsGeos()
 {
-  GEOSGeom_destroy_r( geosinit.ctxt, mGeos );
+  GEOSGeom_destroy_r( geosinit()->ctxt, mGeos );
   mGeos = nullptr;
-  GEOSPreparedGeom_destroy_r( geosinit.ctxt, mGeosPrepared );
+  GEOSPreparedGeom_destroy_r( geosinit()->ctxt, mGeosPrepared );
   mGeosPrepared = nullptr;
 }
 
 void QgsGeos::geometryChanged()
 {
-  GEOSGeom_destroy_r( geosinit.ctxt, mGeos );
+  GEOSGeom_destroy_r( geosinit()->ctxt, mGeos );
   mGeos = nullptr;
-  GEOSPreparedGeom_destroy_r( geosinit.ctxt, mGeosPrepared );
+  GEOSPreparedGeom_destroy_r( geosinit()->ctxt, mGeosPrepared );
   mGeosPrepared = nullptr;
   cacheGeos();
 }
 
 void QgsGeos::prepareGeometry()
 {
-  GEOSPreparedGeom_destroy_r( geosinit.ctxt, mGeosPrepared );
+  GEOSPreparedGeom_destroy_r( geosinit()->ctxt, mGeosPrepared );
   mGeosPrepared = nullptr;
   if ( mGeos )
   {
-    mGeosPrepared = GEOSPrepare_r( geosinit.ctxt, mGeos );
+    mGeosPrepared = GEOSPrepare_r( geosinit()->ctxt, mGeos );
   }
 }
 
@@ -208,13 +222,13 @@ QgsAbstractGeometry *QgsGeos::combine( const QList<QgsAbstractGeometry *> &geomL
   try
   {
     GEOSGeometry *geomCollection =  createGeosCollection( GEOS_GEOMETRYCOLLECTION, geosGeometries );
-    geomUnion = GEOSUnaryUnion_r( geosinit.ctxt, geomCollection );
-    GEOSGeom_destroy_r( geosinit.ctxt, geomCollection );
+    geomUnion = GEOSUnaryUnion_r( geosinit()->ctxt, geomCollection );
+    GEOSGeom_destroy_r( geosinit()->ctxt, geomCollection );
   }
   CATCH_GEOS_WITH_ERRMSG( nullptr )
 
   QgsAbstractGeometry *result = fromGeos( geomUnion );
-  GEOSGeom_destroy_r( geosinit.ctxt, geomUnion );
+  GEOSGeom_destroy_r( geosinit()->ctxt, geomUnion );
   return result;
 }
 
@@ -239,11 +253,11 @@ double QgsGeos::distance( const QgsAbstractGeometry &geom, QString *errorMsg ) c
 
   try
   {
-    GEOSDistance_r( geosinit.ctxt, mGeos, otherGeosGeom, &distance );
+    GEOSDistance_r( geosinit()->ctxt, mGeos, otherGeosGeom, &distance );
   }
   CATCH_GEOS_WITH_ERRMSG( -1.0 )
 
-  GEOSGeom_destroy_r( geosinit.ctxt, otherGeosGeom );
+  GEOSGeom_destroy_r( geosinit()->ctxt, otherGeosGeom );
 
   return distance;
 }
@@ -299,11 +313,11 @@ QString QgsGeos::relate( const QgsAbstractGeometry &geom, QString *errorMsg ) co
   QString result;
   try
   {
-    char *r = GEOSRelate_r( geosinit.ctxt, mGeos, geosGeom.get() );
+    char *r = GEOSRelate_r( geosinit()->ctxt, mGeos, geosGeom.get() );
     if ( r )
     {
       result = QString( r );
-      GEOSFree_r( geosinit.ctxt, r );
+      GEOSFree_r( geosinit()->ctxt, r );
     }
   }
   catch ( GEOSException &e )
@@ -333,7 +347,7 @@ bool QgsGeos::relatePattern( const QgsAbstractGeometry &geom, const QString &pat
   bool result = false;
   try
   {
-    result = ( GEOSRelatePattern_r( geosinit.ctxt, mGeos, geosGeom.get(), pattern.toLocal8Bit().constData() ) == 1 );
+    result = ( GEOSRelatePattern_r( geosinit()->ctxt, mGeos, geosGeom.get(), pattern.toLocal8Bit().constData() ) == 1 );
   }
   catch ( GEOSException &e )
   {
@@ -356,7 +370,7 @@ double QgsGeos::area( QString *errorMsg ) const
 
   try
   {
-    if ( GEOSArea_r( geosinit.ctxt, mGeos, &area ) != 1 )
+    if ( GEOSArea_r( geosinit()->ctxt, mGeos, &area ) != 1 )
       return -1.0;
   }
   CATCH_GEOS_WITH_ERRMSG( -1.0 );
@@ -372,7 +386,7 @@ double QgsGeos::length( QString *errorMsg ) const
   }
   try
   {
-    if ( GEOSLength_r( geosinit.ctxt, mGeos, &length ) != 1 )
+    if ( GEOSLength_r( geosinit()->ctxt, mGeos, &length ) != 1 )
       return -1.0;
   }
   CATCH_GEOS_WITH_ERRMSG( -1.0 )
@@ -398,7 +412,7 @@ int QgsGeos::splitGeometry( const QgsLineString &splitLine,
     return 1; //cannot split points
   }
 
-  if ( !GEOSisValid_r( geosinit.ctxt, mGeos ) )
+  if ( !GEOSisValid_r( geosinit()->ctxt, mGeos ) )
     return 7;
 
   //make sure splitLine is valid
@@ -425,9 +439,9 @@ int QgsGeos::splitGeometry( const QgsLineString &splitLine,
       return 1;
     }
 
-    if ( !GEOSisValid_r( geosinit.ctxt, splitLineGeos ) || !GEOSisSimple_r( geosinit.ctxt, splitLineGeos ) )
+    if ( !GEOSisValid_r( geosinit()->ctxt, splitLineGeos ) || !GEOSisSimple_r( geosinit()->ctxt, splitLineGeos ) )
     {
-      GEOSGeom_destroy_r( geosinit.ctxt, splitLineGeos );
+      GEOSGeom_destroy_r( geosinit()->ctxt, splitLineGeos );
       return 1;
     }
 
@@ -442,12 +456,12 @@ int QgsGeos::splitGeometry( const QgsLineString &splitLine,
     if ( mGeometry->dimension() == 1 )
     {
       returnCode = splitLinearGeometry( splitLineGeos, newGeometries );
-      GEOSGeom_destroy_r( geosinit.ctxt, splitLineGeos );
+      GEOSGeom_destroy_r( geosinit()->ctxt, splitLineGeos );
     }
     else if ( mGeometry->dimension() == 2 )
     {
       returnCode = splitPolygonGeometry( splitLineGeos, newGeometries );
-      GEOSGeom_destroy_r( geosinit.ctxt, splitLineGeos );
+      GEOSGeom_destroy_r( geosinit()->ctxt, splitLineGeos );
     }
     else
     {
@@ -475,18 +489,18 @@ int QgsGeos::topologicalTestPointsSplit( const GEOSGeometry *splitLine, QgsPoint
   try
   {
     testPoints.clear();
-    GEOSGeometry *intersectionGeom = GEOSIntersection_r( geosinit.ctxt, mGeos, splitLine );
+    GEOSGeometry *intersectionGeom = GEOSIntersection_r( geosinit()->ctxt, mGeos, splitLine );
     if ( !intersectionGeom )
       return 1;
 
     bool simple = false;
     int nIntersectGeoms = 1;
-    if ( GEOSGeomTypeId_r( geosinit.ctxt, intersectionGeom ) == GEOS_LINESTRING
-         || GEOSGeomTypeId_r( geosinit.ctxt, intersectionGeom ) == GEOS_POINT )
+    if ( GEOSGeomTypeId_r( geosinit()->ctxt, intersectionGeom ) == GEOS_LINESTRING
+         || GEOSGeomTypeId_r( geosinit()->ctxt, intersectionGeom ) == GEOS_POINT )
       simple = true;
 
     if ( !simple )
-      nIntersectGeoms = GEOSGetNumGeometries_r( geosinit.ctxt, intersectionGeom );
+      nIntersectGeoms = GEOSGetNumGeometries_r( geosinit()->ctxt, intersectionGeom );
 
     for ( int i = 0; i < nIntersectGeoms; ++i )
     {
@@ -494,18 +508,18 @@ int QgsGeos::topologicalTestPointsSplit( const GEOSGeometry *splitLine, QgsPoint
       if ( simple )
         currentIntersectGeom = intersectionGeom;
       else
-        currentIntersectGeom = GEOSGetGeometryN_r( geosinit.ctxt, intersectionGeom, i );
+        currentIntersectGeom = GEOSGetGeometryN_r( geosinit()->ctxt, intersectionGeom, i );
 
-      const GEOSCoordSequence *lineSequence = GEOSGeom_getCoordSeq_r( geosinit.ctxt, currentIntersectGeom );
+      const GEOSCoordSequence *lineSequence = GEOSGeom_getCoordSeq_r( geosinit()->ctxt, currentIntersectGeom );
       unsigned int sequenceSize = 0;
       double x, y;
-      if ( GEOSCoordSeq_getSize_r( geosinit.ctxt, lineSequence, &sequenceSize ) != 0 )
+      if ( GEOSCoordSeq_getSize_r( geosinit()->ctxt, lineSequence, &sequenceSize ) != 0 )
       {
         for ( unsigned int i = 0; i < sequenceSize; ++i )
         {
-          if ( GEOSCoordSeq_getX_r( geosinit.ctxt, lineSequence, i, &x ) != 0 )
+          if ( GEOSCoordSeq_getX_r( geosinit()->ctxt, lineSequence, i, &x ) != 0 )
           {
-            if ( GEOSCoordSeq_getY_r( geosinit.ctxt, lineSequence, i, &y ) != 0 )
+            if ( GEOSCoordSeq_getY_r( geosinit()->ctxt, lineSequence, i, &y ) != 0 )
             {
               testPoints.push_back( QgsPointV2( x, y ) );
             }
@@ -513,7 +527,7 @@ int QgsGeos::topologicalTestPointsSplit( const GEOSGeometry *splitLine, QgsPoint
         }
       }
     }
-    GEOSGeom_destroy_r( geosinit.ctxt, intersectionGeom );
+    GEOSGeom_destroy_r( geosinit()->ctxt, intersectionGeom );
   }
   CATCH_GEOS_WITH_ERRMSG( 1 )
 
@@ -522,7 +536,7 @@ int QgsGeos::topologicalTestPointsSplit( const GEOSGeometry *splitLine, QgsPoint
 
 GEOSGeometry *QgsGeos::linePointDifference( GEOSGeometry *GEOSsplitPoint ) const
 {
-  int type = GEOSGeomTypeId_r( geosinit.ctxt, mGeos );
+  int type = GEOSGeomTypeId_r( geosinit()->ctxt, mGeos );
 
   QgsMultiCurve *multiCurve = nullptr;
   if ( type == GEOS_MULTILINESTRING )
@@ -595,15 +609,15 @@ int QgsGeos::splitLinearGeometry( GEOSGeometry *splitLine, QList<QgsAbstractGeom
     return 5;
 
   //first test if linestring intersects geometry. If not, return straight away
-  if ( !GEOSIntersects_r( geosinit.ctxt, splitLine, mGeos ) )
+  if ( !GEOSIntersects_r( geosinit()->ctxt, splitLine, mGeos ) )
     return 1;
 
   //check that split line has no linear intersection
-  int linearIntersect = GEOSRelatePattern_r( geosinit.ctxt, mGeos, splitLine, "1********" );
+  int linearIntersect = GEOSRelatePattern_r( geosinit()->ctxt, mGeos, splitLine, "1********" );
   if ( linearIntersect > 0 )
     return 3;
 
-  int splitGeomType = GEOSGeomTypeId_r( geosinit.ctxt, splitLine );
+  int splitGeomType = GEOSGeomTypeId_r( geosinit()->ctxt, splitLine );
 
   GEOSGeometry *splitGeom = nullptr;
   if ( splitGeomType == GEOS_POINT )
@@ -612,22 +626,22 @@ int QgsGeos::splitLinearGeometry( GEOSGeometry *splitLine, QList<QgsAbstractGeom
   }
   else
   {
-    splitGeom = GEOSDifference_r( geosinit.ctxt, mGeos, splitLine );
+    splitGeom = GEOSDifference_r( geosinit()->ctxt, mGeos, splitLine );
   }
   QVector<GEOSGeometry *> lineGeoms;
 
-  int splitType = GEOSGeomTypeId_r( geosinit.ctxt, splitGeom );
+  int splitType = GEOSGeomTypeId_r( geosinit()->ctxt, splitGeom );
   if ( splitType == GEOS_MULTILINESTRING )
   {
-    int nGeoms = GEOSGetNumGeometries_r( geosinit.ctxt, splitGeom );
+    int nGeoms = GEOSGetNumGeometries_r( geosinit()->ctxt, splitGeom );
     lineGeoms.reserve( nGeoms );
     for ( int i = 0; i < nGeoms; ++i )
-      lineGeoms << GEOSGeom_clone_r( geosinit.ctxt, GEOSGetGeometryN_r( geosinit.ctxt, splitGeom, i ) );
+      lineGeoms << GEOSGeom_clone_r( geosinit()->ctxt, GEOSGetGeometryN_r( geosinit()->ctxt, splitGeom, i ) );
 
   }
   else
   {
-    lineGeoms << GEOSGeom_clone_r( geosinit.ctxt, splitGeom );
+    lineGeoms << GEOSGeom_clone_r( geosinit()->ctxt, splitGeom );
   }
 
   mergeGeometriesMultiTypeSplit( lineGeoms );
@@ -635,10 +649,10 @@ int QgsGeos::splitLinearGeometry( GEOSGeometry *splitLine, QList<QgsAbstractGeom
   for ( int i = 0; i < lineGeoms.size(); ++i )
   {
     newGeometries << fromGeos( lineGeoms[i] );
-    GEOSGeom_destroy_r( geosinit.ctxt, lineGeoms[i] );
+    GEOSGeom_destroy_r( geosinit()->ctxt, lineGeoms[i] );
   }
 
-  GEOSGeom_destroy_r( geosinit.ctxt, splitGeom );
+  GEOSGeom_destroy_r( geosinit()->ctxt, splitGeom );
   return 0;
 }
 
@@ -651,7 +665,7 @@ int QgsGeos::splitPolygonGeometry( GEOSGeometry *splitLine, QList<QgsAbstractGeo
     return 5;
 
   //first test if linestring intersects geometry. If not, return straight away
-  if ( !GEOSIntersects_r( geosinit.ctxt, splitLine, mGeos ) )
+  if ( !GEOSIntersects_r( geosinit()->ctxt, splitLine, mGeos ) )
     return 1;
 
   //first union all the polygon rings together (to get them noded, see JTS developer guide)
@@ -659,18 +673,18 @@ int QgsGeos::splitPolygonGeometry( GEOSGeometry *splitLine, QList<QgsAbstractGeo
   if ( !nodedGeometry )
     return 2; //an error occurred during noding
 
-  GEOSGeometry *polygons = GEOSPolygonize_r( geosinit.ctxt, &nodedGeometry, 1 );
+  GEOSGeometry *polygons = GEOSPolygonize_r( geosinit()->ctxt, &nodedGeometry, 1 );
   if ( !polygons || numberOfGeometries( polygons ) == 0 )
   {
     if ( polygons )
-      GEOSGeom_destroy_r( geosinit.ctxt, polygons );
+      GEOSGeom_destroy_r( geosinit()->ctxt, polygons );
 
-    GEOSGeom_destroy_r( geosinit.ctxt, nodedGeometry );
+    GEOSGeom_destroy_r( geosinit()->ctxt, nodedGeometry );
 
     return 4;
   }
 
-  GEOSGeom_destroy_r( geosinit.ctxt, nodedGeometry );
+  GEOSGeom_destroy_r( geosinit()->ctxt, nodedGeometry );
 
   //test every polygon if contained in original geometry
   //include in result if yes
@@ -682,8 +696,8 @@ int QgsGeos::splitPolygonGeometry( GEOSGeometry *splitLine, QList<QgsAbstractGeo
 
   for ( int i = 0; i < numberOfGeometries( polygons ); i++ )
   {
-    const GEOSGeometry *polygon = GEOSGetGeometryN_r( geosinit.ctxt, polygons, i );
-    intersectGeometry = GEOSIntersection_r( geosinit.ctxt, mGeos, polygon );
+    const GEOSGeometry *polygon = GEOSGetGeometryN_r( geosinit()->ctxt, polygons, i );
+    intersectGeometry = GEOSIntersection_r( geosinit()->ctxt, mGeos, polygon );
     if ( !intersectGeometry )
     {
       QgsDebugMsg( "intersectGeometry is nullptr" );
@@ -691,18 +705,18 @@ int QgsGeos::splitPolygonGeometry( GEOSGeometry *splitLine, QList<QgsAbstractGeo
     }
 
     double intersectionArea;
-    GEOSArea_r( geosinit.ctxt, intersectGeometry, &intersectionArea );
+    GEOSArea_r( geosinit()->ctxt, intersectGeometry, &intersectionArea );
 
     double polygonArea;
-    GEOSArea_r( geosinit.ctxt, polygon, &polygonArea );
+    GEOSArea_r( geosinit()->ctxt, polygon, &polygonArea );
 
     const double areaRatio = intersectionArea / polygonArea;
     if ( areaRatio > 0.99 && areaRatio < 1.01 )
-      testedGeometries << GEOSGeom_clone_r( geosinit.ctxt, polygon );
+      testedGeometries << GEOSGeom_clone_r( geosinit()->ctxt, polygon );
 
-    GEOSGeom_destroy_r( geosinit.ctxt, intersectGeometry );
+    GEOSGeom_destroy_r( geosinit()->ctxt, intersectGeometry );
   }
-  GEOSGeom_destroy_r( geosinit.ctxt, polygons );
+  GEOSGeom_destroy_r( geosinit()->ctxt, polygons );
 
   bool splitDone = true;
   int nGeometriesThis = numberOfGeometries( mGeos ); //original number of geometries
@@ -718,19 +732,19 @@ int QgsGeos::splitPolygonGeometry( GEOSGeometry *splitLine, QList<QgsAbstractGeo
   {
     for ( int i = 0; i < testedGeometries.size(); ++i )
     {
-      GEOSGeom_destroy_r( geosinit.ctxt, testedGeometries[i] );
+      GEOSGeom_destroy_r( geosinit()->ctxt, testedGeometries[i] );
     }
     return 1;
   }
 
   int i;
-  for ( i = 0; i < testedGeometries.size() && GEOSisValid_r( geosinit.ctxt, testedGeometries[i] ); ++i )
+  for ( i = 0; i < testedGeometries.size() && GEOSisValid_r( geosinit()->ctxt, testedGeometries[i] ); ++i )
     ;
 
   if ( i < testedGeometries.size() )
   {
     for ( i = 0; i < testedGeometries.size(); ++i )
-      GEOSGeom_destroy_r( geosinit.ctxt, testedGeometries[i] );
+      GEOSGeom_destroy_r( geosinit()->ctxt, testedGeometries[i] );
 
     return 3;
   }
@@ -747,16 +761,16 @@ GEOSGeometry *QgsGeos::nodeGeometries( const GEOSGeometry *splitLine, const GEOS
     return nullptr;
 
   GEOSGeometry *geometryBoundary = nullptr;
-  if ( GEOSGeomTypeId_r( geosinit.ctxt, geom ) == GEOS_POLYGON || GEOSGeomTypeId_r( geosinit.ctxt, geom ) == GEOS_MULTIPOLYGON )
-    geometryBoundary = GEOSBoundary_r( geosinit.ctxt, geom );
+  if ( GEOSGeomTypeId_r( geosinit()->ctxt, geom ) == GEOS_POLYGON || GEOSGeomTypeId_r( geosinit()->ctxt, geom ) == GEOS_MULTIPOLYGON )
+    geometryBoundary = GEOSBoundary_r( geosinit()->ctxt, geom );
   else
-    geometryBoundary = GEOSGeom_clone_r( geosinit.ctxt, geom );
+    geometryBoundary = GEOSGeom_clone_r( geosinit()->ctxt, geom );
 
-  GEOSGeometry *splitLineClone = GEOSGeom_clone_r( geosinit.ctxt, splitLine );
-  GEOSGeometry *unionGeometry = GEOSUnion_r( geosinit.ctxt, splitLineClone, geometryBoundary );
-  GEOSGeom_destroy_r( geosinit.ctxt, splitLineClone );
+  GEOSGeometry *splitLineClone = GEOSGeom_clone_r( geosinit()->ctxt, splitLine );
+  GEOSGeometry *unionGeometry = GEOSUnion_r( geosinit()->ctxt, splitLineClone, geometryBoundary );
+  GEOSGeom_destroy_r( geosinit()->ctxt, splitLineClone );
 
-  GEOSGeom_destroy_r( geosinit.ctxt, geometryBoundary );
+  GEOSGeom_destroy_r( geosinit()->ctxt, geometryBoundary );
   return unionGeometry;
 }
 
@@ -766,7 +780,7 @@ int QgsGeos::mergeGeometriesMultiTypeSplit( QVector<GEOSGeometry *> &splitResult
     return 1;
 
   //convert mGeos to geometry collection
-  int type = GEOSGeomTypeId_r( geosinit.ctxt, mGeos );
+  int type = GEOSGeomTypeId_r( geosinit()->ctxt, mGeos );
   if ( type != GEOS_GEOMETRYCOLLECTION &&
        type != GEOS_MULTILINESTRING &&
        type != GEOS_MULTIPOLYGON &&
@@ -783,9 +797,9 @@ int QgsGeos::mergeGeometriesMultiTypeSplit( QVector<GEOSGeometry *> &splitResult
   {
     //is this geometry a part of the original multitype?
     bool isPart = false;
-    for ( int j = 0; j < GEOSGetNumGeometries_r( geosinit.ctxt, mGeos ); j++ )
+    for ( int j = 0; j < GEOSGetNumGeometries_r( geosinit()->ctxt, mGeos ); j++ )
     {
-      if ( GEOSEquals_r( geosinit.ctxt, copyList[i], GEOSGetGeometryN_r( geosinit.ctxt, mGeos, j ) ) )
+      if ( GEOSEquals_r( geosinit()->ctxt, copyList[i], GEOSGetGeometryN_r( geosinit()->ctxt, mGeos, j ) ) )
       {
         isPart = true;
         break;
@@ -806,7 +820,7 @@ int QgsGeos::mergeGeometriesMultiTypeSplit( QVector<GEOSGeometry *> &splitResult
       else if ( type == GEOS_MULTIPOLYGON )
         splitResult << createGeosCollection( GEOS_MULTIPOLYGON, geomVector );
       else
-        GEOSGeom_destroy_r( geosinit.ctxt, copyList[i] );
+        GEOSGeom_destroy_r( geosinit()->ctxt, copyList[i] );
     }
   }
 
@@ -851,7 +865,7 @@ GEOSGeometry *QgsGeos::createGeosCollection( int typeId, const QVector<GEOSGeome
 
   try
   {
-    geom = GEOSGeom_createCollection_r( geosinit.ctxt, typeId, geomarr, nNotNullGeoms );
+    geom = GEOSGeom_createCollection_r( geosinit()->ctxt, typeId, geomarr, nNotNullGeoms );
   }
   catch ( GEOSException &e )
   {
@@ -870,16 +884,16 @@ QgsAbstractGeometry *QgsGeos::fromGeos( const GEOSGeometry *geos )
     return nullptr;
   }
 
-  int nCoordDims = GEOSGeom_getCoordinateDimension_r( geosinit.ctxt, geos );
-  int nDims = GEOSGeom_getDimensions_r( geosinit.ctxt, geos );
+  int nCoordDims = GEOSGeom_getCoordinateDimension_r( geosinit()->ctxt, geos );
+  int nDims = GEOSGeom_getDimensions_r( geosinit()->ctxt, geos );
   bool hasZ = ( nCoordDims == 3 );
   bool hasM = ( ( nDims - nCoordDims ) == 1 );
 
-  switch ( GEOSGeomTypeId_r( geosinit.ctxt, geos ) )
+  switch ( GEOSGeomTypeId_r( geosinit()->ctxt, geos ) )
   {
     case GEOS_POINT:                 // a point
     {
-      const GEOSCoordSequence *cs = GEOSGeom_getCoordSeq_r( geosinit.ctxt, geos );
+      const GEOSCoordSequence *cs = GEOSGeom_getCoordSeq_r( geosinit()->ctxt, geos );
       return ( coordSeqPoint( cs, 0, hasZ, hasM ).clone() );
     }
     case GEOS_LINESTRING:
@@ -893,10 +907,10 @@ QgsAbstractGeometry *QgsGeos::fromGeos( const GEOSGeometry *geos )
     case GEOS_MULTIPOINT:
     {
       QgsMultiPointV2 *multiPoint = new QgsMultiPointV2();
-      int nParts = GEOSGetNumGeometries_r( geosinit.ctxt, geos );
+      int nParts = GEOSGetNumGeometries_r( geosinit()->ctxt, geos );
       for ( int i = 0; i < nParts; ++i )
       {
-        const GEOSCoordSequence *cs = GEOSGeom_getCoordSeq_r( geosinit.ctxt, GEOSGetGeometryN_r( geosinit.ctxt, geos, i ) );
+        const GEOSCoordSequence *cs = GEOSGeom_getCoordSeq_r( geosinit()->ctxt, GEOSGetGeometryN_r( geosinit()->ctxt, geos, i ) );
         if ( cs )
         {
           multiPoint->addGeometry( coordSeqPoint( cs, 0, hasZ, hasM ).clone() );
@@ -907,10 +921,10 @@ QgsAbstractGeometry *QgsGeos::fromGeos( const GEOSGeometry *geos )
     case GEOS_MULTILINESTRING:
     {
       QgsMultiLineString *multiLineString = new QgsMultiLineString();
-      int nParts = GEOSGetNumGeometries_r( geosinit.ctxt, geos );
+      int nParts = GEOSGetNumGeometries_r( geosinit()->ctxt, geos );
       for ( int i = 0; i < nParts; ++i )
       {
-        QgsLineString *line = sequenceToLinestring( GEOSGetGeometryN_r( geosinit.ctxt, geos, i ), hasZ, hasM );
+        QgsLineString *line = sequenceToLinestring( GEOSGetGeometryN_r( geosinit()->ctxt, geos, i ), hasZ, hasM );
         if ( line )
         {
           multiLineString->addGeometry( line );
@@ -922,10 +936,10 @@ QgsAbstractGeometry *QgsGeos::fromGeos( const GEOSGeometry *geos )
     {
       QgsMultiPolygonV2 *multiPolygon = new QgsMultiPolygonV2();
 
-      int nParts = GEOSGetNumGeometries_r( geosinit.ctxt, geos );
+      int nParts = GEOSGetNumGeometries_r( geosinit()->ctxt, geos );
       for ( int i = 0; i < nParts; ++i )
       {
-        QgsPolygonV2 *poly = fromGeosPolygon( GEOSGetGeometryN_r( geosinit.ctxt, geos, i ) );
+        QgsPolygonV2 *poly = fromGeosPolygon( GEOSGetGeometryN_r( geosinit()->ctxt, geos, i ) );
         if ( poly )
         {
           multiPolygon->addGeometry( poly );
@@ -936,10 +950,10 @@ QgsAbstractGeometry *QgsGeos::fromGeos( const GEOSGeometry *geos )
     case GEOS_GEOMETRYCOLLECTION:
     {
       QgsGeometryCollection *geomCollection = new QgsGeometryCollection();
-      int nParts = GEOSGetNumGeometries_r( geosinit.ctxt, geos );
+      int nParts = GEOSGetNumGeometries_r( geosinit()->ctxt, geos );
       for ( int i = 0; i < nParts; ++i )
       {
-        QgsAbstractGeometry *geom = fromGeos( GEOSGetGeometryN_r( geosinit.ctxt, geos, i ) );
+        QgsAbstractGeometry *geom = fromGeos( GEOSGetGeometryN_r( geosinit()->ctxt, geos, i ) );
         if ( geom )
         {
           geomCollection->addGeometry( geom );
@@ -953,28 +967,28 @@ QgsAbstractGeometry *QgsGeos::fromGeos( const GEOSGeometry *geos )
 
 QgsPolygonV2 *QgsGeos::fromGeosPolygon( const GEOSGeometry *geos )
 {
-  if ( GEOSGeomTypeId_r( geosinit.ctxt, geos ) != GEOS_POLYGON )
+  if ( GEOSGeomTypeId_r( geosinit()->ctxt, geos ) != GEOS_POLYGON )
   {
     return nullptr;
   }
 
-  int nCoordDims = GEOSGeom_getCoordinateDimension_r( geosinit.ctxt, geos );
-  int nDims = GEOSGeom_getDimensions_r( geosinit.ctxt, geos );
+  int nCoordDims = GEOSGeom_getCoordinateDimension_r( geosinit()->ctxt, geos );
+  int nDims = GEOSGeom_getDimensions_r( geosinit()->ctxt, geos );
   bool hasZ = ( nCoordDims == 3 );
   bool hasM = ( ( nDims - nCoordDims ) == 1 );
 
   QgsPolygonV2 *polygon = new QgsPolygonV2();
 
-  const GEOSGeometry *ring = GEOSGetExteriorRing_r( geosinit.ctxt, geos );
+  const GEOSGeometry *ring = GEOSGetExteriorRing_r( geosinit()->ctxt, geos );
   if ( ring )
   {
     polygon->setExteriorRing( sequenceToLinestring( ring, hasZ, hasM ) );
   }
 
   QList<QgsCurve *> interiorRings;
-  for ( int i = 0; i < GEOSGetNumInteriorRings_r( geosinit.ctxt, geos ); ++i )
+  for ( int i = 0; i < GEOSGetNumInteriorRings_r( geosinit()->ctxt, geos ); ++i )
   {
-    ring = GEOSGetInteriorRingN_r( geosinit.ctxt, geos, i );
+    ring = GEOSGetInteriorRingN_r( geosinit()->ctxt, geos, i );
     if ( ring )
     {
       interiorRings.push_back( sequenceToLinestring( ring, hasZ, hasM ) );
@@ -988,9 +1002,9 @@ QgsPolygonV2 *QgsGeos::fromGeosPolygon( const GEOSGeometry *geos )
 QgsLineString *QgsGeos::sequenceToLinestring( const GEOSGeometry *geos, bool hasZ, bool hasM )
 {
   QgsPointSequence pts;
-  const GEOSCoordSequence *cs = GEOSGeom_getCoordSeq_r( geosinit.ctxt, geos );
+  const GEOSCoordSequence *cs = GEOSGeom_getCoordSeq_r( geosinit()->ctxt, geos );
   unsigned int nPoints;
-  GEOSCoordSeq_getSize_r( geosinit.ctxt, cs, &nPoints );
+  GEOSCoordSeq_getSize_r( geosinit()->ctxt, cs, &nPoints );
   pts.reserve( nPoints );
   for ( unsigned int i = 0; i < nPoints; ++i )
   {
@@ -1006,13 +1020,13 @@ int QgsGeos::numberOfGeometries( GEOSGeometry *g )
   if ( !g )
     return 0;
 
-  int geometryType = GEOSGeomTypeId_r( geosinit.ctxt, g );
+  int geometryType = GEOSGeomTypeId_r( geosinit()->ctxt, g );
   if ( geometryType == GEOS_POINT || geometryType == GEOS_LINESTRING || geometryType == GEOS_LINEARRING
        || geometryType == GEOS_POLYGON )
     return 1;
 
   //calling GEOSGetNumGeometries is save for multi types and collections also in geos2
-  return GEOSGetNumGeometries_r( geosinit.ctxt, g );
+  return GEOSGetNumGeometries_r( geosinit()->ctxt, g );
 }
 
 QgsPointV2 QgsGeos::coordSeqPoint( const GEOSCoordSequence *cs, int i, bool hasZ, bool hasM )
@@ -1025,15 +1039,15 @@ QgsPointV2 QgsGeos::coordSeqPoint( const GEOSCoordSequence *cs, int i, bool hasZ
   double x, y;
   double z = 0;
   double m = 0;
-  GEOSCoordSeq_getX_r( geosinit.ctxt, cs, i, &x );
-  GEOSCoordSeq_getY_r( geosinit.ctxt, cs, i, &y );
+  GEOSCoordSeq_getX_r( geosinit()->ctxt, cs, i, &x );
+  GEOSCoordSeq_getY_r( geosinit()->ctxt, cs, i, &y );
   if ( hasZ )
   {
-    GEOSCoordSeq_getZ_r( geosinit.ctxt, cs, i, &z );
+    GEOSCoordSeq_getZ_r( geosinit()->ctxt, cs, i, &z );
   }
   if ( hasM )
   {
-    GEOSCoordSeq_getOrdinate_r( geosinit.ctxt, cs, i, 3, &m );
+    GEOSCoordSeq_getOrdinate_r( geosinit()->ctxt, cs, i, 3, &m );
   }
 
   QgsWkbTypes::Type t = QgsWkbTypes::Point;
@@ -1146,21 +1160,21 @@ QgsAbstractGeometry *QgsGeos::overlay( const QgsAbstractGeometry &geom, Overlay
     switch ( op )
     {
       case INTERSECTION:
-        opGeom.reset( GEOSIntersection_r( geosinit.ctxt, mGeos, geosGeom.get() ) );
+        opGeom.reset( GEOSIntersection_r( geosinit()->ctxt, mGeos, geosGeom.get() ) );
         break;
       case DIFFERENCE:
-        opGeom.reset( GEOSDifference_r( geosinit.ctxt, mGeos, geosGeom.get() ) );
+        opGeom.reset( GEOSDifference_r( geosinit()->ctxt, mGeos, geosGeom.get() ) );
         break;
       case UNION:
       {
-        GEOSGeometry *unionGeometry = GEOSUnion_r( geosinit.ctxt, mGeos, geosGeom.get() );
+        GEOSGeometry *unionGeometry = GEOSUnion_r( geosinit()->ctxt, mGeos, geosGeom.get() );
 
-        if ( unionGeometry && GEOSGeomTypeId_r( geosinit.ctxt, unionGeometry ) == GEOS_MULTILINESTRING )
+        if ( unionGeometry && GEOSGeomTypeId_r( geosinit()->ctxt, unionGeometry ) == GEOS_MULTILINESTRING )
         {
-          GEOSGeometry *mergedLines = GEOSLineMerge_r( geosinit.ctxt, unionGeometry );
+          GEOSGeometry *mergedLines = GEOSLineMerge_r( geosinit()->ctxt, unionGeometry );
           if ( mergedLines )
           {
-            GEOSGeom_destroy_r( geosinit.ctxt, unionGeometry );
+            GEOSGeom_destroy_r( geosinit()->ctxt, unionGeometry );
             unionGeometry = mergedLines;
           }
         }
@@ -1169,7 +1183,7 @@ QgsAbstractGeometry *QgsGeos::overlay( const QgsAbstractGeometry &geom, Overlay
       }
       break;
       case SYMDIFFERENCE:
-        opGeom.reset( GEOSSymDifference_r( geosinit.ctxt, mGeos, geosGeom.get() ) );
+        opGeom.reset( GEOSSymDifference_r( geosinit()->ctxt, mGeos, geosGeom.get() ) );
         break;
       default:    //unknown op
         return nullptr;
@@ -1208,25 +1222,25 @@ bool QgsGeos::relation( const QgsAbstractGeometry &geom, Relation r, QString *er
       switch ( r )
       {
         case INTERSECTS:
-          result = ( GEOSPreparedIntersects_r( geosinit.ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
+          result = ( GEOSPreparedIntersects_r( geosinit()->ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
           break;
         case TOUCHES:
-          result = ( GEOSPreparedTouches_r( geosinit.ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
+          result = ( GEOSPreparedTouches_r( geosinit()->ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
           break;
         case CROSSES:
-          result = ( GEOSPreparedCrosses_r( geosinit.ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
+          result = ( GEOSPreparedCrosses_r( geosinit()->ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
           break;
         case WITHIN:
-          result = ( GEOSPreparedWithin_r( geosinit.ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
+          result = ( GEOSPreparedWithin_r( geosinit()->ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
           break;
         case CONTAINS:
-          result = ( GEOSPreparedContains_r( geosinit.ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
+          result = ( GEOSPreparedContains_r( geosinit()->ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
           break;
         case DISJOINT:
-          result = ( GEOSPreparedDisjoint_r( geosinit.ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
+          result = ( GEOSPreparedDisjoint_r( geosinit()->ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
           break;
         case OVERLAPS:
-          result = ( GEOSPreparedOverlaps_r( geosinit.ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
+          result = ( GEOSPreparedOverlaps_r( geosinit()->ctxt, mGeosPrepared, geosGeom.get() ) == 1 );
           break;
         default:
           return false;
@@ -1237,25 +1251,25 @@ bool QgsGeos::relation( const QgsAbstractGeometry &geom, Relation r, QString *er
     switch ( r )
     {
       case INTERSECTS:
-        result = ( GEOSIntersects_r( geosinit.ctxt, mGeos, geosGeom.get() ) == 1 );
+        result = ( GEOSIntersects_r( geosinit()->ctxt, mGeos, geosGeom.get() ) == 1 );
         break;
       case TOUCHES:
-        result = ( GEOSTouches_r( geosinit.ctxt, mGeos, geosGeom.get() ) == 1 );
+        result = ( GEOSTouches_r( geosinit()->ctxt, mGeos, geosGeom.get() ) == 1 );
         break;
       case CROSSES:
-        result = ( GEOSCrosses_r( geosinit.ctxt, mGeos, geosGeom.get() ) == 1 );
+        result = ( GEOSCrosses_r( geosinit()->ctxt, mGeos, geosGeom.get() ) == 1 );
         break;
       case WITHIN:
-        result = ( GEOSWithin_r( geosinit.ctxt, mGeos, geosGeom.get() ) == 1 );
+        result = ( GEOSWithin_r( geosinit()->ctxt, mGeos, geosGeom.get() ) == 1 );
         break;
       case CONTAINS:
-        result = ( GEOSContains_r( geosinit.ctxt, mGeos, geosGeom.get() ) == 1 );
+        result = ( GEOSContains_r( geosinit()->ctxt, mGeos, geosGeom.get() ) == 1 );
         break;
       case DISJOINT:
-        result = ( GEOSDisjoint_r( geosinit.ctxt, mGeos, geosGeom.get() ) == 1 );
+        result = ( GEOSDisjoint_r( geosinit()->ctxt, mGeos, geosGeom.get() ) == 1 );
         break;
       case OVERLAPS:
-        result = ( GEOSOverlaps_r( geosinit.ctxt, mGeos, geosGeom.get() ) == 1 );
+        result = ( GEOSOverlaps_r( geosinit()->ctxt, mGeos, geosGeom.get() ) == 1 );
         break;
       default:
         return false;
@@ -1283,7 +1297,7 @@ QgsAbstractGeometry *QgsGeos::buffer( double distance, int segments, QString *er
   GEOSGeomScopedPtr geos;
   try
   {
-    geos.reset( GEOSBuffer_r( geosinit.ctxt, mGeos, distance, segments ) );
+    geos.reset( GEOSBuffer_r( geosinit()->ctxt, mGeos, distance, segments ) );
   }
   CATCH_GEOS_WITH_ERRMSG( nullptr );
   return fromGeos( geos.get() );
@@ -1299,7 +1313,7 @@ QgsAbstractGeometry *QgsGeos::buffer( double distance, int segments, int endCapS
   GEOSGeomScopedPtr geos;
   try
   {
-    geos.reset( GEOSBufferWithStyle_r( geosinit.ctxt, mGeos, distance, segments, endCapStyle, joinStyle, mitreLimit ) );
+    geos.reset( GEOSBufferWithStyle_r( geosinit()->ctxt, mGeos, distance, segments, endCapStyle, joinStyle, mitreLimit ) );
   }
   CATCH_GEOS_WITH_ERRMSG( nullptr );
   return fromGeos( geos.get() );
@@ -1314,7 +1328,7 @@ QgsAbstractGeometry *QgsGeos::simplify( double tolerance, QString *errorMsg ) co
   GEOSGeomScopedPtr geos;
   try
   {
-    geos.reset( GEOSTopologyPreserveSimplify_r( geosinit.ctxt, mGeos, tolerance ) );
+    geos.reset( GEOSTopologyPreserveSimplify_r( geosinit()->ctxt, mGeos, tolerance ) );
   }
   CATCH_GEOS_WITH_ERRMSG( nullptr );
   return fromGeos( geos.get() );
@@ -1329,7 +1343,7 @@ QgsAbstractGeometry *QgsGeos::interpolate( double distance, QString *errorMsg )
   GEOSGeomScopedPtr geos;
   try
   {
-    geos.reset( GEOSInterpolate_r( geosinit.ctxt, mGeos, distance ) );
+    geos.reset( GEOSInterpolate_r( geosinit()->ctxt, mGeos, distance ) );
   }
   CATCH_GEOS_WITH_ERRMSG( nullptr );
   return fromGeos( geos.get() );
@@ -1345,7 +1359,7 @@ bool QgsGeos::centroid( QgsPointV2 &pt, QString *errorMsg ) const
   GEOSGeomScopedPtr geos;
   try
   {
-    geos.reset( GEOSGetCentroid_r( geosinit.ctxt,  mGeos ) );
+    geos.reset( GEOSGetCentroid_r( geosinit()->ctxt,  mGeos ) );
   }
   CATCH_GEOS_WITH_ERRMSG( false );
 
@@ -1355,8 +1369,8 @@ bool QgsGeos::centroid( QgsPointV2 &pt, QString *errorMsg ) const
   }
 
   double x, y;
-  GEOSGeomGetX_r( geosinit.ctxt, geos.get(), &x );
-  GEOSGeomGetY_r( geosinit.ctxt, geos.get(), &y );
+  GEOSGeomGetX_r( geosinit()->ctxt, geos.get(), &x );
+  GEOSGeomGetY_r( geosinit()->ctxt, geos.get(), &y );
   pt.setX( x );
   pt.setY( y );
   return true;
@@ -1371,7 +1385,7 @@ QgsAbstractGeometry *QgsGeos::envelope( QString *errorMsg ) const
   GEOSGeomScopedPtr geos;
   try
   {
-    geos.reset( GEOSEnvelope_r( geosinit.ctxt, mGeos ) );
+    geos.reset( GEOSEnvelope_r( geosinit()->ctxt, mGeos ) );
   }
   CATCH_GEOS_WITH_ERRMSG( nullptr );
   return fromGeos( geos.get() );
@@ -1387,16 +1401,16 @@ bool QgsGeos::pointOnSurface( QgsPointV2 &pt, QString *errorMsg ) const
   GEOSGeomScopedPtr geos;
   try
   {
-    geos.reset( GEOSPointOnSurface_r( geosinit.ctxt, mGeos ) );
+    geos.reset( GEOSPointOnSurface_r( geosinit()->ctxt, mGeos ) );
 
-    if ( !geos || GEOSisEmpty_r( geosinit.ctxt, geos.get() ) != 0 )
+    if ( !geos || GEOSisEmpty_r( geosinit()->ctxt, geos.get() ) != 0 )
     {
       return false;
     }
 
     double x, y;
-    GEOSGeomGetX_r( geosinit.ctxt, geos.get(), &x );
-    GEOSGeomGetY_r( geosinit.ctxt, geos.get(), &y );
+    GEOSGeomGetX_r( geosinit()->ctxt, geos.get(), &x );
+    GEOSGeomGetY_r( geosinit()->ctxt, geos.get(), &y );
 
     pt.setX( x );
     pt.setY( y );
@@ -1415,9 +1429,9 @@ QgsAbstractGeometry *QgsGeos::convexHull( QString *errorMsg ) const
 
   try
   {
-    GEOSGeometry *cHull = GEOSConvexHull_r( geosinit.ctxt, mGeos );
+    GEOSGeometry *cHull = GEOSConvexHull_r( geosinit()->ctxt, mGeos );
     QgsAbstractGeometry *cHullGeom = fromGeos( cHull );
-    GEOSGeom_destroy_r( geosinit.ctxt, cHull );
+    GEOSGeom_destroy_r( geosinit()->ctxt, cHull );
     return cHullGeom;
   }
   CATCH_GEOS_WITH_ERRMSG( nullptr );
@@ -1432,7 +1446,7 @@ bool QgsGeos::isValid( QString *errorMsg ) const
 
   try
   {
-    return GEOSisValid_r( geosinit.ctxt, mGeos );
+    return GEOSisValid_r( geosinit()->ctxt, mGeos );
   }
   CATCH_GEOS_WITH_ERRMSG( false );
 }
@@ -1451,7 +1465,7 @@ bool QgsGeos::isEqual( const QgsAbstractGeometry &geom, QString *errorMsg ) cons
     {
       return false;
     }
-    bool equal = GEOSEquals_r( geosinit.ctxt, mGeos, geosGeom.get() );
+    bool equal = GEOSEquals_r( geosinit()->ctxt, mGeos, geosGeom.get() );
     return equal;
   }
   CATCH_GEOS_WITH_ERRMSG( false );
@@ -1466,7 +1480,7 @@ bool QgsGeos::isEmpty( QString *errorMsg ) const
 
   try
   {
-    return GEOSisEmpty_r( geosinit.ctxt, mGeos );
+    return GEOSisEmpty_r( geosinit()->ctxt, mGeos );
   }
   CATCH_GEOS_WITH_ERRMSG( false );
 }
@@ -1510,7 +1524,7 @@ GEOSCoordSequence *QgsGeos::createCoordinateSequence( const QgsCurve *curve, dou
   GEOSCoordSequence *coordSeq = nullptr;
   try
   {
-    coordSeq = GEOSCoordSeq_create_r( geosinit.ctxt, numOutPoints, coordDims );
+    coordSeq = GEOSCoordSeq_create_r( geosinit()->ctxt, numOutPoints, coordDims );
     if ( !coordSeq )
     {
       QgsMessageLog::logMessage( QObject::tr( "Could not create coordinate sequence for %1 points in %2 dimensions" ).arg( numPoints ).arg( coordDims ), QObject::tr( "GEOS" ) );
@@ -1520,16 +1534,16 @@ GEOSCoordSequence *QgsGeos::createCoordinateSequence( const QgsCurve *curve, dou
     {
       for ( int i = 0; i < numOutPoints; ++i )
       {
-        const QgsPointV2 &pt = line->pointN( i % numPoints ); //todo: create method to get const point reference
-        GEOSCoordSeq_setX_r( geosinit.ctxt, coordSeq, i, qgsRound( pt.x() / precision ) * precision );
-        GEOSCoordSeq_setY_r( geosinit.ctxt, coordSeq, i, qgsRound( pt.y() / precision ) * precision );
+        const int j = i % numPoints;
+        GEOSCoordSeq_setX_r( geosinit()->ctxt, coordSeq, i, qgsRound( line->xAt( j ) / precision ) * precision );
+        GEOSCoordSeq_setY_r( geosinit()->ctxt, coordSeq, i, qgsRound( line->yAt( j ) / precision ) * precision );
         if ( hasZ )
         {
-          GEOSCoordSeq_setOrdinate_r( geosinit.ctxt, coordSeq, i, 2, qgsRound( pt.z() / precision ) * precision );
+          GEOSCoordSeq_setOrdinate_r( geosinit()->ctxt, coordSeq, i, 2, qgsRound( line->zAt( j ) / precision ) * precision );
         }
         if ( hasM )
         {
-          GEOSCoordSeq_setOrdinate_r( geosinit.ctxt, coordSeq, i, 3, pt.m() );
+          GEOSCoordSeq_setOrdinate_r( geosinit()->ctxt, coordSeq, i, 3, line->mAt( j ) );
         }
       }
     }
@@ -1537,16 +1551,16 @@ GEOSCoordSequence *QgsGeos::createCoordinateSequence( const QgsCurve *curve, dou
     {
       for ( int i = 0; i < numOutPoints; ++i )
       {
-        const QgsPointV2 &pt = line->pointN( i % numPoints ); //todo: create method to get const point reference
-        GEOSCoordSeq_setX_r( geosinit.ctxt, coordSeq, i, pt.x() );
-        GEOSCoordSeq_setY_r( geosinit.ctxt, coordSeq, i, pt.y() );
+        const int j = i % numPoints;
+        GEOSCoordSeq_setX_r( geosinit()->ctxt, coordSeq, i, line->xAt( j ) );
+        GEOSCoordSeq_setY_r( geosinit()->ctxt, coordSeq, i, line->yAt( j ) );
         if ( hasZ )
         {
-          GEOSCoordSeq_setOrdinate_r( geosinit.ctxt, coordSeq, i, 2, pt.z() );
+          GEOSCoordSeq_setOrdinate_r( geosinit()->ctxt, coordSeq, i, 2, line->zAt( j ) );
         }
         if ( hasM )
         {
-          GEOSCoordSeq_setOrdinate_r( geosinit.ctxt, coordSeq, i, 3, pt.m() );
+          GEOSCoordSeq_setOrdinate_r( geosinit()->ctxt, coordSeq, i, 3, line->mAt( j ) );
         }
       }
     }
@@ -1570,7 +1584,7 @@ GEOSGeometry *QgsGeos::createGeosPoint( const QgsAbstractGeometry *point, int co
 
   try
   {
-    GEOSCoordSequence *coordSeq = GEOSCoordSeq_create_r( geosinit.ctxt, 1, coordDims );
+    GEOSCoordSequence *coordSeq = GEOSCoordSeq_create_r( geosinit()->ctxt, 1, coordDims );
     if ( !coordSeq )
     {
       QgsMessageLog::logMessage( QObject::tr( "Could not create coordinate sequence for point with %1 dimensions" ).arg( coordDims ), QObject::tr( "GEOS" ) );
@@ -1578,29 +1592,29 @@ GEOSGeometry *QgsGeos::createGeosPoint( const QgsAbstractGeometry *point, int co
     }
     if ( precision > 0. )
     {
-      GEOSCoordSeq_setX_r( geosinit.ctxt, coordSeq, 0, qgsRound( pt->x() / precision ) * precision );
-      GEOSCoordSeq_setY_r( geosinit.ctxt, coordSeq, 0, qgsRound( pt->y() / precision ) * precision );
+      GEOSCoordSeq_setX_r( geosinit()->ctxt, coordSeq, 0, qgsRound( pt->x() / precision ) * precision );
+      GEOSCoordSeq_setY_r( geosinit()->ctxt, coordSeq, 0, qgsRound( pt->y() / precision ) * precision );
       if ( pt->is3D() )
       {
-        GEOSCoordSeq_setOrdinate_r( geosinit.ctxt, coordSeq, 0, 2, qgsRound( pt->z() / precision ) * precision );
+        GEOSCoordSeq_setOrdinate_r( geosinit()->ctxt, coordSeq, 0, 2, qgsRound( pt->z() / precision ) * precision );
       }
     }
     else
     {
-      GEOSCoordSeq_setX_r( geosinit.ctxt, coordSeq, 0, pt->x() );
-      GEOSCoordSeq_setY_r( geosinit.ctxt, coordSeq, 0, pt->y() );
+      GEOSCoordSeq_setX_r( geosinit()->ctxt, coordSeq, 0, pt->x() );
+      GEOSCoordSeq_setY_r( geosinit()->ctxt, coordSeq, 0, pt->y() );
       if ( pt->is3D() )
       {
-        GEOSCoordSeq_setOrdinate_r( geosinit.ctxt, coordSeq, 0, 2, pt->z() );
+        GEOSCoordSeq_setOrdinate_r( geosinit()->ctxt, coordSeq, 0, 2, pt->z() );
       }
     }
 #if 0 //disabled until geos supports m-coordinates
     if ( pt->isMeasure() )
     {
-      GEOSCoordSeq_setOrdinate_r( geosinit.ctxt, coordSeq, 0, 3, pt->m() );
+      GEOSCoordSeq_setOrdinate_r( geosinit()->ctxt, coordSeq, 0, 3, pt->m() );
     }
 #endif
-    geosPoint = GEOSGeom_createPoint_r( geosinit.ctxt, coordSeq );
+    geosPoint = GEOSGeom_createPoint_r( geosinit()->ctxt, coordSeq );
   }
   CATCH_GEOS( nullptr )
   return geosPoint;
@@ -1619,7 +1633,7 @@ GEOSGeometry *QgsGeos::createGeosLinestring( const QgsAbstractGeometry *curve, d
   GEOSGeometry *geosGeom = nullptr;
   try
   {
-    geosGeom = GEOSGeom_createLineString_r( geosinit.ctxt, coordSeq );
+    geosGeom = GEOSGeom_createLineString_r( geosinit()->ctxt, coordSeq );
   }
   CATCH_GEOS( nullptr )
   return geosGeom;
@@ -1640,7 +1654,7 @@ GEOSGeometry *QgsGeos::createGeosPolygon( const QgsAbstractGeometry *poly, doubl
   GEOSGeometry *geosPolygon = nullptr;
   try
   {
-    GEOSGeometry *exteriorRingGeos = GEOSGeom_createLinearRing_r( geosinit.ctxt, createCoordinateSequence( exteriorRing, precision, true ) );
+    GEOSGeometry *exteriorRingGeos = GEOSGeom_createLinearRing_r( geosinit()->ctxt, createCoordinateSequence( exteriorRing, precision, true ) );
 
 
     int nHoles = polygon->numInteriorRings();
@@ -1653,9 +1667,9 @@ GEOSGeometry *QgsGeos::createGeosPolygon( const QgsAbstractGeometry *poly, doubl
     for ( int i = 0; i < nHoles; ++i )
     {
       const QgsCurve *interiorRing = polygon->interiorRing( i );
-      holes[i] = GEOSGeom_createLinearRing_r( geosinit.ctxt, createCoordinateSequence( interiorRing, precision, true ) );
+      holes[i] = GEOSGeom_createLinearRing_r( geosinit()->ctxt, createCoordinateSequence( interiorRing, precision, true ) );
     }
-    geosPolygon = GEOSGeom_createPolygon_r( geosinit.ctxt, exteriorRingGeos, holes, nHoles );
+    geosPolygon = GEOSGeom_createPolygon_r( geosinit()->ctxt, exteriorRingGeos, holes, nHoles );
     delete[] holes;
   }
   CATCH_GEOS( nullptr )
@@ -1671,11 +1685,11 @@ QgsAbstractGeometry *QgsGeos::offsetCurve( double distance, int segments, int jo
   GEOSGeometry *offset = nullptr;
   try
   {
-    offset = GEOSOffsetCurve_r( geosinit.ctxt, mGeos, distance, segments, joinStyle, mitreLimit );
+    offset = GEOSOffsetCurve_r( geosinit()->ctxt, mGeos, distance, segments, joinStyle, mitreLimit );
   }
   CATCH_GEOS_WITH_ERRMSG( nullptr )
   QgsAbstractGeometry *offsetGeom = fromGeos( offset );
-  GEOSGeom_destroy_r( geosinit.ctxt, offset );
+  GEOSGeom_destroy_r( geosinit()->ctxt, offset );
   return offsetGeom;
 }
 
@@ -1689,18 +1703,18 @@ QgsAbstractGeometry *QgsGeos::singleSidedBuffer( double distance, int segments,
   GEOSGeomScopedPtr geos;
   try
   {
-    GEOSBufferParams *bp  = GEOSBufferParams_create_r( geosinit.ctxt );
-    GEOSBufferParams_setSingleSided_r( geosinit.ctxt, bp, 1 );
-    GEOSBufferParams_setQuadrantSegments_r( geosinit.ctxt, bp, segments );
-    GEOSBufferParams_setJoinStyle_r( geosinit.ctxt, bp, joinStyle );
-    GEOSBufferParams_setMitreLimit_r( geosinit.ctxt, bp, mitreLimit );
+    GEOSBufferParams *bp  = GEOSBufferParams_create_r( geosinit()->ctxt );
+    GEOSBufferParams_setSingleSided_r( geosinit()->ctxt, bp, 1 );
+    GEOSBufferParams_setQuadrantSegments_r( geosinit()->ctxt, bp, segments );
+    GEOSBufferParams_setJoinStyle_r( geosinit()->ctxt, bp, joinStyle );
+    GEOSBufferParams_setMitreLimit_r( geosinit()->ctxt, bp, mitreLimit );
 
     if ( side == 1 )
     {
       distance = -distance;
     }
-    geos.reset( GEOSBufferWithParams_r( geosinit.ctxt, mGeos, bp, distance ) );
-    GEOSBufferParams_destroy_r( geosinit.ctxt, bp );
+    geos.reset( GEOSBufferWithParams_r( geosinit()->ctxt, mGeos, bp, distance ) );
+    GEOSBufferParams_destroy_r( geosinit()->ctxt, bp );
   }
   CATCH_GEOS_WITH_ERRMSG( nullptr );
   return fromGeos( geos.get() );
@@ -1717,16 +1731,16 @@ QgsAbstractGeometry *QgsGeos::reshapeGeometry( const QgsLineString &reshapeWithL
   GEOSGeometry *reshapeLineGeos = createGeosLinestring( &reshapeWithLine, mPrecision );
 
   //single or multi?
-  int numGeoms = GEOSGetNumGeometries_r( geosinit.ctxt, mGeos );
+  int numGeoms = GEOSGetNumGeometries_r( geosinit()->ctxt, mGeos );
   if ( numGeoms == -1 )
   {
     if ( errorCode ) { *errorCode = 1; }
-    GEOSGeom_destroy_r( geosinit.ctxt, reshapeLineGeos );
+    GEOSGeom_destroy_r( geosinit()->ctxt, reshapeLineGeos );
     return nullptr;
   }
 
   bool isMultiGeom = false;
-  int geosTypeId = GEOSGeomTypeId_r( geosinit.ctxt, mGeos );
+  int geosTypeId = GEOSGeomTypeId_r( geosinit()->ctxt, mGeos );
   if ( geosTypeId == GEOS_MULTILINESTRING || geosTypeId == GEOS_MULTIPOLYGON )
     isMultiGeom = true;
 
@@ -1746,8 +1760,8 @@ QgsAbstractGeometry *QgsGeos::reshapeGeometry( const QgsLineString &reshapeWithL
 
     if ( errorCode ) { *errorCode = 0; }
     QgsAbstractGeometry *reshapeResult = fromGeos( reshapedGeometry );
-    GEOSGeom_destroy_r( geosinit.ctxt, reshapedGeometry );
-    GEOSGeom_destroy_r( geosinit.ctxt, reshapeLineGeos );
+    GEOSGeom_destroy_r( geosinit()->ctxt, reshapedGeometry );
+    GEOSGeom_destroy_r( geosinit()->ctxt, reshapeLineGeos );
     return reshapeResult;
   }
   else
@@ -1763,9 +1777,9 @@ QgsAbstractGeometry *QgsGeos::reshapeGeometry( const QgsLineString &reshapeWithL
       for ( int i = 0; i < numGeoms; ++i )
       {
         if ( isLine )
-          currentReshapeGeometry = reshapeLine( GEOSGetGeometryN_r( geosinit.ctxt, mGeos, i ), reshapeLineGeos, mPrecision );
+          currentReshapeGeometry = reshapeLine( GEOSGetGeometryN_r( geosinit()->ctxt, mGeos, i ), reshapeLineGeos, mPrecision );
         else
-          currentReshapeGeometry = reshapePolygon( GEOSGetGeometryN_r( geosinit.ctxt, mGeos, i ), reshapeLineGeos, mPrecision );
+          currentReshapeGeometry = reshapePolygon( GEOSGetGeometryN_r( geosinit()->ctxt, mGeos, i ), reshapeLineGeos, mPrecision );
 
         if ( currentReshapeGeometry )
         {
@@ -1774,19 +1788,19 @@ QgsAbstractGeometry *QgsGeos::reshapeGeometry( const QgsLineString &reshapeWithL
         }
         else
         {
-          newGeoms[i] = GEOSGeom_clone_r( geosinit.ctxt, GEOSGetGeometryN_r( geosinit.ctxt, mGeos, i ) );
+          newGeoms[i] = GEOSGeom_clone_r( geosinit()->ctxt, GEOSGetGeometryN_r( geosinit()->ctxt, mGeos, i ) );
         }
       }
-      GEOSGeom_destroy_r( geosinit.ctxt, reshapeLineGeos );
+      GEOSGeom_destroy_r( geosinit()->ctxt, reshapeLineGeos );
 
       GEOSGeometry *newMultiGeom = nullptr;
       if ( isLine )
       {
-        newMultiGeom = GEOSGeom_createCollection_r( geosinit.ctxt, GEOS_MULTILINESTRING, newGeoms, numGeoms );
+        newMultiGeom = GEOSGeom_createCollection_r( geosinit()->ctxt, GEOS_MULTILINESTRING, newGeoms, numGeoms );
       }
       else //multipolygon
       {
-        newMultiGeom = GEOSGeom_createCollection_r( geosinit.ctxt, GEOS_MULTIPOLYGON, newGeoms, numGeoms );
+        newMultiGeom = GEOSGeom_createCollection_r( geosinit()->ctxt, GEOS_MULTIPOLYGON, newGeoms, numGeoms );
       }
 
       delete[] newGeoms;
@@ -1800,12 +1814,12 @@ QgsAbstractGeometry *QgsGeos::reshapeGeometry( const QgsLineString &reshapeWithL
       {
         if ( errorCode ) { *errorCode = 0; }
         QgsAbstractGeometry *reshapedMultiGeom = fromGeos( newMultiGeom );
-        GEOSGeom_destroy_r( geosinit.ctxt, newMultiGeom );
+        GEOSGeom_destroy_r( geosinit()->ctxt, newMultiGeom );
         return reshapedMultiGeom;
       }
       else
       {
-        GEOSGeom_destroy_r( geosinit.ctxt, newMultiGeom );
+        GEOSGeom_destroy_r( geosinit()->ctxt, newMultiGeom );
         if ( errorCode ) { *errorCode = 1; }
         return nullptr;
       }
@@ -1821,13 +1835,13 @@ QgsGeometry QgsGeos::mergeLines( QString *errorMsg ) const
     return QgsGeometry();
   }
 
-  if ( GEOSGeomTypeId_r( geosinit.ctxt, mGeos ) != GEOS_MULTILINESTRING )
+  if ( GEOSGeomTypeId_r( geosinit()->ctxt, mGeos ) != GEOS_MULTILINESTRING )
     return QgsGeometry();
 
   GEOSGeomScopedPtr geos;
   try
   {
-    geos.reset( GEOSLineMerge_r( geosinit.ctxt, mGeos ) );
+    geos.reset( GEOSLineMerge_r( geosinit()->ctxt, mGeos ) );
   }
   CATCH_GEOS_WITH_ERRMSG( QgsGeometry() );
   return QgsGeometry( fromGeos( geos.get() ) );
@@ -1850,11 +1864,11 @@ QgsGeometry QgsGeos::closestPoint( const QgsGeometry &other, QString *errorMsg )
   double ny = 0.0;
   try
   {
-    GEOSCoordSequence *nearestCoord = GEOSNearestPoints_r( geosinit.ctxt, mGeos, otherGeom.get() );
+    GEOSCoordSequence *nearestCoord = GEOSNearestPoints_r( geosinit()->ctxt, mGeos, otherGeom.get() );
 
-    ( void )GEOSCoordSeq_getX_r( geosinit.ctxt, nearestCoord, 0, &nx );
-    ( void )GEOSCoordSeq_getY_r( geosinit.ctxt, nearestCoord, 0, &ny );
-    GEOSCoordSeq_destroy_r( geosinit.ctxt, nearestCoord );
+    ( void )GEOSCoordSeq_getX_r( geosinit()->ctxt, nearestCoord, 0, &nx );
+    ( void )GEOSCoordSeq_getY_r( geosinit()->ctxt, nearestCoord, 0, &ny );
+    GEOSCoordSeq_destroy_r( geosinit()->ctxt, nearestCoord );
   }
   catch ( GEOSException &e )
   {
@@ -1887,14 +1901,14 @@ QgsGeometry QgsGeos::shortestLine( const QgsGeometry &other, QString *errorMsg )
   double ny2 = 0.0;
   try
   {
-    GEOSCoordSequence *nearestCoord = GEOSNearestPoints_r( geosinit.ctxt, mGeos, otherGeom.get() );
+    GEOSCoordSequence *nearestCoord = GEOSNearestPoints_r( geosinit()->ctxt, mGeos, otherGeom.get() );
 
-    ( void )GEOSCoordSeq_getX_r( geosinit.ctxt, nearestCoord, 0, &nx1 );
-    ( void )GEOSCoordSeq_getY_r( geosinit.ctxt, nearestCoord, 0, &ny1 );
-    ( void )GEOSCoordSeq_getX_r( geosinit.ctxt, nearestCoord, 1, &nx2 );
-    ( void )GEOSCoordSeq_getY_r( geosinit.ctxt, nearestCoord, 1, &ny2 );
+    ( void )GEOSCoordSeq_getX_r( geosinit()->ctxt, nearestCoord, 0, &nx1 );
+    ( void )GEOSCoordSeq_getY_r( geosinit()->ctxt, nearestCoord, 0, &ny1 );
+    ( void )GEOSCoordSeq_getX_r( geosinit()->ctxt, nearestCoord, 1, &nx2 );
+    ( void )GEOSCoordSeq_getY_r( geosinit()->ctxt, nearestCoord, 1, &ny2 );
 
-    GEOSCoordSeq_destroy_r( geosinit.ctxt, nearestCoord );
+    GEOSCoordSeq_destroy_r( geosinit()->ctxt, nearestCoord );
   }
   catch ( GEOSException &e )
   {
@@ -1927,7 +1941,7 @@ double QgsGeos::lineLocatePoint( const QgsPointV2 &point, QString *errorMsg ) co
   double distance = -1;
   try
   {
-    distance = GEOSProject_r( geosinit.ctxt, mGeos, otherGeom.get() );
+    distance = GEOSProject_r( geosinit()->ctxt, mGeos, otherGeom.get() );
   }
   catch ( GEOSException &e )
   {
@@ -1957,10 +1971,10 @@ QgsGeometry QgsGeos::polygonize( const QList<QgsAbstractGeometry *> &geometries,
 
   try
   {
-    GEOSGeomScopedPtr result( GEOSPolygonize_r( geosinit.ctxt, lineGeosGeometries, validLines ) );
+    GEOSGeomScopedPtr result( GEOSPolygonize_r( geosinit()->ctxt, lineGeosGeometries, validLines ) );
     for ( int i = 0; i < validLines; ++i )
     {
-      GEOSGeom_destroy_r( geosinit.ctxt, lineGeosGeometries[i] );
+      GEOSGeom_destroy_r( geosinit()->ctxt, lineGeosGeometries[i] );
     }
     delete[] lineGeosGeometries;
     return QgsGeometry( fromGeos( result.get() ) );
@@ -1973,7 +1987,7 @@ QgsGeometry QgsGeos::polygonize( const QList<QgsAbstractGeometry *> &geometries,
     }
     for ( int i = 0; i < validLines; ++i )
     {
-      GEOSGeom_destroy_r( geosinit.ctxt, lineGeosGeometries[i] );
+      GEOSGeom_destroy_r( geosinit()->ctxt, lineGeosGeometries[i] );
     }
     delete[] lineGeosGeometries;
     return QgsGeometry();
@@ -2002,9 +2016,9 @@ QgsGeometry QgsGeos::voronoiDiagram( const QgsAbstractGeometry *extent, double t
   GEOSGeomScopedPtr geos;
   try
   {
-    geos.reset( GEOSVoronoiDiagram_r( geosinit.ctxt, mGeos, extentGeos, tolerance, edgesOnly ) );
+    geos.reset( GEOSVoronoiDiagram_r( geosinit()->ctxt, mGeos, extentGeos, tolerance, edgesOnly ) );
 
-    if ( !geos || GEOSisEmpty_r( geosinit.ctxt, geos.get() ) != 0 )
+    if ( !geos || GEOSisEmpty_r( geosinit()->ctxt, geos.get() ) != 0 )
     {
       return QgsGeometry();
     }
@@ -2024,9 +2038,9 @@ QgsGeometry QgsGeos::delaunayTriangulation( double tolerance, bool edgesOnly, QS
   GEOSGeomScopedPtr geos;
   try
   {
-    geos.reset( GEOSDelaunayTriangulation_r( geosinit.ctxt, mGeos, tolerance, edgesOnly ) );
+    geos.reset( GEOSDelaunayTriangulation_r( geosinit()->ctxt, mGeos, tolerance, edgesOnly ) );
 
-    if ( !geos || GEOSisEmpty_r( geosinit.ctxt, geos.get() ) != 0 )
+    if ( !geos || GEOSisEmpty_r( geosinit()->ctxt, geos.get() ) != 0 )
     {
       return QgsGeometry();
     }
@@ -2040,21 +2054,21 @@ QgsGeometry QgsGeos::delaunayTriangulation( double tolerance, bool edgesOnly, QS
 //! Extract coordinates of linestring's endpoints. Returns false on error.
 static bool _linestringEndpoints( const GEOSGeometry *linestring, double &x1, double &y1, double &x2, double &y2 )
 {
-  const GEOSCoordSequence *coordSeq = GEOSGeom_getCoordSeq_r( geosinit.ctxt, linestring );
+  const GEOSCoordSequence *coordSeq = GEOSGeom_getCoordSeq_r( geosinit()->ctxt, linestring );
   if ( !coordSeq )
     return false;
 
   unsigned int coordSeqSize;
-  if ( GEOSCoordSeq_getSize_r( geosinit.ctxt, coordSeq, &coordSeqSize ) == 0 )
+  if ( GEOSCoordSeq_getSize_r( geosinit()->ctxt, coordSeq, &coordSeqSize ) == 0 )
     return false;
 
   if ( coordSeqSize < 2 )
     return false;
 
-  GEOSCoordSeq_getX_r( geosinit.ctxt, coordSeq, 0, &x1 );
-  GEOSCoordSeq_getY_r( geosinit.ctxt, coordSeq, 0, &y1 );
-  GEOSCoordSeq_getX_r( geosinit.ctxt, coordSeq, coordSeqSize - 1, &x2 );
-  GEOSCoordSeq_getY_r( geosinit.ctxt, coordSeq, coordSeqSize - 1, &y2 );
+  GEOSCoordSeq_getX_r( geosinit()->ctxt, coordSeq, 0, &x1 );
+  GEOSCoordSeq_getY_r( geosinit()->ctxt, coordSeq, 0, &y1 );
+  GEOSCoordSeq_getX_r( geosinit()->ctxt, coordSeq, coordSeqSize - 1, &x2 );
+  GEOSCoordSeq_getY_r( geosinit()->ctxt, coordSeq, coordSeqSize - 1, &y2 );
   return true;
 }
 
@@ -2080,12 +2094,12 @@ static GEOSGeometry *_mergeLinestrings( const GEOSGeometry *line1, const GEOSGeo
   // the intersection must be at the begin/end of both lines
   if ( intersectionAtOrigLineEndpoint && intersectionAtReshapeLineEndpoint )
   {
-    GEOSGeometry *g1 = GEOSGeom_clone_r( geosinit.ctxt, line1 );
-    GEOSGeometry *g2 = GEOSGeom_clone_r( geosinit.ctxt, line2 );
+    GEOSGeometry *g1 = GEOSGeom_clone_r( geosinit()->ctxt, line1 );
+    GEOSGeometry *g2 = GEOSGeom_clone_r( geosinit()->ctxt, line2 );
     GEOSGeometry *geoms[2] = { g1, g2 };
-    GEOSGeometry *multiGeom = GEOSGeom_createCollection_r( geosinit.ctxt, GEOS_MULTILINESTRING, geoms, 2 );
-    GEOSGeometry *res = GEOSLineMerge_r( geosinit.ctxt, multiGeom );
-    GEOSGeom_destroy_r( geosinit.ctxt, multiGeom );
+    GEOSGeometry *multiGeom = GEOSGeom_createCollection_r( geosinit()->ctxt, GEOS_MULTILINESTRING, geoms, 2 );
+    GEOSGeometry *res = GEOSLineMerge_r( geosinit()->ctxt, multiGeom );
+    GEOSGeom_destroy_r( geosinit()->ctxt, multiGeom );
     return res;
   }
   else
@@ -2105,22 +2119,22 @@ GEOSGeometry *QgsGeos::reshapeLine( const GEOSGeometry *line, const GEOSGeometry
   try
   {
     //make sure there are at least two intersection between line and reshape geometry
-    GEOSGeometry *intersectGeom = GEOSIntersection_r( geosinit.ctxt, line, reshapeLineGeos );
+    GEOSGeometry *intersectGeom = GEOSIntersection_r( geosinit()->ctxt, line, reshapeLineGeos );
     if ( intersectGeom )
     {
-      atLeastTwoIntersections = ( GEOSGeomTypeId_r( geosinit.ctxt, intersectGeom ) == GEOS_MULTIPOINT
-                                  && GEOSGetNumGeometries_r( geosinit.ctxt, intersectGeom ) > 1 );
+      atLeastTwoIntersections = ( GEOSGeomTypeId_r( geosinit()->ctxt, intersectGeom ) == GEOS_MULTIPOINT
+                                  && GEOSGetNumGeometries_r( geosinit()->ctxt, intersectGeom ) > 1 );
       // one point is enough when extending line at its endpoint
-      if ( GEOSGeomTypeId_r( geosinit.ctxt, intersectGeom ) == GEOS_POINT )
+      if ( GEOSGeomTypeId_r( geosinit()->ctxt, intersectGeom ) == GEOS_POINT )
       {
-        const GEOSCoordSequence *intersectionCoordSeq = GEOSGeom_getCoordSeq_r( geosinit.ctxt, intersectGeom );
+        const GEOSCoordSequence *intersectionCoordSeq = GEOSGeom_getCoordSeq_r( geosinit()->ctxt, intersectGeom );
         double xi, yi;
-        GEOSCoordSeq_getX_r( geosinit.ctxt, intersectionCoordSeq, 0, &xi );
-        GEOSCoordSeq_getY_r( geosinit.ctxt, intersectionCoordSeq, 0, &yi );
+        GEOSCoordSeq_getX_r( geosinit()->ctxt, intersectionCoordSeq, 0, &xi );
+        GEOSCoordSeq_getY_r( geosinit()->ctxt, intersectionCoordSeq, 0, &yi );
         oneIntersection = true;
         oneIntersectionPoint = QgsPoint( xi, yi );
       }
-      GEOSGeom_destroy_r( geosinit.ctxt, intersectGeom );
+      GEOSGeom_destroy_r( geosinit()->ctxt, intersectGeom );
     }
   }
   catch ( GEOSException &e )
@@ -2147,36 +2161,36 @@ GEOSGeometry *QgsGeos::reshapeLine( const GEOSGeometry *line, const GEOSGeometry
   GEOSGeometry *endLineVertex = createGeosPoint( &endPoint, 2, precision );
 
   bool isRing = false;
-  if ( GEOSGeomTypeId_r( geosinit.ctxt, line ) == GEOS_LINEARRING
-       || GEOSEquals_r( geosinit.ctxt, beginLineVertex, endLineVertex ) == 1 )
+  if ( GEOSGeomTypeId_r( geosinit()->ctxt, line ) == GEOS_LINEARRING
+       || GEOSEquals_r( geosinit()->ctxt, beginLineVertex, endLineVertex ) == 1 )
     isRing = true;
 
   //node line and reshape line
   GEOSGeometry *nodedGeometry = nodeGeometries( reshapeLineGeos, line );
   if ( !nodedGeometry )
   {
-    GEOSGeom_destroy_r( geosinit.ctxt, beginLineVertex );
-    GEOSGeom_destroy_r( geosinit.ctxt, endLineVertex );
+    GEOSGeom_destroy_r( geosinit()->ctxt, beginLineVertex );
+    GEOSGeom_destroy_r( geosinit()->ctxt, endLineVertex );
     return nullptr;
   }
 
   //and merge them together
-  GEOSGeometry *mergedLines = GEOSLineMerge_r( geosinit.ctxt, nodedGeometry );
-  GEOSGeom_destroy_r( geosinit.ctxt, nodedGeometry );
+  GEOSGeometry *mergedLines = GEOSLineMerge_r( geosinit()->ctxt, nodedGeometry );
+  GEOSGeom_destroy_r( geosinit()->ctxt, nodedGeometry );
   if ( !mergedLines )
   {
-    GEOSGeom_destroy_r( geosinit.ctxt, beginLineVertex );
-    GEOSGeom_destroy_r( geosinit.ctxt, endLineVertex );
+    GEOSGeom_destroy_r( geosinit()->ctxt, beginLineVertex );
+    GEOSGeom_destroy_r( geosinit()->ctxt, endLineVertex );
     return nullptr;
   }
 
-  int numMergedLines = GEOSGetNumGeometries_r( geosinit.ctxt, mergedLines );
+  int numMergedLines = GEOSGetNumGeometries_r( geosinit()->ctxt, mergedLines );
   if ( numMergedLines < 2 ) //some special cases. Normally it is >2
   {
-    GEOSGeom_destroy_r( geosinit.ctxt, beginLineVertex );
-    GEOSGeom_destroy_r( geosinit.ctxt, endLineVertex );
+    GEOSGeom_destroy_r( geosinit()->ctxt, beginLineVertex );
+    GEOSGeom_destroy_r( geosinit()->ctxt, endLineVertex );
     if ( numMergedLines == 1 ) //reshape line is from begin to endpoint. So we keep the reshapeline
-      return GEOSGeom_clone_r( geosinit.ctxt, reshapeLineGeos );
+      return GEOSGeom_clone_r( geosinit()->ctxt, reshapeLineGeos );
     else
       return nullptr;
   }
@@ -2188,19 +2202,19 @@ GEOSGeometry *QgsGeos::reshapeLine( const GEOSGeometry *line, const GEOSGeometry
   {
     const GEOSGeometry *currentGeom = nullptr;
 
-    currentGeom = GEOSGetGeometryN_r( geosinit.ctxt, mergedLines, i );
-    const GEOSCoordSequence *currentCoordSeq = GEOSGeom_getCoordSeq_r( geosinit.ctxt, currentGeom );
+    currentGeom = GEOSGetGeometryN_r( geosinit()->ctxt, mergedLines, i );
+    const GEOSCoordSequence *currentCoordSeq = GEOSGeom_getCoordSeq_r( geosinit()->ctxt, currentGeom );
     unsigned int currentCoordSeqSize;
-    GEOSCoordSeq_getSize_r( geosinit.ctxt, currentCoordSeq, &currentCoordSeqSize );
+    GEOSCoordSeq_getSize_r( geosinit()->ctxt, currentCoordSeq, &currentCoordSeqSize );
     if ( currentCoordSeqSize < 2 )
       continue;
 
     //get the two endpoints of the current line merge result
     double xBegin, xEnd, yBegin, yEnd;
-    GEOSCoordSeq_getX_r( geosinit.ctxt, currentCoordSeq, 0, &xBegin );
-    GEOSCoordSeq_getY_r( geosinit.ctxt, currentCoordSeq, 0, &yBegin );
-    GEOSCoordSeq_getX_r( geosinit.ctxt, currentCoordSeq, currentCoordSeqSize - 1, &xEnd );
-    GEOSCoordSeq_getY_r( geosinit.ctxt, currentCoordSeq, currentCoordSeqSize - 1, &yEnd );
+    GEOSCoordSeq_getX_r( geosinit()->ctxt, currentCoordSeq, 0, &xBegin );
+    GEOSCoordSeq_getY_r( geosinit()->ctxt, currentCoordSeq, 0, &yBegin );
+    GEOSCoordSeq_getX_r( geosinit()->ctxt, currentCoordSeq, currentCoordSeqSize - 1, &xEnd );
+    GEOSCoordSeq_getY_r( geosinit()->ctxt, currentCoordSeq, currentCoordSeqSize - 1, &yEnd );
     QgsPointV2 beginPoint( xBegin, yBegin );
     GEOSGeometry *beginCurrentGeomVertex = createGeosPoint( &beginPoint, 2, precision );
     QgsPointV2 endPoint( xEnd, yEnd );
@@ -2216,12 +2230,12 @@ GEOSGeometry *QgsGeos::reshapeLine( const GEOSGeometry *line, const GEOSGeometry
 
     //check how many endpoints equal the endpoints of the original line
     int nEndpointsSameAsOriginalLine = 0;
-    if ( GEOSEquals_r( geosinit.ctxt, beginCurrentGeomVertex, beginLineVertex ) == 1
-         || GEOSEquals_r( geosinit.ctxt, beginCurrentGeomVertex, endLineVertex ) == 1 )
+    if ( GEOSEquals_r( geosinit()->ctxt, beginCurrentGeomVertex, beginLineVertex ) == 1
+         || GEOSEquals_r( geosinit()->ctxt, beginCurrentGeomVertex, endLineVertex ) == 1 )
       nEndpointsSameAsOriginalLine += 1;
 
-    if ( GEOSEquals_r( geosinit.ctxt, endCurrentGeomVertex, beginLineVertex ) == 1
-         || GEOSEquals_r( geosinit.ctxt, endCurrentGeomVertex, endLineVertex ) == 1 )
+    if ( GEOSEquals_r( geosinit()->ctxt, endCurrentGeomVertex, beginLineVertex ) == 1
+         || GEOSEquals_r( geosinit()->ctxt, endCurrentGeomVertex, endLineVertex ) == 1 )
       nEndpointsSameAsOriginalLine += 1;
 
     //check if the current geometry overlaps the original geometry (GEOSOverlap does not seem to work with linestrings)
@@ -2236,28 +2250,28 @@ GEOSGeometry *QgsGeos::reshapeLine( const GEOSGeometry *line, const GEOSGeometry
     //logic to decide if this part belongs to the result
     if ( !isRing && nEndpointsSameAsOriginalLine == 1 && nEndpointsOnOriginalLine == 2 && currentGeomOverlapsOriginalGeom )
     {
-      resultLineParts.push_back( GEOSGeom_clone_r( geosinit.ctxt, currentGeom ) );
+      resultLineParts.push_back( GEOSGeom_clone_r( geosinit()->ctxt, currentGeom ) );
     }
     //for closed rings, we take one segment from the candidate list
     else if ( isRing && nEndpointsOnOriginalLine == 2 && currentGeomOverlapsOriginalGeom )
     {
-      probableParts.push_back( GEOSGeom_clone_r( geosinit.ctxt, currentGeom ) );
+      probableParts.push_back( GEOSGeom_clone_r( geosinit()->ctxt, currentGeom ) );
     }
     else if ( nEndpointsOnOriginalLine == 2 && !currentGeomOverlapsOriginalGeom )
     {
-      resultLineParts.push_back( GEOSGeom_clone_r( geosinit.ctxt, currentGeom ) );
+      resultLineParts.push_back( GEOSGeom_clone_r( geosinit()->ctxt, currentGeom ) );
     }
     else if ( nEndpointsSameAsOriginalLine == 2 && !currentGeomOverlapsOriginalGeom )
     {
-      resultLineParts.push_back( GEOSGeom_clone_r( geosinit.ctxt, currentGeom ) );
+      resultLineParts.push_back( GEOSGeom_clone_r( geosinit()->ctxt, currentGeom ) );
     }
     else if ( currentGeomOverlapsOriginalGeom && currentGeomOverlapsReshapeLine )
     {
-      resultLineParts.push_back( GEOSGeom_clone_r( geosinit.ctxt, currentGeom ) );
+      resultLineParts.push_back( GEOSGeom_clone_r( geosinit()->ctxt, currentGeom ) );
     }
 
-    GEOSGeom_destroy_r( geosinit.ctxt, beginCurrentGeomVertex );
-    GEOSGeom_destroy_r( geosinit.ctxt, endCurrentGeomVertex );
+    GEOSGeom_destroy_r( geosinit()->ctxt, beginCurrentGeomVertex );
+    GEOSGeom_destroy_r( geosinit()->ctxt, endCurrentGeomVertex );
   }
 
   //add the longest segment from the probable list for rings (only used for polygon rings)
@@ -2270,24 +2284,24 @@ GEOSGeometry *QgsGeos::reshapeLine( const GEOSGeometry *line, const GEOSGeometry
     for ( int i = 0; i < probableParts.size(); ++i )
     {
       currentGeom = probableParts.at( i );
-      GEOSLength_r( geosinit.ctxt, currentGeom, &currentLength );
+      GEOSLength_r( geosinit()->ctxt, currentGeom, &currentLength );
       if ( currentLength > maxLength )
       {
         maxLength = currentLength;
-        GEOSGeom_destroy_r( geosinit.ctxt, maxGeom );
+        GEOSGeom_destroy_r( geosinit()->ctxt, maxGeom );
         maxGeom = currentGeom;
       }
       else
       {
-        GEOSGeom_destroy_r( geosinit.ctxt, currentGeom );
+        GEOSGeom_destroy_r( geosinit()->ctxt, currentGeom );
       }
     }
     resultLineParts.push_back( maxGeom );
   }
 
-  GEOSGeom_destroy_r( geosinit.ctxt, beginLineVertex );
-  GEOSGeom_destroy_r( geosinit.ctxt, endLineVertex );
-  GEOSGeom_destroy_r( geosinit.ctxt, mergedLines );
+  GEOSGeom_destroy_r( geosinit()->ctxt, beginLineVertex );
+  GEOSGeom_destroy_r( geosinit()->ctxt, endLineVertex );
+  GEOSGeom_destroy_r( geosinit()->ctxt, mergedLines );
 
   GEOSGeometry *result = nullptr;
   if ( resultLineParts.size() < 1 )
@@ -2306,18 +2320,18 @@ GEOSGeometry *QgsGeos::reshapeLine( const GEOSGeometry *line, const GEOSGeometry
     }
 
     //create multiline from resultLineParts
-    GEOSGeometry *multiLineGeom = GEOSGeom_createCollection_r( geosinit.ctxt, GEOS_MULTILINESTRING, lineArray, resultLineParts.size() );
+    GEOSGeometry *multiLineGeom = GEOSGeom_createCollection_r( geosinit()->ctxt, GEOS_MULTILINESTRING, lineArray, resultLineParts.size() );
     delete [] lineArray;
 
     //then do a linemerge with the newly combined partstrings
-    result = GEOSLineMerge_r( geosinit.ctxt, multiLineGeom );
-    GEOSGeom_destroy_r( geosinit.ctxt, multiLineGeom );
+    result = GEOSLineMerge_r( geosinit()->ctxt, multiLineGeom );
+    GEOSGeom_destroy_r( geosinit()->ctxt, multiLineGeom );
   }
 
   //now test if the result is a linestring. Otherwise something went wrong
-  if ( GEOSGeomTypeId_r( geosinit.ctxt, result ) != GEOS_LINESTRING )
+  if ( GEOSGeomTypeId_r( geosinit()->ctxt, result ) != GEOS_LINESTRING )
   {
-    GEOSGeom_destroy_r( geosinit.ctxt, result );
+    GEOSGeom_destroy_r( geosinit()->ctxt, result );
     return nullptr;
   }
 
@@ -2331,13 +2345,13 @@ GEOSGeometry *QgsGeos::reshapePolygon( const GEOSGeometry *polygon, const GEOSGe
   int lastIntersectingRing = -2;
   const GEOSGeometry *lastIntersectingGeom = nullptr;
 
-  int nRings = GEOSGetNumInteriorRings_r( geosinit.ctxt, polygon );
+  int nRings = GEOSGetNumInteriorRings_r( geosinit()->ctxt, polygon );
   if ( nRings < 0 )
     return nullptr;
 
   //does outer ring intersect?
-  const GEOSGeometry *outerRing = GEOSGetExteriorRing_r( geosinit.ctxt, polygon );
-  if ( GEOSIntersects_r( geosinit.ctxt, outerRing, reshapeLineGeos ) == 1 )
+  const GEOSGeometry *outerRing = GEOSGetExteriorRing_r( geosinit()->ctxt, polygon );
+  if ( GEOSIntersects_r( geosinit()->ctxt, outerRing, reshapeLineGeos ) == 1 )
   {
     ++nIntersections;
     lastIntersectingRing = -1;
@@ -2351,8 +2365,8 @@ GEOSGeometry *QgsGeos::reshapePolygon( const GEOSGeometry *polygon, const GEOSGe
   {
     for ( int i = 0; i < nRings; ++i )
     {
-      innerRings[i] = GEOSGetInteriorRingN_r( geosinit.ctxt, polygon, i );
-      if ( GEOSIntersects_r( geosinit.ctxt, innerRings[i], reshapeLineGeos ) == 1 )
+      innerRings[i] = GEOSGetInteriorRingN_r( geosinit()->ctxt, polygon, i );
+      if ( GEOSIntersects_r( geosinit()->ctxt, innerRings[i], reshapeLineGeos ) == 1 )
       {
         ++nIntersections;
         lastIntersectingRing = i;
@@ -2382,12 +2396,12 @@ GEOSGeometry *QgsGeos::reshapePolygon( const GEOSGeometry *polygon, const GEOSGe
 
   //if reshaping took place, we need to reassemble the polygon and its rings
   GEOSGeometry *newRing = nullptr;
-  const GEOSCoordSequence *reshapeSequence = GEOSGeom_getCoordSeq_r( geosinit.ctxt, reshapeResult );
-  GEOSCoordSequence *newCoordSequence = GEOSCoordSeq_clone_r( geosinit.ctxt, reshapeSequence );
+  const GEOSCoordSequence *reshapeSequence = GEOSGeom_getCoordSeq_r( geosinit()->ctxt, reshapeResult );
+  GEOSCoordSequence *newCoordSequence = GEOSCoordSeq_clone_r( geosinit()->ctxt, reshapeSequence );
 
-  GEOSGeom_destroy_r( geosinit.ctxt, reshapeResult );
+  GEOSGeom_destroy_r( geosinit()->ctxt, reshapeResult );
 
-  newRing = GEOSGeom_createLinearRing_r( geosinit.ctxt, newCoordSequence );
+  newRing = GEOSGeom_createLinearRing_r( geosinit()->ctxt, newCoordSequence );
   if ( !newRing )
   {
     delete [] innerRings;
@@ -2398,13 +2412,13 @@ GEOSGeometry *QgsGeos::reshapePolygon( const GEOSGeometry *polygon, const GEOSGe
   if ( lastIntersectingRing == -1 )
     newOuterRing = newRing;
   else
-    newOuterRing = GEOSGeom_clone_r( geosinit.ctxt, outerRing );
+    newOuterRing = GEOSGeom_clone_r( geosinit()->ctxt, outerRing );
 
   //check if all the rings are still inside the outer boundary
   QList<GEOSGeometry *> ringList;
   if ( nRings > 0 )
   {
-    GEOSGeometry *outerRingPoly = GEOSGeom_createPolygon_r( geosinit.ctxt, GEOSGeom_clone_r( geosinit.ctxt, newOuterRing ), nullptr, 0 );
+    GEOSGeometry *outerRingPoly = GEOSGeom_createPolygon_r( geosinit()->ctxt, GEOSGeom_clone_r( geosinit()->ctxt, newOuterRing ), nullptr, 0 );
     if ( outerRingPoly )
     {
       GEOSGeometry *currentRing = nullptr;
@@ -2413,16 +2427,16 @@ GEOSGeometry *QgsGeos::reshapePolygon( const GEOSGeometry *polygon, const GEOSGe
         if ( lastIntersectingRing == i )
           currentRing = newRing;
         else
-          currentRing = GEOSGeom_clone_r( geosinit.ctxt, innerRings[i] );
+          currentRing = GEOSGeom_clone_r( geosinit()->ctxt, innerRings[i] );
 
         //possibly a ring is no longer contained in the result polygon after reshape
-        if ( GEOSContains_r( geosinit.ctxt, outerRingPoly, currentRing ) == 1 )
+        if ( GEOSContains_r( geosinit()->ctxt, outerRingPoly, currentRing ) == 1 )
           ringList.push_back( currentRing );
         else
-          GEOSGeom_destroy_r( geosinit.ctxt, currentRing );
+          GEOSGeom_destroy_r( geosinit()->ctxt, currentRing );
       }
     }
-    GEOSGeom_destroy_r( geosinit.ctxt, outerRingPoly );
+    GEOSGeom_destroy_r( geosinit()->ctxt, outerRingPoly );
   }
 
   GEOSGeometry **newInnerRings = new GEOSGeometry*[ringList.size()];
@@ -2431,7 +2445,7 @@ GEOSGeometry *QgsGeos::reshapePolygon( const GEOSGeometry *polygon, const GEOSGe
 
   delete [] innerRings;
 
-  GEOSGeometry *reshapedPolygon = GEOSGeom_createPolygon_r( geosinit.ctxt, newOuterRing, newInnerRings, ringList.size() );
+  GEOSGeometry *reshapedPolygon = GEOSGeom_createPolygon_r( geosinit()->ctxt, newOuterRing, newInnerRings, ringList.size() );
   delete[] newInnerRings;
 
   return reshapedPolygon;
@@ -2446,21 +2460,21 @@ int QgsGeos::lineContainedInLine( const GEOSGeometry *line1, const GEOSGeometry
 
   double bufferDistance = pow( 10.0L, geomDigits( line2 ) - 11 );
 
-  GEOSGeometry *bufferGeom = GEOSBuffer_r( geosinit.ctxt, line2, bufferDistance, DEFAULT_QUADRANT_SEGMENTS );
+  GEOSGeometry *bufferGeom = GEOSBuffer_r( geosinit()->ctxt, line2, bufferDistance, DEFAULT_QUADRANT_SEGMENTS );
   if ( !bufferGeom )
     return -2;
 
-  GEOSGeometry *intersectionGeom = GEOSIntersection_r( geosinit.ctxt, bufferGeom, line1 );
+  GEOSGeometry *intersectionGeom = GEOSIntersection_r( geosinit()->ctxt, bufferGeom, line1 );
 
   //compare ratio between line1Length and intersectGeomLength (usually close to 1 if line1 is contained in line2)
   double intersectGeomLength;
   double line1Length;
 
-  GEOSLength_r( geosinit.ctxt, intersectionGeom, &intersectGeomLength );
-  GEOSLength_r( geosinit.ctxt, line1, &line1Length );
+  GEOSLength_r( geosinit()->ctxt, intersectionGeom, &intersectGeomLength );
+  GEOSLength_r( geosinit()->ctxt, line1, &line1Length );
 
-  GEOSGeom_destroy_r( geosinit.ctxt, bufferGeom );
-  GEOSGeom_destroy_r( geosinit.ctxt, intersectionGeom );
+  GEOSGeom_destroy_r( geosinit()->ctxt, bufferGeom );
+  GEOSGeom_destroy_r( geosinit()->ctxt, intersectionGeom );
 
   double intersectRatio = line1Length / intersectGeomLength;
   if ( intersectRatio > 0.9 && intersectRatio < 1.1 )
@@ -2476,49 +2490,49 @@ int QgsGeos::pointContainedInLine( const GEOSGeometry *point, const GEOSGeometry
 
   double bufferDistance = pow( 10.0L, geomDigits( line ) - 11 );
 
-  GEOSGeometry *lineBuffer = GEOSBuffer_r( geosinit.ctxt, line, bufferDistance, 8 );
+  GEOSGeometry *lineBuffer = GEOSBuffer_r( geosinit()->ctxt, line, bufferDistance, 8 );
   if ( !lineBuffer )
     return -2;
 
   bool contained = false;
-  if ( GEOSContains_r( geosinit.ctxt, lineBuffer, point ) == 1 )
+  if ( GEOSContains_r( geosinit()->ctxt, lineBuffer, point ) == 1 )
     contained = true;
 
-  GEOSGeom_destroy_r( geosinit.ctxt, lineBuffer );
+  GEOSGeom_destroy_r( geosinit()->ctxt, lineBuffer );
   return contained;
 }
 
 int QgsGeos::geomDigits( const GEOSGeometry *geom )
 {
-  GEOSGeomScopedPtr bbox( GEOSEnvelope_r( geosinit.ctxt, geom ) );
+  GEOSGeomScopedPtr bbox( GEOSEnvelope_r( geosinit()->ctxt, geom ) );
   if ( !bbox.get() )
     return -1;
 
-  const GEOSGeometry *bBoxRing = GEOSGetExteriorRing_r( geosinit.ctxt, bbox.get() );
+  const GEOSGeometry *bBoxRing = GEOSGetExteriorRing_r( geosinit()->ctxt, bbox.get() );
   if ( !bBoxRing )
     return -1;
 
-  const GEOSCoordSequence *bBoxCoordSeq = GEOSGeom_getCoordSeq_r( geosinit.ctxt, bBoxRing );
+  const GEOSCoordSequence *bBoxCoordSeq = GEOSGeom_getCoordSeq_r( geosinit()->ctxt, bBoxRing );
 
   if ( !bBoxCoordSeq )
     return -1;
 
   unsigned int nCoords = 0;
-  if ( !GEOSCoordSeq_getSize_r( geosinit.ctxt, bBoxCoordSeq, &nCoords ) )
+  if ( !GEOSCoordSeq_getSize_r( geosinit()->ctxt, bBoxCoordSeq, &nCoords ) )
     return -1;
 
   int maxDigits = -1;
   for ( unsigned int i = 0; i < nCoords - 1; ++i )
   {
     double t;
-    GEOSCoordSeq_getX_r( geosinit.ctxt, bBoxCoordSeq, i, &t );
+    GEOSCoordSeq_getX_r( geosinit()->ctxt, bBoxCoordSeq, i, &t );
 
     int digits;
     digits = ceil( log10( fabs( t ) ) );
     if ( digits > maxDigits )
       maxDigits = digits;
 
-    GEOSCoordSeq_getY_r( geosinit.ctxt, bBoxCoordSeq, i, &t );
+    GEOSCoordSeq_getY_r( geosinit()->ctxt, bBoxCoordSeq, i, &t );
     digits = ceil( log10( fabs( t ) ) );
     if ( digits > maxDigits )
       maxDigits = digits;
@@ -2529,5 +2543,5 @@ int QgsGeos::geomDigits( const GEOSGeometry *geom )
 
 GEOSContextHandle_t QgsGeos::getGEOSHandler()
 {
-  return geosinit.ctxt;
+  return geosinit()->ctxt;
 }
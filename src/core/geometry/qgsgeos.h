@@ -188,6 +188,7 @@ class CORE_EXPORT QgsGeos: public QgsGeometryEngine
     static GEOSGeometry *asGeos( const QgsAbstractGeometry *geom, double precision = 0 );
     static QgsPointV2 coordSeqPoint( const GEOSCoordSequence *cs, int i, bool hasZ, bool hasM );
 
+    //! Returns the GEOS context of the calling thread, each thread uses its own context
     static GEOSContextHandle_t getGEOSHandler();
 
   private:
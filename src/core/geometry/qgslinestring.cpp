@@ -24,6 +24,7 @@
 #include "qgswkbptr.h"
 
 #include <QPainter>
+#include <cstring>
 #include <limits>
 #include <QDomDocument>
 #include <QtCore/qmath.h>
@@ -49,19 +50,15 @@ bool QgsLineString::operator==( const QgsCurve &other ) const
   if ( mWkbType != otherLine->mWkbType )
     return false;
 
-  if ( mX.count() != otherLine->mX.count() )
+  if ( mCoords.count() != otherLine->mCoords.count() )
     return false;
 
-  for ( int i = 0; i < mX.count(); ++i )
+  // both lines have the same type and thus the same layout
+  const double *coords = mCoords.constData();
+  const double *otherCoords = otherLine->mCoords.constData();
+  for ( int i = 0; i < mCoords.count(); ++i )
   {
-    if ( !qgsDoubleNear( mX.at( i ), otherLine->mX.at( i ) )
-         || !qgsDoubleNear( mY.at( i ), otherLine->mY.at( i ) ) )
-      return false;
-
-    if ( is3D() && !qgsDoubleNear( mZ.at( i ), otherLine->mZ.at( i ) ) )
-      return false;
-
-    if ( isMeasure() && !qgsDoubleNear( mM.at( i ), otherLine->mM.at( i ) ) )
+    if ( !qgsDoubleNear( coords[i], otherCoords[i] ) )
       return false;
   }
 
@@ -80,17 +77,15 @@ QgsLineString *QgsLineString::clone() const
 
 void QgsLineString::clear()
 {
-  mX.clear();
-  mY.clear();
-  mZ.clear();
-  mM.clear();
+  mCoords.clear();
   mWkbType = QgsWkbTypes::LineString;
+  mStride = 2;
   clearCache();
 }
 
 bool QgsLineString::isEmpty() const
 {
-  return mX.isEmpty();
+  return mCoords.isEmpty();
 }
 
 bool QgsLineString::fromWkb( QgsConstWkbPtr &wkbPtr )
@@ -123,15 +118,16 @@ QgsRectangle QgsLineString::calculateBoundingBox() const
   double xmax = -std::numeric_limits<double>::max();
   double ymax = -std::numeric_limits<double>::max();
 
-  Q_FOREACH ( double x, mX )
+  const double *coords = mCoords.constData();
+  const double *end = coords + mCoords.size();
+  for ( ; coords < end; coords += mStride )
   {
+    const double x = coords[0];
+    const double y = coords[1];
     if ( x < xmin )
       xmin = x;
     if ( x > xmax )
       xmax = x;
-  }
-  Q_FOREACH ( double y, mY )
-  {
     if ( y < ymin )
       ymin = y;
     if ( y > ymax )
@@ -170,9 +166,12 @@ QByteArray QgsLineString::asWkb() const
   QgsWkbPtr wkb( wkbArray );
   wkb << static_cast<char>( QgsApplication::endian() );
   wkb << static_cast<quint32>( wkbType() );
-  QgsPointSequence pts;
-  points( pts );
-  QgsGeometryUtils::pointsToWKB( wkb, pts, is3D(), isMeasure() );
+  wkb << static_cast<quint32>( numPoints() );
+  // the coordinates are stored in the WKB order
+  Q_FOREACH ( double coord, mCoords )
+  {
+    wkb << coord;
+  }
   return wkbArray;
 }
 
@@ -229,12 +228,13 @@ QString QgsLineString::asJSON( int precision ) const
 double QgsLineString::length() const
 {
   double length = 0;
-  int size = mX.size();
+  int size = numPoints();
+  const double *coords = mCoords.constData();
   double dx, dy;
-  for ( int i = 1; i < size; ++i )
+  for ( int i = 1; i < size; ++i, coords += mStride )
   {
-    dx = mX.at( i ) - mX.at( i - 1 );
-    dy = mY.at( i ) - mY.at( i - 1 );
+    dx = coords[mStride] - coords[0];
+    dy = coords[mStride + 1] - coords[1];
     length += sqrt( dx * dx + dy * dy );
   }
   return length;
@@ -273,30 +273,31 @@ QgsLineString *QgsLineString::curveToLine( double tolerance, SegmentationToleran
 
 int QgsLineString::numPoints() const
 {
-  return mX.size();
+  return mCoords.size() / mStride;
 }
 
 QgsPointV2 QgsLineString::pointN( int i ) const
 {
-  if ( i < 0 || i >= mX.size() )
+  if ( i < 0 || i >= numPoints() )
   {
     return QgsPointV2();
   }
 
-  double x = mX.at( i );
-  double y = mY.at( i );
+  const double *coords = mCoords.constData() + i * mStride;
+  double x = coords[0];
+  double y = coords[1];
   double z = 0;
   double m = 0;
 
   bool hasZ = is3D();
   if ( hasZ )
   {
-    z = mZ.at( i );
+    z = coords[2];
   }
   bool hasM = isMeasure();
   if ( hasM )
   {
-    m = mM.at( i );
+    m = coords[hasZ ? 3 : 2];
   }
 
   QgsWkbTypes::Type t = QgsWkbTypes::Point;
@@ -327,60 +328,60 @@ QgsPointV2 QgsLineString::pointN( int i ) const
 
 double QgsLineString::xAt( int index ) const
 {
-  if ( index >= 0 && index < mX.size() )
-    return mX.at( index );
+  if ( index >= 0 && index * mStride < mCoords.size() )
+    return mCoords.at( index * mStride );
   else
     return 0.0;
 }
 
 double QgsLineString::yAt( int index ) const
 {
-  if ( index >= 0 && index < mY.size() )
-    return mY.at( index );
+  if ( index >= 0 && index * mStride < mCoords.size() )
+    return mCoords.at( index * mStride + 1 );
   else
     return 0.0;
 }
 
 double QgsLineString::zAt( int index ) const
 {
-  if ( index >= 0 && index < mZ.size() )
-    return mZ.at( index );
+  if ( is3D() && index >= 0 && index * mStride < mCoords.size() )
+    return mCoords.at( index * mStride + 2 );
   else
     return 0.0;
 }
 
 double QgsLineString::mAt( int index ) const
 {
-  if ( index >= 0 && index < mM.size() )
-    return mM.at( index );
+  if ( isMeasure() && index >= 0 && index * mStride < mCoords.size() )
+    return mCoords.at( index * mStride + mStride - 1 );
   else
     return 0.0;
 }
 
 void QgsLineString::setXAt( int index, double x )
 {
-  if ( index >= 0 && index < mX.size() )
-    mX[ index ] = x;
+  if ( index >= 0 && index * mStride < mCoords.size() )
+    mCoords[ index * mStride ] = x;
   clearCache();
 }
 
 void QgsLineString::setYAt( int index, double y )
 {
-  if ( index >= 0 && index < mY.size() )
-    mY[ index ] = y;
+  if ( index >= 0 && index * mStride < mCoords.size() )
+    mCoords[ index * mStride + 1 ] = y;
   clearCache();
 }
 
 void QgsLineString::setZAt( int index, double z )
 {
-  if ( index >= 0 && index < mZ.size() )
-    mZ[ index ] = z;
+  if ( is3D() && index >= 0 && index * mStride < mCoords.size() )
+    mCoords[ index * mStride + 2 ] = z;
 }
 
 void QgsLineString::setMAt( int index, double m )
 {
-  if ( index >= 0 && index < mM.size() )
-    mM[ index ] = m;
+  if ( isMeasure() && index >= 0 && index * mStride < mCoords.size() )
+    mCoords[ index * mStride + mStride - 1 ] = m;
 }
 
 /***************************************************************************
@@ -393,6 +394,7 @@ void QgsLineString::points( QgsPointSequence &pts ) const
 {
   pts.clear();
   int nPoints = numPoints();
+  pts.reserve( nPoints );
   for ( int i = 0; i < nPoints; ++i )
   {
     pts.push_back( pointN( i ) );
@@ -415,37 +417,22 @@ void QgsLineString::setPoints( const QgsPointSequence &points )
   bool hasM = firstPt.isMeasure();
 
   setZMTypeFromSubGeometry( &firstPt, QgsWkbTypes::LineString );
+  updateStride();
 
-  mX.resize( points.size() );
-  mY.resize( points.size() );
-  if ( hasZ )
-  {
-    mZ.resize( points.size() );
-  }
-  else
-  {
-    mZ.clear();
-  }
-  if ( hasM )
-  {
-    mM.resize( points.size() );
-  }
-  else
-  {
-    mM.clear();
-  }
-
+  mCoords.resize( points.size() * mStride );
+  double *coords = mCoords.data();
   for ( int i = 0; i < points.size(); ++i )
   {
-    mX[i] = points.at( i ).x();
-    mY[i] = points.at( i ).y();
+    const QgsPointV2 &pt = points.at( i );
+    *coords++ = pt.x();
+    *coords++ = pt.y();
     if ( hasZ )
     {
-      mZ[i] = points.at( i ).z();
+      *coords++ = pt.z();
     }
     if ( hasM )
     {
-      mM[i] = points.at( i ).m();
+      *coords++ = pt.m();
     }
   }
 }
@@ -466,6 +453,7 @@ void QgsLineString::append( const QgsLineString *line )
   if ( numPoints() < 1 )
   {
     setZMTypeFromSubGeometry( line, QgsWkbTypes::LineString );
+    updateStride();
   }
 
   // do not store duplicit points
@@ -473,45 +461,41 @@ void QgsLineString::append( const QgsLineString *line )
        line->numPoints() > 0 &&
        endPoint() == line->startPoint() )
   {
-    mX.pop_back();
-    mY.pop_back();
-
-    if ( is3D() )
-    {
-      mZ.pop_back();
-    }
-    if ( isMeasure() )
-    {
-      mM.pop_back();
-    }
+    mCoords.resize( mCoords.size() - mStride );
   }
 
-  mX += line->mX;
-  mY += line->mY;
+  // line may be this line
+  const QVector<double> lineCoords = line->mCoords;
+  const int lineStride = line->mStride;
+  const int linePoints = lineCoords.size() / lineStride;
 
-  if ( is3D() )
+  if ( is3D() == line->is3D() && isMeasure() == line->isMeasure() )
   {
-    if ( line->is3D() )
-    {
-      mZ += line->mZ;
-    }
-    else
-    {
-      // if append line does not have z coordinates, fill with 0 to match number of points in final line
-      mZ.insert( mZ.count(), mX.size() - mZ.size(), 0 );
-    }
+    mCoords += lineCoords;
   }
-
-  if ( isMeasure() )
+  else
   {
-    if ( line->isMeasure() )
+    // copy x and y, and z and m values if both lines have them, otherwise fill with 0
+    const bool hasZ = is3D();
+    const bool hasM = isMeasure();
+    const bool lineHasZ = line->is3D();
+    const bool lineHasM = line->isMeasure();
+    int start = mCoords.size();
+    mCoords.resize( start + linePoints * mStride );
+    double *coords = mCoords.data() + start;
+    const double *src = lineCoords.constData();
+    for ( int i = 0; i < linePoints; ++i, src += lineStride )
     {
-      mM += line->mM;
-    }
-    else
-    {
-      // if append line does not have m values, fill with 0 to match number of points in final line
-      mM.insert( mM.count(), mX.size() - mM.size(), 0 );
+      *coords++ = src[0];
+      *coords++ = src[1];
+      if ( hasZ )
+      {
+        *coords++ = lineHasZ ? src[2] : 0;
+      }
+      if ( hasM )
+      {
+        *coords++ = lineHasM ? src[lineStride - 1] : 0;
+      }
     }
   }
 
@@ -521,15 +505,11 @@ void QgsLineString::append( const QgsLineString *line )
 QgsLineString *QgsLineString::reversed() const
 {
   QgsLineString *copy = clone();
-  std::reverse( copy->mX.begin(), copy->mX.end() );
-  std::reverse( copy->mY.begin(), copy->mY.end() );
-  if ( copy->is3D() )
+  double *first = copy->mCoords.data();
+  double *last = first + copy->mCoords.size() - mStride;
+  for ( ; first < last; first += mStride, last -= mStride )
   {
-    std::reverse( copy->mZ.begin(), copy->mZ.end() );
-  }
-  if ( copy->isMeasure() )
-  {
-    std::reverse( copy->mM.begin(), copy->mM.end() );
+    std::swap_ranges( first, first + mStride, last );
   }
   return copy;
 }
@@ -540,6 +520,28 @@ QgsLineString *QgsLineString::reversed() const
  * See details in QEP #17
  ****************************************************************************/
 
+QPolygonF QgsLineString::asQPolygonF() const
+{
+  const int nPoints = numPoints();
+  QPolygonF points( nPoints );
+  if ( mStride == 2 && sizeof( QPointF ) == 2 * sizeof( double ) && sizeof( qreal ) == sizeof( double ) )
+  {
+    // x and y only, the coordinates already have the layout of QPointF
+    memcpy( points.data(), mCoords.constData(), mCoords.size() * sizeof( double ) );
+  }
+  else
+  {
+    const double *coords = mCoords.constData();
+    QPointF *point = points.data();
+    for ( int i = 0; i < nPoints; ++i, coords += mStride, ++point )
+    {
+      point->rx() = coords[0];
+      point->ry() = coords[1];
+    }
+  }
+  return points;
+}
+
 void QgsLineString::draw( QPainter &p ) const
 {
   p.drawPolyline( asQPolygonF() );
@@ -553,14 +555,16 @@ void QgsLineString::addToPainterPath( QPainterPath &path ) const
     return;
   }
 
-  if ( path.isEmpty() || path.currentPosition() != QPointF( mX.at( 0 ), mY.at( 0 ) ) )
+  const double *coords = mCoords.constData();
+  if ( path.isEmpty() || path.currentPosition() != QPointF( coords[0], coords[1] ) )
   {
-    path.moveTo( mX.at( 0 ), mY.at( 0 ) );
+    path.moveTo( coords[0], coords[1] );
   }
 
   for ( int i = 1; i < nPoints; ++i )
   {
-    path.lineTo( mX.at( i ), mY.at( i ) );
+    coords += mStride;
+    path.lineTo( coords[0], coords[1] );
   }
 }
 
@@ -578,27 +582,32 @@ QgsAbstractGeometry *QgsLineString::toCurveType() const
 
 void QgsLineString::extend( double startDistance, double endDistance )
 {
-  if ( mX.size() < 2 || mY.size() < 2 )
+  if ( numPoints() < 2 )
     return;
 
+  double *coords = mCoords.data();
+
   // start of line
   if ( startDistance > 0 )
   {
-    double currentLen = sqrt( qPow( mX.at( 0 ) - mX.at( 1 ), 2 ) +
-                              qPow( mY.at( 0 ) - mY.at( 1 ), 2 ) );
+    double *first = coords;
+    const double *second = coords + mStride;
+    double currentLen = sqrt( qPow( first[0] - second[0], 2 ) +
+                              qPow( first[1] - second[1], 2 ) );
     double newLen = currentLen + startDistance;
-    mX[ 0 ] = mX.at( 1 ) + ( mX.at( 0 ) - mX.at( 1 ) ) / currentLen * newLen;
-    mY[ 0 ] = mY.at( 1 ) + ( mY.at( 0 ) - mY.at( 1 ) ) / currentLen * newLen;
+    first[0] = second[0] + ( first[0] - second[0] ) / currentLen * newLen;
+    first[1] = second[1] + ( first[1] - second[1] ) / currentLen * newLen;
   }
   // end of line
   if ( endDistance > 0 )
   {
-    int last = mX.size() - 1;
-    double currentLen = sqrt( qPow( mX.at( last ) - mX.at( last - 1 ), 2 ) +
-                              qPow( mY.at( last ) - mY.at( last - 1 ), 2 ) );
+    double *last = coords + mCoords.size() - mStride;
+    const double *previous = last - mStride;
+    double currentLen = sqrt( qPow( last[0] - previous[0], 2 ) +
+                              qPow( last[1] - previous[1], 2 ) );
     double newLen = currentLen + endDistance;
-    mX[ last ] = mX.at( last - 1 ) + ( mX.at( last ) - mX.at( last - 1 ) ) / currentLen * newLen;
-    mY[ last ] = mY.at( last - 1 ) + ( mY.at( last ) - mY.at( last - 1 ) ) / currentLen * newLen;
+    last[0] = previous[0] + ( last[0] - previous[0] ) / currentLen * newLen;
+    last[1] = previous[1] + ( last[1] - previous[1] ) / currentLen * newLen;
   }
 }
 
@@ -610,20 +619,18 @@ void QgsLineString::extend( double startDistance, double endDistance )
 
 void QgsLineString::transform( const QgsCoordinateTransform &ct, QgsCoordinateTransform::TransformDirection d, bool transformZ )
 {
-  double *zArray = mZ.data();
+  double *coords = mCoords.data();
+  double *zArray = coords + 2;
 
   bool hasZ = is3D();
   int nPoints = numPoints();
   bool useDummyZ = !hasZ || !transformZ;
   if ( useDummyZ )
   {
-    zArray = new double[nPoints];
-    for ( int i = 0; i < nPoints; ++i )
-    {
-      zArray[i] = 0;
-    }
+    // same stride as the coordinates
+    zArray = new double[nPoints * mStride]();
   }
-  ct.transformCoords( nPoints, mX.data(), mY.data(), zArray, d );
+  ct.transformCoords( nPoints, coords, coords + 1, zArray, d, mStride );
   if ( useDummyZ )
   {
     delete[] zArray;
@@ -634,12 +641,13 @@ void QgsLineString::transform( const QgsCoordinateTransform &ct, QgsCoordinateTr
 void QgsLineString::transform( const QTransform &t )
 {
   int nPoints = numPoints();
-  for ( int i = 0; i < nPoints; ++i )
+  double *coords = mCoords.data();
+  for ( int i = 0; i < nPoints; ++i, coords += mStride )
   {
     qreal x, y;
-    t.map( mX.at( i ), mY.at( i ), &x, &y );
-    mX[i] = x;
-    mY[i] = y;
+    t.map( coords[0], coords[1], &x, &y );
+    coords[0] = x;
+    coords[1] = y;
   }
   clearCache();
 }
@@ -652,45 +660,39 @@ void QgsLineString::transform( const QTransform &t )
 
 bool QgsLineString::insertVertex( QgsVertexId position, const QgsPointV2 &vertex )
 {
-  if ( position.vertex < 0 || position.vertex > mX.size() )
+  if ( position.vertex < 0 || position.vertex > numPoints() )
   {
     return false;
   }
 
-  if ( mWkbType == QgsWkbTypes::Unknown || mX.isEmpty() )
+  if ( mWkbType == QgsWkbTypes::Unknown || mCoords.isEmpty() )
   {
     setZMTypeFromSubGeometry( &vertex, QgsWkbTypes::LineString );
+    updateStride();
   }
 
-  mX.insert( position.vertex, vertex.x() );
-  mY.insert( position.vertex, vertex.y() );
-  if ( is3D() )
-  {
-    mZ.insert( position.vertex, vertex.z() );
-  }
-  if ( isMeasure() )
-  {
-    mM.insert( position.vertex, vertex.m() );
-  }
+  mCoords.insert( position.vertex * mStride, mStride, 0.0 );
+  setVertexCoordinates( position.vertex, vertex );
   clearCache(); //set bounding box invalid
   return true;
 }
 
 bool QgsLineString::moveVertex( QgsVertexId position, const QgsPointV2 &newPos )
 {
-  if ( position.vertex < 0 || position.vertex >= mX.size() )
+  if ( position.vertex < 0 || position.vertex >= numPoints() )
   {
     return false;
   }
-  mX[position.vertex] = newPos.x();
-  mY[position.vertex] = newPos.y();
+  double *coords = mCoords.data() + position.vertex * mStride;
+  coords[0] = newPos.x();
+  coords[1] = newPos.y();
   if ( is3D() && newPos.is3D() )
   {
-    mZ[position.vertex] = newPos.z();
+    coords[2] = newPos.z();
   }
   if ( isMeasure() && newPos.isMeasure() )
   {
-    mM[position.vertex] = newPos.m();
+    coords[mStride - 1] = newPos.m();
   }
   clearCache(); //set bounding box invalid
   return true;
@@ -698,21 +700,12 @@ bool QgsLineString::moveVertex( QgsVertexId position, const QgsPointV2 &newPos )
 
 bool QgsLineString::deleteVertex( QgsVertexId position )
 {
-  if ( position.vertex >= mX.size() || position.vertex < 0 )
+  if ( position.vertex >= numPoints() || position.vertex < 0 )
   {
     return false;
   }
 
-  mX.remove( position.vertex );
-  mY.remove( position.vertex );
-  if ( is3D() )
-  {
-    mZ.remove( position.vertex );
-  }
-  if ( isMeasure() )
-  {
-    mM.remove( position.vertex );
-  }
+  mCoords.remove( position.vertex * mStride, mStride );
 
   if ( numPoints() == 1 )
   {
@@ -731,21 +724,15 @@ bool QgsLineString::deleteVertex( QgsVertexId position )
 
 void QgsLineString::addVertex( const QgsPointV2 &pt )
 {
-  if ( mWkbType == QgsWkbTypes::Unknown || mX.isEmpty() )
+  if ( mWkbType == QgsWkbTypes::Unknown || mCoords.isEmpty() )
   {
     setZMTypeFromSubGeometry( &pt, QgsWkbTypes::LineString );
+    updateStride();
   }
 
-  mX.append( pt.x() );
-  mY.append( pt.y() );
-  if ( is3D() )
-  {
-    mZ.append( pt.z() );
-  }
-  if ( isMeasure() )
-  {
-    mM.append( pt.m() );
-  }
+  const int index = numPoints();
+  mCoords.resize( mCoords.size() + mStride );
+  setVertexCoordinates( index, pt );
   clearCache(); //set bounding box invalid
 }
 
@@ -755,18 +742,19 @@ double QgsLineString::closestSegment( const QgsPointV2 &pt, QgsPointV2 &segmentP
   double testDist = 0;
   double segmentPtX, segmentPtY;
 
-  int size = mX.size();
+  int size = numPoints();
   if ( size == 0 || size == 1 )
   {
     vertexAfter = QgsVertexId( 0, 0, 0 );
     return -1;
   }
-  for ( int i = 1; i < size; ++i )
+  const double *coords = mCoords.constData();
+  for ( int i = 1; i < size; ++i, coords += mStride )
   {
-    double prevX = mX.at( i - 1 );
-    double prevY = mY.at( i - 1 );
-    double currentX = mX.at( i );
-    double currentY = mY.at( i );
+    double prevX = coords[0];
+    double prevY = coords[1];
+    double currentX = coords[mStride];
+    double currentY = coords[mStride + 1];
     testDist = QgsGeometryUtils::sqrDistToLine( pt.x(), pt.y(), prevX, prevY, currentX, currentY, segmentPtX, segmentPtY, epsilon );
     if ( testDist < sqrDist )
     {
@@ -804,23 +792,25 @@ bool QgsLineString::pointAt( int node, QgsPointV2 &point, QgsVertexId::VertexTyp
 
 QgsPointV2 QgsLineString::centroid() const
 {
-  if ( mX.isEmpty() )
+  if ( mCoords.isEmpty() )
     return QgsPointV2();
 
-  int numPoints = mX.count();
+  int numPoints = this->numPoints();
+  const double *coords = mCoords.constData();
   if ( numPoints == 1 )
-    return QgsPointV2( mX.at( 0 ), mY.at( 0 ) );
+    return QgsPointV2( coords[0], coords[1] );
 
   double totalLineLength = 0.0;
-  double prevX = mX.at( 0 );
-  double prevY = mY.at( 0 );
+  double prevX = coords[0];
+  double prevY = coords[1];
   double sumX = 0.0;
   double sumY = 0.0;
 
   for ( int i = 1; i < numPoints ; ++i )
   {
-    double currentX = mX.at( i );
-    double currentY = mY.at( i );
+    coords += mStride;
+    double currentX = coords[0];
+    double currentY = coords[1];
     double segmentLength = sqrt( qPow( currentX - prevX, 2.0 ) +
                                  qPow( currentY - prevY, 2.0 ) );
     if ( qgsDoubleNear( segmentLength, 0.0 ) )
@@ -834,7 +824,7 @@ QgsPointV2 QgsLineString::centroid() const
   }
 
   if ( qgsDoubleNear( totalLineLength, 0.0 ) )
-    return QgsPointV2( mX.at( 0 ), mY.at( 0 ) );
+    return QgsPointV2( mCoords.at( 0 ), mCoords.at( 1 ) );
   else
     return QgsPointV2( sumX / totalLineLength, sumY / totalLineLength );
 
@@ -849,35 +839,26 @@ QgsPointV2 QgsLineString::centroid() const
 void QgsLineString::sumUpArea( double &sum ) const
 {
   int maxIndex = numPoints() - 1;
+  const double *coords = mCoords.constData();
 
-  for ( int i = 0; i < maxIndex; ++i )
+  for ( int i = 0; i < maxIndex; ++i, coords += mStride )
   {
-    sum += 0.5 * ( mX.at( i ) * mY.at( i + 1 ) - mY.at( i ) * mX.at( i + 1 ) );
+    sum += 0.5 * ( coords[0] * coords[mStride + 1] - coords[1] * coords[mStride] );
   }
 }
 
 void QgsLineString::importVerticesFromWkb( const QgsConstWkbPtr &wkb )
 {
-  bool hasZ = is3D();
-  bool hasM = isMeasure();
+  updateStride();
   int nVertices = 0;
   wkb >> nVertices;
-  mX.resize( nVertices );
-  mY.resize( nVertices );
-  hasZ ? mZ.resize( nVertices ) : mZ.clear();
-  hasM ? mM.resize( nVertices ) : mM.clear();
-  for ( int i = 0; i < nVertices; ++i )
+  // the WKB stores the coordinates of each vertex in the same order
+  const int nCoords = nVertices * mStride;
+  mCoords.resize( nCoords );
+  double *coords = mCoords.data();
+  for ( int i = 0; i < nCoords; ++i )
   {
-    wkb >> mX[i];
-    wkb >> mY[i];
-    if ( hasZ )
-    {
-      wkb >> mZ[i];
-    }
-    if ( hasM )
-    {
-      wkb >> mM[i];
-    }
+    wkb >> coords[i];
   }
   clearCache(); //set bounding box invalid
 }
@@ -899,7 +880,7 @@ void QgsLineString::close()
 
 double QgsLineString::vertexAngle( QgsVertexId vertex ) const
 {
-  if ( mX.count() < 2 )
+  if ( numPoints() < 2 )
   {
     //undefined
     return 0.0;
@@ -909,33 +890,33 @@ double QgsLineString::vertexAngle( QgsVertexId vertex ) const
   {
     if ( isClosed() )
     {
-      double previousX = mX.at( numPoints() - 2 );
-      double previousY = mY.at( numPoints() - 2 );
-      double currentX = mX.at( 0 );
-      double currentY = mY.at( 0 );
-      double afterX = mX.at( 1 );
-      double afterY = mY.at( 1 );
+      double previousX = xAt( numPoints() - 2 );
+      double previousY = yAt( numPoints() - 2 );
+      double currentX = xAt( 0 );
+      double currentY = yAt( 0 );
+      double afterX = xAt( 1 );
+      double afterY = yAt( 1 );
       return QgsGeometryUtils::averageAngle( previousX, previousY, currentX, currentY, afterX, afterY );
     }
     else if ( vertex.vertex == 0 )
     {
-      return QgsGeometryUtils::lineAngle( mX.at( 0 ), mY.at( 0 ), mX.at( 1 ), mY.at( 1 ) );
+      return QgsGeometryUtils::lineAngle( xAt( 0 ), yAt( 0 ), xAt( 1 ), yAt( 1 ) );
     }
     else
     {
       int a = numPoints() - 2;
       int b = numPoints() - 1;
-      return QgsGeometryUtils::lineAngle( mX.at( a ), mY.at( a ), mX.at( b ), mY.at( b ) );
+      return QgsGeometryUtils::lineAngle( xAt( a ), yAt( a ), xAt( b ), yAt( b ) );
     }
   }
   else
   {
-    double previousX = mX.at( vertex.vertex - 1 );
-    double previousY = mY.at( vertex.vertex - 1 );
-    double currentX = mX.at( vertex.vertex );
-    double currentY = mY.at( vertex.vertex );
-    double afterX = mX.at( vertex.vertex + 1 );
-    double afterY = mY.at( vertex.vertex + 1 );
+    double previousX = xAt( vertex.vertex - 1 );
+    double previousY = yAt( vertex.vertex - 1 );
+    double currentX = xAt( vertex.vertex );
+    double currentY = yAt( vertex.vertex );
+    double afterX = xAt( vertex.vertex + 1 );
+    double afterY = yAt( vertex.vertex + 1 );
     return QgsGeometryUtils::averageAngle( previousX, previousY, currentX, currentY, afterX, afterY );
   }
 }
@@ -955,18 +936,12 @@ bool QgsLineString::addZValue( double zValue )
   if ( mWkbType == QgsWkbTypes::Unknown )
   {
     mWkbType = QgsWkbTypes::LineStringZ;
+    updateStride();
     return true;
   }
 
+  relayoutCoordinates( true, isMeasure(), zValue, 0.0 );
   mWkbType = QgsWkbTypes::addZ( mWkbType );
-
-  mZ.clear();
-  int nPoints = numPoints();
-  mZ.reserve( nPoints );
-  for ( int i = 0; i < nPoints; ++i )
-  {
-    mZ << zValue;
-  }
   return true;
 }
 
@@ -979,9 +954,11 @@ bool QgsLineString::addMValue( double mValue )
   if ( mWkbType == QgsWkbTypes::Unknown )
   {
     mWkbType = QgsWkbTypes::LineStringM;
+    updateStride();
     return true;
   }
 
+  relayoutCoordinates( is3D(), true, 0.0, mValue );
   if ( mWkbType == QgsWkbTypes::LineString25D )
   {
     mWkbType = QgsWkbTypes::LineStringZM;
@@ -990,14 +967,6 @@ bool QgsLineString::addMValue( double mValue )
   {
     mWkbType = QgsWkbTypes::addM( mWkbType );
   }
-
-  mM.clear();
-  int nPoints = numPoints();
-  mM.reserve( nPoints );
-  for ( int i = 0; i < nPoints; ++i )
-  {
-    mM << mValue;
-  }
   return true;
 }
 
@@ -1007,8 +976,8 @@ bool QgsLineString::dropZValue()
     return false;
 
   clearCache();
+  relayoutCoordinates( false, isMeasure(), 0.0, 0.0 );
   mWkbType = QgsWkbTypes::dropZ( mWkbType );
-  mZ.clear();
   return true;
 }
 
@@ -1018,8 +987,8 @@ bool QgsLineString::dropMValue()
     return false;
 
   clearCache();
+  relayoutCoordinates( is3D(), false, 0.0, 0.0 );
   mWkbType = QgsWkbTypes::dropM( mWkbType );
-  mM.clear();
   return true;
 }
 
@@ -1042,3 +1011,51 @@ bool QgsLineString::convertTo( QgsWkbTypes::Type type )
     return QgsCurve::convertTo( type );
   }
 }
+
+void QgsLineString::updateStride()
+{
+  mStride = 2 + ( is3D() ? 1 : 0 ) + ( isMeasure() ? 1 : 0 );
+}
+
+void QgsLineString::setVertexCoordinates( int index, const QgsPointV2 &pt )
+{
+  double *coords = mCoords.data() + index * mStride;
+  coords[0] = pt.x();
+  coords[1] = pt.y();
+  if ( is3D() )
+  {
+    coords[2] = pt.z();
+  }
+  if ( isMeasure() )
+  {
+    coords[mStride - 1] = pt.m();
+  }
+}
+
+void QgsLineString::relayoutCoordinates( bool hasZ, bool hasM, double zValue, double mValue )
+{
+  const bool oldHasZ = is3D();
+  const bool oldHasM = isMeasure();
+  const int oldStride = mStride;
+  const int nPoints = numPoints();
+  const int stride = 2 + ( hasZ ? 1 : 0 ) + ( hasM ? 1 : 0 );
+
+  QVector<double> coords( nPoints * stride );
+  const double *src = mCoords.constData();
+  double *dst = coords.data();
+  for ( int i = 0; i < nPoints; ++i, src += oldStride )
+  {
+    *dst++ = src[0];
+    *dst++ = src[1];
+    if ( hasZ )
+    {
+      *dst++ = oldHasZ ? src[2] : zValue;
+    }
+    if ( hasM )
+    {
+      *dst++ = oldHasM ? src[oldStride - 1] : mValue;
+    }
+  }
+  mCoords = coords;
+  mStride = stride;
+}
@@ -157,9 +157,10 @@ class CORE_EXPORT QgsLineString: public QgsCurve
     virtual QgsLineString *curveToLine( double tolerance = M_PI_2 / 90, SegmentationToleranceType toleranceType = MaximumAngle ) const override;
 
     int numPoints() const override;
-    virtual int nCoordinates() const override { return mX.size(); }
+    virtual int nCoordinates() const override { return numPoints(); }
     void points( QgsPointSequence &pt ) const override;
 
+    QPolygonF asQPolygonF() const override;
     void draw( QPainter &p ) const override;
 
     void transform( const QgsCoordinateTransform &ct, QgsCoordinateTransform::TransformDirection d = QgsCoordinateTransform::ForwardTransform,
@@ -196,10 +197,21 @@ class CORE_EXPORT QgsLineString: public QgsCurve
     virtual QgsRectangle calculateBoundingBox() const override;
 
   private:
-    QVector<double> mX;
-    QVector<double> mY;
-    QVector<double> mZ;
-    QVector<double> mM;
+    //! Coordinates of all vertices in a single buffer, x, y, z if 3D and m if measured for each vertex
+    QVector<double> mCoords;
+    //! Number of coordinates stored for each vertex, always matching the z and m flags of the type
+    int mStride = 2;
+
+    //! Updates mStride after the type of an empty line string was changed
+    void updateStride();
+
+    //! Stores the coordinates of a point as vertex \a index, which must exist
+    void setVertexCoordinates( int index, const QgsPointV2 &pt );
+
+    /** Converts the coordinates to a layout with or without z and m values, existing values
+     * are kept and new ones set to \a zValue and \a mValue. Must be called before the type is changed.
+     */
+    void relayoutCoordinates( bool hasZ, bool hasM, double zValue, double mValue );
 
     void importVerticesFromWkb( const QgsConstWkbPtr &wkb );
 
@@ -0,0 +1,278 @@
+/***************************************************************************
+                         qgswkbgeometryview.cpp
+                         ----------------------
+    begin                : February 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgswkbgeometryview.h"
+#include "qgsabstractgeometry.h"
+#include "qgspointv2.h"
+#include "qgswkbptr.h"
+
+#include <cmath>
+#include <limits>
+
+QgsWkbGeometryView::QgsWkbGeometryView( const QByteArray &wkb )
+  : mWkb( wkb )
+{
+  QgsConstWkbPtr ptr( mWkb );
+  try
+  {
+    mWkbType = ptr.readHeader();
+    const QgsWkbTypes::Type flatType = QgsWkbTypes::flatType( mWkbType );
+    if ( flatType == QgsWkbTypes::Point || flatType == QgsWkbTypes::LineString || flatType == QgsWkbTypes::Polygon )
+    {
+      QgsConstWkbPtr partPtr( mWkb );
+      mPartOffsets.append( 0 );
+      mVertexCount = skipPart( partPtr, mWkbType );
+    }
+    else if ( flatType == QgsWkbTypes::MultiPoint || flatType == QgsWkbTypes::MultiLineString || flatType == QgsWkbTypes::MultiPolygon )
+    {
+      const QgsWkbTypes::Type partType = QgsWkbTypes::singleType( mWkbType );
+      int numParts;
+      ptr >> numParts;
+      if ( numParts < 0 || numParts > ptr.remaining() / static_cast< int >( 1 + sizeof( int ) ) )
+        return;
+
+      for ( int i = 0; i < numParts && mVertexCount >= 0; ++i )
+      {
+        mPartOffsets.append( static_cast< int >( static_cast< const unsigned char * >( ptr ) - reinterpret_cast< const unsigned char * >( mWkb.constData() ) ) );
+        const int partVertices = skipPart( ptr, partType );
+        mVertexCount = partVertices < 0 ? -1 : mVertexCount + partVertices;
+      }
+    }
+    else
+    {
+      return;
+    }
+  }
+  catch ( const QgsWkbException & )
+  {
+    mVertexCount = -1;
+  }
+
+  mValid = mVertexCount >= 0;
+  if ( !mValid )
+  {
+    mVertexCount = 0;
+    mPartOffsets.clear();
+  }
+}
+
+int QgsWkbGeometryView::skipPart( QgsConstWkbPtr &ptr, QgsWkbTypes::Type type )
+{
+  if ( ptr.readHeader() != type )
+    return -1;
+
+  const int vertexSize = QgsWkbTypes::coordDimensions( type ) * sizeof( double );
+  switch ( QgsWkbTypes::flatType( type ) )
+  {
+    case QgsWkbTypes::Point:
+      ptr += vertexSize;
+      return 1;
+
+    case QgsWkbTypes::LineString:
+    {
+      int numPoints;
+      ptr >> numPoints;
+      if ( numPoints < 0 || numPoints > ptr.remaining() / vertexSize )
+        return -1;
+      ptr += numPoints * vertexSize;
+      return numPoints;
+    }
+
+    case QgsWkbTypes::Polygon:
+    {
+      int numRings;
+      ptr >> numRings;
+      if ( numRings < 0 || numRings > ptr.remaining() / static_cast< int >( sizeof( int ) ) )
+        return -1;
+      int vertices = 0;
+      for ( int i = 0; i < numRings; ++i )
+      {
+        int numPoints;
+        ptr >> numPoints;
+        if ( numPoints < 0 || numPoints > ptr.remaining() / vertexSize )
+          return -1;
+        ptr += numPoints * vertexSize;
+        vertices += numPoints;
+      }
+      return vertices;
+    }
+
+    default:
+      return -1;
+  }
+}
+
+QgsConstWkbPtr QgsWkbGeometryView::partData( int part, QgsWkbTypes::Type &type ) const
+{
+  const int offset = mPartOffsets.at( part );
+  QgsConstWkbPtr ptr( reinterpret_cast< const unsigned char * >( mWkb.constData() ) + offset, mWkb.size() - offset );
+  type = ptr.readHeader();
+  return ptr;
+}
+
+QgsRectangle QgsWkbGeometryView::boundingBox() const
+{
+  if ( !mValid )
+    return QgsRectangle();
+
+  double xmin = std::numeric_limits<double>::max();
+  double ymin = std::numeric_limits<double>::max();
+  double xmax = -std::numeric_limits<double>::max();
+  double ymax = -std::numeric_limits<double>::max();
+
+  for ( int part = 0; part < mPartOffsets.count(); ++part )
+  {
+    QgsWkbTypes::Type type;
+    QgsConstWkbPtr ptr = partData( part, type );
+    const int skipZM = ( QgsWkbTypes::coordDimensions( type ) - 2 ) * sizeof( double );
+
+    int numRings = 1;
+    const QgsWkbTypes::Type flatType = QgsWkbTypes::flatType( type );
+    if ( flatType == QgsWkbTypes::Polygon )
+      ptr >> numRings;
+
+    for ( int ring = 0; ring < numRings; ++ring )
+    {
+      int numPoints = 1;
+      if ( flatType != QgsWkbTypes::Point )
+        ptr >> numPoints;
+
+      for ( int i = 0; i < numPoints; ++i )
+      {
+        double x, y;
+        ptr >> x >> y;
+        ptr += skipZM;
+        // empty points are stored with NaN coordinates
+        if ( std::isnan( x ) || std::isnan( y ) )
+          continue;
+        xmin = std::min( xmin, x );
+        xmax = std::max( xmax, x );
+        ymin = std::min( ymin, y );
+        ymax = std::max( ymax, y );
+      }
+    }
+  }
+
+  if ( xmin > xmax )
+    return QgsRectangle();
+  return QgsRectangle( xmin, ymin, xmax, ymax );
+}
+
+QList< QPolygonF > QgsWkbGeometryView::partRings( int part ) const
+{
+  QList< QPolygonF > rings;
+  if ( !mValid || part < 0 || part >= mPartOffsets.count() )
+    return rings;
+
+  QgsWkbTypes::Type type;
+  QgsConstWkbPtr ptr = partData( part, type );
+  switch ( QgsWkbTypes::flatType( type ) )
+  {
+    case QgsWkbTypes::Point:
+    {
+      QPointF point;
+      ptr >> point;
+      rings << ( QPolygonF() << point );
+      break;
+    }
+
+    case QgsWkbTypes::LineString:
+    {
+      QPolygonF line;
+      ptr >> line;
+      rings << line;
+      break;
+    }
+
+    case QgsWkbTypes::Polygon:
+    {
+      int numRings;
+      ptr >> numRings;
+      rings.reserve( numRings );
+      for ( int i = 0; i < numRings; ++i )
+      {
+        QPolygonF ring;
+        ptr >> ring;
+        rings << ring;
+      }
+      break;
+    }
+
+    default:
+      break;
+  }
+  return rings;
+}
+
+bool QgsWkbGeometryView::nextVertex( QgsVertexId &id, QgsPointV2 &vertex ) const
+{
+  if ( !mValid )
+    return false;
+
+  if ( id.part < 0 || id.ring < 0 || id.vertex < 0 )
+  {
+    id.part = 0;
+    id.ring = 0;
+    id.vertex = -1;
+  }
+
+  for ( ; id.part < mPartOffsets.count(); ++id.part, id.ring = 0, id.vertex = -1 )
+  {
+    QgsWkbTypes::Type type;
+    QgsConstWkbPtr ptr = partData( id.part, type );
+    const int vertexSize = QgsWkbTypes::coordDimensions( type ) * sizeof( double );
+    const QgsWkbTypes::Type flatType = QgsWkbTypes::flatType( type );
+
+    int numRings = 1;
+    if ( flatType == QgsWkbTypes::Polygon )
+      ptr >> numRings;
+
+    for ( int ring = 0; ring < numRings; ++ring )
+    {
+      int numPoints = 1;
+      if ( flatType != QgsWkbTypes::Point )
+        ptr >> numPoints;
+
+      if ( ring < id.ring )
+      {
+        ptr += numPoints * vertexSize;
+        continue;
+      }
+      if ( ring > id.ring )
+      {
+        id.ring = ring;
+        id.vertex = -1;
+      }
+      if ( id.vertex + 1 >= numPoints )
+      {
+        ptr += numPoints * vertexSize;
+        continue;
+      }
+
+      ++id.vertex;
+      ptr += id.vertex * vertexSize;
+      double x, y, z = 0.0, m = 0.0;
+      ptr >> x >> y;
+      if ( QgsWkbTypes::hasZ( type ) )
+        ptr >> z;
+      if ( QgsWkbTypes::hasM( type ) )
+        ptr >> m;
+      vertex = QgsPointV2( QgsWkbTypes::zmType( QgsWkbTypes::Point, QgsWkbTypes::hasZ( type ), QgsWkbTypes::hasM( type ) ), x, y, z, m );
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,105 @@
+/***************************************************************************
+                         qgswkbgeometryview.h
+                         --------------------
+    begin                : February 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSWKBGEOMETRYVIEW_H
+#define QGSWKBGEOMETRYVIEW_H
+
+#include "qgis_core.h"
+#include "qgswkbtypes.h"
+#include "qgsrectangle.h"
+
+#include <QByteArray>
+#include <QList>
+#include <QPolygonF>
+#include <QVarLengthArray>
+
+class QgsConstWkbPtr;
+class QgsPointV2;
+struct QgsVertexId;
+
+/** \ingroup core
+ * \class QgsWkbGeometryView
+ * \brief Read-only view over a WKB buffer, giving access to the bounding box, the vertices
+ * and the rings of a geometry without building the QgsAbstractGeometry object tree.
+ *
+ * The structure of the WKB is validated once when the view is created, the accessors then
+ * read the coordinates directly from the shared buffer. Only points, line strings, polygons
+ * and their multi types are supported, with any dimension, other geometries result in an
+ * invalid view and must be parsed with QgsGeometryFactory.
+ *
+ * \note not available in Python bindings
+ * \note added in QGIS 3.0
+ */
+class CORE_EXPORT QgsWkbGeometryView
+{
+  public:
+
+    //! Creates an invalid view
+    QgsWkbGeometryView() = default;
+
+    //! Creates a view over \a wkb, which is shared and not copied
+    explicit QgsWkbGeometryView( const QByteArray &wkb );
+
+    //! Returns true if the WKB is a supported geometry with a valid structure
+    bool isValid() const { return mValid; }
+
+    //! Returns the WKB the view was created from
+    QByteArray wkb() const { return mWkb; }
+
+    //! Returns the WKB type of the geometry
+    QgsWkbTypes::Type wkbType() const { return mWkbType; }
+
+    //! Returns the number of parts, 1 for single geometries
+    int partCount() const { return mPartOffsets.count(); }
+
+    //! Returns the total number of vertices of all parts and rings
+    int vertexCount() const { return mVertexCount; }
+
+    //! Returns the bounding box of the geometry, computed on each call
+    QgsRectangle boundingBox() const;
+
+    /**
+     * Returns the rings of a part as polygons in layer coordinates, the exterior ring
+     * first for polygons. Line strings and points give a single ring.
+     * @param part part index, between 0 and partCount() - 1
+     */
+    QList< QPolygonF > partRings( int part ) const;
+
+    /**
+     * Returns the next vertex of the geometry, starting from an invalid \a id, with
+     * the same numbering as QgsAbstractGeometry::nextVertex().
+     * @returns false when there is no more vertex
+     */
+    bool nextVertex( QgsVertexId &id, QgsPointV2 &vertex ) const;
+
+  private:
+
+    QByteArray mWkb;
+    bool mValid = false;
+    QgsWkbTypes::Type mWkbType = QgsWkbTypes::Unknown;
+    int mVertexCount = 0;
+
+    //! Offset in mWkb of the header of each part, the geometry itself for single types
+    QVarLengthArray< int, 4 > mPartOffsets;
+
+    //! Validates a part of type \a type and skips it, returns the number of vertices or -1
+    static int skipPart( QgsConstWkbPtr &ptr, QgsWkbTypes::Type type );
+
+    //! Reads the header of a part and returns a pointer to its data
+    QgsConstWkbPtr partData( int part, QgsWkbTypes::Type &type ) const;
+};
+
+#endif // QGSWKBGEOMETRYVIEW_H
@@ -76,6 +76,7 @@ Pal::Pal()
   poly_p = 30;
 
   showPartial = true;
+  solveInParallel = false;
 }
 
 void Pal::removeLayer( Layer *layer )
@@ -477,7 +478,9 @@ QList<LabelPosition *> *Pal::labeller( double bbox[4], PalStat **stats, bool dis
   prob->displayAll = displayAll;
 
   // search a solution
-  if ( searchMethod == FALP )
+  if ( solveInParallel && ( searchMethod == FALP || searchMethod == CHAIN ) )
+    prob->solveComponents( searchMethod == CHAIN );
+  else if ( searchMethod == FALP )
     prob->init_sol_falp();
   else if ( searchMethod == CHAIN )
     prob->chain_search();
@@ -523,7 +526,9 @@ QList<LabelPosition *> *Pal::solveProblem( Problem *prob, bool displayAll )
 
   try
   {
-    if ( searchMethod == FALP )
+    if ( solveInParallel && ( searchMethod == FALP || searchMethod == CHAIN ) )
+      prob->solveComponents( searchMethod == CHAIN );
+    else if ( searchMethod == FALP )
       prob->init_sol_falp();
     else if ( searchMethod == CHAIN )
       prob->chain_search();
@@ -626,6 +631,16 @@ bool Pal::getShowPartial()
   return showPartial;
 }
 
+void Pal::setSolveInParallel( bool parallel )
+{
+  solveInParallel = parallel;
+}
+
+bool Pal::getSolveInParallel()
+{
+  return solveInParallel;
+}
+
 SearchMethod Pal::getSearch()
 {
   return searchMethod;
@@ -164,6 +164,22 @@ namespace pal
        */
       bool getShowPartial();
 
+      /**
+       * \brief Set whether FALP and chain search solve the independent parts of the problem in parallel
+       *
+       * The solution does not depend on the number of threads, but it may differ from the
+       * one of the sequential solver (see Problem::solveComponents()).
+       * @param parallel flag value
+       * @note added in QGIS 3.0
+       */
+      void setSolveInParallel( bool parallel );
+
+      /**
+       * \brief Get whether FALP and chain search solve the independent parts of the problem in parallel
+       * @note added in QGIS 3.0
+       */
+      bool getSolveInParallel();
+
       /**
        * \brief set # candidates to generate for points features
        * Higher the value is, longer Pal::labeller will spend time
@@ -260,6 +276,9 @@ namespace pal
        */
       bool showPartial;
 
+      //! Solve the independent parts of the problem in parallel
+      bool solveInParallel;
+
       //! Callback that may be called from PAL to check whether the job has not been cancelled in meanwhile
       FnIsCancelled fnIsCancelled;
       //! Application-specific context for the cancellation check function
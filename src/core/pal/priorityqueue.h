@@ -85,14 +85,26 @@ namespace pal
 
 
       int getId( int key );
+
+      /**
+       * Sets whether elements of equal priority are returned by increasing key. By default
+       * their order depends on the layout of the heap, and thus on all the inserted elements.
+       * Must be set before any element is inserted.
+       */
+      void setBreakTiesByKey( bool breakTies ) { breakTiesByKey = breakTies; }
+
     private:
 
+      //! Returns true if the element at heap position i comes after the one at position j
+      bool worse( int i, int j ) const;
+
       int size;
       int maxsize;
       int maxId;
       int *heap = nullptr;
       double *p = nullptr;
       int *pos = nullptr;
+      bool breakTiesByKey = false;
 
       bool ( *greater )( double l, double r );
   };
@@ -39,7 +39,10 @@
 #include "priorityqueue.h"
 #include "internalexception.h"
 #include <cfloat>
+#include <cstring>
 #include <limits> //for INT_MAX
+#include <QtConcurrentMap>
+#include <QThreadPool>
 
 #include "qgslabelingengine.h"
 
@@ -286,6 +289,7 @@ void Problem::init_sol_falp()
   init_sol_empty();
 
   list = new PriorityQueue( nblp, all_nblp, true );
+  list->setBreakTiesByKey( mComponentOrder );
 
   double amin[2];
   double amax[2];
@@ -2174,23 +2178,46 @@ void Problem::chain_search()
 
   int iter = 0;
 
+  // in component order, seeds are visited round robin from the first feature on. The next
+  // seed only depends on the previous one, so independent parts of the problem are visited
+  // in the same order whether they are solved together or separately (see solveComponents())
+  seed = nbft - 1;
+
   while ( true )
   {
 
     //check_solution();
 
-    for ( seed = ( iter + 1 ) % nbft;
-          ok[seed] && seed != iter;
-          seed = ( seed + 1 ) % nbft )
-      ;
+    if ( mComponentOrder )
+    {
+      int next = ( seed + 1 ) % nbft;
+      for ( i = 0; i < nbft && ok[next]; i++ )
+        next = ( next + 1 ) % nbft;
+
+      // All seeds are OK
+      if ( ok[next] )
+      {
+        break;
+      }
 
-    // All seeds are OK
-    if ( seed == iter )
+      seed = next;
+    }
+    else
     {
-      break;
+      for ( seed = ( iter + 1 ) % nbft;
+            ok[seed] && seed != iter;
+            seed = ( seed + 1 ) % nbft )
+        ;
+
+      // All seeds are OK
+      if ( seed == iter )
+      {
+        break;
+      }
+
+      iter = ( iter + 1 ) % nbft;
     }
 
-    iter = ( iter + 1 ) % nbft;
     retainedChain = chain( seed );
 
     if ( retainedChain && retainedChain->delta < - EPSILON )
@@ -2237,6 +2264,207 @@ void Problem::chain_search()
   delete[] ok;
 }
 
+typedef struct
+{
+  int *parent = nullptr;
+  LabelPosition *lp = nullptr;
+} ComponentContext;
+
+//! Minimum number of candidates of a group of components solved in the same thread
+const int COMPONENT_GROUP_MINIMUM_CANDIDATES = 2000;
+
+static int findComponent( int *parent, int feat )
+{
+  while ( parent[feat] != feat )
+  {
+    parent[feat] = parent[parent[feat]];
+    feat = parent[feat];
+  }
+  return feat;
+}
+
+static bool componentCallback( LabelPosition *lp, void *ctx )
+{
+  ComponentContext *context = reinterpret_cast< ComponentContext * >( ctx );
+  int *parent = context->parent;
+
+  // components are represented by their first feature
+  int c1 = findComponent( parent, lp->getProblemFeatureId() );
+  int c2 = findComponent( parent, context->lp->getProblemFeatureId() );
+  if ( c1 < c2 )
+    parent[c2] = c1;
+  else if ( c2 < c1 )
+    parent[c1] = c2;
+
+  return true;
+}
+
+typedef struct
+{
+  QVector<int> features;
+  int nbLp;
+  bool ok;
+} ComponentGroup;
+
+void Problem::solveComponents( bool useChainSearch )
+{
+  if ( nbft == 0 )
+    return;
+
+  mComponentOrder = true;
+
+  // with a single thread, the whole problem is solved at once in the same order
+  if ( QThreadPool::globalInstance()->maxThreadCount() < 2 )
+  {
+    if ( useChainSearch )
+      chain_search();
+    else
+      init_sol_falp();
+    return;
+  }
+
+  int i, j;
+  double amin[2];
+  double amax[2];
+
+  // features with candidates whose bounding boxes overlap are in the same component
+  int *parent = new int[nbft];
+  for ( i = 0; i < nbft; i++ )
+    parent[i] = i;
+
+  ComponentContext context;
+  context.parent = parent;
+  for ( i = 0; i < nbft; i++ )
+  {
+    for ( j = 0; j < featNbLp[i]; j++ )
+    {
+      context.lp = mLabelPositions.at( featStartId[i] + j );
+      context.lp->getBoundingBox( amin, amax );
+      candidates->Search( amin, amax, componentCallback, &context );
+    }
+  }
+
+  // small components are grouped in feature order, to keep the overhead of splitting
+  // the problem low. The groups do not depend on the number of threads.
+  int *groupOf = new int[nbft];
+  QList< ComponentGroup > groups;
+  for ( i = 0; i < nbft; i++ )
+  {
+    int component = findComponent( parent, i );
+    if ( component == i )
+    {
+      if ( groups.isEmpty() || groups.last().nbLp >= COMPONENT_GROUP_MINIMUM_CANDIDATES )
+      {
+        ComponentGroup group;
+        group.nbLp = 0;
+        group.ok = true;
+        groups << group;
+      }
+      groupOf[i] = groups.count() - 1;
+    }
+
+    ComponentGroup &group = groups[ groupOf[component] ];
+    group.features << i;
+    group.nbLp += featNbLp[i];
+  }
+
+  delete[] groupOf;
+  delete[] parent;
+
+  if ( groups.count() == 1 )
+  {
+    if ( useChainSearch )
+      chain_search();
+    else
+      init_sol_falp();
+    return;
+  }
+
+  init_sol_empty();
+
+  QtConcurrent::blockingMap( groups, [this, useChainSearch]( ComponentGroup & group )
+  {
+    group.ok = solveFeatures( group.features, useChainSearch );
+  } );
+
+  Q_FOREACH ( const ComponentGroup &group, groups )
+  {
+    if ( !group.ok )
+      throw InternalException::Empty();
+  }
+
+  for ( i = 0; i < nbft; i++ )
+  {
+    if ( sol->s[i] >= 0 )
+      mLabelPositions.at( sol->s[i] )->insertIntoIndex( candidates_sol );
+  }
+
+  solution_cost();
+}
+
+bool Problem::solveFeatures( const QVector<int> &features, bool useChainSearch )
+{
+  Problem part;
+  part.mComponentOrder = true;
+  part.pal = pal;
+  part.displayAll = displayAll;
+  memcpy( part.bbox, bbox, sizeof( bbox ) );
+  part.nbft = features.count();
+  part.featStartId = new int[part.nbft];
+  part.featNbLp = new int[part.nbft];
+  part.inactiveCost = new double[part.nbft];
+
+  int i, j;
+
+  // candidates are numbered from 0 in the part, in the same order as in the whole problem
+  for ( i = 0; i < part.nbft; i++ )
+  {
+    int feat = features.at( i );
+    part.featStartId[i] = part.nblp;
+    part.featNbLp[i] = featNbLp[feat];
+    part.inactiveCost[i] = inactiveCost[feat];
+
+    for ( j = 0; j < featNbLp[feat]; j++ )
+    {
+      LabelPosition *lp = mLabelPositions.at( featStartId[feat] + j );
+      lp->setProblemIds( i, part.nblp++ );
+      lp->insertIntoIndex( part.candidates );
+      part.nbOverlap += lp->getNumOverlaps();
+      part.mLabelPositions.append( lp );
+    }
+  }
+  part.all_nblp = part.nblp;
+
+  bool ok = true;
+  try
+  {
+    if ( useChainSearch )
+      part.chain_search();
+    else
+      part.init_sol_falp();
+  }
+  catch ( InternalException::Empty )
+  {
+    ok = false;
+  }
+
+  // copy the solution and restore the numbering of the whole problem
+  for ( i = 0; i < part.nbft; i++ )
+  {
+    int feat = features.at( i );
+    if ( ok && part.sol && part.sol->s[i] >= 0 )
+      sol->s[feat] = featStartId[feat] + part.sol->s[i] - part.featStartId[i];
+
+    for ( j = 0; j < featNbLp[feat]; j++ )
+      mLabelPositions.at( featStartId[feat] + j )->setProblemIds( feat, featStartId[feat] + j );
+  }
+
+  // the candidates belong to the whole problem
+  part.mLabelPositions.clear();
+
+  return ok;
+}
+
 bool Problem::compareLabelArea( pal::LabelPosition *l1, pal::LabelPosition *l2 )
 {
   return l1->getWidth() * l1->getHeight() > l2->getWidth() * l2->getHeight();
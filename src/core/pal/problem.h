@@ -33,6 +33,7 @@
 #include "qgis_core.h"
 #include <list>
 #include <QList>
+#include <QVector>
 #include "rtree.hpp"
 
 namespace pal
@@ -146,6 +147,23 @@ namespace pal
        */
       void chain_search();
 
+      /**
+       * \brief Solves the problem with FALP or chain search, using several threads
+       *
+       * Features are grouped into components whose candidates can not conflict with
+       * the candidates of other components, and the components are solved concurrently.
+       * FALP and chain search are run in component order: FALP breaks ties between
+       * candidates by id and chain search visits the seeds round robin from the previous
+       * one. Each component is then solved exactly as if the whole problem was solved at
+       * once with the same order, which is what happens with a single thread, so the
+       * solution does not depend on the number of threads. It may differ from the one of
+       * init_sol_falp() and chain_search() alone, which break ties depending on the whole
+       * problem.
+       * \param useChainSearch true to improve the initial FALP solution with chain search
+       * \note added in QGIS 3.0
+       */
+      void solveComponents( bool useChainSearch );
+
       QList<LabelPosition *> *getSolution( bool returnInactive );
 
       PalStat *getStats();
@@ -249,6 +267,15 @@ namespace pal
 
       void solution_cost();
       void check_solution();
+
+      //! True to run FALP and chain search in component order (see solveComponents())
+      bool mComponentOrder = false;
+
+      /**
+       * Solves the part of the problem made of the given \a features, which must not
+       * have candidates in conflict with other features. Returns false if it failed.
+       */
+      bool solveFeatures( const QVector<int> &features, bool useChainSearch );
   };
 
 } // namespace
@@ -21,8 +21,65 @@
 #include "qgsfeatureiterator.h"
 #include "qgsgeometry.h"
 #include "qgsvectorlayer.h"
+#include "qgsvectorlayerfeatureiterator.h"
 
+#include <QThread>
+#include <QtConcurrentMap>
 
+//! Number of features evaluated at once when aggregating an expression
+static const int BLOCK_SIZE = 1024;
+
+//! Minimum number of features handled by each thread when calculating in parallel
+static const int PARALLEL_MINIMUM_FEATURES = 10000;
+
+///@cond PRIVATE
+
+//! Adds the values of the field or expression for all features of an iterator to a summary
+template< class Summary > static void addFeatureValues( Summary &summary, void ( Summary::*addValue )( const QVariant & ),
+    QgsFeatureIterator &fit, int attr, QgsExpression *expression, QgsExpressionContext *context )
+{
+  Q_ASSERT( expression || attr >= 0 );
+
+  QgsFeature f;
+  if ( expression )
+  {
+    Q_ASSERT( context );
+    QgsFeatureList block;
+    block.reserve( BLOCK_SIZE );
+    bool hasMore = true;
+    while ( hasMore )
+    {
+      hasMore = fit.nextFeature( f );
+      if ( hasMore )
+        block << f;
+      if ( block.count() == BLOCK_SIZE || ( !hasMore && !block.isEmpty() ) )
+      {
+        Q_FOREACH ( const QVariant &v, expression->evaluateBlock( block, context ) )
+          ( summary.*addValue )( v );
+        block.clear();
+      }
+    }
+  }
+  else
+  {
+    while ( fit.nextFeature( f ) )
+    {
+      ( summary.*addValue )( f.attribute( attr ) );
+    }
+  }
+}
+
+//! Subset of the features and partial aggregate when calculating in parallel
+struct QgsAggregatePartition
+{
+  std::shared_ptr< QgsVectorLayerFeatureSource > source;
+  QgsFeatureIds fids;
+  QgsStatisticalSummary numeric;
+  QgsStringStatisticalSummary string;
+  QgsDateTimeStatisticalSummary dateTime;
+};
+
+///@endcond
 
 QgsAggregateCalculator::QgsAggregateCalculator( const QgsVectorLayer *layer )
   : mLayer( layer )
@@ -39,6 +96,7 @@ void QgsAggregateCalculator::setParameters( const AggregateParameters &parameter
 {
   mFilterExpression = parameters.filter;
   mDelimiter = parameters.delimiter;
+  mParallel = parameters.parallel;
 }
 
 QVariant QgsAggregateCalculator::calculate( QgsAggregateCalculator::Aggregate aggregate,
@@ -69,6 +127,7 @@ QVariant QgsAggregateCalculator::calculate( QgsAggregateCalculator::Aggregate ag
     {
       return QVariant();
     }
+    expression->compile();
   }
 
   QSet<QString> lst;
@@ -114,6 +173,12 @@ QVariant QgsAggregateCalculator::calculate( QgsAggregateCalculator::Aggregate ag
     resultType = mLayer->fields().at( attrNum ).type();
   }
 
+  if ( mParallel && QThread::idealThreadCount() > 1 && mLayer->featureCount() >= 2 * PARALLEL_MINIMUM_FEATURES
+       && canCalculateInParallel( aggregate, resultType ) )
+  {
+    return calculateInParallel( aggregate, request, resultType, attrNum, expression.get(), context, ok );
+  }
+
   QgsFeatureIterator fit = mLayer->getFeatures( request );
   return calculate( aggregate, fit, resultType, attrNum, expression.get(), mDelimiter, context, ok );
 }
@@ -401,25 +466,8 @@ QgsDateTimeStatisticalSummary::Statistic QgsAggregateCalculator::dateTimeStatFro
 QVariant QgsAggregateCalculator::calculateNumericAggregate( QgsFeatureIterator &fit, int attr, QgsExpression *expression,
     QgsExpressionContext *context, QgsStatisticalSummary::Statistic stat )
 {
-  Q_ASSERT( expression || attr >= 0 );
-
   QgsStatisticalSummary s( stat );
-  QgsFeature f;
-
-  while ( fit.nextFeature( f ) )
-  {
-    if ( expression )
-    {
-      Q_ASSERT( context );
-      context->setFeature( f );
-      QVariant v = expression->evaluate( context );
-      s.addVariant( v );
-    }
-    else
-    {
-      s.addVariant( f.attribute( attr ) );
-    }
-  }
+  addFeatureValues( s, &QgsStatisticalSummary::addVariant, fit, attr, expression, context );
   s.finalize();
   double val = s.statistic( stat );
   return qIsNaN( val ) ? QVariant() : val;
@@ -428,25 +476,8 @@ QVariant QgsAggregateCalculator::calculateNumericAggregate( QgsFeatureIterator &
 QVariant QgsAggregateCalculator::calculateStringAggregate( QgsFeatureIterator &fit, int attr, QgsExpression *expression,
     QgsExpressionContext *context, QgsStringStatisticalSummary::Statistic stat )
 {
-  Q_ASSERT( expression || attr >= 0 );
-
   QgsStringStatisticalSummary s( stat );
-  QgsFeature f;
-
-  while ( fit.nextFeature( f ) )
-  {
-    if ( expression )
-    {
-      Q_ASSERT( context );
-      context->setFeature( f );
-      QVariant v = expression->evaluate( context );
-      s.addValue( v );
-    }
-    else
-    {
-      s.addValue( f.attribute( attr ) );
-    }
-  }
+  addFeatureValues( s, &QgsStringStatisticalSummary::addValue, fit, attr, expression, context );
   s.finalize();
   return s.statistic( stat );
 }
@@ -537,25 +568,169 @@ QVariant QgsAggregateCalculator::defaultValue( QgsAggregateCalculator::Aggregate
 QVariant QgsAggregateCalculator::calculateDateTimeAggregate( QgsFeatureIterator &fit, int attr, QgsExpression *expression,
     QgsExpressionContext *context, QgsDateTimeStatisticalSummary::Statistic stat )
 {
-  Q_ASSERT( expression || attr >= 0 );
-
   QgsDateTimeStatisticalSummary s( stat );
+  addFeatureValues( s, &QgsDateTimeStatisticalSummary::addValue, fit, attr, expression, context );
+  s.finalize();
+  return s.statistic( stat );
+}
+
+bool QgsAggregateCalculator::canCalculateInParallel( QgsAggregateCalculator::Aggregate aggregate, QVariant::Type resultType )
+{
+  // same dispatching as calculate(), concatenation and geometry aggregates depend on the feature order
+  bool statOk = false;
+  switch ( resultType )
+  {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+    case QVariant::Double:
+      numericStatFromAggregate( aggregate, &statOk );
+      return statOk;
+
+    case QVariant::Date:
+    case QVariant::DateTime:
+      dateTimeStatFromAggregate( aggregate, &statOk );
+      return statOk;
+
+    case QVariant::UserType:
+      return false;
+
+    default:
+      if ( aggregate == StringConcatenate )
+        return false;
+      stringStatFromAggregate( aggregate, &statOk );
+      return statOk;
+  }
+#ifndef _MSC_VER
+  return false;
+#endif
+}
+
+QVariant QgsAggregateCalculator::calculateInParallel( QgsAggregateCalculator::Aggregate aggregate, const QgsFeatureRequest &request,
+    QVariant::Type resultType, int attr, QgsExpression *expression, QgsExpressionContext *context, bool *ok ) const
+{
+  Q_ASSERT( context );
+
+  // collect the ids of the matching features in iteration order, the filter is only evaluated here
+  QgsFeatureRequest idRequest;
+  idRequest.setSubsetOfAttributes( QgsAttributeList() );
+  if ( !mFilterExpression.isEmpty() )
+  {
+    QgsExpression filter( mFilterExpression );
+    idRequest.setFlags( idRequest.flags() | ( filter.needsGeometry() ? QgsFeatureRequest::NoFlags : QgsFeatureRequest::NoGeometry ) );
+    idRequest.setFilterExpression( mFilterExpression );
+    idRequest.setExpressionContext( *context );
+  }
+  else
+  {
+    idRequest.setFlags( idRequest.flags() | QgsFeatureRequest::NoGeometry );
+  }
+
+  QList< QgsFeatureId > ids;
   QgsFeature f;
+  QgsFeatureIterator idIt = mLayer->getFeatures( idRequest );
+  while ( idIt.nextFeature( f ) )
+    ids << f.id();
+
+  // split the ids into contiguous ranges, one per thread. Feature sources are created
+  // here since they must be created from the thread the layer lives in
+  int partitionCount = qBound( 1, ( ids.count() + PARALLEL_MINIMUM_FEATURES - 1 ) / PARALLEL_MINIMUM_FEATURES, QThread::idealThreadCount() );
+  QList< QgsAggregatePartition > partitions;
+  for ( int i = 0; i < partitionCount; ++i )
+  {
+    QgsAggregatePartition partition;
+    partition.source = std::make_shared< QgsVectorLayerFeatureSource >( mLayer );
+    int start = ids.count() * i / partitionCount;
+    int end = ids.count() * ( i + 1 ) / partitionCount;
+    for ( int j = start; j < end; ++j )
+      partition.fids << ids.at( j );
+    partitions << partition;
+  }
 
-  while ( fit.nextFeature( f ) )
+  const QgsStatisticalSummary::Statistic numericStat = numericStatFromAggregate( aggregate );
+  const QgsStringStatisticalSummary::Statistic stringStat = stringStatFromAggregate( aggregate );
+  const QgsDateTimeStatisticalSummary::Statistic dateTimeStat = dateTimeStatFromAggregate( aggregate );
+
+  auto calculatePartition = [&]( QgsAggregatePartition & partition )
   {
+    // expressions and contexts are not thread safe, each thread works on its own copies
+    QgsExpressionContext partitionContext( *context );
+    std::unique_ptr< QgsExpression > partitionExpression;
     if ( expression )
     {
-      Q_ASSERT( context );
-      context->setFeature( f );
-      QVariant v = expression->evaluate( context );
-      s.addValue( v );
+      partitionExpression.reset( new QgsExpression( *expression ) );
+      partitionExpression->prepare( &partitionContext );
+      partitionExpression->compile();
     }
-    else
+
+    QgsFeatureRequest partitionRequest( partition.fids );
+    partitionRequest.setFlags( request.flags() );
+    // expressions referencing all the attributes have no subset, setting an empty one would fetch none
+    if ( request.flags() & QgsFeatureRequest::SubsetOfAttributes )
+      partitionRequest.setSubsetOfAttributes( request.subsetOfAttributes() );
+    QgsFeatureIterator fit = partition.source->getFeatures( partitionRequest );
+
+    switch ( resultType )
     {
-      s.addValue( f.attribute( attr ) );
+      case QVariant::Int:
+      case QVariant::UInt:
+      case QVariant::LongLong:
+      case QVariant::ULongLong:
+      case QVariant::Double:
+        partition.numeric.setStatistics( numericStat );
+        addFeatureValues( partition.numeric, &QgsStatisticalSummary::addVariant, fit, attr, partitionExpression.get(), &partitionContext );
+        break;
+
+      case QVariant::Date:
+      case QVariant::DateTime:
+        partition.dateTime.setStatistics( dateTimeStat );
+        addFeatureValues( partition.dateTime, &QgsDateTimeStatisticalSummary::addValue, fit, attr, partitionExpression.get(), &partitionContext );
+        break;
+
+      default:
+        partition.string.setStatistics( stringStat );
+        addFeatureValues( partition.string, &QgsStringStatisticalSummary::addValue, fit, attr, partitionExpression.get(), &partitionContext );
+        break;
     }
+  };
+  QtConcurrent::blockingMap( partitions, calculatePartition );
+
+  // merge partial aggregates, in feature order
+  if ( ok )
+    *ok = true;
+
+  QgsAggregatePartition &result = partitions.first();
+  for ( int i = 1; i < partitions.count(); ++i )
+  {
+    result.numeric.merge( partitions.at( i ).numeric );
+    result.string.merge( partitions.at( i ).string );
+    result.dateTime.merge( partitions.at( i ).dateTime );
   }
-  s.finalize();
-  return s.statistic( stat );
+
+  switch ( resultType )
+  {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+    case QVariant::Double:
+    {
+      result.numeric.finalize();
+      double val = result.numeric.statistic( numericStat );
+      return qIsNaN( val ) ? QVariant() : val;
+    }
+
+    case QVariant::Date:
+    case QVariant::DateTime:
+      result.dateTime.finalize();
+      return result.dateTime.statistic( dateTimeStat );
+
+    default:
+      result.string.finalize();
+      return result.string.statistic( stringStat );
+  }
+#ifndef _MSC_VER
+  return QVariant();
+#endif
 }
@@ -26,6 +26,7 @@
 
 
 class QgsFeatureIterator;
+class QgsFeatureRequest;
 class QgsExpression;
 class QgsVectorLayer;
 class QgsExpressionContext;
@@ -84,6 +85,13 @@ class CORE_EXPORT QgsAggregateCalculator
        * @see QgsAggregateCalculator::delimiter()
        */
       QString delimiter;
+
+      /** True if the aggregate may be calculated in parallel over subsets of the features.
+       * @see QgsAggregateCalculator::setParallel()
+       * @see QgsAggregateCalculator::parallel()
+       * @note added in QGIS 3.0
+       */
+      bool parallel = false;
     };
 
     /** Constructor for QgsAggregateCalculator.
@@ -122,6 +130,23 @@ class CORE_EXPORT QgsAggregateCalculator
      */
     QString delimiter() const { return mDelimiter; }
 
+    /** Sets whether the aggregate may be calculated in parallel. If enabled, the features
+     * of large layers are split by feature id into one subset per available thread, partial
+     * aggregates are calculated for each subset concurrently and then merged. Concatenation
+     * and geometry aggregates are always calculated sequentially, since they depend on the
+     * order of the features.
+     * @param parallel set to true to allow parallel calculation
+     * @see parallel()
+     * @note added in QGIS 3.0
+     */
+    void setParallel( bool parallel ) { mParallel = parallel; }
+
+    /** Returns true if the aggregate may be calculated in parallel.
+     * @see setParallel()
+     * @note added in QGIS 3.0
+     */
+    bool parallel() const { return mParallel; }
+
     /** Calculates the value of an aggregate.
      * @param aggregate aggregate to calculate
      * @param fieldOrExpression source field or expression to use as basis for aggregated values.
@@ -151,6 +176,9 @@ class CORE_EXPORT QgsAggregateCalculator
     //! Delimiter to use for concatenate aggregate
     QString mDelimiter;
 
+    //! True if the aggregate may be calculated in parallel
+    bool mParallel = false;
+
     static QgsStatisticalSummary::Statistic numericStatFromAggregate( Aggregate aggregate, bool *ok = nullptr );
     static QgsStringStatisticalSummary::Statistic stringStatFromAggregate( Aggregate aggregate, bool *ok = nullptr );
     static QgsDateTimeStatisticalSummary::Statistic dateTimeStatFromAggregate( Aggregate aggregate, bool *ok = nullptr );
@@ -172,6 +200,10 @@ class CORE_EXPORT QgsAggregateCalculator
     static QVariant concatenateStrings( QgsFeatureIterator &fit, int attr, QgsExpression *expression,
                                         QgsExpressionContext *context, const QString &delimiter );
 
+    static bool canCalculateInParallel( Aggregate aggregate, QVariant::Type resultType );
+    QVariant calculateInParallel( Aggregate aggregate, const QgsFeatureRequest &request, QVariant::Type resultType,
+                                  int attr, QgsExpression *expression, QgsExpressionContext *context, bool *ok ) const;
+
     QVariant defaultValue( Aggregate aggregate ) const;
 };
 
@@ -0,0 +1,272 @@
+/***************************************************************************
+                   qgsapproximatecoordinatetransform.cpp
+                   -------------------------------------
+    begin                : February 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsapproximatecoordinatetransform.h"
+#include "qgscsexception.h"
+#include "qgslogger.h"
+
+#include <QPolygonF>
+
+#include <algorithm>
+#include <cmath>
+
+QgsApproximateCoordinateTransform::QgsApproximateCoordinateTransform( const QgsCoordinateTransform &transform, const QgsRectangle &extent, double tolerance, int maxGridSize )
+  : mTransform( transform )
+  , mExtent( extent )
+  , mTolerance( tolerance )
+{
+  if ( !transform.isValid() || transform.isShortCircuited() || !( tolerance > 0 ) || maxGridSize < 3 )
+    return;
+
+  if ( !std::isfinite( extent.xMinimum() ) || !std::isfinite( extent.yMinimum() )
+       || !std::isfinite( extent.xMaximum() ) || !std::isfinite( extent.yMaximum() )
+       || extent.width() <= 0 || extent.height() <= 0 )
+    return;
+
+  mColumns = 3;
+  mRows = 3;
+  for ( ;; )
+  {
+    if ( !computeNodes() )
+      return;
+
+    double errorAlongX = 0;
+    double errorAlongY = 0;
+    if ( !maxErrors( errorAlongX, errorAlongY ) )
+      return;
+
+    const bool refineColumns = errorAlongX > mTolerance;
+    const bool refineRows = errorAlongY > mTolerance;
+    if ( !refineColumns && !refineRows )
+      break;
+
+    if ( ( refineColumns && mColumns >= maxGridSize ) || ( refineRows && mRows >= maxGridSize ) )
+    {
+      QgsDebugMsgLevel( QString( "Grid of %1 x %2 nodes too coarse for tolerance %3" ).arg( mColumns ).arg( mRows ).arg( mTolerance ), 4 );
+      return;
+    }
+
+    if ( refineColumns )
+      mColumns = std::min( 2 * mColumns - 1, maxGridSize );
+    if ( refineRows )
+      mRows = std::min( 2 * mRows - 1, maxGridSize );
+  }
+
+  QgsDebugMsgLevel( QString( "Approximate transform grid: %1 x %2 nodes" ).arg( mColumns ).arg( mRows ), 4 );
+  mValid = true;
+}
+
+bool QgsApproximateCoordinateTransform::computeNodes()
+{
+  mCellWidth = mExtent.width() / ( mColumns - 1 );
+  mCellHeight = mExtent.height() / ( mRows - 1 );
+
+  const int count = mColumns * mRows;
+  mNodesX.resize( count );
+  mNodesY.resize( count );
+  for ( int row = 0; row < mRows; ++row )
+  {
+    const double y = row == mRows - 1 ? mExtent.yMaximum() : mExtent.yMinimum() + row * mCellHeight;
+    for ( int column = 0; column < mColumns; ++column )
+    {
+      mNodesX[ row * mColumns + column ] = column == mColumns - 1 ? mExtent.xMaximum() : mExtent.xMinimum() + column * mCellWidth;
+      mNodesY[ row * mColumns + column ] = y;
+    }
+  }
+
+  try
+  {
+    mTransform.transformCoords( count, mNodesX.data(), mNodesY.data(), nullptr );
+  }
+  catch ( QgsCsException & )
+  {
+    return false;
+  }
+
+  for ( int i = 0; i < count; ++i )
+  {
+    if ( !std::isfinite( mNodesX.at( i ) ) || !std::isfinite( mNodesY.at( i ) ) )
+      return false;
+  }
+  return true;
+}
+
+void QgsApproximateCoordinateTransform::interpolate( double &x, double &y ) const
+{
+  const double fx = ( x - mExtent.xMinimum() ) / mCellWidth;
+  const double fy = ( y - mExtent.yMinimum() ) / mCellHeight;
+  // points on the maximum edges belong to the last cell
+  const int column = std::min( static_cast< int >( fx ), mColumns - 2 );
+  const int row = std::min( static_cast< int >( fy ), mRows - 2 );
+  const double u = fx - column;
+  const double v = fy - row;
+
+  const int i00 = row * mColumns + column;
+  const int i10 = i00 + mColumns;
+  const double *nx = mNodesX.constData();
+  const double *ny = mNodesY.constData();
+  x = ( 1 - v ) * ( ( 1 - u ) * nx[i00] + u * nx[i00 + 1] ) + v * ( ( 1 - u ) * nx[i10] + u * nx[i10 + 1] );
+  y = ( 1 - v ) * ( ( 1 - u ) * ny[i00] + u * ny[i00 + 1] ) + v * ( ( 1 - u ) * ny[i10] + u * ny[i10 + 1] );
+}
+
+bool QgsApproximateCoordinateTransform::maxErrors( double &errorAlongX, double &errorAlongY ) const
+{
+  // the interpolation is exact on the nodes, it is checked in the middle of the cell
+  // edges along x, of the cell edges along y and of the cells
+  const int alongX = mRows * ( mColumns - 1 );
+  const int alongY = ( mRows - 1 ) * mColumns;
+  const int centers = ( mRows - 1 ) * ( mColumns - 1 );
+  QVector< double > x;
+  QVector< double > y;
+  x.reserve( alongX + alongY + centers );
+  y.reserve( alongX + alongY + centers );
+  for ( int row = 0; row < mRows; ++row )
+  {
+    for ( int column = 0; column < mColumns - 1; ++column )
+    {
+      x << mExtent.xMinimum() + ( column + 0.5 ) * mCellWidth;
+      y << mExtent.yMinimum() + row * mCellHeight;
+    }
+  }
+  for ( int row = 0; row < mRows - 1; ++row )
+  {
+    for ( int column = 0; column < mColumns; ++column )
+    {
+      x << mExtent.xMinimum() + column * mCellWidth;
+      y << mExtent.yMinimum() + ( row + 0.5 ) * mCellHeight;
+    }
+  }
+  for ( int row = 0; row < mRows - 1; ++row )
+  {
+    for ( int column = 0; column < mColumns - 1; ++column )
+    {
+      x << mExtent.xMinimum() + ( column + 0.5 ) * mCellWidth;
+      y << mExtent.yMinimum() + ( row + 0.5 ) * mCellHeight;
+    }
+  }
+
+  QVector< double > exactX = x;
+  QVector< double > exactY = y;
+  try
+  {
+    mTransform.transformCoords( exactX.size(), exactX.data(), exactY.data(), nullptr );
+  }
+  catch ( QgsCsException & )
+  {
+    return false;
+  }
+
+  errorAlongX = 0;
+  errorAlongY = 0;
+  for ( int i = 0; i < x.size(); ++i )
+  {
+    if ( !std::isfinite( exactX.at( i ) ) || !std::isfinite( exactY.at( i ) ) )
+      return false;
+
+    double ix = x.at( i );
+    double iy = y.at( i );
+    interpolate( ix, iy );
+    const double error = std::hypot( ix - exactX.at( i ), iy - exactY.at( i ) );
+    // errors at the cell centers need both more columns and more rows
+    const bool isCenter = i >= alongX + alongY;
+    if ( i < alongX || isCenter )
+      errorAlongX = std::max( errorAlongX, error );
+    if ( i >= alongX )
+      errorAlongY = std::max( errorAlongY, error );
+  }
+  return true;
+}
+
+void QgsApproximateCoordinateTransform::transformCoords( int numPoints, double *x, double *y, int stride ) const
+{
+  if ( !mValid )
+  {
+    mTransform.transformCoords( numPoints, x, y, nullptr, QgsCoordinateTransform::ForwardTransform, stride );
+    return;
+  }
+
+  QVector< int > outside;
+  for ( int i = 0; i < numPoints; ++i )
+  {
+    double &px = x[ i * stride ];
+    double &py = y[ i * stride ];
+    // NaN coordinates fail the comparisons and are left to the exact transform
+    if ( px >= mExtent.xMinimum() && px <= mExtent.xMaximum() && py >= mExtent.yMinimum() && py <= mExtent.yMaximum() )
+      interpolate( px, py );
+    else
+      outside << i;
+  }
+
+  if ( outside.isEmpty() )
+    return;
+
+  QVector< double > outsideX( outside.size() );
+  QVector< double > outsideY( outside.size() );
+  for ( int i = 0; i < outside.size(); ++i )
+  {
+    outsideX[i] = x[ outside.at( i ) * stride ];
+    outsideY[i] = y[ outside.at( i ) * stride ];
+  }
+  mTransform.transformCoords( outside.size(), outsideX.data(), outsideY.data(), nullptr );
+  for ( int i = 0; i < outside.size(); ++i )
+  {
+    x[ outside.at( i ) * stride ] = outsideX.at( i );
+    y[ outside.at( i ) * stride ] = outsideY.at( i );
+  }
+}
+
+void QgsApproximateCoordinateTransform::transformPolygon( QPolygonF &polygon ) const
+{
+  if ( !mValid )
+  {
+    mTransform.transformPolygon( polygon );
+    return;
+  }
+
+  // qreal is not double on all the platforms, so the points are not passed to transformCoords()
+  QPointF *points = polygon.data();
+  QVector< int > outside;
+  for ( int i = 0; i < polygon.size(); ++i )
+  {
+    double x = points[i].x();
+    double y = points[i].y();
+    if ( x >= mExtent.xMinimum() && x <= mExtent.xMaximum() && y >= mExtent.yMinimum() && y <= mExtent.yMaximum() )
+    {
+      interpolate( x, y );
+      points[i] = QPointF( x, y );
+    }
+    else
+    {
+      outside << i;
+    }
+  }
+
+  if ( outside.isEmpty() )
+    return;
+
+  QVector< double > outsideX( outside.size() );
+  QVector< double > outsideY( outside.size() );
+  for ( int i = 0; i < outside.size(); ++i )
+  {
+    outsideX[i] = points[ outside.at( i ) ].x();
+    outsideY[i] = points[ outside.at( i ) ].y();
+  }
+  mTransform.transformCoords( outside.size(), outsideX.data(), outsideY.data(), nullptr );
+  for ( int i = 0; i < outside.size(); ++i )
+  {
+    points[ outside.at( i ) ] = QPointF( outsideX.at( i ), outsideY.at( i ) );
+  }
+}
@@ -0,0 +1,126 @@
+/***************************************************************************
+                   qgsapproximatecoordinatetransform.h
+                   -----------------------------------
+    begin                : February 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSAPPROXIMATECOORDINATETRANSFORM_H
+#define QGSAPPROXIMATECOORDINATETRANSFORM_H
+
+#include "qgis_core.h"
+#include "qgscoordinatetransform.h"
+#include "qgsrectangle.h"
+
+#include <QVector>
+
+class QPolygonF;
+
+/** \ingroup core
+ * \class QgsApproximateCoordinateTransform
+ * \brief Fast approximation of a coordinate transform over an extent, for rendering.
+ *
+ * The transform is computed exactly on the nodes of a regular grid covering the source
+ * extent, and points inside the extent are interpolated bilinearly between the nodes of
+ * their cell, without calling proj. Like the approximate mode of QgsRasterProjector, the grid
+ * starts with 3 x 3 nodes and its columns or rows are doubled until the transform of the
+ * middle of the cell edges and of the cell centers is within the tolerance of the interpolated
+ * one. Points outside the extent are transformed exactly.
+ *
+ * If the tolerance cannot be reached with a reasonable grid size, or if the transform fails
+ * inside the extent (e.g. around a pole or the antimeridian of the destination CRS), the
+ * approximation is not valid and transforms fall back to the exact transform.
+ *
+ * Only forward transforms of x and y are approximated, z is not supported.
+ *
+ * \note not available in Python bindings
+ * \note added in QGIS 3.0
+ */
+class CORE_EXPORT QgsApproximateCoordinateTransform
+{
+  public:
+
+    //! Constructs an invalid approximate transform
+    QgsApproximateCoordinateTransform() = default;
+
+    /**
+     * Constructs an approximation of \a transform over \a extent, in source CRS units.
+     * The interpolation error at the tested points is kept below \a tolerance, in destination
+     * CRS units, with at most \a maxGridSize nodes per grid dimension.
+     */
+    QgsApproximateCoordinateTransform( const QgsCoordinateTransform &transform, const QgsRectangle &extent,
+                                       double tolerance, int maxGridSize = 257 );
+
+    /**
+     * Returns true if the grid approximates the transform within the tolerance, otherwise
+     * all the points are transformed exactly.
+     */
+    bool isValid() const { return mValid; }
+
+    //! Returns the approximated exact transform
+    QgsCoordinateTransform coordinateTransform() const { return mTransform; }
+
+    //! Returns the source extent covered by the grid
+    QgsRectangle extent() const { return mExtent; }
+
+    //! Returns the maximum interpolation error at the tested points, in destination CRS units
+    double tolerance() const { return mTolerance; }
+
+    //! Returns the number of grid nodes along x, 0 if the approximation is not valid
+    int gridColumns() const { return mValid ? mColumns : 0; }
+
+    //! Returns the number of grid nodes along y, 0 if the approximation is not valid
+    int gridRows() const { return mValid ? mRows : 0; }
+
+    /**
+     * Transforms in place an array of \a numPoints points from the source to the destination CRS,
+     * with \a stride doubles between the coordinates of consecutive points.
+     * @throws QgsCsException if the exact transform of points outside the extent fails
+     */
+    void transformCoords( int numPoints, double *x, double *y, int stride = 1 ) const;
+
+    /**
+     * Transforms in place a \a polygon from the source to the destination CRS.
+     * @throws QgsCsException if the exact transform of points outside the extent fails
+     */
+    void transformPolygon( QPolygonF &polygon ) const;
+
+  private:
+
+    //! Computes the exact transform of the grid nodes, returns false if it failed
+    bool computeNodes();
+
+    //! Interpolates the destination of \a x, \a y which must be inside the extent
+    void interpolate( double &x, double &y ) const;
+
+    //! Returns the largest errors of the interpolation along the x and y axis of the grid
+    bool maxErrors( double &errorAlongX, double &errorAlongY ) const;
+
+    QgsCoordinateTransform mTransform;
+    QgsRectangle mExtent;
+    double mTolerance = 0;
+    bool mValid = false;
+
+    //! Number of grid nodes along x and y
+    int mColumns = 0;
+    int mRows = 0;
+
+    //! Source size of a grid cell
+    double mCellWidth = 0;
+    double mCellHeight = 0;
+
+    //! Destination coordinates of the nodes, by rows starting at the minimum y
+    QVector< double > mNodesX;
+    QVector< double > mNodesY;
+};
+
+#endif // QGSAPPROXIMATECOORDINATETRANSFORM_H
@@ -0,0 +1,114 @@
+/***************************************************************************
+                         qgsarenaallocator.cpp
+                         ---------------------
+    begin                : February 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsarenaallocator.h"
+
+#include <algorithm>
+#include <cstdint>
+
+///@cond PRIVATE
+
+//! Returns the first offset from \a offset in \a data which is aligned to \a alignment
+static std::size_t alignedOffset( const char *data, std::size_t offset, std::size_t alignment )
+{
+  const std::uintptr_t base = reinterpret_cast< std::uintptr_t >( data );
+  const std::uintptr_t aligned = ( base + offset + alignment - 1 ) & ~static_cast< std::uintptr_t >( alignment - 1 );
+  return static_cast< std::size_t >( aligned - base );
+}
+
+///@endcond
+
+QgsArenaAllocator::QgsArenaAllocator( std::size_t blockSize )
+  : mBlockSize( blockSize )
+{
+}
+
+QgsArenaAllocator::~QgsArenaAllocator()
+{
+  runFinalizers( nullptr );
+}
+
+void *QgsArenaAllocator::allocate( std::size_t size, std::size_t alignment )
+{
+  if ( size == 0 )
+    size = 1;
+
+  for ( ;; )
+  {
+    if ( mCurrentBlock >= 0 )
+    {
+      Block &block = mBlocks[ mCurrentBlock ];
+      const std::size_t offset = alignedOffset( block.data.get(), mOffset, alignment );
+      if ( offset + size <= block.size )
+      {
+        mOffset = offset + size;
+        return block.data.get() + offset;
+      }
+    }
+
+    // continue in the next block kept from before a rewind, blocks too small for
+    // this allocation are skipped until the arena is rewound
+    if ( mCurrentBlock + 1 >= static_cast< int >( mBlocks.size() ) )
+      break;
+    ++mCurrentBlock;
+    mOffset = 0;
+  }
+
+  Block block;
+  block.size = std::max( mBlockSize, size + alignment );
+  block.data.reset( new char[ block.size ] );
+  mBlocks.push_back( std::move( block ) );
+  mCurrentBlock = static_cast< int >( mBlocks.size() ) - 1;
+
+  char *data = mBlocks[ mCurrentBlock ].data.get();
+  const std::size_t offset = alignedOffset( data, 0, alignment );
+  mOffset = offset + size;
+  return data + offset;
+}
+
+void QgsArenaAllocator::rewind( const Marker &marker )
+{
+  runFinalizers( marker.finalizers );
+  mCurrentBlock = marker.block;
+  mOffset = marker.offset;
+}
+
+void QgsArenaAllocator::reset()
+{
+  runFinalizers( nullptr );
+  if ( mBlocks.size() > 1 )
+    mBlocks.resize( 1 );
+  mCurrentBlock = mBlocks.empty() ? -1 : 0;
+  mOffset = 0;
+}
+
+std::size_t QgsArenaAllocator::capacity() const
+{
+  std::size_t size = 0;
+  for ( const Block &block : mBlocks )
+    size += block.size;
+  return size;
+}
+
+void QgsArenaAllocator::runFinalizers( Finalizer *last )
+{
+  while ( mFinalizers && mFinalizers != last )
+  {
+    Finalizer *finalizer = mFinalizers;
+    mFinalizers = finalizer->next;
+    finalizer->destroy( finalizer->object );
+  }
+}
@@ -0,0 +1,179 @@
+/***************************************************************************
+                         qgsarenaallocator.h
+                         -------------------
+    begin                : February 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSARENAALLOCATOR_H
+#define QGSARENAALLOCATOR_H
+
+#include "qgis_core.h"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/** \ingroup core
+ * \class QgsArenaAllocator
+ * \brief Monotonic allocator for short-lived temporary objects, released all at once.
+ *
+ * Memory is handed out from large blocks by moving a pointer forward, and is only
+ * given back by rewinding the arena to a previous position with rewind() or Scope,
+ * or by resetting it with reset(). The blocks are kept for reuse, so that after the
+ * first features of a render job temporary buffers do not hit the global heap anymore.
+ *
+ * Objects with a destructor created with create() are destroyed, in the reverse order
+ * of their creation, when the arena is rewound past them.
+ *
+ * An arena is not thread safe, each render job owns its own, see QgsRenderContext::arena().
+ *
+ * \note not available in Python bindings
+ * \note added in QGIS 3.0
+ */
+class CORE_EXPORT QgsArenaAllocator
+{
+    struct Finalizer
+    {
+      void ( *destroy )( void *object );
+      void *object;
+      Finalizer *next;
+    };
+
+  public:
+
+    //! Position in an arena, see mark() and rewind()
+    struct Marker
+    {
+      int block;
+      std::size_t offset;
+      Finalizer *finalizers;
+    };
+
+    /**
+     * Rewinds an arena to its position at the creation of the scope when the scope is destroyed,
+     * releasing everything allocated within the scope.
+     */
+    class Scope
+    {
+      public:
+        //! Creates a scope on \a arena
+        explicit Scope( QgsArenaAllocator &arena )
+          : mArena( arena )
+          , mMarker( arena.mark() )
+        {}
+
+        ~Scope() { mArena.rewind( mMarker ); }
+
+        //! Scope cannot be copied
+        Scope( const Scope &other ) = delete;
+        //! Scope cannot be copied
+        Scope &operator=( const Scope &other ) = delete;
+
+      private:
+        QgsArenaAllocator &mArena;
+        Marker mMarker;
+    };
+
+    /**
+     * Creates an empty arena, no memory is allocated until the first allocation.
+     * @param blockSize size in bytes of the blocks, larger allocations get a block of their own
+     */
+    explicit QgsArenaAllocator( std::size_t blockSize = 64 * 1024 );
+
+    ~QgsArenaAllocator();
+
+    //! QgsArenaAllocator cannot be copied
+    QgsArenaAllocator( const QgsArenaAllocator &other ) = delete;
+    //! QgsArenaAllocator cannot be copied
+    QgsArenaAllocator &operator=( const QgsArenaAllocator &other ) = delete;
+
+    /**
+     * Allocates \a size bytes aligned to \a alignment, which must be a power of two.
+     * The memory is valid until the arena is rewound or reset.
+     */
+    void *allocate( std::size_t size, std::size_t alignment = alignof( std::max_align_t ) );
+
+    /**
+     * Allocates an uninitialized array of \a count elements. Only types without
+     * destructor are allowed, as no destructor is ever called for the elements.
+     */
+    template <typename T> T *allocateArray( std::size_t count )
+    {
+      static_assert( std::is_trivially_destructible<T>::value, "use create() for types with a destructor" );
+      return static_cast< T * >( allocate( count * sizeof( T ), alignof( T ) ) );
+    }
+
+    /**
+     * Constructs an object of type T in the arena, forwarding \a args to its constructor.
+     * The destructor of the object is called when the arena is rewound past it, the object
+     * must not be deleted.
+     */
+    template <typename T, typename... Args> T *create( Args &&... args )
+    {
+      Finalizer *finalizer = std::is_trivially_destructible<T>::value ? nullptr : allocateArray<Finalizer>( 1 );
+      T *object = new( allocate( sizeof( T ), alignof( T ) ) ) T( std::forward<Args>( args )... );
+      if ( finalizer )
+      {
+        finalizer->destroy = &destroyObject<T>;
+        finalizer->object = object;
+        finalizer->next = mFinalizers;
+        mFinalizers = finalizer;
+      }
+      return object;
+    }
+
+    //! Returns the current position of the arena, to be given to rewind()
+    Marker mark() const { return Marker{ mCurrentBlock, mOffset, mFinalizers }; }
+
+    /**
+     * Releases everything allocated since \a marker was taken, destroying the objects
+     * created in the meantime. The blocks are kept for later allocations.
+     */
+    void rewind( const Marker &marker );
+
+    /**
+     * Releases everything allocated in the arena, keeping the first block for
+     * later allocations and giving the others back to the system.
+     */
+    void reset();
+
+    //! Returns the total size in bytes of the blocks owned by the arena
+    std::size_t capacity() const;
+
+  private:
+
+    struct Block
+    {
+      std::unique_ptr< char[] > data;
+      std::size_t size;
+    };
+
+    std::size_t mBlockSize;
+    std::vector< Block > mBlocks;
+    //! Index in mBlocks of the block allocations are made from, -1 before the first allocation
+    int mCurrentBlock = -1;
+    //! Number of bytes used in the current block
+    std::size_t mOffset = 0;
+    //! Objects to destroy, most recently created first
+    Finalizer *mFinalizers = nullptr;
+
+    template <typename T> static void destroyObject( void *object ) { static_cast< T * >( object )->~T(); }
+
+    //! Runs the finalizers registered after \a last
+    void runFinalizers( Finalizer *last );
+};
+
+#endif // QGSARENAALLOCATOR_H
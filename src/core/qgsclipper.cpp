@@ -17,9 +17,16 @@
  ***************************************************************************/
 
 #include "qgsclipper.h"
+#include "qgsarenaallocator.h"
 #include "qgsgeometry.h"
 #include "qgscurve.h"
 #include "qgslogger.h"
+#include "qgssimd_p.h"
+
+#include <QThreadStorage>
+
+#include <algorithm>
+#include <type_traits>
 
 // Where has all the code gone?
 
@@ -38,10 +45,234 @@ const double QgsClipper::MIN_Y = -16000;
 
 const double QgsClipper::SMALL_NUM = 1e-12;
 
+///@cond PRIVATE
+
+#if defined( QGS_SIMD_SSE2 )
+static int insideBoundarySse2( const double *xy, int count, QgsClipper::Boundary b, double value, unsigned char *inside )
+{
+  const bool useX = b == QgsClipper::XMax || b == QgsClipper::XMin;
+  const bool below = b == QgsClipper::XMax || b == QgsClipper::YMax;
+  const __m128d limit = _mm_set1_pd( value );
+  int insideCount = 0;
+  int i = 0;
+  for ( ; i + 2 <= count; i += 2, xy += 4 )
+  {
+    const __m128d p0 = _mm_loadu_pd( xy );
+    const __m128d p1 = _mm_loadu_pd( xy + 2 );
+    const __m128d c = useX ? _mm_unpacklo_pd( p0, p1 ) : _mm_unpackhi_pd( p0, p1 );
+    const int mask = _mm_movemask_pd( below ? _mm_cmplt_pd( c, limit ) : _mm_cmpgt_pd( c, limit ) );
+    inside[i] = mask & 1;
+    inside[i + 1] = ( mask >> 1 ) & 1;
+    insideCount += inside[i] + inside[i + 1];
+  }
+  return insideCount;
+}
+
+//! Returns whether all the points are inside the rectangle or on its border, NaN coordinates being outside
+static bool allInsideSse2( const double *xy, int count, const QgsRectangle &rect )
+{
+  const __m128d minimum = _mm_set_pd( rect.yMinimum(), rect.xMinimum() );
+  const __m128d maximum = _mm_set_pd( rect.yMaximum(), rect.xMaximum() );
+  for ( int i = 0; i < count; ++i, xy += 2 )
+  {
+    const __m128d p = _mm_loadu_pd( xy );
+    if ( _mm_movemask_pd( _mm_and_pd( _mm_cmpge_pd( p, minimum ), _mm_cmple_pd( p, maximum ) ) ) != 3 )
+      return false;
+  }
+  return true;
+}
+#endif
+
+#if defined( QGS_SIMD_AVX2 )
+QGS_TARGET_AVX2 static int insideBoundaryAvx2( const double *xy, int count, QgsClipper::Boundary b, double value, unsigned char *inside, int &insideCount )
+{
+  const bool useX = b == QgsClipper::XMax || b == QgsClipper::XMin;
+  const bool below = b == QgsClipper::XMax || b == QgsClipper::YMax;
+  const __m256d limit = _mm256_set1_pd( value );
+  int i = 0;
+  for ( ; i + 4 <= count; i += 4, xy += 8 )
+  {
+    const __m256d p01 = _mm256_loadu_pd( xy );
+    const __m256d p23 = _mm256_loadu_pd( xy + 4 );
+    // the unpack works within 128 bit lanes, giving the coordinates of points 0, 2, 1, 3
+    const __m256d mixed = useX ? _mm256_unpacklo_pd( p01, p23 ) : _mm256_unpackhi_pd( p01, p23 );
+    const __m256d c = _mm256_permute4x64_pd( mixed, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+    const int mask = _mm256_movemask_pd( below ? _mm256_cmp_pd( c, limit, _CMP_LT_OQ ) : _mm256_cmp_pd( c, limit, _CMP_GT_OQ ) );
+    for ( int j = 0; j < 4; ++j )
+    {
+      inside[i + j] = ( mask >> j ) & 1;
+      insideCount += inside[i + j];
+    }
+  }
+  return i;
+}
+#endif
+
+//! Computes whether each point is inside boundary \a b and returns the number of points inside
+static int insideBoundary( const QPointF *pts, int count, QgsClipper::Boundary b, double value, unsigned char *inside )
+{
+  int insideCount = 0;
+  int done = 0;
+#if defined( QGS_SIMD_SSE2 )
+  if ( std::is_same< qreal, double >::value && QgsSimd::hasSse2() )
+  {
+    const double *xy = reinterpret_cast< const double * >( pts );
+#if defined( QGS_SIMD_AVX2 )
+    if ( QgsSimd::hasAvx2() )
+      done = insideBoundaryAvx2( xy, count, b, value, inside, insideCount );
+#endif
+    const int pairs = ( count - done ) / 2 * 2;
+    insideCount += insideBoundarySse2( xy + 2 * done, pairs, b, value, inside + done );
+    done += pairs;
+  }
+#endif
+  for ( int i = done; i < count; ++i )
+  {
+    switch ( b )
+    {
+      case QgsClipper::XMax:
+        inside[i] = pts[i].x() < value;
+        break;
+      case QgsClipper::XMin:
+        inside[i] = pts[i].x() > value;
+        break;
+      case QgsClipper::YMax:
+        inside[i] = pts[i].y() < value;
+        break;
+      case QgsClipper::YMin:
+        inside[i] = pts[i].y() > value;
+        break;
+    }
+    insideCount += inside[i];
+  }
+  return insideCount;
+}
+
+//! Returns whether all the points are inside the rectangle or on its border
+static bool allInside( const QPointF *pts, int count, const QgsRectangle &rect )
+{
+#if defined( QGS_SIMD_SSE2 )
+  if ( std::is_same< qreal, double >::value && QgsSimd::hasSse2() )
+    return allInsideSse2( reinterpret_cast< const double * >( pts ), count, rect );
+#endif
+  for ( int i = 0; i < count; ++i )
+  {
+    if ( !( pts[i].x() >= rect.xMinimum() && pts[i].x() <= rect.xMaximum() && pts[i].y() >= rect.yMinimum() && pts[i].y() <= rect.yMaximum() ) )
+      return false;
+  }
+  return true;
+}
+
+///@endcond
+
+///@cond PRIVATE
+
+//! Scratch arena of each thread for trimPolygon() calls without an arena, kept between the calls
+static QThreadStorage< QgsArenaAllocator * > sTrimPolygonArena;
+
+//! Larger scratch arenas are released after the call, so that a huge polygon does not keep its memory
+static const std::size_t TRIM_POLYGON_ARENA_MAXIMUM_CAPACITY = 1024 * 1024;
+
+///@endcond
+
+void QgsClipper::trimPolygon( QPolygonF &pts, const QgsRectangle &clipRect )
+{
+  if ( !sTrimPolygonArena.hasLocalData() )
+  {
+    // enough for the first pass over polygons of a few hundred vertices
+    sTrimPolygonArena.setLocalData( new QgsArenaAllocator( 16 * 1024 ) );
+  }
+  QgsArenaAllocator *arena = sTrimPolygonArena.localData();
+  trimPolygon( pts, clipRect, *arena );
+
+  if ( arena->capacity() > TRIM_POLYGON_ARENA_MAXIMUM_CAPACITY )
+  {
+    // the previous arena is deleted by the thread storage
+    sTrimPolygonArena.setLocalData( new QgsArenaAllocator( 16 * 1024 ) );
+  }
+}
+
+void QgsClipper::trimPolygon( QPolygonF &pts, const QgsRectangle &clipRect, QgsArenaAllocator &arena )
+{
+  if ( pts.isEmpty() )
+    return;
+
+  QgsArenaAllocator::Scope scope( arena );
+
+  const Boundary boundaries[] = { XMax, YMax, XMin, YMin };
+  const double values[] = { clipRect.xMaximum(), clipRect.yMaximum(), clipRect.xMinimum(), clipRect.yMinimum() };
+
+  const QPointF *in = pts.constData();
+  int count = pts.size();
+  for ( int pass = 0; pass < 4; ++pass )
+  {
+    unsigned char *inside = arena.allocateArray<unsigned char>( count );
+    const int insideCount = insideBoundary( in, count, boundaries[pass], values[pass], inside );
+    if ( insideCount == count )
+    {
+      // the boundary does not cut the polygon
+      continue;
+    }
+    if ( insideCount == 0 )
+    {
+      pts.clear();
+      return;
+    }
+
+    // each boundary adds at most one point per edge, so the output of a pass is
+    // never more than twice the size of its input
+    QPointF *out = arena.allocateArray<QPointF>( 2 * count );
+    count = trimPolygonToBoundary( in, count, out, inside, clipRect, boundaries[pass] );
+    in = out;
+  }
+
+  if ( in != pts.constData() )
+  {
+    pts.resize( count );
+    std::copy( in, in + count, pts.begin() );
+  }
+}
+
+int QgsClipper::trimPolygonToBoundary( const QPointF *inPts, int inCount, QPointF *outPts, const unsigned char *inside, const QgsRectangle &rect, Boundary b )
+{
+  QPointF *out = outPts;
+  int i1 = inCount - 1; // start with last point
+
+  // and compare to the first point initially.
+  for ( int i2 = 0; i2 < inCount; ++i2 )
+  {
+    if ( inside[i2] != inside[i1] )
+    {
+      // edge crosses the boundary, so trim back to the boundary
+      *out++ = intersectRect( inPts[i1], inPts[i2], b, rect );
+    }
+    if ( inside[i2] )
+    {
+      *out++ = inPts[i2];
+    }
+    i1 = i2;
+  }
+  return static_cast< int >( out - outPts );
+}
+
 QPolygonF QgsClipper::clippedLine( const QgsCurve &curve, const QgsRectangle &clipExtent )
 {
-  const int nPoints = curve.numPoints();
+  return clippedLine( curve.asQPolygonF(), clipExtent );
+}
+
+QPolygonF QgsClipper::clippedLine( const QPolygonF &points, const QgsRectangle &clipExtent )
+{
+  // lines completely inside the extent are returned as is
+  if ( points.size() > 1 && allInside( points.constData(), points.size(), clipExtent ) )
+    return points;
 
+  const QPointF *data = points.constData();
+  return clippedLine( points.size(), [data]( int i ) { return data[i]; }, clipExtent );
+}
+
+template <typename PointAt>
+QPolygonF QgsClipper::clippedLine( int nPoints, PointAt pointAt, const QgsRectangle &clipExtent )
+{
   double p0x, p0y, p1x = 0.0, p1y = 0.0; //original coordinates
   double p1x_c, p1y_c; //clipped end coordinates
   double lastClipX = 0.0, lastClipY = 0.0; //last successfully clipped coords
@@ -51,10 +282,11 @@ QPolygonF QgsClipper::clippedLine( const QgsCurve &curve, const QgsRectangle &cl
 
   for ( int i = 0; i < nPoints; ++i )
   {
+    const QPointF p = pointAt( i );
     if ( i == 0 )
     {
-      p1x = curve.xAt( i );
-      p1y = curve.yAt( i );
+      p1x = p.x();
+      p1y = p.y();
       continue;
     }
     else
@@ -62,8 +294,8 @@ QPolygonF QgsClipper::clippedLine( const QgsCurve &curve, const QgsRectangle &cl
       p0x = p1x;
       p0y = p1y;
 
-      p1x = curve.xAt( i );
-      p1y = curve.yAt( i );
+      p1x = p.x();
+      p1y = p.y();
 
       p1x_c = p1x;
       p1y_c = p1y;
@@ -27,6 +27,7 @@
 #include <QVector>
 #include <QPolygonF>
 
+class QgsArenaAllocator;
 class QgsCurve;
 
 /** \ingroup core
@@ -83,8 +84,22 @@ class CORE_EXPORT QgsClipper
                              QVector<double> &y,
                              bool shapeOpen );
 
+    /** Trims a polygon to a rectangle with the Sutherland-Hodgman algorithm.
+     * The vertices are classified against each boundary in batches, with SSE2 or
+     * AVX2 instructions when available, and boundaries which do not cut the
+     * polygon are skipped. The intermediate results are stored in a scratch
+     * arena of the calling thread, kept between calls.
+     */
     static void trimPolygon( QPolygonF &pts, const QgsRectangle &clipRect );
 
+    /** Trims a polygon to a rectangle like trimPolygon(), with the intermediate
+     * results of the clipping stored in \a arena instead of the heap.
+     * The memory taken from the arena is released before returning.
+     * @note not available in Python bindings
+     * @note added in QGIS 3.0
+     */
+    static void trimPolygon( QPolygonF &pts, const QgsRectangle &clipRect, QgsArenaAllocator &arena );
+
     /** Takes a linestring and clips it to clipExtent
      * @param curve the linestring
      * @param clipExtent clipping bounds
@@ -92,8 +107,19 @@ class CORE_EXPORT QgsClipper
      */
     static QPolygonF clippedLine( const QgsCurve &curve, const QgsRectangle &clipExtent );
 
+    /** Takes a linestring and clips it to clipExtent
+     * @param points the linestring vertices
+     * @param clipExtent clipping bounds
+     * @return clipped line coordinates
+     * @note added in QGIS 3.0
+     */
+    static QPolygonF clippedLine( const QPolygonF &points, const QgsRectangle &clipExtent );
+
   private:
 
+    //! Clips the line of \a nPoints vertices returned by \a pointAt, shared by the clippedLine() overloads
+    template <typename PointAt> static QPolygonF clippedLine( int nPoints, PointAt pointAt, const QgsRectangle &clipExtent );
+
     // Used when testing for equivalance to 0.0
     static const double SMALL_NUM;
 
@@ -106,13 +132,14 @@ class CORE_EXPORT QgsClipper
                                        Boundary b,
                                        bool shapeOpen );
 
-    static void trimPolygonToBoundary( const QPolygonF &inPts, QPolygonF &outPts, const QgsRectangle &rect, Boundary b, double boundaryValue );
+    // Trims the inCount points of inPts to the given boundary, writing at most
+    // 2 * inCount points to outPts. The inside array tells for each input point
+    // whether it is inside the boundary. Returns the number of points written.
+    static int trimPolygonToBoundary( const QPointF *inPts, int inCount, QPointF *outPts, const unsigned char *inside, const QgsRectangle &rect, Boundary b );
 
     // Determines if a point is inside or outside the given boundary
     static bool inside( const double x, const double y, Boundary b );
 
-    static bool inside( QPointF pt, Boundary b, double val );
-
     // Calculates the intersection point between a line defined by a
     // (x1, y1), and (x2, y2) and the given boundary
     static QgsPoint intersect( const double x1, const double y1,
@@ -181,20 +208,6 @@ inline void QgsClipper::trimFeature( QVector<double> &x,
   trimFeatureToBoundary( tmpX, tmpY, x, y, YMin, shapeOpen );
 }
 
-inline void QgsClipper::trimPolygon( QPolygonF &pts, const QgsRectangle &clipRect )
-{
-  QPolygonF tmpPts;
-  tmpPts.reserve( pts.size() );
-
-  trimPolygonToBoundary( pts, tmpPts, clipRect, XMax, clipRect.xMaximum() );
-  pts.resize( 0 );
-  trimPolygonToBoundary( tmpPts, pts, clipRect, YMax, clipRect.yMaximum() );
-  tmpPts.resize( 0 );
-  trimPolygonToBoundary( pts, tmpPts, clipRect, XMin, clipRect.xMinimum() );
-  pts.resize( 0 );
-  trimPolygonToBoundary( tmpPts, pts, clipRect, YMin, clipRect.yMinimum() );
-}
-
 // An auxiliary function that is part of the polygon trimming
 // code. Will trim the given polygon to the given boundary and return
 // the trimmed polygon in the out pointer. Uses Sutherland and
@@ -266,40 +279,6 @@ inline void QgsClipper::trimFeatureToBoundary(
   }
 }
 
-inline void QgsClipper::trimPolygonToBoundary( const QPolygonF &inPts, QPolygonF &outPts, const QgsRectangle &rect, Boundary b, double boundaryValue )
-{
-  int i1 = inPts.size() - 1; // start with last point
-
-  // and compare to the first point initially.
-  for ( int i2 = 0; i2 < inPts.size() ; ++i2 )
-  {
-    // look at each edge of the polygon in turn
-    if ( inside( inPts[i2], b, boundaryValue ) ) // end point of edge is inside boundary
-    {
-      if ( inside( inPts[i1], b, boundaryValue ) )
-      {
-        outPts.append( inPts[i2] );
-      }
-      else
-      {
-        // edge crosses into the boundary, so trim back to the boundary, and
-        // store both ends of the new edge
-        outPts.append( intersectRect( inPts[i1], inPts[i2], b, rect ) );
-        outPts.append( inPts[i2] );
-      }
-    }
-    else // end point of edge is outside boundary
-    {
-      // start point is in boundary, so need to trim back
-      if ( inside( inPts[i1], b, boundaryValue ) )
-      {
-        outPts.append( intersectRect( inPts[i1], inPts[i2], b, rect ) );
-      }
-    }
-    i1 = i2;
-  }
-}
-
 // An auxiliary function to trimPolygonToBoundarY() that returns
 // whether a point is inside or outside the given boundary.
 
@@ -327,22 +306,6 @@ inline bool QgsClipper::inside( const double x, const double y, Boundary b )
   return false;
 }
 
-inline bool QgsClipper::inside( QPointF pt, Boundary b, double val )
-{
-  switch ( b )
-  {
-    case XMax: // x < MAX_X is inside
-      return ( pt.x() < val );
-    case XMin: // x > MIN_X is inside
-      return ( pt.x() > val );
-    case YMax: // y < MAX_Y is inside
-      return ( pt.y() < val );
-    case YMin: // y > MIN_Y is inside
-      return ( pt.y() > val );
-  }
-  return false;
-}
-
 
 // An auxiliary function to trimPolygonToBoundarY() that calculates and
 // returns the intersection of the line defined by the given points
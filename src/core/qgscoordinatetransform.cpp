@@ -27,8 +27,12 @@
 #include <QDomNode>
 #include <QDomElement>
 #include <QApplication>
+#include <QMutexLocker>
 #include <QPolygonF>
 #include <QStringList>
+#include <QtConcurrentMap>
+#include <QThreadPool>
+#include <QThreadStorage>
 #include <QVector>
 
 extern "C"
@@ -36,10 +40,40 @@ extern "C"
 #include <proj_api.h>
 }
 #include <sqlite3.h>
+#include <algorithm>
 
 // if defined shows all information about transform to stdout
 // #define COORDINATE_TRANSFORM_VERBOSE
 
+///@cond PRIVATE
+#ifdef QGS_PROJ_HAS_CONTEXTS
+
+QMutex QgsProjThreadCleanup::sMutex;
+
+//! Deleted by Qt when the thread finishes
+static QThreadStorage< QgsProjThreadCleanup * > sProjThreadCleanup;
+
+QgsProjThreadCleanup::~QgsProjThreadCleanup()
+{
+  QMutexLocker locker( &sMutex );
+  Q_FOREACH ( QgsCoordinateTransformPrivate *transform, transforms )
+    transform->freeThreadProjections( thread );
+}
+
+QgsProjThreadCleanup *QgsProjThreadCleanup::current()
+{
+  if ( !sProjThreadCleanup.hasLocalData() )
+  {
+    QgsProjThreadCleanup *cleanup = new QgsProjThreadCleanup();
+    cleanup->thread = QThread::currentThreadId();
+    sProjThreadCleanup.setLocalData( cleanup );
+  }
+  return sProjThreadCleanup.localData();
+}
+
+#endif
+///@endcond
+
 QgsCoordinateTransform::QgsCoordinateTransform()
 {
   d = new QgsCoordinateTransformPrivate();
@@ -445,7 +479,7 @@ QgsRectangle QgsCoordinateTransform::transformBoundingBox( const QgsRectangle &r
   return bb_rect;
 }
 
-void QgsCoordinateTransform::transformCoords( int numPoints, double *x, double *y, double *z, TransformDirection direction ) const
+void QgsCoordinateTransform::transformCoords( int numPoints, double *x, double *y, double *z, TransformDirection direction, int stride ) const
 {
   if ( !d->mIsValid || d->mShortCircuit )
     return;
@@ -479,21 +513,31 @@ void QgsCoordinateTransform::transformCoords( int numPoints, double *x, double *
   {
     for ( int i = 0; i < numPoints; ++i )
     {
-      x[i] *= DEG_TO_RAD;
-      y[i] *= DEG_TO_RAD;
+      x[i * stride] *= DEG_TO_RAD;
+      y[i * stride] *= DEG_TO_RAD;
     }
 
   }
-  int projResult;
-  if ( direction == ReverseTransform )
+  // each thread transforms with its own proj objects, so that transforms shared
+  // between render jobs run concurrently
+  QMutex *projMutex = nullptr;
+  const QgsCoordinateTransformPrivate::ThreadProjections projections = d->threadProjections( projMutex );
+  if ( !projections.source || !projections.destination )
   {
-    projResult = pj_transform( d->mDestinationProjection, d->mSourceProjection, numPoints, 0, x, y, z );
+    throw QgsCsException( QObject::tr( "Could not initialize the PROJ.4 projections of the transform" ) );
   }
-  else
+
+  int projResult;
   {
-    Q_ASSERT( d->mSourceProjection );
-    Q_ASSERT( d->mDestinationProjection );
-    projResult = pj_transform( d->mSourceProjection, d->mDestinationProjection, numPoints, 0, x, y, z );
+    QMutexLocker locker( projMutex );
+    if ( direction == ReverseTransform )
+    {
+      projResult = pj_transform( projections.destination, projections.source, numPoints, stride, x, y, z );
+    }
+    else
+    {
+      projResult = pj_transform( projections.source, projections.destination, numPoints, stride, x, y, z );
+    }
   }
 
   if ( projResult != 0 )
@@ -505,11 +549,11 @@ void QgsCoordinateTransform::transformCoords( int numPoints, double *x, double *
     {
       if ( direction == ForwardTransform )
       {
-        points += QStringLiteral( "(%1, %2)\n" ).arg( x[i], 0, 'f' ).arg( y[i], 0, 'f' );
+        points += QStringLiteral( "(%1, %2)\n" ).arg( x[i * stride], 0, 'f' ).arg( y[i * stride], 0, 'f' );
       }
       else
       {
-        points += QStringLiteral( "(%1, %2)\n" ).arg( x[i] * RAD_TO_DEG, 0, 'f' ).arg( y[i] * RAD_TO_DEG, 0, 'f' );
+        points += QStringLiteral( "(%1, %2)\n" ).arg( x[i * stride] * RAD_TO_DEG, 0, 'f' ).arg( y[i * stride] * RAD_TO_DEG, 0, 'f' );
       }
     }
 
@@ -543,8 +587,8 @@ void QgsCoordinateTransform::transformCoords( int numPoints, double *x, double *
   {
     for ( int i = 0; i < numPoints; ++i )
     {
-      x[i] *= RAD_TO_DEG;
-      y[i] *= RAD_TO_DEG;
+      x[i * stride] *= RAD_TO_DEG;
+      y[i * stride] *= RAD_TO_DEG;
     }
   }
 #ifdef COORDINATE_TRANSFORM_VERBOSE
@@ -554,6 +598,66 @@ void QgsCoordinateTransform::transformCoords( int numPoints, double *x, double *
 #endif
 }
 
+///@cond PRIVATE
+
+//! Consecutive points of the arrays transformed by one task of transformCoordsParallel()
+struct QgsTransformChunk
+{
+  int start;
+  int count;
+};
+
+///@endcond
+
+void QgsCoordinateTransform::transformCoordsParallel( int numPoints, double *x, double *y, double *z, TransformDirection direction, int stride ) const
+{
+  if ( !d->mIsValid || d->mShortCircuit )
+    return;
+
+  // below this, the cost of dispatching the chunks to threads outweighs the gain
+  const int minChunkSize = 10000;
+  const int threads = QThreadPool::globalInstance()->maxThreadCount();
+  if ( numPoints < 2 * minChunkSize || threads < 2 )
+  {
+    transformCoords( numPoints, x, y, z, direction, stride );
+    return;
+  }
+
+  // a few chunks per thread so that unequal transform costs still balance
+  const int chunkSize = std::max( minChunkSize, numPoints / ( threads * 4 ) + 1 );
+  QVector< QgsTransformChunk > chunks;
+  for ( int start = 0; start < numPoints; start += chunkSize )
+  {
+    chunks << QgsTransformChunk{ start, std::min( chunkSize, numPoints - start ) };
+  }
+
+  // QtConcurrent only forwards QException subclasses, keep the first error and
+  // rethrow it once all the chunks are done
+  QMutex errorMutex;
+  QString error;
+  const QgsCoordinateTransform &transform = *this;
+  auto transformChunk = [&]( const QgsTransformChunk & chunk )
+  {
+    const int offset = chunk.start * stride;
+    try
+    {
+      transform.transformCoords( chunk.count, x + offset, y + offset, z ? z + offset : nullptr, direction, stride );
+    }
+    catch ( QgsCsException &e )
+    {
+      QMutexLocker locker( &errorMutex );
+      if ( error.isEmpty() )
+        error = e.what();
+    }
+  };
+  QtConcurrent::blockingMap( chunks, transformChunk );
+
+  if ( !error.isEmpty() )
+  {
+    throw QgsCsException( error );
+  }
+}
+
 bool QgsCoordinateTransform::isValid() const
 {
   return d->mIsValid;
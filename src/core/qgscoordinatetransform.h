@@ -233,8 +233,27 @@ class CORE_EXPORT QgsCoordinateTransform
      * @param y array of y coordinates to transform
      * @param z array of z coordinates to transform
      * @param direction transform direction (defaults to ForwardTransform)
+     * @param stride distance in doubles between the coordinates of consecutive points, e.g. 2 for
+     * x and y arrays pointing into an interleaved x y buffer (added in QGIS 3.0, not available in Python bindings)
      */
-    void transformCoords( int numPoint, double *x, double *y, double *z, TransformDirection direction = ForwardTransform ) const;
+    void transformCoords( int numPoint, double *x, double *y, double *z, TransformDirection direction = ForwardTransform, int stride = 1 ) const;
+
+    /** Transforms an array of coordinates to the destination CRS like transformCoords(),
+     * splitting large arrays in chunks transformed concurrently by the threads of the
+     * global thread pool. Each thread uses its own proj context, small arrays are
+     * transformed in the calling thread.
+     * @param numPoint number of coordinates in arrays
+     * @param x array of x coordinates to transform
+     * @param y array of y coordinates to transform
+     * @param z array of z coordinates to transform
+     * @param direction transform direction (defaults to ForwardTransform)
+     * @param stride distance in doubles between the coordinates of consecutive points
+     * @throws QgsCsException if any of the chunks fails to transform, the other chunks
+     * are still transformed
+     * @note added in QGIS 3.0
+     * @note not available in Python bindings
+     */
+    void transformCoordsParallel( int numPoint, double *x, double *y, double *z, TransformDirection direction = ForwardTransform, int stride = 1 ) const;
 
     /** Returns true if the transform short circuits because the source and destination are equivalent.
      */
@@ -39,7 +39,42 @@ extern "C"
 }
 #include <sqlite3.h>
 
+#include <QHash>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QSet>
 #include <QStringList>
+#include <QThread>
+
+// proj contexts were added in proj 4.8, older versions share one state between threads
+#if defined(PJ_VERSION) && PJ_VERSION >= 480
+#define QGS_PROJ_HAS_CONTEXTS
+#endif
+
+#ifdef QGS_PROJ_HAS_CONTEXTS
+class QgsCoordinateTransformPrivate;
+
+/**
+ * Frees the proj objects created by a thread for the transforms it used when the thread finishes,
+ * so that they do not outlive the thread and a new thread reusing its id starts with its own ones.
+ */
+class QgsProjThreadCleanup
+{
+  public:
+    ~QgsProjThreadCleanup();
+
+    //! Returns the cleanup of the calling thread, created on first use
+    static QgsProjThreadCleanup *current();
+
+    //! Id of the thread
+    Qt::HANDLE thread;
+    //! Transforms with proj objects for the thread, protected by sMutex
+    QSet< QgsCoordinateTransformPrivate * > transforms;
+
+    //! Protects the transforms of the cleanups of all the threads, locked before the proj objects of a transform
+    static QMutex sMutex;
+};
+#endif
 
 class QgsCoordinateTransformPrivate : public QSharedData
 {
@@ -89,6 +124,8 @@ class QgsCoordinateTransformPrivate : public QSharedData
 
     ~QgsCoordinateTransformPrivate()
     {
+      freeThreadProjections();
+
       // free the proj objects
       if ( mSourceProjection )
       {
@@ -155,8 +192,11 @@ class QgsCoordinateTransformPrivate : public QSharedData
         addNullGridShifts( sourceProjString, destProjString );
       }
 
-      mSourceProjection = pj_init_plus( sourceProjString.toUtf8() );
-      mDestinationProjection = pj_init_plus( destProjString.toUtf8() );
+      freeThreadProjections();
+      mSourceProjString = sourceProjString.toUtf8();
+      mDestinationProjString = destProjString.toUtf8();
+      mSourceProjection = pj_init_plus( mSourceProjString.constData() );
+      mDestinationProjection = pj_init_plus( mDestinationProjString.constData() );
 
 #ifdef COORDINATE_TRANSFORM_VERBOSE
       QgsDebugMsg( "From proj : " + mSourceCRS.toProj4() );
@@ -209,6 +249,95 @@ class QgsCoordinateTransformPrivate : public QSharedData
       return mIsValid;
     }
 
+    //! Proj objects used by one thread
+    struct ThreadProjections
+    {
+      projPJ source = nullptr;
+      projPJ destination = nullptr;
+#ifdef QGS_PROJ_HAS_CONTEXTS
+      projCtx context = nullptr;
+      QgsProjThreadCleanup *cleanup = nullptr;
+#endif
+    };
+
+    /**
+     * Returns the proj objects to use in the calling thread. A proj object must not be
+     * used by several threads at once, so each thread gets its own context and objects,
+     * created on first use and kept until the thread finishes or the transform is reinitialized or destroyed.
+     * Without proj contexts, the shared objects are returned and \a mutex must be held
+     * while they are used.
+     */
+    ThreadProjections threadProjections( QMutex *&mutex )
+    {
+#ifdef QGS_PROJ_HAS_CONTEXTS
+      mutex = nullptr;
+      const Qt::HANDLE thread = QThread::currentThreadId();
+      {
+        QReadLocker locker( &mThreadProjectionsLock );
+        QHash< Qt::HANDLE, ThreadProjections >::const_iterator it = mThreadProjections.constFind( thread );
+        if ( it != mThreadProjections.constEnd() )
+          return it.value();
+      }
+
+      ThreadProjections projections;
+      projections.context = pj_ctx_alloc();
+      projections.source = pj_init_plus_ctx( projections.context, mSourceProjString.constData() );
+      projections.destination = pj_init_plus_ctx( projections.context, mDestinationProjString.constData() );
+      projections.cleanup = QgsProjThreadCleanup::current();
+
+      // only the calling thread adds its own entry, so there is no other entry to replace
+      QMutexLocker cleanupLocker( &QgsProjThreadCleanup::sMutex );
+      projections.cleanup->transforms.insert( this );
+      QWriteLocker locker( &mThreadProjectionsLock );
+      mThreadProjections.insert( thread, projections );
+      return projections;
+#else
+      mutex = &mProjMutex;
+      ThreadProjections projections;
+      projections.source = mSourceProjection;
+      projections.destination = mDestinationProjection;
+      return projections;
+#endif
+    }
+
+    //! Frees the proj objects of all the threads
+    void freeThreadProjections()
+    {
+#ifdef QGS_PROJ_HAS_CONTEXTS
+      QMutexLocker cleanupLocker( &QgsProjThreadCleanup::sMutex );
+      QWriteLocker locker( &mThreadProjectionsLock );
+      Q_FOREACH ( const ThreadProjections &projections, mThreadProjections )
+      {
+        projections.cleanup->transforms.remove( this );
+        freeProjections( projections );
+      }
+      mThreadProjections.clear();
+#endif
+    }
+
+#ifdef QGS_PROJ_HAS_CONTEXTS
+
+    /**
+     * Frees the proj objects of a finishing \a thread, called by its QgsProjThreadCleanup
+     * with QgsProjThreadCleanup::sMutex held.
+     */
+    void freeThreadProjections( Qt::HANDLE thread )
+    {
+      QWriteLocker locker( &mThreadProjectionsLock );
+      freeProjections( mThreadProjections.take( thread ) );
+    }
+
+    static void freeProjections( const ThreadProjections &projections )
+    {
+      if ( projections.source )
+        pj_free( projections.source );
+      if ( projections.destination )
+        pj_free( projections.destination );
+      if ( projections.context )
+        pj_ctx_free( projections.context );
+    }
+#endif
+
     //! Removes +nadgrids and +towgs84 from proj4 string
     QString stripDatumTransform( const QString &proj4 ) const
     {
@@ -339,6 +468,17 @@ class QgsCoordinateTransformPrivate : public QSharedData
     int mSourceDatumTransform;
     int mDestinationDatumTransform;
 
+    //! Proj definitions the proj objects of the threads are created from
+    QByteArray mSourceProjString;
+    QByteArray mDestinationProjString;
+
+#ifdef QGS_PROJ_HAS_CONTEXTS
+    QHash< Qt::HANDLE, ThreadProjections > mThreadProjections;
+    QReadWriteLock mThreadProjectionsLock;
+#else
+    QMutex mProjMutex;
+#endif
+
     void setFinder()
     {
 #if 0
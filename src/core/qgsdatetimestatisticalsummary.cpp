@@ -88,6 +88,18 @@ void QgsDateTimeStatisticalSummary::finalize()
   //if statistics are implemented which require a post-calculation step
 }
 
+void QgsDateTimeStatisticalSummary::merge( const QgsDateTimeStatisticalSummary &other )
+{
+  mCount += other.mCount;
+  mCountMissing += other.mCountMissing;
+  mValues.unite( other.mValues );
+  if ( other.mMin.isValid() && ( !mMin.isValid() || other.mMin < mMin ) )
+    mMin = other.mMin;
+  if ( other.mMax.isValid() && ( !mMax.isValid() || other.mMax > mMax ) )
+    mMax = other.mMax;
+  mIsTimes = mIsTimes || other.mIsTimes;
+}
+
 void QgsDateTimeStatisticalSummary::testDateTime( const QDateTime &dateTime )
 {
   mCount++;
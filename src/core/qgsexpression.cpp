@@ -49,6 +49,7 @@
 #include "qgsmultilinestring.h"
 #include "qgscurvepolygon.h"
 #include "qgsexpressionprivate.h"
+#include "qgsexpressionutils_p.h"
 #include "qgsexpressionsorter.h"
 #include "qgsmaptopixelgeometrysimplifier.h"
 #include "qgsmessagelog.h"
@@ -59,128 +60,6 @@
 // from parser
 extern QgsExpression::Node *parseExpression( const QString &str, QString &parserErrorMsg );
 
-///////////////////////////////////////////////
-// three-value logic
-
-enum TVL
-{
-  False,
-  True,
-  Unknown
-};
-
-static TVL AND[3][3] =
-{
-  // false  true    unknown
-  { False, False,   False },   // false
-  { False, True,    Unknown }, // true
-  { False, Unknown, Unknown }  // unknown
-};
-
-static TVL OR[3][3] =
-{
-  { False,   True, Unknown },  // false
-  { True,    True, True },     // true
-  { Unknown, True, Unknown }   // unknown
-};
-
-static TVL NOT[3] = { True, False, Unknown };
-
-static QVariant tvl2variant( TVL v )
-{
-  switch ( v )
-  {
-    case False:
-      return 0;
-    case True:
-      return 1;
-    case Unknown:
-    default:
-      return QVariant();
-  }
-}
-
-#define TVL_True     QVariant(1)
-#define TVL_False    QVariant(0)
-#define TVL_Unknown  QVariant()
-
-///////////////////////////////////////////////
-// QVariant checks and conversions
-
-inline bool isIntSafe( const QVariant &v )
-{
-  if ( v.type() == QVariant::Int )
-    return true;
-  if ( v.type() == QVariant::UInt )
-    return true;
-  if ( v.type() == QVariant::LongLong )
-    return true;
-  if ( v.type() == QVariant::ULongLong )
-    return true;
-  if ( v.type() == QVariant::Double )
-    return false;
-  if ( v.type() == QVariant::String )
-  {
-    bool ok;
-    v.toString().toInt( &ok );
-    return ok;
-  }
-  return false;
-}
-inline bool isDoubleSafe( const QVariant &v )
-{
-  if ( v.type() == QVariant::Double )
-    return true;
-  if ( v.type() == QVariant::Int )
-    return true;
-  if ( v.type() == QVariant::UInt )
-    return true;
-  if ( v.type() == QVariant::LongLong )
-    return true;
-  if ( v.type() == QVariant::ULongLong )
-    return true;
-  if ( v.type() == QVariant::String )
-  {
-    bool ok;
-    double val = v.toString().toDouble( &ok );
-    ok = ok && qIsFinite( val ) && !qIsNaN( val );
-    return ok;
-  }
-  return false;
-}
-
-inline bool isDateTimeSafe( const QVariant &v )
-{
-  return v.type() == QVariant::DateTime
-         || v.type() == QVariant::Date
-         || v.type() == QVariant::Time;
-}
-
-inline bool isIntervalSafe( const QVariant &v )
-{
-  if ( v.canConvert<QgsInterval>() )
-  {
-    return true;
-  }
-
-  if ( v.type() == QVariant::String )
-  {
-    return QgsInterval::fromString( v.toString() ).isValid();
-  }
-  return false;
-}
-
-inline bool isNull( const QVariant &v )
-{
-  return v.isNull();
-}
-
-///////////////////////////////////////////////
-// evaluation error macros
-
-#define ENSURE_NO_EVAL_ERROR   {  if (parent->hasEvalError()) return QVariant(); }
-#define SET_EVAL_ERROR(x)   { parent->setEvalErrorString(x); return QVariant(); }
-
 ///////////////////////////////////////////////
 // operators
 
@@ -202,39 +81,6 @@ const char *QgsExpression::UNARY_OPERATOR_TEXT[] =
 ///////////////////////////////////////////////
 // functions
 
-// implicit conversion to string
-static QString getStringValue( const QVariant &value, QgsExpression * )
-{
-  return value.toString();
-}
-
-static double getDoubleValue( const QVariant &value, QgsExpression *parent )
-{
-  bool ok;
-  double x = value.toDouble( &ok );
-  if ( !ok || qIsNaN( x ) || !qIsFinite( x ) )
-  {
-    parent->setEvalErrorString( QObject::tr( "Cannot convert '%1' to double" ).arg( value.toString() ) );
-    return 0;
-  }
-  return x;
-}
-
-static qlonglong getIntValue( const QVariant &value, QgsExpression *parent )
-{
-  bool ok;
-  qlonglong x = value.toLongLong( &ok );
-  if ( ok )
-  {
-    return x;
-  }
-  else
-  {
-    parent->setEvalErrorString( QObject::tr( "Cannot convert '%1' to int" ).arg( value.toString() ) );
-    return 0;
-  }
-}
-
 static int getNativeIntValue( const QVariant &value, QgsExpression *parent )
 {
   bool ok;
@@ -367,41 +213,6 @@ QgsVectorLayer *getVectorLayer( const QVariant &value, QgsExpression * )
   return vl;
 }
 
-
-// this handles also NULL values
-static TVL getTVLValue( const QVariant &value, QgsExpression *parent )
-{
-  // we need to convert to TVL
-  if ( value.isNull() )
-    return Unknown;
-
-  //handle some special cases
-  if ( value.canConvert<QgsGeometry>() )
-  {
-    //geom is false if empty
-    QgsGeometry geom = value.value<QgsGeometry>();
-    return geom.isNull() ? False : True;
-  }
-  else if ( value.canConvert<QgsFeature>() )
-  {
-    //feat is false if non-valid
-    QgsFeature feat = value.value<QgsFeature>();
-    return feat.isValid() ? True : False;
-  }
-
-  if ( value.type() == QVariant::Int )
-    return value.toInt() != 0 ? True : False;
-
-  bool ok;
-  double x = value.toDouble( &ok );
-  if ( !ok )
-  {
-    parent->setEvalErrorString( QObject::tr( "Cannot convert '%1' to boolean" ).arg( value.toString() ) );
-    return Unknown;
-  }
-  return !qgsDoubleNear( x, 0.0 ) ? True : False;
-}
-
 static QVariantList getListValue( const QVariant &value, QgsExpression *parent )
 {
   if ( value.type() == QVariant::List || value.type() == QVariant::StringList )
@@ -693,6 +504,7 @@ static QVariant fcnAggregate( const QVariantList &values, const QgsExpressionCon
   QString subExpression = node->dump();
 
   QgsAggregateCalculator::AggregateParameters parameters;
+  parameters.parallel = true;
   //optional forth node is filter
   if ( values.count() > 3 )
   {
@@ -815,6 +627,7 @@ static QVariant fcnAggregateRelation( const QVariantList &values, const QgsExpre
 
   //optional fourth node is concatenator
   QgsAggregateCalculator::AggregateParameters parameters;
+  parameters.parallel = true;
   if ( values.count() > 3 )
   {
     node = getNode( values.at( 3 ), parent );
@@ -925,6 +738,7 @@ static QVariant fcnAggregateGeneric( QgsAggregateCalculator::Aggregate aggregate
   bool ok = false;
 
   QgsExpressionContext subContext( *context );
+  parameters.parallel = true;
   result = vl->aggregate( aggregate, subExpression, parameters, &subContext, &ok );
 
   if ( !ok )
@@ -4178,6 +3992,7 @@ bool QgsExpression::checkExpression( const QString &text, const QgsExpressionCon
 void QgsExpression::setExpression( const QString &expression )
 {
   detach();
+  d->mProgram.reset();
   d->mRootNode = ::parseExpression( expression, d->mParserErrorString );
   d->mEvalErrorString = QString();
   d->mExp = expression;
@@ -4398,6 +4213,7 @@ bool QgsExpression::prepare( const QgsExpressionContext *context )
 {
   detach();
   d->mEvalErrorString = QString();
+  d->mProgram.reset();
   if ( !d->mRootNode )
   {
     //re-parse expression. Creation of QgsExpressionContexts may have added extra
@@ -4415,6 +4231,30 @@ bool QgsExpression::prepare( const QgsExpressionContext *context )
   return d->mRootNode->prepare( this, context );
 }
 
+bool QgsExpression::compile()
+{
+  return compile( nullptr );
+}
+
+bool QgsExpression::compile( QgsExpressionSharedValues *sharedValues )
+{
+  detach();
+  d->mProgram.reset();
+  if ( !d->mRootNode )
+  {
+    d->mEvalErrorString = tr( "No root node! Parsing failed?" );
+    return false;
+  }
+
+  d->mProgram.reset( QgsExpressionProgram::compile( d->mRootNode, sharedValues ) );
+  return static_cast< bool >( d->mProgram );
+}
+
+bool QgsExpression::isCompiled() const
+{
+  return static_cast< bool >( d->mProgram );
+}
+
 QVariant QgsExpression::evaluate()
 {
   d->mEvalErrorString = QString();
@@ -4424,6 +4264,9 @@ QVariant QgsExpression::evaluate()
     return QVariant();
   }
 
+  if ( d->mProgram )
+    return d->mProgram->run( this, nullptr );
+
   return d->mRootNode->eval( this, static_cast<const QgsExpressionContext *>( nullptr ) );
 }
 
@@ -4436,9 +4279,42 @@ QVariant QgsExpression::evaluate( const QgsExpressionContext *context )
     return QVariant();
   }
 
+  if ( d->mProgram )
+    return d->mProgram->run( this, context );
+
   return d->mRootNode->eval( this, context );
 }
 
+QVariantList QgsExpression::evaluateBlock( const QgsFeatureList &features, QgsExpressionContext *context )
+{
+  d->mEvalErrorString = QString();
+  if ( !d->mRootNode )
+  {
+    d->mEvalErrorString = tr( "No root node! Parsing failed?" );
+    return QVariantList();
+  }
+
+  if ( d->mProgram && d->mProgram->supportsBlocks() )
+    return d->mProgram->runBlock( this, features );
+
+  QgsExpressionContext localContext;
+  if ( !context )
+    context = &localContext;
+
+  QVariantList results;
+  results.reserve( features.count() );
+  QString firstError;
+  Q_FOREACH ( const QgsFeature &feature, features )
+  {
+    context->setFeature( feature );
+    results << evaluate( context );
+    if ( firstError.isNull() )
+      firstError = d->mEvalErrorString;
+  }
+  d->mEvalErrorString = firstError;
+  return results;
+}
+
 bool QgsExpression::hasEvalError() const
 {
   return !d->mEvalErrorString.isNull();
@@ -4567,6 +4443,25 @@ double QgsExpression::evaluateToDouble( const QString &text, const double fallba
 ///////////////////////////////////////////////
 // nodes
 
+bool QgsExpression::Node::cacheStaticValue( QgsExpression *parent, const QgsExpressionContext *context )
+{
+  // evaluate with a clean error state. If the evaluation fails the node is not
+  // cached, so that the error gets reported when the node is evaluated for real
+  QString previousError = parent->d->mEvalErrorString;
+  parent->d->mEvalErrorString = QString();
+  mHasCachedValue = false;
+
+  QVariant value = eval( parent, context );
+  bool ok = parent->d->mEvalErrorString.isEmpty();
+  parent->d->mEvalErrorString = previousError;
+  if ( !ok )
+    return false;
+
+  mCachedStaticValue = value;
+  mHasCachedValue = true;
+  return true;
+}
+
 void QgsExpression::NodeList::append( QgsExpression::NamedNode *node )
 {
   mList.append( node->node );
@@ -4605,9 +4500,17 @@ QString QgsExpression::NodeList::dump() const
 
 QVariant QgsExpression::NodeUnaryOperator::eval( QgsExpression *parent, const QgsExpressionContext *context )
 {
+  if ( mHasCachedValue )
+    return mCachedStaticValue;
+
   QVariant val = mOperand->eval( parent, context );
   ENSURE_NO_EVAL_ERROR;
 
+  return evalOperand( parent, val );
+}
+
+QVariant QgsExpression::NodeUnaryOperator::evalOperand( QgsExpression *parent, const QVariant &val )
+{
   switch ( mOp )
   {
     case uoNot:
@@ -4632,7 +4535,11 @@ QVariant QgsExpression::NodeUnaryOperator::eval( QgsExpression *parent, const Qg
 
 bool QgsExpression::NodeUnaryOperator::prepare( QgsExpression *parent, const QgsExpressionContext *context )
 {
-  return mOperand->prepare( parent, context );
+  mHasCachedValue = false;
+  bool res = mOperand->prepare( parent, context );
+  if ( res && mOperand->hasCachedStaticValue() )
+    cacheStaticValue( parent, context );
+  return res;
 }
 
 QString QgsExpression::NodeUnaryOperator::dump() const
@@ -4659,11 +4566,19 @@ QgsExpression::Node *QgsExpression::NodeUnaryOperator::clone() const
 
 QVariant QgsExpression::NodeBinaryOperator::eval( QgsExpression *parent, const QgsExpressionContext *context )
 {
+  if ( mHasCachedValue )
+    return mCachedStaticValue;
+
   QVariant vL = mOpLeft->eval( parent, context );
   ENSURE_NO_EVAL_ERROR;
   QVariant vR = mOpRight->eval( parent, context );
   ENSURE_NO_EVAL_ERROR;
 
+  return evalOperands( parent, vL, vR );
+}
+
+QVariant QgsExpression::NodeBinaryOperator::evalOperands( QgsExpression *parent, const QVariant &vL, const QVariant &vR )
+{
   switch ( mOp )
   {
     case boPlus:
@@ -5014,8 +4929,11 @@ double QgsExpression::NodeBinaryOperator::computeDouble( double x, double y )
 
 bool QgsExpression::NodeBinaryOperator::prepare( QgsExpression *parent, const QgsExpressionContext *context )
 {
+  mHasCachedValue = false;
   bool resL = mOpLeft->prepare( parent, context );
   bool resR = mOpRight->prepare( parent, context );
+  if ( resL && resR && mOpLeft->hasCachedStaticValue() && mOpRight->hasCachedStaticValue() )
+    cacheStaticValue( parent, context );
   return resL && resR;
 }
 
@@ -5156,6 +5074,9 @@ QgsExpression::Node *QgsExpression::NodeBinaryOperator::clone() const
 
 QVariant QgsExpression::NodeInOperator::eval( QgsExpression *parent, const QgsExpressionContext *context )
 {
+  if ( mHasCachedValue )
+    return mCachedStaticValue;
+
   if ( mList->count() == 0 )
     return mNotIn ? TVL_True : TVL_False;
   QVariant v1 = mNode->eval( parent, context );
@@ -5206,11 +5127,16 @@ QVariant QgsExpression::NodeInOperator::eval( QgsExpression *parent, const QgsEx
 
 bool QgsExpression::NodeInOperator::prepare( QgsExpression *parent, const QgsExpressionContext *context )
 {
+  mHasCachedValue = false;
   bool res = mNode->prepare( parent, context );
+  bool isStatic = mNode->hasCachedStaticValue();
   Q_FOREACH ( Node *n, mList->list() )
   {
     res = res && n->prepare( parent, context );
+    isStatic = isStatic && n->hasCachedStaticValue();
   }
+  if ( res && isStatic )
+    cacheStaticValue( parent, context );
   return res;
 }
 
@@ -5228,6 +5154,9 @@ QgsExpression::Node *QgsExpression::NodeInOperator::clone() const
 
 QVariant QgsExpression::NodeFunction::eval( QgsExpression *parent, const QgsExpressionContext *context )
 {
+  if ( mHasCachedValue )
+    return mCachedStaticValue;
+
   QString name = Functions()[mFnIndex]->name();
   Function *fd = context && context->hasFunction( name ) ? context->function( name ) : Functions()[mFnIndex];
 
@@ -5304,6 +5233,7 @@ QgsExpression::NodeFunction::NodeFunction( int fnIndex, QgsExpression::NodeList
 
 bool QgsExpression::NodeFunction::prepare( QgsExpression *parent, const QgsExpressionContext *context )
 {
+  mHasCachedValue = false;
   Function *fd = Functions()[mFnIndex];
 
   bool res = true;
@@ -5314,6 +5244,14 @@ bool QgsExpression::NodeFunction::prepare( QgsExpression *parent, const QgsExpre
       res = res && n->prepare( parent, context );
     }
   }
+
+  // the context may override the function, in which case it decides whether it is static
+  QString name = fd->name();
+  if ( context && context->hasFunction( name ) )
+    fd = context->function( name );
+  if ( res && fd->isStatic( this, parent, context ) )
+    cacheStaticValue( parent, context );
+
   return res;
 }
 
@@ -5476,6 +5414,8 @@ bool QgsExpression::NodeLiteral::prepare( QgsExpression *parent, const QgsExpres
 {
   Q_UNUSED( parent );
   Q_UNUSED( context );
+  mCachedStaticValue = mValue;
+  mHasCachedValue = true;
   return true;
 }
 
@@ -5587,6 +5527,9 @@ QgsExpression::Node *QgsExpression::NodeColumnRef::clone() const
 
 QVariant QgsExpression::NodeCondition::eval( QgsExpression *parent, const QgsExpressionContext *context )
 {
+  if ( mHasCachedValue )
+    return mCachedStaticValue;
+
   Q_FOREACH ( WhenThen *cond, mConditions )
   {
     QVariant vWhen = cond->mWhenExp->eval( parent, context );
@@ -5613,16 +5556,26 @@ QVariant QgsExpression::NodeCondition::eval( QgsExpression *parent, const QgsExp
 
 bool QgsExpression::NodeCondition::prepare( QgsExpression *parent, const QgsExpressionContext *context )
 {
+  mHasCachedValue = false;
   bool res;
+  bool isStatic = true;
   Q_FOREACH ( WhenThen *cond, mConditions )
   {
     res = cond->mWhenExp->prepare( parent, context )
           & cond->mThenExp->prepare( parent, context );
     if ( !res ) return false;
+    isStatic = isStatic && cond->mWhenExp->hasCachedStaticValue() && cond->mThenExp->hasCachedStaticValue();
   }
 
   if ( mElseExp )
-    return mElseExp->prepare( parent, context );
+  {
+    if ( !mElseExp->prepare( parent, context ) )
+      return false;
+    isStatic = isStatic && mElseExp->hasCachedStaticValue();
+  }
+
+  if ( isStatic )
+    cacheStaticValue( parent, context );
 
   return true;
 }
@@ -6059,6 +6012,56 @@ bool QgsExpression::Function::usesGeometry( const QgsExpression::NodeFunction *n
   return true;
 }
 
+bool QgsExpression::Function::isStatic( const QgsExpression::NodeFunction *node, QgsExpression *parent, const QgsExpressionContext *context ) const
+{
+  Q_UNUSED( parent )
+  if ( mLazyEval || mIsContextual || usesGeometry( node ) )
+    return false;
+
+  if ( node->args() )
+  {
+    Q_FOREACH ( Node *argNode, node->args()->list() )
+    {
+      if ( !argNode->hasCachedStaticValue() )
+        return false;
+    }
+  }
+
+  // variables are only static if the scope they come from says so
+  if ( mName == QLatin1String( "var" ) )
+  {
+    if ( !context || !node->args() || node->args()->count() < 1 )
+      return false;
+
+    QString varName = node->args()->list().at( 0 )->cachedStaticValue().toString();
+    return context->isStatic( varName );
+  }
+
+  if ( isVolatileFunction( mName ) )
+    return false;
+
+  // groups of functions which only depend on their arguments
+  static const QStringList sPureGroups = QStringList() << QStringLiteral( "Math" )
+                                         << QStringLiteral( "Conversions" )
+                                         << QStringLiteral( "String" )
+                                         << QStringLiteral( "Conditionals" )
+                                         << QStringLiteral( "Date and Time" )
+                                         << QStringLiteral( "Fuzzy Matching" )
+                                         << QStringLiteral( "Arrays" )
+                                         << QStringLiteral( "Maps" )
+                                         << QStringLiteral( "GeometryGroup" )
+                                         << QStringLiteral( "Color" );
+  if ( mGroups.isEmpty() )
+    return false;
+
+  Q_FOREACH ( const QString &group, mGroups )
+  {
+    if ( !sPureGroups.contains( group ) )
+      return false;
+  }
+  return true;
+}
+
 QSet<QString> QgsExpression::Function::referencedColumns( const NodeFunction *node ) const
 {
   Q_UNUSED( node )
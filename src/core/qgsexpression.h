@@ -41,6 +41,8 @@ class QgsDistanceArea;
 class QDomElement;
 class QgsExpressionContext;
 class QgsExpressionPrivate;
+class QgsExpressionProgram;
+class QgsExpressionSharedValues;
 
 /** \ingroup core
 Class for parsing and evaluation of expressions (formerly called "search strings").
@@ -81,6 +83,11 @@ Performance
 For better performance with many evaluations you may first call prepare(fields) function
 to find out indices of columns and then repeatedly call evaluate(feature).
 
+After preparing, compile() can be called to lower the expression into a flat
+register based program. Subsequent calls to evaluate() then run this program
+instead of recursively walking the node tree, which avoids virtual calls and
+QVariant conversions for numeric and logical operators.
+
 Type conversion
 ===============
 
@@ -170,11 +177,55 @@ class CORE_EXPORT QgsExpression
     const Node *rootNode() const;
 
     /** Get the expression ready for evaluation - find out column indexes.
+     * Subexpressions which do not depend on the feature (e.g. literals, static
+     * variables of the \a context and pure functions of them) are evaluated once here.
      * @param context context for preparing expression
      * @note added in QGIS 2.12
+     * @see QgsExpression::Node::hasCachedStaticValue()
      */
     bool prepare( const QgsExpressionContext *context );
 
+    /**
+     * Compiles the prepared expression into a flat, register based program.
+     * Subsequent calls to evaluate() will run the compiled program instead
+     * of walking the expression node tree. Results (including evaluation errors)
+     * are identical to the node tree evaluation.
+     *
+     * Operators on numeric values are evaluated using typed registers, while
+     * nodes which can not be lowered (e.g., functions with lazily evaluated arguments)
+     * are evaluated through the node tree.
+     *
+     * @note prepare() must be called before compile(). Calling prepare() again
+     * discards the compiled program.
+     * @returns true if the expression was successfully compiled
+     * @see isCompiled()
+     * @note added in QGIS 3.0
+     */
+    bool compile();
+
+    /**
+     * Compiles the prepared expression into a program, like compile(), sharing the
+     * values of common subexpressions with other expressions compiled with the same
+     * \a sharedValues. The expression must have been registered in \a sharedValues,
+     * which must outlive the compiled program.
+     *
+     * This is used to avoid evaluating the same subexpression several times when
+     * a series of expressions is evaluated against every feature, e.g. the filters of
+     * a rule based renderer.
+     *
+     * @note not available in Python bindings
+     * @note added in QGIS 3.0
+     */
+    bool compile( QgsExpressionSharedValues *sharedValues );
+
+    /**
+     * Returns true if the expression has been compiled into a program by a
+     * call to compile().
+     * @see compile()
+     * @note added in QGIS 3.0
+     */
+    bool isCompiled() const;
+
     /**
      * Get list of columns referenced by the expression.
      *
@@ -220,6 +271,24 @@ class CORE_EXPORT QgsExpression
      */
     QVariant evaluate( const QgsExpressionContext *context );
 
+    /** Evaluates the expression against each feature of a block of \a features and returns
+     * the results, in the same order as the features.
+     *
+     * If the expression was compiled and only consists of operators over fields and constants,
+     * the whole block is evaluated column by column, which is much faster than evaluating
+     * the features one after the other. Otherwise the features are set on the \a context
+     * and evaluated one at a time.
+     *
+     * Features which raise an evaluation error give a NULL result, and the first
+     * error is reported by hasEvalError() and evalErrorString().
+     * @param features features to evaluate the expression against
+     * @param context context for evaluating expression. Its feature is changed and
+     * may not be restored.
+     * @note prepare() should be called before calling this method.
+     * @note added in QGIS 3.0
+     */
+    QVariantList evaluateBlock( const QList< QgsFeature > &features, QgsExpressionContext *context );
+
     //! Returns true if an error occurred when evaluating last input
     bool hasEvalError() const;
     //! Returns evaluation error
@@ -625,6 +694,23 @@ class CORE_EXPORT QgsExpression
 
         virtual bool handlesNull() const { return mHandlesNull; }
 
+        /**
+         * Returns true if the function \a node will always return the same value
+         * for the given \a context, i.e. the result does not depend on the feature being
+         * evaluated. Static functions are evaluated only once during prepare().
+         *
+         * The default implementation considers a function static if all of its arguments
+         * are static, it does not use the geometry, is not contextual and belongs to a group
+         * of pure functions (math, string, conversion, date and time, ...). Volatile functions
+         * like rand() or now() are never static. The var() function is static if the
+         * requested variable is marked static in the \a context.
+         *
+         * @see QgsExpression::Node::hasCachedStaticValue()
+         * @see QgsExpressionContext::isStatic()
+         * @note added in QGIS 3.0
+         */
+        virtual bool isStatic( const NodeFunction *node, QgsExpression *parent, const QgsExpressionContext *context ) const;
+
       private:
         QString mName;
         int mParams;
@@ -907,6 +993,46 @@ class CORE_EXPORT QgsExpression
          * @return true if a geometry is required to evaluate this expression
          */
         virtual bool needsGeometry() const = 0;
+
+        /**
+         * Returns true if this node has been found to be static during prepare(),
+         * i.e. its value does not depend on the feature being evaluated. The value of
+         * such a node is computed once in prepare() and returned by every subsequent
+         * call to eval().
+         *
+         * A node is static if it is a literal, or if all of its children are static and
+         * the node itself does not depend on the feature (see Function::isStatic()).
+         *
+         * @see cachedStaticValue()
+         * @note added in QGIS 3.0
+         */
+        bool hasCachedStaticValue() const { return mHasCachedValue; }
+
+        /**
+         * Returns the value of this node as computed during prepare(). Only valid if
+         * hasCachedStaticValue() returns true.
+         *
+         * @see hasCachedStaticValue()
+         * @note added in QGIS 3.0
+         */
+        QVariant cachedStaticValue() const { return mCachedStaticValue; }
+
+      protected:
+
+        /**
+         * Evaluates this node and stores the result as its static value. Evaluation errors
+         * are not reported to the \a parent, instead the node is left uncached so that
+         * the error is raised again when the node is evaluated against a feature.
+         * Returns true if the value was cached.
+         * @note added in QGIS 3.0
+         */
+        bool cacheStaticValue( QgsExpression *parent, const QgsExpressionContext *context );
+
+        //! True if mCachedStaticValue holds the value of this node
+        bool mHasCachedValue = false;
+
+        //! Value of this node if it is static, computed in prepare()
+        QVariant mCachedStaticValue;
     };
 
     //! Named node
@@ -1012,6 +1138,13 @@ class CORE_EXPORT QgsExpression
       protected:
         UnaryOperator mOp;
         Node *mOperand = nullptr;
+
+      private:
+
+        //! Applies the operator to an already evaluated operand value
+        QVariant evalOperand( QgsExpression *parent, const QVariant &val );
+
+        friend class QgsExpressionProgram;
     };
 
     /** \ingroup core
@@ -1048,6 +1181,9 @@ class CORE_EXPORT QgsExpression
         qlonglong computeInt( qlonglong x, qlonglong y );
         double computeDouble( double x, double y );
 
+        //! Applies the operator to already evaluated operand values
+        QVariant evalOperands( QgsExpression *parent, const QVariant &vL, const QVariant &vR );
+
         /** Computes the result date time calculation from a start datetime and an interval
          * @param d start datetime
          * @param i interval to add or subtract (depending on mOp)
@@ -1057,6 +1193,8 @@ class CORE_EXPORT QgsExpression
         BinaryOperator mOp;
         Node *mOpLeft = nullptr;
         Node *mOpRight = nullptr;
+
+        friend class QgsExpressionProgram;
     };
 
     /** \ingroup core
@@ -1175,6 +1313,8 @@ class CORE_EXPORT QgsExpression
       protected:
         QString mName;
         int mIndex;
+
+        friend class QgsExpressionProgram;
     };
 
     /** \ingroup core
@@ -1228,6 +1368,8 @@ class CORE_EXPORT QgsExpression
       protected:
         WhenThenList mConditions;
         Node *mElseExp = nullptr;
+
+        friend class QgsExpressionProgram;
     };
 
     /** Returns the help text for a specified function.
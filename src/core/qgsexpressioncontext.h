@@ -124,11 +124,13 @@ class CORE_EXPORT QgsExpressionContextScope
        * @param name variable name (should be unique within the QgsExpressionContextScope)
        * @param value initial variable value
        * @param readOnly true if variable should not be editable by users
+       * @param isStatic true if the variable will not change during the lifetime of an iterator.
        */
-      StaticVariable( const QString &name = QString(), const QVariant &value = QVariant(), bool readOnly = false )
+      StaticVariable( const QString &name = QString(), const QVariant &value = QVariant(), bool readOnly = false, bool isStatic = false )
         : name( name )
         , value( value )
         , readOnly( readOnly )
+        , isStatic( isStatic )
       {}
 
       //! Variable name
@@ -139,6 +141,9 @@ class CORE_EXPORT QgsExpressionContextScope
 
       //! True if variable should not be editable by users
       bool readOnly;
+
+      //! A static variable can be cached for the lifetime of a context
+      bool isStatic;
     };
 
     /** Constructor for QgsExpressionContextScope
@@ -162,9 +167,10 @@ class CORE_EXPORT QgsExpressionContextScope
      * with the same name is already set then its value is overwritten, otherwise a new variable is added to the scope.
      * @param name variable name
      * @param value variable value
+     * @param isStatic true if the variable will not change during the lifetime of an iterator.
      * @see addVariable()
      */
-    void setVariable( const QString &name, const QVariant &value );
+    void setVariable( const QString &name, const QVariant &value, bool isStatic = false );
 
     /** Adds a variable into the context scope. If a variable with the same name is already set then its
      * value is overwritten, otherwise a new variable is added to the scope.
@@ -217,6 +223,15 @@ class CORE_EXPORT QgsExpressionContextScope
      */
     bool isReadOnly( const QString &name ) const;
 
+    /**
+     * Tests whether the variable with the specified \a name is static and can
+     * be cached, i.e. its value will not change while features are iterated
+     * or rendered with this scope.
+     * @see QgsExpression::Node::hasCachedStaticValue()
+     * @note added in QGIS 3.0
+     */
+    bool isStatic( const QString &name ) const;
+
     /** Returns the count of variables contained within the scope.
      */
     int variableCount() const { return mVariables.count(); }
@@ -442,6 +457,16 @@ class CORE_EXPORT QgsExpressionContext
      */
     bool isReadOnly( const QString &name ) const;
 
+    /**
+     * Returns true if the variable with the specified \a name is static, i.e. its
+     * value will not change while this context is used to evaluate expressions against
+     * a series of features. The static flag is taken from the last scope which contains
+     * the variable.
+     * @see QgsExpressionContextScope::isStatic()
+     * @note added in QGIS 3.0
+     */
+    bool isStatic( const QString &name ) const;
+
     /** Checks whether a specified function is contained in the context.
      * @param name function name
      * @returns true if context provides a matching function
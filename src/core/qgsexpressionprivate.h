@@ -21,6 +21,7 @@
 #include <memory>
 
 #include "qgsexpression.h"
+#include "qgsexpressionprogram.h"
 #include "qgsdistancearea.h"
 #include "qgsunittypes.h"
 
@@ -51,7 +52,10 @@ class QgsExpressionPrivate
       , mCalc( other.mCalc )
       , mDistanceUnit( other.mDistanceUnit )
       , mAreaUnit( other.mAreaUnit )
-    {}
+    {
+      // the compiled program references the nodes of the other expression's
+      // tree, so it is not copied. The copy needs to be prepared and compiled again.
+    }
 
     ~QgsExpressionPrivate()
     {
@@ -70,6 +74,9 @@ class QgsExpressionPrivate
     std::shared_ptr<QgsDistanceArea> mCalc;
     QgsUnitTypes::DistanceUnit mDistanceUnit;
     QgsUnitTypes::AreaUnit mAreaUnit;
+
+    //! Compiled program, or nullptr if the expression has not been compiled
+    std::unique_ptr<QgsExpressionProgram> mProgram;
 };
 ///@endcond
 
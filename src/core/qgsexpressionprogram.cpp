@@ -0,0 +1,1415 @@
+/***************************************************************************
+                         qgsexpressionprogram.cpp
+                         ------------------------
+    begin                : February 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsexpressionprogram.h"
+#include "qgsexpressionutils_p.h"
+#include "qgsexpressioncontext.h"
+#include "qgsfeature.h"
+
+#include <cmath>
+#include <qmath.h>
+
+///@cond PRIVATE
+
+//
+// QgsExpressionSharedValues
+//
+
+void QgsExpressionSharedValues::registerExpression( const QgsExpression &expression )
+{
+  if ( expression.rootNode() )
+    registerNode( const_cast< QgsExpression::Node * >( expression.rootNode() ) );
+}
+
+int QgsExpressionSharedValues::sharedCount() const
+{
+  int count = 0;
+  Q_FOREACH ( const Entry &entry, mEntries )
+  {
+    if ( entry.count > 1 )
+      count++;
+  }
+  return count;
+}
+
+void QgsExpressionSharedValues::registerNode( QgsExpression::Node *node )
+{
+  // literals, columns and static nodes are cheaper to evaluate than to share
+  if ( !node->hasCachedStaticValue()
+       && node->nodeType() != QgsExpression::ntLiteral
+       && node->nodeType() != QgsExpression::ntColumnRef
+       && QgsExpressionProgram::isShareable( node ) )
+  {
+    QString key = node->dump();
+    int index = findEntry( key, node );
+    if ( index >= 0 )
+    {
+      mEntries[ index ].count++;
+    }
+    else
+    {
+      Entry entry;
+      entry.node = node;
+      entry.count = 1;
+      mEntries.append( entry );
+      mEntryIndex.insert( key, mEntries.count() - 1 );
+      mValues.append( QVariant() );
+      mValueGenerations.append( 0 );
+    }
+  }
+
+  Q_FOREACH ( QgsExpression::Node *child, QgsExpressionProgram::childNodes( node ) )
+    registerNode( child );
+}
+
+int QgsExpressionSharedValues::findEntry( const QString &key, const QgsExpression::Node *node ) const
+{
+  QMultiHash< QString, int >::const_iterator it = mEntryIndex.constFind( key );
+  for ( ; it != mEntryIndex.constEnd() && it.key() == key; ++it )
+  {
+    if ( QgsExpressionProgram::nodesEqual( mEntries.at( it.value() ).node, node ) )
+      return it.value();
+  }
+  return -1;
+}
+
+int QgsExpressionSharedValues::slot( const QgsExpression::Node *node ) const
+{
+  if ( node->nodeType() == QgsExpression::ntLiteral || node->nodeType() == QgsExpression::ntColumnRef )
+    return -1;
+
+  int index = findEntry( node->dump(), node );
+  return index >= 0 && mEntries.at( index ).count > 1 ? index : -1;
+}
+
+//
+// QgsExpressionProgram::Value
+//
+
+void QgsExpressionProgram::Value::setVariant( const QVariant &value )
+{
+  v = value;
+  boxed = true;
+  switch ( value.type() )
+  {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+      if ( value.isNull() )
+      {
+        type = Variant;
+      }
+      else
+      {
+        type = LongLong;
+        i = value.toLongLong();
+      }
+      break;
+
+    case QVariant::Double:
+      if ( value.isNull() )
+      {
+        type = Variant;
+      }
+      else
+      {
+        type = Double;
+        d = value.toDouble();
+      }
+      break;
+
+    default:
+      type = Variant;
+      break;
+  }
+}
+
+QVariant QgsExpressionProgram::Value::toVariant() const
+{
+  if ( boxed )
+    return v;
+
+  switch ( type )
+  {
+    case Int:
+      return QVariant( static_cast< int >( i ) );
+    case LongLong:
+      return QVariant( i );
+    case Double:
+      return QVariant( d );
+    case Variant:
+      break;
+  }
+  return v;
+}
+
+bool QgsExpressionProgram::isFastNumeric( const Value &value )
+{
+  // numeric registers can be handled without boxing, as long as they would
+  // not trigger a conversion error in getDoubleValue()
+  return value.isInteger() || ( value.type == Value::Double && qIsFinite( value.d ) );
+}
+
+double QgsExpressionProgram::toDouble( const Value &value )
+{
+  return value.type == Value::Double ? value.d : static_cast< double >( value.i );
+}
+
+bool QgsExpressionProgram::isTrue( const Value &value )
+{
+  // same as getTVLValue(), numeric values are never unknown
+  if ( value.isInteger() )
+    return value.i != 0;
+  return !qgsDoubleNear( value.d, 0.0 );
+}
+
+//
+// compilation
+//
+
+QgsExpressionProgram *QgsExpressionProgram::compile( QgsExpression::Node *rootNode, QgsExpressionSharedValues *sharedValues )
+{
+  if ( !rootNode )
+    return nullptr;
+
+  QgsExpressionProgram *program = new QgsExpressionProgram();
+  program->mSharedValues = sharedValues;
+  int result = program->compileNode( rootNode );
+  program->addInstruction( Instruction( OpReturn, -1, result ) );
+  program->mFunctionSlots.fill( nullptr );
+  program->mAvailable.clear();
+
+  program->mSupportsBlocks = true;
+  Q_FOREACH ( const Instruction &instruction, program->mCode )
+  {
+    if ( instruction.code != OpLoadColumn && instruction.code != OpUnary
+         && instruction.code != OpBinary && instruction.code != OpReturn )
+    {
+      program->mSupportsBlocks = false;
+      break;
+    }
+  }
+  return program;
+}
+
+bool QgsExpressionProgram::isShareable( const QgsExpression::Node *node )
+{
+  if ( node->nodeType() == QgsExpression::ntFunction )
+  {
+    // functions registered by plugins may have side effects, and eval() may
+    // evaluate anything
+    QString name = QgsExpression::Functions()[ static_cast< const QgsExpression::NodeFunction * >( node )->fnIndex() ]->name();
+    if ( !QgsExpression::BuiltinFunctions().contains( name ) || isVolatileFunction( name ) || name == QLatin1String( "eval" ) )
+      return false;
+  }
+
+  Q_FOREACH ( QgsExpression::Node *child, childNodes( node ) )
+  {
+    if ( !isShareable( child ) )
+      return false;
+  }
+  return true;
+}
+
+bool QgsExpressionProgram::nodesEqual( const QgsExpression::Node *node1, const QgsExpression::Node *node2 )
+{
+  if ( node1 == node2 )
+    return true;
+  if ( node1->nodeType() != node2->nodeType() )
+    return false;
+
+  switch ( node1->nodeType() )
+  {
+    case QgsExpression::ntLiteral:
+    {
+      QVariant value1 = static_cast< const QgsExpression::NodeLiteral * >( node1 )->value();
+      QVariant value2 = static_cast< const QgsExpression::NodeLiteral * >( node2 )->value();
+      return value1.type() == value2.type() && value1.isNull() == value2.isNull() && value1 == value2;
+    }
+
+    case QgsExpression::ntColumnRef:
+      return static_cast< const QgsExpression::NodeColumnRef * >( node1 )->name() == static_cast< const QgsExpression::NodeColumnRef * >( node2 )->name();
+
+    case QgsExpression::ntUnaryOperator:
+      if ( static_cast< const QgsExpression::NodeUnaryOperator * >( node1 )->op() != static_cast< const QgsExpression::NodeUnaryOperator * >( node2 )->op() )
+        return false;
+      break;
+
+    case QgsExpression::ntBinaryOperator:
+      if ( static_cast< const QgsExpression::NodeBinaryOperator * >( node1 )->op() != static_cast< const QgsExpression::NodeBinaryOperator * >( node2 )->op() )
+        return false;
+      break;
+
+    case QgsExpression::ntInOperator:
+      if ( static_cast< const QgsExpression::NodeInOperator * >( node1 )->isNotIn() != static_cast< const QgsExpression::NodeInOperator * >( node2 )->isNotIn() )
+        return false;
+      break;
+
+    case QgsExpression::ntFunction:
+      if ( static_cast< const QgsExpression::NodeFunction * >( node1 )->fnIndex() != static_cast< const QgsExpression::NodeFunction * >( node2 )->fnIndex() )
+        return false;
+      break;
+
+    case QgsExpression::ntCondition:
+    {
+      // the else node is optional, children lists of the same length may still differ
+      const QgsExpression::NodeCondition *condition1 = static_cast< const QgsExpression::NodeCondition * >( node1 );
+      const QgsExpression::NodeCondition *condition2 = static_cast< const QgsExpression::NodeCondition * >( node2 );
+      if ( condition1->mConditions.count() != condition2->mConditions.count()
+           || static_cast< bool >( condition1->mElseExp ) != static_cast< bool >( condition2->mElseExp ) )
+        return false;
+      break;
+    }
+  }
+
+  QList< QgsExpression::Node * > children1 = childNodes( node1 );
+  QList< QgsExpression::Node * > children2 = childNodes( node2 );
+  if ( children1.count() != children2.count() )
+    return false;
+
+  for ( int i = 0; i < children1.count(); ++i )
+  {
+    if ( !nodesEqual( children1.at( i ), children2.at( i ) ) )
+      return false;
+  }
+  return true;
+}
+
+QList< QgsExpression::Node * > QgsExpressionProgram::childNodes( const QgsExpression::Node *node )
+{
+  QList< QgsExpression::Node * > children;
+  switch ( node->nodeType() )
+  {
+    case QgsExpression::ntUnaryOperator:
+      children << static_cast< const QgsExpression::NodeUnaryOperator * >( node )->operand();
+      break;
+
+    case QgsExpression::ntBinaryOperator:
+    {
+      const QgsExpression::NodeBinaryOperator *binary = static_cast< const QgsExpression::NodeBinaryOperator * >( node );
+      children << binary->opLeft() << binary->opRight();
+      break;
+    }
+
+    case QgsExpression::ntInOperator:
+    {
+      const QgsExpression::NodeInOperator *in = static_cast< const QgsExpression::NodeInOperator * >( node );
+      children << in->node() << in->list()->list();
+      break;
+    }
+
+    case QgsExpression::ntFunction:
+    {
+      const QgsExpression::NodeFunction *function = static_cast< const QgsExpression::NodeFunction * >( node );
+      if ( function->args() )
+        children << function->args()->list();
+      break;
+    }
+
+    case QgsExpression::ntCondition:
+    {
+      const QgsExpression::NodeCondition *condition = static_cast< const QgsExpression::NodeCondition * >( node );
+      Q_FOREACH ( QgsExpression::WhenThen *whenThen, condition->mConditions )
+        children << whenThen->mWhenExp << whenThen->mThenExp;
+      if ( condition->mElseExp )
+        children << condition->mElseExp;
+      break;
+    }
+
+    case QgsExpression::ntLiteral:
+    case QgsExpression::ntColumnRef:
+      break;
+  }
+  return children;
+}
+
+int QgsExpressionProgram::addRegister()
+{
+  mRegisters.append( Value() );
+  return mRegisters.count() - 1;
+}
+
+int QgsExpressionProgram::addConstant( const QVariant &value )
+{
+  // constant registers are initialized once and never written by the program
+  int reg = addRegister();
+  mRegisters[ reg ].setVariant( value );
+  return reg;
+}
+
+int QgsExpressionProgram::addNode( QgsExpression::Node *node )
+{
+  mNodes.append( node );
+  return mNodes.count() - 1;
+}
+
+int QgsExpressionProgram::addInstruction( const Instruction &instruction )
+{
+  mCode.append( instruction );
+  return mCode.count() - 1;
+}
+
+void QgsExpressionProgram::patchJump( int instruction, int target )
+{
+  mCode[ instruction ].arg = target;
+}
+
+int QgsExpressionProgram::compileNode( QgsExpression::Node *node )
+{
+  // static nodes have been evaluated once in prepare()
+  if ( node->hasCachedStaticValue() )
+    return addConstant( node->cachedStaticValue() );
+
+  if ( !isShareable( node ) )
+    return compileNodeValue( node );
+
+  // reuse the register of an identical subexpression which is always evaluated before this one
+  QString key = node->dump();
+  QMultiHash< QString, AvailableValue >::const_iterator it = mAvailable.constFind( key );
+  for ( ; it != mAvailable.constEnd() && it.key() == key; ++it )
+  {
+    if ( nodesEqual( it.value().node, node ) )
+      return it.value().reg;
+  }
+
+  int dest;
+  int sharedSlot = mSharedValues ? mSharedValues->slot( node ) : -1;
+  if ( sharedSlot < 0 )
+  {
+    dest = compileNodeValue( node );
+  }
+  else
+  {
+    // only evaluate the node if no other program did for the current feature. The
+    // registers written while evaluating it are not available afterwards.
+    int load = addInstruction( Instruction( OpLoadShared, -1, -1, sharedSlot ) );
+    QMultiHash< QString, AvailableValue > available = mAvailable;
+    dest = compileNodeValue( node );
+    mAvailable = available;
+    addInstruction( Instruction( OpStoreShared, -1, dest, sharedSlot ) );
+    mCode[ load ].dest = dest;
+    patchJump( load, mCode.count() );
+  }
+
+  AvailableValue value;
+  value.node = node;
+  value.reg = dest;
+  mAvailable.insert( key, value );
+  return dest;
+}
+
+int QgsExpressionProgram::compileNodeValue( QgsExpression::Node *node )
+{
+  switch ( node->nodeType() )
+  {
+    case QgsExpression::ntLiteral:
+      return addConstant( static_cast< QgsExpression::NodeLiteral * >( node )->value() );
+
+    case QgsExpression::ntColumnRef:
+    {
+      QgsExpression::NodeColumnRef *columnRef = static_cast< QgsExpression::NodeColumnRef * >( node );
+      if ( columnRef->mIndex < 0 )
+        break; // field index is resolved at evaluation time, let the node handle it
+
+      int dest = addRegister();
+      addInstruction( Instruction( OpLoadColumn, dest, -1, -1, columnRef->mIndex, addNode( node ) ) );
+      return dest;
+    }
+
+    case QgsExpression::ntUnaryOperator:
+    {
+      QgsExpression::NodeUnaryOperator *unary = static_cast< QgsExpression::NodeUnaryOperator * >( node );
+      int operand = compileNode( unary->operand() );
+      int dest = addRegister();
+      addInstruction( Instruction( OpUnary, dest, operand, -1, -1, addNode( node ) ) );
+      return dest;
+    }
+
+    case QgsExpression::ntBinaryOperator:
+    {
+      QgsExpression::NodeBinaryOperator *binary = static_cast< QgsExpression::NodeBinaryOperator * >( node );
+      // both operands are always evaluated, left one first
+      int left = compileNode( binary->opLeft() );
+      int right = compileNode( binary->opRight() );
+      int dest = addRegister();
+      addInstruction( Instruction( OpBinary, dest, left, right, -1, addNode( node ) ) );
+      return dest;
+    }
+
+    case QgsExpression::ntInOperator:
+    {
+      QgsExpression::NodeInOperator *in = static_cast< QgsExpression::NodeInOperator * >( node );
+      if ( in->list()->count() == 0 )
+        return addConstant( in->isNotIn() ? TVL_True : TVL_False );
+
+      int nodeIndex = addNode( node );
+      int value = compileNode( in->node() );
+      int dest = addRegister();
+      QList< int > jumpsToEnd;
+      jumpsToEnd << addInstruction( Instruction( OpInBegin, dest, value, -1, -1, nodeIndex ) );
+
+      // list items are only evaluated until a match is found
+      QMultiHash< QString, AvailableValue > available = mAvailable;
+      Q_FOREACH ( QgsExpression::Node *item, in->list()->list() )
+      {
+        int itemValue = compileNode( item );
+        jumpsToEnd << addInstruction( Instruction( OpInTest, dest, value, itemValue, -1, nodeIndex ) );
+      }
+      mAvailable = available;
+
+      addInstruction( Instruction( OpInFinish, dest, -1, -1, -1, nodeIndex ) );
+      Q_FOREACH ( int jump, jumpsToEnd )
+        patchJump( jump, mCode.count() );
+      return dest;
+    }
+
+    case QgsExpression::ntFunction:
+    {
+      QgsExpression::NodeFunction *function = static_cast< QgsExpression::NodeFunction * >( node );
+      if ( QgsExpression::Functions()[ function->fnIndex() ]->lazyEval() )
+        break; // arguments are passed as nodes, let the node handle it
+
+      int nodeIndex = addNode( node );
+      int dest = addRegister();
+      int slot = mFunctionSlots.count();
+      mFunctionSlots.append( nullptr );
+
+      // the function is resolved against the context at evaluation time, as the
+      // context may override it
+      QList< int > jumpsToEnd;
+      jumpsToEnd << addInstruction( Instruction( OpResolveFunction, dest, slot, -1, -1, nodeIndex ) );
+
+      // arguments are skipped if the function is lazy evaluated or a previous argument is null
+      QMultiHash< QString, AvailableValue > available = mAvailable;
+      QVector< int > arguments;
+      if ( function->args() )
+      {
+        Q_FOREACH ( QgsExpression::Node *argument, function->args()->list() )
+        {
+          int argumentValue = compileNode( argument );
+          arguments << argumentValue;
+          jumpsToEnd << addInstruction( Instruction( OpNullGuard, dest, argumentValue, slot, -1, nodeIndex ) );
+        }
+      }
+      mAvailable = available;
+
+      mArgumentLists.append( arguments );
+      addInstruction( Instruction( OpCall, dest, slot, mArgumentLists.count() - 1, -1, nodeIndex ) );
+      Q_FOREACH ( int jump, jumpsToEnd )
+        patchJump( jump, mCode.count() );
+      return dest;
+    }
+
+    case QgsExpression::ntCondition:
+    {
+      QgsExpression::NodeCondition *condition = static_cast< QgsExpression::NodeCondition * >( node );
+      int dest = addRegister();
+      QList< int > jumpsToEnd;
+
+      // conditions are evaluated in turn until one matches, so the values of the
+      // previous conditions are available to the next ones, but not the values
+      // computed in the branches
+      QMultiHash< QString, AvailableValue > available = mAvailable;
+      Q_FOREACH ( QgsExpression::WhenThen *whenThen, condition->mConditions )
+      {
+        int when = compileNode( whenThen->mWhenExp );
+        int skip = addInstruction( Instruction( OpJumpIfNotTrue, -1, when ) );
+        QMultiHash< QString, AvailableValue > availableAfterWhen = mAvailable;
+        int then = compileNode( whenThen->mThenExp );
+        mAvailable = availableAfterWhen;
+        addInstruction( Instruction( OpMove, dest, then ) );
+        jumpsToEnd << addInstruction( Instruction( OpJump ) );
+        patchJump( skip, mCode.count() );
+      }
+
+      // return NULL if no condition is matching
+      int elseValue = condition->mElseExp ? compileNode( condition->mElseExp ) : addConstant( QVariant() );
+      addInstruction( Instruction( OpMove, dest, elseValue ) );
+      mAvailable = available;
+
+      Q_FOREACH ( int jump, jumpsToEnd )
+        patchJump( jump, mCode.count() );
+      return dest;
+    }
+  }
+
+  // generic fallback: evaluate the node through the node tree
+  int dest = addRegister();
+  addInstruction( Instruction( OpEvalNode, dest, -1, -1, -1, addNode( node ) ) );
+  return dest;
+}
+
+//
+// evaluation
+//
+
+QVariant QgsExpressionProgram::run( QgsExpression *parent, const QgsExpressionContext *context )
+{
+  Value *registers = mRegisters.data();
+  const Instruction *code = mCode.constData();
+  const int codeSize = mCode.count();
+
+  // attributes are fetched from the context on first access only
+  bool attributesFetched = false;
+  QgsAttributes attributes;
+
+  int pc = 0;
+  while ( pc < codeSize )
+  {
+    const Instruction &instruction = code[ pc++ ];
+    switch ( instruction.code )
+    {
+      case OpMove:
+        registers[ instruction.dest ] = registers[ instruction.a ];
+        break;
+
+      case OpLoadColumn:
+        if ( !context || !context->hasFeature() )
+        {
+          registers[ instruction.dest ].setVariant( mNodes.at( instruction.node )->eval( parent, context ) );
+        }
+        else
+        {
+          if ( !attributesFetched )
+          {
+            attributes = context->feature().attributes();
+            attributesFetched = true;
+          }
+          registers[ instruction.dest ].setVariant( instruction.arg < attributes.count() ? attributes.at( instruction.arg ) : QVariant() );
+        }
+        break;
+
+      case OpEvalNode:
+        registers[ instruction.dest ].setVariant( mNodes.at( instruction.node )->eval( parent, context ) );
+        if ( parent->hasEvalError() )
+          return QVariant();
+        break;
+
+      case OpUnary:
+        if ( !evalUnary( parent, static_cast< QgsExpression::NodeUnaryOperator * >( mNodes.at( instruction.node ) ),
+                         registers[ instruction.a ], registers[ instruction.dest ] ) )
+          return QVariant();
+        break;
+
+      case OpBinary:
+        if ( !evalBinary( parent, static_cast< QgsExpression::NodeBinaryOperator * >( mNodes.at( instruction.node ) ),
+                          registers[ instruction.a ], registers[ instruction.b ], registers[ instruction.dest ] ) )
+          return QVariant();
+        break;
+
+      case OpJump:
+        pc = instruction.arg;
+        break;
+
+      case OpJumpIfNotTrue:
+      {
+        const Value &value = registers[ instruction.a ];
+        TVL tvl;
+        if ( isFastNumeric( value ) )
+        {
+          tvl = isTrue( value ) ? True : False;
+        }
+        else
+        {
+          tvl = getTVLValue( value.toVariant(), parent );
+          if ( parent->hasEvalError() )
+            return QVariant();
+        }
+        if ( tvl != True )
+          pc = instruction.arg;
+        break;
+      }
+
+      case OpInBegin:
+        if ( registers[ instruction.a ].isNull() )
+        {
+          registers[ instruction.dest ].setNull();
+          pc = instruction.arg;
+        }
+        else
+        {
+          // dest is used as "list contains null" flag until the result is known
+          registers[ instruction.dest ].setInt( 0 );
+        }
+        break;
+
+      case OpInTest:
+      {
+        bool found = false;
+        if ( !evalInTest( parent, instruction, found ) )
+          return QVariant();
+        if ( found )
+          pc = instruction.arg;
+        break;
+      }
+
+      case OpInFinish:
+      {
+        QgsExpression::NodeInOperator *in = static_cast< QgsExpression::NodeInOperator * >( mNodes.at( instruction.node ) );
+        Value &dest = registers[ instruction.dest ];
+        if ( dest.i )
+          dest.setNull();
+        else
+          dest.setInt( in->isNotIn() ? 1 : 0 );
+        break;
+      }
+
+      case OpResolveFunction:
+      {
+        QgsExpression::NodeFunction *function = static_cast< QgsExpression::NodeFunction * >( mNodes.at( instruction.node ) );
+        QgsExpression::Function *fd = QgsExpression::Functions()[ function->fnIndex() ];
+        if ( context && context->hasFunction( fd->name() ) )
+          fd = context->function( fd->name() );
+        mFunctionSlots[ instruction.a ] = fd;
+
+        if ( fd->lazyEval() )
+        {
+          registers[ instruction.dest ].setVariant( function->eval( parent, context ) );
+          if ( parent->hasEvalError() )
+            return QVariant();
+          pc = instruction.arg;
+        }
+        break;
+      }
+
+      case OpNullGuard:
+        // all "normal" functions return NULL, when any parameter is NULL
+        if ( !mFunctionSlots.at( instruction.b )->handlesNull() && registers[ instruction.a ].isNull() )
+        {
+          registers[ instruction.dest ].setNull();
+          pc = instruction.arg;
+        }
+        break;
+
+      case OpCall:
+      {
+        const QVector< int > &arguments = mArgumentLists.at( instruction.b );
+        QVariantList argValues;
+        argValues.reserve( arguments.count() );
+        Q_FOREACH ( int argument, arguments )
+          argValues.append( registers[ argument ].toVariant() );
+
+        registers[ instruction.dest ].setVariant( mFunctionSlots.at( instruction.a )->func( argValues, context, parent ) );
+        if ( parent->hasEvalError() )
+          return QVariant();
+        break;
+      }
+
+      case OpLoadShared:
+        if ( mSharedValues->mValueGenerations.at( instruction.b ) == mSharedValues->mGeneration )
+        {
+          registers[ instruction.dest ].setVariant( mSharedValues->mValues.at( instruction.b ) );
+          pc = instruction.arg;
+        }
+        break;
+
+      case OpStoreShared:
+        mSharedValues->mValues[ instruction.b ] = registers[ instruction.a ].toVariant();
+        mSharedValues->mValueGenerations[ instruction.b ] = mSharedValues->mGeneration;
+        break;
+
+      case OpReturn:
+        return registers[ instruction.a ].toVariant();
+    }
+  }
+
+  Q_ASSERT( false && "program did not return a value" );
+  return QVariant();
+}
+
+bool QgsExpressionProgram::evalUnary( QgsExpression *parent, QgsExpression::NodeUnaryOperator *node, const Value &operand, Value &dest )
+{
+  if ( isFastNumeric( operand ) )
+  {
+    switch ( node->mOp )
+    {
+      case QgsExpression::uoNot:
+        dest.setInt( isTrue( operand ) ? 0 : 1 );
+        return true;
+
+      case QgsExpression::uoMinus:
+        if ( operand.isInteger() )
+          dest.setLongLong( -operand.i );
+        else
+          dest.setDouble( -operand.d );
+        return true;
+    }
+  }
+
+  dest.setVariant( node->evalOperand( parent, operand.toVariant() ) );
+  return !parent->hasEvalError();
+}
+
+bool QgsExpressionProgram::evalBinary( QgsExpression *parent, QgsExpression::NodeBinaryOperator *node, const Value &left, const Value &right, Value &dest )
+{
+  if ( isFastNumeric( left ) && isFastNumeric( right ) )
+  {
+    const QgsExpression::BinaryOperator op = node->mOp;
+    const double fL = toDouble( left );
+    const double fR = toDouble( right );
+    switch ( op )
+    {
+      case QgsExpression::boPlus:
+      case QgsExpression::boMinus:
+      case QgsExpression::boMul:
+      case QgsExpression::boMod:
+        if ( left.isInteger() && right.isInteger() )
+        {
+          // both are integers - let's use integer arithmetics
+          if ( op == QgsExpression::boMod && right.i == 0 )
+            dest.setNull();
+          else
+            dest.setLongLong( node->computeInt( left.i, right.i ) );
+          return true;
+        }
+        FALLTHROUGH;
+      case QgsExpression::boDiv:
+        // silently handle division by zero and return NULL
+        if ( ( op == QgsExpression::boDiv || op == QgsExpression::boMod ) && fR == 0. )
+          dest.setNull();
+        else
+          dest.setDouble( node->computeDouble( fL, fR ) );
+        return true;
+
+      case QgsExpression::boIntDiv:
+        if ( fR == 0. )
+          dest.setNull();
+        else
+          dest.setInt( qFloor( fL / fR ) );
+        return true;
+
+      case QgsExpression::boPow:
+        dest.setDouble( pow( fL, fR ) );
+        return true;
+
+      case QgsExpression::boAnd:
+        dest.setInt( isTrue( left ) && isTrue( right ) ? 1 : 0 );
+        return true;
+
+      case QgsExpression::boOr:
+        dest.setInt( isTrue( left ) || isTrue( right ) ? 1 : 0 );
+        return true;
+
+      case QgsExpression::boEQ:
+      case QgsExpression::boNE:
+      case QgsExpression::boLT:
+      case QgsExpression::boGT:
+      case QgsExpression::boLE:
+      case QgsExpression::boGE:
+        dest.setInt( node->compare( fL - fR ) ? 1 : 0 );
+        return true;
+
+      case QgsExpression::boIs:
+      case QgsExpression::boIsNot:
+      {
+        bool equal = qgsDoubleNear( fL, fR );
+        dest.setInt( equal == ( op == QgsExpression::boIs ) ? 1 : 0 );
+        return true;
+      }
+
+      default:
+        // string operators, use generic code path
+        break;
+    }
+  }
+
+  dest.setVariant( node->evalOperands( parent, left.toVariant(), right.toVariant() ) );
+  return !parent->hasEvalError();
+}
+
+bool QgsExpressionProgram::evalInTest( QgsExpression *parent, const Instruction &instruction, bool &found )
+{
+  QgsExpression::NodeInOperator *node = static_cast< QgsExpression::NodeInOperator * >( mNodes.at( instruction.node ) );
+  const Value &value = mRegisters.at( instruction.a );
+  const Value &item = mRegisters.at( instruction.b );
+  Value &dest = mRegisters[ instruction.dest ];
+
+  if ( item.isNull() )
+  {
+    dest.setInt( 1 );
+    return true;
+  }
+
+  bool equal = false;
+  if ( isFastNumeric( value ) && isFastNumeric( item ) )
+  {
+    equal = qgsDoubleNear( toDouble( value ), toDouble( item ) );
+  }
+  else
+  {
+    QVariant v1 = value.toVariant();
+    QVariant v2 = item.toVariant();
+    if ( isDoubleSafe( v1 ) && isDoubleSafe( v2 ) )
+    {
+      double f1 = getDoubleValue( v1, parent );
+      if ( parent->hasEvalError() )
+        return false;
+      double f2 = getDoubleValue( v2, parent );
+      if ( parent->hasEvalError() )
+        return false;
+      equal = qgsDoubleNear( f1, f2 );
+    }
+    else
+    {
+      equal = QString::compare( getStringValue( v1, parent ), getStringValue( v2, parent ) ) == 0;
+    }
+  }
+
+  if ( equal )
+  {
+    dest.setInt( node->isNotIn() ? 0 : 1 );
+    found = true;
+  }
+  return true;
+}
+
+//
+// block evaluation
+//
+
+void QgsExpressionProgram::Column::setNull( int row )
+{
+  if ( nulls.isEmpty() )
+    nulls.fill( 0, rows );
+  nulls[ row ] = 1;
+}
+
+QgsExpressionProgram::Value QgsExpressionProgram::Column::value( int row ) const
+{
+  Value value;
+  if ( type == Value::Variant || loaded )
+    value.setVariant( v.at( row ) );
+  else if ( isNull( row ) )
+    value.setNull();
+  else if ( type == Value::Int )
+    value.setInt( static_cast< int >( i.at( row ) ) );
+  else if ( type == Value::LongLong )
+    value.setLongLong( i.at( row ) );
+  else
+    value.setDouble( d.at( row ) );
+  return value;
+}
+
+void QgsExpressionProgram::Column::setValue( int row, const Value &value )
+{
+  if ( type != Value::Variant )
+  {
+    // keep the column unboxed as long as the value would be boxed the same way
+    static const QVariant::Type BOXED_TYPE[] = { QVariant::Int, QVariant::LongLong, QVariant::Double };
+    if ( value.isNull() && value.v.type() == QVariant::Invalid )
+    {
+      setNull( row );
+      return;
+    }
+    if ( value.type == type && isFastNumeric( value ) && ( !value.boxed || value.v.type() == BOXED_TYPE[ type ] ) )
+    {
+      if ( type == Value::Double )
+        d[ row ] = value.d;
+      else
+        i[ row ] = value.i;
+      if ( !nulls.isEmpty() )
+        nulls[ row ] = 0;
+      return;
+    }
+    box();
+  }
+  v[ row ] = value.toVariant();
+}
+
+void QgsExpressionProgram::Column::box()
+{
+  if ( type == Value::Variant )
+    return;
+
+  if ( !loaded )
+  {
+    v.resize( rows );
+    for ( int row = 0; row < rows; ++row )
+    {
+      if ( isNull( row ) )
+        v[ row ] = QVariant();
+      else if ( type == Value::Int )
+        v[ row ] = QVariant( static_cast< int >( i.at( row ) ) );
+      else if ( type == Value::LongLong )
+        v[ row ] = QVariant( i.at( row ) );
+      else
+        v[ row ] = QVariant( d.at( row ) );
+    }
+  }
+  type = Value::Variant;
+  i.clear();
+  d.clear();
+  nulls.clear();
+}
+
+QVariantList QgsExpressionProgram::runBlock( QgsExpression *parent, const QgsFeatureList &features )
+{
+  Q_ASSERT( mSupportsBlocks );
+
+  const int rows = features.count();
+  QVector< Column > columns( mRegisters.count() );
+  BlockErrors errors;
+  errors.rows.fill( 0, rows );
+
+  QVariantList results;
+  results.reserve( rows );
+
+  Q_FOREACH ( const Instruction &instruction, mCode )
+  {
+    switch ( instruction.code )
+    {
+      case OpLoadColumn:
+        blockLoadColumn( columns[ instruction.dest ], features, instruction.arg );
+        break;
+
+      case OpUnary:
+        blockUnary( parent, instruction, columns, errors );
+        break;
+
+      case OpBinary:
+        blockBinary( parent, instruction, columns, errors );
+        break;
+
+      case OpReturn:
+      {
+        const Column &result = blockColumn( columns, instruction.a, rows );
+        for ( int row = 0; row < rows; ++row )
+          results << ( errors.rows.at( row ) ? QVariant() : result.value( row ).toVariant() );
+        break;
+      }
+
+      default:
+        Q_ASSERT( false && "instruction does not support blocks" );
+        break;
+    }
+  }
+
+  parent->setEvalErrorString( errors.first );
+  return results;
+}
+
+QgsExpressionProgram::Column &QgsExpressionProgram::blockColumn( QVector< Column > &columns, int reg, int rows ) const
+{
+  Column &column = columns[ reg ];
+  if ( column.computed )
+    return column;
+
+  // registers which are never written are constants, broadcast them
+  const Value &constant = mRegisters.at( reg );
+  column.rows = rows;
+  column.loaded = true;
+  column.computed = true;
+  column.v.fill( constant.toVariant(), rows );
+  if ( isFastNumeric( constant ) )
+  {
+    column.type = constant.type;
+    if ( constant.type == Value::Double )
+      column.d.fill( constant.d, rows );
+    else
+      column.i.fill( constant.i, rows );
+  }
+  return column;
+}
+
+void QgsExpressionProgram::blockLoadColumn( Column &column, const QgsFeatureList &features, int index ) const
+{
+  const int rows = features.count();
+  column = Column();
+  column.rows = rows;
+  column.loaded = true;
+  column.computed = true;
+  column.v.resize( rows );
+
+  // the column is kept unboxed if all its non-null values are integers, or all are finite doubles
+  bool integers = true;
+  bool doubles = true;
+  int row = 0;
+  Q_FOREACH ( const QgsFeature &feature, features )
+  {
+    const QgsAttributes attributes = feature.attributes();
+    const QVariant value = index < attributes.count() ? attributes.at( index ) : QVariant();
+    column.v[ row ] = value;
+    if ( value.isNull() )
+    {
+      column.setNull( row );
+    }
+    else
+    {
+      switch ( value.type() )
+      {
+        case QVariant::Int:
+        case QVariant::UInt:
+        case QVariant::LongLong:
+          doubles = false;
+          break;
+        case QVariant::Double:
+          integers = false;
+          doubles = doubles && qIsFinite( value.toDouble() );
+          break;
+        default:
+          integers = false;
+          doubles = false;
+          break;
+      }
+    }
+    row++;
+  }
+
+  if ( integers )
+  {
+    column.type = Value::LongLong;
+    column.i.resize( rows );
+    for ( row = 0; row < rows; ++row )
+      column.i[ row ] = column.isNull( row ) ? 0 : column.v.at( row ).toLongLong();
+  }
+  else if ( doubles )
+  {
+    column.type = Value::Double;
+    column.d.resize( rows );
+    for ( row = 0; row < rows; ++row )
+      column.d[ row ] = column.isNull( row ) ? 0.0 : column.v.at( row ).toDouble();
+  }
+  else
+  {
+    column.nulls.clear();
+  }
+}
+
+void QgsExpressionProgram::blockError( QgsExpression *parent, BlockErrors &errors, int row )
+{
+  if ( errors.first.isEmpty() )
+    errors.first = parent->evalErrorString();
+  parent->setEvalErrorString( QString() );
+  errors.rows[ row ] = 1;
+}
+
+void QgsExpressionProgram::blockUnary( QgsExpression *parent, const Instruction &instruction, QVector< Column > &columns, BlockErrors &errors ) const
+{
+  QgsExpression::NodeUnaryOperator *node = static_cast< QgsExpression::NodeUnaryOperator * >( mNodes.at( instruction.node ) );
+  const int rows = errors.rows.count();
+  const Column &operand = blockColumn( columns, instruction.a, rows );
+  Column &dest = columns[ instruction.dest ];
+  dest = Column();
+  dest.rows = rows;
+  dest.computed = true;
+
+  bool fixNulls = false;
+  if ( operand.type != Value::Variant )
+  {
+    switch ( node->mOp )
+    {
+      case QgsExpression::uoNot:
+        dest.type = Value::Int;
+        dest.i.resize( rows );
+        if ( operand.type == Value::Double )
+        {
+          for ( int row = 0; row < rows; ++row )
+            dest.i[ row ] = qgsDoubleNear( operand.d.at( row ), 0.0 ) ? 1 : 0;
+        }
+        else
+        {
+          for ( int row = 0; row < rows; ++row )
+            dest.i[ row ] = operand.i.at( row ) == 0 ? 1 : 0;
+        }
+        break;
+
+      case QgsExpression::uoMinus:
+        if ( operand.type == Value::Double )
+        {
+          dest.type = Value::Double;
+          dest.d.resize( rows );
+          for ( int row = 0; row < rows; ++row )
+            dest.d[ row ] = -operand.d.at( row );
+        }
+        else
+        {
+          dest.type = Value::LongLong;
+          dest.i.resize( rows );
+          for ( int row = 0; row < rows; ++row )
+            dest.i[ row ] = -operand.i.at( row );
+        }
+        break;
+    }
+    fixNulls = !operand.nulls.isEmpty();
+  }
+  else
+  {
+    dest.v.resize( rows );
+  }
+
+  // rows which are not handled by the loops above go through the generic code
+  for ( int row = 0; row < rows; ++row )
+  {
+    if ( errors.rows.at( row ) )
+      continue;
+    if ( dest.type != Value::Variant && !( fixNulls && operand.isNull( row ) ) )
+      continue;
+
+    Value value;
+    if ( !evalUnary( parent, node, operand.value( row ), value ) )
+      blockError( parent, errors, row );
+    else
+      dest.setValue( row, value );
+  }
+}
+
+void QgsExpressionProgram::blockBinary( QgsExpression *parent, const Instruction &instruction, QVector< Column > &columns, BlockErrors &errors ) const
+{
+  QgsExpression::NodeBinaryOperator *node = static_cast< QgsExpression::NodeBinaryOperator * >( mNodes.at( instruction.node ) );
+  const int rows = errors.rows.count();
+  const Column &left = blockColumn( columns, instruction.a, rows );
+  const Column &right = blockColumn( columns, instruction.b, rows );
+  Column &dest = columns[ instruction.dest ];
+  dest = Column();
+  dest.rows = rows;
+  dest.computed = true;
+
+  bool vectorized = false;
+  if ( left.type != Value::Variant && right.type != Value::Variant )
+  {
+    const QgsExpression::BinaryOperator op = node->mOp;
+    const bool integers = left.type != Value::Double && right.type != Value::Double;
+
+    // integer columns are converted once, so that all the loops below run over plain arrays
+    QVector< double > leftDoubles;
+    QVector< double > rightDoubles;
+    if ( left.type == Value::Double )
+    {
+      leftDoubles = left.d;
+    }
+    else
+    {
+      leftDoubles.resize( rows );
+      for ( int row = 0; row < rows; ++row )
+        leftDoubles[ row ] = static_cast< double >( left.i.at( row ) );
+    }
+    if ( right.type == Value::Double )
+    {
+      rightDoubles = right.d;
+    }
+    else
+    {
+      rightDoubles.resize( rows );
+      for ( int row = 0; row < rows; ++row )
+        rightDoubles[ row ] = static_cast< double >( right.i.at( row ) );
+    }
+    const double *fL = leftDoubles.constData();
+    const double *fR = rightDoubles.constData();
+
+    vectorized = true;
+    switch ( op )
+    {
+      case QgsExpression::boPlus:
+      case QgsExpression::boMinus:
+      case QgsExpression::boMul:
+      case QgsExpression::boMod:
+        if ( integers )
+        {
+          const qlonglong *iL = left.i.constData();
+          const qlonglong *iR = right.i.constData();
+          dest.type = Value::LongLong;
+          dest.i.resize( rows );
+          qlonglong *out = dest.i.data();
+          if ( op == QgsExpression::boPlus )
+          {
+            for ( int row = 0; row < rows; ++row )
+              out[ row ] = iL[ row ] + iR[ row ];
+          }
+          else if ( op == QgsExpression::boMinus )
+          {
+            for ( int row = 0; row < rows; ++row )
+              out[ row ] = iL[ row ] - iR[ row ];
+          }
+          else if ( op == QgsExpression::boMul )
+          {
+            for ( int row = 0; row < rows; ++row )
+              out[ row ] = iL[ row ] * iR[ row ];
+          }
+          else
+          {
+            for ( int row = 0; row < rows; ++row )
+            {
+              if ( iR[ row ] == 0 )
+                dest.setNull( row );
+              else
+                out[ row ] = iL[ row ] % iR[ row ];
+            }
+          }
+          break;
+        }
+        FALLTHROUGH;
+      case QgsExpression::boDiv:
+      {
+        dest.type = Value::Double;
+        dest.d.resize( rows );
+        double *out = dest.d.data();
+        switch ( op )
+        {
+          case QgsExpression::boPlus:
+            for ( int row = 0; row < rows; ++row )
+              out[ row ] = fL[ row ] + fR[ row ];
+            break;
+          case QgsExpression::boMinus:
+            for ( int row = 0; row < rows; ++row )
+              out[ row ] = fL[ row ] - fR[ row ];
+            break;
+          case QgsExpression::boMul:
+            for ( int row = 0; row < rows; ++row )
+              out[ row ] = fL[ row ] * fR[ row ];
+            break;
+          default:
+            // silently handle division by zero and return NULL
+            for ( int row = 0; row < rows; ++row )
+            {
+              if ( fR[ row ] == 0. )
+                dest.setNull( row );
+              else
+                out[ row ] = op == QgsExpression::boDiv ? fL[ row ] / fR[ row ] : fmod( fL[ row ], fR[ row ] );
+            }
+            break;
+        }
+        break;
+      }
+
+      case QgsExpression::boIntDiv:
+        dest.type = Value::Int;
+        dest.i.resize( rows );
+        for ( int row = 0; row < rows; ++row )
+        {
+          if ( fR[ row ] == 0. )
+            dest.setNull( row );
+          else
+            dest.i[ row ] = qFloor( fL[ row ] / fR[ row ] );
+        }
+        break;
+
+      case QgsExpression::boPow:
+        dest.type = Value::Double;
+        dest.d.resize( rows );
+        for ( int row = 0; row < rows; ++row )
+          dest.d[ row ] = pow( fL[ row ], fR[ row ] );
+        break;
+
+      case QgsExpression::boAnd:
+      case QgsExpression::boOr:
+      {
+        dest.type = Value::Int;
+        dest.i.resize( rows );
+        const bool isAnd = op == QgsExpression::boAnd;
+        for ( int row = 0; row < rows; ++row )
+        {
+          bool tL = !qgsDoubleNear( fL[ row ], 0.0 );
+          bool tR = !qgsDoubleNear( fR[ row ], 0.0 );
+          dest.i[ row ] = ( isAnd ? tL && tR : tL || tR ) ? 1 : 0;
+        }
+        break;
+      }
+
+      case QgsExpression::boEQ:
+      case QgsExpression::boNE:
+      case QgsExpression::boLT:
+      case QgsExpression::boGT:
+      case QgsExpression::boLE:
+      case QgsExpression::boGE:
+        dest.type = Value::Int;
+        dest.i.resize( rows );
+        for ( int row = 0; row < rows; ++row )
+          dest.i[ row ] = node->compare( fL[ row ] - fR[ row ] ) ? 1 : 0;
+        break;
+
+      case QgsExpression::boIs:
+      case QgsExpression::boIsNot:
+      {
+        dest.type = Value::Int;
+        dest.i.resize( rows );
+        const int equalValue = op == QgsExpression::boIs ? 1 : 0;
+        for ( int row = 0; row < rows; ++row )
+          dest.i[ row ] = qgsDoubleNear( fL[ row ], fR[ row ] ) ? equalValue : 1 - equalValue;
+        break;
+      }
+
+      default:
+        // string operators, use generic code path
+        vectorized = false;
+        break;
+    }
+
+    // like the node tree, overflows and invalid operations give infinite or NaN values rather
+    // than errors. The column is boxed so that the operators using it evaluate these values
+    // row by row with evalBinary() instead of the typed loops above
+    if ( dest.type == Value::Double )
+    {
+      for ( int row = 0; row < rows; ++row )
+      {
+        if ( !dest.isNull( row ) && !qIsFinite( dest.d.at( row ) ) )
+        {
+          dest.box();
+          break;
+        }
+      }
+    }
+  }
+
+  if ( !vectorized )
+  {
+    dest = Column();
+    dest.rows = rows;
+    dest.computed = true;
+    dest.v.resize( rows );
+  }
+
+  // null rows are not handled by the loops above, they go through the generic code
+  const bool fixNulls = !left.nulls.isEmpty() || !right.nulls.isEmpty();
+  for ( int row = 0; row < rows; ++row )
+  {
+    if ( errors.rows.at( row ) )
+      continue;
+    if ( vectorized && !( fixNulls && ( left.isNull( row ) || right.isNull( row ) ) ) )
+      continue;
+
+    Value value;
+    if ( !evalBinary( parent, node, left.value( row ), right.value( row ), value ) )
+      blockError( parent, errors, row );
+    else
+      dest.setValue( row, value );
+  }
+}
+
+//
+// debugging
+//
+
+QString QgsExpressionProgram::dump() const
+{
+  static const char *OPCODE_TEXT[] =
+  {
+    "MOVE", "LOADCOLUMN", "EVALNODE", "UNARY", "BINARY", "JUMP", "JUMPIFNOTTRUE",
+    "INBEGIN", "INTEST", "INFINISH", "RESOLVEFUNCTION", "NULLGUARD", "CALL", "LOADSHARED",
+    "STORESHARED", "RETURN"
+  };
+
+  QStringList lines;
+  for ( int i = 0; i < mCode.count(); ++i )
+  {
+    const Instruction &instruction = mCode.at( i );
+    QString line = QStringLiteral( "%1: %2 r%3 r%4 r%5 #%6" ).arg( i ).arg( OPCODE_TEXT[ instruction.code ] )
+                   .arg( instruction.dest ).arg( instruction.a ).arg( instruction.b ).arg( instruction.arg );
+    if ( instruction.node >= 0 )
+      line += QStringLiteral( " [%1]" ).arg( mNodes.at( instruction.node )->dump() );
+    lines << line;
+  }
+  return lines.join( '\n' );
+}
+
+///@endcond
@@ -0,0 +1,331 @@
+/***************************************************************************
+                         qgsexpressionprogram.h
+                         ----------------------
+    begin                : February 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSEXPRESSIONPROGRAM_H
+#define QGSEXPRESSIONPROGRAM_H
+
+#include <QVariant>
+#include <QVector>
+#include <QMultiHash>
+
+#include "qgsexpression.h"
+#include "qgsfeature.h"
+
+///@cond PRIVATE
+
+/**
+ * \ingroup core
+ * Values of subexpressions which are shared between several compiled expressions.
+ *
+ * All the expressions which are evaluated against the same feature (e.g. the filters
+ * of the rules of a QgsRuleBasedRenderer) are first registered, then compiled with
+ * QgsExpression::compile( QgsExpressionSharedValues * ). Every subexpression which
+ * occurs more than once across the registered expressions is then evaluated only once
+ * per feature, the first expression which needs it stores the value for the others.
+ *
+ * newFeature() must be called whenever the feature changes, it invalidates all the
+ * stored values.
+ *
+ * \note not available in Python bindings
+ * \note added in QGIS 3.0
+ */
+class QgsExpressionSharedValues
+{
+  public:
+
+    /**
+     * Registers the subexpressions of a prepared \a expression. All the expressions
+     * must be registered before the first one is compiled.
+     */
+    void registerExpression( const QgsExpression &expression );
+
+    /**
+     * Invalidates all the stored values, to be called before the expressions are
+     * evaluated against a new feature.
+     */
+    void newFeature() { ++mGeneration; }
+
+    /**
+     * Returns the number of distinct subexpressions which occur more than once.
+     */
+    int sharedCount() const;
+
+  private:
+
+    struct Entry
+    {
+      QgsExpression::Node *node;
+      int count;
+    };
+
+    void registerNode( QgsExpression::Node *node );
+    int findEntry( const QString &key, const QgsExpression::Node *node ) const;
+
+    //! Returns the slot for the value of \a node, or -1 if it is not shared
+    int slot( const QgsExpression::Node *node ) const;
+
+    QMultiHash< QString, int > mEntryIndex;
+    QVector< Entry > mEntries;
+
+    QVector< QVariant > mValues;
+    QVector< quint64 > mValueGenerations;
+    quint64 mGeneration = 1;
+
+    friend class QgsExpressionProgram;
+};
+
+/**
+ * \ingroup core
+ * A prepared QgsExpression lowered into a linear instruction stream operating
+ * on a register file.
+ *
+ * Each node of the expression tree writes its result into a register. Registers
+ * keep numeric values unboxed (as qlonglong or double), so chains of arithmetic,
+ * comparison and logical operators run without any QVariant conversion and without
+ * virtual calls. Values are only boxed into QVariants at the boundaries: when reading
+ * feature attributes, when calling expression functions and when returning the
+ * final result.
+ *
+ * Whenever an operand is not numeric (strings, dates, nulls, geometries...) the
+ * instruction falls back to the same conversion rules as the node tree, so results
+ * and evaluation errors are always identical to QgsExpression::Node::eval(). Nodes
+ * which can not be lowered are evaluated through the node tree.
+ *
+ * Nodes found to be static during prepare() become constant registers, and identical
+ * subexpressions are evaluated only once per run. If a QgsExpressionSharedValues is
+ * used, subexpressions are also shared with the other expressions registered with it.
+ *
+ * The program keeps references to the nodes of the expression it was compiled
+ * from, so it is only valid as long as this node tree is alive and unchanged.
+ *
+ * \note not available in Python bindings
+ * \note added in QGIS 3.0
+ */
+class QgsExpressionProgram
+{
+  public:
+
+    /**
+     * Compiles the expression tree starting at \a rootNode into a new program.
+     * The nodes must have been prepared already. Ownership of the returned program
+     * is transferred to the caller.
+     *
+     * If \a sharedValues is set, the values of the subexpressions registered in it are
+     * shared with other programs. The shared values must outlive the program.
+     */
+    static QgsExpressionProgram *compile( QgsExpression::Node *rootNode, QgsExpressionSharedValues *sharedValues = nullptr );
+
+    /**
+     * Runs the program against the specified \a context and returns the result.
+     * Errors are reported to the \a parent expression.
+     */
+    QVariant run( QgsExpression *parent, const QgsExpressionContext *context );
+
+    /**
+     * Returns true if the program only consists of operators over columns and constants,
+     * so that it can be evaluated column-wise over a block of features with runBlock().
+     */
+    bool supportsBlocks() const { return mSupportsBlocks; }
+
+    /**
+     * Evaluates the program for all \a features at once. Attributes are read column-wise
+     * and operators run in tight loops over whole columns of integers or doubles. Rows which
+     * can not be handled that way (nulls, strings, ...) fall back to the same code as run(),
+     * so results are identical to running the program for each feature.
+     *
+     * Rows which raise an evaluation error are NULL, the first error is reported to the
+     * \a parent expression. The program must support blocks, see supportsBlocks().
+     */
+    QVariantList runBlock( QgsExpression *parent, const QgsFeatureList &features );
+
+    /**
+     * Returns the number of instructions in the program.
+     */
+    int instructionCount() const { return mCode.count(); }
+
+    /**
+     * Returns a human readable listing of the program, for debugging purposes.
+     */
+    QString dump() const;
+
+    /**
+     * Returns true if the value of \a node only depends on the feature and context
+     * it is evaluated against, so that it can be computed once and reused wherever an
+     * identical subexpression occurs.
+     */
+    static bool isShareable( const QgsExpression::Node *node );
+
+    /**
+     * Returns true if the subtrees starting at \a node1 and \a node2 are identical.
+     */
+    static bool nodesEqual( const QgsExpression::Node *node1, const QgsExpression::Node *node2 );
+
+    /**
+     * Returns the direct children of \a node, in evaluation order.
+     */
+    static QList< QgsExpression::Node * > childNodes( const QgsExpression::Node *node );
+
+  private:
+
+    enum OpCode
+    {
+      OpMove,             //!< dest = a
+      OpLoadColumn,       //!< dest = feature attribute #arg, falls back to node if no feature is set
+      OpEvalNode,         //!< dest = node->eval()
+      OpUnary,            //!< dest = op a
+      OpBinary,           //!< dest = a op b
+      OpJump,             //!< jump to arg
+      OpJumpIfNotTrue,    //!< jump to arg if a is not true
+      OpInBegin,          //!< if a is null: dest = null and jump to arg
+      OpInTest,           //!< compare a with list item b, dest = result and jump to arg if found
+      OpInFinish,         //!< dest = result of IN operator if no match was found
+      OpResolveFunction,  //!< resolve function for node, if it is lazy evaluated dest = node->eval() and jump to arg
+      OpNullGuard,        //!< if function does not handle null and a is null: dest = null and jump to arg
+      OpCall,             //!< dest = function( argument list b )
+      OpLoadShared,       //!< if shared value b is set for the current feature: dest = value and jump to arg
+      OpStoreShared,      //!< shared value b = a
+      OpReturn,           //!< return a
+    };
+
+    struct Instruction
+    {
+      Instruction( OpCode code, int dest = -1, int a = -1, int b = -1, int arg = -1, int node = -1 )
+        : code( code )
+        , dest( dest )
+        , a( a )
+        , b( b )
+        , arg( arg )
+        , node( node )
+      {}
+
+      OpCode code;
+      int dest;
+      int a;
+      int b;
+      int arg;
+      int node;
+    };
+
+    //! Typed register
+    struct Value
+    {
+      enum Type
+      {
+        Int,      //!< integer, boxed as int (results of logical and comparison operators)
+        LongLong, //!< integer, boxed as qlonglong (results of integer arithmetic)
+        Double,   //!< floating point value
+        Variant,  //!< any other value, including nulls
+      };
+
+      Type type = Variant;
+      qlonglong i = 0;
+      double d = 0.0;
+
+      //! Boxed value, only valid if boxed is true
+      QVariant v;
+      bool boxed = true;
+
+      bool isInteger() const { return type == Int || type == LongLong; }
+      bool isNumeric() const { return type != Variant; }
+      bool isNull() const { return type == Variant && v.isNull(); }
+
+      void setVariant( const QVariant &value );
+      void setInt( int value ) { type = Int; i = value; boxed = false; }
+      void setLongLong( qlonglong value ) { type = LongLong; i = value; boxed = false; }
+      void setDouble( double value ) { type = Double; d = value; boxed = false; }
+      void setNull() { type = Variant; v = QVariant(); boxed = true; }
+      QVariant toVariant() const;
+    };
+
+    //! Register holding the value of a subexpression
+    struct AvailableValue
+    {
+      QgsExpression::Node *node;
+      int reg;
+    };
+
+    //! Values of a register for a block of features
+    struct Column
+    {
+      //! Int, LongLong or Double if the non-null rows are stored unboxed in i or d
+      Value::Type type = Value::Variant;
+      QVector< qlonglong > i;
+      QVector< double > d;
+
+      //! Null rows of a typed column, empty if there are none
+      QVector< char > nulls;
+
+      //! All the values of a Variant column, original values of a loaded column
+      QVector< QVariant > v;
+
+      //! True if v holds the original values of the rows (attributes and constants)
+      bool loaded = false;
+
+      bool computed = false;
+      int rows = 0;
+
+      bool isNull( int row ) const { return !nulls.isEmpty() && nulls.at( row ); }
+      void setNull( int row );
+      Value value( int row ) const;
+      void setValue( int row, const Value &value );
+      void box();
+    };
+
+    //! Rows with evaluation errors while running a block
+    struct BlockErrors
+    {
+      QVector< char > rows;
+      QString first;
+    };
+
+    QgsExpressionProgram() = default;
+
+    int compileNode( QgsExpression::Node *node );
+    int compileNodeValue( QgsExpression::Node *node );
+    int addRegister();
+    int addConstant( const QVariant &value );
+    int addNode( QgsExpression::Node *node );
+    int addInstruction( const Instruction &instruction );
+    void patchJump( int instruction, int target );
+
+    static bool isFastNumeric( const Value &value );
+    static double toDouble( const Value &value );
+    static bool isTrue( const Value &value );
+
+    static bool evalUnary( QgsExpression *parent, QgsExpression::NodeUnaryOperator *node, const Value &operand, Value &dest );
+    static bool evalBinary( QgsExpression *parent, QgsExpression::NodeBinaryOperator *node, const Value &left, const Value &right, Value &dest );
+    bool evalInTest( QgsExpression *parent, const Instruction &instruction, bool &found );
+
+    Column &blockColumn( QVector< Column > &columns, int reg, int rows ) const;
+    void blockLoadColumn( Column &column, const QgsFeatureList &features, int index ) const;
+    void blockUnary( QgsExpression *parent, const Instruction &instruction, QVector< Column > &columns, BlockErrors &errors ) const;
+    void blockBinary( QgsExpression *parent, const Instruction &instruction, QVector< Column > &columns, BlockErrors &errors ) const;
+    static void blockError( QgsExpression *parent, BlockErrors &errors, int row );
+
+    QVector< Instruction > mCode;
+    QVector< Value > mRegisters;
+    QVector< QgsExpression::Node * > mNodes;
+    QVector< QVector< int > > mArgumentLists;
+    QVector< QgsExpression::Function * > mFunctionSlots;
+
+    QgsExpressionSharedValues *mSharedValues = nullptr;
+    bool mSupportsBlocks = false;
+
+    //! Subexpressions which have already been evaluated at the current compilation point, by dump
+    QMultiHash< QString, AvailableValue > mAvailable;
+};
+
+///@endcond
+
+#endif // QGSEXPRESSIONPROGRAM_H
@@ -140,22 +140,29 @@ class QgsExpressionSorter
       expressionContext->appendScope( scope );
 
       QVector<QgsIndexedFeature> indexedFeatures;
+      indexedFeatures.reserve( features.size() );
 
       QgsIndexedFeature indexedFeature;
+      indexedFeature.mIndexes.resize( mPreparedOrderBys.size() );
 
       Q_FOREACH ( const QgsFeature &f, features )
       {
-        indexedFeature.mIndexes.resize( mPreparedOrderBys.size() );
         indexedFeature.mFeature = f;
+        indexedFeatures.append( indexedFeature );
+      }
 
-        expressionContext->setFeature( indexedFeature.mFeature );
+      // evaluate each expression over all the features at once
+      int i = 0;
+      Q_FOREACH ( const QgsFeatureRequest::OrderByClause &orderBy, mPreparedOrderBys )
+      {
+        QgsExpression expression = orderBy.expression();
+        if ( expression.prepare( expressionContext ) )
+          expression.compile();
 
-        int i = 0;
-        Q_FOREACH ( const QgsFeatureRequest::OrderByClause &orderBy, mPreparedOrderBys )
-        {
-          indexedFeature.mIndexes.replace( i++, orderBy.expression().evaluate( expressionContext ) );
-        }
-        indexedFeatures.append( indexedFeature );
+        const QVariantList values = expression.evaluateBlock( features, expressionContext );
+        for ( int row = 0; row < indexedFeatures.size(); ++row )
+          indexedFeatures[ row ].mIndexes.replace( i, values.at( row ) );
+        ++i;
       }
 
       delete expressionContext->popScope();
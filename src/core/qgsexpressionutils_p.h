@@ -0,0 +1,244 @@
+/***************************************************************************
+     qgsexpressionutils_p.h
+     ----------------------
+    Date                 : February 2017
+    Copyright            : (C) 2011 Martin Dobias
+    Email                : wonder.sk at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSEXPRESSIONUTILS_P_H
+#define QGSEXPRESSIONUTILS_P_H
+
+/// @cond PRIVATE
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QGIS API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// Value conversion helpers and three-value logic shared by the expression
+// node tree (qgsexpression.cpp) and the compiled expression program
+// (qgsexpressionprogram.cpp), so that both evaluate with identical semantics.
+//
+
+#include <QVariant>
+#include <QObject>
+
+#include "qgsexpression.h"
+#include "qgsfeature.h"
+#include "qgsgeometry.h"
+
+///////////////////////////////////////////////
+// three-value logic
+
+enum TVL
+{
+  False,
+  True,
+  Unknown
+};
+
+static const TVL AND[3][3] =
+{
+  // false  true    unknown
+  { False, False,   False },   // false
+  { False, True,    Unknown }, // true
+  { False, Unknown, Unknown }  // unknown
+};
+
+static const TVL OR[3][3] =
+{
+  { False,   True, Unknown },  // false
+  { True,    True, True },     // true
+  { Unknown, True, Unknown }   // unknown
+};
+
+static const TVL NOT[3] = { True, False, Unknown };
+
+inline QVariant tvl2variant( TVL v )
+{
+  switch ( v )
+  {
+    case False:
+      return 0;
+    case True:
+      return 1;
+    case Unknown:
+    default:
+      return QVariant();
+  }
+}
+
+#define TVL_True     QVariant(1)
+#define TVL_False    QVariant(0)
+#define TVL_Unknown  QVariant()
+
+///////////////////////////////////////////////
+// QVariant checks and conversions
+
+inline bool isIntSafe( const QVariant &v )
+{
+  if ( v.type() == QVariant::Int )
+    return true;
+  if ( v.type() == QVariant::UInt )
+    return true;
+  if ( v.type() == QVariant::LongLong )
+    return true;
+  if ( v.type() == QVariant::ULongLong )
+    return true;
+  if ( v.type() == QVariant::Double )
+    return false;
+  if ( v.type() == QVariant::String )
+  {
+    bool ok;
+    v.toString().toInt( &ok );
+    return ok;
+  }
+  return false;
+}
+inline bool isDoubleSafe( const QVariant &v )
+{
+  if ( v.type() == QVariant::Double )
+    return true;
+  if ( v.type() == QVariant::Int )
+    return true;
+  if ( v.type() == QVariant::UInt )
+    return true;
+  if ( v.type() == QVariant::LongLong )
+    return true;
+  if ( v.type() == QVariant::ULongLong )
+    return true;
+  if ( v.type() == QVariant::String )
+  {
+    bool ok;
+    double val = v.toString().toDouble( &ok );
+    ok = ok && qIsFinite( val ) && !qIsNaN( val );
+    return ok;
+  }
+  return false;
+}
+
+inline bool isDateTimeSafe( const QVariant &v )
+{
+  return v.type() == QVariant::DateTime
+         || v.type() == QVariant::Date
+         || v.type() == QVariant::Time;
+}
+
+inline bool isIntervalSafe( const QVariant &v )
+{
+  if ( v.canConvert<QgsInterval>() )
+  {
+    return true;
+  }
+
+  if ( v.type() == QVariant::String )
+  {
+    return QgsInterval::fromString( v.toString() ).isValid();
+  }
+  return false;
+}
+
+inline bool isNull( const QVariant &v )
+{
+  return v.isNull();
+}
+
+///////////////////////////////////////////////
+// evaluation error macros
+
+#define ENSURE_NO_EVAL_ERROR   {  if (parent->hasEvalError()) return QVariant(); }
+#define SET_EVAL_ERROR(x)   { parent->setEvalErrorString(x); return QVariant(); }
+
+// implicit conversion to string
+inline QString getStringValue( const QVariant &value, QgsExpression * )
+{
+  return value.toString();
+}
+
+inline double getDoubleValue( const QVariant &value, QgsExpression *parent )
+{
+  bool ok;
+  double x = value.toDouble( &ok );
+  if ( !ok || qIsNaN( x ) || !qIsFinite( x ) )
+  {
+    parent->setEvalErrorString( QObject::tr( "Cannot convert '%1' to double" ).arg( value.toString() ) );
+    return 0;
+  }
+  return x;
+}
+
+inline qlonglong getIntValue( const QVariant &value, QgsExpression *parent )
+{
+  bool ok;
+  qlonglong x = value.toLongLong( &ok );
+  if ( ok )
+  {
+    return x;
+  }
+  else
+  {
+    parent->setEvalErrorString( QObject::tr( "Cannot convert '%1' to int" ).arg( value.toString() ) );
+    return 0;
+  }
+}
+
+// this handles also NULL values
+inline TVL getTVLValue( const QVariant &value, QgsExpression *parent )
+{
+  // we need to convert to TVL
+  if ( value.isNull() )
+    return Unknown;
+
+  //handle some special cases
+  if ( value.canConvert<QgsGeometry>() )
+  {
+    //geom is false if empty
+    QgsGeometry geom = value.value<QgsGeometry>();
+    return geom.isNull() ? False : True;
+  }
+  else if ( value.canConvert<QgsFeature>() )
+  {
+    //feat is false if non-valid
+    QgsFeature feat = value.value<QgsFeature>();
+    return feat.isValid() ? True : False;
+  }
+
+  if ( value.type() == QVariant::Int )
+    return value.toInt() != 0 ? True : False;
+
+  bool ok;
+  double x = value.toDouble( &ok );
+  if ( !ok )
+  {
+    parent->setEvalErrorString( QObject::tr( "Cannot convert '%1' to boolean" ).arg( value.toString() ) );
+    return Unknown;
+  }
+  return !qgsDoubleNear( x, 0.0 ) ? True : False;
+}
+
+/**
+ * Returns true if the builtin function \a name may return a different value on
+ * every call, even for the same arguments and the same feature. The results of such
+ * functions must never be cached or shared.
+ */
+inline bool isVolatileFunction( const QString &name )
+{
+  return name == QLatin1String( "rand" )
+         || name == QLatin1String( "randf" )
+         || name == QLatin1String( "now" )
+         || name == QLatin1String( "uuid" );
+}
+
+/// @endcond
+
+#endif // QGSEXPRESSIONUTILS_P_H
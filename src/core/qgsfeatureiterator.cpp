@@ -137,14 +137,16 @@ void QgsAbstractFeatureIterator::setupOrderBy( const QList<QgsFeatureRequest::Or
 
     // Prepare the expressions
     QList<QgsFeatureRequest::OrderByClause> preparedOrderBys( orderBys );
-    QList<QgsFeatureRequest::OrderByClause>::iterator orderByIt( preparedOrderBys.begin() );
+    QList<QgsExpression> expressions;
 
     QgsExpressionContext *expressionContext( mRequest.expressionContext() );
-    do
+    Q_FOREACH ( const QgsFeatureRequest::OrderByClause &orderBy, preparedOrderBys )
     {
-      orderByIt->expression().prepare( expressionContext );
+      QgsExpression expression = orderBy.expression();
+      if ( expression.prepare( expressionContext ) )
+        expression.compile();
+      expressions << expression;
     }
-    while ( ++orderByIt != preparedOrderBys.end() );
 
     // Fetch all features
     QgsIndexedFeature indexedFeature;
@@ -152,19 +154,31 @@ void QgsAbstractFeatureIterator::setupOrderBy( const QList<QgsFeatureRequest::Or
 
     while ( nextFeature( indexedFeature.mFeature ) )
     {
-      expressionContext->setFeature( indexedFeature.mFeature );
-      int i = 0;
-      Q_FOREACH ( const QgsFeatureRequest::OrderByClause &orderBy, preparedOrderBys )
-      {
-        indexedFeature.mIndexes.replace( i++, orderBy.expression().evaluate( expressionContext ) );
-      }
-
       // We need all features, to ignore the limit for this pre-fetch
       // keep the fetched count at 0.
       mFetchedCount = 0;
       mCachedFeatures.append( indexedFeature );
     }
 
+    // Evaluate the expressions over blocks of features
+    const int blockSize = 1024;
+    QgsFeatureList block;
+    block.reserve( blockSize );
+    for ( int start = 0; start < mCachedFeatures.count(); start += blockSize )
+    {
+      const int end = qMin( start + blockSize, mCachedFeatures.count() );
+      block.clear();
+      for ( int row = start; row < end; ++row )
+        block << mCachedFeatures.at( row ).mFeature;
+
+      for ( int i = 0; i < expressions.count(); ++i )
+      {
+        const QVariantList values = expressions[ i ].evaluateBlock( block, expressionContext );
+        for ( int row = start; row < end; ++row )
+          mCachedFeatures[ row ].mIndexes.replace( i, values.at( row - start ) );
+      }
+    }
+
     std::sort( mCachedFeatures.begin(), mCachedFeatures.end(), QgsExpressionSorter( preparedOrderBys ) );
 
     mFeatureIterator = mCachedFeatures.constBegin();
@@ -222,6 +222,7 @@ void QgsLabelingEngine::run( QgsRenderContext &context )
   p.setPolyP( mCandPolygon );
 
   p.setShowPartial( mFlags.testFlag( UsePartialCandidates ) );
+  p.setSolveInParallel( mFlags.testFlag( SolveInParallel ) );
 
 
   // for each provider: get labels and register them in PAL
@@ -373,6 +374,7 @@ void QgsLabelingEngine::readSettingsFromProject( QgsProject *prj )
   if ( prj->readBoolEntry( QStringLiteral( "PAL" ), QStringLiteral( "/ShowingAllLabels" ), false, &saved ) ) mFlags |= UseAllLabels;
   if ( prj->readBoolEntry( QStringLiteral( "PAL" ), QStringLiteral( "/ShowingPartialsLabels" ), true, &saved ) ) mFlags |= UsePartialCandidates;
   if ( prj->readBoolEntry( QStringLiteral( "PAL" ), QStringLiteral( "/DrawOutlineLabels" ), true, &saved ) ) mFlags |= RenderOutlineLabels;
+  if ( prj->readBoolEntry( QStringLiteral( "PAL" ), QStringLiteral( "/SolveInParallel" ), false, &saved ) ) mFlags |= SolveInParallel;
 }
 
 void QgsLabelingEngine::writeSettingsToProject( QgsProject *project )
@@ -387,6 +389,7 @@ void QgsLabelingEngine::writeSettingsToProject( QgsProject *project )
   project->writeEntry( QStringLiteral( "PAL" ), QStringLiteral( "/ShowingAllLabels" ), mFlags.testFlag( UseAllLabels ) );
   project->writeEntry( QStringLiteral( "PAL" ), QStringLiteral( "/ShowingPartialsLabels" ), mFlags.testFlag( UsePartialCandidates ) );
   project->writeEntry( QStringLiteral( "PAL" ), QStringLiteral( "/DrawOutlineLabels" ), mFlags.testFlag( RenderOutlineLabels ) );
+  project->writeEntry( QStringLiteral( "PAL" ), QStringLiteral( "/SolveInParallel" ), mFlags.testFlag( SolveInParallel ) );
 }
 
 void QgsLabelingEngine::clearSettingsInProject( QgsProject *project )
@@ -399,6 +402,7 @@ void QgsLabelingEngine::clearSettingsInProject( QgsProject *project )
   project->removeEntry( QStringLiteral( "PAL" ), QStringLiteral( "/ShowingAllLabels" ) );
   project->removeEntry( QStringLiteral( "PAL" ), QStringLiteral( "/ShowingPartialsLabels" ) );
   project->removeEntry( QStringLiteral( "PAL" ), QStringLiteral( "/DrawOutlineLabels" ) );
+  project->removeEntry( QStringLiteral( "PAL" ), QStringLiteral( "/SolveInParallel" ) );
 }
 
 
@@ -183,6 +183,7 @@ class CORE_EXPORT QgsLabelingEngine
       RenderOutlineLabels   = 1 << 3,  //!< Whether to render labels as text or outlines
       DrawLabelRectOnly     = 1 << 4,  //!< Whether to only draw the label rect and not the actual label text (used for unit tests)
       DrawCandidates        = 1 << 5,  //!< Whether to draw rectangles of generated candidates (good for debugging)
+      SolveInParallel       = 1 << 6,  //!< Whether to solve independent groups of conflicting labels in parallel with the FALP and chain methods. Placements may differ from the sequential solver. Added in QGIS 3.0
     };
     Q_DECLARE_FLAGS( Flags, Flag )
 
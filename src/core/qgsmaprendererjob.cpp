@@ -19,6 +19,7 @@
 #include <QTime>
 #include <QTimer>
 #include <QtConcurrentMap>
+#include <QThread>
 
 #include "qgslogger.h"
 #include "qgsrendercontext.h"
@@ -41,11 +42,24 @@
 
 const QString QgsMapRendererJob::LABEL_CACHE_ID = QStringLiteral( "_labels_" );
 
+//! Vector layers with fewer features are not worth splitting into tiles
+static const long TILED_RENDERING_MINIMUM_FEATURES = 50000;
+//! Tiles are not made smaller than this height, in pixels
+static const int TILED_RENDERING_MINIMUM_TILE_HEIGHT = 64;
+
+/**
+ * Width of the border rendered around each tile, in pixels. Symbols and effects which
+ * extend less than that from the features they belong to are rendered exactly as if
+ * the layer was rendered in one piece.
+ */
+static const int TILED_RENDERING_MARGIN = 128;
+
 QgsMapRendererJob::QgsMapRendererJob( const QgsMapSettings &settings )
   : mSettings( settings )
   , mCache( nullptr )
   , mRenderingTime( 0 )
   , mFeatureFilterProvider( nullptr )
+  , mTiledLayerMinimumFeatures( TILED_RENDERING_MINIMUM_FEATURES )
 {
 }
 
@@ -353,6 +367,139 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter *painter, QgsLabelingEn
   return layerJobs;
 }
 
+LayerRenderJobs QgsMapRendererJob::prepareTileJobs( LayerRenderJobs &layerJobs )
+{
+  LayerRenderJobs tileJobs;
+
+  const int width = mSettings.outputSize().width();
+  const int height = mSettings.outputSize().height();
+  const int tileCount = qMin( QThread::idealThreadCount(), height / TILED_RENDERING_MINIMUM_TILE_HEIGHT );
+  if ( tileCount < 2 || !qgsDoubleNear( mSettings.rotation(), 0.0 ) )
+    return tileJobs;
+
+  const QgsMapToPixel &mtp = mSettings.mapToPixel();
+  const int margin = TILED_RENDERING_MARGIN;
+
+  for ( int i = 0; i < layerJobs.count(); ++i )
+  {
+    LayerRenderJob &job = layerJobs[i];
+    if ( job.cached || !job.renderer || !job.img )
+      continue;
+
+    QgsVectorLayer *vl = qobject_cast<QgsVectorLayer *>( job.layer.data() );
+    if ( !vl || !vl->renderer() || vl->featureCount() < mTiledLayerMinimumFeatures )
+      continue;
+
+    // the geometry cache is filled by a single renderer
+    if ( mRequestedGeomCacheForLayers.contains( vl->id() ) )
+      continue;
+
+    // labels and diagrams would be registered once per tile
+    if ( job.context.labelingEngine() && QgsPalLabeling::staticWillUseLayer( vl ) )
+      continue;
+
+    // these renderers draw each feature depending on the other features of the map
+    const QString rendererType = vl->renderer()->type();
+    if ( rendererType == QLatin1String( "pointDisplacement" ) || rendererType == QLatin1String( "pointCluster" )
+         || rendererType == QLatin1String( "heatmapRenderer" ) || rendererType == QLatin1String( "invertedPolygonRenderer" ) )
+      continue;
+
+    LayerRenderJobs layerTiles;
+    bool ok = true;
+    for ( int tile = 0; tile < tileCount && ok; ++tile )
+    {
+      const int top = height * tile / tileCount;
+      const int bottom = height * ( tile + 1 ) / tileCount;
+
+      // features are requested from the tile and its margin
+      QgsRectangle r1( mtp.toMapCoordinates( -margin, top - margin ), mtp.toMapCoordinates( width + margin, bottom + margin ) ), r2;
+      if ( job.context.coordinateTransform().isValid() )
+        reprojectToLayerExtent( vl, job.context.coordinateTransform(), r1, r2 );
+      if ( !r1.isFinite() || !r2.isFinite() )
+      {
+        ok = false;
+        break;
+      }
+
+      QImage *img = new QImage( width + 2 * margin, bottom - top + 2 * margin, mSettings.outputImageFormat() );
+      if ( img->isNull() )
+      {
+        delete img;
+        ok = false;
+        break;
+      }
+
+      layerTiles.append( LayerRenderJob() );
+      LayerRenderJob &tileJob = layerTiles.last();
+      tileJob.context = job.context;
+      // the tiles are rendered in parallel, each with its own arena
+      tileJob.context.detachArena();
+      tileJob.context.setExtent( r1 );
+      tileJob.img = img;
+      QPainter *painter = new QPainter( img );
+      painter->setRenderHint( QPainter::Antialiasing, mSettings.testFlag( QgsMapSettings::Antialiasing ) );
+      painter->translate( margin, margin - top );
+      tileJob.context.setPainter( painter );
+      tileJob.blendMode = QPainter::CompositionMode_SourceOver;
+      tileJob.opacity = 1.0;
+      tileJob.cached = false;
+      // tiles are never cached on their own
+      tileJob.layer = nullptr;
+      tileJob.renderingTime = -1;
+      tileJob.tileOf = i;
+      tileJob.tileRect = QRect( 0, top, width, bottom - top );
+      tileJob.tileMargin = margin;
+
+      bool hasStyleOverride = mSettings.layerStyleOverrides().contains( vl->id() );
+      if ( hasStyleOverride )
+        vl->styleManager()->setOverrideStyle( mSettings.layerStyleOverrides().value( vl->id() ) );
+
+      tileJob.renderer = vl->createMapRenderer( tileJob.context );
+
+      if ( hasStyleOverride )
+        vl->styleManager()->restoreOverrideStyle();
+    }
+
+    if ( !ok )
+    {
+      QgsDebugMsg( "could not split layer " + vl->id() + " into tiles" );
+      cleanupJobs( layerTiles );
+      continue;
+    }
+
+    // the tiles are drawn into the layer image by composeTiles(), which needs the only painter on it
+    delete job.renderer;
+    job.renderer = nullptr;
+    delete job.context.painter();
+    job.context.setPainter( nullptr );
+    job.img->fill( 0 );
+    tileJobs << layerTiles;
+  }
+
+  return tileJobs;
+}
+
+void QgsMapRendererJob::composeTiles( LayerRenderJobs &layerJobs, LayerRenderJobs &tileJobs )
+{
+  for ( LayerRenderJobs::iterator it = tileJobs.begin(); it != tileJobs.end(); ++it )
+  {
+    LayerRenderJob &tileJob = *it;
+    LayerRenderJob &job = layerJobs[ tileJob.tileOf ];
+
+    delete tileJob.context.painter();
+    tileJob.context.setPainter( nullptr );
+
+    // tiles own disjoint parts of the image, so the drawing order of symbol levels is kept
+    QPainter painter( job.img );
+    painter.setCompositionMode( QPainter::CompositionMode_Source );
+    painter.drawImage( tileJob.tileRect.topLeft(), *tileJob.img,
+                       QRect( QPoint( tileJob.tileMargin, tileJob.tileMargin ), tileJob.tileRect.size() ) );
+    painter.end();
+
+    job.renderingTime = qMax( job.renderingTime, tileJob.renderingTime );
+  }
+}
+
 LabelRenderJob QgsMapRendererJob::prepareLabelingJob( QPainter *painter, QgsLabelingEngine *labelingEngine2, bool canUseLabelCache )
 {
   LabelRenderJob job;
@@ -52,6 +52,13 @@ struct LayerRenderJob
   bool cached; // if true, img already contains cached image from previous rendering
   QgsWeakMapLayerPointer layer;
   int renderingTime; //!< Time it took to render the layer in ms (it is -1 if not rendered or still rendering)
+
+  //! Index of the layer job this job renders a tile of, or -1 if the job renders a whole layer
+  int tileOf = -1;
+  //! Area of the map image covered by the tile, in pixels
+  QRect tileRect;
+  //! Width of the border rendered around the tile into img, in pixels
+  int tileMargin = 0;
 };
 
 typedef QList<LayerRenderJob> LayerRenderJobs;
@@ -162,6 +169,22 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
     //! each LayerRenderJob.
     const QgsFeatureFilterProvider *featureFilterProvider() const { return mFeatureFilterProvider; }
 
+    /**
+     * Sets the minimum number of features of the vector layers which are split into tiles
+     * when the QgsMapSettings::RenderTiledLayers flag is set. Defaults to 50000.
+     * @see tiledLayerMinimumFeatures()
+     * @note added in QGIS 3.0
+     */
+    void setTiledLayerMinimumFeatures( long count ) { mTiledLayerMinimumFeatures = count; }
+
+    /**
+     * Returns the minimum number of features of the vector layers which are split into tiles
+     * when the QgsMapSettings::RenderTiledLayers flag is set.
+     * @see setTiledLayerMinimumFeatures()
+     * @note added in QGIS 3.0
+     */
+    long tiledLayerMinimumFeatures() const { return mTiledLayerMinimumFeatures; }
+
     struct Error
     {
       Error( const QString &lid, const QString &msg )
@@ -244,6 +267,25 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
      */
     LabelRenderJob prepareLabelingJob( QPainter *painter, QgsLabelingEngine *labelingEngine2, bool canUseLabelCache = true );
 
+    /**
+     * Splits the jobs of heavy vector layers into tiles which can be rendered in parallel
+     * (see QgsMapSettings::RenderTiledLayers). Each returned tile job renders the features of
+     * a horizontal strip of the map into its own image, with a margin around it. The split
+     * layer jobs are left without renderer, their image must be filled with composeTiles()
+     * once the tiles are rendered.
+     * @note not available in python bindings
+     * @note added in QGIS 3.0
+     */
+    LayerRenderJobs prepareTileJobs( LayerRenderJobs &layerJobs );
+
+    /**
+     * Copies the rendered tiles into the images of the layer jobs they were split from.
+     * The painters of the tiles are ended first.
+     * @note not available in python bindings
+     * @note added in QGIS 3.0
+     */
+    static void composeTiles( LayerRenderJobs &layerJobs, LayerRenderJobs &tileJobs );
+
     //! @note not available in python bindings
     static QImage composeImage( const QgsMapSettings &settings, const LayerRenderJobs &jobs, const LabelRenderJob &labelJob );
 
@@ -285,6 +327,8 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
     QMap<QString, QgsGeometryCache> mGeometryCaches;
 
     const QgsFeatureFilterProvider *mFeatureFilterProvider = nullptr;
+
+    long mTiledLayerMinimumFeatures;
 };
 
 
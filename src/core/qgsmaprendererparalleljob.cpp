@@ -61,6 +61,19 @@ void QgsMapRendererParallelJob::start()
   bool canUseLabelCache = prepareLabelCache();
   mLayerJobs = prepareJobs( nullptr, mLabelingEngineV2.get() );
   mLabelJob = prepareLabelingJob( nullptr, mLabelingEngineV2.get(), canUseLabelCache );
+  if ( mSettings.testFlag( QgsMapSettings::RenderTiledLayers ) )
+    mTileJobs = prepareTileJobs( mLayerJobs );
+  mTileCount = mTileJobs.count();
+
+  // tiles first: they belong to the heaviest layers
+  mRenderQueue.clear();
+  for ( LayerRenderJobs::iterator it = mTileJobs.begin(); it != mTileJobs.end(); ++it )
+    mRenderQueue << &*it;
+  for ( LayerRenderJobs::iterator it = mLayerJobs.begin(); it != mLayerJobs.end(); ++it )
+  {
+    if ( it->renderer || it->cached )
+      mRenderQueue << &*it;
+  }
 
   QgsDebugMsg( QString( "QThreadPool max thread count is %1" ).arg( QThreadPool::globalInstance()->maxThreadCount() ) );
 
@@ -68,7 +81,7 @@ void QgsMapRendererParallelJob::start()
 
   connect( &mFutureWatcher, &QFutureWatcher<void>::finished, this, &QgsMapRendererParallelJob::renderLayersFinished );
 
-  mFuture = QtConcurrent::map( mLayerJobs, renderLayerStatic );
+  mFuture = QtConcurrent::map( mRenderQueue, renderQueuedJobStatic );
   mFutureWatcher.setFuture( mFuture );
 }
 
@@ -86,6 +99,12 @@ void QgsMapRendererParallelJob::cancel()
     if ( it->renderer && it->renderer->feedback() )
       it->renderer->feedback()->cancel();
   }
+  for ( LayerRenderJobs::iterator it = mTileJobs.begin(); it != mTileJobs.end(); ++it )
+  {
+    it->context.setRenderingStopped( true );
+    if ( it->renderer && it->renderer->feedback() )
+      it->renderer->feedback()->cancel();
+  }
 
   if ( mStatus == RenderingLayers )
   {
@@ -122,6 +141,12 @@ void QgsMapRendererParallelJob::cancelWithoutBlocking()
     if ( it->renderer && it->renderer->feedback() )
       it->renderer->feedback()->cancel();
   }
+  for ( LayerRenderJobs::iterator it = mTileJobs.begin(); it != mTileJobs.end(); ++it )
+  {
+    it->context.setRenderingStopped( true );
+    if ( it->renderer && it->renderer->feedback() )
+      it->renderer->feedback()->cancel();
+  }
 
   if ( mStatus == RenderingLayers )
   {
@@ -196,6 +221,8 @@ void QgsMapRendererParallelJob::renderLayersFinished()
 {
   Q_ASSERT( mStatus == RenderingLayers );
 
+  composeTiles( mLayerJobs, mTileJobs );
+
   // compose final image
   mFinalImage = composeImage( mSettings, mLayerJobs, mLabelJob );
 
@@ -224,6 +251,8 @@ void QgsMapRendererParallelJob::renderingFinished()
 
   logRenderingTime( mLayerJobs, mLabelJob );
 
+  mRenderQueue.clear();
+  cleanupJobs( mTileJobs );
   cleanupJobs( mLayerJobs );
 
   cleanupLabelJob( mLabelJob );
@@ -273,6 +302,10 @@ void QgsMapRendererParallelJob::renderLayerStatic( LayerRenderJob &job )
   QgsDebugMsgLevel( QString( "job %1 end [%2 ms] (layer %3)" ).arg( reinterpret_cast< quint64 >( &job ), 0, 16 ).arg( job.renderingTime ).arg( job.layer ? job.layer->id() : QString() ), 2 );
 }
 
+void QgsMapRendererParallelJob::renderQueuedJobStatic( LayerRenderJob *&job )
+{
+  renderLayerStatic( *job );
+}
 
 void QgsMapRendererParallelJob::renderLabelsStatic( QgsMapRendererParallelJob *self )
 {
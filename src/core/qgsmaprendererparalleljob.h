@@ -25,6 +25,11 @@
  * The resulting map image can be retrieved with renderedImage() function.
  * It is safe to call that function while rendering is active to see preview of the map.
  *
+ * If the QgsMapSettings::RenderTiledLayers flag is set, vector layers with many features
+ * are additionally split into horizontal tiles, each rendered by its own layer renderer.
+ * Layers which are labeled or have diagrams, and maps with rotation, are not split. The
+ * tiles of a layer only show in the preview once all of them are rendered.
+ *
  * @note added in 2.4
  */
 class CORE_EXPORT QgsMapRendererParallelJob : public QgsMapRendererQImageJob
@@ -46,6 +51,13 @@ class CORE_EXPORT QgsMapRendererParallelJob : public QgsMapRendererQImageJob
     // from QgsMapRendererJobWithPreview
     virtual QImage renderedImage() override;
 
+    /**
+     * Returns the number of tiles the vector layers were split into when the job was started,
+     * 0 if no layer was split (see QgsMapSettings::RenderTiledLayers).
+     * @note added in QGIS 3.0
+     */
+    int tileCount() const { return mTileCount; }
+
   private slots:
     //! layers are rendered, labeling is still pending
     void renderLayersFinished();
@@ -57,6 +69,8 @@ class CORE_EXPORT QgsMapRendererParallelJob : public QgsMapRendererQImageJob
     //! @note not available in Python bindings
     static void renderLayerStatic( LayerRenderJob &job );
     //! @note not available in Python bindings
+    static void renderQueuedJobStatic( LayerRenderJob *&job );
+    //! @note not available in Python bindings
     static void renderLabelsStatic( QgsMapRendererParallelJob *self );
 
     QImage mFinalImage;
@@ -68,6 +82,11 @@ class CORE_EXPORT QgsMapRendererParallelJob : public QgsMapRendererQImageJob
     QFutureWatcher<void> mFutureWatcher;
 
     LayerRenderJobs mLayerJobs;
+    //! Tiles of the layers split with QgsMapSettings::RenderTiledLayers
+    LayerRenderJobs mTileJobs;
+    int mTileCount = 0;
+    //! Layer and tile jobs which are rendered in parallel
+    QList< LayerRenderJob * > mRenderQueue;
     LabelRenderJob mLabelJob;
 
     //! New labeling engine
@@ -23,6 +23,9 @@
 
 #include "qgslogger.h"
 #include "qgspoint.h"
+#include "qgssimd_p.h"
+
+#include <type_traits>
 
 
 QgsMapToPixel::QgsMapToPixel( double mapUnitsPerPixel,
@@ -261,6 +264,104 @@ void QgsMapToPixel::transformInPlace( float &x, float &y ) const
   y = my;
 }
 
+///@cond PRIVATE
+
+// The kernels transform interleaved x, y coordinates with the operations of
+// QTransform::map() in the same order, so that the results are identical.
+// Scaling matrices only use the diagonal, as in QTransform, to give the same
+// result for infinite coordinates.
+
+#if defined( QGS_SIMD_SSE2 )
+static void scalePointsSse2( double *xy, int count, double m11, double m22, double dx, double dy )
+{
+  const __m128d scale = _mm_set_pd( m22, m11 );
+  const __m128d offset = _mm_set_pd( dy, dx );
+  for ( int i = 0; i < count; ++i, xy += 2 )
+  {
+    _mm_storeu_pd( xy, _mm_add_pd( _mm_mul_pd( _mm_loadu_pd( xy ), scale ), offset ) );
+  }
+}
+
+static void affinePointsSse2( double *xy, int count, const QTransform &t )
+{
+  const __m128d diagonal = _mm_set_pd( t.m22(), t.m11() );
+  const __m128d cross = _mm_set_pd( t.m12(), t.m21() );
+  const __m128d offset = _mm_set_pd( t.dy(), t.dx() );
+  for ( int i = 0; i < count; ++i, xy += 2 )
+  {
+    const __m128d p = _mm_loadu_pd( xy );
+    const __m128d swapped = _mm_shuffle_pd( p, p, 1 );
+    _mm_storeu_pd( xy, _mm_add_pd( _mm_add_pd( _mm_mul_pd( p, diagonal ), _mm_mul_pd( swapped, cross ) ), offset ) );
+  }
+}
+#endif
+
+#if defined( QGS_SIMD_AVX2 )
+QGS_TARGET_AVX2 static int scalePointsAvx2( double *xy, int count, double m11, double m22, double dx, double dy )
+{
+  const __m256d scale = _mm256_set_pd( m22, m11, m22, m11 );
+  const __m256d offset = _mm256_set_pd( dy, dx, dy, dx );
+  int i = 0;
+  for ( ; i + 2 <= count; i += 2, xy += 4 )
+  {
+    _mm256_storeu_pd( xy, _mm256_add_pd( _mm256_mul_pd( _mm256_loadu_pd( xy ), scale ), offset ) );
+  }
+  return i;
+}
+
+QGS_TARGET_AVX2 static int affinePointsAvx2( double *xy, int count, const QTransform &t )
+{
+  const __m256d diagonal = _mm256_set_pd( t.m22(), t.m11(), t.m22(), t.m11() );
+  const __m256d cross = _mm256_set_pd( t.m12(), t.m21(), t.m12(), t.m21() );
+  const __m256d offset = _mm256_set_pd( t.dy(), t.dx(), t.dy(), t.dx() );
+  int i = 0;
+  for ( ; i + 2 <= count; i += 2, xy += 4 )
+  {
+    const __m256d p = _mm256_loadu_pd( xy );
+    const __m256d swapped = _mm256_permute_pd( p, 0x5 );
+    _mm256_storeu_pd( xy, _mm256_add_pd( _mm256_add_pd( _mm256_mul_pd( p, diagonal ), _mm256_mul_pd( swapped, cross ) ), offset ) );
+  }
+  return i;
+}
+#endif
+
+///@endcond
+
+void QgsMapToPixel::transformInPlace( QPointF *points, int count ) const
+{
+  const QTransform::TransformationType type = mMatrix.type();
+  if ( type == QTransform::TxNone )
+    return;
+
+  if ( !std::is_same< qreal, double >::value || type == QTransform::TxProject || !QgsSimd::hasSse2() )
+  {
+    for ( int i = 0; i < count; ++i )
+    {
+      qreal mx, my;
+      mMatrix.map( points[i].x(), points[i].y(), &mx, &my );
+      points[i] = QPointF( mx, my );
+    }
+    return;
+  }
+
+#if defined( QGS_SIMD_SSE2 )
+  double *xy = reinterpret_cast< double * >( points );
+  const bool scaleOnly = type <= QTransform::TxScale;
+  int done = 0;
+#if defined( QGS_SIMD_AVX2 )
+  if ( QgsSimd::hasAvx2() )
+  {
+    done = scaleOnly ? scalePointsAvx2( xy, count, mMatrix.m11(), mMatrix.m22(), mMatrix.dx(), mMatrix.dy() )
+           : affinePointsAvx2( xy, count, mMatrix );
+  }
+#endif
+  if ( scaleOnly )
+    scalePointsSse2( xy + 2 * done, count - done, mMatrix.m11(), mMatrix.m22(), mMatrix.dx(), mMatrix.dy() );
+  else
+    affinePointsSse2( xy + 2 * done, count - done, mMatrix );
+#endif
+}
+
 QTransform QgsMapToPixel::transform() const
 {
   // NOTE: operations are done in the reverse order in which
@@ -25,6 +25,7 @@
 
 class QgsPoint;
 class QPoint;
+class QPointF;
 
 /** \ingroup core
   * Perform transforms between map coordinates and device coordinates.
@@ -111,6 +112,15 @@ class CORE_EXPORT QgsMapToPixel
         transformInPlace( x[i], y[i] );
     }
 
+    /**
+     * Transforms \a count points from map coordinates to device coordinates in place.
+     * Whole arrays are transformed with SSE2 or AVX2 instructions when the CPU supports
+     * them, with the same result as calling transformInPlace() for each point.
+     * @note not available in python bindings
+     * @note added in QGIS 3.0
+     */
+    void transformInPlace( QPointF *points, int count ) const;
+
     QgsPoint toMapCoordinates( int x, int y ) const;
 
     //! Transform device coordinates to map (world) coordinates
@@ -0,0 +1,476 @@
+/***************************************************************************
+  qgspackedspatialindex.cpp
+  --------------------------------------
+  Date                 : February 2017
+  Copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgspackedspatialindex.h"
+
+#include "qgsfeatureiterator.h"
+#include "qgsgeometry.h"
+#include "qgslogger.h"
+#include "qgspoint.h"
+
+#include <QSaveFile>
+#include <QThread>
+#include <QtConcurrentMap>
+#include <QVector>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <vector>
+
+///@cond PRIVATE
+
+static const char PACKED_INDEX_MAGIC[8] = { 'Q', 'G', 'S', 'P', 'I', 'D', 'X', '\0' };
+static const quint32 PACKED_INDEX_BYTE_ORDER = 0x01020304;
+static const quint32 PACKED_INDEX_VERSION = 1;
+
+//! Header of an index file, followed by the level starts, the node boxes and the feature ids
+struct QgsPackedIndexHeader
+{
+  char magic[8];
+  quint32 byteOrder;
+  quint32 version;
+  quint32 nodeSize;
+  quint32 levelCount;
+  qint64 count;
+  qint64 stamp;
+};
+
+struct QgsPackedIndexItem
+{
+  double box[4];
+  qint64 id;
+  quint32 hilbert;
+};
+
+struct QgsPackedIndexNearestEntry
+{
+  double distance;
+  int level;
+  int index;
+
+  bool operator>( const QgsPackedIndexNearestEntry &other ) const { return distance > other.distance; }
+};
+
+//! Returns the distance along the Hilbert curve filling a 65536 x 65536 grid of the cell x, y
+static quint32 hilbertIndex( quint32 x, quint32 y )
+{
+  quint32 d = 0;
+  for ( quint32 s = 1 << 15; s > 0; s >>= 1 )
+  {
+    const quint32 rx = ( x & s ) ? 1 : 0;
+    const quint32 ry = ( y & s ) ? 1 : 0;
+    d += s * s * ( ( 3 * rx ) ^ ry );
+    if ( ry == 0 )
+    {
+      if ( rx == 1 )
+      {
+        x = 0xffff - x;
+        y = 0xffff - y;
+      }
+      std::swap( x, y );
+    }
+  }
+  return d;
+}
+
+static QVector< QgsPackedIndexItem > readItems( const QgsFeatureIterator &fi )
+{
+  QVector< QgsPackedIndexItem > items;
+  QgsFeatureIterator it( fi );
+  QgsFeature f;
+  while ( it.nextFeature( f ) )
+  {
+    if ( !f.hasGeometry() )
+      continue;
+
+    const QgsRectangle bbox = f.geometry().boundingBox();
+    QgsPackedIndexItem item;
+    item.box[0] = bbox.xMinimum();
+    item.box[1] = bbox.yMinimum();
+    item.box[2] = bbox.xMaximum();
+    item.box[3] = bbox.yMaximum();
+    item.id = f.id();
+    items << item;
+  }
+  return items;
+}
+
+//! Below this number of features the tree is built by the calling thread only
+static const int PARALLEL_PACKING_MINIMUM_ITEMS = 100000;
+
+//! Range of items or nodes processed by one task
+struct QgsPackedIndexRange
+{
+  int start;
+  int end;
+};
+
+//! Splits count items into ranges of at least minimumSize items, one per thread if possible
+static QVector< QgsPackedIndexRange > splitRanges( int count, int minimumSize )
+{
+  const int threads = std::max( 1, QThread::idealThreadCount() );
+  const int size = std::max( minimumSize, ( count + threads - 1 ) / threads );
+  QVector< QgsPackedIndexRange > ranges;
+  for ( int start = 0; start < count; start += size )
+    ranges.append( { start, std::min( start + size, count ) } );
+  return ranges;
+}
+
+//! Merge of the sorted ranges [start, middle) and [middle, end)
+struct QgsPackedIndexMerge
+{
+  int start;
+  int middle;
+  int end;
+};
+
+static bool itemLessThan( const QgsPackedIndexItem &a, const QgsPackedIndexItem &b )
+{
+  return a.hilbert < b.hilbert || ( a.hilbert == b.hilbert && a.id < b.id );
+}
+
+/**
+ * Sorts the items along a Hilbert curve and builds the levels of the tree: level 0
+ * holds the features, each upper level the boxes of groups of nodeSize nodes below.
+ * Large trees are built by all threads: the items are sorted by ranges which are then
+ * merged, and the nodes of each level are computed by ranges.
+ */
+static void packItems( QVector< QgsPackedIndexItem > &items, const int nodeSize, std::vector< quint64 > &levelStart, std::vector< double > &boxes, std::vector< qint64 > &ids )
+{
+  const int count = items.count();
+  levelStart.clear();
+  boxes.clear();
+  ids.clear();
+  levelStart.push_back( 0 );
+  if ( count == 0 )
+    return;
+
+  const int minimumRange = count < PARALLEL_PACKING_MINIMUM_ITEMS ? count : PARALLEL_PACKING_MINIMUM_ITEMS / 4;
+  QVector< QgsPackedIndexRange > ranges = splitRanges( count, minimumRange );
+  QgsPackedIndexItem *data = items.data();
+
+  double extent[4] = { DBL_MAX, DBL_MAX, -DBL_MAX, -DBL_MAX };
+  for ( int i = 0; i < count; ++i )
+  {
+    const double *box = data[i].box;
+    extent[0] = std::min( extent[0], box[0] );
+    extent[1] = std::min( extent[1], box[1] );
+    extent[2] = std::max( extent[2], box[2] );
+    extent[3] = std::max( extent[3], box[3] );
+  }
+  const double scaleX = extent[2] > extent[0] ? 0xffff / ( extent[2] - extent[0] ) : 0.0;
+  const double scaleY = extent[3] > extent[1] ? 0xffff / ( extent[3] - extent[1] ) : 0.0;
+
+  // Hilbert keys and sort of each range
+  QtConcurrent::blockingMap( ranges, [ = ]( const QgsPackedIndexRange & range )
+  {
+    for ( int i = range.start; i < range.end; ++i )
+    {
+      QgsPackedIndexItem &item = data[i];
+      const double x = ( ( item.box[0] + item.box[2] ) / 2 - extent[0] ) * scaleX;
+      const double y = ( ( item.box[1] + item.box[3] ) / 2 - extent[1] ) * scaleY;
+      item.hilbert = hilbertIndex( static_cast< quint32 >( qBound( 0.0, x, 65535.0 ) ), static_cast< quint32 >( qBound( 0.0, y, 65535.0 ) ) );
+    }
+    std::sort( data + range.start, data + range.end, itemLessThan );
+  } );
+
+  // merge sorted ranges two by two until a single one remains
+  while ( ranges.count() > 1 )
+  {
+    QVector< QgsPackedIndexRange > merged;
+    QVector< QgsPackedIndexMerge > merges;
+    for ( int i = 0; i + 1 < ranges.count(); i += 2 )
+    {
+      merged.append( { ranges.at( i ).start, ranges.at( i + 1 ).end } );
+      merges.append( { ranges.at( i ).start, ranges.at( i ).end, ranges.at( i + 1 ).end } );
+    }
+    if ( ranges.count() % 2 )
+      merged.append( ranges.last() );
+
+    QtConcurrent::blockingMap( merges, [ = ]( const QgsPackedIndexMerge & merge )
+    {
+      std::inplace_merge( data + merge.start, data + merge.middle, data + merge.end, itemLessThan );
+    } );
+    ranges = merged;
+  }
+
+  quint64 levelSize = count;
+  while ( true )
+  {
+    levelStart.push_back( levelStart.back() + levelSize );
+    if ( levelSize == 1 )
+      break;
+    levelSize = ( levelSize + nodeSize - 1 ) / nodeSize;
+  }
+
+  boxes.resize( 4 * levelStart.back() );
+  ids.resize( count );
+  double *boxData = boxes.data();
+  qint64 *idData = ids.data();
+  ranges = splitRanges( count, minimumRange );
+  QtConcurrent::blockingMap( ranges, [ = ]( const QgsPackedIndexRange & range )
+  {
+    for ( int i = range.start; i < range.end; ++i )
+    {
+      std::copy( data[i].box, data[i].box + 4, boxData + 4 * i );
+      idData[i] = data[i].id;
+    }
+  } );
+
+  for ( size_t level = 1; level + 1 < levelStart.size(); ++level )
+  {
+    const quint64 childStart = levelStart[level - 1];
+    const quint64 childCount = levelStart[level] - childStart;
+    const quint64 nodeStart = levelStart[level];
+    const int nodeCount = static_cast< int >( levelStart[level + 1] - nodeStart );
+    ranges = splitRanges( nodeCount, std::max( 1, minimumRange / nodeSize ) );
+    QtConcurrent::blockingMap( ranges, [ = ]( const QgsPackedIndexRange & range )
+    {
+      for ( int node = range.start; node < range.end; ++node )
+      {
+        double *box = boxData + 4 * ( nodeStart + node );
+        box[0] = box[1] = DBL_MAX;
+        box[2] = box[3] = -DBL_MAX;
+        const quint64 lastChild = std::min< quint64 >( static_cast< quint64 >( node + 1 ) * nodeSize, childCount );
+        for ( quint64 child = static_cast< quint64 >( node ) * nodeSize; child < lastChild; ++child )
+        {
+          const double *childBox = boxData + 4 * ( childStart + child );
+          box[0] = std::min( box[0], childBox[0] );
+          box[1] = std::min( box[1], childBox[1] );
+          box[2] = std::max( box[2], childBox[2] );
+          box[3] = std::max( box[3], childBox[3] );
+        }
+      }
+    } );
+  }
+}
+
+///@endcond
+
+bool QgsPackedSpatialIndex::write( const QString &fileName, const QgsFeatureIterator &fi, qint64 stamp )
+{
+  QVector< QgsPackedIndexItem > items = readItems( fi );
+  std::vector< quint64 > levelStart;
+  std::vector< double > boxes;
+  std::vector< qint64 > ids;
+  packItems( items, NODE_SIZE, levelStart, boxes, ids );
+
+  QgsPackedIndexHeader header;
+  memcpy( header.magic, PACKED_INDEX_MAGIC, sizeof( header.magic ) );
+  header.byteOrder = PACKED_INDEX_BYTE_ORDER;
+  header.version = PACKED_INDEX_VERSION;
+  header.nodeSize = NODE_SIZE;
+  header.levelCount = static_cast< quint32 >( levelStart.size() - 1 );
+  header.count = items.count();
+  header.stamp = stamp;
+
+  QSaveFile file( fileName );
+  if ( !file.open( QIODevice::WriteOnly ) )
+  {
+    QgsDebugMsg( QString( "Cannot write spatial index file %1: %2" ).arg( fileName, file.errorString() ) );
+    return false;
+  }
+
+  file.write( reinterpret_cast< const char * >( &header ), sizeof( header ) );
+  file.write( reinterpret_cast< const char * >( levelStart.data() ), levelStart.size() * sizeof( quint64 ) );
+  file.write( reinterpret_cast< const char * >( boxes.data() ), boxes.size() * sizeof( double ) );
+  file.write( reinterpret_cast< const char * >( ids.data() ), ids.size() * sizeof( qint64 ) );
+  return file.commit();
+}
+
+bool QgsPackedSpatialIndex::build( const QgsFeatureIterator &fi )
+{
+  clear();
+
+  QVector< QgsPackedIndexItem > items = readItems( fi );
+  packItems( items, NODE_SIZE, mBuiltLevelStart, mBuiltBoxes, mBuiltIds );
+
+  mLevelStart = mBuiltLevelStart.data();
+  mBoxes = mBuiltBoxes.data();
+  mIds = mBuiltIds.data();
+  mLevelCount = static_cast< int >( mBuiltLevelStart.size() - 1 );
+  mCount = items.count();
+  mValid = true;
+  return true;
+}
+
+void QgsPackedSpatialIndex::clear()
+{
+  mFile.reset();
+  mBuiltLevelStart.clear();
+  mBuiltBoxes.clear();
+  mBuiltIds.clear();
+  mValid = false;
+  mStamp = 0;
+  mCount = 0;
+  mLevelCount = 0;
+  mLevelStart = nullptr;
+  mBoxes = nullptr;
+  mIds = nullptr;
+}
+
+bool QgsPackedSpatialIndex::open( const QString &fileName )
+{
+  clear();
+
+  std::unique_ptr< QFile > file( new QFile( fileName ) );
+  if ( !file->open( QIODevice::ReadOnly ) )
+    return false;
+
+  const qint64 size = file->size();
+  if ( size < static_cast< qint64 >( sizeof( QgsPackedIndexHeader ) ) )
+    return false;
+
+  const uchar *data = file->map( 0, size );
+  if ( !data )
+    return false;
+
+  QgsPackedIndexHeader header;
+  memcpy( &header, data, sizeof( header ) );
+  if ( memcmp( header.magic, PACKED_INDEX_MAGIC, sizeof( header.magic ) ) != 0
+       || header.byteOrder != PACKED_INDEX_BYTE_ORDER
+       || header.version != PACKED_INDEX_VERSION
+       || header.nodeSize != static_cast< quint32 >( NODE_SIZE )
+       || header.count < 0 || header.count > std::numeric_limits<int>::max()
+       || header.levelCount > 64 )
+  {
+    QgsDebugMsg( QString( "%1 is not a valid spatial index file" ).arg( fileName ) );
+    return false;
+  }
+
+  qint64 offset = sizeof( header );
+  if ( size < offset + static_cast< qint64 >( ( header.levelCount + 1 ) * sizeof( quint64 ) ) )
+    return false;
+  const quint64 *levelStart = reinterpret_cast< const quint64 * >( data + offset );
+  offset += ( header.levelCount + 1 ) * sizeof( quint64 );
+
+  // check the tree shape before using the file
+  if ( levelStart[0] != 0 || ( header.levelCount == 0 ) != ( header.count == 0 ) )
+    return false;
+  quint64 expectedSize = header.count;
+  for ( quint32 level = 0; level < header.levelCount; ++level )
+  {
+    if ( levelStart[level + 1] - levelStart[level] != expectedSize )
+      return false;
+    expectedSize = ( expectedSize + NODE_SIZE - 1 ) / NODE_SIZE;
+  }
+  if ( header.levelCount > 0 && levelStart[header.levelCount] - levelStart[header.levelCount - 1] != 1 )
+    return false;
+
+  const quint64 nodeCount = levelStart[header.levelCount];
+  if ( static_cast< quint64 >( size ) != offset + nodeCount * 4 * sizeof( double ) + header.count * sizeof( qint64 ) )
+    return false;
+
+  mBoxes = reinterpret_cast< const double * >( data + offset );
+  offset += nodeCount * 4 * sizeof( double );
+  mIds = reinterpret_cast< const qint64 * >( data + offset );
+  mLevelStart = levelStart;
+  mLevelCount = static_cast< int >( header.levelCount );
+  mCount = static_cast< int >( header.count );
+  mStamp = header.stamp;
+  mFile = std::move( file );
+  mValid = true;
+  return true;
+}
+
+QgsRectangle QgsPackedSpatialIndex::boundingBox( int index ) const
+{
+  const double *box = mBoxes + 4 * index;
+  return QgsRectangle( box[0], box[1], box[2], box[3] );
+}
+
+bool QgsPackedSpatialIndex::nodeIntersects( quint64 node, const QgsRectangle &rect ) const
+{
+  const double *box = mBoxes + 4 * node;
+  return !( box[0] > rect.xMaximum() || box[2] < rect.xMinimum() || box[1] > rect.yMaximum() || box[3] < rect.yMinimum() );
+}
+
+double QgsPackedSpatialIndex::nodeDistance( quint64 node, const QgsPoint &point ) const
+{
+  const double *box = mBoxes + 4 * node;
+  const double dx = std::max( std::max( box[0] - point.x(), 0.0 ), point.x() - box[2] );
+  const double dy = std::max( std::max( box[1] - point.y(), 0.0 ), point.y() - box[3] );
+  return std::sqrt( dx * dx + dy * dy );
+}
+
+QList<QgsFeatureId> QgsPackedSpatialIndex::intersects( const QgsRectangle &rect ) const
+{
+  QList<QgsFeatureId> list;
+  if ( !mValid || mCount == 0 )
+    return list;
+
+  // level and index within the level of the nodes left to visit. Each visited node
+  // adds at most NODE_SIZE entries for the level below and trees of int sized feature
+  // counts have less than 16 levels, so the stack never outgrows this array
+  QPair< int, int > stack[16 * NODE_SIZE];
+  int stackSize = 0;
+  stack[stackSize++] = qMakePair( mLevelCount - 1, 0 );
+  while ( stackSize > 0 )
+  {
+    const QPair< int, int > node = stack[--stackSize];
+    if ( !nodeIntersects( mLevelStart[node.first] + node.second, rect ) )
+      continue;
+
+    if ( node.first == 0 )
+    {
+      list << mIds[node.second];
+      continue;
+    }
+
+    const int firstChild = node.second * NODE_SIZE;
+    const int lastChild = std::min( firstChild + NODE_SIZE, levelSize( node.first - 1 ) );
+    for ( int child = firstChild; child < lastChild; ++child )
+      stack[stackSize++] = qMakePair( node.first - 1, child );
+  }
+  return list;
+}
+
+QList<QgsFeatureId> QgsPackedSpatialIndex::nearestNeighbor( const QgsPoint &point, int neighbors ) const
+{
+  QList<QgsFeatureId> list;
+  if ( !mValid || mCount == 0 )
+    return list;
+
+  std::priority_queue< QgsPackedIndexNearestEntry, std::vector< QgsPackedIndexNearestEntry >, std::greater< QgsPackedIndexNearestEntry > > queue;
+  queue.push( { nodeDistance( mLevelStart[mLevelCount - 1], point ), mLevelCount - 1, 0 } );
+
+  double farthest = 0.0;
+  while ( !queue.empty() )
+  {
+    const QgsPackedIndexNearestEntry entry = queue.top();
+
+    // features at the same distance as the farthest neighbor are returned too
+    if ( list.count() >= neighbors && entry.distance > farthest )
+      break;
+    queue.pop();
+
+    if ( entry.level == 0 )
+    {
+      list << mIds[entry.index];
+      farthest = entry.distance;
+      continue;
+    }
+
+    const int firstChild = entry.index * NODE_SIZE;
+    const int lastChild = std::min( firstChild + NODE_SIZE, levelSize( entry.level - 1 ) );
+    for ( int child = firstChild; child < lastChild; ++child )
+      queue.push( { nodeDistance( mLevelStart[entry.level - 1] + child, point ), entry.level - 1, child } );
+  }
+  return list;
+}
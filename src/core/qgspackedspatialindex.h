@@ -0,0 +1,140 @@
+/***************************************************************************
+  qgspackedspatialindex.h
+  --------------------------------------
+  Date                 : February 2017
+  Copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSPACKEDSPATIALINDEX_H
+#define QGSPACKEDSPATIALINDEX_H
+
+#include "qgis_core.h"
+#include "qgsfeature.h"
+#include "qgsrectangle.h"
+
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <memory>
+#include <vector>
+
+class QgsFeatureIterator;
+class QgsPoint;
+
+/** \ingroup core
+ * \class QgsPackedSpatialIndex
+ * \brief Read-only packed R-tree, built in memory or stored in a file which is memory mapped when opened.
+ *
+ * The features are sorted along a Hilbert curve and grouped by NODE_SIZE into the
+ * nodes of the tree, which are stored level by level from the features up to the root
+ * in flat arrays, the children of a node following each other. Queries therefore need
+ * no pointer chasing, and the file can be used as is, without any parsing, the mapped
+ * pages being shared by all the processes which open the same file.
+ *
+ * Index files are written with write() and depend on the byte order of the machine
+ * which wrote them, an index file written on a machine with another byte order is
+ * rejected by open().
+ *
+ * \note not available in Python bindings, use QgsSpatialIndex::fromIndexFile()
+ * \note added in QGIS 3.0
+ */
+class CORE_EXPORT QgsPackedSpatialIndex
+{
+  public:
+
+    //! Number of children of each node of the tree
+    static const int NODE_SIZE = 16;
+
+    //! Creates an index which is not valid until a file is opened
+    QgsPackedSpatialIndex() = default;
+
+    //! QgsPackedSpatialIndex cannot be copied
+    QgsPackedSpatialIndex( const QgsPackedSpatialIndex &other ) = delete;
+    //! QgsPackedSpatialIndex cannot be copied
+    QgsPackedSpatialIndex &operator=( const QgsPackedSpatialIndex &other ) = delete;
+
+    /**
+     * Builds the index of the features of the iterator and writes it to a file.
+     * Features without geometry are skipped. The file is replaced atomically,
+     * so that other processes never open a partially written index.
+     * @param fileName name of the index file
+     * @param fi features to index
+     * @param stamp value stored in the file, e.g. the modification time of the
+     * indexed data, see stamp()
+     * @returns true if the file was written
+     */
+    static bool write( const QString &fileName, const QgsFeatureIterator &fi, qint64 stamp = 0 );
+
+    /**
+     * Builds the index of the features of the iterator in memory, replacing any open file.
+     * Features without geometry are skipped.
+     * @returns true if the index was built
+     */
+    bool build( const QgsFeatureIterator &fi );
+
+    /**
+     * Opens an index file created with write() and maps it into memory.
+     * @returns true if the file is a valid index
+     */
+    bool open( const QString &fileName );
+
+    //! Returns true if an index file is open
+    bool isValid() const { return mValid; }
+
+    //! Returns the stamp value the index file was written with
+    qint64 stamp() const { return mStamp; }
+
+    //! Returns the number of indexed features
+    int count() const { return mCount; }
+
+    //! Returns the bounding box of the feature at \a index, between 0 and count() - 1
+    QgsRectangle boundingBox( int index ) const;
+
+    //! Returns the id of the feature at \a index, between 0 and count() - 1
+    QgsFeatureId id( int index ) const { return mIds[index]; }
+
+    //! Returns features whose bounding box intersects the specified rectangle
+    QList<QgsFeatureId> intersects( const QgsRectangle &rect ) const;
+
+    /**
+     * Returns the features nearest to a point, by distance to their bounding box.
+     * More than \a neighbors features are returned if several are at the distance
+     * of the farthest one.
+     */
+    QList<QgsFeatureId> nearestNeighbor( const QgsPoint &point, int neighbors ) const;
+
+  private:
+
+    std::unique_ptr< QFile > mFile;
+
+    //! Storage of an index built in memory
+    std::vector< quint64 > mBuiltLevelStart;
+    std::vector< double > mBuiltBoxes;
+    std::vector< qint64 > mBuiltIds;
+
+    bool mValid = false;
+    qint64 mStamp = 0;
+    int mCount = 0;
+    int mLevelCount = 0;
+
+    //! Index of the first node of each level in mBoxes, plus the total number of nodes
+    const quint64 *mLevelStart = nullptr;
+    //! Bounding boxes of all nodes (xmin, ymin, xmax, ymax), level 0 holds the features
+    const double *mBoxes = nullptr;
+    //! Ids of the features, in the order of level 0
+    const qint64 *mIds = nullptr;
+
+    void clear();
+    bool nodeIntersects( quint64 node, const QgsRectangle &rect ) const;
+    double nodeDistance( quint64 node, const QgsPoint &point ) const;
+    int levelSize( int level ) const { return static_cast< int >( mLevelStart[level + 1] - mLevelStart[level] ); }
+};
+
+#endif // QGSPACKEDSPATIALINDEX_H
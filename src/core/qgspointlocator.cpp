@@ -14,16 +14,23 @@
  ***************************************************************************/
 
 #include "qgspointlocator.h"
+#include "qgspointlocator_p.h"
 
+#include "qgsapplication.h"
 #include "qgsfeatureiterator.h"
+#include "qgsfeedback.h"
 #include "qgsgeometry.h"
+#include "qgsgeometryutils.h"
+#include "qgstaskmanager.h"
 #include "qgsvectorlayer.h"
+#include "qgsvectorlayerfeatureiterator.h"
 #include "qgswkbptr.h"
 #include "qgis.h"
 #include "qgslogger.h"
 
 #include <SpatialIndex.h>
 
+#include <QEventLoop>
 #include <QLinkedListIterator>
 
 using namespace SpatialIndex;
@@ -101,10 +108,9 @@ class QgsPointLocator_VisitorNearestVertex : public IVisitor
     void visitData( const IData &d ) override
     {
       QgsFeatureId id = d.getIdentifier();
-      QgsGeometry *geom = mLocator->mGeoms.value( id );
-      int vertexIndex, beforeVertex, afterVertex;
-      double sqrDist;
-      QgsPoint pt = geom->closestVertex( mSrcPoint, vertexIndex, beforeVertex, afterVertex, sqrDist );
+      int vertexIndex;
+      QgsPoint pt;
+      double sqrDist = mLocator->mIndex->geometries().closestVertex( id, mSrcPoint, pt, vertexIndex );
       if ( sqrDist < 0 )
         return;  // probably empty geometry
 
@@ -148,16 +154,13 @@ class QgsPointLocator_VisitorNearestEdge : public IVisitor
     void visitData( const IData &d ) override
     {
       QgsFeatureId id = d.getIdentifier();
-      QgsGeometry *geom = mLocator->mGeoms.value( id );
       QgsPoint pt;
       int afterVertex;
-      double sqrDist = geom->closestSegmentWithContext( mSrcPoint, pt, afterVertex, nullptr, POINT_LOC_EPSILON );
+      QgsPoint edgePoints[2];
+      double sqrDist = mLocator->mIndex->geometries().closestSegment( id, mSrcPoint, pt, afterVertex, edgePoints );
       if ( sqrDist < 0 )
         return;
 
-      QgsPoint edgePoints[2];
-      edgePoints[0] = geom->vertexAt( afterVertex - 1 );
-      edgePoints[1] = geom->vertexAt( afterVertex );
       QgsPointLocator::Match m( QgsPointLocator::Edge, mLocator->mLayer, id, sqrt( sqrDist ), pt, afterVertex - 1, edgePoints );
       // in range queries the filter may reject some matches
       if ( mFilter && !mFilter->acceptMatch( m ) )
@@ -189,6 +192,7 @@ class QgsPointLocator_VisitorArea : public IVisitor
     QgsPointLocator_VisitorArea( QgsPointLocator *pl, const QgsPoint &origPt, QgsPointLocator::MatchList &list )
       : mLocator( pl )
       , mList( list )
+      , mPt( origPt )
       , mGeomPt( QgsGeometry::fromPoint( origPt ) )
     {}
 
@@ -198,13 +202,13 @@ class QgsPointLocator_VisitorArea : public IVisitor
     void visitData( const IData &d ) override
     {
       QgsFeatureId id = d.getIdentifier();
-      QgsGeometry *g = mLocator->mGeoms.value( id );
-      if ( g->intersects( mGeomPt ) )
+      if ( mLocator->mIndex->geometries().containsPoint( id, mPt, mGeomPt ) )
         mList << QgsPointLocator::Match( QgsPointLocator::Area, mLocator->mLayer, id, 0, QgsPoint() );
     }
   private:
     QgsPointLocator *mLocator = nullptr;
     QgsPointLocator::MatchList &mList;
+    QgsPoint mPt;
     QgsGeometry mGeomPt;
 };
 
@@ -320,7 +324,7 @@ struct _CohenSutherland
 };
 
 
-static QgsPointLocator::MatchList _geometrySegmentsInRect( QgsGeometry *geom, const QgsRectangle &rect, QgsVectorLayer *vl, QgsFeatureId fid )
+static QgsPointLocator::MatchList _geometrySegmentsInRect( const QgsGeometry *geom, const QgsRectangle &rect, QgsVectorLayer *vl, QgsFeatureId fid )
 {
   // this code is stupidly based on QgsGeometry::closestSegmentWithContext
   // we need iterator for segments...
@@ -539,9 +543,8 @@ class QgsPointLocator_VisitorEdgesInRect : public IVisitor
     void visitData( const IData &d ) override
     {
       QgsFeatureId id = d.getIdentifier();
-      QgsGeometry *geom = mLocator->mGeoms.value( id );
 
-      Q_FOREACH ( const QgsPointLocator::Match &m, _geometrySegmentsInRect( geom, mSrcRect, mLocator->mLayer, id ) )
+      Q_FOREACH ( const QgsPointLocator::Match &m, mLocator->mIndex->geometries().segmentsInRect( id, mSrcRect, mLocator->mLayer ) )
       {
         // in range queries the filter may reject some matches
         if ( mFilter && !mFilter->acceptMatch( m ) )
@@ -613,108 +616,337 @@ class QgsPointLocator_DumpTree : public SpatialIndex::IQueryStrategy
 ////////////////////////////////////////////////////////////////////////////
 
 
-QgsPointLocator::QgsPointLocator( QgsVectorLayer *layer, const QgsCoordinateReferenceSystem &destCRS, const QgsRectangle *extent )
-  : mStorage( nullptr )
-  , mRTree( nullptr )
-  , mIsEmptyLayer( false )
-  , mLayer( layer )
-  , mExtent( nullptr )
-{
-  if ( destCRS.isValid() )
-  {
-    mTransform = QgsCoordinateTransform( layer->crs(), destCRS );
-  }
+////////////////////////////////////////////////////////////////////////////
 
-  setExtent( extent );
+///@cond PRIVATE
 
-  mStorage = StorageManager::createNewMemoryStorageManager();
+QgsPointLocatorGeometryStore::QgsPointLocatorGeometryStore( bool compact )
+  : mCompact( compact )
+{
+}
 
-  connect( mLayer, SIGNAL( featureAdded( QgsFeatureId ) ), this, SLOT( onFeatureAdded( QgsFeatureId ) ) );
-  connect( mLayer, SIGNAL( featureDeleted( QgsFeatureId ) ), this, SLOT( onFeatureDeleted( QgsFeatureId ) ) );
-  connect( mLayer, SIGNAL( geometryChanged( QgsFeatureId, const QgsGeometry & ) ), this, SLOT( onGeometryChanged( QgsFeatureId, const QgsGeometry & ) ) );
-  connect( mLayer, &QgsVectorLayer::dataChanged, this, &QgsPointLocator::destroyIndex );
+QgsPointLocatorGeometryStore::~QgsPointLocatorGeometryStore()
+{
+  qDeleteAll( mGeometries );
 }
 
+void QgsPointLocatorGeometryStore::insert( QgsFeatureId fid, const QgsGeometry &geometry )
+{
+  remove( fid );
+  if ( mCompact && insertCompact( fid, geometry ) )
+    return;
 
-QgsPointLocator::~QgsPointLocator()
+  mGeometries.insert( fid, new QgsGeometry( geometry ) );
+}
+
+bool QgsPointLocatorGeometryStore::insertCompact( QgsFeatureId fid, const QgsGeometry &geometry )
 {
-  destroyIndex();
-  delete mStorage;
-  delete mExtent;
+  const QgsAbstractGeometry *g = geometry.geometry();
+  if ( !g || QgsWkbTypes::isCurvedType( g->wkbType() ) )
+    return false;
+
+  CompactGeometry compact;
+  compact.type = geometry.type();
+  compact.firstVertex = mCoordinates.size() / 2;
+  compact.firstSequence = mSequences.size();
+
+  // a new sequence starts with each part and each ring
+  QgsVertexId id;
+  QgsVertexId previous;
+  QgsPointV2 vertex;
+  while ( g->nextVertex( id, vertex ) )
+  {
+    if ( mSequences.size() == compact.firstSequence || id.part != previous.part || id.ring != previous.ring )
+    {
+      Sequence sequence;
+      sequence.vertexCount = 0;
+      sequence.exteriorRing = compact.type == QgsWkbTypes::PolygonGeometry && id.ring == 0;
+      mSequences << sequence;
+    }
+    ++mSequences.last().vertexCount;
+    mCoordinates << vertex.x() << vertex.y();
+    previous = id;
+  }
+
+  compact.vertexCount = mCoordinates.size() / 2 - compact.firstVertex;
+  compact.sequenceCount = mSequences.size() - compact.firstSequence;
+  mCompactGeometries.insert( fid, compact );
+  return true;
 }
 
-QgsCoordinateReferenceSystem QgsPointLocator::destinationCrs() const
+void QgsPointLocatorGeometryStore::remove( QgsFeatureId fid )
 {
-  return mTransform.isValid() ? mTransform.destinationCrs() : QgsCoordinateReferenceSystem();
+  if ( QgsGeometry *geometry = mGeometries.take( fid ) )
+  {
+    delete geometry;
+    return;
+  }
+
+  QHash< QgsFeatureId, CompactGeometry >::iterator it = mCompactGeometries.find( fid );
+  if ( it == mCompactGeometries.end() )
+    return;
+
+  // the vertices stay in the buffer until enough of them are unused
+  mGarbageVertices += it->vertexCount;
+  mCompactGeometries.erase( it );
+  if ( mGarbageVertices > 4096 && mGarbageVertices > mCoordinates.size() / 4 )
+    collectGarbage();
 }
 
-void QgsPointLocator::setExtent( const QgsRectangle *extent )
+void QgsPointLocatorGeometryStore::collectGarbage()
 {
-  if ( extent )
+  QVector< double > coordinates;
+  coordinates.reserve( mCoordinates.size() - 2 * mGarbageVertices );
+  QVector< Sequence > sequences;
+  sequences.reserve( mSequences.size() );
+
+  for ( QHash< QgsFeatureId, CompactGeometry >::iterator it = mCompactGeometries.begin(); it != mCompactGeometries.end(); ++it )
   {
-    mExtent = new QgsRectangle( *extent );
+    const int firstVertex = coordinates.size() / 2;
+    const int firstSequence = sequences.size();
+    const double *vertices = mCoordinates.constData() + 2 * it->firstVertex;
+    for ( int i = 0; i < 2 * it->vertexCount; ++i )
+      coordinates << vertices[i];
+    for ( int i = 0; i < it->sequenceCount; ++i )
+      sequences << mSequences.at( it->firstSequence + i );
+    it->firstVertex = firstVertex;
+    it->firstSequence = firstSequence;
   }
 
-  destroyIndex();
+  mCoordinates = coordinates;
+  mSequences = sequences;
+  mGarbageVertices = 0;
 }
 
+void QgsPointLocatorGeometryStore::clear()
+{
+  qDeleteAll( mGeometries );
+  mGeometries.clear();
+  mCompactGeometries.clear();
+  mCoordinates.clear();
+  mSequences.clear();
+  mGarbageVertices = 0;
+}
 
-bool QgsPointLocator::init( int maxFeaturesToIndex )
+bool QgsPointLocatorGeometryStore::contains( QgsFeatureId fid ) const
 {
-  return hasIndex() ? true : rebuildIndex( maxFeaturesToIndex );
+  return mGeometries.contains( fid ) || mCompactGeometries.contains( fid );
 }
 
+int QgsPointLocatorGeometryStore::count() const
+{
+  return mGeometries.count() + mCompactGeometries.count();
+}
 
-bool QgsPointLocator::hasIndex() const
+QgsRectangle QgsPointLocatorGeometryStore::boundingBox( QgsFeatureId fid ) const
 {
-  return mRTree || mIsEmptyLayer;
+  if ( const QgsGeometry *geometry = mGeometries.value( fid ) )
+    return geometry->boundingBox();
+
+  const CompactGeometry compact = mCompactGeometries.value( fid );
+  if ( compact.vertexCount == 0 )
+    return QgsRectangle();
+
+  const double *vertices = mCoordinates.constData() + 2 * compact.firstVertex;
+  QgsRectangle rect( vertices[0], vertices[1], vertices[0], vertices[1] );
+  for ( int i = 1; i < compact.vertexCount; ++i )
+    rect.combineExtentWith( vertices[2 * i], vertices[2 * i + 1] );
+  return rect;
 }
 
+double QgsPointLocatorGeometryStore::closestVertex( QgsFeatureId fid, const QgsPoint &point, QgsPoint &vertex, int &vertexIndex ) const
+{
+  if ( const QgsGeometry *geometry = mGeometries.value( fid ) )
+  {
+    int beforeVertex, afterVertex;
+    double sqrDist;
+    vertex = geometry->closestVertex( point, vertexIndex, beforeVertex, afterVertex, sqrDist );
+    return sqrDist;
+  }
 
-bool QgsPointLocator::rebuildIndex( int maxFeaturesToIndex )
+  const CompactGeometry compact = mCompactGeometries.value( fid );
+  const double *vertices = mCoordinates.constData() + 2 * compact.firstVertex;
+  double minSqrDist = -1;
+  for ( int i = 0; i < compact.vertexCount; ++i )
+  {
+    const double dx = vertices[2 * i] - point.x();
+    const double dy = vertices[2 * i + 1] - point.y();
+    const double sqrDist = dx * dx + dy * dy;
+    if ( minSqrDist < 0 || sqrDist < minSqrDist )
+    {
+      minSqrDist = sqrDist;
+      vertexIndex = i;
+    }
+  }
+  if ( minSqrDist >= 0 )
+    vertex.set( vertices[2 * vertexIndex], vertices[2 * vertexIndex + 1] );
+  return minSqrDist;
+}
+
+double QgsPointLocatorGeometryStore::closestSegment( QgsFeatureId fid, const QgsPoint &point, QgsPoint &segmentPoint, int &afterVertex, QgsPoint *edgePoints ) const
 {
-  destroyIndex();
+  if ( const QgsGeometry *geometry = mGeometries.value( fid ) )
+  {
+    double sqrDist = geometry->closestSegmentWithContext( point, segmentPoint, afterVertex, nullptr, POINT_LOC_EPSILON );
+    if ( sqrDist >= 0 )
+    {
+      edgePoints[0] = geometry->vertexAt( afterVertex - 1 );
+      edgePoints[1] = geometry->vertexAt( afterVertex );
+    }
+    return sqrDist;
+  }
 
-  QLinkedList<RTree::Data *> dataList;
-  QgsFeature f;
-  QgsWkbTypes::GeometryType geomType = mLayer->geometryType();
-  if ( geomType == QgsWkbTypes::NullGeometry )
-    return true; // nothing to index
+  const CompactGeometry compact = mCompactGeometries.value( fid );
+  if ( compact.type == QgsWkbTypes::PointGeometry )
+    return -1;
 
-  QgsFeatureRequest request;
-  request.setSubsetOfAttributes( QgsAttributeList() );
-  if ( mExtent )
+  const double *vertices = mCoordinates.constData() + 2 * compact.firstVertex;
+  double minSqrDist = -1;
+  int firstVertex = 0;
+  for ( int s = 0; s < compact.sequenceCount; ++s )
   {
-    QgsRectangle rect = *mExtent;
-    if ( mTransform.isValid() )
+    const int vertexCount = mSequences.at( compact.firstSequence + s ).vertexCount;
+    for ( int i = firstVertex + 1; i < firstVertex + vertexCount; ++i )
     {
-      try
+      double x, y;
+      const double sqrDist = QgsGeometryUtils::sqrDistToLine( point.x(), point.y(), vertices[2 * i - 2], vertices[2 * i - 1],
+                             vertices[2 * i], vertices[2 * i + 1], x, y, POINT_LOC_EPSILON );
+      if ( minSqrDist < 0 || sqrDist < minSqrDist )
       {
-        rect = mTransform.transformBoundingBox( rect, QgsCoordinateTransform::ReverseTransform );
+        minSqrDist = sqrDist;
+        segmentPoint.set( x, y );
+        afterVertex = i;
       }
-      catch ( const QgsException &e )
+    }
+    firstVertex += vertexCount;
+  }
+
+  if ( minSqrDist >= 0 )
+  {
+    edgePoints[0].set( vertices[2 * afterVertex - 2], vertices[2 * afterVertex - 1] );
+    edgePoints[1].set( vertices[2 * afterVertex], vertices[2 * afterVertex + 1] );
+  }
+  return minSqrDist;
+}
+
+bool QgsPointLocatorGeometryStore::containsPoint( QgsFeatureId fid, const QgsPoint &point, const QgsGeometry &pointGeometry ) const
+{
+  if ( const QgsGeometry *geometry = mGeometries.value( fid ) )
+    return geometry->intersects( pointGeometry );
+
+  const CompactGeometry compact = mCompactGeometries.value( fid );
+  if ( compact.type != QgsWkbTypes::PolygonGeometry )
+    return false;
+
+  // even-odd rule over the rings of each polygon, from the exterior ring to the next one
+  const double *vertices = mCoordinates.constData() + 2 * compact.firstVertex;
+  bool inside = false;
+  int firstVertex = 0;
+  for ( int s = 0; s < compact.sequenceCount; ++s )
+  {
+    const Sequence &sequence = mSequences.at( compact.firstSequence + s );
+    if ( sequence.exteriorRing )
+    {
+      if ( inside )
+        return true;
+    }
+
+    for ( int i = firstVertex, j = firstVertex + sequence.vertexCount - 1; i < firstVertex + sequence.vertexCount; j = i++ )
+    {
+      const double xi = vertices[2 * i];
+      const double yi = vertices[2 * i + 1];
+      const double xj = vertices[2 * j];
+      const double yj = vertices[2 * j + 1];
+      if ( ( yi > point.y() ) != ( yj > point.y() ) && point.x() < ( xj - xi ) * ( point.y() - yi ) / ( yj - yi ) + xi )
+        inside = !inside;
+    }
+    firstVertex += sequence.vertexCount;
+  }
+  return inside;
+}
+
+QgsPointLocator::MatchList QgsPointLocatorGeometryStore::segmentsInRect( QgsFeatureId fid, const QgsRectangle &rect, QgsVectorLayer *layer ) const
+{
+  if ( const QgsGeometry *geometry = mGeometries.value( fid ) )
+    return _geometrySegmentsInRect( geometry, rect, layer, fid );
+
+  QgsPointLocator::MatchList lst;
+  const CompactGeometry compact = mCompactGeometries.value( fid );
+  if ( compact.type == QgsWkbTypes::PointGeometry )
+    return lst;
+
+  _CohenSutherland cs( rect );
+  const double *vertices = mCoordinates.constData() + 2 * compact.firstVertex;
+  int firstVertex = 0;
+  for ( int s = 0; s < compact.sequenceCount; ++s )
+  {
+    const int vertexCount = mSequences.at( compact.firstSequence + s ).vertexCount;
+    for ( int i = firstVertex + 1; i < firstVertex + vertexCount; ++i )
+    {
+      if ( cs.isSegmentInRect( vertices[2 * i - 2], vertices[2 * i - 1], vertices[2 * i], vertices[2 * i + 1] ) )
       {
-        Q_UNUSED( e );
-        // See http://hub.qgis.org/issues/12634
-        QgsDebugMsg( QString( "could not transform bounding box to map, skipping the snap filter (%1)" ).arg( e.what() ) );
+        QgsPoint edgePoints[2];
+        edgePoints[0].set( vertices[2 * i - 2], vertices[2 * i - 1] );
+        edgePoints[1].set( vertices[2 * i], vertices[2 * i + 1] );
+        lst << QgsPointLocator::Match( QgsPointLocator::Edge, layer, fid, 0, QgsPoint(), i - 1, edgePoints );
       }
     }
-    request.setFilterRect( rect );
+    firstVertex += vertexCount;
   }
-  QgsFeatureIterator fi = mLayer->getFeatures( request );
+  return lst;
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+// R-Tree parameters
+static const double RTREE_FILL_FACTOR = 0.7;
+static const unsigned long RTREE_INDEX_CAPACITY = 10;
+static const unsigned long RTREE_LEAF_CAPACITY = 10;
+static const unsigned long RTREE_DIMENSION = 2;
+static const RTree::RTreeVariant RTREE_VARIANT = RTree::RV_RSTAR;
+
+QgsPointLocatorIndex::QgsPointLocatorIndex( bool compact )
+  : mStorage( StorageManager::createNewMemoryStorageManager() )
+  , mGeometries( compact )
+{
+}
+
+QgsPointLocatorIndex::~QgsPointLocatorIndex()
+{
+  // the tree uses the storage
+  mRTree.reset();
+}
+
+bool QgsPointLocatorIndex::build( QgsFeatureIterator &iterator, const QgsCoordinateTransform &transform, int maxFeaturesToIndex,
+                                  QgsFeedback *feedback, long featureCount )
+{
+  QLinkedList<RTree::Data *> dataList;
+  QgsFeature f;
   int indexedCount = 0;
-  while ( fi.nextFeature( f ) )
+  int readCount = 0;
+  while ( iterator.nextFeature( f ) )
   {
+    if ( feedback && ++readCount % 1000 == 0 )
+    {
+      if ( feedback->isCanceled() )
+      {
+        qDeleteAll( dataList );
+        mGeometries.clear();
+        return false;
+      }
+      if ( featureCount > 0 )
+        feedback->setProgress( 100.0 * readCount / featureCount );
+    }
+
     if ( !f.hasGeometry() )
       continue;
 
-    if ( mTransform.isValid() )
+    QgsGeometry geometry = f.geometry();
+    if ( transform.isValid() )
     {
       try
       {
-        QgsGeometry transformedGeometry = f.geometry();
-        transformedGeometry.transform( mTransform );
-        f.setGeometry( transformedGeometry );
+        geometry.transform( transform );
       }
       catch ( const QgsException &e )
       {
@@ -725,133 +957,405 @@ bool QgsPointLocator::rebuildIndex( int maxFeaturesToIndex )
       }
     }
 
-    SpatialIndex::Region r( rect2region( f.geometry().boundingBox() ) );
+    SpatialIndex::Region r( rect2region( geometry.boundingBox() ) );
     dataList << new RTree::Data( 0, nullptr, r, f.id() );
-
-    if ( mGeoms.contains( f.id() ) )
-      delete mGeoms.take( f.id() );
-    mGeoms[f.id()] = new QgsGeometry( f.geometry() );
+    mGeometries.insert( f.id(), geometry );
     ++indexedCount;
 
     if ( maxFeaturesToIndex != -1 && indexedCount > maxFeaturesToIndex )
     {
       qDeleteAll( dataList );
-      destroyIndex();
+      mGeometries.clear();
       return false;
     }
   }
 
-  // R-Tree parameters
-  double fillFactor = 0.7;
-  unsigned long indexCapacity = 10;
-  unsigned long leafCapacity = 10;
-  unsigned long dimension = 2;
-  RTree::RTreeVariant variant = RTree::RV_RSTAR;
-  SpatialIndex::id_type indexId;
-
   if ( dataList.isEmpty() )
-  {
-    mIsEmptyLayer = true;
     return true; // no features
-  }
 
+  SpatialIndex::id_type indexId;
   QgsPointLocator_Stream stream( dataList );
-  mRTree = RTree::createAndBulkLoadNewRTree( RTree::BLM_STR, stream, *mStorage, fillFactor, indexCapacity,
-           leafCapacity, dimension, variant, indexId );
+  mRTree.reset( RTree::createAndBulkLoadNewRTree( RTree::BLM_STR, stream, *mStorage, RTREE_FILL_FACTOR, RTREE_INDEX_CAPACITY,
+                RTREE_LEAF_CAPACITY, RTREE_DIMENSION, RTREE_VARIANT, indexId ) );
   return true;
 }
 
+void QgsPointLocatorIndex::insert( QgsFeatureId fid, const QgsGeometry &geometry )
+{
+  remove( fid );
 
-void QgsPointLocator::destroyIndex()
+  QgsRectangle bbox = geometry.boundingBox();
+  if ( bbox.isNull() )
+    return;
+
+  if ( !mRTree )
+  {
+    // first feature of an empty layer
+    SpatialIndex::id_type indexId;
+    mRTree.reset( RTree::createNewRTree( *mStorage, RTREE_FILL_FACTOR, RTREE_INDEX_CAPACITY,
+                                         RTREE_LEAF_CAPACITY, RTREE_DIMENSION, RTREE_VARIANT, indexId ) );
+  }
+
+  mRTree->insertData( 0, nullptr, rect2region( bbox ), fid );
+  mGeometries.insert( fid, geometry );
+}
+
+void QgsPointLocatorIndex::remove( QgsFeatureId fid )
+{
+  if ( !mGeometries.contains( fid ) )
+    return;
+
+  if ( mRTree )
+    mRTree->deleteData( rect2region( mGeometries.boundingBox( fid ) ), fid );
+  mGeometries.remove( fid );
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Task building the index of a point locator in the background, from a snapshot of the
+ * features of the layer. The index is handed over to the locator when the task is finished,
+ * unless the locator was destroyed or started another task meanwhile.
+ */
+class QgsPointLocatorInitTask : public QgsTask
+{
+  public:
+    QgsPointLocatorInitTask( QgsPointLocator *locator, int maxFeaturesToIndex )
+      : QgsTask( QObject::tr( "Indexing %1" ).arg( locator->layer()->name() ), QgsTask::CanCancel )
+      , mLocator( locator )
+      , mSource( new QgsVectorLayerFeatureSource( locator->layer() ) )
+      , mRequest( locator->indexRequest() )
+      , mTransform( locator->mTransform )
+      , mMaxFeaturesToIndex( maxFeaturesToIndex )
+      , mFeatureCount( locator->layer()->featureCount() )
+      , mIndex( new QgsPointLocatorIndex( locator->compactGeometryStorage() ) )
+    {
+      setDependentLayers( QList< QgsMapLayer * >() << locator->layer() );
+    }
+
+    virtual void cancel() override
+    {
+      mFeedback.cancel();
+      QgsTask::cancel();
+    }
+
+  protected:
+
+    virtual bool run() override
+    {
+      connect( &mFeedback, &QgsFeedback::progressChanged, this, &QgsPointLocatorInitTask::setProgress );
+
+      QgsFeatureIterator fi = mSource->getFeatures( mRequest );
+      return mIndex->build( fi, mTransform, mMaxFeaturesToIndex, &mFeedback, mFeatureCount );
+    }
+
+    virtual void finished( bool result ) override
+    {
+      if ( mLocator )
+        mLocator->indexingTaskFinished( this, mIndex.release(), result, mFeedback.isCanceled() );
+    }
+
+  private:
+    QPointer< QgsPointLocator > mLocator;
+    std::unique_ptr< QgsVectorLayerFeatureSource > mSource;
+    QgsFeatureRequest mRequest;
+    QgsCoordinateTransform mTransform;
+    int mMaxFeaturesToIndex;
+    long mFeatureCount;
+    std::unique_ptr< QgsPointLocatorIndex > mIndex;
+    QgsFeedback mFeedback;
+};
+
+///@endcond
+
+////////////////////////////////////////////////////////////////////////////
+
+
+QgsPointLocator::QgsPointLocator( QgsVectorLayer *layer, const QgsCoordinateReferenceSystem &destCRS, const QgsRectangle *extent )
+  : mLayer( layer )
+  , mExtent( nullptr )
 {
-  delete mRTree;
-  mRTree = nullptr;
+  if ( destCRS.isValid() )
+  {
+    mTransform = QgsCoordinateTransform( layer->crs(), destCRS );
+  }
 
-  mIsEmptyLayer = false;
+  setExtent( extent );
+
+  connect( mLayer, SIGNAL( featureAdded( QgsFeatureId ) ), this, SLOT( onFeatureAdded( QgsFeatureId ) ) );
+  connect( mLayer, SIGNAL( featureDeleted( QgsFeatureId ) ), this, SLOT( onFeatureDeleted( QgsFeatureId ) ) );
+  connect( mLayer, SIGNAL( geometryChanged( QgsFeatureId, const QgsGeometry & ) ), this, SLOT( onGeometryChanged( QgsFeatureId, const QgsGeometry & ) ) );
+  connect( mLayer, &QgsVectorLayer::dataChanged, this, &QgsPointLocator::onDataChanged );
+}
 
-  qDeleteAll( mGeoms );
 
-  mGeoms.clear();
+QgsPointLocator::~QgsPointLocator()
+{
+  destroyIndex();
+  delete mExtent;
 }
 
-void QgsPointLocator::onFeatureAdded( QgsFeatureId fid )
+QgsCoordinateReferenceSystem QgsPointLocator::destinationCrs() const
 {
-  if ( !mRTree )
+  return mTransform.isValid() ? mTransform.destinationCrs() : QgsCoordinateReferenceSystem();
+}
+
+void QgsPointLocator::setExtent( const QgsRectangle *extent )
+{
+  if ( extent )
   {
-    if ( mIsEmptyLayer )
-      rebuildIndex(); // first feature - let's built the index
-    return; // nothing to do if we are not initialized yet
+    mExtent = new QgsRectangle( *extent );
   }
 
-  QgsFeature f;
-  if ( mLayer->getFeatures( QgsFeatureRequest( fid ) ).nextFeature( f ) )
+  destroyIndex();
+}
+
+void QgsPointLocator::setCompactGeometryStorage( bool compact )
+{
+  if ( compact == mCompactGeometryStorage )
+    return;
+
+  mCompactGeometryStorage = compact;
+  destroyIndex();
+}
+
+
+bool QgsPointLocator::init( int maxFeaturesToIndex, bool relaxed )
+{
+  if ( hasIndex() )
+    return true;
+
+  if ( relaxed )
   {
-    if ( !f.hasGeometry() )
-      return;
+    mRelaxed = true;
+    mMaxFeaturesToIndex = maxFeaturesToIndex;
+    if ( !mInitTask )
+      startIndexingTask( maxFeaturesToIndex );
+    return true;
+  }
+
+  return rebuildIndex( maxFeaturesToIndex );
+}
+
+
+bool QgsPointLocator::hasIndex() const
+{
+  return static_cast< bool >( mIndex );
+}
+
+void QgsPointLocator::waitForIndexingFinished()
+{
+  if ( !mInitTask )
+    return;
+
+  // initFinished() is emitted from the event loop, once the task is finished
+  QEventLoop loop;
+  connect( this, &QgsPointLocator::initFinished, &loop, &QEventLoop::quit );
+  loop.exec();
+}
 
+int QgsPointLocator::cachedGeometryCount() const
+{
+  return mIndex ? mIndex->geometries().count() : 0;
+}
+
+QgsFeatureRequest QgsPointLocator::indexRequest() const
+{
+  QgsFeatureRequest request;
+  request.setSubsetOfAttributes( QgsAttributeList() );
+  if ( mExtent )
+  {
+    QgsRectangle rect = *mExtent;
     if ( mTransform.isValid() )
     {
       try
       {
-        QgsGeometry transformedGeom = f.geometry();
-        transformedGeom.transform( mTransform );
-        f.setGeometry( transformedGeom );
+        rect = mTransform.transformBoundingBox( rect, QgsCoordinateTransform::ReverseTransform );
       }
       catch ( const QgsException &e )
       {
         Q_UNUSED( e );
         // See http://hub.qgis.org/issues/12634
-        QgsDebugMsg( QString( "could not transform geometry to map, skipping the snap for it (%1)" ).arg( e.what() ) );
-        return;
+        QgsDebugMsg( QString( "could not transform bounding box to map, skipping the snap filter (%1)" ).arg( e.what() ) );
       }
     }
+    request.setFilterRect( rect );
+  }
+  return request;
+}
 
-    QgsRectangle bbox = f.geometry().boundingBox();
-    if ( !bbox.isNull() )
-    {
-      SpatialIndex::Region r( rect2region( bbox ) );
-      mRTree->insertData( 0, nullptr, r, f.id() );
 
-      if ( mGeoms.contains( f.id() ) )
-        delete mGeoms.take( f.id() );
-      mGeoms[fid] = new QgsGeometry( f.geometry() );
-    }
+bool QgsPointLocator::rebuildIndex( int maxFeaturesToIndex )
+{
+  destroyIndex();
+
+  std::unique_ptr< QgsPointLocatorIndex > index( new QgsPointLocatorIndex( mCompactGeometryStorage ) );
+  if ( mLayer->geometryType() != QgsWkbTypes::NullGeometry )
+  {
+    QgsFeatureIterator fi = mLayer->getFeatures( indexRequest() );
+    if ( !index->build( fi, mTransform, maxFeaturesToIndex ) )
+      return false;
   }
+
+  mIndex = std::move( index );
+  return true;
 }
 
-void QgsPointLocator::onFeatureDeleted( QgsFeatureId fid )
+
+void QgsPointLocator::destroyIndex()
 {
-  if ( !mRTree )
-    return; // nothing to do if we are not initialized yet
+  if ( mInitTask )
+  {
+    // the index of the task is discarded when it finishes
+    mInitTask->cancel();
+    mInitTask = nullptr;
+    mChangedWhileIndexing.clear();
+    emit initFinished( false );
+  }
+
+  mIndex.reset();
+}
 
-  if ( mGeoms.contains( fid ) )
+void QgsPointLocator::startIndexingTask( int maxFeaturesToIndex )
+{
+  if ( mInitTask )
+    mInitTask->cancel();
+  mChangedWhileIndexing.clear();
+
+  QgsPointLocatorInitTask *task = new QgsPointLocatorInitTask( this, maxFeaturesToIndex );
+  mInitTask = task;
+  QgsApplication::taskManager()->addTask( task );
+}
+
+void QgsPointLocator::indexingTaskFinished( QgsTask *task, QgsPointLocatorIndex *index, bool ok, bool canceled )
+{
+  std::unique_ptr< QgsPointLocatorIndex > newIndex( index );
+  if ( task != mInitTask )
+    return; // canceled or replaced by a newer task
+
+  mInitTask = nullptr;
+  if ( !ok )
   {
-    mRTree->deleteData( rect2region( mGeoms[fid]->boundingBox() ), fid );
-    delete mGeoms.take( fid );
+    // a refresh canceled from the task manager keeps the index which still answers queries,
+    // the index is only dropped when the layer does not fit within the limit of features anymore
+    if ( !canceled )
+      mIndex.reset();
+    mChangedWhileIndexing.clear();
+    emit initFinished( false );
+    return;
   }
+
+  mIndex = std::move( newIndex );
+
+  // the task read a snapshot of the layer, apply the edits made since then
+  const QSet< QgsFeatureId > changed = mChangedWhileIndexing;
+  mChangedWhileIndexing.clear();
+  Q_FOREACH ( QgsFeatureId fid, changed )
+    updateFeature( fid );
+
+  emit initFinished( true );
+}
+
+void QgsPointLocator::updateFeature( QgsFeatureId fid )
+{
+  QgsFeature f;
+  QgsFeatureRequest request( fid );
+  request.setSubsetOfAttributes( QgsAttributeList() );
+  if ( !mLayer->getFeatures( request ).nextFeature( f ) || !f.hasGeometry() )
+  {
+    mIndex->remove( fid );
+    return;
+  }
+
+  onGeometryChanged( fid, f.geometry() );
+}
+
+void QgsPointLocator::onFeatureAdded( QgsFeatureId fid )
+{
+  if ( mInitTask )
+    mChangedWhileIndexing << fid;
+
+  if ( !mIndex )
+    return; // nothing to do if we are not initialized yet
+
+  updateFeature( fid );
+}
+
+void QgsPointLocator::onFeatureDeleted( QgsFeatureId fid )
+{
+  if ( mInitTask )
+    mChangedWhileIndexing << fid;
+
+  if ( !mIndex )
+    return; // nothing to do if we are not initialized yet
+
+  mIndex->remove( fid );
 }
 
 void QgsPointLocator::onGeometryChanged( QgsFeatureId fid, const QgsGeometry &geom )
 {
-  Q_UNUSED( geom );
-  onFeatureDeleted( fid );
-  onFeatureAdded( fid );
+  if ( mInitTask )
+    mChangedWhileIndexing << fid;
+
+  if ( !mIndex )
+    return; // nothing to do if we are not initialized yet
+
+  // the feature is only updated in the index, the other features are left alone
+  QgsGeometry transformedGeom = geom;
+  if ( mTransform.isValid() && !transformedGeom.isNull() )
+  {
+    try
+    {
+      transformedGeom.transform( mTransform );
+    }
+    catch ( const QgsException &e )
+    {
+      Q_UNUSED( e );
+      // See http://hub.qgis.org/issues/12634
+      QgsDebugMsg( QString( "could not transform geometry to map, skipping the snap for it (%1)" ).arg( e.what() ) );
+      mIndex->remove( fid );
+      return;
+    }
+  }
+
+  mIndex->insert( fid, transformedGeom );
 }
 
+void QgsPointLocator::onDataChanged()
+{
+  if ( mRelaxed )
+  {
+    // keep answering queries from the current index, if any, while the new one is built
+    startIndexingTask( mMaxFeaturesToIndex );
+    return;
+  }
+
+  destroyIndex();
+}
 
-QgsPointLocator::Match QgsPointLocator::nearestVertex( const QgsPoint &point, double tolerance, MatchFilter *filter )
+bool QgsPointLocator::prepareQuery()
 {
-  if ( !mRTree )
+  if ( !mIndex )
   {
-    init();
-    if ( !mRTree ) // still invalid?
-      return Match();
+    // nothing is found until the index built in the background is ready
+    if ( mInitTask )
+      return false;
+
+    init( mMaxFeaturesToIndex, mRelaxed );
   }
+  return mIndex && mIndex->rtree();
+}
+
+
+QgsPointLocator::Match QgsPointLocator::nearestVertex( const QgsPoint &point, double tolerance, MatchFilter *filter )
+{
+  if ( !prepareQuery() )
+    return Match();
 
   Match m;
   QgsPointLocator_VisitorNearestVertex visitor( this, m, point, filter );
   QgsRectangle rect( point.x() - tolerance, point.y() - tolerance, point.x() + tolerance, point.y() + tolerance );
-  mRTree->intersectsWithQuery( rect2region( rect ), visitor );
+  mIndex->rtree()->intersectsWithQuery( rect2region( rect ), visitor );
   if ( m.isValid() && m.distance() > tolerance )
     return Match(); // make sure that only match strictly within the tolerance is returned
   return m;
@@ -859,12 +1363,8 @@ QgsPointLocator::Match QgsPointLocator::nearestVertex( const QgsPoint &point, do
 
 QgsPointLocator::Match QgsPointLocator::nearestEdge( const QgsPoint &point, double tolerance, MatchFilter *filter )
 {
-  if ( !mRTree )
-  {
-    init();
-    if ( !mRTree ) // still invalid?
-      return Match();
-  }
+  if ( !prepareQuery() )
+    return Match();
 
   QgsWkbTypes::GeometryType geomType = mLayer->geometryType();
   if ( geomType == QgsWkbTypes::PointGeometry )
@@ -873,7 +1373,7 @@ QgsPointLocator::Match QgsPointLocator::nearestEdge( const QgsPoint &point, doub
   Match m;
   QgsPointLocator_VisitorNearestEdge visitor( this, m, point, filter );
   QgsRectangle rect( point.x() - tolerance, point.y() - tolerance, point.x() + tolerance, point.y() + tolerance );
-  mRTree->intersectsWithQuery( rect2region( rect ), visitor );
+  mIndex->rtree()->intersectsWithQuery( rect2region( rect ), visitor );
   if ( m.isValid() && m.distance() > tolerance )
     return Match(); // make sure that only match strictly within the tolerance is returned
   return m;
@@ -881,12 +1381,8 @@ QgsPointLocator::Match QgsPointLocator::nearestEdge( const QgsPoint &point, doub
 
 QgsPointLocator::MatchList QgsPointLocator::edgesInRect( const QgsRectangle &rect, QgsPointLocator::MatchFilter *filter )
 {
-  if ( !mRTree )
-  {
-    init();
-    if ( !mRTree ) // still invalid?
-      return MatchList();
-  }
+  if ( !prepareQuery() )
+    return MatchList();
 
   QgsWkbTypes::GeometryType geomType = mLayer->geometryType();
   if ( geomType == QgsWkbTypes::PointGeometry )
@@ -894,7 +1390,7 @@ QgsPointLocator::MatchList QgsPointLocator::edgesInRect( const QgsRectangle &rec
 
   MatchList lst;
   QgsPointLocator_VisitorEdgesInRect visitor( this, lst, rect, filter );
-  mRTree->intersectsWithQuery( rect2region( rect ), visitor );
+  mIndex->rtree()->intersectsWithQuery( rect2region( rect ), visitor );
 
   return lst;
 }
@@ -908,12 +1404,8 @@ QgsPointLocator::MatchList QgsPointLocator::edgesInRect( const QgsPoint &point,
 
 QgsPointLocator::MatchList QgsPointLocator::pointInPolygon( const QgsPoint &point )
 {
-  if ( !mRTree )
-  {
-    init();
-    if ( !mRTree ) // still invalid?
-      return MatchList();
-  }
+  if ( !prepareQuery() )
+    return MatchList();
 
   QgsWkbTypes::GeometryType geomType = mLayer->geometryType();
   if ( geomType == QgsWkbTypes::PointGeometry || geomType == QgsWkbTypes::LineGeometry )
@@ -921,6 +1413,6 @@ QgsPointLocator::MatchList QgsPointLocator::pointInPolygon( const QgsPoint &poin
 
   MatchList lst;
   QgsPointLocator_VisitorArea visitor( this, point, lst );
-  mRTree->intersectsWithQuery( point2point( point ), visitor );
+  mIndex->rtree()->intersectsWithQuery( point2point( point ), visitor );
   return lst;
 }
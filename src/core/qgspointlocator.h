@@ -25,16 +25,17 @@ class QgsVectorLayer;
 #include "qgscoordinatereferencesystem.h"
 #include "qgscoordinatetransform.h"
 
+#include <QPointer>
+#include <QSet>
+#include <memory>
+
 class QgsPointLocator_VisitorNearestVertex;
 class QgsPointLocator_VisitorNearestEdge;
 class QgsPointLocator_VisitorArea;
 class QgsPointLocator_VisitorEdgesInRect;
-
-namespace SpatialIndex
-{
-  class IStorageManager;
-  class ISpatialIndex;
-}
+class QgsFeatureRequest;
+class QgsPointLocatorIndex;
+class QgsTask;
 
 /** \ingroup core
  * @brief The class defines interface for querying point location:
@@ -44,6 +45,12 @@ namespace SpatialIndex
  *
  * Works with one layer.
  *
+ * The index can be built in a background task with init( -1, true ). Until the new index is
+ * ready, queries are answered from the previous one if any, or find nothing. A locator built
+ * this way also refreshes its index in the background when the data of the layer change,
+ * instead of dropping it. Added, deleted and modified features are updated in the index
+ * without rebuilding it.
+ *
  * @note added in 2.8
  */
 class CORE_EXPORT QgsPointLocator : public QObject
@@ -91,12 +98,49 @@ class CORE_EXPORT QgsPointLocator : public QObject
     /** Prepare the index for queries. Does nothing if the index already exists.
      * If the number of features is greater than the value of maxFeaturesToIndex, creation of index is stopped
      * to make sure we do not run out of memory. If maxFeaturesToIndex is -1, no limits are used. Returns
-     * false if the creation of index has been prematurely stopped due to the limit of features, otherwise true */
-    bool init( int maxFeaturesToIndex = -1 );
+     * false if the creation of index has been prematurely stopped due to the limit of features, otherwise true.
+     *
+     * If \a relaxed is true, the index is built in a background task and the method returns true
+     * immediately, initFinished() is emitted once the index is ready or its creation was stopped.
+     * The parameter is available since QGIS 3.0.
+     * @see initFinished()
+     */
+    bool init( int maxFeaturesToIndex = -1, bool relaxed = false );
 
     //! Indicate whether the data have been already indexed
     bool hasIndex() const;
 
+    /**
+     * Returns true if the index is being built in a background task.
+     * @see init()
+     * @note added in QGIS 3.0
+     */
+    bool isIndexing() const { return !mInitTask.isNull(); }
+
+    /**
+     * Waits until the index being built in a background task is ready, processing the
+     * events of the calling thread meanwhile. Returns immediately if the index is not being built.
+     * @note added in QGIS 3.0
+     */
+    void waitForIndexingFinished();
+
+    /**
+     * Sets whether the geometries of the index are stored as the coordinates of their vertices in
+     * a buffer shared by all the features, instead of QgsGeometry copies. This needs much less memory
+     * for large layers, queries are a bit slower for complex geometries and curved geometries are
+     * still stored as QgsGeometry copies. Changing it drops the current index.
+     * @see compactGeometryStorage()
+     * @note added in QGIS 3.0
+     */
+    void setCompactGeometryStorage( bool compact );
+
+    /**
+     * Returns true if the geometries of the index are stored as the coordinates of their vertices.
+     * @see setCompactGeometryStorage()
+     * @note added in QGIS 3.0
+     */
+    bool compactGeometryStorage() const { return mCompactGeometryStorage; }
+
     struct Match
     {
         //! construct invalid match
@@ -216,7 +260,18 @@ class CORE_EXPORT QgsPointLocator : public QObject
 
     //! Return how many geometries are cached in the index
     //! @note added in QGIS 2.14
-    int cachedGeometryCount() const { return mGeoms.count(); }
+    int cachedGeometryCount() const;
+
+  signals:
+
+    /**
+     * Emitted when the index built in a background task is ready, or with \a ok set to
+     * false if its creation was stopped because of the limit of features or canceled, e.g.
+     * when the index is destroyed because the extent changed.
+     * @see init()
+     * @note added in QGIS 3.0
+     */
+    void initFinished( bool ok );
 
   protected:
     bool rebuildIndex( int maxFeaturesToIndex = -1 );
@@ -226,22 +281,47 @@ class CORE_EXPORT QgsPointLocator : public QObject
     void onFeatureAdded( QgsFeatureId fid );
     void onFeatureDeleted( QgsFeatureId fid );
     void onGeometryChanged( QgsFeatureId fid, const QgsGeometry &geom );
+    void onDataChanged();
 
   private:
-    //! Storage manager
-    SpatialIndex::IStorageManager *mStorage = nullptr;
+    //! Returns true if queries can run, building the index if needed
+    bool prepareQuery();
+
+    //! Starts building a new index in a background task, replacing any task already running
+    void startIndexingTask( int maxFeaturesToIndex );
+
+    //! Hands over the index built by a background task, \a canceled is true if the task was canceled
+    void indexingTaskFinished( QgsTask *task, QgsPointLocatorIndex *index, bool ok, bool canceled );
 
-    QHash<QgsFeatureId, QgsGeometry *> mGeoms;
-    SpatialIndex::ISpatialIndex *mRTree = nullptr;
+    //! Returns the request for the features to index
+    QgsFeatureRequest indexRequest() const;
 
-    //! flag whether the layer is currently empty (i.e. mRTree is null but it is not necessary to rebuild it)
-    bool mIsEmptyLayer;
+    //! Adds a feature of the layer to the index, or removes it if it does not exist anymore
+    void updateFeature( QgsFeatureId fid );
+
+    //! Spatial index and geometries, null if the layer is not indexed
+    std::unique_ptr< QgsPointLocatorIndex > mIndex;
+
+    //! Task building a new index, null if none is running
+    QPointer< QgsTask > mInitTask;
+
+    //! Features changed while the background task runs, updated in its index once it is ready
+    QSet< QgsFeatureId > mChangedWhileIndexing;
+
+    //! True if the index is refreshed in background tasks when the data change
+    bool mRelaxed = false;
+
+    //! Limit of features of the indexes built in background tasks
+    int mMaxFeaturesToIndex = -1;
+
+    bool mCompactGeometryStorage = false;
 
-    //! R-tree containing spatial index
     QgsCoordinateTransform mTransform;
     QgsVectorLayer *mLayer = nullptr;
     QgsRectangle *mExtent = nullptr;
 
+    friend class QgsPointLocatorInitTask;
+
     friend class QgsPointLocator_VisitorNearestVertex;
     friend class QgsPointLocator_VisitorNearestEdge;
     friend class QgsPointLocator_VisitorArea;
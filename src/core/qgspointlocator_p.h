@@ -0,0 +1,191 @@
+/***************************************************************************
+  qgspointlocator_p.h
+  --------------------------------------
+  Date                 : February 2017
+  Copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSPOINTLOCATOR_P_H
+#define QGSPOINTLOCATOR_P_H
+
+/// @cond PRIVATE
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QGIS API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+
+#include "qgspointlocator.h"
+#include "qgsgeometry.h"
+#include "qgsrectangle.h"
+
+#include <QHash>
+#include <QVector>
+
+#include <memory>
+
+class QgsFeatureIterator;
+class QgsFeedback;
+
+namespace SpatialIndex
+{
+  class IStorageManager;
+  class ISpatialIndex;
+}
+
+/**
+ * Geometries indexed by a point locator, in the destination CRS of the locator.
+ *
+ * Geometries are either kept as QgsGeometry copies, or in compact mode as the x and y
+ * coordinates of their vertices in one buffer shared by all the features, which needs
+ * several times less memory for large layers. Curved geometries are always kept as
+ * QgsGeometry copies, as their vertices are not enough to answer edge queries.
+ *
+ * Vertex indices are the same as the ones of QgsGeometry, counting all the vertices of
+ * all the parts and rings in order.
+ */
+class QgsPointLocatorGeometryStore
+{
+  public:
+
+    explicit QgsPointLocatorGeometryStore( bool compact = false );
+    ~QgsPointLocatorGeometryStore();
+
+    //! QgsPointLocatorGeometryStore cannot be copied
+    QgsPointLocatorGeometryStore( const QgsPointLocatorGeometryStore &rh ) = delete;
+    //! QgsPointLocatorGeometryStore cannot be copied
+    QgsPointLocatorGeometryStore &operator=( const QgsPointLocatorGeometryStore &rh ) = delete;
+
+    //! Returns true if flat geometries are stored as vertices in a shared buffer
+    bool isCompact() const { return mCompact; }
+
+    //! Adds the geometry of a feature, replacing any geometry stored for it
+    void insert( QgsFeatureId fid, const QgsGeometry &geometry );
+
+    //! Removes the geometry of a feature
+    void remove( QgsFeatureId fid );
+
+    //! Removes all the geometries
+    void clear();
+
+    bool contains( QgsFeatureId fid ) const;
+
+    //! Returns the number of stored geometries
+    int count() const;
+
+    QgsRectangle boundingBox( QgsFeatureId fid ) const;
+
+    /**
+     * Finds the vertex of the geometry closest to \a point, returns the squared distance
+     * to it or -1 if the geometry has no vertex.
+     */
+    double closestVertex( QgsFeatureId fid, const QgsPoint &point, QgsPoint &vertex, int &vertexIndex ) const;
+
+    /**
+     * Finds the segment of the geometry closest to \a point, returns the squared distance
+     * to it or -1 if the geometry has no segment. \a edgePoints receives the vertices of the
+     * segment, \a afterVertex the index of its second vertex.
+     */
+    double closestSegment( QgsFeatureId fid, const QgsPoint &point, QgsPoint &segmentPoint, int &afterVertex, QgsPoint *edgePoints ) const;
+
+    /**
+     * Returns true if the polygons of the geometry contain \a point, \a pointGeometry is the
+     * same point used for the geometries which are not stored in compact form. In compact form,
+     * points exactly on the boundary of a polygon may not be found in it.
+     */
+    bool containsPoint( QgsFeatureId fid, const QgsPoint &point, const QgsGeometry &pointGeometry ) const;
+
+    //! Returns the edge matches of the segments of the geometry intersecting \a rect
+    QgsPointLocator::MatchList segmentsInRect( QgsFeatureId fid, const QgsRectangle &rect, QgsVectorLayer *layer ) const;
+
+  private:
+
+    //! Vertices of a part, or of a ring of a polygon
+    struct Sequence
+    {
+      int vertexCount;
+      //! True for the exterior ring of a polygon
+      bool exteriorRing;
+    };
+
+    //! Geometry stored in the shared buffers
+    struct CompactGeometry
+    {
+      QgsWkbTypes::GeometryType type;
+      int firstVertex;
+      int vertexCount;
+      int firstSequence;
+      int sequenceCount;
+    };
+
+    //! Copies the vertices of a flat geometry to the shared buffers, returns false if it is not flat
+    bool insertCompact( QgsFeatureId fid, const QgsGeometry &geometry );
+
+    //! Rewrites the shared buffers without the vertices of removed geometries
+    void collectGarbage();
+
+    bool mCompact = false;
+
+    QHash< QgsFeatureId, QgsGeometry * > mGeometries;
+
+    QHash< QgsFeatureId, CompactGeometry > mCompactGeometries;
+    //! x and y of the vertices of all the compact geometries
+    QVector< double > mCoordinates;
+    QVector< Sequence > mSequences;
+    //! Number of vertices of removed geometries still in mCoordinates
+    int mGarbageVertices = 0;
+};
+
+/**
+ * Spatial index and geometries of a point locator. It is built in one go, possibly in a
+ * background task, then handed over to the locator and updated incrementally.
+ */
+class QgsPointLocatorIndex
+{
+  public:
+
+    explicit QgsPointLocatorIndex( bool compact = false );
+    ~QgsPointLocatorIndex();
+
+    /**
+     * Indexes the features of \a iterator, with their geometries transformed with \a transform
+     * if it is valid. Returns false if there are more than \a maxFeaturesToIndex features,
+     * unless it is -1, or if \a feedback is canceled. \a featureCount is only used to report
+     * the progress to \a feedback.
+     */
+    bool build( QgsFeatureIterator &iterator, const QgsCoordinateTransform &transform, int maxFeaturesToIndex,
+                QgsFeedback *feedback = nullptr, long featureCount = 0 );
+
+    //! Adds or replaces a feature, with its geometry in the destination CRS of the locator
+    void insert( QgsFeatureId fid, const QgsGeometry &geometry );
+
+    //! Removes a feature
+    void remove( QgsFeatureId fid );
+
+    //! R-tree of the bounding boxes of the features, null if there is no feature
+    SpatialIndex::ISpatialIndex *rtree() const { return mRTree.get(); }
+
+    QgsPointLocatorGeometryStore &geometries() { return mGeometries; }
+    const QgsPointLocatorGeometryStore &geometries() const { return mGeometries; }
+
+  private:
+
+    std::unique_ptr< SpatialIndex::IStorageManager > mStorage;
+    std::unique_ptr< SpatialIndex::ISpatialIndex > mRTree;
+    QgsPointLocatorGeometryStore mGeometries;
+};
+
+/// @endcond
+
+#endif // QGSPOINTLOCATOR_P_H
@@ -28,6 +28,7 @@
 
 QgsRenderContext::QgsRenderContext()
   : mFlags( DrawEditingInfo | UseAdvancedEffects | DrawSelection | UseRenderingOptimization )
+  , mArena( std::make_shared< QgsArenaAllocator >() )
 {
   mVectorSimplifyMethod.setSimplifyHints( QgsVectorSimplifyMethod::NoSimplification );
 }
@@ -36,6 +37,7 @@ QgsRenderContext::QgsRenderContext( const QgsRenderContext &rh )
   : mFlags( rh.mFlags )
   , mPainter( rh.mPainter )
   , mCoordTransform( rh.mCoordTransform )
+  , mApproximateTransform( rh.mApproximateTransform )
   , mExtent( rh.mExtent )
   , mMapToPixel( rh.mMapToPixel )
   , mRenderingStopped( rh.mRenderingStopped )
@@ -49,6 +51,7 @@ QgsRenderContext::QgsRenderContext( const QgsRenderContext &rh )
   , mFeatureFilterProvider( rh.mFeatureFilterProvider ? rh.mFeatureFilterProvider->clone() : nullptr )
   , mSegmentationTolerance( rh.mSegmentationTolerance )
   , mSegmentationToleranceType( rh.mSegmentationToleranceType )
+  , mArena( rh.mArena )
 {
 }
 
@@ -57,6 +60,7 @@ QgsRenderContext &QgsRenderContext::operator=( const QgsRenderContext &rh )
   mFlags = rh.mFlags;
   mPainter = rh.mPainter;
   mCoordTransform = rh.mCoordTransform;
+  mApproximateTransform = rh.mApproximateTransform;
   mExtent = rh.mExtent;
   mMapToPixel = rh.mMapToPixel;
   mRenderingStopped = rh.mRenderingStopped;
@@ -70,6 +74,7 @@ QgsRenderContext &QgsRenderContext::operator=( const QgsRenderContext &rh )
   mFeatureFilterProvider.reset( rh.mFeatureFilterProvider ? rh.mFeatureFilterProvider->clone() : nullptr );
   mSegmentationTolerance = rh.mSegmentationTolerance;
   mSegmentationToleranceType = rh.mSegmentationToleranceType;
+  mArena = rh.mArena;
   return *this;
 }
 
@@ -168,6 +173,7 @@ bool QgsRenderContext::showSelection() const
 void QgsRenderContext::setCoordinateTransform( const QgsCoordinateTransform &t )
 {
   mCoordTransform = t;
+  mApproximateTransform = QgsApproximateCoordinateTransform();
 }
 
 void QgsRenderContext::setDrawEditingInformation( bool b )
@@ -359,3 +365,13 @@ double QgsRenderContext::convertFromMapUnits( double sizeInMapUnits, QgsUnitType
   }
   return 0.0;
 }
+
+QgsArenaAllocator &QgsRenderContext::arena()
+{
+  return *mArena;
+}
+
+void QgsRenderContext::detachArena()
+{
+  mArena = std::make_shared< QgsArenaAllocator >();
+}
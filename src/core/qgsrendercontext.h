@@ -23,6 +23,8 @@
 #include <memory>
 
 #include "qgsabstractgeometry.h"
+#include "qgsapproximatecoordinatetransform.h"
+#include "qgsarenaallocator.h"
 #include "qgscoordinatetransform.h"
 #include "qgsmaptopixel.h"
 #include "qgsrectangle.h"
@@ -113,6 +115,16 @@ class CORE_EXPORT QgsRenderContext
      */
     QgsCoordinateTransform coordinateTransform() const {return mCoordTransform;}
 
+    /**
+     * Returns the approximation of the coordinate transform used to render geometries
+     * when sub-pixel accuracy is enough. It is invalid if the geometries must be
+     * transformed exactly with coordinateTransform().
+     * @see setApproximateCoordinateTransform()
+     * @note not available in Python bindings
+     * @note added in QGIS 3.0
+     */
+    const QgsApproximateCoordinateTransform &approximateCoordinateTransform() const { return mApproximateTransform; }
+
     const QgsRectangle &extent() const {return mExtent;}
 
     const QgsMapToPixel &mapToPixel() const {return mMapToPixel;}
@@ -162,8 +174,20 @@ class CORE_EXPORT QgsRenderContext
 
     //setters
 
-    //! Sets coordinate transformation.
+    /**
+     * Sets coordinate transformation. This resets the approximate coordinate transform.
+     * @see setApproximateCoordinateTransform()
+     */
     void setCoordinateTransform( const QgsCoordinateTransform &t );
+
+    /**
+     * Sets the approximation of the coordinate transform used to render geometries, which
+     * must approximate the transform set with setCoordinateTransform().
+     * @see approximateCoordinateTransform()
+     * @note not available in Python bindings
+     * @note added in QGIS 3.0
+     */
+    void setApproximateCoordinateTransform( const QgsApproximateCoordinateTransform &transform ) { mApproximateTransform = transform; }
     void setMapToPixel( const QgsMapToPixel &mtp ) {mMapToPixel = mtp;}
     void setExtent( const QgsRectangle &extent ) {mExtent = extent;}
 
@@ -297,6 +321,26 @@ class CORE_EXPORT QgsRenderContext
      */
     double convertFromMapUnits( double sizeInMapUnits, QgsUnitTypes::RenderUnit outputUnit ) const;
 
+    /**
+     * Returns the arena for the temporary objects of the rendering operation, such as the
+     * intermediate buffers of clipping. The arena is shared with the copies of the context,
+     * and reset when the layer is rendered. A copy used by another thread must get its own
+     * arena with detachArena() first.
+     * @note not available in Python bindings
+     * @note added in QGIS 3.0
+     * @see detachArena()
+     */
+    QgsArenaAllocator &arena();
+
+    /**
+     * Gives the context its own arena, no longer shared with the context it was copied from
+     * nor with its other copies. Must be called before a copy is used by another thread.
+     * @note not available in Python bindings
+     * @note added in QGIS 3.0
+     * @see arena()
+     */
+    void detachArena();
+
   private:
 
     Flags mFlags;
@@ -307,6 +351,9 @@ class CORE_EXPORT QgsRenderContext
     //! For transformation between coordinate systems. Can be invalid if on-the-fly reprojection is not used
     QgsCoordinateTransform mCoordTransform;
 
+    //! Approximation of mCoordTransform for rendering, invalid if not used
+    QgsApproximateCoordinateTransform mApproximateTransform;
+
     QgsRectangle mExtent;
 
     QgsMapToPixel mMapToPixel;
@@ -341,6 +388,9 @@ class CORE_EXPORT QgsRenderContext
     double mSegmentationTolerance = M_PI_2 / 90;
 
     QgsAbstractGeometry::SegmentationToleranceType mSegmentationToleranceType = QgsAbstractGeometry::MaximumAngle;
+
+    //! Arena for temporary objects, shared with the copies of the context
+    std::shared_ptr< QgsArenaAllocator > mArena;
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS( QgsRenderContext::Flags )
@@ -0,0 +1,71 @@
+/***************************************************************************
+     qgssimd.cpp
+     -----------
+    Date                 : February 2017
+    Copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgssimd_p.h"
+
+#include <cstdlib>
+
+#if defined( QGS_SIMD_AVX2 ) && defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+///@cond PRIVATE
+
+static bool simdDisabled()
+{
+  static const bool disabled = std::getenv( "QGIS_DISABLE_SIMD" ) != nullptr;
+  return disabled;
+}
+
+static bool detectAvx2()
+{
+#if !defined( QGS_SIMD_AVX2 )
+  return false;
+#elif defined( _MSC_VER )
+  int info[4];
+  __cpuid( info, 0 );
+  if ( info[0] < 7 )
+    return false;
+
+  // AVX2 needs the OS to save the YMM registers, as reported by XGETBV
+  __cpuid( info, 1 );
+  const bool osxsave = info[2] & ( 1 << 27 );
+  const bool avx = info[2] & ( 1 << 28 );
+  if ( !osxsave || !avx || ( _xgetbv( 0 ) & 0x6 ) != 0x6 )
+    return false;
+
+  __cpuidex( info, 7, 0 );
+  return info[1] & ( 1 << 5 );
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports( "avx2" );
+#endif
+}
+
+bool QgsSimd::hasAvx2()
+{
+  static const bool avx2 = !simdDisabled() && detectAvx2();
+  return avx2;
+}
+
+bool QgsSimd::hasSse2()
+{
+#if defined( QGS_SIMD_SSE2 )
+  return !simdDisabled();
+#else
+  return false;
+#endif
+}
+
+///@endcond
@@ -0,0 +1,74 @@
+/***************************************************************************
+     qgssimd_p.h
+     -----------
+    Date                 : February 2017
+    Copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSSIMD_P_H
+#define QGSSIMD_P_H
+
+/// @cond PRIVATE
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QGIS API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// Selection of the vectorized code paths of the coordinate and raster
+// kernels. SSE2 is part of the x86-64 baseline and is chosen at compile
+// time, AVX2 kernels are compiled for their own target and only called
+// after checking at runtime that the CPU supports them. Other architectures
+// use the scalar code.
+//
+
+#include "qgis_core.h"
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define QGS_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined( QGS_SIMD_SSE2 ) && ( defined( _MSC_VER ) || ( defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) ) ) )
+#define QGS_SIMD_AVX2 1
+#include <immintrin.h>
+#if defined( _MSC_VER )
+// MSVC compiles intrinsics of any instruction set without a target option
+#define QGS_TARGET_AVX2
+#else
+#define QGS_TARGET_AVX2 __attribute__(( target( "avx2" ) ))
+#endif
+#endif
+
+namespace QgsSimd
+{
+
+  /**
+   * Returns true if the CPU and the operating system support AVX2, the
+   * result is computed once. Always false if QGIS was built without the
+   * AVX2 kernels or if they were disabled with the QGIS_DISABLE_SIMD
+   * environment variable, which also disables the SSE2 kernels.
+   */
+  CORE_EXPORT bool hasAvx2();
+
+  /**
+   * Returns true if the SSE2 kernels should be used, i.e. if QGIS was built
+   * with them and they were not disabled with the QGIS_DISABLE_SIMD
+   * environment variable.
+   */
+  CORE_EXPORT bool hasSse2();
+
+}
+
+/// @endcond
+
+#endif // QGSSIMD_P_H
@@ -20,11 +20,25 @@
 #include "qgsfeatureiterator.h"
 #include "qgsrectangle.h"
 #include "qgslogger.h"
+#include "qgspackedspatialindex.h"
+#include "qgsvectorlayer.h"
+#include "qgsvectordataprovider.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QtConcurrentMap>
 
 #include "SpatialIndex.h"
 
+#include <memory>
+
 using namespace SpatialIndex;
 
+//! Number of rectangles queried by each task of a batch query
+static const int BATCH_QUERY_SIZE = 256;
+
 
 
 /** \ingroup core
@@ -143,6 +157,39 @@ class QgsFeatureIteratorDataStream : public IDataStream
 };
 
 
+/** \ingroup core
+ * \class QgsPackedIndexDataStream
+ * \brief Utility class for bulk loading of R-trees from a packed index file. Not a part of public API.
+ * \note not available in Python bindings
+*/
+class QgsPackedIndexDataStream : public IDataStream
+{
+  public:
+    explicit QgsPackedIndexDataStream( const QgsPackedSpatialIndex &index )
+      : mIndex( index )
+    {}
+
+    IData *getNext() override
+    {
+      QgsRectangle rect = mIndex.boundingBox( mNext );
+      double pt1[2] = { rect.xMinimum(), rect.yMinimum() },
+                      pt2[2] = { rect.xMaximum(), rect.yMaximum() };
+      SpatialIndex::Region r( pt1, pt2, 2 );
+      return new RTree::Data( 0, nullptr, r, mIndex.id( mNext++ ) );
+    }
+
+    bool hasNext() override { return mNext < mIndex.count(); }
+
+    uint32_t size() override { return static_cast< uint32_t >( mIndex.count() ); }
+
+    void rewind() override { mNext = 0; }
+
+  private:
+    const QgsPackedSpatialIndex &mIndex;
+    int mNext = 0;
+};
+
+
 /** \ingroup core
  *  \class QgsSpatialIndexData
  * \brief Data of spatial index that may be implicitly shared
@@ -156,15 +203,33 @@ class QgsSpatialIndexData : public QSharedData
       initTree();
     }
 
-    explicit QgsSpatialIndexData( const QgsFeatureIterator &fi )
+    QgsSpatialIndexData( const QgsFeatureIterator &fi, QgsSpatialIndex::Backend backend )
     {
+      if ( backend == QgsSpatialIndex::PackedRTree )
+      {
+        std::shared_ptr< QgsPackedSpatialIndex > packed = std::make_shared< QgsPackedSpatialIndex >();
+        packed->build( fi );
+        mPacked = packed;
+        return;
+      }
+
       QgsFeatureIteratorDataStream fids( fi );
       initTree( &fids );
     }
 
+    explicit QgsSpatialIndexData( const std::shared_ptr< const QgsPackedSpatialIndex > &packed )
+      : mPacked( packed )
+    {
+    }
+
     QgsSpatialIndexData( const QgsSpatialIndexData &other )
       : QSharedData( other )
+      , mPacked( other.mPacked )
     {
+      // the mapped file is read only, copies share it until they are modified
+      if ( mPacked )
+        return;
+
       initTree();
 
       // copy R-tree data one by one (is there a faster way??)
@@ -204,6 +269,31 @@ class QgsSpatialIndexData : public QSharedData
                                         leafCapacity, dimension, variant, indexId );
     }
 
+    /**
+     * Replaces the packed index by a dynamic R-tree holding the same entries,
+     * called before the index is modified.
+     */
+    void unpack()
+    {
+      if ( !mPacked )
+        return;
+
+      if ( mPacked->count() > 0 )
+      {
+        QgsPackedIndexDataStream stream( *mPacked );
+        initTree( &stream );
+      }
+      else
+      {
+        // bulk loading requires at least one entry
+        initTree();
+      }
+      mPacked.reset();
+    }
+
+    //! Packed index, built in memory or mapped from a file, used instead of the R-tree until the index is modified
+    std::shared_ptr< const QgsPackedSpatialIndex > mPacked;
+
     //! Storage manager
     SpatialIndex::IStorageManager *mStorage = nullptr;
 
@@ -223,9 +313,9 @@ QgsSpatialIndex::QgsSpatialIndex()
   d = new QgsSpatialIndexData;
 }
 
-QgsSpatialIndex::QgsSpatialIndex( const QgsFeatureIterator &fi )
+QgsSpatialIndex::QgsSpatialIndex( const QgsFeatureIterator &fi, Backend backend )
 {
-  d = new QgsSpatialIndexData( fi );
+  d = new QgsSpatialIndexData( fi, backend );
 }
 
 QgsSpatialIndex::QgsSpatialIndex( const QgsSpatialIndex &other ) //NOLINT
@@ -271,6 +361,8 @@ bool QgsSpatialIndex::insertFeature( const QgsFeature &f )
   if ( !featureInfo( f, r, id ) )
     return false;
 
+  d->unpack();
+
   // TODO: handle possible exceptions correctly
   try
   {
@@ -302,12 +394,17 @@ bool QgsSpatialIndex::deleteFeature( const QgsFeature &f )
   if ( !featureInfo( f, r, id ) )
     return false;
 
+  d->unpack();
+
   // TODO: handle exceptions
   return d->mRTree->deleteData( r, FID_TO_NUMBER( id ) );
 }
 
 QList<QgsFeatureId> QgsSpatialIndex::intersects( const QgsRectangle &rect ) const
 {
+  if ( d->mPacked )
+    return d->mPacked->intersects( rect );
+
   QList<QgsFeatureId> list;
   QgisVisitor visitor( list );
 
@@ -318,8 +415,40 @@ QList<QgsFeatureId> QgsSpatialIndex::intersects( const QgsRectangle &rect ) cons
   return list;
 }
 
+QVector< QList<QgsFeatureId> > QgsSpatialIndex::intersects( const QVector<QgsRectangle> &rects ) const
+{
+  QVector< QList<QgsFeatureId> > results( rects.count() );
+  if ( !d->mPacked )
+  {
+    // libspatialindex trees do not support concurrent queries
+    for ( int i = 0; i < rects.count(); ++i )
+      results[i] = intersects( rects.at( i ) );
+    return results;
+  }
+
+  // queries are grouped so that tasks are not too small
+  QVector< int > batchStarts;
+  for ( int start = 0; start < rects.count(); start += BATCH_QUERY_SIZE )
+    batchStarts << start;
+
+  const QgsPackedSpatialIndex *packed = d->mPacked.get();
+  const QgsRectangle *rectData = rects.constData();
+  QList<QgsFeatureId> *resultData = results.data();
+  const int count = rects.count();
+  QtConcurrent::blockingMap( batchStarts, [ = ]( int start )
+  {
+    const int end = std::min( start + BATCH_QUERY_SIZE, count );
+    for ( int i = start; i < end; ++i )
+      resultData[i] = packed->intersects( rectData[i] );
+  } );
+  return results;
+}
+
 QList<QgsFeatureId> QgsSpatialIndex::nearestNeighbor( const QgsPoint &point, int neighbors ) const
 {
+  if ( d->mPacked )
+    return d->mPacked->nearestNeighbor( point, neighbors );
+
   QList<QgsFeatureId> list;
   QgisVisitor visitor( list );
 
@@ -331,6 +460,73 @@ QList<QgsFeatureId> QgsSpatialIndex::nearestNeighbor( const QgsPoint &point, int
   return list;
 }
 
+bool QgsSpatialIndex::writeIndexFile( const QString &fileName, const QgsFeatureIterator &fi )
+{
+  return QgsPackedSpatialIndex::write( fileName, fi );
+}
+
+QgsSpatialIndex QgsSpatialIndex::fromIndexFile( const QString &fileName, bool *ok )
+{
+  std::shared_ptr< QgsPackedSpatialIndex > packed = std::make_shared< QgsPackedSpatialIndex >();
+  bool opened = packed->open( fileName );
+  if ( ok )
+    *ok = opened;
+  if ( !opened )
+    return QgsSpatialIndex();
+
+  QgsSpatialIndex index;
+  index.d = new QgsSpatialIndexData( std::shared_ptr< const QgsPackedSpatialIndex >( packed ) );
+  return index;
+}
+
+QString QgsSpatialIndex::indexFileName( const QString &source, const QString &cacheDirectory )
+{
+  // OGR style sources append the layer and subset options after a pipe
+  QFileInfo dataFile( source.section( '|', 0, 0 ) );
+  if ( !dataFile.isFile() )
+    return QString();
+
+  QByteArray hash = QCryptographicHash::hash( source.toUtf8(), QCryptographicHash::Sha1 ).toHex();
+  if ( cacheDirectory.isEmpty() )
+    return QStringLiteral( "%1.%2.qgsidx" ).arg( dataFile.absoluteFilePath(), QString::fromLatin1( hash.left( 8 ) ) );
+
+  return QDir( cacheDirectory ).absoluteFilePath( QStringLiteral( "%1.%2.qgsidx" ).arg( dataFile.completeBaseName(), QString::fromLatin1( hash.left( 16 ) ) ) );
+}
+
+QgsSpatialIndex QgsSpatialIndex::cachedIndex( QgsVectorLayer *layer, const QString &cacheDirectory )
+{
+  if ( !layer || !layer->dataProvider() )
+    return QgsSpatialIndex();
+
+  QgsFeatureRequest request;
+  request.setSubsetOfAttributes( QgsAttributeList() );
+
+  // edits are not stored in the data file, such layers always get a fresh index
+  QString source = layer->source();
+  QString fileName = indexFileName( source + '|' + layer->subsetString(), cacheDirectory );
+  if ( fileName.isEmpty() || layer->isEditable() || layer->isModified() )
+    return QgsSpatialIndex( layer->getFeatures( request ) );
+
+  QFileInfo dataFile( source.section( '|', 0, 0 ) );
+  qint64 stamp = dataFile.lastModified().toMSecsSinceEpoch();
+
+  std::shared_ptr< QgsPackedSpatialIndex > packed = std::make_shared< QgsPackedSpatialIndex >();
+  if ( !packed->open( fileName ) || packed->stamp() != stamp )
+  {
+    // the index file is missing or older than the data
+    packed = std::make_shared< QgsPackedSpatialIndex >();
+    if ( !QgsPackedSpatialIndex::write( fileName, layer->getFeatures( request ), stamp ) || !packed->open( fileName ) )
+    {
+      QgsDebugMsg( QString( "Could not write spatial index file %1" ).arg( fileName ) );
+      return QgsSpatialIndex( layer->getFeatures( request ) );
+    }
+  }
+
+  QgsSpatialIndex index;
+  index.d = new QgsSpatialIndexData( std::shared_ptr< const QgsPackedSpatialIndex >( packed ) );
+  return index;
+}
+
 QAtomicInt QgsSpatialIndex::refs() const
 {
   return d->ref;
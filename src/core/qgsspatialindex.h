@@ -37,11 +37,14 @@ class QgsPoint;
 #include "qgis_core.h"
 #include <QList>
 #include <QSharedDataPointer>
+#include <QString>
+#include <QVector>
 
 #include "qgsfeature.h"
 
 class QgsSpatialIndexData;
 class QgsFeatureIterator;
+class QgsVectorLayer;
 
 /** \ingroup core
  * \class QgsSpatialIndex
@@ -51,6 +54,15 @@ class CORE_EXPORT QgsSpatialIndex
 
   public:
 
+    /** Data structure of an index bulk loaded from features.
+     * @note added in QGIS 3.0
+     */
+    enum Backend
+    {
+      DynamicRTree, //!< R*-tree, efficient for indexes which are modified after they are built
+      PackedRTree, //!< Static R-tree of features sorted along a Hilbert curve, faster to build and to query. Modifying the index first converts it to a dynamic R-tree
+    };
+
     /* creation of spatial index */
 
     //! Constructor - creates R-tree
@@ -58,14 +70,50 @@ class CORE_EXPORT QgsSpatialIndex
 
     /** Constructor - creates R-tree and bulk loads it with features from the iterator.
      * This is much faster approach than creating an empty index and then inserting features one by one.
+     * The PackedRTree backend is best suited to indexes which are only queried,
+     * queries may then run concurrently from several threads.
      *
-     * @note added in 2.8
+     * @note added in 2.8, backend added in QGIS 3.0
      */
-    explicit QgsSpatialIndex( const QgsFeatureIterator &fi );
+    explicit QgsSpatialIndex( const QgsFeatureIterator &fi, Backend backend = DynamicRTree );
 
     //! Copy constructor
     QgsSpatialIndex( const QgsSpatialIndex &other );
 
+    /** Builds the index of the features from the iterator and writes it to an index file,
+     * which can later be opened with fromIndexFile(), also by other processes.
+     * @returns true if the file was written
+     * @note added in QGIS 3.0
+     */
+    static bool writeIndexFile( const QString &fileName, const QgsFeatureIterator &fi );
+
+    /** Opens an index file written by writeIndexFile(). The file is memory mapped, so opening
+     * it is immediate and its pages are shared with other processes using the same file.
+     * The index is read from the file until it is modified with insertFeature() or
+     * deleteFeature(), which first copy it into memory.
+     * @param fileName name of the index file
+     * @param ok set to true if the file was opened, otherwise an empty index is returned
+     * @note added in QGIS 3.0
+     */
+    static QgsSpatialIndex fromIndexFile( const QString &fileName, bool *ok = nullptr );
+
+    /** Returns the index of a layer, stored in an index file which is reused by later calls
+     * as long as the data file of the layer is not modified. Layers which are not file based
+     * or which have unsaved edits get an index built in memory.
+     * @param layer layer to index
+     * @param cacheDirectory directory of the index files, the directory of the data file is
+     * used if empty
+     * @see indexFileName()
+     * @note added in QGIS 3.0
+     */
+    static QgsSpatialIndex cachedIndex( QgsVectorLayer *layer, const QString &cacheDirectory = QString() );
+
+    /** Returns the name of the index file used by cachedIndex() for a data source, or an empty
+     * string if the source is not a file.
+     * @note added in QGIS 3.0
+     */
+    static QString indexFileName( const QString &source, const QString &cacheDirectory = QString() );
+
     //! Destructor finalizes work with spatial index
     ~QgsSpatialIndex();
 
@@ -86,6 +134,14 @@ class CORE_EXPORT QgsSpatialIndex
     //! Returns features that intersect the specified rectangle
     QList<QgsFeatureId> intersects( const QgsRectangle &rect ) const;
 
+    /** Returns for each rectangle the features that intersect it.
+     * With the PackedRTree backend the queries are run concurrently by the threads of
+     * the global thread pool, with a dynamic R-tree they are run one after the other.
+     * @note not available in Python bindings
+     * @note added in QGIS 3.0
+     */
+    QVector< QList<QgsFeatureId> > intersects( const QVector<QgsRectangle> &rects ) const;
+
     //! Returns nearest neighbors (their count is specified by second parameter)
     QList<QgsFeatureId> nearestNeighbor( const QgsPoint &point, int neighbors ) const;
 
@@ -14,6 +14,10 @@
  ***************************************************************************/
 
 #include "qgsstatisticalsummary.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
 #include <limits>
 #include <qmath.h>
 #include <QString>
@@ -25,6 +29,15 @@
  * See details in QEP #17
  ****************************************************************************/
 
+//! Size of the largest compactor of the quantile sketch
+static const int SKETCH_K = 200;
+
+//! Number of bits of the hash used to select a HyperLogLog register
+static const int DISTINCT_PRECISION = 14;
+
+//! Maximum number of frequent value counters
+static const int FREQUENT_COUNTERS = 1024;
+
 QgsStatisticalSummary::QgsStatisticalSummary( Statistics stats )
   : mStatistics( stats )
 {
@@ -46,8 +59,16 @@ void QgsStatisticalSummary::reset()
   mMajority = 0;
   mFirstQuartile = 0;
   mThirdQuartile = 0;
+  mRunningMean = 0;
+  mSquaredDiffSum = 0;
+  mVariety = 0;
   mValueCount.clear();
   mValues.clear();
+  mSketchLevels.clear();
+  mSketchSize = 0;
+  mSketchCoin = false;
+  mDistinctRegisters.clear();
+  mFrequentCounts.clear();
 }
 
 /***************************************************************************
@@ -75,13 +96,31 @@ void QgsStatisticalSummary::addValue( double value )
   mMin = qMin( mMin, value );
   mMax = qMax( mMax, value );
 
-  if ( mStatistics & QgsStatisticalSummary::Majority || mStatistics & QgsStatisticalSummary::Minority || mStatistics & QgsStatisticalSummary::Variety )
+  if ( mApproximate )
+  {
+    if ( mStatistics & QgsStatisticalSummary::Variety )
+      addDistinct( value );
+    if ( mStatistics & QgsStatisticalSummary::Majority )
+      addFrequent( value, 1 );
+  }
+  else if ( mStatistics & QgsStatisticalSummary::Majority || mStatistics & QgsStatisticalSummary::Minority || mStatistics & QgsStatisticalSummary::Variety )
     mValueCount.insert( value, mValueCount.value( value, 0 ) + 1 );
 
-  if ( mStatistics & QgsStatisticalSummary::StDev || mStatistics & QgsStatisticalSummary::StDevSample ||
-       mStatistics & QgsStatisticalSummary::Median || mStatistics & QgsStatisticalSummary::FirstQuartile ||
+  if ( mStatistics & QgsStatisticalSummary::StDev || mStatistics & QgsStatisticalSummary::StDevSample )
+  {
+    double delta = value - mRunningMean;
+    mRunningMean += delta / mCount;
+    mSquaredDiffSum += delta * ( value - mRunningMean );
+  }
+
+  if ( mStatistics & QgsStatisticalSummary::Median || mStatistics & QgsStatisticalSummary::FirstQuartile ||
        mStatistics & QgsStatisticalSummary::ThirdQuartile || mStatistics & QgsStatisticalSummary::InterQuartileRange )
-    mValues << value;
+  {
+    if ( mApproximate )
+      addToSketch( value );
+    else
+      mValues << value;
+  }
 }
 
 void QgsStatisticalSummary::addVariant( const QVariant &value )
@@ -99,6 +138,59 @@ void QgsStatisticalSummary::addVariant( const QVariant &value )
   }
 }
 
+void QgsStatisticalSummary::merge( const QgsStatisticalSummary &other )
+{
+  mMissing += other.mMissing;
+  if ( other.mCount == 0 )
+    return;
+
+  if ( mCount == 0 )
+  {
+    mMin = other.mMin;
+    mMax = other.mMax;
+  }
+  else
+  {
+    mMin = qMin( mMin, other.mMin );
+    mMax = qMax( mMax, other.mMax );
+  }
+
+  // pairwise update of the mean and squared differences, see Chan et al.
+  int count = mCount + other.mCount;
+  double delta = other.mRunningMean - mRunningMean;
+  mSquaredDiffSum += other.mSquaredDiffSum + delta * delta * mCount * other.mCount / count;
+  mRunningMean += delta * other.mCount / count;
+
+  mCount = count;
+  mSum += other.mSum;
+
+  for ( QMap< double, int >::const_iterator it = other.mValueCount.constBegin(); it != other.mValueCount.constEnd(); ++it )
+    mValueCount.insert( it.key(), mValueCount.value( it.key(), 0 ) + it.value() );
+  mValues.append( other.mValues );
+
+  // sketches
+  if ( mSketchLevels.count() < other.mSketchLevels.count() )
+    mSketchLevels.resize( other.mSketchLevels.count() );
+  for ( int level = 0; level < other.mSketchLevels.count(); ++level )
+    mSketchLevels[ level ] += other.mSketchLevels.at( level );
+  mSketchSize += other.mSketchSize;
+  compressSketch();
+
+  if ( mDistinctRegisters.isEmpty() )
+  {
+    mDistinctRegisters = other.mDistinctRegisters;
+  }
+  else if ( !other.mDistinctRegisters.isEmpty() )
+  {
+    for ( int i = 0; i < mDistinctRegisters.count(); ++i )
+      mDistinctRegisters[ i ] = qMax( mDistinctRegisters.at( i ), other.mDistinctRegisters.at( i ) );
+  }
+
+  for ( QHash< double, qint64 >::const_iterator it = other.mFrequentCounts.constBegin(); it != other.mFrequentCounts.constEnd(); ++it )
+    mFrequentCounts[ it.key() ] += it.value();
+  pruneFrequent();
+}
+
 void QgsStatisticalSummary::finalize()
 {
   if ( mCount == 0 )
@@ -113,6 +205,7 @@ void QgsStatisticalSummary::finalize()
     mMajority = std::numeric_limits<double>::quiet_NaN();
     mFirstQuartile = std::numeric_limits<double>::quiet_NaN();
     mThirdQuartile = std::numeric_limits<double>::quiet_NaN();
+    mVariety = 0;
     return;
   }
 
@@ -120,16 +213,44 @@ void QgsStatisticalSummary::finalize()
 
   if ( mStatistics & QgsStatisticalSummary::StDev || mStatistics & QgsStatisticalSummary::StDevSample )
   {
-    double sumSquared = 0;
-    Q_FOREACH ( double value, mValues )
+    mStdev = qPow( mSquaredDiffSum / mCount, 0.5 );
+    mSampleStdev = qPow( mSquaredDiffSum / ( mCount - 1 ), 0.5 );
+  }
+
+  if ( mApproximate )
+  {
+    if ( mStatistics & QgsStatisticalSummary::Median
+         || mStatistics & QgsStatisticalSummary::FirstQuartile
+         || mStatistics & QgsStatisticalSummary::ThirdQuartile
+         || mStatistics & QgsStatisticalSummary::InterQuartileRange )
     {
-      double diff = value - mMean;
-      sumSquared += diff * diff;
+      QList< double > quantiles = sketchQuantiles( QList< double >() << 0.25 << 0.5 << 0.75 );
+      mFirstQuartile = quantiles.at( 0 );
+      mMedian = quantiles.at( 1 );
+      mThirdQuartile = quantiles.at( 2 );
+    }
+
+    mMinority = std::numeric_limits<double>::quiet_NaN();
+    if ( mStatistics & QgsStatisticalSummary::Majority )
+    {
+      qint64 maxCount = 0;
+      for ( QHash< double, qint64 >::const_iterator it = mFrequentCounts.constBegin(); it != mFrequentCounts.constEnd(); ++it )
+      {
+        // ties are resolved towards the smallest value, as in the exact calculation
+        if ( it.value() > maxCount || ( it.value() == maxCount && it.key() < mMajority ) )
+        {
+          maxCount = it.value();
+          mMajority = it.key();
+        }
+      }
     }
-    mStdev = qPow( sumSquared / mValues.count(), 0.5 );
-    mSampleStdev = qPow( sumSquared / ( mValues.count() - 1 ), 0.5 );
+
+    mVariety = mStatistics & QgsStatisticalSummary::Variety ? distinctEstimate() : 0;
+    return;
   }
 
+  mVariety = mValueCount.count();
+
   if ( mStatistics & QgsStatisticalSummary::Median
        || mStatistics & QgsStatisticalSummary::FirstQuartile
        || mStatistics & QgsStatisticalSummary::ThirdQuartile
@@ -260,7 +381,7 @@ double QgsStatisticalSummary::statistic( QgsStatisticalSummary::Statistic stat )
     case Majority:
       return mMajority;
     case Variety:
-      return mValueCount.count();
+      return mVariety;
     case FirstQuartile:
       return mFirstQuartile;
     case ThirdQuartile:
@@ -273,6 +394,193 @@ double QgsStatisticalSummary::statistic( QgsStatisticalSummary::Statistic stat )
   return 0;
 }
 
+//
+// sketches
+//
+
+static int sketchLevelCapacity( int level, int levels )
+{
+  // compactor capacities decrease geometrically towards the lower levels (KLL sketch)
+  int depth = levels - level - 1;
+  return qMax( 2, static_cast< int >( std::ceil( SKETCH_K * std::pow( 2.0 / 3.0, depth ) ) ) );
+}
+
+void QgsStatisticalSummary::addToSketch( double value )
+{
+  if ( mSketchLevels.isEmpty() )
+    mSketchLevels.resize( 1 );
+  mSketchLevels[ 0 ] << value;
+  mSketchSize++;
+  compressSketch();
+}
+
+void QgsStatisticalSummary::compressSketch()
+{
+  Q_FOREVER
+  {
+    int capacity = 0;
+    for ( int level = 0; level < mSketchLevels.count(); ++level )
+      capacity += sketchLevelCapacity( level, mSketchLevels.count() );
+    if ( mSketchSize < capacity )
+      return;
+
+    // compact the lowest full level: sort it and promote every other item, with
+    // twice the weight, to the next level
+    for ( int level = 0; level < mSketchLevels.count(); ++level )
+    {
+      if ( mSketchLevels.at( level ).count() < sketchLevelCapacity( level, mSketchLevels.count() ) )
+        continue;
+
+      if ( level + 1 == mSketchLevels.count() )
+        mSketchLevels.resize( level + 2 );
+
+      QVector< double > &items = mSketchLevels[ level ];
+      QVector< double > &next = mSketchLevels[ level + 1 ];
+      std::sort( items.begin(), items.end() );
+
+      // an odd item out stays at this level. The kept half alternates between compactions,
+      // so that the rank errors cancel out on average
+      int start = items.count() % 2;
+      mSketchCoin = !mSketchCoin;
+      for ( int i = start + ( mSketchCoin ? 1 : 0 ); i < items.count(); i += 2 )
+        next << items.at( i );
+      mSketchSize -= ( items.count() - start ) / 2;
+      items.resize( start );
+      break;
+    }
+  }
+}
+
+QList< double > QgsStatisticalSummary::sketchQuantiles( const QList< double > &fractions ) const
+{
+  QVector< QPair< double, qint64 > > weighted;
+  weighted.reserve( mSketchSize );
+  qint64 totalWeight = 0;
+  for ( int level = 0; level < mSketchLevels.count(); ++level )
+  {
+    qint64 weight = Q_INT64_C( 1 ) << level;
+    Q_FOREACH ( double value, mSketchLevels.at( level ) )
+    {
+      weighted << qMakePair( value, weight );
+      totalWeight += weight;
+    }
+  }
+  std::sort( weighted.begin(), weighted.end() );
+
+  QList< double > quantiles;
+  Q_FOREACH ( double fraction, fractions )
+  {
+    double rank = fraction * totalWeight;
+    qint64 cumulative = 0;
+    double quantile = weighted.isEmpty() ? std::numeric_limits<double>::quiet_NaN() : weighted.last().first;
+    for ( int i = 0; i < weighted.count(); ++i )
+    {
+      cumulative += weighted.at( i ).second;
+      if ( cumulative >= rank )
+      {
+        quantile = weighted.at( i ).first;
+        break;
+      }
+    }
+    quantiles << quantile;
+  }
+  return quantiles;
+}
+
+static quint64 distinctHash( double value )
+{
+  // -0 and 0 are the same value
+  if ( value == 0.0 )
+    value = 0.0;
+  quint64 x;
+  std::memcpy( &x, &value, sizeof( x ) );
+
+  // splitmix64 finalizer
+  x += Q_UINT64_C( 0x9e3779b97f4a7c15 );
+  x = ( x ^ ( x >> 30 ) ) * Q_UINT64_C( 0xbf58476d1ce4e5b9 );
+  x = ( x ^ ( x >> 27 ) ) * Q_UINT64_C( 0x94d049bb133111eb );
+  return x ^ ( x >> 31 );
+}
+
+void QgsStatisticalSummary::addDistinct( double value )
+{
+  if ( mDistinctRegisters.isEmpty() )
+    mDistinctRegisters.fill( 0, 1 << DISTINCT_PRECISION );
+
+  quint64 hash = distinctHash( value );
+  int index = static_cast< int >( hash >> ( 64 - DISTINCT_PRECISION ) );
+
+  // position of the first set bit in the remaining bits
+  quint64 remaining = hash << DISTINCT_PRECISION;
+  quint8 rank = 1;
+  while ( rank <= 64 - DISTINCT_PRECISION && !( remaining & ( Q_UINT64_C( 1 ) << 63 ) ) )
+  {
+    remaining <<= 1;
+    rank++;
+  }
+  if ( rank > mDistinctRegisters.at( index ) )
+    mDistinctRegisters[ index ] = rank;
+}
+
+int QgsStatisticalSummary::distinctEstimate() const
+{
+  if ( mDistinctRegisters.isEmpty() )
+    return 0;
+
+  const double m = mDistinctRegisters.count();
+  double sum = 0;
+  int zeros = 0;
+  Q_FOREACH ( quint8 rank, mDistinctRegisters )
+  {
+    sum += std::ldexp( 1.0, -rank );
+    if ( rank == 0 )
+      zeros++;
+  }
+
+  double alpha = 0.7213 / ( 1 + 1.079 / m );
+  double estimate = alpha * m * m / sum;
+
+  // linear counting is more accurate for small cardinalities
+  if ( estimate <= 2.5 * m && zeros > 0 )
+    estimate = m * std::log( m / zeros );
+
+  return qRound( estimate );
+}
+
+void QgsStatisticalSummary::addFrequent( double value, qint64 count )
+{
+  QHash< double, qint64 >::iterator it = mFrequentCounts.find( value );
+  if ( it != mFrequentCounts.end() )
+  {
+    it.value() += count;
+    return;
+  }
+
+  mFrequentCounts.insert( value, count );
+  pruneFrequent();
+}
+
+void QgsStatisticalSummary::pruneFrequent()
+{
+  if ( mFrequentCounts.count() <= FREQUENT_COUNTERS )
+    return;
+
+  // subtract the count of the first value which does not fit from all counters (Misra-Gries)
+  QList< qint64 > counts = mFrequentCounts.values();
+  std::nth_element( counts.begin(), counts.begin() + FREQUENT_COUNTERS, counts.end(), std::greater< qint64 >() );
+  qint64 threshold = counts.at( FREQUENT_COUNTERS );
+
+  QHash< double, qint64 >::iterator it = mFrequentCounts.begin();
+  while ( it != mFrequentCounts.end() )
+  {
+    it.value() -= threshold;
+    if ( it.value() <= 0 )
+      it = mFrequentCounts.erase( it );
+    else
+      ++it;
+  }
+}
+
 QString QgsStatisticalSummary::displayName( QgsStatisticalSummary::Statistic statistic )
 {
   switch ( statistic )
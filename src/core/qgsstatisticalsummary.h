@@ -18,6 +18,8 @@
 
 #include <QMap>
 #include <QVariant>
+#include <QVector>
+#include <QHash>
 
 #include "qgis_core.h"
 
@@ -36,6 +38,10 @@
  * are calculated by default. Statistics which require slower computations are only calculated by
  * specifying the statistic in the constructor or via @link setStatistics @endlink.
  *
+ * By default the median, quartiles, variety, minority and majority are calculated exactly,
+ * which requires memory proportional to the number of values. For very large inputs
+ * setApproximate() switches to bounded memory estimates of these statistics.
+ *
  * \note Added in version 2.9
  */
 
@@ -86,6 +92,34 @@ class CORE_EXPORT QgsStatisticalSummary
      */
     void setStatistics( Statistics stats ) { mStatistics = stats; }
 
+    /** Sets whether statistics which depend on the distribution of the values are
+     * estimated from bounded memory sketches instead of being calculated exactly. This
+     * must be set before the first value is added.
+     *
+     * In approximate mode:
+     * - the median and quartiles are estimated with a KLL quantile sketch of about 600 values.
+     *   The rank of the returned value differs from the exact rank by less than 2% of the count
+     *   with high probability, and quartiles are rank based rather than Tukey's hinges.
+     * - the variety is estimated with a HyperLogLog counter of 16384 registers, with a relative
+     *   standard error of 0.8%.
+     * - the majority is estimated with 1024 Misra-Gries counters, which finds the most frequent
+     *   value as long as it occurs in more than 1/1025 of the values.
+     * - the minority can not be estimated and is NaN.
+     *
+     * Other statistics are always calculated exactly and in constant memory.
+     * @param approximate set to true to use approximate statistics
+     * @see approximate()
+     * @note added in QGIS 3.0
+     */
+    void setApproximate( bool approximate ) { mApproximate = approximate; }
+
+    /** Returns true if statistics which depend on the distribution of the values are
+     * estimated from bounded memory sketches.
+     * @see setApproximate()
+     * @note added in QGIS 3.0
+     */
+    bool approximate() const { return mApproximate; }
+
     /** Resets the calculated values
      */
     void reset();
@@ -135,6 +169,17 @@ class CORE_EXPORT QgsStatisticalSummary
      */
     void finalize();
 
+    /** Merges the values added to another summary into this summary, as if they had been
+     * added to this summary. This allows partial statistics to be calculated separately
+     * (e.g. in parallel over subsets of features) and combined afterwards. Both summaries
+     * should be set to calculate the same statistics.
+     * @param other summary to merge values from
+     * @note finalize() must be called after merging and before retrieving calculated
+     * statistics.
+     * @note added in QGIS 3.0
+     */
+    void merge( const QgsStatisticalSummary &other );
+
     /** Returns the value of a specified statistic
      * @param stat statistic to return
      * @returns calculated value of statistic. A NaN value may be returned for invalid
@@ -199,7 +244,7 @@ class CORE_EXPORT QgsStatisticalSummary
      * This is only calculated if Statistic::Variety has been specified in the constructor
      * or via setStatistics.
      */
-    int variety() const { return mValueCount.count(); }
+    int variety() const { return mVariety; }
 
     /** Returns minority of values. The minority is the value with least occurrences in the list
      * This is only calculated if Statistic::Minority has been specified in the constructor
@@ -263,8 +308,33 @@ class CORE_EXPORT QgsStatisticalSummary
     double mMajority;
     double mFirstQuartile;
     double mThirdQuartile;
+    //! Running mean and sum of squared differences from the mean (Welford's algorithm)
+    double mRunningMean;
+    double mSquaredDiffSum;
+    int mVariety;
     QMap< double, int > mValueCount;
     QList< double > mValues;
+
+    bool mApproximate = false;
+
+    //! KLL quantile sketch: compactors whose items have a weight of 2^level
+    QVector< QVector< double > > mSketchLevels;
+    int mSketchSize;
+    bool mSketchCoin;
+
+    //! HyperLogLog registers
+    QVector< quint8 > mDistinctRegisters;
+
+    //! Misra-Gries frequent value counters
+    QHash< double, qint64 > mFrequentCounts;
+
+    void addToSketch( double value );
+    void compressSketch();
+    QList< double > sketchQuantiles( const QList< double > &fractions ) const;
+    void addDistinct( double value );
+    int distinctEstimate() const;
+    void addFrequent( double value, qint64 count );
+    void pruneFrequent();
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS( QgsStatisticalSummary::Statistics )
@@ -76,6 +76,20 @@ void QgsStringStatisticalSummary::finalize()
   mMeanLength = mSumLengths / static_cast< double >( mCount );
 }
 
+void QgsStringStatisticalSummary::merge( const QgsStringStatisticalSummary &other )
+{
+  mCount += other.mCount;
+  mCountMissing += other.mCountMissing;
+  mValues.unite( other.mValues );
+  if ( !other.mMin.isEmpty() && ( mMin.isEmpty() || other.mMin < mMin ) )
+    mMin = other.mMin;
+  if ( !other.mMax.isEmpty() && ( mMax.isEmpty() || other.mMax > mMax ) )
+    mMax = other.mMax;
+  mSumLengths += other.mSumLengths;
+  mMinLength = qMin( mMinLength, other.mMinLength );
+  mMaxLength = qMax( mMaxLength, other.mMaxLength );
+}
+
 void QgsStringStatisticalSummary::calculateFromVariants( const QVariantList &values )
 {
   reset();
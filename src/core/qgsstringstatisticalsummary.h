@@ -130,6 +130,17 @@ class CORE_EXPORT QgsStringStatisticalSummary
      */
     void finalize();
 
+    /** Merges the values added to another summary into this summary, as if they had been
+     * added to this summary. This allows partial statistics to be calculated separately
+     * (e.g. in parallel over subsets of features) and combined afterwards. Both summaries
+     * should be set to calculate the same statistics.
+     * @param other summary to merge values from
+     * @note finalize() must be called after merging and before retrieving calculated
+     * statistics.
+     * @note added in QGIS 3.0
+     */
+    void merge( const QgsStringStatisticalSummary &other );
+
     /** Returns the value of a specified statistic
      * @param stat statistic to return
      * @returns calculated value of statistic
@@ -103,6 +103,7 @@ QgsVectorLayerFeatureIterator::QgsVectorLayerFeatureIterator( QgsVectorLayerFeat
   {
     mRequest.expressionContext()->setFields( mSource->mFields );
     mRequest.filterExpression()->prepare( mRequest.expressionContext() );
+    mRequest.filterExpression()->compile();
 
     if ( mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes )
     {
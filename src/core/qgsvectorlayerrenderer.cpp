@@ -17,6 +17,7 @@
 
 #include "diagram/qgsdiagram.h"
 
+#include "qgsapproximatecoordinatetransform.h"
 #include "qgsdiagramrenderer.h"
 #include "qgsgeometrycache.h"
 #include "qgsmessagelog.h"
@@ -245,6 +246,19 @@ bool QgsVectorLayerRenderer::render()
     mContext.setVectorSimplifyMethod( vectorMethod );
   }
 
+  // the geometries only need sub-pixel accuracy, so the transform is interpolated over
+  // the rendered extent instead of calling proj for each vertex
+  const QgsCoordinateTransform ct = mContext.coordinateTransform();
+  if ( mContext.testFlag( QgsRenderContext::UseRenderingOptimization ) && ct.isValid() && !ct.isShortCircuited() )
+  {
+    // same margin as the clipping of the geometries by QgsSymbol
+    const QgsRectangle &e = mContext.extent();
+    const double cw = e.width() / 10;
+    const double ch = e.height() / 10;
+    const QgsRectangle gridExtent( e.xMinimum() - cw, e.yMinimum() - ch, e.xMaximum() + cw, e.yMaximum() + ch );
+    mContext.setApproximateCoordinateTransform( QgsApproximateCoordinateTransform( ct, gridExtent, mContext.mapToPixel().mapUnitsPerPixel() / 4 ) );
+  }
+
   QgsFeatureIterator fit = mSource->getFeatures( featureRequest );
   // Attach an interruption checker so that iterators that have potentially
   // slow fetchFeature() implementations, such as in the WFS provider, can
@@ -262,6 +276,10 @@ bool QgsVectorLayerRenderer::render()
     mRenderer->paintEffect()->end( mContext );
   }
 
+  // the layer is rendered, release the temporary objects in one go
+  mContext.arena().reset();
+  mContext.setApproximateCoordinateTransform( QgsApproximateCoordinateTransform() );
+
   return true;
 }
 
@@ -297,6 +315,9 @@ void QgsVectorLayerRenderer::drawRenderer( QgsFeatureIterator &fit )
       if ( !fet.hasGeometry() )
         continue; // skip features without geometry
 
+      // temporary objects of the feature are released from the arena once it is rendered
+      QgsArenaAllocator::Scope arenaScope( mContext.arena() );
+
       mContext.expressionContext().setFeature( fet );
 
       bool sel = mContext.showSelection() && mSelectedFeatureIds.contains( fet.id() );
@@ -482,6 +503,7 @@ void QgsVectorLayerRenderer::drawRendererLevels( QgsFeatureIterator &fit )
 
         try
         {
+          QgsArenaAllocator::Scope arenaScope( mContext.arena() );
           mRenderer->renderFeature( *fit, mContext, layer, sel, drawMarker );
         }
         catch ( const QgsCsException &cse )
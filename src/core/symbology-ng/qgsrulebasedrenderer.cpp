@@ -16,6 +16,7 @@
 #include "qgsrulebasedrenderer.h"
 #include "qgssymbollayer.h"
 #include "qgsexpression.h"
+#include "qgsexpressionprogram.h"
 #include "qgssymbollayerutils.h"
 #include "qgsrendercontext.h"
 #include "qgsvectorlayer.h"
@@ -409,7 +410,11 @@ bool QgsRuleBasedRenderer::Rule::startRender( QgsRenderContext &context, const Q
 
   // init this rule
   if ( mFilter )
+  {
     mFilter->prepare( &context.expressionContext() );
+    // the filter is evaluated for every feature, use the faster compiled program
+    mFilter->compile();
+  }
   if ( mSymbol )
     mSymbol->startRender( context, fields );
 
@@ -835,16 +840,51 @@ bool QgsRuleBasedRenderer::renderFeature( QgsFeature &feature,
   int flags = ( selected ? FeatIsSelected : 0 ) | ( drawVertexMarker ? FeatDrawMarkers : 0 );
   mCurrentFeatures.append( FeatureToRender( feature, flags ) );
 
+  if ( mSharedFilterValues )
+    mSharedFilterValues->newFeature();
+
   // check each active rule
   return mRootRule->renderFeature( mCurrentFeatures.last(), context, mRenderQueue ) == Rule::Rendered;
 }
 
+///@cond PRIVATE
+//! Collects the filters of the rules which have been prepared in Rule::startRender()
+static void collectActiveFilters( QgsRuleBasedRenderer::Rule *rule, double scale, QList< QgsExpression * > &filters )
+{
+  if ( !rule->active() || !rule->isScaleOK( scale ) )
+    return;
+
+  if ( rule->filter() && !rule->isElse() )
+    filters << rule->filter();
+
+  Q_FOREACH ( QgsRuleBasedRenderer::Rule *child, rule->children() )
+    collectActiveFilters( child, scale, filters );
+}
+///@endcond
+
 
 void QgsRuleBasedRenderer::startRender( QgsRenderContext &context, const QgsFields &fields )
 {
   // prepare active children
   mRootRule->startRender( context, fields, mFilter );
 
+  // rules of large styles often repeat the same subexpressions (e.g. $area or
+  // "type" = 'road'), evaluate them only once per feature for all the rules
+  QList< QgsExpression * > filters;
+  collectActiveFilters( mRootRule, context.rendererScale(), filters );
+  mSharedFilterValues.reset( new QgsExpressionSharedValues() );
+  Q_FOREACH ( QgsExpression *filter, filters )
+    mSharedFilterValues->registerExpression( *filter );
+  if ( mSharedFilterValues->sharedCount() > 0 )
+  {
+    Q_FOREACH ( QgsExpression *filter, filters )
+      filter->compile( mSharedFilterValues.get() );
+  }
+  else
+  {
+    mSharedFilterValues.reset();
+  }
+
   QSet<int> symbolZLevelsSet = mRootRule->collectZLevels();
   QList<int> symbolZLevels = symbolZLevelsSet.toList();
   std::sort( symbolZLevels.begin(), symbolZLevels.end() );
@@ -903,6 +943,16 @@ void QgsRuleBasedRenderer::stopRender( QgsRenderContext &context )
 
   // clean up rules from temporary stuff
   mRootRule->stopRender( context );
+
+  // the filters must not refer to the shared values anymore
+  if ( mSharedFilterValues )
+  {
+    QList< QgsExpression * > filters;
+    collectActiveFilters( mRootRule, context.rendererScale(), filters );
+    Q_FOREACH ( QgsExpression *filter, filters )
+      filter->compile();
+    mSharedFilterValues.reset();
+  }
 }
 
 QString QgsRuleBasedRenderer::filter( const QgsFields & )
@@ -1178,21 +1228,29 @@ QString QgsRuleBasedRenderer::dump() const
 
 bool QgsRuleBasedRenderer::willRenderFeature( QgsFeature &feat, QgsRenderContext &context )
 {
+  if ( mSharedFilterValues )
+    mSharedFilterValues->newFeature();
   return mRootRule->willRenderFeature( feat, &context );
 }
 
 QgsSymbolList QgsRuleBasedRenderer::symbolsForFeature( QgsFeature &feat, QgsRenderContext &context )
 {
+  if ( mSharedFilterValues )
+    mSharedFilterValues->newFeature();
   return mRootRule->symbolsForFeature( feat, &context );
 }
 
 QgsSymbolList QgsRuleBasedRenderer::originalSymbolsForFeature( QgsFeature &feat, QgsRenderContext &context )
 {
+  if ( mSharedFilterValues )
+    mSharedFilterValues->newFeature();
   return mRootRule->symbolsForFeature( feat, &context );
 }
 
 QSet< QString > QgsRuleBasedRenderer::legendKeysForFeature( QgsFeature &feature, QgsRenderContext &context )
 {
+  if ( mSharedFilterValues )
+    mSharedFilterValues->newFeature();
   return mRootRule->legendKeysForFeature( feature, &context );
 }
 
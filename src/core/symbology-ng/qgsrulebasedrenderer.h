@@ -20,10 +20,12 @@
 #include "qgsfields.h"
 #include "qgsfeature.h"
 #include "qgis.h"
+#include <memory>
 
 #include "qgsrenderer.h"
 
 class QgsExpression;
+class QgsExpressionSharedValues;
 
 class QgsCategorizedSymbolRenderer;
 class QgsGraduatedSymbolRenderer;
@@ -482,6 +484,11 @@ class CORE_EXPORT QgsRuleBasedRenderer : public QgsFeatureRenderer
     QList<FeatureToRender> mCurrentFeatures;
 
     QString mFilter;
+
+  private:
+
+    //! Values of the subexpressions shared by the filters of the active rules while rendering
+    std::unique_ptr< QgsExpressionSharedValues > mSharedFilterValues;
 };
 
 #endif // QGSRULEBASEDRENDERERV2_H
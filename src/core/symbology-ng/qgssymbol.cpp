@@ -38,6 +38,7 @@
 #include "qgslinestring.h"
 #include "qgspolygon.h"
 #include "qgsclipper.h"
+#include "qgswkbgeometryview.h"
 #include "qgsproperty.h"
 
 #include <QColor>
@@ -46,8 +47,29 @@
 #include <QSize>
 #include <QSvgGenerator>
 
+#include <algorithm>
 #include <cmath>
-#include <map>
+
+///@cond PRIVATE
+
+//! Transforms points to the map CRS, with the approximate transform of the context if it has one
+static void transformToMapCrs( const QgsRenderContext &context, QPolygonF &points )
+{
+  const QgsApproximateCoordinateTransform &approximateTransform = context.approximateCoordinateTransform();
+  if ( approximateTransform.isValid() )
+  {
+    approximateTransform.transformPolygon( points );
+    return;
+  }
+
+  const QgsCoordinateTransform ct = context.coordinateTransform();
+  if ( ct.isValid() )
+  {
+    ct.transformPolygon( points );
+  }
+}
+
+///@endcond
 
 inline
 QgsProperty rotateWholeSymbol( double additionalRotation, const QgsProperty &property )
@@ -105,7 +127,6 @@ QPolygonF QgsSymbol::_getLineString( QgsRenderContext &context, const QgsCurve &
 {
   const unsigned int nPoints = curve.numPoints();
 
-  QgsCoordinateTransform ct = context.coordinateTransform();
   const QgsMapToPixel &mtp = context.mapToPixel();
   QPolygonF pts;
 
@@ -124,23 +145,15 @@ QPolygonF QgsSymbol::_getLineString( QgsRenderContext &context, const QgsCurve &
   }
 
   //transform the QPolygonF to screen coordinates
-  if ( ct.isValid() )
-  {
-    ct.transformPolygon( pts );
-  }
+  transformToMapCrs( context, pts );
 
-  QPointF *ptr = pts.data();
-  for ( int i = 0; i < pts.size(); ++i, ++ptr )
-  {
-    mtp.transformInPlace( ptr->rx(), ptr->ry() );
-  }
+  mtp.transformInPlace( pts.data(), pts.size() );
 
   return pts;
 }
 
 QPolygonF QgsSymbol::_getPolygonRing( QgsRenderContext &context, const QgsCurve &curve, bool clipToExtent )
 {
-  const QgsCoordinateTransform ct = context.coordinateTransform();
   const QgsMapToPixel &mtp = context.mapToPixel();
   const QgsRectangle &e = context.extent();
   const double cw = e.width() / 10;
@@ -156,20 +169,13 @@ QPolygonF QgsSymbol::_getPolygonRing( QgsRenderContext &context, const QgsCurve
   const QRectF ptsRect = poly.boundingRect();
   if ( clipToExtent && !context.extent().contains( ptsRect ) )
   {
-    QgsClipper::trimPolygon( poly, clipRect );
+    QgsClipper::trimPolygon( poly, clipRect, context.arena() );
   }
 
   //transform the QPolygonF to screen coordinates
-  if ( ct.isValid() )
-  {
-    ct.transformPolygon( poly );
-  }
+  transformToMapCrs( context, poly );
 
-  QPointF *ptr = poly.data();
-  for ( int i = 0; i < poly.size(); ++i, ++ptr )
-  {
-    mtp.transformInPlace( ptr->rx(), ptr->ry() );
-  }
+  mtp.transformInPlace( poly.data(), poly.size() );
 
   return poly;
 }
@@ -643,6 +649,153 @@ bool QgsSymbol::hasDataDefinedProperties() const
   return false;
 }
 
+///@cond PRIVATE
+
+//! Transforms a ring read from a WKB view to screen coordinates, clipping it if needed
+static void wkbRingToScreen( QPolygonF &ring, QgsRenderContext &context, bool isPolygonRing, bool clipToExtent )
+{
+  const QgsRectangle &e = context.extent();
+  const double cw = e.width() / 10;
+  const double ch = e.height() / 10;
+  const QgsRectangle clipRect( e.xMinimum() - cw, e.yMinimum() - ch, e.xMaximum() + cw, e.yMaximum() + ch );
+
+  if ( isPolygonRing )
+  {
+    if ( clipToExtent && !ring.isEmpty() && !e.contains( ring.boundingRect() ) )
+      QgsClipper::trimPolygon( ring, clipRect, context.arena() );
+  }
+  else if ( clipToExtent && ring.size() > 1 )
+  {
+    ring = QgsClipper::clippedLine( ring, clipRect );
+  }
+
+  transformToMapCrs( context, ring );
+
+  const QgsMapToPixel &mtp = context.mapToPixel();
+  mtp.transformInPlace( ring.data(), ring.size() );
+}
+
+///@endcond
+
+bool QgsSymbol::renderWkbView( const QgsWkbGeometryView &view, const QgsFeature &feature, QgsRenderContext &context, int layer, bool selected )
+{
+  const QgsWkbTypes::GeometryType geometryType = QgsWkbTypes::geometryType( view.wkbType() );
+  if ( ( geometryType == QgsWkbTypes::PointGeometry && mType != QgsSymbol::Marker )
+       || ( geometryType == QgsWkbTypes::LineGeometry && mType != QgsSymbol::Line )
+       || ( geometryType == QgsWkbTypes::PolygonGeometry && mType != QgsSymbol::Fill ) )
+  {
+    // let the generic code report the mismatch
+    return false;
+  }
+
+  // symbol layers relying on the geometry of the render context handle a null geometry
+  context.setGeometry( nullptr );
+  const bool clipToExtent = !context.testFlag( QgsRenderContext::RenderMapTile ) && clipFeaturesToExtent();
+  const bool isMulti = QgsWkbTypes::isMultiType( view.wkbType() );
+  const int partCount = view.partCount();
+
+  mSymbolRenderContext->setGeometryPartCount( partCount );
+  mSymbolRenderContext->setGeometryPartNum( 1 );
+
+  if ( mSymbolRenderContext->expressionContextScope() )
+  {
+    context.expressionContext().appendScope( mSymbolRenderContext->expressionContextScope() );
+    QgsExpressionContextUtils::updateSymbolScope( this, mSymbolRenderContext->expressionContextScope() );
+    mSymbolRenderContext->expressionContextScope()->addVariable( QgsExpressionContextScope::StaticVariable( QgsExpressionContext::EXPR_GEOMETRY_PART_COUNT, partCount, true ) );
+    mSymbolRenderContext->expressionContextScope()->addVariable( QgsExpressionContextScope::StaticVariable( QgsExpressionContext::EXPR_GEOMETRY_PART_NUM, 1, true ) );
+  }
+
+  // draw polygons starting with larger parts down to smaller parts, so that in
+  // case of a part being incorrectly inside another part, it is drawn on top of it (#15419)
+  QgsArenaAllocator::Scope arenaScope( context.arena() );
+  int *partOrder = context.arena().allocateArray<int>( partCount );
+  double *partAreas = context.arena().allocateArray<double>( partCount );
+  QVector< QList< QPolygonF > > partRings( partCount );
+  for ( int i = 0; i < partCount; ++i )
+  {
+    partOrder[i] = i;
+    partAreas[i] = 0.0;
+    partRings[i] = view.partRings( i );
+    if ( geometryType == QgsWkbTypes::PolygonGeometry && isMulti && !partRings.at( i ).isEmpty() )
+    {
+      const QRectF r = partRings.at( i ).at( 0 ).boundingRect();
+      partAreas[i] = r.width() * r.height();
+    }
+  }
+  if ( geometryType == QgsWkbTypes::PolygonGeometry && isMulti )
+  {
+    std::stable_sort( partOrder, partOrder + partCount, [partAreas]( int a, int b ) { return partAreas[a] > partAreas[b]; } );
+  }
+
+  for ( int orderIndex = 0; orderIndex < partCount; ++orderIndex )
+  {
+    const int i = partOrder[orderIndex];
+    if ( isMulti )
+    {
+      mSymbolRenderContext->setGeometryPartNum( i + 1 );
+      if ( mSymbolRenderContext->expressionContextScope() )
+        mSymbolRenderContext->expressionContextScope()->addVariable( QgsExpressionContextScope::StaticVariable( QgsExpressionContext::EXPR_GEOMETRY_PART_NUM, i + 1, true ) );
+    }
+
+    QList< QPolygonF > &rings = partRings[i];
+    switch ( geometryType )
+    {
+      case QgsWkbTypes::PointGeometry:
+      {
+        QPolygonF &point = rings[0];
+        wkbRingToScreen( point, context, false, false );
+        const QPointF pt = point.at( 0 );
+        static_cast<QgsMarkerSymbol *>( this )->renderPoint( pt, &feature, context, layer, selected );
+
+        if ( !isMulti && context.testFlag( QgsRenderContext::DrawSymbolBounds ) )
+        {
+          //draw debugging rect
+          context.painter()->setPen( Qt::red );
+          context.painter()->setBrush( QColor( 255, 0, 0, 100 ) );
+          context.painter()->drawRect( static_cast<QgsMarkerSymbol *>( this )->bounds( pt, context, feature ) );
+        }
+        break;
+      }
+
+      case QgsWkbTypes::LineGeometry:
+      {
+        QPolygonF &line = rings[0];
+        wkbRingToScreen( line, context, false, clipToExtent );
+        static_cast<QgsLineSymbol *>( this )->renderPolyline( line, &feature, context, layer, selected );
+        break;
+      }
+
+      case QgsWkbTypes::PolygonGeometry:
+      {
+        if ( rings.isEmpty() )
+        {
+          QgsDebugMsg( "cannot render polygon with no exterior ring" );
+          break;
+        }
+
+        QPolygonF &exterior = rings[0];
+        wkbRingToScreen( exterior, context, true, clipToExtent );
+        QList< QPolygonF > holes;
+        for ( int ring = 1; ring < rings.count(); ++ring )
+        {
+          wkbRingToScreen( rings[ring], context, true, clipToExtent );
+          if ( !rings.at( ring ).isEmpty() )
+            holes << rings.at( ring );
+        }
+        static_cast<QgsFillSymbol *>( this )->renderPolygon( exterior, ( !holes.isEmpty() ? &holes : nullptr ), &feature, context, layer, selected );
+        break;
+      }
+
+      default:
+        break;
+    }
+  }
+
+  if ( mSymbolRenderContext->expressionContextScope() )
+    context.expressionContext().popScope();
+  return true;
+}
+
 void QgsSymbol::renderFeature( const QgsFeature &feature, QgsRenderContext &context, int layer, bool selected, bool drawVertexMarker, int currentVertexMarkerType, int currentVertexMarkerSize )
 {
   QgsGeometry geom = feature.geometry();
@@ -651,6 +804,19 @@ void QgsSymbol::renderFeature( const QgsFeature &feature, QgsRenderContext &cont
     return;
   }
 
+  // geometries which were not parsed yet are rendered from their WKB, unless the
+  // object tree is needed anyway for the vertex markers or the local simplification
+  const QgsVectorSimplifyMethod &simplifyMethod = context.vectorSimplifyMethod();
+  const bool simplifyLocally = simplifyMethod.forceLocalOptimization() && simplifyMethod.simplifyHints() != QgsVectorSimplifyMethod::NoSimplification;
+  if ( !drawVertexMarker && !simplifyLocally )
+  {
+    const QgsWkbGeometryView view = geom.wkbView();
+    if ( view.isValid() && renderWkbView( view, feature, context, layer, selected ) )
+    {
+      return;
+    }
+  }
+
   QgsGeometry segmentizedGeometry = geom;
   bool usingSegmentizedGeometry = false;
   context.setGeometry( geom.geometry() );
@@ -852,48 +1018,47 @@ void QgsSymbol::renderFeature( const QgsFeature &feature, QgsRenderContext &cont
       const unsigned int num = geomCollection.numGeometries();
 
       // Sort components by approximate area (probably a bit faster than using
-      // area() )
-      std::map<double, QList<unsigned int> > mapAreaToPartNum;
+      // area() ), in temporary arrays of the render arena
+      QgsArenaAllocator::Scope arenaScope( context.arena() );
+      unsigned int *partOrder = context.arena().allocateArray<unsigned int>( num );
+      double *partAreas = context.arena().allocateArray<double>( num );
       for ( unsigned int i = 0; i < num; ++i )
       {
         const QgsPolygonV2 &polygon = dynamic_cast<const QgsPolygonV2 &>( *geomCollection.geometryN( i ) );
         const QgsRectangle r( polygon.boundingBox() );
-        mapAreaToPartNum[ r.width() * r.height()] << i;
+        partOrder[i] = i;
+        partAreas[i] = r.width() * r.height();
       }
 
       // Draw starting with larger parts down to smaller parts, so that in
       // case of a part being incorrectly inside another part, it is drawn
       // on top of it (#15419)
-      std::map<double, QList<unsigned int> >::const_reverse_iterator iter = mapAreaToPartNum.rbegin();
-      for ( ; iter != mapAreaToPartNum.rend(); ++iter )
+      std::stable_sort( partOrder, partOrder + num, [partAreas]( unsigned int a, unsigned int b ) { return partAreas[a] > partAreas[b]; } );
+      for ( unsigned int idx = 0; idx < num; ++idx )
       {
-        const QList<unsigned int> &listPartIndex = iter->second;
-        for ( int idx = 0; idx < listPartIndex.size(); ++idx )
-        {
-          const unsigned i = listPartIndex[idx];
-          mSymbolRenderContext->setGeometryPartNum( i + 1 );
-          mSymbolRenderContext->expressionContextScope()->addVariable( QgsExpressionContextScope::StaticVariable( QgsExpressionContext::EXPR_GEOMETRY_PART_NUM, i + 1, true ) );
+        const unsigned i = partOrder[idx];
+        mSymbolRenderContext->setGeometryPartNum( i + 1 );
+        mSymbolRenderContext->expressionContextScope()->addVariable( QgsExpressionContextScope::StaticVariable( QgsExpressionContext::EXPR_GEOMETRY_PART_NUM, i + 1, true ) );
+
+        context.setGeometry( geomCollection.geometryN( i ) );
+        const QgsPolygonV2 &polygon = dynamic_cast<const QgsPolygonV2 &>( *geomCollection.geometryN( i ) );
+        _getPolygon( pts, holes, context, polygon, !tileMapRendering && clipFeaturesToExtent() );
+        static_cast<QgsFillSymbol *>( this )->renderPolygon( pts, ( !holes.isEmpty() ? &holes : nullptr ), &feature, context, layer, selected );
 
-          context.setGeometry( geomCollection.geometryN( i ) );
-          const QgsPolygonV2 &polygon = dynamic_cast<const QgsPolygonV2 &>( *geomCollection.geometryN( i ) );
-          _getPolygon( pts, holes, context, polygon, !tileMapRendering && clipFeaturesToExtent() );
-          static_cast<QgsFillSymbol *>( this )->renderPolygon( pts, ( !holes.isEmpty() ? &holes : nullptr ), &feature, context, layer, selected );
+        if ( drawVertexMarker && !usingSegmentizedGeometry )
+        {
+          if ( i == 0 )
+          {
+            markers = pts;
+          }
+          else
+          {
+            markers << pts;
+          }
 
-          if ( drawVertexMarker && !usingSegmentizedGeometry )
+          Q_FOREACH ( const QPolygonF &hole, holes )
           {
-            if ( i == 0 )
-            {
-              markers = pts;
-            }
-            else
-            {
-              markers << pts;
-            }
-
-            Q_FOREACH ( const QPolygonF &hole, holes )
-            {
-              markers << hole;
-            }
+            markers << hole;
           }
         }
       }
@@ -50,6 +50,7 @@ class QgsSymbolRenderContext;
 class QgsFeatureRenderer;
 class QgsCurve;
 class QgsPolygonV2;
+class QgsWkbGeometryView;
 class QgsExpressionContext;
 
 typedef QList<QgsSymbolLayer *> QgsSymbolLayerList;
@@ -365,6 +366,12 @@ class CORE_EXPORT QgsSymbol
     //! Initialized in startRender, destroyed in stopRender
     QgsSymbolRenderContext *mSymbolRenderContext = nullptr;
 
+    /**
+     * Renders a feature directly from the WKB view of its geometry, without parsing it.
+     * @returns false if the geometry cannot be rendered with this symbol
+     */
+    bool renderWkbView( const QgsWkbGeometryView &view, const QgsFeature &feature, QgsRenderContext &context, int layer, bool selected );
+
     Q_DISABLE_COPY( QgsSymbol )
 
 };
@@ -0,0 +1,147 @@
+/***************************************************************************
+                 qgsbenchlabeling.cpp  - Label placement benchmark
+                             -------------------
+    begin                : February 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QObject>
+#include <QPainter>
+#include <QScopedPointer>
+#include <QThread>
+#include <QThreadPool>
+
+#include "qgstest.h"
+
+#include "qgsapplication.h"
+#include "qgsfeature.h"
+#include "qgsgeometry.h"
+#include "qgslabelingengine.h"
+#include "qgsmapsettings.h"
+#include "qgsrendercontext.h"
+#include "qgsvectorlayer.h"
+#include "qgsvectordataprovider.h"
+#include "qgsvectorlayerlabelprovider.h"
+
+/**
+ * Benchmark of QgsLabelingEngine::run() on a dense point layer, where most labels
+ * are in conflict with others, like in a WMS GetMap at a small scale.
+ *
+ * Run with e.g. "qgis_bench_labeling -iterations 3" and see tests/bench/README
+ * for the available QTestLib benchmark options.
+ */
+class QgsBenchLabeling : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void labeling_data();
+    void labeling();
+
+  private:
+    //! Layer of randomly placed, labeled points
+    static QgsVectorLayer *createLayer( int count );
+
+    int mMaxThreadCount = 1;
+};
+
+void QgsBenchLabeling::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+  mMaxThreadCount = QThreadPool::globalInstance()->maxThreadCount();
+}
+
+void QgsBenchLabeling::cleanupTestCase()
+{
+  QThreadPool::globalInstance()->setMaxThreadCount( mMaxThreadCount );
+  QgsApplication::exitQgis();
+}
+
+QgsVectorLayer *QgsBenchLabeling::createLayer( int count )
+{
+  QgsVectorLayer *layer = new QgsVectorLayer( QStringLiteral( "Point?crs=EPSG:3857&field=name:string" ), QStringLiteral( "dense" ), QStringLiteral( "memory" ) );
+  QgsFeatureList features;
+  quint32 seed = 42;
+  for ( int i = 0; i < count; ++i )
+  {
+    seed = seed * 1103515245 + 12345;
+    const double x = ( seed >> 8 ) % 1000000;
+    seed = seed * 1103515245 + 12345;
+    const double y = ( seed >> 8 ) % 1000000;
+    QgsFeature f( layer->fields() );
+    f.setAttribute( 0, QStringLiteral( "label %1" ).arg( i ) );
+    f.setGeometry( QgsGeometry::fromPoint( QgsPoint( x, y ) ) );
+    features << f;
+  }
+  layer->dataProvider()->addFeatures( features );
+
+  layer->setCustomProperty( QStringLiteral( "labeling" ), "pal" );
+  layer->setCustomProperty( QStringLiteral( "labeling/enabled" ), true );
+  layer->setCustomProperty( QStringLiteral( "labeling/fieldName" ), "name" );
+  layer->setCustomProperty( QStringLiteral( "labeling/fontSize" ), 9 );
+  return layer;
+}
+
+void QgsBenchLabeling::labeling_data()
+{
+  QTest::addColumn<int>( "count" );
+  QTest::addColumn<int>( "searchMethod" );
+  QTest::addColumn<bool>( "parallel" );
+
+  QTest::newRow( "20000 points, chain, sequential" ) << 20000 << static_cast< int >( QgsPalLabeling::Chain ) << false;
+  QTest::newRow( "20000 points, chain, parallel" ) << 20000 << static_cast< int >( QgsPalLabeling::Chain ) << true;
+  QTest::newRow( "20000 points, falp, sequential" ) << 20000 << static_cast< int >( QgsPalLabeling::Falp ) << false;
+  QTest::newRow( "20000 points, falp, parallel" ) << 20000 << static_cast< int >( QgsPalLabeling::Falp ) << true;
+  QTest::newRow( "100000 points, chain, parallel" ) << 100000 << static_cast< int >( QgsPalLabeling::Chain ) << true;
+}
+
+void QgsBenchLabeling::labeling()
+{
+  QFETCH( int, count );
+  QFETCH( int, searchMethod );
+  QFETCH( bool, parallel );
+
+  QScopedPointer< QgsVectorLayer > layer( createLayer( count ) );
+
+  QgsMapSettings mapSettings;
+  mapSettings.setOutputSize( QSize( 1600, 1200 ) );
+  mapSettings.setExtent( layer->extent() );
+  mapSettings.setLayers( QList<QgsMapLayer *>() << layer.data() );
+  mapSettings.setOutputDpi( 96 );
+
+  QThreadPool::globalInstance()->setMaxThreadCount( parallel ? QThread::idealThreadCount() : 1 );
+
+  QImage img( mapSettings.outputSize(), QImage::Format_ARGB32_Premultiplied );
+  QBENCHMARK
+  {
+    img.fill( 0 );
+    QPainter p( &img );
+    QgsRenderContext context = QgsRenderContext::fromMapSettings( mapSettings );
+    context.setPainter( &p );
+
+    QgsLabelingEngine engine;
+    engine.setMapSettings( mapSettings );
+    engine.setSearchMethod( static_cast< QgsPalLabeling::Search >( searchMethod ) );
+    engine.setFlag( QgsLabelingEngine::SolveInParallel, parallel );
+    engine.addProvider( new QgsVectorLayerLabelProvider( layer.data(), QString() ) );
+    engine.run( context );
+    p.end();
+  }
+
+  QThreadPool::globalInstance()->setMaxThreadCount( mMaxThreadCount );
+}
+
+QGSTEST_MAIN( QgsBenchLabeling )
+#include "qgsbenchlabeling.moc"
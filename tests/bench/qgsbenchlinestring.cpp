@@ -0,0 +1,164 @@
+/***************************************************************************
+                 qgsbenchlinestring.cpp  - Line string benchmark
+                             -------------------
+    begin                : February 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QObject>
+#include <QtMath>
+
+#include "qgstest.h"
+
+#include "qgsapplication.h"
+#include "qgscoordinatereferencesystem.h"
+#include "qgscoordinatetransform.h"
+#include "qgsgeometry.h"
+#include "qgsgeos.h"
+#include "qgslinestring.h"
+#include "qgsmaptopixelgeometrysimplifier.h"
+#include "qgspointv2.h"
+
+/**
+ * Benchmark of the operations of QgsLineString which walk over all its vertices:
+ * conversion to QPolygonF, simplification for rendering, conversion to GEOS and
+ * reprojection, for 2D and ZM line strings.
+ *
+ * Run with e.g. "qgis_bench_linestring -iterations 10" and see tests/bench/README
+ * for the available QTestLib benchmark options.
+ */
+class QgsBenchLineString : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void asQPolygonF_data() { addRows(); }
+    void asQPolygonF();
+    void simplify_data() { addRows(); }
+    void simplify();
+    void asGeos_data() { addRows(); }
+    void asGeos();
+    void transform_data() { addRows(); }
+    void transform();
+
+  private:
+    static void addRows();
+    //! Spiral line string with the given number of vertices
+    static QgsLineString *createLine( int vertices, bool zm );
+};
+
+void QgsBenchLineString::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+}
+
+void QgsBenchLineString::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void QgsBenchLineString::addRows()
+{
+  QTest::addColumn<int>( "vertices" );
+  QTest::addColumn<bool>( "zm" );
+
+  QList< int > vertexCounts;
+  vertexCounts << 1000 << 1000000;
+  Q_FOREACH ( int vertices, vertexCounts )
+  {
+    QTest::newRow( QStringLiteral( "%1 vertices, XY" ).arg( vertices ).toLocal8Bit().constData() ) << vertices << false;
+    QTest::newRow( QStringLiteral( "%1 vertices, XYZM" ).arg( vertices ).toLocal8Bit().constData() ) << vertices << true;
+  }
+}
+
+QgsLineString *QgsBenchLineString::createLine( int vertices, bool zm )
+{
+  QgsPointSequence points;
+  points.reserve( vertices );
+  for ( int i = 0; i < vertices; ++i )
+  {
+    const double angle = 0.01 * i;
+    const double radius = 0.0001 * i;
+    if ( zm )
+      points << QgsPointV2( QgsWkbTypes::PointZM, radius * std::cos( angle ), radius * std::sin( angle ), i, i );
+    else
+      points << QgsPointV2( radius * std::cos( angle ), radius * std::sin( angle ) );
+  }
+  QgsLineString *line = new QgsLineString();
+  line->setPoints( points );
+  return line;
+}
+
+void QgsBenchLineString::asQPolygonF()
+{
+  QFETCH( int, vertices );
+  QFETCH( bool, zm );
+
+  std::unique_ptr< QgsLineString > line( createLine( vertices, zm ) );
+  QPolygonF polygon;
+  QBENCHMARK
+  {
+    polygon = line->asQPolygonF();
+  }
+  QCOMPARE( polygon.count(), vertices );
+}
+
+void QgsBenchLineString::simplify()
+{
+  QFETCH( int, vertices );
+  QFETCH( bool, zm );
+
+  QgsGeometry geometry( createLine( vertices, zm ) );
+  QgsMapToPixelSimplifier simplifier( QgsMapToPixelSimplifier::SimplifyGeometry, 0.001 );
+  QgsGeometry simplified;
+  QBENCHMARK
+  {
+    simplified = simplifier.simplify( geometry );
+  }
+  QVERIFY( !simplified.isNull() );
+}
+
+void QgsBenchLineString::asGeos()
+{
+  QFETCH( int, vertices );
+  QFETCH( bool, zm );
+
+  std::unique_ptr< QgsLineString > line( createLine( vertices, zm ) );
+  QBENCHMARK
+  {
+    GEOSGeometry *geos = QgsGeos::asGeos( line.get() );
+    QVERIFY( geos );
+    GEOSGeom_destroy_r( QgsGeos::getGEOSHandler(), geos );
+  }
+}
+
+void QgsBenchLineString::transform()
+{
+  QFETCH( int, vertices );
+  QFETCH( bool, zm );
+
+  std::unique_ptr< QgsLineString > line( createLine( vertices, zm ) );
+  QgsCoordinateTransform forward( QgsCoordinateReferenceSystem::fromEpsgId( 4326 ), QgsCoordinateReferenceSystem::fromEpsgId( 3857 ) );
+  QBENCHMARK
+  {
+    // back and forth, so that each iteration transforms the same coordinates
+    line->transform( forward );
+    line->transform( forward, QgsCoordinateTransform::ReverseTransform );
+  }
+  QCOMPARE( line->numPoints(), vertices );
+}
+
+QGSTEST_MAIN( QgsBenchLineString )
+#include "qgsbenchlinestring.moc"
@@ -0,0 +1,191 @@
+/***************************************************************************
+                 qgsbenchmaptopixel.cpp  - Vertex transform and clipping benchmark
+                             -------------------
+    begin                : February 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPolygonF>
+#include <QtMath>
+
+#include "qgstest.h"
+
+#include "qgsarenaallocator.h"
+#include "qgsclipper.h"
+#include "qgsmaptopixel.h"
+
+/**
+ * Benchmark of the per vertex work of rendering: transformation of map coordinates
+ * to pixels, one vertex at a time and in batches, and clipping of polygons and lines.
+ * Besides the QTestLib timing, the throughput of each row is printed in vertices per second.
+ *
+ * The batched code uses SSE2 or AVX2 when available, run with the QGIS_DISABLE_SIMD
+ * environment variable set to measure the scalar code, e.g.
+ * "QGIS_DISABLE_SIMD=1 qgis_bench_maptopixel -iterations 100". See tests/bench/README
+ * for the available QTestLib benchmark options.
+ */
+class QgsBenchMapToPixel : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void transform_data();
+    void transform();
+    void trimPolygon_data();
+    void trimPolygon();
+    void clippedLine_data();
+    void clippedLine();
+
+  private:
+    //! Star shaped polygon around (500, 500), reaching outside of a 1000 x 1000 extent if large
+    static QPolygonF createPolygon( int vertices, bool large );
+    static void reportThroughput( const QElapsedTimer &timer, int iterations, int vertices );
+};
+
+QPolygonF QgsBenchMapToPixel::createPolygon( int vertices, bool large )
+{
+  QPolygonF polygon;
+  polygon.reserve( vertices );
+  for ( int i = 0; i < vertices; ++i )
+  {
+    const double angle = 2 * M_PI * i / vertices;
+    const double radius = ( i % 2 ? 400 : 300 ) * ( large ? 1.5 : 1 );
+    polygon << QPointF( 500 + radius * std::cos( angle ), 500 + radius * std::sin( angle ) );
+  }
+  return polygon;
+}
+
+void QgsBenchMapToPixel::reportThroughput( const QElapsedTimer &timer, int iterations, int vertices )
+{
+  const double seconds = timer.nsecsElapsed() / 1e9;
+  if ( seconds > 0 )
+    qDebug( "%.1f million vertices per second", static_cast< double >( iterations ) * vertices / seconds / 1e6 );
+}
+
+void QgsBenchMapToPixel::transform_data()
+{
+  QTest::addColumn<double>( "rotation" );
+  QTest::addColumn<bool>( "batched" );
+
+  QTest::newRow( "no rotation, per vertex" ) << 0.0 << false;
+  QTest::newRow( "no rotation, batched" ) << 0.0 << true;
+  QTest::newRow( "rotation, per vertex" ) << 30.0 << false;
+  QTest::newRow( "rotation, batched" ) << 30.0 << true;
+}
+
+void QgsBenchMapToPixel::transform()
+{
+  QFETCH( double, rotation );
+  QFETCH( bool, batched );
+
+  const int vertices = 1000000;
+  const QgsMapToPixel mtp( 0.5, 500, 500, 2000, 2000, rotation );
+  const QPolygonF source = createPolygon( vertices, false );
+  QPolygonF points = source;
+
+  int iterations = 0;
+  QElapsedTimer timer;
+  timer.start();
+  QBENCHMARK
+  {
+    // transforming again the output of the previous iteration keeps the coordinates
+    // finite over the iterations of the benchmark, as the scale is 2
+    if ( iterations % 16 == 0 )
+      points = source;
+    if ( batched )
+    {
+      mtp.transformInPlace( points.data(), points.size() );
+    }
+    else
+    {
+      QPointF *ptr = points.data();
+      for ( int i = 0; i < points.size(); ++i, ++ptr )
+        mtp.transformInPlace( ptr->rx(), ptr->ry() );
+    }
+    ++iterations;
+  }
+  reportThroughput( timer, iterations, vertices );
+}
+
+void QgsBenchMapToPixel::trimPolygon_data()
+{
+  QTest::addColumn<int>( "vertices" );
+  QTest::addColumn<bool>( "large" );
+
+  QList< int > vertexCounts;
+  vertexCounts << 100 << 100000;
+  Q_FOREACH ( int vertices, vertexCounts )
+  {
+    QTest::newRow( QStringLiteral( "%1 vertices, inside" ).arg( vertices ).toLocal8Bit().constData() ) << vertices << false;
+    QTest::newRow( QStringLiteral( "%1 vertices, crossing" ).arg( vertices ).toLocal8Bit().constData() ) << vertices << true;
+  }
+}
+
+void QgsBenchMapToPixel::trimPolygon()
+{
+  QFETCH( int, vertices );
+  QFETCH( bool, large );
+
+  const QgsRectangle clipRect( 0, 0, 1000, 1000 );
+  const QPolygonF source = createPolygon( vertices, large );
+  QgsArenaAllocator arena;
+
+  // enough calls per iteration for the small polygons to be measurable
+  const int repeat = 1000000 / vertices;
+  int iterations = 0;
+  QElapsedTimer timer;
+  timer.start();
+  QBENCHMARK
+  {
+    for ( int i = 0; i < repeat; ++i )
+    {
+      QPolygonF polygon = source;
+      QgsClipper::trimPolygon( polygon, clipRect, arena );
+    }
+    ++iterations;
+  }
+  reportThroughput( timer, iterations, repeat * vertices );
+}
+
+void QgsBenchMapToPixel::clippedLine_data()
+{
+  trimPolygon_data();
+}
+
+void QgsBenchMapToPixel::clippedLine()
+{
+  QFETCH( int, vertices );
+  QFETCH( bool, large );
+
+  const QgsRectangle clipRect( 0, 0, 1000, 1000 );
+  const QPolygonF source = createPolygon( vertices, large );
+
+  const int repeat = 1000000 / vertices;
+  int iterations = 0;
+  QElapsedTimer timer;
+  timer.start();
+  QBENCHMARK
+  {
+    for ( int i = 0; i < repeat; ++i )
+    {
+      const QPolygonF line = QgsClipper::clippedLine( source, clipRect );
+      Q_UNUSED( line );
+    }
+    ++iterations;
+  }
+  reportThroughput( timer, iterations, repeat * vertices );
+}
+
+QGSTEST_MAIN( QgsBenchMapToPixel )
+#include "qgsbenchmaptopixel.moc"
@@ -0,0 +1,126 @@
+/***************************************************************************
+                 qgsbenchnetwork.cpp  - Network graph building benchmark
+                             -------------------
+    begin                : February 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QObject>
+#include <QScopedPointer>
+
+#include "qgstest.h"
+
+#include "qgsapplication.h"
+#include "qgsfeature.h"
+#include "qgsgeometry.h"
+#include "qgsvectorlayer.h"
+#include "qgsvectordataprovider.h"
+#include "qgsgraph.h"
+#include "qgsgraphbuilder.h"
+#include "qgsnetworkdistancestrategy.h"
+#include "qgsvectorlayerdirector.h"
+
+/**
+ * Benchmark of QgsVectorLayerDirector::makeGraph() on a synthetic street grid.
+ *
+ * Run with e.g. "qgis_bench_network -iterations 3" and see tests/bench/README
+ * for the available QTestLib benchmark options.
+ */
+class QgsBenchNetwork : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void makeGraph_data();
+    void makeGraph();
+
+  private:
+    //! Layer of size x size streets, each street is split into one feature per block
+    static QgsVectorLayer *createGrid( int size );
+};
+
+void QgsBenchNetwork::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+}
+
+void QgsBenchNetwork::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+QgsVectorLayer *QgsBenchNetwork::createGrid( int size )
+{
+  QgsVectorLayer *layer = new QgsVectorLayer( QStringLiteral( "LineString?crs=EPSG:3857" ), QStringLiteral( "grid" ), QStringLiteral( "memory" ) );
+  QgsFeatureList features;
+  for ( int i = 0; i < size; ++i )
+  {
+    for ( int j = 0; j + 1 < size; ++j )
+    {
+      QgsFeature horizontal;
+      horizontal.setGeometry( QgsGeometry::fromPolyline( QgsPolyline() << QgsPoint( j * 100, i * 100 ) << QgsPoint( j * 100 + 50, i * 100 + 1 ) << QgsPoint( ( j + 1 ) * 100, i * 100 ) ) );
+      features << horizontal;
+      QgsFeature vertical;
+      vertical.setGeometry( QgsGeometry::fromPolyline( QgsPolyline() << QgsPoint( i * 100, j * 100 ) << QgsPoint( i * 100, ( j + 1 ) * 100 ) ) );
+      features << vertical;
+    }
+  }
+  layer->dataProvider()->addFeatures( features );
+  return layer;
+}
+
+void QgsBenchNetwork::makeGraph_data()
+{
+  QTest::addColumn<int>( "size" );
+  QTest::addColumn<int>( "tiePoints" );
+
+  QTest::newRow( "100x100 streets, no tie points" ) << 100 << 0;
+  QTest::newRow( "100x100 streets, 1000 tie points" ) << 100 << 1000;
+  QTest::newRow( "300x300 streets, 10000 tie points" ) << 300 << 10000;
+}
+
+void QgsBenchNetwork::makeGraph()
+{
+  QFETCH( int, size );
+  QFETCH( int, tiePoints );
+
+  QScopedPointer< QgsVectorLayer > layer( createGrid( size ) );
+  QgsVectorLayerDirector director( layer.data(), -1, QString(), QString(), QString(), QgsVectorLayerDirector::DirectionBoth );
+  director.addStrategy( new QgsNetworkDistanceStrategy() );
+
+  // deterministic points spread over the grid
+  QVector< QgsPoint > additionalPoints;
+  quint32 seed = 42;
+  for ( int i = 0; i < tiePoints; ++i )
+  {
+    seed = seed * 1103515245 + 12345;
+    const double x = ( seed >> 8 ) % ( ( size - 1 ) * 100 );
+    seed = seed * 1103515245 + 12345;
+    const double y = ( seed >> 8 ) % ( ( size - 1 ) * 100 );
+    additionalPoints << QgsPoint( x + 0.5, y + 0.5 );
+  }
+
+  QBENCHMARK
+  {
+    QgsGraphBuilder builder( layer->crs(), false );
+    QVector< QgsPoint > snappedPoints;
+    director.makeGraph( &builder, additionalPoints, snappedPoints );
+    QScopedPointer< QgsGraph > graph( builder.graph() );
+    QVERIFY( graph->edgeCount() > 0 );
+  }
+}
+
+QGSTEST_MAIN( QgsBenchNetwork )
+#include "qgsbenchnetwork.moc"
@@ -0,0 +1,129 @@
+/***************************************************************************
+                 qgsbenchpredicates.cpp  - Geometry predicate benchmark
+                             -------------------
+    begin                : February 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QObject>
+#include <QtMath>
+
+#include "qgstest.h"
+
+#include "qgsapplication.h"
+#include "qgsgeometry.h"
+#include "qgsgeos.h"
+
+/**
+ * Benchmark of QgsGeometry::intersects() between one detailed polygon and many points,
+ * evaluated with a new GEOS engine per call, with repeated calls reusing the prepared
+ * geometry and with a batched call.
+ *
+ * Run with e.g. "qgis_bench_predicates -iterations 3" and see tests/bench/README
+ * for the available QTestLib benchmark options.
+ */
+class QgsBenchPredicates : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void intersects_data();
+    void intersects();
+
+  private:
+    //! Star shaped polygon with the given number of vertices
+    static QgsGeometry createPolygon( int vertices );
+};
+
+void QgsBenchPredicates::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+}
+
+void QgsBenchPredicates::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+QgsGeometry QgsBenchPredicates::createPolygon( int vertices )
+{
+  QgsPolyline ring;
+  for ( int i = 0; i < vertices; ++i )
+  {
+    const double angle = 2 * M_PI * i / vertices;
+    const double radius = i % 2 ? 1000 : 700;
+    ring << QgsPoint( radius * std::cos( angle ), radius * std::sin( angle ) );
+  }
+  ring << ring.first();
+  return QgsGeometry::fromPolygon( QgsPolygon() << ring );
+}
+
+void QgsBenchPredicates::intersects_data()
+{
+  QTest::addColumn<int>( "vertices" );
+  QTest::addColumn<int>( "mode" );
+
+  QList< int > vertexCounts;
+  vertexCounts << 100 << 10000;
+  Q_FOREACH ( int vertices, vertexCounts )
+  {
+    QTest::newRow( QStringLiteral( "%1 vertices, engine per call" ).arg( vertices ).toLocal8Bit().constData() ) << vertices << 0;
+    QTest::newRow( QStringLiteral( "%1 vertices, repeated calls" ).arg( vertices ).toLocal8Bit().constData() ) << vertices << 1;
+    QTest::newRow( QStringLiteral( "%1 vertices, batched call" ).arg( vertices ).toLocal8Bit().constData() ) << vertices << 2;
+  }
+}
+
+void QgsBenchPredicates::intersects()
+{
+  QFETCH( int, vertices );
+  QFETCH( int, mode );
+
+  // 10000 points spread over the bounding box of the polygon
+  QVector< QgsGeometry > points;
+  for ( int i = 0; i < 10000; ++i )
+    points << QgsGeometry::fromPoint( QgsPoint( ( i % 100 ) * 20 - 1000, ( i / 100 ) * 20 - 1000 ) );
+
+  int count = 0;
+  QBENCHMARK
+  {
+    // a new polygon for each iteration, so that no prepared geometry is kept between them
+    QgsGeometry polygon = createPolygon( vertices );
+    count = 0;
+    switch ( mode )
+    {
+      case 0:
+        Q_FOREACH ( const QgsGeometry &point, points )
+        {
+          QgsGeos geos( polygon.geometry() );
+          count += geos.intersects( *point.geometry() ) ? 1 : 0;
+        }
+        break;
+
+      case 1:
+        Q_FOREACH ( const QgsGeometry &point, points )
+          count += polygon.intersects( point ) ? 1 : 0;
+        break;
+
+      case 2:
+        Q_FOREACH ( bool result, polygon.intersects( points ) )
+          count += result ? 1 : 0;
+        break;
+    }
+  }
+  QVERIFY( count > 0 );
+}
+
+QGSTEST_MAIN( QgsBenchPredicates )
+#include "qgsbenchpredicates.moc"
@@ -0,0 +1,157 @@
+/***************************************************************************
+                 qgsbenchrastercalc.cpp  - Raster calculator expression benchmark
+                             -------------------
+    begin                : February 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QElapsedTimer>
+#include <QMap>
+#include <QObject>
+
+#include "qgstest.h"
+
+#include "qgsrasterblock.h"
+#include "qgsrastercalcnode.h"
+#include "qgsrastermatrix.h"
+
+#include <cfloat>
+#include <memory>
+
+/**
+ * Benchmark of QgsRasterCalcNode::calculate() on NDVI style formulas over large tiles
+ * of two Float32 bands. The "per node" row evaluates NDVI the way the calculator did
+ * before the single pass evaluation, with a QgsRasterMatrix for every node of the tree.
+ * Besides the QTestLib timing, the throughput of each row is printed in cells per second.
+ *
+ * Run with e.g. "qgis_bench_rastercalc -iterations 10" and see tests/bench/README
+ * for the available QTestLib benchmark options.
+ */
+class QgsBenchRasterCalc : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void calculate_data();
+    void calculate();
+    void ndviPerNode();
+
+  private:
+    static const int TILE_SIZE = 2048;
+    static const double NODATA;
+
+    //! Band of random reflectances, with some nodata cells
+    static QgsRasterBlock *createBand( int seed );
+    static void reportThroughput( const QElapsedTimer &timer, int iterations );
+
+    QMap< QString, QgsRasterBlock * > mBands;
+};
+
+const double QgsBenchRasterCalc::NODATA = -FLT_MAX;
+
+QgsRasterBlock *QgsBenchRasterCalc::createBand( int seed )
+{
+  QgsRasterBlock *block = new QgsRasterBlock( Qgis::Float32, TILE_SIZE, TILE_SIZE );
+  block->setNoDataValue( -1 );
+  qsrand( seed );
+  const qgssize count = static_cast< qgssize >( TILE_SIZE ) * TILE_SIZE;
+  for ( qgssize i = 0; i < count; ++i )
+  {
+    block->setValue( i, i % 97 == 0 ? -1 : qrand() / static_cast< double >( RAND_MAX ) );
+  }
+  return block;
+}
+
+void QgsBenchRasterCalc::reportThroughput( const QElapsedTimer &timer, int iterations )
+{
+  const double seconds = timer.nsecsElapsed() / 1e9;
+  if ( seconds > 0 )
+    qDebug( "%.1f million cells per second", static_cast< double >( iterations ) * TILE_SIZE * TILE_SIZE / seconds / 1e6 );
+}
+
+void QgsBenchRasterCalc::initTestCase()
+{
+  mBands.insert( QStringLiteral( "b4@1" ), createBand( 4 ) );
+  mBands.insert( QStringLiteral( "b5@1" ), createBand( 5 ) );
+}
+
+void QgsBenchRasterCalc::cleanupTestCase()
+{
+  qDeleteAll( mBands );
+  mBands.clear();
+}
+
+void QgsBenchRasterCalc::calculate_data()
+{
+  QTest::addColumn< QString >( "formula" );
+
+  QTest::newRow( "ndvi" ) << QStringLiteral( "(b5@1 - b4@1) / (b5@1 + b4@1)" );
+  QTest::newRow( "savi" ) << QStringLiteral( "1.5 * (b5@1 - b4@1) / (b5@1 + b4@1 + 0.5)" );
+  QTest::newRow( "threshold" ) << QStringLiteral( "((b5@1 - b4@1) / (b5@1 + b4@1) > 0.3) AND (b4@1 < 0.2)" );
+  QTest::newRow( "sqrt" ) << QStringLiteral( "sqrt((b5@1 - b4@1) / (b5@1 + b4@1) + 0.5)" );
+}
+
+void QgsBenchRasterCalc::calculate()
+{
+  QFETCH( QString, formula );
+
+  QString error;
+  std::unique_ptr< QgsRasterCalcNode > node( QgsRasterCalcNode::parseRasterCalcString( formula, error ) );
+  QVERIFY2( node, error.toLocal8Bit().constData() );
+
+  QgsRasterMatrix result;
+  result.setNodataValue( NODATA );
+
+  int iterations = 0;
+  QElapsedTimer timer;
+  timer.start();
+  QBENCHMARK
+  {
+    QVERIFY( node->calculate( mBands, result ) );
+    ++iterations;
+  }
+  reportThroughput( timer, iterations );
+  QCOMPARE( result.nColumns(), static_cast< int >( TILE_SIZE ) );
+}
+
+void QgsBenchRasterCalc::ndviPerNode()
+{
+  QString error;
+  std::unique_ptr< QgsRasterCalcNode > b4( QgsRasterCalcNode::parseRasterCalcString( QStringLiteral( "b4@1" ), error ) );
+  std::unique_ptr< QgsRasterCalcNode > b5( QgsRasterCalcNode::parseRasterCalcString( QStringLiteral( "b5@1" ), error ) );
+
+  int iterations = 0;
+  QElapsedTimer timer;
+  timer.start();
+  QBENCHMARK
+  {
+    QgsRasterMatrix difference, b4Matrix, sum, b4Matrix2;
+    difference.setNodataValue( NODATA );
+    b4Matrix.setNodataValue( NODATA );
+    sum.setNodataValue( NODATA );
+    b4Matrix2.setNodataValue( NODATA );
+    b5->calculate( mBands, difference );
+    b4->calculate( mBands, b4Matrix );
+    difference.subtract( b4Matrix );
+    b5->calculate( mBands, sum );
+    b4->calculate( mBands, b4Matrix2 );
+    sum.add( b4Matrix2 );
+    difference.divide( sum );
+    ++iterations;
+  }
+  reportThroughput( timer, iterations );
+}
+
+QGSTEST_MAIN( QgsBenchRasterCalc )
+#include "qgsbenchrastercalc.moc"
@@ -0,0 +1,193 @@
+/***************************************************************************
+                 qgsbenchspatialindex.cpp  - Spatial index benchmark
+                             -------------------
+    begin                : February 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QObject>
+
+#include "qgstest.h"
+
+#include "qgsapplication.h"
+#include "qgsfeature.h"
+#include "qgsfeatureiterator.h"
+#include "qgsgeometry.h"
+#include "qgsspatialindex.h"
+
+/**
+ * Iterator over synthetic features with small random rectangles as geometries,
+ * generated on the fly so that millions of them do not need to be kept in memory.
+ */
+class QgsBenchRectangleIterator : public QgsAbstractFeatureIterator
+{
+  public:
+    explicit QgsBenchRectangleIterator( int count )
+      : QgsAbstractFeatureIterator( QgsFeatureRequest() )
+      , mCount( count )
+    {}
+
+    bool rewind() override
+    {
+      mNext = 0;
+      mSeed = 42;
+      return true;
+    }
+
+    bool close() override
+    {
+      mNext = mCount;
+      return true;
+    }
+
+  protected:
+    bool fetchFeature( QgsFeature &f ) override
+    {
+      if ( mNext >= mCount )
+        return false;
+
+      const double x = random() * 100000;
+      const double y = random() * 100000;
+      f.setId( mNext++ );
+      f.setGeometry( QgsGeometry::fromRect( QgsRectangle( x, y, x + random() * 10, y + random() * 10 ) ) );
+      f.setValid( true );
+      return true;
+    }
+
+  private:
+    int mCount;
+    int mNext = 0;
+    quint32 mSeed = 42;
+
+    //! deterministic value between 0 and 1
+    double random()
+    {
+      mSeed = mSeed * 1103515245 + 12345;
+      return ( mSeed >> 8 ) / static_cast< double >( 1 << 24 );
+    }
+};
+
+/**
+ * Benchmark of the QgsSpatialIndex backends, building the index and querying it.
+ *
+ * Run with e.g. "qgis_bench_spatialindex -iterations 3" and see tests/bench/README
+ * for the available QTestLib benchmark options. The 10M features rows need several
+ * gigabytes of memory for the dynamic R-tree.
+ */
+class QgsBenchSpatialIndex : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void build_data();
+    void build();
+    void intersects_data();
+    void intersects();
+    void nearestNeighbor_data();
+    void nearestNeighbor();
+
+  private:
+    static void addRows();
+};
+
+void QgsBenchSpatialIndex::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+}
+
+void QgsBenchSpatialIndex::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void QgsBenchSpatialIndex::addRows()
+{
+  QTest::addColumn<int>( "count" );
+  QTest::addColumn<int>( "backend" );
+
+  QList< int > counts;
+  counts << 100000 << 1000000 << 10000000;
+  Q_FOREACH ( int count, counts )
+  {
+    QTest::newRow( QStringLiteral( "%1 features, dynamic R-tree" ).arg( count ).toLocal8Bit().constData() ) << count << static_cast< int >( QgsSpatialIndex::DynamicRTree );
+    QTest::newRow( QStringLiteral( "%1 features, packed R-tree" ).arg( count ).toLocal8Bit().constData() ) << count << static_cast< int >( QgsSpatialIndex::PackedRTree );
+  }
+}
+
+void QgsBenchSpatialIndex::build_data()
+{
+  addRows();
+}
+
+void QgsBenchSpatialIndex::build()
+{
+  QFETCH( int, count );
+  QFETCH( int, backend );
+
+  QBENCHMARK
+  {
+    QgsSpatialIndex index( QgsFeatureIterator( new QgsBenchRectangleIterator( count ) ), static_cast< QgsSpatialIndex::Backend >( backend ) );
+    QVERIFY( !index.intersects( QgsRectangle( 0, 0, 100000, 100000 ) ).isEmpty() );
+  }
+}
+
+void QgsBenchSpatialIndex::intersects_data()
+{
+  addRows();
+}
+
+void QgsBenchSpatialIndex::intersects()
+{
+  QFETCH( int, count );
+  QFETCH( int, backend );
+
+  QgsSpatialIndex index( QgsFeatureIterator( new QgsBenchRectangleIterator( count ) ), static_cast< QgsSpatialIndex::Backend >( backend ) );
+
+  // 10000 windows of 1/1000th of the extent width
+  int found = 0;
+  QBENCHMARK
+  {
+    found = 0;
+    for ( int i = 0; i < 10000; ++i )
+    {
+      const double x = ( i % 100 ) * 1000.0;
+      const double y = ( i / 100 ) * 1000.0;
+      found += index.intersects( QgsRectangle( x, y, x + 100, y + 100 ) ).count();
+    }
+  }
+  QVERIFY( found > 0 );
+}
+
+void QgsBenchSpatialIndex::nearestNeighbor_data()
+{
+  addRows();
+}
+
+void QgsBenchSpatialIndex::nearestNeighbor()
+{
+  QFETCH( int, count );
+  QFETCH( int, backend );
+
+  QgsSpatialIndex index( QgsFeatureIterator( new QgsBenchRectangleIterator( count ) ), static_cast< QgsSpatialIndex::Backend >( backend ) );
+
+  QBENCHMARK
+  {
+    for ( int i = 0; i < 10000; ++i )
+      index.nearestNeighbor( QgsPoint( ( i % 100 ) * 1000.0 + 0.5, ( i / 100 ) * 1000.0 + 0.5 ), 5 );
+  }
+}
+
+QGSTEST_MAIN( QgsBenchSpatialIndex )
+#include "qgsbenchspatialindex.moc"
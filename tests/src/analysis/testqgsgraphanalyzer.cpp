@@ -0,0 +1,442 @@
+/***************************************************************************
+     testqgsgraphanalyzer.cpp
+     --------------------------------------
+    Date                 : February 2017
+    Copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <cmath>
+
+#include <QTemporaryFile>
+
+#include "qgstest.h"
+
+#include "qgis.h"
+#include "qgsgraph.h"
+#include "qgscompactgraph.h"
+#include "qgsgraphanalyzer.h"
+#include "qgscontractionhierarchy.h"
+#include "qgsgraphbuilder.h"
+#include "qgsnetworkdistancestrategy.h"
+#include "qgsvectorlayerdirector.h"
+#include "qgsvectorlayer.h"
+#include "qgsvectordataprovider.h"
+#include "qgsgeometry.h"
+
+/** \ingroup UnitTests
+ * This is a unit test for the graph analyzer, on synthetic grid networks
+ */
+class TestQgsGraphAnalyzer : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void vectorLayerDirector();
+    void compactGraph();
+    void dijkstraGrid();
+    void shortestPath();
+    void shortestPathUnreachable();
+    void contractionHierarchy();
+    void contractionHierarchyUnreachable();
+    void contractionHierarchyFile();
+    void distanceMatrix();
+    void benchmark_data();
+    void benchmark();
+
+  private:
+
+    /**
+     * Creates a grid of size x size vertices one unit apart, connected in both directions
+     * to their horizontal and vertical neighbors. If weighted, each edge costs between
+     * one and two times its length, otherwise exactly its length.
+     */
+    static QgsGraph *createGrid( int size, bool weighted );
+
+    //! Checks that path leads from start to end and returns its cost
+    static double pathCost( const QgsGraph &graph, const QVector<int> &path, int start, int end );
+};
+
+QgsGraph *TestQgsGraphAnalyzer::createGrid( int size, bool weighted )
+{
+  QgsGraph *graph = new QgsGraph();
+  for ( int row = 0; row < size; ++row )
+  {
+    for ( int col = 0; col < size; ++col )
+    {
+      graph->addVertex( QgsPoint( col, row ) );
+    }
+  }
+
+  // deterministic pseudo random costs
+  quint32 seed = 12345;
+  auto edgeCost = [&]() -> double
+  {
+    if ( !weighted )
+      return 1.0;
+    seed = seed * 1103515245 + 12345;
+    return 1.0 + ( ( seed >> 16 ) & 0x7fff ) / 32768.0;
+  };
+
+  for ( int row = 0; row < size; ++row )
+  {
+    for ( int col = 0; col < size; ++col )
+    {
+      const int vertex = row * size + col;
+      if ( col + 1 < size )
+      {
+        graph->addEdge( vertex, vertex + 1, QVector< QVariant >() << edgeCost() );
+        graph->addEdge( vertex + 1, vertex, QVector< QVariant >() << edgeCost() );
+      }
+      if ( row + 1 < size )
+      {
+        graph->addEdge( vertex, vertex + size, QVector< QVariant >() << edgeCost() );
+        graph->addEdge( vertex + size, vertex, QVector< QVariant >() << edgeCost() );
+      }
+    }
+  }
+  return graph;
+}
+
+double TestQgsGraphAnalyzer::pathCost( const QgsGraph &graph, const QVector<int> &path, int start, int end )
+{
+  double cost = 0.0;
+  int vertex = start;
+  Q_FOREACH ( int edgeId, path )
+  {
+    const QgsGraphEdge &edge = graph.edge( edgeId );
+    if ( edge.outVertex() != vertex )
+      return -1.0;
+    cost += edge.cost( 0 ).toDouble();
+    vertex = edge.inVertex();
+  }
+  return vertex == end ? cost : -1.0;
+}
+
+void TestQgsGraphAnalyzer::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+}
+
+void TestQgsGraphAnalyzer::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void TestQgsGraphAnalyzer::vectorLayerDirector()
+{
+  // enough streets for the segments to be extracted by several threads
+  const int size = 35;
+  QScopedPointer< QgsVectorLayer > layer( new QgsVectorLayer( QStringLiteral( "LineString?crs=EPSG:3857" ), QStringLiteral( "grid" ), QStringLiteral( "memory" ) ) );
+  QgsFeatureList features;
+  for ( int i = 0; i < size; ++i )
+  {
+    for ( int j = 0; j + 1 < size; ++j )
+    {
+      QgsFeature horizontal;
+      horizontal.setGeometry( QgsGeometry::fromPolyline( QgsPolyline() << QgsPoint( j * 100, i * 100 ) << QgsPoint( ( j + 1 ) * 100, i * 100 ) ) );
+      features << horizontal;
+      QgsFeature vertical;
+      vertical.setGeometry( QgsGeometry::fromPolyline( QgsPolyline() << QgsPoint( i * 100, j * 100 ) << QgsPoint( i * 100, ( j + 1 ) * 100 ) ) );
+      features << vertical;
+    }
+  }
+  QVERIFY( layer->dataProvider()->addFeatures( features ) );
+
+  QgsVectorLayerDirector director( layer.data(), -1, QString(), QString(), QString(), QgsVectorLayerDirector::DirectionBoth );
+  director.addStrategy( new QgsNetworkDistanceStrategy() );
+  QgsGraphBuilder builder( layer->crs(), false );
+
+  QVector< QgsPoint > additionalPoints;
+  additionalPoints << QgsPoint( 1030, 1020 ) << QgsPoint( 2050, 2090 ) << QgsPoint( 300, 300 );
+  QVector< QgsPoint > snappedPoints;
+  director.makeGraph( &builder, additionalPoints, snappedPoints );
+  QScopedPointer< QgsGraph > graph( builder.graph() );
+
+  QCOMPARE( snappedPoints.count(), 3 );
+  QCOMPARE( snappedPoints.at( 0 ), QgsPoint( 1030, 1000 ) );
+  QCOMPARE( snappedPoints.at( 1 ), QgsPoint( 2050, 2100 ) );
+  QCOMPARE( snappedPoints.at( 2 ), QgsPoint( 300, 300 ) );
+
+  // grid vertices and two tied points, which split a segment each
+  QCOMPARE( graph->vertexCount(), size * size + 2 );
+  QCOMPARE( graph->edgeCount(), features.count() * 2 + 4 );
+  QVERIFY( graph->findVertex( QgsPoint( 1030, 1000 ) ) >= 0 );
+  QVERIFY( graph->findVertex( QgsPoint( 2050, 2100 ) ) >= 0 );
+}
+
+void TestQgsGraphAnalyzer::compactGraph()
+{
+  QScopedPointer< QgsGraph > graph( createGrid( 3, false ) );
+  QgsCompactGraph compact( *graph, 0 );
+  QCOMPARE( compact.strategyIndex(), 0 );
+  QCOMPARE( compact.vertexCount(), 9 );
+  QCOMPARE( compact.edgeCount(), 24 );
+  QCOMPARE( compact.point( 5 ), QgsPoint( 2, 1 ) );
+  QCOMPARE( compact.costPerUnitDistance(), 1.0 );
+
+  // zero cost edges give no distance bound
+  graph->addEdge( 0, 8, QVector< QVariant >() << 0.0 );
+  QgsCompactGraph compact2( *graph, 0 );
+  QCOMPARE( compact2.edgeCount(), 25 );
+  QCOMPARE( compact2.costPerUnitDistance(), 0.0 );
+}
+
+void TestQgsGraphAnalyzer::dijkstraGrid()
+{
+  const int size = 20;
+  QScopedPointer< QgsGraph > graph( createGrid( size, false ) );
+  QgsCompactGraph compact( *graph, 0 );
+
+  QVector<int> tree;
+  QVector<double> cost;
+  QgsGraphAnalyzer::dijkstra( graph.data(), 0, 0, &tree, &cost );
+  QVector<int> compactTree;
+  QVector<double> compactCost;
+  QgsGraphAnalyzer::dijkstra( compact, 0, &compactTree, &compactCost );
+
+  QCOMPARE( tree.at( 0 ), -1 );
+  QCOMPARE( compactTree.at( 0 ), -1 );
+  for ( int row = 0; row < size; ++row )
+  {
+    for ( int col = 0; col < size; ++col )
+    {
+      const int vertex = row * size + col;
+      QCOMPARE( cost.at( vertex ), double( row + col ) );
+      QCOMPARE( compactCost.at( vertex ), double( row + col ) );
+      if ( vertex > 0 )
+      {
+        QCOMPARE( graph->edge( tree.at( vertex ) ).inVertex(), vertex );
+        QCOMPARE( graph->edge( compactTree.at( vertex ) ).inVertex(), vertex );
+      }
+    }
+  }
+}
+
+void TestQgsGraphAnalyzer::shortestPath()
+{
+  const int size = 30;
+  QScopedPointer< QgsGraph > graph( createGrid( size, true ) );
+  QgsCompactGraph compact( *graph, 0 );
+  QVERIFY( compact.costPerUnitDistance() >= 1.0 );
+
+  QList< QPair< int, int > > pairs;
+  pairs << qMakePair( 0, size * size - 1 )
+        << qMakePair( size * size - 1, 0 )
+        << qMakePair( size - 1, size * ( size - 1 ) )
+        << qMakePair( 37, 38 )
+        << qMakePair( 100, 517 )
+        << qMakePair( 450, 451 + size );
+
+  QPair< int, int > pair;
+  Q_FOREACH ( pair, pairs )
+  {
+    QVector<double> cost;
+    QgsGraphAnalyzer::dijkstra( graph.data(), pair.first, 0, nullptr, &cost );
+
+    QVector<int> path;
+    const double result = QgsGraphAnalyzer::shortestPath( compact, pair.first, pair.second, &path );
+    QVERIFY( qgsDoubleNear( result, cost.at( pair.second ), 1e-9 ) );
+    QVERIFY( qgsDoubleNear( pathCost( *graph, path, pair.first, pair.second ), result, 1e-9 ) );
+  }
+
+  QVector<int> path;
+  QCOMPARE( QgsGraphAnalyzer::shortestPath( compact, 5, 5, &path ), 0.0 );
+  QVERIFY( path.isEmpty() );
+}
+
+void TestQgsGraphAnalyzer::shortestPathUnreachable()
+{
+  QScopedPointer< QgsGraph > graph( createGrid( 5, false ) );
+  const int isolated = graph->addVertex( QgsPoint( 10, 10 ) );
+  // one way edge out of the grid
+  const int sink = graph->addVertex( QgsPoint( 6, 0 ) );
+  graph->addEdge( 4, sink, QVector< QVariant >() << 2.0 );
+  QgsCompactGraph compact( *graph, 0 );
+
+  QVector<int> path;
+  QVERIFY( std::isinf( QgsGraphAnalyzer::shortestPath( compact, 0, isolated, &path ) ) );
+  QVERIFY( path.isEmpty() );
+  QVERIFY( std::isinf( QgsGraphAnalyzer::shortestPath( compact, sink, 0, &path ) ) );
+  QVERIFY( path.isEmpty() );
+  QCOMPARE( QgsGraphAnalyzer::shortestPath( compact, 0, sink, &path ), 6.0 );
+  QCOMPARE( path.count(), 5 );
+}
+
+void TestQgsGraphAnalyzer::contractionHierarchy()
+{
+  const int size = 20;
+  QScopedPointer< QgsGraph > graph( createGrid( size, true ) );
+  // parallel edges and loops must not break the hierarchy
+  graph->addEdge( 0, 1, QVector< QVariant >() << 0.5 );
+  graph->addEdge( 7, 7, QVector< QVariant >() << 1.0 );
+
+  QgsContractionHierarchy hierarchy( *graph, 0 );
+  QVERIFY( hierarchy.isValid() );
+  QCOMPARE( hierarchy.strategyIndex(), 0 );
+  QCOMPARE( hierarchy.vertexCount(), size * size );
+  QVERIFY( hierarchy.shortcutCount() > 0 );
+
+  for ( int start = 0; start < size * size; start += 37 )
+  {
+    QVector<double> cost;
+    QgsGraphAnalyzer::dijkstra( graph.data(), start, 0, nullptr, &cost );
+    for ( int end = 0; end < size * size; end += 13 )
+    {
+      QVector<int> path;
+      const double result = hierarchy.shortestPath( start, end, &path );
+      QVERIFY( qgsDoubleNear( result, cost.at( end ), 1e-9 ) );
+      QVERIFY( qgsDoubleNear( pathCost( *graph, path, start, end ), result, 1e-9 ) );
+    }
+  }
+
+  // invalid hierarchy or vertices
+  QVERIFY( std::isinf( QgsContractionHierarchy().shortestPath( 0, 1 ) ) );
+  QVERIFY( std::isinf( hierarchy.shortestPath( 0, size * size ) ) );
+}
+
+void TestQgsGraphAnalyzer::contractionHierarchyUnreachable()
+{
+  QScopedPointer< QgsGraph > graph( createGrid( 5, false ) );
+  const int isolated = graph->addVertex( QgsPoint( 10, 10 ) );
+  const int sink = graph->addVertex( QgsPoint( 6, 0 ) );
+  graph->addEdge( 4, sink, QVector< QVariant >() << 2.0 );
+  QgsContractionHierarchy hierarchy( *graph, 0 );
+
+  QVector<int> path;
+  QVERIFY( std::isinf( hierarchy.shortestPath( 0, isolated, &path ) ) );
+  QVERIFY( path.isEmpty() );
+  QVERIFY( std::isinf( hierarchy.shortestPath( sink, 0, &path ) ) );
+  QVERIFY( path.isEmpty() );
+  QCOMPARE( hierarchy.shortestPath( 0, sink, &path ), 6.0 );
+  QCOMPARE( path.count(), 5 );
+}
+
+void TestQgsGraphAnalyzer::contractionHierarchyFile()
+{
+  QScopedPointer< QgsGraph > graph( createGrid( 10, true ) );
+  QgsContractionHierarchy hierarchy( *graph, 0 );
+
+  QTemporaryFile file;
+  QVERIFY( file.open() );
+  file.close();
+  QVERIFY( hierarchy.writeToFile( file.fileName() ) );
+
+  QgsContractionHierarchy loaded;
+  QVERIFY( !loaded.isValid() );
+  QVERIFY( loaded.readFromFile( file.fileName() ) );
+  QVERIFY( loaded.isValid() );
+  QCOMPARE( loaded.strategyIndex(), 0 );
+  QCOMPARE( loaded.vertexCount(), 100 );
+  QCOMPARE( loaded.shortcutCount(), hierarchy.shortcutCount() );
+
+  QVector<int> path;
+  QVector<int> loadedPath;
+  QCOMPARE( loaded.shortestPath( 3, 96, &loadedPath ), hierarchy.shortestPath( 3, 96, &path ) );
+  QCOMPARE( loadedPath, path );
+
+  // not a hierarchy
+  QTemporaryFile badFile;
+  QVERIFY( badFile.open() );
+  badFile.write( "not a contraction hierarchy" );
+  badFile.close();
+  QVERIFY( !loaded.readFromFile( badFile.fileName() ) );
+  QVERIFY( !loaded.isValid() );
+  QVERIFY( !loaded.readFromFile( QStringLiteral( "/does/not/exist" ) ) );
+  QVERIFY( !QgsContractionHierarchy().writeToFile( file.fileName() ) );
+}
+
+void TestQgsGraphAnalyzer::distanceMatrix()
+{
+  const int size = 20;
+  QScopedPointer< QgsGraph > graph( createGrid( size, true ) );
+  const int isolated = graph->addVertex( QgsPoint( 50, 50 ) );
+  QgsContractionHierarchy hierarchy( *graph, 0 );
+
+  QVector<int> sources;
+  sources << 0 << 57 << 211 << 399 << isolated;
+  QVector<int> targets;
+  targets << 399 << 0 << 57 << 123 << 280 << isolated;
+
+  const QVector<double> matrix = hierarchy.distanceMatrix( sources, targets );
+  QCOMPARE( matrix.count(), sources.count() * targets.count() );
+  for ( int i = 0; i < sources.count(); ++i )
+  {
+    QVector<double> cost;
+    QgsGraphAnalyzer::dijkstra( graph.data(), sources.at( i ), 0, nullptr, &cost );
+    for ( int j = 0; j < targets.count(); ++j )
+    {
+      const double expected = cost.at( targets.at( j ) );
+      const double value = matrix.at( i * targets.count() + j );
+      if ( std::isinf( expected ) )
+        QVERIFY( std::isinf( value ) );
+      else
+        QVERIFY( qgsDoubleNear( value, expected, 1e-9 ) );
+    }
+  }
+}
+
+void TestQgsGraphAnalyzer::benchmark_data()
+{
+  QTest::addColumn<int>( "method" );
+
+  QTest::newRow( "dijkstra" ) << 0;
+  QTest::newRow( "compact dijkstra" ) << 1;
+  QTest::newRow( "bidirectional a*" ) << 2;
+  QTest::newRow( "contraction hierarchy" ) << 3;
+}
+
+void TestQgsGraphAnalyzer::benchmark()
+{
+  QFETCH( int, method );
+
+  const int size = 300;
+  QScopedPointer< QgsGraph > graph( createGrid( size, true ) );
+  QgsCompactGraph compact( *graph, 0 );
+  QgsContractionHierarchy hierarchy;
+  if ( method == 3 )
+    hierarchy = QgsContractionHierarchy( *graph, 0 );
+  const int start = 10 * size + 10;
+  const int end = ( size - 20 ) * size + size - 50;
+
+  double result = 0.0;
+  QBENCHMARK
+  {
+    switch ( method )
+    {
+      case 0:
+      {
+        QVector<double> cost;
+        QgsGraphAnalyzer::dijkstra( graph.data(), start, 0, nullptr, &cost );
+        result = cost.at( end );
+        break;
+      }
+      case 1:
+      {
+        QVector<double> cost;
+        QgsGraphAnalyzer::dijkstra( compact, start, nullptr, &cost );
+        result = cost.at( end );
+        break;
+      }
+      case 2:
+        result = QgsGraphAnalyzer::shortestPath( compact, start, end );
+        break;
+      default:
+        result = hierarchy.shortestPath( start, end );
+        break;
+    }
+  }
+  QVERIFY( result > 0.0 );
+}
+
+QGSTEST_MAIN( TestQgsGraphAnalyzer )
+#include "testqgsgraphanalyzer.moc"
@@ -0,0 +1,289 @@
+/***************************************************************************
+  testqgskde.cpp
+  --------------------------------------
+  Date                 : February 2017
+  Copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstest.h"
+
+#include "qgsapplication.h"
+#include "qgsfeature.h"
+#include "qgsgeometry.h"
+#include "qgskde.h"
+#include "qgstestutils.h"
+#include "qgsvectordataprovider.h"
+#include "qgsvectorlayer.h"
+
+#include <QDir>
+#include <QFile>
+#include <QVector>
+
+#include <cmath>
+
+#include <gdal.h>
+
+/** \ingroup UnitTests
+ * This is a unit test for the kernel density estimation
+ */
+class TestQgsKde : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testSurface();
+    void testBinnedPoints_data();
+    void testBinnedPoints();
+    void testMemoryLimit_data();
+    void testMemoryLimit();
+
+  private:
+    struct Point
+    {
+      double x;
+      double y;
+      double weight;
+    };
+
+    //! Memory layer with the points and their weight in the "weight" field
+    static QgsVectorLayer *createLayer( const QList< Point > &points );
+
+    //! Runs the KDE and returns the values of the output raster by rows
+    QVector< float > runKde( QgsVectorLayer *layer, double radius, bool binPoints, int &columns, int &rows, int memoryLimit = 1024 );
+
+    QString mOutputFile;
+};
+
+void TestQgsKde::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+  GDALAllRegister();
+
+  mOutputFile = QDir::tempPath() + "/kde_output.tif";
+}
+
+void TestQgsKde::cleanupTestCase()
+{
+  QFile::remove( mOutputFile );
+  QgsApplication::exitQgis();
+}
+
+QgsVectorLayer *TestQgsKde::createLayer( const QList< Point > &points )
+{
+  QgsVectorLayer *layer = new QgsVectorLayer( QStringLiteral( "Point?crs=EPSG:3857&field=weight:double" ), QStringLiteral( "points" ), QStringLiteral( "memory" ) );
+  QgsFeatureList features;
+  Q_FOREACH ( const Point &point, points )
+  {
+    QgsFeature feature( layer->fields() );
+    feature.setGeometry( QgsGeometry::fromPoint( QgsPoint( point.x, point.y ) ) );
+    feature.setAttribute( 0, point.weight );
+    features << feature;
+  }
+  layer->dataProvider()->addFeatures( features );
+  layer->updateExtents();
+  return layer;
+}
+
+QVector< float > TestQgsKde::runKde( QgsVectorLayer *layer, double radius, bool binPoints, int &columns, int &rows, int memoryLimit )
+{
+  QgsKernelDensityEstimation::Parameters parameters;
+  parameters.vectorLayer = layer;
+  parameters.radius = radius;
+  parameters.weightField = QStringLiteral( "weight" );
+  parameters.pixelSize = 1;
+  parameters.shape = QgsKernelDensityEstimation::KernelQuartic;
+  parameters.decayRatio = 0;
+  parameters.outputValues = QgsKernelDensityEstimation::OutputRaw;
+  parameters.binPoints = binPoints;
+  parameters.memoryLimit = memoryLimit;
+
+  QgsKernelDensityEstimation kde( parameters, mOutputFile, QStringLiteral( "GTiff" ) );
+  if ( kde.run() != QgsKernelDensityEstimation::Success )
+    return QVector< float >();
+
+  GDALDatasetH dataset = GDALOpen( mOutputFile.toUtf8().constData(), GA_ReadOnly );
+  if ( !dataset )
+    return QVector< float >();
+  columns = GDALGetRasterXSize( dataset );
+  rows = GDALGetRasterYSize( dataset );
+  QVector< float > values( columns * rows );
+  if ( GDALRasterIO( GDALGetRasterBand( dataset, 1 ), GF_Read, 0, 0, columns, rows, values.data(), columns, rows, GDT_Float32, 0, 0 ) != CE_None )
+    values.clear();
+  GDALClose( dataset );
+  return values;
+}
+
+void TestQgsKde::testSurface()
+{
+  // with a radius of 10.5 map units the raster starts 10.5 units before the points, the pixel
+  // at column c and row r is centered on c - 10, r - 10
+  QList< Point > points;
+  points << Point { 0, 0, 1 } << Point { 3, 1, 0.5 } << Point { 20, 5, 2 };
+  QgsVectorLayer *layer = createLayer( points );
+
+  int columns = 0;
+  int rows = 0;
+  const double radius = 10.5;
+  QVector< float > values = runKde( layer, radius, false, columns, rows );
+  QCOMPARE( columns, 42 );
+  QCOMPARE( rows, 27 );
+  QCOMPARE( values.size(), columns * rows );
+
+  // the window of a point is 10 pixels around it, as the radius rounds down to 10 pixels
+  int covered = 0;
+  for ( int row = 0; row < rows; ++row )
+  {
+    for ( int col = 0; col < columns; ++col )
+    {
+      const double x = col - 10;
+      const double y = row - 10;
+      double expected = 0;
+      bool inside = false;
+      Q_FOREACH ( const Point &point, points )
+      {
+        const double distance = std::sqrt( ( x - point.x ) * ( x - point.x ) + ( y - point.y ) * ( y - point.y ) );
+        if ( std::fabs( x - point.x ) > 10 || std::fabs( y - point.y ) > 10 || distance > radius )
+          continue;
+        inside = true;
+        expected += point.weight * std::pow( 1 - std::pow( distance / radius, 2 ), 2 );
+      }
+
+      const float value = values.at( row * columns + col );
+      if ( !inside )
+      {
+        QCOMPARE( value, -9999.0f );
+        continue;
+      }
+      ++covered;
+      QGSCOMPARENEAR( value, expected, 0.00001 );
+    }
+  }
+  QVERIFY( covered > 0 );
+
+  delete layer;
+}
+
+void TestQgsKde::testBinnedPoints_data()
+{
+  QTest::addColumn<int>( "pointCount" );
+  QTest::addColumn<double>( "radius" );
+  QTest::addColumn<int>( "memoryLimit" );
+
+  // few points are added to the tiles with the kernel values, many points are convolved with a FFT
+  QTest::newRow( "sparse" ) << 30 << 10.5 << 1024;
+  QTest::newRow( "dense" ) << 20000 << 30.5 << 1024;
+  // the 4 tiles of bins fit in 8 MB but not the 16 output tiles with the convolution buffers, and the
+  // kernel is larger than the smallest FFT, so it is convolved in parts and the tiles are read back
+  QTest::newRow( "large radius" ) << 400 << 300.5 << 8;
+}
+
+void TestQgsKde::testBinnedPoints()
+{
+  QFETCH( int, pointCount );
+  QFETCH( double, radius );
+  QFETCH( int, memoryLimit );
+
+  // points on the centers of the pixels are not moved by the binning, so the binned surface
+  // must be the same as the exact one
+  QList< Point > points;
+  for ( int i = 0; i < pointCount; ++i )
+  {
+    points << Point { static_cast< double >( ( i * 37 ) % 293 ), static_cast< double >( ( i * 91 ) % 277 ), 1.0 + i % 3 };
+  }
+  QgsVectorLayer *layer = createLayer( points );
+
+  int columns = 0;
+  int rows = 0;
+  const QVector< float > exact = runKde( layer, radius, false, columns, rows );
+  int binnedColumns = 0;
+  int binnedRows = 0;
+  const QVector< float > binned = runKde( layer, radius, true, binnedColumns, binnedRows, memoryLimit );
+  QCOMPARE( binnedColumns, columns );
+  QCOMPARE( binnedRows, rows );
+  QCOMPARE( exact.size(), columns * rows );
+  QCOMPARE( binned.size(), columns * rows );
+
+  int differences = 0;
+  for ( int i = 0; i < exact.size(); ++i )
+  {
+    const float exactValue = exact.at( i );
+    const float binnedValue = binned.at( i );
+    if ( ( exactValue == -9999 ) != ( binnedValue == -9999 ) )
+      ++differences;
+    else if ( std::fabs( exactValue - binnedValue ) > 0.0001 * std::max( 1.0f, std::fabs( exactValue ) ) )
+      ++differences;
+  }
+  QCOMPARE( differences, 0 );
+
+  delete layer;
+}
+
+void TestQgsKde::testMemoryLimit_data()
+{
+  QTest::addColumn<bool>( "binPoints" );
+
+  QTest::newRow( "exact" ) << false;
+  // the bins do not fit in 1 MB, the points are added one by one at the center of their pixel
+  QTest::newRow( "binned" ) << true;
+}
+
+void TestQgsKde::testMemoryLimit()
+{
+  QFETCH( bool, binPoints );
+
+  // more points than a batch over 36 tiles, with 1 MB only 4 tiles are kept in memory and the
+  // others are written to the raster and read back by the next batch
+  QList< Point > points;
+  for ( int i = 0; i < 70000; ++i )
+  {
+    points << Point { static_cast< double >( ( i * 37 ) % 1499 ), static_cast< double >( ( i * 91 ) % 1493 ), 1.0 + i % 3 };
+  }
+  QgsVectorLayer *layer = createLayer( points );
+
+  int columns = 0;
+  int rows = 0;
+  const QVector< float > unlimited = runKde( layer, 5.5, binPoints, columns, rows );
+  int limitedColumns = 0;
+  int limitedRows = 0;
+  const QVector< float > limited = runKde( layer, 5.5, binPoints, limitedColumns, limitedRows, 1 );
+  QCOMPARE( limitedColumns, columns );
+  QCOMPARE( limitedRows, rows );
+  QCOMPARE( unlimited.size(), columns * rows );
+  QCOMPARE( limited.size(), columns * rows );
+
+  if ( !binPoints )
+  {
+    // each tile gets the points in the same order, the values are the same
+    QVERIFY( limited == unlimited );
+  }
+  else
+  {
+    int differences = 0;
+    for ( int i = 0; i < unlimited.size(); ++i )
+    {
+      const float unlimitedValue = unlimited.at( i );
+      const float limitedValue = limited.at( i );
+      if ( ( unlimitedValue == -9999 ) != ( limitedValue == -9999 ) )
+        ++differences;
+      else if ( std::fabs( unlimitedValue - limitedValue ) > 0.0001 * std::max( 1.0f, std::fabs( unlimitedValue ) ) )
+        ++differences;
+    }
+    QCOMPARE( differences, 0 );
+  }
+
+  delete layer;
+}
+
+QGSTEST_MAIN( TestQgsKde )
+#include "testqgskde.moc"
@@ -0,0 +1,162 @@
+/***************************************************************************
+  testqgsninecellfilter.cpp
+  --------------------------------------
+  Date                 : February 2017
+  Copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstest.h"
+
+#include "qgsaspectfilter.h"
+#include "qgshillshadefilter.h"
+#include "qgsruggednessfilter.h"
+#include "qgsslopefilter.h"
+
+#include <QDir>
+#include <QFile>
+#include <QVector>
+
+#include <cmath>
+#include <memory>
+
+#include <gdal.h>
+
+/** \ingroup UnitTests
+ * This is a unit test for the nine cell filters (slope, aspect, hillshade and ruggedness)
+ */
+class TestQgsNineCellFilter : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testFilters_data();
+    void testFilters();
+
+  private:
+    // wide enough for the raster to be processed in several blocks of rows
+    static const int WIDTH = 2100;
+    static const int HEIGHT = 1200;
+    static const int NODATA = -9999;
+
+    QString mDemFile;
+    QString mOutputFile;
+    //! Values of the DEM, by rows
+    QVector< float > mDem;
+};
+
+void TestQgsNineCellFilter::initTestCase()
+{
+  GDALAllRegister();
+
+  mDemFile = QDir::tempPath() + "/ninecellfilter_dem.tif";
+  mOutputFile = QDir::tempPath() + "/ninecellfilter_output.tif";
+
+  // hills with a few holes of nodata values, some of them on the border of the raster
+  mDem.resize( WIDTH * HEIGHT );
+  for ( int row = 0; row < HEIGHT; ++row )
+  {
+    for ( int col = 0; col < WIDTH; ++col )
+    {
+      float value = 500 + 100 * std::sin( col / 40.0 ) * std::cos( row / 70.0 ) + ( col * row ) % 7;
+      if ( ( col % 397 < 3 && row % 211 < 4 ) || ( row == 0 && col % 50 == 0 ) || ( col == WIDTH - 1 && row % 30 == 0 ) )
+        value = NODATA;
+      mDem[ row * WIDTH + col ] = value;
+    }
+  }
+
+  GDALDriverH driver = GDALGetDriverByName( "GTiff" );
+  QVERIFY( driver );
+  GDALDatasetH dataset = GDALCreate( driver, mDemFile.toUtf8().constData(), WIDTH, HEIGHT, 1, GDT_Float32, nullptr );
+  QVERIFY( dataset );
+  double geoTransform[6] = { 600000, 10, 0, 200000, 0, -10 };
+  GDALSetGeoTransform( dataset, geoTransform );
+  GDALRasterBandH band = GDALGetRasterBand( dataset, 1 );
+  GDALSetRasterNoDataValue( band, NODATA );
+  QCOMPARE( GDALRasterIO( band, GF_Write, 0, 0, WIDTH, HEIGHT, mDem.data(), WIDTH, HEIGHT, GDT_Float32, 0, 0 ), CE_None );
+  GDALClose( dataset );
+}
+
+void TestQgsNineCellFilter::cleanupTestCase()
+{
+  QFile::remove( mDemFile );
+  QFile::remove( mOutputFile );
+}
+
+void TestQgsNineCellFilter::testFilters_data()
+{
+  QTest::addColumn<QString>( "filterName" );
+
+  QTest::newRow( "slope" ) << "slope";
+  QTest::newRow( "aspect" ) << "aspect";
+  QTest::newRow( "hillshade" ) << "hillshade";
+  QTest::newRow( "ruggedness" ) << "ruggedness";
+}
+
+void TestQgsNineCellFilter::testFilters()
+{
+  QFETCH( QString, filterName );
+
+  const QString format = QStringLiteral( "GTiff" );
+  std::unique_ptr< QgsNineCellFilter > filter;
+  if ( filterName == QLatin1String( "slope" ) )
+    filter.reset( new QgsSlopeFilter( mDemFile, mOutputFile, format ) );
+  else if ( filterName == QLatin1String( "aspect" ) )
+    filter.reset( new QgsAspectFilter( mDemFile, mOutputFile, format ) );
+  else if ( filterName == QLatin1String( "hillshade" ) )
+    filter.reset( new QgsHillshadeFilter( mDemFile, mOutputFile, format, 315, 45 ) );
+  else
+    filter.reset( new QgsRuggednessFilter( mDemFile, mOutputFile, format ) );
+  filter->setZFactor( 2 );
+
+  QCOMPARE( filter->processRaster( nullptr ), 0 );
+  QCOMPARE( filter->inputNodataValue(), static_cast< double >( NODATA ) );
+  QCOMPARE( filter->cellSizeX(), 10.0 );
+
+  QVector< float > output( WIDTH * HEIGHT );
+  GDALDatasetH dataset = GDALOpen( mOutputFile.toUtf8().constData(), GA_ReadOnly );
+  QVERIFY( dataset );
+  QCOMPARE( GDALRasterIO( GDALGetRasterBand( dataset, 1 ), GF_Read, 0, 0, WIDTH, HEIGHT, output.data(), WIDTH, HEIGHT, GDT_Float32, 0, 0 ), CE_None );
+  GDALClose( dataset );
+
+  // the expected values are calculated for each cell with processNineCellWindow(), from
+  // scan lines padded with nodata values as processRaster() does at the border of the raster
+  const int paddedWidth = WIDTH + 2;
+  QVector< float > padded( ( HEIGHT + 2 ) * paddedWidth, NODATA );
+  for ( int row = 0; row < HEIGHT; ++row )
+  {
+    std::copy( mDem.constData() + row * WIDTH, mDem.constData() + ( row + 1 ) * WIDTH, padded.data() + ( row + 1 ) * paddedWidth + 1 );
+  }
+
+  QVector< float > expected( WIDTH );
+  QgsNineCellFilter::ScanLineBuffers buffers( WIDTH );
+  int differences = 0;
+  int validCells = 0;
+  for ( int row = 0; row < HEIGHT; ++row )
+  {
+    const float *line = padded.constData() + row * paddedWidth + 1;
+    filter->QgsNineCellFilter::processScanLine( line, line + paddedWidth, line + 2 * paddedWidth, expected.data(), WIDTH, buffers );
+    for ( int col = 0; col < WIDTH; ++col )
+    {
+      const float value = output.at( row * WIDTH + col );
+      if ( value != expected.at( col ) )
+        ++differences;
+      if ( value != filter->outputNodataValue() )
+        ++validCells;
+    }
+  }
+  QCOMPARE( differences, 0 );
+  QVERIFY( validCells > WIDTH * HEIGHT / 2 );
+}
+
+QGSTEST_MAIN( TestQgsNineCellFilter )
+#include "testqgsninecellfilter.moc"
@@ -54,9 +54,12 @@ class TestQgsRasterCalculator : public QObject
 
     void rasterRefOp();
     void dualOpRasterRaster(); //test dual op on raster ref and raster ref
+    void calcTreeOnBlocks(); //test a whole tree evaluated in one pass against matrix operations
 
     void calcWithLayers();
     void calcWithReprojectedLayers();
+    void calcTiled_data();
+    void calcTiled(); // tiled processing gives the same result as processing at once
 
   private:
 
@@ -421,6 +424,85 @@ void TestQgsRasterCalculator::dualOpRasterRaster()
   QCOMPARE( result.data()[5], -9999.0 );
 }
 
+void TestQgsRasterCalculator::calcTreeOnBlocks()
+{
+  // more cells than evaluated in one chunk
+  const int cols = 40;
+  const int rows = 30;
+  QgsRasterBlock b1( Qgis::Float32, cols, rows );
+  b1.setNoDataValue( -1.0 );
+  QgsRasterBlock b2( Qgis::Int16, cols, rows );
+  b2.setNoDataValue( -2.0 );
+  for ( int row = 0; row < rows; ++row )
+  {
+    for ( int col = 0; col < cols; ++col )
+    {
+      b1.setValue( row, col, ( row * cols + col ) % 7 == 0 ? -1.0 : ( row - col ) * 0.25 );
+      b2.setValue( row, col, ( row * cols + col ) % 11 == 0 ? -2.0 : col % 5 );
+    }
+  }
+  QMap<QString, QgsRasterBlock *> rasterData;
+  rasterData.insert( QStringLiteral( "b1@1" ), &b1 );
+  rasterData.insert( QStringLiteral( "b2@1" ), &b2 );
+
+  QString error;
+  QgsRasterCalcNode *node = QgsRasterCalcNode::parseRasterCalcString( QStringLiteral( "sqrt((b1@1 - b2@1) / (b1@1 + b2@1) + 1) + (b1@1 > 2 AND b2@1 != 3) - ln(b2@1) ^ 2" ), error );
+  QVERIFY( node );
+
+  QgsRasterMatrix result;
+  result.setNodataValue( -9999 );
+  QVERIFY( node->calculate( rasterData, result ) );
+  QCOMPARE( result.nColumns(), cols );
+  QCOMPARE( result.nRows(), rows );
+
+  // same tree, with a matrix for each node
+  QgsRasterCalcNode b1Node( QStringLiteral( "b1@1" ) );
+  QgsRasterCalcNode b2Node( QStringLiteral( "b2@1" ) );
+  QgsRasterMatrix m1;
+  m1.setNodataValue( -9999 );
+  QgsRasterMatrix m2;
+  m2.setNodataValue( -9999 );
+  QVERIFY( b1Node.calculate( rasterData, m1 ) );
+  QVERIFY( b2Node.calculate( rasterData, m2 ) );
+  QgsRasterMatrix one( 1, 1, new double[1] { 1 }, -9999 );
+  QgsRasterMatrix two( 1, 1, new double[1] { 2 }, -9999 );
+  QgsRasterMatrix three( 1, 1, new double[1] { 3 }, -9999 );
+
+  QgsRasterMatrix ratio( m1 );
+  ratio.subtract( m2 );
+  QgsRasterMatrix sum( m1 );
+  sum.add( m2 );
+  ratio.divide( sum );
+  ratio.add( one );
+  ratio.squareRoot();
+  QgsRasterMatrix greater( m1 );
+  greater.greaterThan( two );
+  QgsRasterMatrix notThree( m2 );
+  notThree.notEqual( three );
+  greater.logicalAnd( notThree );
+  ratio.add( greater );
+  QgsRasterMatrix logarithm( m2 );
+  logarithm.log();
+  logarithm.power( two );
+  ratio.subtract( logarithm );
+
+  for ( int i = 0; i < cols * rows; ++i )
+  {
+    QCOMPARE( result.data()[i], ratio.data()[i] );
+  }
+
+  // by rows
+  QVERIFY( node->calculate( rasterData, result, 17 ) );
+  QCOMPARE( result.nColumns(), cols );
+  QCOMPARE( result.nRows(), 1 );
+  for ( int col = 0; col < cols; ++col )
+  {
+    QCOMPARE( result.data()[col], ratio.data()[17 * cols + col] );
+  }
+
+  delete node;
+}
+
 void TestQgsRasterCalculator::calcWithLayers()
 {
   QgsRasterCalculatorEntry entry1;
@@ -532,5 +614,83 @@ void TestQgsRasterCalculator::calcWithReprojectedLayers()
   delete block;
 }
 
+void TestQgsRasterCalculator::calcTiled_data()
+{
+  QTest::addColumn< QString >( "formula" );
+  QTest::addColumn< int >( "tileWidth" );
+  QTest::addColumn< int >( "tileHeight" );
+
+  QTest::newRow( "two bands, small tiles" ) << QStringLiteral( "\"landsat@1\" + \"landsat@2\"" ) << 7 << 5;
+  QTest::newRow( "two bands, one tile" ) << QStringLiteral( "\"landsat@1\" + \"landsat@2\"" ) << 1000 << 1000;
+  QTest::newRow( "two bands, single rows" ) << QStringLiteral( "\"landsat@1\" * 2 - \"landsat@2\"" ) << 1000 << 1;
+  QTest::newRow( "number" ) << QStringLiteral( "2 + 3" ) << 7 << 5;
+}
+
+void TestQgsRasterCalculator::calcTiled()
+{
+  QFETCH( QString, formula );
+  QFETCH( int, tileWidth );
+  QFETCH( int, tileHeight );
+
+  QgsRasterCalculatorEntry entry1;
+  entry1.bandNumber = 1;
+  entry1.raster = mpLandsatRasterLayer;
+  entry1.ref = QStringLiteral( "landsat@1" );
+
+  QgsRasterCalculatorEntry entry2;
+  entry2.bandNumber = 2;
+  entry2.raster = mpLandsatRasterLayer;
+  entry2.ref = QStringLiteral( "landsat@2" );
+
+  QVector<QgsRasterCalculatorEntry> entries;
+  entries << entry1 << entry2;
+
+  QgsCoordinateReferenceSystem crs;
+  crs.createFromId( 32633, QgsCoordinateReferenceSystem::EpsgCrsId );
+  QgsRectangle extent( 783235, 3347960, 783535, 3348170 );
+  const int columns = 30;
+  const int rows = 21;
+
+  QTemporaryFile tmpFile;
+  tmpFile.open(); // fileName is no avialable until open
+  QString tmpName = tmpFile.fileName();
+  tmpFile.close();
+  QTemporaryFile tmpFileTiled;
+  tmpFileTiled.open();
+  QString tmpNameTiled = tmpFileTiled.fileName();
+  tmpFileTiled.close();
+
+  QgsRasterCalculator rc( formula, tmpName, QStringLiteral( "GTiff" ), extent, crs, columns, rows, entries );
+  rc.setTiledProcessing( false );
+  QVERIFY( !rc.tiledProcessing() );
+  QCOMPARE( rc.processCalculation(), 0 );
+
+  QgsRasterCalculator rcTiled( formula, tmpNameTiled, QStringLiteral( "GTiff" ), extent, crs, columns, rows, entries );
+  QVERIFY( rcTiled.tiledProcessing() );
+  rcTiled.setTileSize( tileWidth, tileHeight );
+  QCOMPARE( rcTiled.tileWidth(), tileWidth );
+  QCOMPARE( rcTiled.tileHeight(), tileHeight );
+  QCOMPARE( rcTiled.processCalculation(), 0 );
+
+  QgsRasterLayer *result = new QgsRasterLayer( tmpName, QStringLiteral( "result" ) );
+  QgsRasterLayer *resultTiled = new QgsRasterLayer( tmpNameTiled, QStringLiteral( "result" ) );
+  QCOMPARE( resultTiled->width(), columns );
+  QCOMPARE( resultTiled->height(), rows );
+  QgsRasterBlock *block = result->dataProvider()->block( 1, extent, columns, rows );
+  QgsRasterBlock *blockTiled = resultTiled->dataProvider()->block( 1, extent, columns, rows );
+  for ( int row = 0; row < rows; ++row )
+  {
+    for ( int col = 0; col < columns; ++col )
+    {
+      QCOMPARE( blockTiled->isNoData( row, col ), block->isNoData( row, col ) );
+      QCOMPARE( blockTiled->value( row, col ), block->value( row, col ) );
+    }
+  }
+  delete block;
+  delete blockTiled;
+  delete result;
+  delete resultTiled;
+}
+
 QGSTEST_MAIN( TestQgsRasterCalculator )
 #include "testqgsrastercalculator.moc"
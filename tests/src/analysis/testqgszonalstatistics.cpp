@@ -18,8 +18,11 @@
 
 #include "qgsapplication.h"
 #include "qgsfeatureiterator.h"
+#include "qgsgeometry.h"
+#include "qgsvectordataprovider.h"
 #include "qgsvectorlayer.h"
 #include "qgsrasterlayer.h"
+#include "qgstestutils.h"
 #include "qgszonalstatistics.h"
 #include "qgsproject.h"
 
@@ -37,6 +40,7 @@ class TestQgsZonalStatistics : public QObject
     void cleanup() {}
 
     void testStatistics();
+    void testHolesAndSmallPolygons();
 
   private:
     QgsVectorLayer *mVectorLayer = nullptr;
@@ -175,5 +179,50 @@ void TestQgsZonalStatistics::testStatistics()
   QCOMPARE( f.attribute( "myqgis2_va" ).toDouble(), 2.0 );
 }
 
+void TestQgsZonalStatistics::testHolesAndSmallPolygons()
+{
+  // the raster has 4 x 3 cells of 0.000045, with values 1 1 0 0 / 1 1 0 0 / 1 1 1 1
+  const double xMin = 100.379357;
+  const double yMax = -0.960588 + 3 * 0.000045;
+  const double cell = 0.000045;
+  auto rect = [&]( double col0, double row0, double col1, double row1 )
+  {
+    return QgsGeometry::fromRect( QgsRectangle( xMin + col0 * cell, yMax - row1 * cell, xMin + col1 * cell, yMax - row0 * cell ) );
+  };
+
+  QgsVectorLayer *layer = new QgsVectorLayer( QStringLiteral( "Polygon" ), QStringLiteral( "polys" ), QStringLiteral( "memory" ) );
+  QgsFeatureList features;
+  // the whole raster, with a hole around the center of the cell of row 2 and column 2
+  QgsFeature withHole;
+  withHole.setGeometry( rect( -1, -1, 5, 4 ).difference( rect( 2.1, 2.1, 2.9, 2.9 ) ) );
+  features << withHole;
+  // a quarter of the cell of row 0 and column 0, smaller than a cell
+  QgsFeature quarter;
+  quarter.setGeometry( rect( 0.25, 0.25, 0.75, 0.75 ) );
+  features << quarter;
+  // an eighth of the cells of row 0 and columns 1 and 2
+  QgsFeature straddling;
+  straddling.setGeometry( rect( 1.75, 0.25, 2.25, 0.75 ) );
+  features << straddling;
+  QVERIFY( layer->dataProvider()->addFeatures( features ) );
+
+  QgsZonalStatistics zs( layer, mRasterLayer, QStringLiteral( "z" ), 1, QgsZonalStatistics::Count | QgsZonalStatistics::Sum );
+  QCOMPARE( zs.calculateStatistics( nullptr ), 0 );
+
+  QgsFeatureIterator it = layer->getFeatures();
+  QgsFeature f;
+  QVERIFY( it.nextFeature( f ) );
+  QCOMPARE( f.attribute( "zcount" ).toDouble(), 11.0 );
+  QCOMPARE( f.attribute( "zsum" ).toDouble(), 7.0 );
+  QVERIFY( it.nextFeature( f ) );
+  QGSCOMPARENEAR( f.attribute( "zcount" ).toDouble(), 0.25, 0.000001 );
+  QGSCOMPARENEAR( f.attribute( "zsum" ).toDouble(), 0.25, 0.000001 );
+  QVERIFY( it.nextFeature( f ) );
+  QGSCOMPARENEAR( f.attribute( "zcount" ).toDouble(), 0.25, 0.000001 );
+  QGSCOMPARENEAR( f.attribute( "zsum" ).toDouble(), 0.125, 0.000001 );
+
+  delete layer;
+}
+
 QGSTEST_MAIN( TestQgsZonalStatistics )
 #include "testqgszonalstatistics.moc"
@@ -0,0 +1,158 @@
+/***************************************************************************
+     testqgsarenaallocator.cpp
+     --------------------------------------
+    Date                 : February 2017
+    Copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgstest.h"
+#include <QObject>
+#include <QPointF>
+#include <QString>
+
+#include "qgsarenaallocator.h"
+#include "qgsrendercontext.h"
+
+#include <cstdint>
+
+class TestQgsArenaAllocator: public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void allocate();
+    void largeAllocation();
+    void rewind();
+    void reset();
+    void renderContext();
+};
+
+//! Counts its destructions, to check the objects created in the arena are destroyed
+class DestructionCounter
+{
+  public:
+    explicit DestructionCounter( int *counter, const QString &name = QString() )
+      : mCounter( counter )
+      , mName( name )
+    {}
+    ~DestructionCounter() { ++*mCounter; }
+
+    QString name() const { return mName; }
+
+  private:
+    int *mCounter = nullptr;
+    QString mName;
+};
+
+void TestQgsArenaAllocator::allocate()
+{
+  QgsArenaAllocator arena( 1024 );
+  QCOMPARE( arena.capacity(), std::size_t( 0 ) );
+
+  char *c = static_cast< char * >( arena.allocate( 1, 1 ) );
+  QVERIFY( c );
+  QCOMPARE( arena.capacity(), std::size_t( 1024 ) );
+
+  // allocations are aligned and do not overlap
+  double *d = arena.allocateArray<double>( 10 );
+  QCOMPARE( reinterpret_cast< std::uintptr_t >( d ) % alignof( double ), std::uintptr_t( 0 ) );
+  QVERIFY( reinterpret_cast< char * >( d ) > c );
+  for ( int i = 0; i < 10; ++i )
+    d[i] = i;
+  QPointF *p = arena.allocateArray<QPointF>( 5 );
+  QVERIFY( reinterpret_cast< char * >( p ) >= reinterpret_cast< char * >( d + 10 ) );
+  p[4] = QPointF( 1, 2 );
+  QCOMPARE( d[9], 9.0 );
+
+  // a new block once the first one is full
+  arena.allocate( 1000 );
+  QCOMPARE( arena.capacity(), std::size_t( 2048 ) );
+}
+
+void TestQgsArenaAllocator::largeAllocation()
+{
+  QgsArenaAllocator arena( 1024 );
+  int *values = arena.allocateArray<int>( 10000 );
+  for ( int i = 0; i < 10000; ++i )
+    values[i] = i;
+  QVERIFY( arena.capacity() >= 10000 * sizeof( int ) );
+  QCOMPARE( values[9999], 9999 );
+}
+
+void TestQgsArenaAllocator::rewind()
+{
+  int destroyed = 0;
+  QgsArenaAllocator arena( 1024 );
+  DestructionCounter *first = arena.create<DestructionCounter>( &destroyed, QStringLiteral( "first" ) );
+  QCOMPARE( first->name(), QStringLiteral( "first" ) );
+
+  const QgsArenaAllocator::Marker marker = arena.mark();
+  {
+    QgsArenaAllocator::Scope scope( arena );
+    arena.create<DestructionCounter>( &destroyed );
+    arena.create<DestructionCounter>( &destroyed );
+    // enough to need several blocks
+    arena.allocateArray<double>( 1000 );
+    QCOMPARE( destroyed, 0 );
+  }
+  // only the objects created in the scope are destroyed
+  QCOMPARE( destroyed, 2 );
+  QCOMPARE( arena.mark().block, marker.block );
+  QCOMPARE( arena.mark().offset, marker.offset );
+
+  // the blocks are kept and reused
+  const std::size_t capacity = arena.capacity();
+  {
+    QgsArenaAllocator::Scope scope( arena );
+    arena.allocateArray<double>( 1000 );
+  }
+  QCOMPARE( arena.capacity(), capacity );
+
+  QCOMPARE( first->name(), QStringLiteral( "first" ) );
+  arena.rewind( QgsArenaAllocator::Marker{ -1, 0, nullptr } );
+  QCOMPARE( destroyed, 3 );
+}
+
+void TestQgsArenaAllocator::reset()
+{
+  int destroyed = 0;
+  {
+    QgsArenaAllocator arena( 1024 );
+    arena.create<DestructionCounter>( &destroyed );
+    arena.allocateArray<double>( 1000 );
+    QVERIFY( arena.capacity() > 1024 );
+
+    // only the first block is kept
+    arena.reset();
+    QCOMPARE( destroyed, 1 );
+    QCOMPARE( arena.capacity(), std::size_t( 1024 ) );
+
+    arena.create<DestructionCounter>( &destroyed );
+    QCOMPARE( arena.capacity(), std::size_t( 1024 ) );
+  }
+  // remaining objects are destroyed with the arena
+  QCOMPARE( destroyed, 2 );
+}
+
+void TestQgsArenaAllocator::renderContext()
+{
+  QgsRenderContext context;
+  context.arena().allocateArray<double>( 10 );
+  QVERIFY( context.arena().capacity() > 0 );
+
+  // copies of a context have their own arena
+  QgsRenderContext copy( context );
+  QCOMPARE( copy.arena().capacity(), std::size_t( 0 ) );
+  QVERIFY( &copy.arena() != &context.arena() );
+  copy = context;
+  QVERIFY( &copy.arena() != &context.arena() );
+}
+
+QGSTEST_MAIN( TestQgsArenaAllocator )
+#include "testqgsarenaallocator.moc"
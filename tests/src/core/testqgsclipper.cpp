@@ -15,14 +15,17 @@
 #include "qgstest.h"
 #include <QFile>
 #include <QTextStream>
+#include <QtMath>
 #include <QObject>
 #include <QString>
 #include <QStringList>
 #include <qgsapplication.h>
 //header for class being tested
 #include <qgsclipper.h>
+#include <qgsarenaallocator.h>
 #include <qgspoint.h>
 #include "qgslogger.h"
+#include "qgstestutils.h"
 
 class TestQgsClipper: public QObject
 {
@@ -34,6 +37,9 @@ class TestQgsClipper: public QObject
     void init() {} // will be called before each testfunction is executed.
     void cleanup() {} // will be called after every testfunction.
     void basic();
+    void trimPolygonArena();
+    void trimPolygonVertexCounts();
+    void clippedLine();
   private:
     bool checkBoundingBox( const QPolygonF &polygon, const QgsRectangle &clipRect );
 };
@@ -78,6 +84,144 @@ void TestQgsClipper::basic()
   QVERIFY( ! checkBoundingBox( polygon, clipRectInner ) );
 }
 
+void TestQgsClipper::trimPolygonArena()
+{
+  QgsArenaAllocator arena( 1024 );
+
+  // the same result as when clipping without arena
+  QPolygonF polygon;
+  polygon << QPointF( 1.0, 9.0 ) << QPointF( 11.0, 11.0 ) << QPointF( 9.0, 1.0 );
+  const QgsRectangle clipRect( 0.0, 0.0, 10.0, 10.0 );
+  QPolygonF expected = polygon;
+  QgsClipper::trimPolygon( expected, clipRect );
+  QgsClipper::trimPolygon( polygon, clipRect, arena );
+  QCOMPARE( polygon, expected );
+  QCOMPARE( polygon.size(), 5 );
+
+  // a star crossing all the boundaries
+  polygon.clear();
+  for ( int i = 0; i < 20; ++i )
+  {
+    const double radius = i % 2 ? 20 : 4;
+    polygon << QPointF( 5 + radius * std::cos( i * M_PI / 10 ), 5 + radius * std::sin( i * M_PI / 10 ) );
+  }
+  expected = polygon;
+  QgsClipper::trimPolygon( expected, clipRect );
+  QgsClipper::trimPolygon( polygon, clipRect, arena );
+  QCOMPARE( polygon, expected );
+  QVERIFY( checkBoundingBox( polygon, clipRect ) );
+
+  // the intermediate buffers are given back to the arena
+  const QgsArenaAllocator::Marker marker = arena.mark();
+  QgsClipper::trimPolygon( polygon, clipRect, arena );
+  QCOMPARE( arena.mark().block, marker.block );
+  QCOMPARE( arena.mark().offset, marker.offset );
+
+  // empty polygons are left alone
+  polygon.clear();
+  QgsClipper::trimPolygon( polygon, clipRect, arena );
+  QVERIFY( polygon.isEmpty() );
+}
+
+void TestQgsClipper::trimPolygonVertexCounts()
+{
+  // straightforward Sutherland-Hodgman clipping, against which the batched version is checked
+  auto clipReference = []( const QPolygonF & polygon, const QgsRectangle & rect )
+  {
+    QPolygonF in = polygon;
+    for ( int b = 0; b < 4; ++b )
+    {
+      auto isInside = [b, &rect]( QPointF p )
+      {
+        switch ( b )
+        {
+          case 0:
+            return p.x() < rect.xMaximum();
+          case 1:
+            return p.y() < rect.yMaximum();
+          case 2:
+            return p.x() > rect.xMinimum();
+          default:
+            return p.y() > rect.yMinimum();
+        }
+      };
+      auto intersection = [b, &rect]( QPointF p1, QPointF p2 )
+      {
+        if ( b == 0 || b == 2 )
+        {
+          const double x = b == 0 ? rect.xMaximum() : rect.xMinimum();
+          return QPointF( x, p1.y() + ( x - p1.x() ) * ( p2.y() - p1.y() ) / ( p2.x() - p1.x() ) );
+        }
+        const double y = b == 1 ? rect.yMaximum() : rect.yMinimum();
+        return QPointF( p1.x() + ( y - p1.y() ) * ( p2.x() - p1.x() ) / ( p2.y() - p1.y() ), y );
+      };
+
+      QPolygonF out;
+      for ( int i = 0; i < in.size(); ++i )
+      {
+        const QPointF p1 = in.at( ( i + in.size() - 1 ) % in.size() );
+        const QPointF p2 = in.at( i );
+        if ( isInside( p2 ) != isInside( p1 ) )
+          out << intersection( p1, p2 );
+        if ( isInside( p2 ) )
+          out << p2;
+      }
+      in = out;
+    }
+    return in;
+  };
+
+  const QgsRectangle clipRect( 0.0, 0.0, 10.0, 10.0 );
+  QgsArenaAllocator arena;
+  for ( int count = 0; count < 40; ++count )
+  {
+    QPolygonF polygon;
+    for ( int i = 0; i < count; ++i )
+    {
+      const double radius = i % 3 ? 8 : 3;
+      polygon << QPointF( 5 + radius * std::cos( i * 2 * M_PI / count ), 5 + radius * std::sin( i * 2 * M_PI / count ) );
+    }
+    const QPolygonF expected = clipReference( polygon, clipRect );
+
+    QgsClipper::trimPolygon( polygon, clipRect, arena );
+    QCOMPARE( polygon.size(), expected.size() );
+    for ( int i = 0; i < polygon.size(); ++i )
+    {
+      QGSCOMPARENEAR( polygon.at( i ).x(), expected.at( i ).x(), 1e-9 );
+      QGSCOMPARENEAR( polygon.at( i ).y(), expected.at( i ).y(), 1e-9 );
+    }
+  }
+
+  // polygons completely inside or outside
+  QPolygonF polygon;
+  polygon << QPointF( 1, 1 ) << QPointF( 2, 1 ) << QPointF( 2, 2 ) << QPointF( 1, 1 );
+  QPolygonF inside = polygon;
+  QgsClipper::trimPolygon( inside, clipRect );
+  QCOMPARE( inside, polygon );
+  QPolygonF outside = polygon.translated( 20, 0 );
+  QgsClipper::trimPolygon( outside, clipRect );
+  QVERIFY( outside.isEmpty() );
+}
+
+void TestQgsClipper::clippedLine()
+{
+  const QgsRectangle clipRect( 0.0, 0.0, 10.0, 10.0 );
+
+  // lines inside the rectangle, including on its border, are unchanged
+  QPolygonF line;
+  line << QPointF( 0, 0 ) << QPointF( 5, 5 ) << QPointF( 10, 2 );
+  QCOMPARE( QgsClipper::clippedLine( line, clipRect ), line );
+
+  // a single point is not a line
+  QVERIFY( QgsClipper::clippedLine( QPolygonF() << QPointF( 5, 5 ), clipRect ).isEmpty() );
+
+  // lines crossing the rectangle are cut at its border
+  line.clear();
+  line << QPointF( -5, 5 ) << QPointF( 5, 5 ) << QPointF( 15, 5 );
+  QPolygonF clipped = QgsClipper::clippedLine( line, clipRect );
+  QCOMPARE( clipped, QPolygonF() << QPointF( 0, 5 ) << QPointF( 5, 5 ) << QPointF( 10, 5 ) );
+}
+
 bool TestQgsClipper::checkBoundingBox( const QPolygonF &polygon, const QgsRectangle &clipRect )
 {
   QgsRectangle bBox( polygon.boundingRect() );
@@ -15,9 +15,14 @@
  *                                                                         *
  ***************************************************************************/
 #include "qgscoordinatetransform.h"
+#include "qgsapproximatecoordinatetransform.h"
 #include "qgsapplication.h"
+#include "qgscsexception.h"
 #include "qgsrectangle.h"
+#include "qgstestutils.h"
 #include <QObject>
+#include <QPolygonF>
+#include <QtConcurrentMap>
 #include "qgstest.h"
 
 class TestQgsCoordinateTransform: public QObject
@@ -32,6 +37,10 @@ class TestQgsCoordinateTransform: public QObject
     void assignment();
     void isValid();
     void isShortCircuited();
+    void transformCoordsParallel();
+    void transformFromThreads();
+    void approximateTransform();
+    void approximateTransformInvalid();
 
   private:
 
@@ -206,5 +215,133 @@ void TestQgsCoordinateTransform::transformBoundingBox()
   QVERIFY( qgsDoubleNear( resultRect.yMaximum(), expectedRect.yMaximum(), 0.001 ) );
 }
 
+void TestQgsCoordinateTransform::transformCoordsParallel()
+{
+  QgsCoordinateReferenceSystem sourceSrs;
+  sourceSrs.createFromSrid( 4326 );
+  QgsCoordinateReferenceSystem destSrs;
+  destSrs.createFromSrid( 3857 );
+  QgsCoordinateTransform tr( sourceSrs, destSrs );
+
+  // enough points to be split in chunks, interleaved to check the stride
+  const int count = 100000;
+  QVector< double > xy( 2 * count );
+  for ( int i = 0; i < count; ++i )
+  {
+    xy[ 2 * i ] = -170.0 + 340.0 * i / count;
+    xy[ 2 * i + 1 ] = -80.0 + 160.0 * ( i % 1000 ) / 1000;
+  }
+  QVector< double > expected = xy;
+
+  tr.transformCoordsParallel( count, xy.data(), xy.data() + 1, nullptr, QgsCoordinateTransform::ForwardTransform, 2 );
+  tr.transformCoords( count, expected.data(), expected.data() + 1, nullptr, QgsCoordinateTransform::ForwardTransform, 2 );
+  QVERIFY( xy == expected );
+
+  // and back
+  tr.transformCoordsParallel( count, xy.data(), xy.data() + 1, nullptr, QgsCoordinateTransform::ReverseTransform, 2 );
+  QGSCOMPARENEAR( xy.at( 0 ), -170.0, 0.000001 );
+  QGSCOMPARENEAR( xy.at( 2 * count - 1 ), -80.0 + 160.0 * 999 / 1000, 0.000001 );
+}
+
+void TestQgsCoordinateTransform::transformFromThreads()
+{
+  QgsCoordinateReferenceSystem sourceSrs;
+  sourceSrs.createFromSrid( 3111 );
+  QgsCoordinateReferenceSystem destSrs;
+  destSrs.createFromSrid( 4326 );
+  const QgsCoordinateTransform tr( sourceSrs, destSrs );
+
+  // one transform shared by concurrent jobs gives the same results as a sequential transform
+  QList< QPolygonF > polygons;
+  for ( int i = 0; i < 64; ++i )
+  {
+    QPolygonF polygon;
+    for ( int j = 0; j < 1000; ++j )
+      polygon << QPointF( 2500000 + 100 * i + j, 2400000 + 50 * j );
+    polygons << polygon;
+  }
+  QList< QPolygonF > expected = polygons;
+  for ( QPolygonF &polygon : expected )
+    tr.transformPolygon( polygon );
+
+  auto transformPolygon = [&tr]( QPolygonF & polygon ) { tr.transformPolygon( polygon ); };
+  QtConcurrent::blockingMap( polygons, transformPolygon );
+  QCOMPARE( polygons, expected );
+}
+
+void TestQgsCoordinateTransform::approximateTransform()
+{
+  QgsCoordinateReferenceSystem sourceSrs;
+  sourceSrs.createFromSrid( 4326 );
+  QgsCoordinateReferenceSystem destSrs;
+  destSrs.createFromSrid( 3111 );
+  const QgsCoordinateTransform tr( sourceSrs, destSrs );
+
+  const QgsRectangle extent( 144, -38, 146, -37 );
+  const double tolerance = 0.5;
+  const QgsApproximateCoordinateTransform approximate( tr, extent, tolerance );
+  QVERIFY( approximate.isValid() );
+  QVERIFY( approximate.gridColumns() >= 3 );
+  QVERIFY( approximate.gridRows() >= 3 );
+
+  // points inside the extent are interpolated close to the exact transform, points
+  // outside are transformed exactly
+  QPolygonF polygon;
+  for ( int i = 0; i <= 100; ++i )
+    polygon << QPointF( 143.8 + 0.025 * i, -38.2 + 0.015 * i );
+  QPolygonF expected = polygon;
+  tr.transformPolygon( expected );
+  approximate.transformPolygon( polygon );
+  for ( int i = 0; i < polygon.size(); ++i )
+  {
+    QGSCOMPARENEAR( polygon.at( i ).x(), expected.at( i ).x(), 2 * tolerance );
+    QGSCOMPARENEAR( polygon.at( i ).y(), expected.at( i ).y(), 2 * tolerance );
+  }
+  QCOMPARE( polygon.first(), expected.first() );
+  QCOMPARE( polygon.last(), expected.last() );
+
+  // the grid nodes are exact
+  double x = extent.xMinimum();
+  double y = extent.yMaximum();
+  double exactX = x;
+  double exactY = y;
+  approximate.transformCoords( 1, &x, &y );
+  tr.transformCoords( 1, &exactX, &exactY, nullptr );
+  QGSCOMPARENEAR( x, exactX, 0.000001 );
+  QGSCOMPARENEAR( y, exactY, 0.000001 );
+
+  // a smaller tolerance needs a finer grid
+  const QgsApproximateCoordinateTransform finer( tr, extent, tolerance / 10 );
+  QVERIFY( finer.isValid() );
+  QVERIFY( finer.gridColumns() * finer.gridRows() > approximate.gridColumns() * approximate.gridRows() );
+}
+
+void TestQgsCoordinateTransform::approximateTransformInvalid()
+{
+  QgsCoordinateReferenceSystem sourceSrs;
+  sourceSrs.createFromSrid( 4326 );
+  QgsCoordinateReferenceSystem destSrs;
+  destSrs.createFromSrid( 3111 );
+  const QgsCoordinateTransform tr( sourceSrs, destSrs );
+
+  QVERIFY( !QgsApproximateCoordinateTransform().isValid() );
+  QVERIFY( !QgsApproximateCoordinateTransform( QgsCoordinateTransform(), QgsRectangle( 141, -39, 150, -34 ), 1 ).isValid() );
+  QVERIFY( !QgsApproximateCoordinateTransform( tr, QgsRectangle(), 1 ).isValid() );
+  QVERIFY( !QgsApproximateCoordinateTransform( tr, QgsRectangle( 141, -39, 150, -34 ), 0 ).isValid() );
+
+  // the tolerance cannot be reached with a small grid
+  const QgsApproximateCoordinateTransform coarse( tr, QgsRectangle( 100, -60, 180, 0 ), 0.001, 5 );
+  QVERIFY( !coarse.isValid() );
+  QCOMPARE( coarse.gridColumns(), 0 );
+
+  // an invalid approximation transforms exactly
+  QPolygonF polygon;
+  polygon << QPointF( 145, -37 ) << QPointF( 146, -38 );
+  QPolygonF expected = polygon;
+  tr.transformPolygon( expected );
+  coarse.transformPolygon( polygon );
+  QCOMPARE( polygon, expected );
+}
+
 QGSTEST_MAIN( TestQgsCoordinateTransform )
 #include "testqgscoordinatetransform.moc"
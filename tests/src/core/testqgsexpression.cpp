@@ -65,6 +65,18 @@ class TestQgsExpression: public QObject
     QgsVectorLayer *mChildLayer = nullptr;
     QgsRasterLayer *mRasterLayer = nullptr;
 
+    void compareCompiledResult( const QVariant &compiled, const QVariant &tree )
+    {
+      QCOMPARE( compiled.type(), tree.type() );
+      QCOMPARE( compiled.isNull(), tree.isNull() );
+      if ( tree.userType() == qMetaTypeId<QgsInterval>() )
+        QCOMPARE( compiled.value<QgsInterval>().seconds(), tree.value<QgsInterval>().seconds() );
+      else if ( tree.userType() == qMetaTypeId<QgsGeometry>() )
+        QCOMPARE( compiled.value<QgsGeometry>().exportToWkt(), tree.value<QgsGeometry>().exportToWkt() );
+      else
+        QCOMPARE( compiled, tree );
+    }
+
   private slots:
 
     void initTestCase()
@@ -2746,6 +2758,366 @@ class TestQgsExpression: public QObject
       QCOMPARE( QgsExpression::formatPreviewString( QVariant( stringList ) ),
                 QString( "<i>&lt;array: 'One', 'Two', 'A very long string that is going to be trunca...&gt;</i>" ) );
     }
+
+    void compiled_evaluation_data()
+    {
+      evaluation_data();
+    }
+
+    void compiled_evaluation()
+    {
+      QFETCH( QString, string );
+
+      QgsExpressionContext context;
+      QgsExpression exp( string );
+      QVERIFY( !exp.hasParserError() );
+      exp.prepare( &context );
+      QVariant treeResult = exp.evaluate( &context );
+      bool treeError = exp.hasEvalError();
+      QString treeErrorString = exp.evalErrorString();
+
+      QVERIFY( exp.compile() );
+      QVERIFY( exp.isCompiled() );
+      QVariant compiledResult = exp.evaluate( &context );
+      QCOMPARE( exp.hasEvalError(), treeError );
+      QCOMPARE( exp.evalErrorString(), treeErrorString );
+      compareCompiledResult( compiledResult, treeResult );
+
+      // evaluating without context must also match
+      QgsExpression exp2( string );
+      exp2.prepare( &context );
+      treeResult = exp2.evaluate();
+      treeError = exp2.hasEvalError();
+      QVERIFY( exp2.compile() );
+      compiledResult = exp2.evaluate();
+      QCOMPARE( exp2.hasEvalError(), treeError );
+      compareCompiledResult( compiledResult, treeResult );
+    }
+
+    void compiled_eval_columns_data()
+    {
+      QTest::addColumn<QString>( "string" );
+
+      QTest::newRow( "column" ) << "\"int\"";
+      QTest::newRow( "arithmetic" ) << "\"int\" * 2 + \"double\" / 3 - 1";
+      QTest::newRow( "integer arithmetic" ) << "\"int\" % 3 + \"int\" // 2";
+      QTest::newRow( "division by zero" ) << "\"double\" / (\"int\" - \"int\")";
+      QTest::newRow( "overflow" ) << "(\"double\" + 10) ^ 400 + 1";
+      QTest::newRow( "null arithmetic" ) << "\"null\" + 1";
+      QTest::newRow( "string arithmetic" ) << "\"string\" + 'x'";
+      QTest::newRow( "string number" ) << "\"numstring\" * 2";
+      QTest::newRow( "bad conversion" ) << "\"string\" * 2";
+      QTest::newRow( "comparison" ) << "\"int\" > 3 AND \"double\" <= 10.5 OR \"int\" = 1";
+      QTest::newRow( "string comparison" ) << "\"string\" = 'abc'";
+      QTest::newRow( "null logic" ) << "\"null\" > 3 OR \"int\" > 2";
+      QTest::newRow( "not" ) << "NOT (\"int\" > 3)";
+      QTest::newRow( "minus" ) << "-\"int\" + -\"double\"";
+      QTest::newRow( "is" ) << "\"null\" IS NULL AND \"int\" IS NOT 5";
+      QTest::newRow( "in" ) << "\"int\" IN (1, 3, '5', NULL)";
+      QTest::newRow( "not in" ) << "\"string\" NOT IN ('abc', 'xyz')";
+      QTest::newRow( "in null" ) << "\"null\" IN (1, 2)";
+      QTest::newRow( "case" ) << "CASE WHEN \"int\" < 3 THEN 'small' WHEN \"int\" < 6 THEN \"double\" END";
+      QTest::newRow( "case else" ) << "CASE WHEN \"null\" THEN 1 ELSE \"int\" * 2 END";
+      QTest::newRow( "function" ) << "round(\"double\" * 1.5, 1)";
+      QTest::newRow( "function null" ) << "round(\"null\", 2)";
+      QTest::newRow( "function handles null" ) << "coalesce(\"null\", \"int\")";
+      QTest::newRow( "lazy function" ) << "if(\"int\" > 3, 'a', 'b')";
+      QTest::newRow( "nested functions" ) << "concat(upper(\"string\"), to_string(\"int\" + 1))";
+      QTest::newRow( "like" ) << "\"string\" LIKE 'a%'";
+      QTest::newRow( "concat" ) << "\"string\" || \"int\"";
+      QTest::newRow( "variable" ) << "@var_int * \"int\"";
+      QTest::newRow( "static variable" ) << "@var_static * \"int\"";
+      QTest::newRow( "static subtree" ) << "\"int\" + (2 * 3 + pi())";
+      QTest::newRow( "common subexpressions" ) << "(\"int\" * 2 + 1) * (\"int\" * 2 + 1) - \"int\" * 2";
+      QTest::newRow( "common subexpressions in case" ) << "CASE WHEN \"int\" > 3 THEN \"int\" * 2 WHEN \"int\" * 2 > 4 THEN \"int\" * 2 + 1 ELSE \"int\" * 2 END";
+      QTest::newRow( "common subexpressions in in" ) << "\"int\" * 2 IN (\"double\", \"int\" + 1, \"int\" * 2) AND \"int\" + 1 > 3";
+      QTest::newRow( "common subexpressions after null" ) << "round(\"null\" + \"int\", \"int\" * 2) || (\"int\" * 2)";
+    }
+
+    void compiled_eval_columns()
+    {
+      QFETCH( QString, string );
+
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "int" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "double" ), QVariant::Double ) );
+      fields.append( QgsField( QStringLiteral( "string" ), QVariant::String ) );
+      fields.append( QgsField( QStringLiteral( "numstring" ), QVariant::String ) );
+      fields.append( QgsField( QStringLiteral( "null" ), QVariant::Int ) );
+
+      QgsExpressionContext context;
+      QgsExpressionContextScope *scope = new QgsExpressionContextScope();
+      scope->setVariable( QStringLiteral( "var_int" ), 3 );
+      scope->setVariable( QStringLiteral( "var_static" ), 4, true );
+      context.appendScope( scope );
+      context.setFields( fields );
+
+      QgsExpression tree( string );
+      QVERIFY( !tree.hasParserError() );
+      QVERIFY( tree.prepare( &context ) );
+      QgsExpression compiled( string );
+      QVERIFY( compiled.prepare( &context ) );
+      QVERIFY( compiled.compile() );
+
+      QStringList strings;
+      strings << QStringLiteral( "abc" ) << QStringLiteral( "xyz" ) << QString();
+      for ( int i = 0; i < 9; ++i )
+      {
+        QgsFeature f( fields, i );
+        f.setAttribute( 0, i );
+        f.setAttribute( 1, i * 2.5 );
+        f.setAttribute( 2, strings.at( i % 3 ) );
+        f.setAttribute( 3, QString::number( i ) );
+        f.setAttribute( 4, QVariant( QVariant::Int ) );
+        context.setFeature( f );
+
+        QVariant treeResult = tree.evaluate( &context );
+        QVariant compiledResult = compiled.evaluate( &context );
+        QCOMPARE( compiled.hasEvalError(), tree.hasEvalError() );
+        QCOMPARE( compiled.evalErrorString(), tree.evalErrorString() );
+        compareCompiledResult( compiledResult, treeResult );
+      }
+    }
+
+    void evaluate_block_data()
+    {
+      compiled_eval_columns_data();
+    }
+
+    void evaluate_block()
+    {
+      QFETCH( QString, string );
+
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "int" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "double" ), QVariant::Double ) );
+      fields.append( QgsField( QStringLiteral( "string" ), QVariant::String ) );
+      fields.append( QgsField( QStringLiteral( "numstring" ), QVariant::String ) );
+      fields.append( QgsField( QStringLiteral( "null" ), QVariant::Int ) );
+
+      QgsExpressionContext context;
+      QgsExpressionContextScope *scope = new QgsExpressionContextScope();
+      scope->setVariable( QStringLiteral( "var_int" ), 3 );
+      scope->setVariable( QStringLiteral( "var_static" ), 4, true );
+      context.appendScope( scope );
+      context.setFields( fields );
+
+      QgsExpression tree( string );
+      QVERIFY( tree.prepare( &context ) );
+      QgsExpression compiled( string );
+      QVERIFY( compiled.prepare( &context ) );
+      QVERIFY( compiled.compile() );
+
+      QStringList strings;
+      strings << QStringLiteral( "abc" ) << QStringLiteral( "xyz" ) << QString();
+      QgsFeatureList features;
+      QVariantList expected;
+      bool expectedError = false;
+      for ( int i = 0; i < 9; ++i )
+      {
+        QgsFeature f( fields, i );
+        f.setAttribute( 0, i );
+        f.setAttribute( 1, i * 2.5 );
+        f.setAttribute( 2, strings.at( i % 3 ) );
+        f.setAttribute( 3, QString::number( i ) );
+        f.setAttribute( 4, QVariant( QVariant::Int ) );
+        features << f;
+
+        context.setFeature( f );
+        QVariant result = tree.evaluate( &context );
+        expected << ( tree.hasEvalError() ? QVariant() : result );
+        expectedError = expectedError || tree.hasEvalError();
+      }
+
+      QVariantList treeResults = tree.evaluateBlock( features, &context );
+      QCOMPARE( tree.hasEvalError(), expectedError );
+      QVariantList compiledResults = compiled.evaluateBlock( features, &context );
+      QCOMPARE( compiled.hasEvalError(), expectedError );
+
+      QCOMPARE( treeResults.count(), features.count() );
+      QCOMPARE( compiledResults.count(), features.count() );
+      for ( int i = 0; i < features.count(); ++i )
+      {
+        compareCompiledResult( treeResults.at( i ), expected.at( i ) );
+        compareCompiledResult( compiledResults.at( i ), expected.at( i ) );
+      }
+
+      // without a context
+      QVariantList noContextResults = compiled.evaluateBlock( features, nullptr );
+      QCOMPARE( noContextResults.count(), features.count() );
+    }
+
+    void compiled_prepare()
+    {
+      QgsExpression exp( QStringLiteral( "1 + 2" ) );
+      QVERIFY( !exp.isCompiled() );
+      QgsExpressionContext context;
+      QVERIFY( exp.prepare( &context ) );
+      QVERIFY( exp.compile() );
+      QVERIFY( exp.isCompiled() );
+      QCOMPARE( exp.evaluate( &context ).toInt(), 3 );
+
+      // copies need to be compiled again
+      QgsExpression copy( exp );
+      QVERIFY( copy.prepare( &context ) );
+      QVERIFY( !copy.isCompiled() );
+      QCOMPARE( copy.evaluate( &context ).toInt(), 3 );
+
+      // preparing again discards the program
+      QVERIFY( exp.prepare( &context ) );
+      QVERIFY( !exp.isCompiled() );
+      QCOMPARE( exp.evaluate( &context ).toInt(), 3 );
+
+      QgsExpression invalid( QStringLiteral( "1 +" ) );
+      QVERIFY( !invalid.compile() );
+      QVERIFY( !invalid.isCompiled() );
+    }
+
+    void static_nodes_data()
+    {
+      QTest::addColumn<QString>( "string" );
+      QTest::addColumn<bool>( "isStatic" );
+      QTest::addColumn<QVariant>( "result" );
+
+      QTest::newRow( "literal" ) << "5" << true << QVariant( 5 );
+      QTest::newRow( "arithmetic" ) << "1000 * 1000" << true << QVariant( 1000000 );
+      QTest::newRow( "column" ) << "\"pop\" / 2" << false << QVariant( 5 );
+      QTest::newRow( "function" ) << "round(pi(), 2)" << true << QVariant( 3.14 );
+      QTest::newRow( "nested" ) << "upper('a' || 'b') IN ('AB', 'CD')" << true << QVariant( 1 );
+      QTest::newRow( "case" ) << "CASE WHEN 1 > 2 THEN 'a' ELSE 'b' END" << true << QVariant( "b" );
+      QTest::newRow( "static variable" ) << "@static_var * 2" << true << QVariant( 20 );
+      QTest::newRow( "variable" ) << "@dynamic_var * 2" << false << QVariant( 40 );
+      QTest::newRow( "missing variable" ) << "@missing_var" << false << QVariant();
+      QTest::newRow( "volatile" ) << "rand(5, 5)" << false << QVariant( 5 );
+      QTest::newRow( "geometry function" ) << "x(make_point(1, 2))" << true << QVariant( 1.0 );
+      QTest::newRow( "record" ) << "$id" << false << QVariant( 1LL );
+      QTest::newRow( "error" ) << "'a' * 2" << false << QVariant();
+    }
+
+    void static_nodes()
+    {
+      QFETCH( QString, string );
+      QFETCH( bool, isStatic );
+      QFETCH( QVariant, result );
+
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "pop" ), QVariant::Int ) );
+      QgsFeature f( fields, 1 );
+      f.setAttribute( 0, 10 );
+
+      QgsExpressionContext context;
+      QgsExpressionContextScope *scope = new QgsExpressionContextScope();
+      scope->setVariable( QStringLiteral( "static_var" ), 10, true );
+      scope->setVariable( QStringLiteral( "dynamic_var" ), 10 );
+      context.appendScope( scope );
+      context.setFields( fields );
+
+      QgsExpression exp( string );
+      QVERIFY( exp.prepare( &context ) );
+      QCOMPARE( exp.rootNode()->hasCachedStaticValue(), isStatic );
+      QVERIFY( !exp.hasEvalError() );
+
+      // static values are computed when preparing, changes to dynamic variables
+      // must still be picked up
+      scope->setVariable( QStringLiteral( "dynamic_var" ), 20 );
+      context.setFeature( f );
+      QVariant value = exp.evaluate( &context );
+      QCOMPARE( exp.hasEvalError(), string == QLatin1String( "'a' * 2" ) );
+      QCOMPARE( value, result );
+    }
+
+    void benchmark_compiled_data()
+    {
+      QTest::addColumn<QString>( "string" );
+      QTest::addColumn<bool>( "compiled" );
+
+      QStringList expressions;
+      expressions << QStringLiteral( "\"pop\" / (1000 * 1000)" )
+                  << QStringLiteral( "\"pop\" > 5000 AND \"area\" < 200.5 OR \"class\" = 3" )
+                  << QStringLiteral( "\"class\" IN (1, 2, 3, 7)" )
+                  << QStringLiteral( "CASE WHEN \"pop\" < 1000 THEN 1 WHEN \"pop\" < 5000 THEN 2 ELSE 3 END" )
+                  << QStringLiteral( "round(\"pop\" / \"area\", 2) > 10" );
+      Q_FOREACH ( const QString &expression, expressions )
+      {
+        QTest::newRow( QStringLiteral( "tree %1" ).arg( expression ).toLocal8Bit().constData() ) << expression << false;
+        QTest::newRow( QStringLiteral( "compiled %1" ).arg( expression ).toLocal8Bit().constData() ) << expression << true;
+      }
+    }
+
+    void benchmark_compiled()
+    {
+      QFETCH( QString, string );
+      QFETCH( bool, compiled );
+
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "pop" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "area" ), QVariant::Double ) );
+      fields.append( QgsField( QStringLiteral( "class" ), QVariant::Int ) );
+
+      QList< QgsFeature > features;
+      for ( int i = 0; i < 1000; ++i )
+      {
+        QgsFeature f( fields, i );
+        f.setAttribute( 0, i * 10 );
+        f.setAttribute( 1, 1.5 + i );
+        f.setAttribute( 2, i % 10 );
+        features << f;
+      }
+
+      QgsExpressionContext context;
+      context.setFields( fields );
+      QgsExpression exp( string );
+      QVERIFY( exp.prepare( &context ) );
+      if ( compiled )
+        QVERIFY( exp.compile() );
+
+      QBENCHMARK
+      {
+        Q_FOREACH ( const QgsFeature &f, features )
+        {
+          context.setFeature( f );
+          exp.evaluate( &context );
+        }
+      }
+    }
+
+    void benchmark_block_data()
+    {
+      benchmark_compiled_data();
+    }
+
+    void benchmark_block()
+    {
+      QFETCH( QString, string );
+      QFETCH( bool, compiled );
+
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "pop" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "area" ), QVariant::Double ) );
+      fields.append( QgsField( QStringLiteral( "class" ), QVariant::Int ) );
+
+      QgsFeatureList features;
+      for ( int i = 0; i < 1000; ++i )
+      {
+        QgsFeature f( fields, i );
+        f.setAttribute( 0, i * 10 );
+        f.setAttribute( 1, 1.5 + i );
+        f.setAttribute( 2, i % 10 );
+        features << f;
+      }
+
+      QgsExpressionContext context;
+      context.setFields( fields );
+      QgsExpression exp( string );
+      QVERIFY( exp.prepare( &context ) );
+      if ( compiled )
+        QVERIFY( exp.compile() );
+
+      QBENCHMARK
+      {
+        exp.evaluateBlock( features, &context );
+      }
+    }
 };
 
 QGSTEST_MAIN( TestQgsExpression )
@@ -170,6 +170,19 @@ void TestQgsExpressionContext::contextScope()
   scope.setVariable( QStringLiteral( "readonly" ), "newvalue" );
   QVERIFY( scope.isReadOnly( "readonly" ) );
 
+  //static variables
+  scope.setVariable( QStringLiteral( "static" ), 5, true );
+  QVERIFY( scope.isStatic( "static" ) );
+  QVERIFY( !scope.isStatic( "test" ) );
+  QVERIFY( !scope.isStatic( "missing" ) );
+  scope.addVariable( QgsExpressionContextScope::StaticVariable( QStringLiteral( "static2" ), 5, true, true ) );
+  QVERIFY( scope.isStatic( "static2" ) );
+  //updating a variable without the static flag makes it dynamic
+  scope.setVariable( QStringLiteral( "static" ), 6 );
+  QVERIFY( !scope.isStatic( "static" ) );
+  QVERIFY( scope.removeVariable( "static" ) );
+  QVERIFY( scope.removeVariable( "static2" ) );
+
   //test retrieving filtered variable names
   scope.setVariable( QStringLiteral( "_hidden_" ), "hidden" );
   QCOMPARE( scope.filteredVariableNames(), QStringList() << "readonly" << "notreadonly" << "test" );
@@ -299,6 +312,13 @@ void TestQgsExpressionContext::contextStack()
   QVERIFY( context.isReadOnly( "readonly" ) );
   QVERIFY( !context.isReadOnly( "test" ) );
 
+  //check isStatic, the last scope containing the variable wins
+  scope1->setVariable( QStringLiteral( "static" ), 5, true );
+  QVERIFY( context.isStatic( "static" ) );
+  scope2->setVariable( QStringLiteral( "static" ), 6 );
+  QVERIFY( !context.isStatic( "static" ) );
+  QVERIFY( !context.isStatic( "missing" ) );
+
   // Check scopes can be popped
   delete context.popScope();
   QCOMPARE( scopes.length(), 2 );
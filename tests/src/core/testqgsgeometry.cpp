@@ -22,6 +22,8 @@
 #include <QDesktopServices>
 #include <QVector>
 #include <QPointF>
+#include <QTransform>
+#include <QtConcurrentMap>
 #include <QImage>
 #include <QPainter>
 
@@ -40,6 +42,7 @@
 #include "qgscircularstring.h"
 #include "qgsgeometrycollection.h"
 #include "qgsgeometryfactory.h"
+#include "qgswkbgeometryview.h"
 #include "qgstestutils.h"
 
 //qgs unit test utility class
@@ -116,6 +119,9 @@ class TestQgsGeometry : public QObject
 
     void makeValid();
 
+    void preparedPredicates();
+    void wkbView();
+
   private:
     //! A helper method to do a render check to see if the geometry op is as expected
     bool renderCheck( const QString &testName, const QString &comment = QLatin1String( QLatin1String( "" ) ), int mismatchCount = 0 );
@@ -2332,6 +2338,38 @@ void TestQgsGeometry::lineString()
   QCOMPARE( extend1.pointN( 0 ), QgsPointV2( QgsWkbTypes::Point, -1, 0 ) );
   QCOMPARE( extend1.pointN( 1 ), QgsPointV2( QgsWkbTypes::Point, 1, 0 ) );
   QCOMPARE( extend1.pointN( 2 ), QgsPointV2( QgsWkbTypes::Point, 1, 3 ) );
+
+  //changing the dimensions keeps the other coordinates of each vertex
+  QgsLineString dims;
+  dims.setPoints( QList<QgsPointV2>() << QgsPointV2( QgsWkbTypes::PointM, 1, 2, 0, 3 ) << QgsPointV2( QgsWkbTypes::PointM, 4, 5, 0, 6 ) );
+  QVERIFY( dims.addZValue( 7 ) );
+  QCOMPARE( dims.pointN( 1 ), QgsPointV2( QgsWkbTypes::PointZM, 4, 5, 7, 6 ) );
+  dims.setZAt( 0, 8 );
+  dims.setMAt( 0, 9 );
+  QCOMPARE( dims.pointN( 0 ), QgsPointV2( QgsWkbTypes::PointZM, 1, 2, 8, 9 ) );
+  QVERIFY( dims.dropMValue() );
+  QCOMPARE( dims.pointN( 0 ), QgsPointV2( QgsWkbTypes::PointZ, 1, 2, 8 ) );
+  QVERIFY( dims.dropZValue() );
+  QVERIFY( dims.addMValue( 10 ) );
+  QCOMPARE( dims.pointN( 1 ), QgsPointV2( QgsWkbTypes::PointM, 4, 5, 0, 10 ) );
+  QCOMPARE( dims.zAt( 1 ), 0.0 );
+  dims.setZAt( 1, 11 );
+  QCOMPARE( dims.mAt( 1 ), 10.0 );
+  QCOMPARE( dims.asQPolygonF(), QPolygonF() << QPointF( 1, 2 ) << QPointF( 4, 5 ) );
+
+  //vertices inserted, moved and deleted in the middle of a line with z and m values
+  dims.addZValue( 1 );
+  dims.insertVertex( QgsVertexId( 0, 0, 1 ), QgsPointV2( QgsWkbTypes::PointZM, 2, 3, 4, 5 ) );
+  QCOMPARE( dims.numPoints(), 3 );
+  QCOMPARE( dims.pointN( 1 ), QgsPointV2( QgsWkbTypes::PointZM, 2, 3, 4, 5 ) );
+  QCOMPARE( dims.pointN( 2 ), QgsPointV2( QgsWkbTypes::PointZM, 4, 5, 1, 10 ) );
+  dims.moveVertex( QgsVertexId( 0, 0, 2 ), QgsPointV2( QgsWkbTypes::PointZM, 6, 7, 8, 9 ) );
+  dims.deleteVertex( QgsVertexId( 0, 0, 0 ) );
+  QCOMPARE( dims.pointN( 0 ), QgsPointV2( QgsWkbTypes::PointZM, 2, 3, 4, 5 ) );
+  QCOMPARE( dims.pointN( 1 ), QgsPointV2( QgsWkbTypes::PointZM, 6, 7, 8, 9 ) );
+  std::unique_ptr< QgsLineString > dimsReversed( dims.reversed() );
+  QCOMPARE( dimsReversed->pointN( 0 ), QgsPointV2( QgsWkbTypes::PointZM, 6, 7, 8, 9 ) );
+  QCOMPARE( dimsReversed->pointN( 1 ), QgsPointV2( QgsWkbTypes::PointZM, 2, 3, 4, 5 ) );
 }
 
 void TestQgsGeometry::polygon()
@@ -4215,5 +4253,163 @@ void TestQgsGeometry::makeValid()
   }
 }
 
+void TestQgsGeometry::preparedPredicates()
+{
+  QgsGeometry polygon = QgsGeometry::fromWkt( QStringLiteral( "Polygon((0 0, 10 0, 10 10, 0 10, 0 0))" ) );
+  QgsGeometry inside = QgsGeometry::fromWkt( QStringLiteral( "Point(5 5)" ) );
+  QgsGeometry outside = QgsGeometry::fromWkt( QStringLiteral( "Point(15 5)" ) );
+
+  // repeated predicates reuse a prepared geometry
+  for ( int i = 0; i < 3; ++i )
+  {
+    QVERIFY( polygon.intersects( inside ) );
+    QVERIFY( !polygon.intersects( outside ) );
+    QVERIFY( polygon.contains( inside ) );
+    QVERIFY( polygon.disjoint( outside ) );
+    QVERIFY( inside.within( polygon ) );
+  }
+
+  // threads sharing the geometry evaluate predicates with their own prepared geometry
+  QVector<int> indices;
+  QVector<QgsGeometry> points;
+  for ( int i = 0; i < 2000; ++i )
+  {
+    indices << i;
+    points << QgsGeometry::fromPoint( QgsPoint( i % 20, i % 13 ) );
+  }
+  QVector<bool> intersections( points.count(), false );
+  bool *intersectionData = intersections.data();
+  QtConcurrent::blockingMap( indices, [&polygon, &points, intersectionData]( int i )
+  {
+    intersectionData[i] = polygon.intersects( points.at( i ) );
+  } );
+  for ( int i = 0; i < points.count(); ++i )
+    QCOMPARE( intersections.at( i ), i % 20 <= 10 && i % 13 <= 10 );
+
+  // copies share the prepared geometry, modifying one of them discards it
+  QgsGeometry copy( polygon );
+  QVERIFY( copy.intersects( inside ) );
+  copy.translate( 10, 0 );
+  QVERIFY( !copy.intersects( inside ) );
+  QVERIFY( copy.intersects( outside ) );
+  QVERIFY( polygon.intersects( inside ) );
+  QVERIFY( !polygon.intersects( outside ) );
+
+  // modification through the underlying geometry
+  polygon.geometry()->transform( QTransform::fromTranslate( 10, 0 ) );
+  QVERIFY( !polygon.intersects( inside ) );
+  QVERIFY( polygon.contains( outside ) );
+
+  // batched predicates, small lists and lists processed by several threads
+  QgsGeometry square = QgsGeometry::fromWkt( QStringLiteral( "Polygon((0 0, 100 0, 100 100, 0 100, 0 0))" ) );
+  Q_FOREACH ( int count, QList<int>() << 0 << 10 << 5000 )
+  {
+    QVector<QgsGeometry> geometries;
+    for ( int i = 0; i < count; ++i )
+    {
+      if ( i % 100 == 7 )
+        geometries << QgsGeometry();
+      else
+        geometries << QgsGeometry::fromPoint( QgsPoint( i % 150, ( i * 7 ) % 150 ) );
+    }
+
+    QVector<bool> intersects = square.intersects( geometries );
+    QVector<bool> contains = square.contains( geometries );
+    QVector<bool> within = square.within( geometries );
+    QCOMPARE( intersects.count(), count );
+    QCOMPARE( contains.count(), count );
+    QCOMPARE( within.count(), count );
+    for ( int i = 0; i < count; ++i )
+    {
+      QCOMPARE( intersects.at( i ), square.intersects( geometries.at( i ) ) );
+      QCOMPARE( contains.at( i ), square.contains( geometries.at( i ) ) );
+      QVERIFY( !within.at( i ) );
+    }
+  }
+  QCOMPARE( QgsGeometry().intersects( QVector<QgsGeometry>() << square ), QVector<bool>() << false );
+}
+
+void TestQgsGeometry::wkbView()
+{
+  QStringList wkts;
+  wkts << QStringLiteral( "Point (1 2)" )
+       << QStringLiteral( "PointZM (1 2 3 4)" )
+       << QStringLiteral( "LineString (0 0, 10 5, 3 -2)" )
+       << QStringLiteral( "LineStringZ (0 0 1, 10 5 2)" )
+       << QStringLiteral( "Polygon ((0 0, 10 0, 10 10, 0 10, 0 0),(2 2, 3 2, 3 3, 2 2))" )
+       << QStringLiteral( "MultiPoint ((1 2),(-3 4),(5 -6))" )
+       << QStringLiteral( "MultiLineStringM ((0 0 1, 1 1 2),(5 5 3, 6 7 4, 8 9 5))" )
+       << QStringLiteral( "MultiPolygon (((0 0, 1 0, 1 1, 0 0)),((10 10, 20 10, 20 20, 10 10),(12 11, 13 11, 13 12, 12 11)))" )
+       << QStringLiteral( "MultiPolygon EMPTY" );
+
+  Q_FOREACH ( const QString &wkt, wkts )
+  {
+    QgsGeometry expected = QgsGeometry::fromWkt( wkt );
+    const QByteArray wkb = expected.exportToWkb();
+
+    QgsWkbGeometryView view( wkb );
+    QVERIFY( view.isValid() );
+    QCOMPARE( view.wkbType(), expected.wkbType() );
+    QCOMPARE( view.partCount(), expected.geometry()->partCount() );
+    QCOMPARE( view.vertexCount(), expected.geometry()->nCoordinates() );
+    QCOMPARE( view.boundingBox(), expected.boundingBox() );
+
+    // vertices are numbered as for the parsed geometry
+    QgsVertexId viewId, expectedId;
+    QgsPointV2 viewVertex, expectedVertex;
+    while ( expected.geometry()->nextVertex( expectedId, expectedVertex ) )
+    {
+      QVERIFY( view.nextVertex( viewId, viewVertex ) );
+      QCOMPARE( viewId, expectedId );
+      QCOMPARE( viewVertex, expectedVertex );
+    }
+    QVERIFY( !view.nextVertex( viewId, viewVertex ) );
+
+    // geometries created from WKB are parsed on demand
+    QgsGeometry lazy;
+    lazy.fromWkb( wkb );
+    QVERIFY( lazy.wkbView().isValid() );
+    QVERIFY( !lazy.isNull() );
+    QCOMPARE( lazy.wkbType(), expected.wkbType() );
+    QCOMPARE( lazy.boundingBox(), expected.boundingBox() );
+    QVERIFY( lazy.wkbView().isValid() );
+    QCOMPARE( lazy.exportToWkt(), expected.exportToWkt() );
+    QVERIFY( !lazy.wkbView().isValid() );
+  }
+
+  // rings of each part
+  QgsWkbGeometryView polygons( QgsGeometry::fromWkt( QStringLiteral( "MultiPolygon (((0 0, 1 0, 1 1, 0 0)),((10 10, 20 10, 20 20, 10 10),(12 11, 13 11, 13 12, 12 11)))" ) ).exportToWkb() );
+  QCOMPARE( polygons.partRings( 0 ).count(), 1 );
+  QCOMPARE( polygons.partRings( 0 ).at( 0 ), QPolygonF() << QPointF( 0, 0 ) << QPointF( 1, 0 ) << QPointF( 1, 1 ) << QPointF( 0, 0 ) );
+  QCOMPARE( polygons.partRings( 1 ).count(), 2 );
+  QCOMPARE( polygons.partRings( 1 ).at( 1 ), QPolygonF() << QPointF( 12, 11 ) << QPointF( 13, 11 ) << QPointF( 13, 12 ) << QPointF( 12, 11 ) );
+  QVERIFY( polygons.partRings( 2 ).isEmpty() );
+  QgsWkbGeometryView line( QgsGeometry::fromWkt( QStringLiteral( "LineStringZ (0 0 1, 10 5 2)" ) ).exportToWkb() );
+  QCOMPARE( line.partRings( 0 ), QList< QPolygonF >() << ( QPolygonF() << QPointF( 0, 0 ) << QPointF( 10, 5 ) ) );
+
+  // unsupported or truncated WKB
+  QVERIFY( !QgsWkbGeometryView().isValid() );
+  QVERIFY( !QgsWkbGeometryView( QgsGeometry::fromWkt( QStringLiteral( "CircularString (0 0, 1 1, 2 0)" ) ).exportToWkb() ).isValid() );
+  QByteArray truncated = QgsGeometry::fromWkt( QStringLiteral( "LineString (0 0, 10 5, 3 -2)" ) ).exportToWkb();
+  truncated.chop( 4 );
+  QVERIFY( !QgsWkbGeometryView( truncated ).isValid() );
+  QgsGeometry curve;
+  curve.fromWkb( QgsGeometry::fromWkt( QStringLiteral( "CircularString (0 0, 1 1, 2 0)" ) ).exportToWkb() );
+  QVERIFY( !curve.wkbView().isValid() );
+  QCOMPARE( curve.wkbType(), QgsWkbTypes::CircularString );
+
+  // copies share the WKB until one of them is modified
+  QgsGeometry original;
+  original.fromWkb( QgsGeometry::fromWkt( QStringLiteral( "LineString (0 0, 10 5)" ) ).exportToWkb() );
+  QgsGeometry copy( original );
+  copy.translate( 1, 1 );
+  QVERIFY( original.wkbView().isValid() );
+  QVERIFY( !copy.wkbView().isValid() );
+  QCOMPARE( copy.exportToWkt(), QStringLiteral( "LineString (1 1, 11 6)" ) );
+  QCOMPARE( original.exportToWkt(), QStringLiteral( "LineString (0 0, 10 5)" ) );
+  original.setGeometry( nullptr );
+  QVERIFY( original.isNull() );
+}
+
 QGSTEST_MAIN( TestQgsGeometry )
 #include "testqgsgeometry.moc"
@@ -15,12 +15,15 @@
 
 #include "qgstest.h"
 
+#include <QThreadPool>
+
 #include <qgsapplication.h>
 #include <qgslabelingengine.h>
 #include <qgsproject.h>
 #include <qgsmaprenderersequentialjob.h>
 #include <qgsrulebasedlabeling.h>
 #include <qgsvectorlayer.h>
+#include <qgsvectordataprovider.h>
 #include <qgsvectorlayerdiagramprovider.h>
 #include <qgsvectorlayerlabeling.h>
 #include <qgsvectorlayerlabelprovider.h>
@@ -46,6 +49,8 @@ class TestQgsLabelingEngine : public QObject
     void testSubstitutions();
     void testCapitalization();
     void testParticipatingLayers();
+    void testParallelSolution_data();
+    void testParallelSolution(); //test that solving independent parts in parallel gives the same solution as solving them at once
 
   private:
     QgsVectorLayer *vl = nullptr;
@@ -54,6 +59,7 @@ class TestQgsLabelingEngine : public QObject
 
     void setDefaultLabelParams( QgsVectorLayer *layer );
     bool imageCheck( const QString &testName, QImage &image, int mismatchCount );
+    QStringList placedLabels( QgsVectorLayer *layer, QgsPalLabeling::Search searchMethod, bool solveInParallel );
 
 };
 
@@ -564,6 +570,89 @@ void TestQgsLabelingEngine::testParticipatingLayers()
   QCOMPARE( engine.participatingLayers().toSet(), QSet< QgsMapLayer * >() << vl << layer2 << layer3 );
 }
 
+void TestQgsLabelingEngine::testParallelSolution_data()
+{
+  QTest::addColumn<int>( "searchMethod" );
+
+  QTest::newRow( "chain" ) << static_cast< int >( QgsPalLabeling::Chain );
+  QTest::newRow( "falp" ) << static_cast< int >( QgsPalLabeling::Falp );
+}
+
+void TestQgsLabelingEngine::testParallelSolution()
+{
+  QFETCH( int, searchMethod );
+
+  // clusters of points with conflicting labels, spread over the map
+  QgsVectorLayer *layer = new QgsVectorLayer( QStringLiteral( "Point?crs=EPSG:3857&field=name:string" ), QStringLiteral( "dense" ), QStringLiteral( "memory" ) );
+  QgsFeatureList features;
+  quint32 seed = 1;
+  for ( int i = 0; i < 3000; ++i )
+  {
+    seed = seed * 1103515245 + 12345;
+    const double x = ( i % 60 ) * 1000 + ( seed >> 8 ) % 300;
+    seed = seed * 1103515245 + 12345;
+    const double y = ( i / 60 ) * 1000 + ( seed >> 8 ) % 300;
+    QgsFeature f( layer->fields() );
+    f.setAttribute( 0, QStringLiteral( "label %1" ).arg( i ) );
+    f.setGeometry( QgsGeometry::fromPoint( QgsPoint( x, y ) ) );
+    features << f;
+  }
+  layer->dataProvider()->addFeatures( features );
+  layer->setCustomProperty( QStringLiteral( "labeling" ), "pal" );
+  layer->setCustomProperty( QStringLiteral( "labeling/enabled" ), true );
+  layer->setCustomProperty( QStringLiteral( "labeling/fieldName" ), "name" );
+  setDefaultLabelParams( layer );
+
+  // the default placement is left to the sequential solver
+  QVERIFY( !QgsLabelingEngine().testFlag( QgsLabelingEngine::SolveInParallel ) );
+
+  // with a single thread the whole problem is solved at once, with more threads it is split
+  // into independent parts which must be solved exactly the same way
+  const int maxThreads = QThreadPool::globalInstance()->maxThreadCount();
+  QThreadPool::globalInstance()->setMaxThreadCount( 1 );
+  QStringList sequential = placedLabels( layer, static_cast< QgsPalLabeling::Search >( searchMethod ), true );
+  QThreadPool::globalInstance()->setMaxThreadCount( qMax( maxThreads, 4 ) );
+  QStringList parallel = placedLabels( layer, static_cast< QgsPalLabeling::Search >( searchMethod ), true );
+  QThreadPool::globalInstance()->setMaxThreadCount( maxThreads );
+
+  QVERIFY( !sequential.isEmpty() );
+  QVERIFY( sequential.count() < 3000 );
+  QCOMPARE( parallel, sequential );
+
+  delete layer;
+}
+
+QStringList TestQgsLabelingEngine::placedLabels( QgsVectorLayer *layer, QgsPalLabeling::Search searchMethod, bool solveInParallel )
+{
+  QgsMapSettings mapSettings;
+  mapSettings.setOutputSize( QSize( 1200, 1000 ) );
+  mapSettings.setExtent( layer->extent() );
+  mapSettings.setLayers( QList<QgsMapLayer *>() << layer );
+  mapSettings.setOutputDpi( 96 );
+
+  QImage img( mapSettings.outputSize(), QImage::Format_ARGB32_Premultiplied );
+  QPainter p( &img );
+  QgsRenderContext context = QgsRenderContext::fromMapSettings( mapSettings );
+  context.setPainter( &p );
+
+  QgsLabelingEngine engine;
+  engine.setMapSettings( mapSettings );
+  engine.setSearchMethod( searchMethod );
+  engine.setFlag( QgsLabelingEngine::SolveInParallel, solveInParallel );
+  engine.addProvider( new QgsVectorLayerLabelProvider( layer, QString() ) );
+  engine.run( context );
+  p.end();
+
+  std::unique_ptr< QgsLabelingResults > results( engine.takeResults() );
+  QStringList labels;
+  Q_FOREACH ( const QgsLabelPosition &position, results->labelsWithinRect( mapSettings.visibleExtent() ) )
+  {
+    labels << QStringLiteral( "%1 %2" ).arg( position.featureId ).arg( position.labelRect.toString() );
+  }
+  labels.sort();
+  return labels;
+}
+
 bool TestQgsLabelingEngine::imageCheck( const QString &testName, QImage &image, int mismatchCount )
 {
   //draw background
@@ -18,6 +18,7 @@
 #include <QStringList>
 #include <QPainter>
 #include <QTime>
+#include <QThread>
 #include <QApplication>
 #include <QDesktopServices>
 
@@ -32,6 +33,7 @@
 #include <qgsfield.h>
 #include <qgis.h> //defines GEOWkt
 #include "qgsmaprenderersequentialjob.h"
+#include "qgsmaprendererparalleljob.h"
 #include <qgsmaplayer.h>
 #include <qgsvectorlayer.h>
 #include <qgsapplication.h>
@@ -78,6 +80,9 @@ class TestQgsMapRendererJob : public QObject
     void testFourAdjacentTiles_data();
     void testFourAdjacentTiles();
 
+    //! Checks that rendering a layer split into tiles gives the same image
+    void tiledLayerRendering();
+
   private:
     QString mEncoding;
     QgsVectorFileWriter::WriterError mError;
@@ -331,6 +336,35 @@ void TestQgsMapRendererJob::testFourAdjacentTiles()
   QVERIFY( result );
 }
 
+void TestQgsMapRendererJob::tiledLayerRendering()
+{
+  QgsMapSettings mapSettings;
+  mapSettings.setLayers( QList<QgsMapLayer *>() << mpPolysLayer );
+  mapSettings.setExtent( QgsRectangle( -30, -20, 30, 20 ) );
+  mapSettings.setOutputSize( QSize( 600, 400 ) );
+  mapSettings.setFlag( QgsMapSettings::Antialiasing );
+
+  QgsMapRendererParallelJob job( mapSettings );
+  job.start();
+  job.waitForFinished();
+  QImage expected = job.renderedImage();
+
+  if ( QThread::idealThreadCount() < 2 )
+    QSKIP( "layers are only split into tiles with several threads" );
+
+  mapSettings.setFlag( QgsMapSettings::RenderTiledLayers );
+  QgsMapRendererParallelJob tiledJob( mapSettings );
+  // split the layer whatever its feature count
+  tiledJob.setTiledLayerMinimumFeatures( 1 );
+  tiledJob.start();
+  tiledJob.waitForFinished();
+  QImage tiled = tiledJob.renderedImage();
+
+  QVERIFY( tiledJob.tileCount() >= 2 );
+  QVERIFY( tiledJob.errors().isEmpty() );
+  QCOMPARE( tiled.size(), expected.size() );
+  QVERIFY( tiled == expected );
+}
 
 QGSTEST_MAIN( TestQgsMapRendererJob )
 #include "testqgsmaprendererjob.moc"
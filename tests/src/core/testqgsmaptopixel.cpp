@@ -15,6 +15,7 @@
 #include "qgstest.h"
 #include <QObject>
 #include <QString>
+#include <QVector>
 //header for class being tested
 #include <qgsrectangle.h>
 #include <qgsmaptopixel.h>
@@ -30,6 +31,7 @@ class TestQgsMapToPixel: public QObject
     void getters();
     void fromScale();
     void toMapPoint();
+    void transformPoints();
 };
 
 void TestQgsMapToPixel::rotation()
@@ -120,6 +122,39 @@ void TestQgsMapToPixel::toMapPoint()
   QCOMPARE( p, QgsPoint( 20, 20 ) );
 }
 
+void TestQgsMapToPixel::transformPoints()
+{
+  QList< QgsMapToPixel > transforms;
+  transforms << QgsMapToPixel( 0.5, 105, 42, 800, 600, 0 )
+             << QgsMapToPixel( 0.5, 105, 42, 800, 600, 30 )
+             << QgsMapToPixel( 2, 0, 0, 100, 100, -90 );
+
+  Q_FOREACH ( const QgsMapToPixel &m2p, transforms )
+  {
+    // all the counts, to cover the remainders of the vectorized loops
+    for ( int count = 0; count < 12; ++count )
+    {
+      QVector< QPointF > points;
+      for ( int i = 0; i < count; ++i )
+        points << QPointF( 100 + 3.7 * i, 40 - 1.3 * i * i );
+      if ( count == 11 )
+        points[5] = QPointF( 1e300, -1e300 );
+
+      QVector< QPointF > expected = points;
+      for ( int i = 0; i < count; ++i )
+        m2p.transformInPlace( expected[i].rx(), expected[i].ry() );
+
+      m2p.transformInPlace( points.data(), points.size() );
+      for ( int i = 0; i < count; ++i )
+      {
+        // identical, not only close
+        QVERIFY( points.at( i ).x() == expected.at( i ).x() );
+        QVERIFY( points.at( i ).y() == expected.at( i ).y() );
+      }
+    }
+  }
+}
+
 QGSTEST_MAIN( TestQgsMapToPixel )
 #include "testqgsmaptopixel.moc"
 
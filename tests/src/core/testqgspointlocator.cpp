@@ -15,6 +15,7 @@
 
 #include "qgstest.h"
 #include <QObject>
+#include <QSignalSpy>
 #include <QString>
 
 #include "qgsapplication.h"
@@ -304,6 +305,130 @@ class TestQgsPointLocator : public QObject
 
       delete vlEmptyGeom;
     }
+
+    void testCompactStorage()
+    {
+      // multipolygon with a hole in its first part, and a line layer
+      QgsVectorLayer *vl = new QgsVectorLayer( QStringLiteral( "MultiPolygon" ), QStringLiteral( "x" ), QStringLiteral( "memory" ) );
+      QgsFeature ff( 0 );
+      ff.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "MultiPolygon(((0 0, 10 0, 10 10, 0 10, 0 0),(4 4, 6 4, 6 6, 4 6, 4 4)),((20 0, 30 0, 30 10, 20 0)))" ) ) );
+      QgsFeatureList flist;
+      flist << ff;
+      vl->dataProvider()->addFeatures( flist );
+
+      QgsPointLocator loc( vl );
+      QgsPointLocator compactLoc( vl );
+      compactLoc.setCompactGeometryStorage( true );
+      QVERIFY( compactLoc.compactGeometryStorage() );
+
+      // same answers as with QgsGeometry copies
+      QList< QgsPoint > points;
+      points << QgsPoint( 4.5, 4.2 ) << QgsPoint( 2, 3 ) << QgsPoint( 29, 8 ) << QgsPoint( 25, 1 ) << QgsPoint( 15, 5 );
+      Q_FOREACH ( const QgsPoint &pt, points )
+      {
+        QCOMPARE( compactLoc.nearestVertex( pt, 999 ), loc.nearestVertex( pt, 999 ) );
+        QCOMPARE( compactLoc.nearestEdge( pt, 999 ), loc.nearestEdge( pt, 999 ) );
+        QCOMPARE( compactLoc.pointInPolygon( pt ), loc.pointInPolygon( pt ) );
+        QCOMPARE( compactLoc.edgesInRect( pt, 1 ), loc.edgesInRect( pt, 1 ) );
+      }
+      QCOMPARE( compactLoc.cachedGeometryCount(), 1 );
+
+      // vertex indices count all the rings of all the parts
+      QgsPointLocator::Match m = compactLoc.nearestVertex( QgsPoint( 29, 8 ), 999 );
+      QCOMPARE( m.point(), QgsPoint( 30, 10 ) );
+      QCOMPARE( m.vertexIndex(), 12 );
+      QCOMPARE( compactLoc.pointInPolygon( QgsPoint( 5, 5 ) ).count(), 0 ); // in the hole
+      QCOMPARE( compactLoc.pointInPolygon( QgsPoint( 3, 5 ) ).count(), 1 );
+
+      // changing the storage drops the index
+      compactLoc.setCompactGeometryStorage( false );
+      QVERIFY( !compactLoc.hasIndex() );
+
+      delete vl;
+    }
+
+    void testBackgroundIndexing()
+    {
+      QgsPointLocator loc( mVL );
+      QVERIFY( loc.init( -1, true ) );
+      QVERIFY( loc.isIndexing() );
+      QVERIFY( !loc.hasIndex() );
+
+      // nothing is found until the index is ready
+      QVERIFY( !loc.nearestVertex( QgsPoint( 2, 2 ), 999 ).isValid() );
+      QVERIFY( loc.isIndexing() );
+
+      QSignalSpy spy( &loc, &QgsPointLocator::initFinished );
+      loc.waitForIndexingFinished();
+      QCOMPARE( spy.count(), 1 );
+      QVERIFY( spy.at( 0 ).at( 0 ).toBool() );
+      QVERIFY( !loc.isIndexing() );
+      QVERIFY( loc.hasIndex() );
+      QCOMPARE( loc.nearestVertex( QgsPoint( 2, 2 ), 999 ).point(), QgsPoint( 1, 1 ) );
+
+      // when the data change, the current index answers queries until the new one is ready
+      emit mVL->dataChanged();
+      QVERIFY( loc.isIndexing() );
+      QVERIFY( loc.hasIndex() );
+      QCOMPARE( loc.nearestVertex( QgsPoint( 2, 2 ), 999 ).point(), QgsPoint( 1, 1 ) );
+      loc.waitForIndexingFinished();
+      QCOMPARE( spy.count(), 2 );
+      QCOMPARE( loc.nearestVertex( QgsPoint( 2, 2 ), 999 ).point(), QgsPoint( 1, 1 ) );
+    }
+
+    void testDataChangedWhileIndexing()
+    {
+      QgsPointLocator loc( mVL );
+      QSignalSpy spy( &loc, &QgsPointLocator::initFinished );
+      QVERIFY( loc.init( -1, true ) );
+
+      // the first index is not ready yet, the task is restarted rather than canceled
+      emit mVL->dataChanged();
+      QVERIFY( loc.isIndexing() );
+      QCOMPARE( spy.count(), 0 );
+
+      loc.waitForIndexingFinished();
+      QCOMPARE( spy.count(), 1 );
+      QVERIFY( spy.at( 0 ).at( 0 ).toBool() );
+      QVERIFY( loc.hasIndex() );
+      QCOMPARE( loc.nearestVertex( QgsPoint( 2, 2 ), 999 ).point(), QgsPoint( 1, 1 ) );
+    }
+
+    void testEditsWhileIndexing()
+    {
+      QgsPointLocator loc( mVL );
+      loc.init( -1, true );
+      QVERIFY( loc.isIndexing() );
+
+      // the feature is added after the task took its snapshot of the layer
+      mVL->startEditing();
+      QgsFeature ff( 0 );
+      ff.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "Polygon((10 11, 11 10, 11 11, 10 11))" ) ) );
+      QVERIFY( mVL->addFeature( ff ) );
+
+      loc.waitForIndexingFinished();
+      QCOMPARE( loc.cachedGeometryCount(), 2 );
+      QCOMPARE( loc.nearestVertex( QgsPoint( 12, 12 ), 999 ).point(), QgsPoint( 11, 11 ) );
+
+      // and later edits update the index without rebuilding it
+      QVERIFY( mVL->deleteFeature( ff.id() ) );
+      QVERIFY( !loc.isIndexing() );
+      QCOMPARE( loc.cachedGeometryCount(), 1 );
+      QCOMPARE( loc.nearestVertex( QgsPoint( 12, 12 ), 999 ).point(), QgsPoint( 1, 1 ) );
+
+      mVL->rollBack();
+    }
+
+    void testMaxFeaturesInBackground()
+    {
+      QgsPointLocator loc( mVL );
+      QSignalSpy spy( &loc, &QgsPointLocator::initFinished );
+      loc.init( 0, true );
+      loc.waitForIndexingFinished();
+      QCOMPARE( spy.count(), 1 );
+      QVERIFY( !spy.at( 0 ).at( 0 ).toBool() );
+      QVERIFY( !loc.hasIndex() );
+    }
 };
 
 QGSTEST_MAIN( TestQgsPointLocator )
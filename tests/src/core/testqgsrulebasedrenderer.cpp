@@ -117,6 +117,42 @@ class TestQgsRuleBasedRenderer: public QObject
       delete layer;
     }
 
+    void test_sharedFilterSubexpressions()
+    {
+      QgsVectorLayer *layer = new QgsVectorLayer( QStringLiteral( "point?field=fld:int" ), QStringLiteral( "x" ), QStringLiteral( "memory" ) );
+
+      // the rules share "fld * 2" and "fld * 2 > 5", which are only evaluated once per feature
+      RRule *rootRule = new RRule( nullptr );
+      rootRule->appendChild( new RRule( QgsSymbol::defaultSymbol( QgsWkbTypes::PointGeometry ), 0, 0, QStringLiteral( "fld * 2 > 5" ) ) );
+      rootRule->appendChild( new RRule( QgsSymbol::defaultSymbol( QgsWkbTypes::PointGeometry ), 0, 0, QStringLiteral( "fld * 2 > 5 AND fld < 10" ) ) );
+      rootRule->appendChild( new RRule( QgsSymbol::defaultSymbol( QgsWkbTypes::PointGeometry ), 0, 0, QStringLiteral( "CASE WHEN fld < 3 THEN fld * 2 ELSE 0 END" ) ) );
+      QgsRuleBasedRenderer r( rootRule );
+
+      QgsRenderContext ctx; // dummy render context
+      ctx.expressionContext().setFields( layer->fields() );
+      r.startRender( ctx, layer->fields() );
+
+      for ( int i = 0; i < 12; ++i )
+      {
+        QgsFeature f( layer->fields(), i );
+        f.setAttribute( 0, i );
+        ctx.expressionContext().setFeature( f );
+
+        int expected = ( i * 2 > 5 ? 1 : 0 ) + ( i * 2 > 5 && i < 10 ? 1 : 0 ) + ( i < 3 && i > 0 ? 1 : 0 );
+        QCOMPARE( r.symbolsForFeature( f, ctx ).count(), expected );
+      }
+
+      r.stopRender( ctx );
+
+      // filters still work once rendering is finished
+      QgsFeature f( layer->fields(), 1 );
+      f.setAttribute( 0, 4 );
+      ctx.expressionContext().setFeature( f );
+      QCOMPARE( r.symbolsForFeature( f, ctx ).count(), 2 );
+
+      delete layer;
+    }
+
     void test_clone_ruleKey()
     {
       RRule *rootRule = new RRule( 0 );
@@ -16,6 +16,10 @@
 #include "qgstest.h"
 #include <QObject>
 #include <QString>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QTemporaryDir>
 
 #include <qgsapplication.h>
 #include "qgsfeatureiterator.h"
@@ -119,6 +123,199 @@ class TestQgsSpatialIndex : public QObject
       QVERIFY( fids[0] == 1 );
     }
 
+    void testPackedBackend()
+    {
+      QgsVectorLayer vl( QStringLiteral( "Polygon" ), QStringLiteral( "x" ), QStringLiteral( "memory" ) );
+      QgsFeatureList flist;
+      quint32 seed = 1;
+      for ( int i = 0; i < 5000; ++i )
+      {
+        seed = seed * 1103515245 + 12345;
+        const double x = ( seed >> 16 ) % 1000;
+        seed = seed * 1103515245 + 12345;
+        const double y = ( seed >> 16 ) % 1000;
+        QgsFeature f( i + 1 );
+        f.setGeometry( QgsGeometry::fromRect( QgsRectangle( x, y, x + i % 7, y + i % 5 ) ) );
+        flist << f;
+      }
+      vl.dataProvider()->addFeatures( flist );
+
+      QgsSpatialIndex packed( vl.getFeatures(), QgsSpatialIndex::PackedRTree );
+      QgsSpatialIndex dynamic( vl.getFeatures() );
+
+      for ( int i = 0; i < 100; ++i )
+      {
+        QgsRectangle rect( i * 10, ( i * 37 ) % 1000, i * 10 + i % 20, ( i * 37 ) % 1000 + 15 );
+        QList<QgsFeatureId> resPacked = packed.intersects( rect );
+        QList<QgsFeatureId> resDynamic = dynamic.intersects( rect );
+        std::sort( resPacked.begin(), resPacked.end() );
+        std::sort( resDynamic.begin(), resDynamic.end() );
+        QCOMPARE( resPacked, resDynamic );
+      }
+      QCOMPARE( packed.intersects( QgsRectangle( -1, -1, 2000, 2000 ) ).count(), 5000 );
+
+      // nearest neighbors are at the same distances, ties may be returned in another order
+      Q_FOREACH ( const QgsFeature &f, flist.mid( 0, 50 ) )
+      {
+        QgsPoint point = f.geometry().boundingBox().center();
+        QList<QgsFeatureId> resPacked = packed.nearestNeighbor( point, 1 );
+        QVERIFY( !resPacked.isEmpty() );
+        QVERIFY( flist.at( resPacked.at( 0 ) - 1 ).geometry().boundingBox().contains( point ) );
+      }
+
+      // modifying the packed index converts it to a dynamic one
+      QVERIFY( packed.deleteFeature( flist.at( 0 ) ) );
+      QVERIFY( packed.insertFeature( _pointFeature( 6000, 5000, 5000 ) ) );
+      QCOMPARE( packed.intersects( QgsRectangle( -1, -1, 6000, 6000 ) ).count(), 5000 );
+      QVERIFY( !packed.intersects( QgsRectangle( -1, -1, 6000, 6000 ) ).contains( 1 ) );
+      QCOMPARE( packed.nearestNeighbor( QgsPoint( 4990, 4990 ), 1 ), QList<QgsFeatureId>() << 6000 );
+
+      // empty packed index
+      QgsVectorLayer empty( QStringLiteral( "Point" ), QStringLiteral( "x" ), QStringLiteral( "memory" ) );
+      QgsSpatialIndex emptyIndex( empty.getFeatures(), QgsSpatialIndex::PackedRTree );
+      QVERIFY( emptyIndex.intersects( QgsRectangle( -1, -1, 1, 1 ) ).isEmpty() );
+      QVERIFY( emptyIndex.nearestNeighbor( QgsPoint( 0, 0 ), 3 ).isEmpty() );
+    }
+
+    void testBatchIntersects()
+    {
+      // enough features for the packed tree to be built by several threads
+      QgsVectorLayer vl( QStringLiteral( "Point" ), QStringLiteral( "x" ), QStringLiteral( "memory" ) );
+      QgsFeatureList flist;
+      for ( int i = 0; i < 150000; ++i )
+        flist << _pointFeature( i + 1, ( i * 7919 ) % 1000 + 0.5, ( i * 104729 ) % 1000 + 0.25 );
+      vl.dataProvider()->addFeatures( flist );
+
+      QgsSpatialIndex packed( vl.getFeatures(), QgsSpatialIndex::PackedRTree );
+      QgsSpatialIndex dynamic( vl.getFeatures() );
+
+      QVector<QgsRectangle> rects;
+      for ( int i = 0; i < 2000; ++i )
+        rects << QgsRectangle( i % 100 * 10, i / 20 * 10, i % 100 * 10 + 5, i / 20 * 10 + 5 );
+
+      QVector< QList<QgsFeatureId> > resPacked = packed.intersects( rects );
+      QVector< QList<QgsFeatureId> > resDynamic = dynamic.intersects( rects );
+      QCOMPARE( resPacked.count(), rects.count() );
+      QCOMPARE( resDynamic.count(), rects.count() );
+      int found = 0;
+      for ( int i = 0; i < rects.count(); ++i )
+      {
+        QList<QgsFeatureId> single = dynamic.intersects( rects.at( i ) );
+        std::sort( single.begin(), single.end() );
+        std::sort( resPacked[i].begin(), resPacked[i].end() );
+        std::sort( resDynamic[i].begin(), resDynamic[i].end() );
+        QCOMPARE( resPacked.at( i ), single );
+        QCOMPARE( resDynamic.at( i ), single );
+        found += single.count();
+      }
+      QVERIFY( found > 0 );
+      QCOMPARE( packed.intersects( QgsRectangle( 0, 0, 1000, 1000 ) ).count(), 150000 );
+      QVERIFY( packed.intersects( QVector<QgsRectangle>() ).isEmpty() );
+    }
+
+    void testIndexFile()
+    {
+      QgsVectorLayer vl( QStringLiteral( "Point" ), QStringLiteral( "x" ), QStringLiteral( "memory" ) );
+      QgsFeatureList flist;
+      for ( int i = 0; i < 1000; ++i )
+        flist << _pointFeature( i + 1, i % 37, i / 37 );
+      flist << QgsFeature( 5000 ); // without geometry, not indexed
+      vl.dataProvider()->addFeatures( flist );
+
+      QTemporaryDir dir;
+      QString fileName = dir.path() + "/points.qgsidx";
+      QVERIFY( QgsSpatialIndex::writeIndexFile( fileName, vl.getFeatures() ) );
+
+      bool ok = false;
+      QgsSpatialIndex fileIndex = QgsSpatialIndex::fromIndexFile( fileName, &ok );
+      QVERIFY( ok );
+      QgsSpatialIndex memoryIndex( vl.getFeatures() );
+
+      // the file index gives the same results as an index built in memory
+      QList<QgsRectangle> rects;
+      rects << QgsRectangle( 0, 0, 10, 10 ) << QgsRectangle( 3.5, 3.5, 3.6, 3.6 ) << QgsRectangle( -100, -100, 100, 100 ) << QgsRectangle( 10, 5, 20, 5 );
+      Q_FOREACH ( const QgsRectangle &rect, rects )
+      {
+        QList<QgsFeatureId> resFile = fileIndex.intersects( rect );
+        QList<QgsFeatureId> resMemory = memoryIndex.intersects( rect );
+        std::sort( resFile.begin(), resFile.end() );
+        std::sort( resMemory.begin(), resMemory.end() );
+        QCOMPARE( resFile, resMemory );
+      }
+      QCOMPARE( fileIndex.intersects( QgsRectangle( -100, -100, 100, 100 ) ).count(), 1000 );
+      QCOMPARE( fileIndex.nearestNeighbor( QgsPoint( 5.2, 3.1 ), 1 ), QList<QgsFeatureId>() << 3 * 37 + 5 + 1 );
+      QCOMPARE( fileIndex.nearestNeighbor( QgsPoint( 100, 0 ), 3 ).count(), 3 );
+
+      // copies share the mapped file until modified
+      QgsSpatialIndex copy( fileIndex );
+      QVERIFY( copy.insertFeature( _pointFeature( 2000, 50.5, 50.5 ) ) );
+      QVERIFY( copy.deleteFeature( flist.at( 0 ) ) );
+      QCOMPARE( copy.intersects( QgsRectangle( 50, 50, 51, 51 ) ), QList<QgsFeatureId>() << 2000 );
+      QVERIFY( copy.intersects( QgsRectangle( -0.1, -0.1, 0.1, 0.1 ) ).isEmpty() );
+      QCOMPARE( fileIndex.intersects( QgsRectangle( -0.1, -0.1, 0.1, 0.1 ) ), QList<QgsFeatureId>() << 1 );
+      QCOMPARE( copy.intersects( QgsRectangle( -100, -100, 100, 100 ) ).count(), 1000 );
+
+      // invalid files
+      QgsSpatialIndex::fromIndexFile( dir.path() + "/missing.qgsidx", &ok );
+      QVERIFY( !ok );
+      QFile garbage( dir.path() + "/garbage.qgsidx" );
+      QVERIFY( garbage.open( QIODevice::WriteOnly ) );
+      garbage.write( QByteArray( 100, 'x' ) );
+      garbage.close();
+      QgsSpatialIndex invalid = QgsSpatialIndex::fromIndexFile( garbage.fileName(), &ok );
+      QVERIFY( !ok );
+      QVERIFY( invalid.intersects( QgsRectangle( -100, -100, 100, 100 ) ).isEmpty() );
+
+      // empty index
+      QgsVectorLayer empty( QStringLiteral( "Point" ), QStringLiteral( "x" ), QStringLiteral( "memory" ) );
+      QVERIFY( QgsSpatialIndex::writeIndexFile( dir.path() + "/empty.qgsidx", empty.getFeatures() ) );
+      QgsSpatialIndex emptyIndex = QgsSpatialIndex::fromIndexFile( dir.path() + "/empty.qgsidx", &ok );
+      QVERIFY( ok );
+      QVERIFY( emptyIndex.intersects( QgsRectangle( -100, -100, 100, 100 ) ).isEmpty() );
+      QVERIFY( emptyIndex.insertFeature( _pointFeature( 1, 0, 0 ) ) );
+      QCOMPARE( emptyIndex.intersects( QgsRectangle( -1, -1, 1, 1 ) ), QList<QgsFeatureId>() << 1 );
+    }
+
+    void testCachedIndex()
+    {
+      QTemporaryDir dir;
+      Q_FOREACH ( const QString &ext, QStringList() << "shp" << "shx" << "dbf" << "prj" )
+        QVERIFY( QFile::copy( QStringLiteral( TEST_DATA_DIR ) + "/points." + ext, dir.path() + "/points." + ext ) );
+
+      QgsVectorLayer vl( dir.path() + "/points.shp", QStringLiteral( "points" ), QStringLiteral( "ogr" ) );
+      QVERIFY( vl.isValid() );
+      QgsSpatialIndex memoryIndex( vl.getFeatures() );
+      QgsRectangle extent = vl.extent();
+
+      QString cacheDir = dir.path() + "/cache";
+      QVERIFY( QDir().mkpath( cacheDir ) );
+      QString fileName = QgsSpatialIndex::indexFileName( vl.source() + '|' + vl.subsetString(), cacheDir );
+      QVERIFY( fileName.startsWith( cacheDir ) );
+      QVERIFY( !QFile::exists( fileName ) );
+
+      QgsSpatialIndex index = QgsSpatialIndex::cachedIndex( &vl, cacheDir );
+      QVERIFY( QFile::exists( fileName ) );
+      QCOMPARE( index.intersects( extent ).count(), memoryIndex.intersects( extent ).count() );
+
+      // the file is reused
+      QDateTime written = QFileInfo( fileName ).lastModified();
+      QgsSpatialIndex index2 = QgsSpatialIndex::cachedIndex( &vl, cacheDir );
+      QCOMPARE( QFileInfo( fileName ).lastModified(), written );
+      QCOMPARE( index2.intersects( extent ).count(), memoryIndex.intersects( extent ).count() );
+
+      // another subset gets another file
+      vl.setSubsetString( QStringLiteral( "\"Class\" = 'Jet'" ) );
+      QVERIFY( QgsSpatialIndex::indexFileName( vl.source() + '|' + vl.subsetString(), cacheDir ) != fileName );
+      QgsSpatialIndex subsetIndex = QgsSpatialIndex::cachedIndex( &vl, cacheDir );
+      QVERIFY( subsetIndex.intersects( extent ).count() < index.intersects( extent ).count() );
+
+      // sources which are not files
+      QVERIFY( QgsSpatialIndex::indexFileName( QStringLiteral( "Point" ) ).isEmpty() );
+      QgsVectorLayer memoryLayer( QStringLiteral( "Point" ), QStringLiteral( "x" ), QStringLiteral( "memory" ) );
+      memoryLayer.dataProvider()->addFeatures( QgsFeatureList() << _pointFeature( 1, 0, 0 ) );
+      QCOMPARE( QgsSpatialIndex::cachedIndex( &memoryLayer ).intersects( QgsRectangle( -1, -1, 1, 1 ) ), QList<QgsFeatureId>() << 1 );
+    }
+
     void benchmarkIntersect()
     {
       // add 50K features to the index
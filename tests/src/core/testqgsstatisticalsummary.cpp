@@ -17,6 +17,7 @@
 #include <QString>
 #include <QStringList>
 #include <QSettings>
+#include <algorithm>
 
 #include "qgsstatisticalsummary.h"
 #include "qgis.h"
@@ -36,6 +37,11 @@ class TestQgsStatisticSummary: public QObject
     void maxMin();
     void countMissing();
     void noValues();
+    void merge();
+    void approximate();
+    void approximateMerge();
+    void benchmark_data();
+    void benchmark();
 
   private:
 
@@ -339,5 +345,178 @@ void TestQgsStatisticSummary::noValues()
   QVERIFY( qIsNaN( s.statistic( QgsStatisticalSummary::InterQuartileRange ) ) );
 }
 
+void TestQgsStatisticSummary::merge()
+{
+  QList<double> values;
+  values << 4 << 2 << 3 << 2 << 5 << 8 << 9 << 4 << 5 << 8 << 12 << 12 << 12;
+  QgsStatisticalSummary expected( QgsStatisticalSummary::All );
+  expected.calculate( values );
+
+  // split values into uneven parts, including an empty one
+  QgsStatisticalSummary s( QgsStatisticalSummary::All );
+  QgsStatisticalSummary part1( QgsStatisticalSummary::All );
+  QgsStatisticalSummary part2( QgsStatisticalSummary::All );
+  QgsStatisticalSummary empty( QgsStatisticalSummary::All );
+  for ( int i = 0; i < values.count(); ++i )
+  {
+    if ( i < 4 )
+      s.addValue( values.at( i ) );
+    else if ( i < 5 )
+      part1.addValue( values.at( i ) );
+    else
+      part2.addValue( values.at( i ) );
+  }
+  part1.addVariant( QVariant() );
+  empty.addVariant( QVariant() );
+  empty.finalize();
+  s.merge( part1 );
+  s.merge( empty );
+  s.merge( part2 );
+  s.finalize();
+
+  QCOMPARE( s.count(), expected.count() );
+  QCOMPARE( s.countMissing(), 2 );
+  QCOMPARE( s.sum(), expected.sum() );
+  QCOMPARE( s.mean(), expected.mean() );
+  QVERIFY( qgsDoubleNear( s.stDev(), expected.stDev(), 0.000001 ) );
+  QVERIFY( qgsDoubleNear( s.sampleStDev(), expected.sampleStDev(), 0.000001 ) );
+  QCOMPARE( s.min(), expected.min() );
+  QCOMPARE( s.max(), expected.max() );
+  QCOMPARE( s.median(), expected.median() );
+  QCOMPARE( s.firstQuartile(), expected.firstQuartile() );
+  QCOMPARE( s.thirdQuartile(), expected.thirdQuartile() );
+  QCOMPARE( s.variety(), expected.variety() );
+  QCOMPARE( s.minority(), expected.minority() );
+  QCOMPARE( s.majority(), expected.majority() );
+
+  // merging into an empty summary
+  QgsStatisticalSummary s2( QgsStatisticalSummary::All );
+  s2.finalize();
+  s2.merge( expected );
+  s2.finalize();
+  QCOMPARE( s2.count(), expected.count() );
+  QCOMPARE( s2.min(), expected.min() );
+  QCOMPARE( s2.max(), expected.max() );
+  QVERIFY( qgsDoubleNear( s2.stDev(), expected.stDev(), 0.000001 ) );
+}
+
+static QList<double> randomValues( int count, int distinct )
+{
+  QList<double> values;
+  values.reserve( count );
+  quint32 seed = 1;
+  for ( int i = 0; i < count; ++i )
+  {
+    seed = seed * 1103515245 + 12345;
+    values << ( seed >> 8 ) % distinct * 0.5;
+  }
+  return values;
+}
+
+//! Returns the rank of value in sorted values, as a fraction of the count
+static double rankOf( const QList<double> &sortedValues, double value )
+{
+  QList<double>::const_iterator it = std::lower_bound( sortedValues.constBegin(), sortedValues.constEnd(), value );
+  QList<double>::const_iterator upper = std::upper_bound( sortedValues.constBegin(), sortedValues.constEnd(), value );
+  // middle of the range of equal values
+  return ( ( it - sortedValues.constBegin() ) + ( upper - sortedValues.constBegin() ) ) / 2.0 / sortedValues.count();
+}
+
+void TestQgsStatisticSummary::approximate()
+{
+  QList<double> values = randomValues( 200000, 50000 );
+  // add a clear majority
+  for ( int i = 0; i < 2000; ++i )
+    values << 7.0;
+
+  QgsStatisticalSummary exact( QgsStatisticalSummary::All );
+  exact.calculate( values );
+  QgsStatisticalSummary s( QgsStatisticalSummary::All );
+  QVERIFY( !s.approximate() );
+  s.setApproximate( true );
+  QVERIFY( s.approximate() );
+  s.calculate( values );
+
+  // exact statistics
+  QCOMPARE( s.count(), exact.count() );
+  QCOMPARE( s.sum(), exact.sum() );
+  QCOMPARE( s.min(), exact.min() );
+  QCOMPARE( s.max(), exact.max() );
+  QCOMPARE( s.mean(), exact.mean() );
+  QVERIFY( qgsDoubleNear( s.stDev(), exact.stDev(), 0.000001 ) );
+
+  // approximations
+  QList<double> sorted = values;
+  std::sort( sorted.begin(), sorted.end() );
+  QVERIFY( qAbs( rankOf( sorted, s.median() ) - 0.5 ) < 0.02 );
+  QVERIFY( qAbs( rankOf( sorted, s.firstQuartile() ) - 0.25 ) < 0.02 );
+  QVERIFY( qAbs( rankOf( sorted, s.thirdQuartile() ) - 0.75 ) < 0.02 );
+  QVERIFY( qAbs( s.variety() - exact.variety() ) < exact.variety() * 0.03 );
+  QCOMPARE( s.majority(), 7.0 );
+  QVERIFY( qIsNaN( s.minority() ) );
+
+  // small counts are exact
+  s.calculate( QList<double>() << 4 << 2 << 3 << 2 << 5 << 8 );
+  QCOMPARE( s.variety(), 5 );
+  QCOMPARE( s.majority(), 2.0 );
+  QCOMPARE( s.min(), 2.0 );
+
+  // no values
+  s.reset();
+  s.finalize();
+  QCOMPARE( s.variety(), 0 );
+  QVERIFY( qIsNaN( s.median() ) );
+}
+
+void TestQgsStatisticSummary::approximateMerge()
+{
+  QList<double> values = randomValues( 100000, 20000 );
+  QList<double> sorted = values;
+  std::sort( sorted.begin(), sorted.end() );
+
+  QgsStatisticalSummary exact( QgsStatisticalSummary::All );
+  exact.calculate( values );
+
+  QgsStatisticalSummary s( QgsStatisticalSummary::All );
+  s.setApproximate( true );
+  QgsStatisticalSummary part( QgsStatisticalSummary::All );
+  part.setApproximate( true );
+  for ( int i = 0; i < values.count(); ++i )
+  {
+    if ( i % 3 )
+      s.addValue( values.at( i ) );
+    else
+      part.addValue( values.at( i ) );
+  }
+  s.merge( part );
+  s.finalize();
+
+  QCOMPARE( s.count(), exact.count() );
+  QVERIFY( qAbs( rankOf( sorted, s.median() ) - 0.5 ) < 0.02 );
+  QVERIFY( qAbs( s.variety() - exact.variety() ) < exact.variety() * 0.03 );
+}
+
+void TestQgsStatisticSummary::benchmark_data()
+{
+  QTest::addColumn<bool>( "approximate" );
+
+  QTest::newRow( "exact" ) << false;
+  QTest::newRow( "approximate" ) << true;
+}
+
+void TestQgsStatisticSummary::benchmark()
+{
+  QFETCH( bool, approximate );
+
+  QList<double> values = randomValues( 1000000, 100000 );
+  QgsStatisticalSummary s( QgsStatisticalSummary::All );
+  s.setApproximate( approximate );
+
+  QBENCHMARK
+  {
+    s.calculate( values );
+  }
+}
+
 QGSTEST_MAIN( TestQgsStatisticSummary )
 #include "testqgsstatisticalsummary.moc"
@@ -17,6 +17,9 @@
 #include <QStringList>
 #include <QApplication>
 #include <QFileInfo>
+#include <QPainter>
+
+#include <memory>
 
 //qgis includes...
 #include "qgsmultirenderchecker.h"
@@ -30,6 +33,9 @@
 #include "qgslinesymbollayer.h"
 #include "qgsfillsymbollayer.h"
 #include "qgssinglesymbolrenderer.h"
+#include "qgsrendercontext.h"
+#include "qgsvectorsimplifymethod.h"
+#include "qgswkbgeometryview.h"
 
 #include "qgsstyle.h"
 
@@ -68,6 +74,12 @@ class TestQgsSymbol : public QObject
     void testParseColor();
     void testParseColorList();
     void symbolProperties();
+    void renderWkbView_data();
+    void renderWkbView();
+
+  private:
+    //! Renders \a geometry with \a symbol on a 300 x 300 pixels image
+    static QImage renderGeometry( QgsSymbol *symbol, const QgsGeometry &geometry );
 };
 
 TestQgsSymbol::TestQgsSymbol()
@@ -455,5 +467,61 @@ void TestQgsSymbol::symbolProperties()
   delete fillSymbol2;
 }
 
+void TestQgsSymbol::renderWkbView_data()
+{
+  QTest::addColumn<QString>( "wkt" );
+
+  QTest::newRow( "point" ) << "Point (10 10)";
+  QTest::newRow( "multipoint" ) << "MultiPoint ((2 3),(15 12))";
+  QTest::newRow( "line" ) << "LineStringZ (-10 0 1, 10 5 2, 12 30 3)";
+  QTest::newRow( "polygon" ) << "Polygon ((0 0, 20 0, 20 20, 0 20, 0 0),(5 5, 10 5, 10 10, 5 5))";
+  QTest::newRow( "multipolygon" ) << "MultiPolygon (((0 0, 5 0, 5 5, 0 0)),((-10 10, 30 10, 30 30, -10 10)))";
+}
+
+void TestQgsSymbol::renderWkbView()
+{
+  QFETCH( QString, wkt );
+
+  const QgsGeometry expected = QgsGeometry::fromWkt( wkt );
+  QgsGeometry lazy;
+  lazy.fromWkb( expected.exportToWkb() );
+  QVERIFY( lazy.wkbView().isValid() );
+  QVERIFY( QgsVectorSimplifyMethod().forceLocalOptimization() );
+
+  std::unique_ptr< QgsSymbol > symbol( QgsSymbol::defaultSymbol( expected.type() ) );
+  const QImage image = renderGeometry( symbol.get(), lazy );
+
+  // the geometry was rendered from its WKB, without being parsed
+  QVERIFY( lazy.wkbView().isValid() );
+  QCOMPARE( image, renderGeometry( symbol.get(), expected ) );
+}
+
+QImage TestQgsSymbol::renderGeometry( QgsSymbol *symbol, const QgsGeometry &geometry )
+{
+  QgsMapSettings ms;
+  ms.setExtent( QgsRectangle( -5, -5, 25, 25 ) );
+  ms.setOutputSize( QSize( 300, 300 ) );
+  ms.setOutputDpi( 96 );
+
+  QImage image( ms.outputSize(), QImage::Format_ARGB32_Premultiplied );
+  image.fill( 0 );
+  QPainter painter( &image );
+  QgsRenderContext context = QgsRenderContext::fromMapSettings( ms );
+  context.setPainter( &painter );
+
+  // like a layer without simplification, local optimization is left enabled
+  QgsVectorSimplifyMethod simplifyMethod;
+  simplifyMethod.setSimplifyHints( QgsVectorSimplifyMethod::NoSimplification );
+  context.setVectorSimplifyMethod( simplifyMethod );
+
+  QgsFeature feature;
+  feature.setGeometry( geometry );
+  symbol->startRender( context );
+  symbol->renderFeature( feature, context );
+  symbol->stopRender( context );
+  painter.end();
+  return image;
+}
+
 QGSTEST_MAIN( TestQgsSymbol )
 #include "testqgssymbol.moc"
@@ -53,9 +53,13 @@ class TestQgsAggregateCalculator(unittest.TestCase):
         params = QgsAggregateCalculator.AggregateParameters()
         params.filter = 'string filter'
         params.delimiter = 'delim'
+        params.parallel = True
         a.setParameters(params)
         self.assertEqual(a.filter(), 'string filter')
         self.assertEqual(a.delimiter(), 'delim')
+        self.assertTrue(a.parallel())
+        a.setParallel(False)
+        self.assertFalse(a.parallel())
 
     def testGeometry(self):
         """ Test calculation of aggregates on geometry expressions """
@@ -308,6 +312,63 @@ class TestQgsAggregateCalculator(unittest.TestCase):
         self.assertTrue(ok)
         self.assertEqual(val, 24)
 
+    def testParallel(self):
+        """ test that aggregates calculated in parallel match sequential results """
+
+        layer = QgsVectorLayer("Point?field=fldint:integer&field=flddbl:double&field=fldstring:string&field=flddatetime:datetime",
+                               "layer", "memory")
+        pr = layer.dataProvider()
+
+        features = []
+        for i in range(25000):
+            f = QgsFeature()
+            f.setFields(layer.fields())
+            f.setAttributes([i % 997 if i % 101 else None,
+                             (i * 7 % 1013) / 3.0,
+                             'string{}'.format(i % 503) if i % 7 else '',
+                             QDateTime(QDate(2000 + i % 17, 1 + i % 12, 1 + i % 28), QTime(i % 24, 0, 0))])
+            features.append(f)
+        self.assertTrue(pr.addFeatures(features))
+
+        tests = [[QgsAggregateCalculator.Count, 'fldint'],
+                 [QgsAggregateCalculator.CountMissing, 'fldint'],
+                 [QgsAggregateCalculator.Sum, 'fldint'],
+                 [QgsAggregateCalculator.Mean, 'flddbl'],
+                 [QgsAggregateCalculator.StDev, 'flddbl'],
+                 [QgsAggregateCalculator.StDevSample, 'fldint'],
+                 [QgsAggregateCalculator.Min, 'flddbl'],
+                 [QgsAggregateCalculator.Max, 'fldint'],
+                 [QgsAggregateCalculator.Median, 'flddbl'],
+                 [QgsAggregateCalculator.FirstQuartile, 'fldint'],
+                 [QgsAggregateCalculator.Majority, 'fldint'],
+                 [QgsAggregateCalculator.CountDistinct, 'flddbl'],
+                 [QgsAggregateCalculator.Sum, 'fldint * 2 + flddbl'],
+                 [QgsAggregateCalculator.CountDistinct, 'fldstring'],
+                 [QgsAggregateCalculator.Min, 'fldstring'],
+                 [QgsAggregateCalculator.StringMaximumLength, 'fldstring'],
+                 [QgsAggregateCalculator.Max, 'upper(fldstring)'],
+                 [QgsAggregateCalculator.Sum, "attribute($currentfeature, 'fldint')"],
+                 [QgsAggregateCalculator.Max, "attribute($currentfeature, 'fldstring')"],
+                 [QgsAggregateCalculator.Min, 'flddatetime'],
+                 [QgsAggregateCalculator.Range, 'flddatetime'],
+                 [QgsAggregateCalculator.StringConcatenate, 'fldstring']]
+
+        for filter_string in [None, 'fldint > 500']:
+            sequential = QgsAggregateCalculator(layer)
+            sequential.setFilter(filter_string)
+            parallel = QgsAggregateCalculator(layer)
+            parallel.setFilter(filter_string)
+            parallel.setParallel(True)
+            for t in tests:
+                expected, ok = sequential.calculate(t[0], t[1])
+                self.assertTrue(ok)
+                val, ok = parallel.calculate(t[0], t[1])
+                self.assertTrue(ok)
+                if isinstance(expected, float):
+                    self.assertAlmostEqual(val, expected, 6)
+                else:
+                    self.assertEqual(val, expected)
+
     def testExpression(self):
         """ test aggregate calculation using an expression """
 
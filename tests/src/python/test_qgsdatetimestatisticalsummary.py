@@ -65,6 +65,33 @@ class PyQgsDateTimeStatisticalSummary(unittest.TestCase):
         self.assertEqual(s.range(), QgsInterval(693871147))
         self.assertEqual(s2.range(), QgsInterval(693871147))
 
+    def testMerge(self):
+        """ test merging partial summaries """
+        dates = [QDateTime(QDate(2015, 3, 4), QTime(11, 10, 54)),
+                 QDateTime(QDate(2011, 1, 5), QTime(15, 3, 1)),
+                 QDateTime(QDate(2015, 3, 4), QTime(11, 10, 54)),
+                 QDateTime(),
+                 QDateTime(QDate(2019, 12, 28), QTime(23, 10, 1)),
+                 QDateTime(QDate(1998, 1, 2), QTime(1, 10, 54))]
+        s = QgsDateTimeStatisticalSummary()
+        s.calculate(dates)
+
+        s1 = QgsDateTimeStatisticalSummary()
+        s2 = QgsDateTimeStatisticalSummary()
+        for d in dates[:3]:
+            s1.addValue(d)
+        for d in dates[3:]:
+            s2.addValue(d)
+        s1.merge(QgsDateTimeStatisticalSummary())
+        s1.merge(s2)
+        s1.finalize()
+        self.assertEqual(s1.count(), s.count())
+        self.assertEqual(s1.countDistinct(), s.countDistinct())
+        self.assertEqual(s1.countMissing(), s.countMissing())
+        self.assertEqual(s1.min(), s.min())
+        self.assertEqual(s1.max(), s.max())
+        self.assertEqual(s1.range(), s.range())
+
     def testIndividualStats(self):
         # tests calculation of statistics one at a time, to make sure statistic calculations are not
         # dependent on each other
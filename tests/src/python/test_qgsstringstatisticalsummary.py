@@ -55,6 +55,30 @@ class PyQgsStringStatisticalSummary(unittest.TestCase):
         s.calculate(['1111111', '111', '11111'])
         self.assertEqual(s.minLength(), 3)
 
+    def testMerge(self):
+        """ test merging partial summaries """
+        strings = ['cc', 'aaaa', 'bbbbbbbb', 'aaaa', 'eeee', '', 'eeee', '', 'dddd']
+        s = QgsStringStatisticalSummary()
+        s.calculate(strings)
+
+        s1 = QgsStringStatisticalSummary()
+        s2 = QgsStringStatisticalSummary()
+        for string in strings[:4]:
+            s1.addString(string)
+        for string in strings[4:]:
+            s2.addString(string)
+        s1.merge(QgsStringStatisticalSummary())
+        s1.merge(s2)
+        s1.finalize()
+        self.assertEqual(s1.count(), s.count())
+        self.assertEqual(s1.countDistinct(), s.countDistinct())
+        self.assertEqual(s1.countMissing(), s.countMissing())
+        self.assertEqual(s1.min(), s.min())
+        self.assertEqual(s1.max(), s.max())
+        self.assertEqual(s1.minLength(), s.minLength())
+        self.assertEqual(s1.maxLength(), s.maxLength())
+        self.assertEqual(s1.meanLength(), s.meanLength())
+
     def testIndividualStats(self):
         # tests calculation of statistics one at a time, to make sure statistic calculations are not
         # dependent on each other